@@ -6,12 +6,14 @@
 #include "launchers/LauncherManager.h"
 #include "gog/GogAuth.h"
 #include "launchers/IStoreService.h"
+#include "gog/GogConcurrency.h"
 #include "gog/GogContentClient.h"
 #include "gog/GogInstallPlan.h"
 #include "gog/GogDownloader.h"
 #include "gog/GogInstallRegistry.h"
 #include "core/SecretStore.h"
 #include "launchers/SteamLauncher.h"
+#include "runner/ExecutableIndex.h"
 #include "runner/GameRunner.h"
 #include "utils/EnvBuilder.h"
 #include "utils/ProtonManager.h"
@@ -25,6 +27,7 @@
 #include <QDir>
 #include <QEventLoop>
 #include <QFileInfo>
+#include <QHash>
 #include <QJsonArray>
 #include <QJsonDocument>
 #include <QJsonObject>
@@ -33,6 +36,8 @@
 #include <QTextStream>
 #include <QTimer>
 
+#include <algorithm>
+
 namespace {
 
 // Every long option the CLI owns. isCliInvocation() matches against this list
@@ -44,7 +49,7 @@ const char* const kOptions[] = {
     "--print-launch-options", "--parse-launch-options",
     "--apply", "--launch", "--dry-run", "--set", "--timeout",
     "--gog-login-url", "--gog-status", "--store-list", "--gog-plan",
-    "--gog-install", "--gog-uninstall",
+    "--gog-install", "--gog-uninstall", "--max-parallel",
 };
 
 QTextStream& out()
@@ -319,14 +324,24 @@ int cmdListGames()
 
     LauncherManager& lm = LauncherManager::instance();
 
+    // Whatever each game's launcher already has stored, if it stores anything,
+    // asked once per launcher for all of its games rather than game by game.
+    QHash<QString, QList<Game>> byLauncher;
+    for (const Game& game : games) {
+        byLauncher[game.launcher()].append(game);
+    }
+    QHash<QString, QHash<QString, QString>> launchOptions;
+    for (auto it = byLauncher.constBegin(); it != byLauncher.constEnd(); ++it) {
+        if (const auto launcher = lm.launcher(it.key())) {
+            launchOptions.insert(it.key(), launcher->readAllLaunchOptions(it.value()));
+        }
+    }
+
     QJsonArray arr;
     for (const Game& game : games) {
         QJsonObject o = gameToJson(game);
         o["hasSettings"] = sm.hasSettings(game.settingsKey());
-        // Whatever this game's launcher already has stored, if it stores
-        // anything. Launchers that do not simply return nothing.
-        const auto launcher = lm.launcher(game.launcher());
-        o["launchOptions"] = launcher ? launcher->readLaunchOptions(game) : QString();
+        o["launchOptions"] = launchOptions.value(game.launcher()).value(game.id());
         arr.append(o);
     }
     printJson(arr);
@@ -404,39 +419,80 @@ int cmdParseLaunchOptions(const QString& raw)
     return Cli::Ok;
 }
 
-int cmdApply(const QString& appId, const QStringList& overrides)
+int cmdApply(const QStringList& appIds, const QStringList& overrides)
 {
-    Game game;
-    if (!findGame(appId, &game)) {
-        return fail(QString("no game with app id %1").arg(appId), Cli::UnknownGame);
+    // One discovery for all of them, and every id checked before anything is
+    // written: a typo in the tenth must not leave nine applied and a failure.
+    const QList<Game> all = discoverGames();
+    QList<Game> games;
+    for (const QString& appId : appIds) {
+        const auto it = std::find_if(all.cbegin(), all.cend(),
+                                     [&appId](const Game& g) { return g.id() == appId; });
+        if (it == all.cend()) {
+            return fail(QString("no game with app id %1").arg(appId), Cli::UnknownGame);
+        }
+        games.append(*it);
     }
 
-    DLSSSettings settings = settingsFor(game);
-    QString error;
-    if (!applyOverrides(settings, overrides, &error)) {
-        return fail(error, Cli::UsageError);
+    // Per launcher, so each writes its store once however many games it has.
+    QStringList launcherNames;
+    QHash<QString, QList<QPair<Game, DLSSSettings>>> changes;
+    QHash<QString, QString> wanted;
+    for (const Game& game : std::as_const(games)) {
+        DLSSSettings settings = settingsFor(game);
+        QString error;
+        if (!applyOverrides(settings, overrides, &error)) {
+            return fail(error, Cli::UsageError);
+        }
+        if (!LauncherManager::instance().launcher(game.launcher())) {
+            return fail(QString("no launcher registered for '%1'").arg(game.launcher()), Cli::Error);
+        }
+        if (!launcherNames.contains(game.launcher())) {
+            launcherNames << game.launcher();
+        }
+        changes[game.launcher()].append({game, settings});
+        wanted.insert(game.id(), EnvBuilder::buildLaunchOptions(settings));
     }
 
-    auto launcher = LauncherManager::instance().launcher(game.launcher());
-    if (!launcher) {
-        return fail(QString("no launcher registered for '%1'").arg(game.launcher()), Cli::Error);
+    QHash<QString, bool> applied;
+    for (const QString& name : std::as_const(launcherNames)) {
+        applied.insert(name, LauncherManager::instance().launcher(name)->applySettingsToAll(changes.value(name)));
     }
 
-    const QString wanted = EnvBuilder::buildLaunchOptions(settings);
-    const bool applied = launcher->applySettings(game, settings);
-    // Read it back rather than trusting the return value: applySettings reports
-    // success on paths where it did not actually change anything.
-    const QString readBack = launcher->readLaunchOptions(game);
+    // Read it back rather than trusting the return value: applySettings
+    // reports success on paths where it did not actually change anything.
+    QHash<QString, QHash<QString, QString>> readBacks;
+    for (const QString& name : std::as_const(launcherNames)) {
+        QList<Game> written;
+        for (const auto& change : changes.value(name)) {
+            written.append(change.first);
+        }
+        readBacks.insert(name, LauncherManager::instance().launcher(name)->readAllLaunchOptions(written));
+    }
 
-    QJsonObject o;
-    o["appId"]         = appId;
-    o["applied"]       = applied;
-    o["launchOptions"] = wanted;
-    o["readBack"]      = readBack;
-    o["matches"]       = readBack == wanted;
-    printJson(o);
+    QJsonArray results;
+    bool allApplied = true;
+    for (const Game& game : std::as_const(games)) {
+        const QString readBack = readBacks.value(game.launcher()).value(game.id());
+
+        QJsonObject o;
+        o["appId"]         = game.id();
+        o["applied"]       = applied.value(game.launcher());
+        o["launchOptions"] = wanted.value(game.id());
+        o["readBack"]      = readBack;
+        o["matches"]       = readBack == wanted.value(game.id());
+        results.append(o);
+        allApplied = allApplied && applied.value(game.launcher());
+    }
 
-    return applied ? Cli::Ok : Cli::Error;
+    // One game prints the object it always has; several, an array of them.
+    if (results.size() == 1) {
+        printJson(results.first().toObject());
+    } else {
+        printJson(results);
+    }
+
+    return allApplied ? Cli::Ok : Cli::Error;
 }
 
 QJsonObject planToJson(const GameRunner::LaunchPlan& plan)
@@ -500,6 +556,9 @@ int cmdLaunch(const QString& appId, const QStringList& overrides, bool dryRun, i
         return fail(error, Cli::UsageError);
     }
 
+    // Nothing here keeps a background pass of the library, and no list to
+    // keep responsive: a game the index has not seen is walked on the spot.
+    ExecutableIndex::instance().setWalkOnMiss(true);
     GameRunner runner;
 
     if (dryRun) {
@@ -701,7 +760,7 @@ int cmdStoreList(const QString& launcherName)
 
 // Download and install a GOG game, reporting progress on stderr so stdout stays
 // a single JSON object a script can parse.
-int cmdGogInstall(const QString& productId)
+int cmdGogInstall(const QString& productId, int maxParallel, const QString& installDir)
 {
     if (productId.isEmpty()) {
         return fail("--gog-install needs a GOG product id", UsageError);
@@ -757,6 +816,8 @@ int cmdGogInstall(const QString& productId)
 
     GogDownloader::Request request;
     request.productId = productId;
+    request.maxParallel = maxParallel;
+    request.installPath = installDir;
     downloader.enqueue(request);
     loop.exec();
 
@@ -970,7 +1031,8 @@ int run(QCoreApplication& app)
     const QCommandLineOption parseLaunchOptions("parse-launch-options",
         "Parse a launch-options <string> back into settings and print it as JSON.", "string");
     const QCommandLineOption apply("apply",
-        "Write the launch options for <appid> into Steam's localconfig.vdf.", "appid");
+        "Write the launch options for <appid> into Steam's localconfig.vdf. Repeatable, "
+        "or a comma-separated list; each user's file is written once for all of them.", "appid");
     const QCommandLineOption launch("launch",
         "Launch <appid>.", "appid");
     const QCommandLineOption dryRun("dry-run",
@@ -992,11 +1054,17 @@ int run(QCoreApplication& app)
         "Download and install GOG <productid>.", "productid");
     const QCommandLineOption gogUninstall("gog-uninstall",
         "Delete GOG <productid> and its Proton prefix.", "productid");
+    const QCommandLineOption maxParallel("max-parallel",
+        "With --gog-install: the most chunk downloads to keep in flight (1-16). "
+        "The download adapts below this; default is the GOG setting.", "count");
+    const QCommandLineOption installDir("install-dir",
+        "With --gog-install: install into <path>, keeping whatever of the game is already "
+        "there and downloading only what differs.", "path");
 
     parser.addOptions({steamInfo, listGames, steamClient, printLaunchOptions,
                        parseLaunchOptions, apply, launch, dryRun, set, timeout,
                        gogLoginUrl, gogStatus, storeList, gogPlan,
-                       gogInstall, gogUninstall});
+                       gogInstall, gogUninstall, maxParallel, installDir});
 
     if (!parser.parse(app.arguments())) {
         errs() << "protonforge: " << parser.errorText() << Qt::endl;
@@ -1057,7 +1125,35 @@ int run(QCoreApplication& app)
     if (parser.isSet(gogStatus))   return cmdGogStatus();
     if (parser.isSet(storeList))   return cmdStoreList(parser.value(storeList));
     if (parser.isSet(gogPlan))     return cmdGogPlan(parser.value(gogPlan));
-    if (parser.isSet(gogInstall))  return cmdGogInstall(parser.value(gogInstall));
+    if (parser.isSet(maxParallel) && !parser.isSet(gogInstall)) {
+        return fail("--max-parallel only applies to --gog-install", UsageError);
+    }
+    if (parser.isSet(installDir) && !parser.isSet(gogInstall)) {
+        return fail("--install-dir only applies to --gog-install", UsageError);
+    }
+    if (parser.isSet(gogInstall)) {
+        int ceiling = 0;
+        if (parser.isSet(maxParallel)) {
+            bool ok = false;
+            ceiling = parser.value(maxParallel).toInt(&ok);
+            if (!ok || ceiling < GogConcurrency::kFloor || ceiling > GogConcurrency::kHardCeiling) {
+                return fail(QStringLiteral("--max-parallel expects a number from %1 to %2")
+                                .arg(GogConcurrency::kFloor).arg(GogConcurrency::kHardCeiling),
+                            UsageError);
+            }
+        }
+        QString directory;
+        if (parser.isSet(installDir)) {
+            const QFileInfo info(parser.value(installDir));
+            if (!info.isDir()) {
+                return fail(QStringLiteral("--install-dir: %1 is not a directory")
+                                .arg(parser.value(installDir)),
+                            UsageError);
+            }
+            directory = info.absoluteFilePath();
+        }
+        return cmdGogInstall(parser.value(gogInstall), ceiling, directory);
+    }
     if (parser.isSet(gogUninstall)) return cmdGogUninstall(parser.value(gogUninstall));
     if (parser.isSet(steamInfo))   return cmdSteamInfo();
     if (parser.isSet(listGames))   return cmdListGames();
@@ -1070,7 +1166,19 @@ int run(QCoreApplication& app)
         return cmdParseLaunchOptions(parser.value(parseLaunchOptions));
     }
     if (parser.isSet(apply)) {
-        return cmdApply(parser.value(apply), overrides);
+        QStringList appIds;
+        for (const QString& value : parser.values(apply)) {
+            for (const QString& appId : value.split(',', Qt::SkipEmptyParts)) {
+                const QString trimmed = appId.trimmed();
+                if (!trimmed.isEmpty() && !appIds.contains(trimmed)) {
+                    appIds << trimmed;
+                }
+            }
+        }
+        if (appIds.isEmpty()) {
+            return fail("--apply expects an app id", UsageError);
+        }
+        return cmdApply(appIds, overrides);
     }
     if (parser.isSet(launch)) {
         bool ok = false;
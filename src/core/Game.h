@@ -55,6 +55,12 @@ public:
     bool isNativeLinux() const { return m_isNativeLinux; }
     void setIsNativeLinux(bool isNative) { m_isNativeLinux = isNative; }
 
+    // isNativeLinux() is a guess: discovery left the look that settles it for
+    // later, because it means walking the install directory. The launcher's
+    // classifyGames() finishes the job.
+    bool platformPending() const { return m_platformPending; }
+    void setPlatformPending(bool pending) { m_platformPending = pending; }
+
     int stateFlags() const { return m_stateFlags; }
     void setStateFlags(int flags) { m_stateFlags = flags; }
 
@@ -107,6 +113,7 @@ private:
     QString m_compatDataPath;
     QString m_shaderCachePath;
     bool m_isNativeLinux = false;
+    bool m_platformPending = false;
     int m_stateFlags = 4;      // Default: StateFullyInstalled
     qint64 m_buildId = 0;
     QString m_version;
@@ -0,0 +1,422 @@
+#include "SearchIndex.h"
+
+#include <QtConcurrent>
+
+#include <algorithm>
+#include <iterator>
+
+namespace {
+
+// How long typing has to pause before a query runs.
+constexpr int kDebounceMs = 120;
+
+quint64 trigramKey(QChar a, QChar b, QChar c)
+{
+    return (quint64(a.unicode()) << 32) | (quint64(b.unicode()) << 16) | quint64(c.unicode());
+}
+
+// Every trigram of `text`, each once.
+QList<quint64> trigramsOf(const QString& text)
+{
+    QList<quint64> trigrams;
+    for (qsizetype i = 0; i + 2 < text.size(); ++i) {
+        const quint64 key = trigramKey(text.at(i), text.at(i + 1), text.at(i + 2));
+        if (!trigrams.contains(key)) {
+            trigrams.append(key);
+        }
+    }
+    return trigrams;
+}
+
+bool isNumber(const QString& word)
+{
+    return std::all_of(word.cbegin(), word.cend(), [](QChar c) { return c.isDigit(); });
+}
+
+} // namespace
+
+// ---------------------------------------------------------------------------
+// SearchIndex
+// ---------------------------------------------------------------------------
+QString SearchIndex::normalize(const QString& text)
+{
+    // Symbols go before decomposing: compatibility decomposition spells ™ out
+    // as "TM", and "DOOM™" would be indexed as "doomtm".
+    QString symbolsRemoved = text;
+    for (QChar& c : symbolsRemoved) {
+        if (c.category() == QChar::Symbol_Other) {
+            c = QLatin1Char(' ');
+        }
+    }
+    const QString decomposed = symbolsRemoved.normalized(QString::NormalizationForm_KD);
+    QString out;
+    out.reserve(decomposed.size());
+    bool gap = false;
+    for (const QChar c : decomposed) {
+        if (c.isMark()) {
+            continue;   // the accent a decomposed letter left behind
+        }
+        if (c == QLatin1Char('\'') || c == QChar(0x2019)) {
+            continue;   // "Baldur's" is searched for as "baldurs"
+        }
+        if (!c.isLetterOrNumber()) {
+            gap = true;
+            continue;
+        }
+        if (gap && !out.isEmpty()) {
+            out += QLatin1Char(' ');
+        }
+        gap = false;
+        out += c.toCaseFolded();
+    }
+    return out;
+}
+
+int SearchIndex::allowedEdits(qsizetype length)
+{
+    if (length < 4) {
+        return 0;
+    }
+    return length < 8 ? 1 : 2;
+}
+
+int SearchIndex::prefixDistance(QStringView query, QStringView word, int max)
+{
+    const qsizetype m = query.size();
+    // Past m + max characters of the word no prefix can come within max.
+    const qsizetype n = std::min<qsizetype>(word.size(), m + max);
+
+    // Optimal string alignment: Levenshtein plus adjacent swaps. Three rows,
+    // since a swap looks two back.
+    std::vector<int> before(n + 1), previous(n + 1), current(n + 1);
+    for (qsizetype j = 0; j <= n; ++j) {
+        previous[j] = static_cast<int>(j);
+    }
+    for (qsizetype i = 1; i <= m; ++i) {
+        current[0] = static_cast<int>(i);
+        int rowMin = current[0];
+        for (qsizetype j = 1; j <= n; ++j) {
+            const int cost = query[i - 1] == word[j - 1] ? 0 : 1;
+            int d = std::min({previous[j] + 1, current[j - 1] + 1, previous[j - 1] + cost});
+            if (i > 1 && j > 1 && query[i - 1] == word[j - 2] && query[i - 2] == word[j - 1]) {
+                d = std::min(d, before[j - 2] + 1);
+            }
+            current[j] = d;
+            rowMin = std::min(rowMin, d);
+        }
+        if (rowMin > max) {
+            return max + 1;
+        }
+        std::swap(before, previous);
+        std::swap(previous, current);
+    }
+
+    // The whole query against any prefix of the word: the last row's best.
+    const int best = *std::min_element(previous.cbegin(), previous.cend());
+    return std::min(best, max + 1);
+}
+
+SearchIndex::SearchIndex(const QList<Document>& documents)
+{
+    m_keys.reserve(documents.size());
+    m_entries.reserve(documents.size());
+
+    for (int doc = 0; doc < documents.size(); ++doc) {
+        const Document& document = documents.at(doc);
+        m_keys.append(document.key);
+
+        Entry entry;
+        const QString title = normalize(document.title);
+        entry.keys.append(title);
+        for (const QString& alias : document.aliases) {
+            const QString key = normalize(alias);
+            if (!key.isEmpty() && !entry.keys.contains(key)) {
+                entry.keys.append(key);
+            }
+        }
+
+        const QStringList titleWords = title.split(QLatin1Char(' '), Qt::SkipEmptyParts);
+        if (titleWords.size() > 1) {
+            for (const QString& word : titleWords) {
+                entry.initials += isNumber(word) ? word : word.left(1);
+            }
+        }
+
+        for (const QString& key : entry.keys) {
+            for (const QString& word : key.split(QLatin1Char(' '), Qt::SkipEmptyParts)) {
+                if (!entry.words.contains(word)) {
+                    entry.words.append(word);
+                }
+            }
+        }
+        if (!entry.initials.isEmpty() && !entry.words.contains(entry.initials)) {
+            entry.words.append(entry.initials);
+        }
+
+        // Trigrams across word boundaries too, with a space either side, so
+        // "witcher 3" is found as a run and " wi" marks where a word starts.
+        QStringList indexed = entry.keys;
+        if (!entry.initials.isEmpty()) {
+            indexed.append(entry.initials);
+        }
+        for (const QString& key : indexed) {
+            for (const quint64 trigram : trigramsOf(QLatin1Char(' ') + key + QLatin1Char(' '))) {
+                std::vector<int>& postings = m_trigrams[trigram];
+                if (postings.empty() || postings.back() != doc) {
+                    postings.push_back(doc);
+                }
+            }
+        }
+        for (const QString& word : entry.words) {
+            m_words.emplace_back(word, doc);
+        }
+
+        m_entries.push_back(std::move(entry));
+    }
+
+    std::sort(m_words.begin(), m_words.end());
+}
+
+std::vector<int> SearchIndex::trigramCandidates(const QList<quint64>& trigrams, int maxEdits) const
+{
+    // Every edit breaks at most three of the query's trigrams. Never fewer
+    // than one in common, or every document would be a candidate.
+    const int needed = std::max(1, static_cast<int>(trigrams.size()) - 3 * maxEdits);
+
+    std::vector<int> hits(m_entries.size(), 0);
+    for (const quint64 trigram : trigrams) {
+        const auto it = m_trigrams.constFind(trigram);
+        if (it == m_trigrams.constEnd()) {
+            continue;
+        }
+        for (const int doc : it.value()) {
+            ++hits[doc];
+        }
+    }
+
+    std::vector<int> candidates;
+    for (int doc = 0; doc < static_cast<int>(hits.size()); ++doc) {
+        if (hits[doc] >= needed) {
+            candidates.push_back(doc);
+        }
+    }
+    return candidates;
+}
+
+std::vector<int> SearchIndex::prefixCandidates(const QStringList& words) const
+{
+    std::vector<int> candidates;
+    bool first = true;
+    for (const QString& word : words) {
+        std::vector<int> found;
+        auto it = std::lower_bound(m_words.cbegin(), m_words.cend(), word,
+                                   [](const std::pair<QString, int>& entry, const QString& value) {
+                                       return entry.first < value;
+                                   });
+        for (; it != m_words.cend() && it->first.startsWith(word); ++it) {
+            found.push_back(it->second);
+        }
+        std::sort(found.begin(), found.end());
+        found.erase(std::unique(found.begin(), found.end()), found.end());
+
+        if (first) {
+            candidates = std::move(found);
+            first = false;
+        } else {
+            std::vector<int> both;
+            std::set_intersection(candidates.cbegin(), candidates.cend(), found.cbegin(),
+                                  found.cend(), std::back_inserter(both));
+            candidates = std::move(both);
+        }
+        if (candidates.empty()) {
+            break;
+        }
+    }
+    return candidates;
+}
+
+int SearchIndex::rank(const Entry& entry, const QString& query, const QStringList& words) const
+{
+    int best = RankNone;
+    for (const QString& key : entry.keys) {
+        if (key == query) {
+            return RankExact;
+        }
+        if (key.startsWith(query)) {
+            best = std::min<int>(best, RankKeyPrefix);
+            continue;
+        }
+        for (qsizetype at = key.indexOf(query); at >= 0; at = key.indexOf(query, at + 1)) {
+            if (at == 0 || key.at(at - 1) == QLatin1Char(' ')) {
+                best = std::min<int>(best, RankWordPrefix);
+                break;
+            }
+            best = std::min<int>(best, RankSubstring);
+        }
+    }
+    // Initials are a shorthand, not the name: never ahead of a real word.
+    if (!entry.initials.isEmpty() && query.size() > 1 && entry.initials.startsWith(query)) {
+        best = std::min<int>(best, RankWordPrefix);
+    }
+    if (best != RankNone) {
+        return best;
+    }
+
+    // Each word of the query on its own: a prefix of some word, or close to
+    // one. The edits add up across words.
+    int edits = 0;
+    for (const QString& queryWord : words) {
+        const int allowed = allowedEdits(queryWord.size());
+        int closest = allowed + 1;
+        for (const QString& word : entry.words) {
+            if (word.startsWith(queryWord)) {
+                closest = 0;
+                break;
+            }
+            if (allowed > 0) {
+                closest = std::min(closest, prefixDistance(queryWord, word, allowed));
+            }
+        }
+        if (closest > allowed) {
+            return RankNone;
+        }
+        edits += closest;
+    }
+    return edits == 0 ? RankAllWordPrefixes : RankFuzzy + edits;
+}
+
+QList<int> SearchIndex::search(const QString& query) const
+{
+    QList<int> results;
+    const QString normalized = normalize(query);
+    if (normalized.isEmpty()) {
+        results.reserve(size());
+        for (int doc = 0; doc < size(); ++doc) {
+            results.append(doc);
+        }
+        return results;
+    }
+
+    const QStringList words = normalized.split(QLatin1Char(' '), Qt::SkipEmptyParts);
+    int maxEdits = 0;
+    for (const QString& word : words) {
+        maxEdits += allowedEdits(word.size());
+    }
+
+    // Trigrams from within each word only: the words of a query need not be
+    // next to each other, or in that order, in what they find. A query of
+    // nothing but short words has none, and goes by prefix.
+    QList<quint64> trigrams;
+    for (const QString& word : words) {
+        for (const quint64 trigram : trigramsOf(word)) {
+            if (!trigrams.contains(trigram)) {
+                trigrams.append(trigram);
+            }
+        }
+    }
+    const std::vector<int> candidates = trigrams.isEmpty()
+        ? prefixCandidates(words)
+        : trigramCandidates(trigrams, maxEdits);
+
+    std::vector<std::pair<int, int>> ranked;   // (rank, document)
+    for (const int doc : candidates) {
+        const int r = rank(m_entries[doc], normalized, words);
+        if (r != RankNone) {
+            ranked.emplace_back(r, doc);
+        }
+    }
+    std::sort(ranked.begin(), ranked.end());
+
+    results.reserve(static_cast<qsizetype>(ranked.size()));
+    for (const auto& [r, doc] : ranked) {
+        results.append(doc);
+    }
+    return results;
+}
+
+QStringList SearchIndex::searchKeys(const QString& query) const
+{
+    QStringList keys;
+    const QList<int> docs = search(query);
+    keys.reserve(docs.size());
+    for (const int doc : docs) {
+        keys.append(m_keys.at(doc));
+    }
+    return keys;
+}
+
+// ---------------------------------------------------------------------------
+// AsyncSearch
+// ---------------------------------------------------------------------------
+AsyncSearch::AsyncSearch(QObject* parent)
+    : QObject(parent)
+    , m_debounce(new QTimer(this))
+{
+    m_debounce->setSingleShot(true);
+    m_debounce->setInterval(kDebounceMs);
+    connect(m_debounce, &QTimer::timeout, this, &AsyncSearch::run);
+}
+
+void AsyncSearch::setDocuments(const QList<SearchIndex::Document>& documents)
+{
+    m_documents = documents;
+    ++m_documentsGeneration;
+    if (isActive()) {
+        m_debounce->start();   // what is shown was found in the old list
+    }
+}
+
+void AsyncSearch::setQuery(const QString& text)
+{
+    m_query = text;
+    if (!isActive()) {
+        m_debounce->stop();
+        ++m_generation;        // whatever is still running answers nobody
+        emit resultsReady(QString(), QStringList());
+        return;
+    }
+    m_debounce->start();
+}
+
+void AsyncSearch::run()
+{
+    if (!isActive()) {
+        return;
+    }
+
+    const quint64 generation = ++m_generation;
+    const QString query = m_query;
+    const std::shared_ptr<const SearchIndex> index = m_index;
+    const bool rebuild = !m_index || m_indexGeneration != m_documentsGeneration;
+    const QList<SearchIndex::Document> documents = rebuild ? m_documents
+                                                           : QList<SearchIndex::Document>();
+    const quint64 documentsGeneration = m_documentsGeneration;
+
+    auto* watcher = new QFutureWatcher<Result>(this);
+    connect(watcher, &QFutureWatcher<Result>::finished, this, [this, watcher, generation, query]() {
+        const Result result = watcher->result();
+        watcher->deleteLater();
+        // Two queries can both have built; the newer documents win whichever
+        // finishes last.
+        if (result.built && (!m_index || result.builtGeneration > m_indexGeneration)) {
+            m_index = result.built;
+            m_indexGeneration = result.builtGeneration;
+        }
+        if (generation == m_generation) {
+            emit resultsReady(query, result.keys);
+        }
+    });
+
+    watcher->setFuture(QtConcurrent::run([index, rebuild, documents, documentsGeneration,
+                                          query]() -> Result {
+        Result result;
+        std::shared_ptr<const SearchIndex> searched = index;
+        if (rebuild) {
+            result.built = std::make_shared<const SearchIndex>(documents);
+            result.builtGeneration = documentsGeneration;
+            searched = result.built;
+        }
+        result.keys = searched->searchKeys(query);
+        return result;
+    }));
+}
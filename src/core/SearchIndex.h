@@ -0,0 +1,149 @@
+#ifndef SEARCHINDEX_H
+#define SEARCHINDEX_H
+
+#include <QFutureWatcher>
+#include <QHash>
+#include <QList>
+#include <QObject>
+#include <QString>
+#include <QStringList>
+#include <QTimer>
+
+#include <memory>
+#include <utility>
+#include <vector>
+
+// What the library and store lists search: titles, ids and aliases, prepared
+// once so that a query never has to look at every title.
+//
+// Both lists used to run QString::contains(text, Qt::CaseInsensitive) over
+// every title on each keystroke, on the GUI thread. The store dialog then also
+// rebuilt every row. With tens of thousands of store entries, typing lagged
+// behind the keyboard. And "witcher3", "pokemon" for "Pokémon" or one wrong
+// letter found nothing.
+//
+// Everything indexed is normalized first. It is decomposed, stripped of
+// accents, case-folded, and punctuation becomes single spaces; apostrophes
+// are dropped, so "baldurs" finds "Baldur's". A query with a word of three
+// characters or more is answered from trigram postings. One of nothing but
+// shorter words is answered from a sorted word list, by prefix. Each candidate
+// is then checked against what was asked and ranked:
+//
+//   exact key > key prefix > word prefix > substring > every word a prefix,
+//   in any order > close within a few typos
+//
+// A title of several words can also be found by its initials, a number kept
+// whole: "rdr2", "gta5". Equal ranks keep the order the documents were given
+// in. The typo allowance grows with the word: none under four characters, one
+// up to seven, two beyond.
+//
+// Immutable once built, so one index can be searched from any thread.
+class SearchIndex
+{
+public:
+    struct Document {
+        QString key;            // what a result names; opaque to the index
+        QString title;
+        QStringList aliases;    // ids, launcher names, anything else to find it by
+    };
+
+    SearchIndex() = default;
+    explicit SearchIndex(const QList<Document>& documents);
+
+    int size() const { return static_cast<int>(m_keys.size()); }
+    const QString& key(int document) const { return m_keys.at(document); }
+
+    // Document numbers, best first. An empty query, after normalizing,
+    // matches everything in the order given.
+    QList<int> search(const QString& query) const;
+    QStringList searchKeys(const QString& query) const;
+
+    // --- pure helpers, public for tests ---
+
+    static QString normalize(const QString& text);
+
+    // The fewest edits (insert, delete, substitute, swap two neighbours) that
+    // turn `query` into some prefix of `word`, or max + 1 once it is plainly
+    // more than `max`.
+    static int prefixDistance(QStringView query, QStringView word, int max);
+
+    // Typos allowed in a query word of that length.
+    static int allowedEdits(qsizetype length);
+
+private:
+    struct Entry {
+        QStringList keys;   // normalized title first, then aliases
+        QStringList words;  // every word of every key
+        QString initials;   // empty for a one-word title
+    };
+
+    enum Rank {
+        RankExact = 0,
+        RankKeyPrefix,
+        RankWordPrefix,
+        RankSubstring,
+        RankAllWordPrefixes,
+        RankFuzzy,          // plus the number of edits
+        RankNone = 1000,
+    };
+
+    int rank(const Entry& entry, const QString& query, const QStringList& words) const;
+    std::vector<int> trigramCandidates(const QList<quint64>& trigrams, int maxEdits) const;
+    std::vector<int> prefixCandidates(const QStringList& words) const;
+
+    QStringList m_keys;
+    std::vector<Entry> m_entries;
+    QHash<quint64, std::vector<int>> m_trigrams;            // ascending, no repeats
+    std::vector<std::pair<QString, int>> m_words;           // sorted by word
+};
+
+// A search box's side of SearchIndex: the text is debounced, and building the
+// index and running the query both happen on a worker thread. An answer that
+// arrives after the user has typed on is dropped.
+class AsyncSearch : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit AsyncSearch(QObject* parent = nullptr);
+
+    // What to search from now on. Indexed with the next query rather than
+    // here, so a list that changes while nobody is searching costs nothing.
+    void setDocuments(const QList<SearchIndex::Document>& documents);
+
+    // Debounced. Clearing the text answers at once: there is nothing to run.
+    void setQuery(const QString& text);
+    QString query() const { return m_query; }
+
+    // True while the query is not empty. The last resultsReady() then holds
+    // the rows to show; otherwise every row is shown.
+    bool isActive() const { return !SearchIndex::normalize(m_query).isEmpty(); }
+
+    void setDelay(int ms) { m_debounce->setInterval(ms); }
+
+signals:
+    // Document keys, best first. Empty `query` means no filter at all.
+    void resultsReady(const QString& query, const QStringList& keys);
+
+private:
+    struct Result {
+        std::shared_ptr<const SearchIndex> built;   // null when none was needed
+        quint64 builtGeneration = 0;
+        QStringList keys;
+    };
+
+    void run();
+
+    QTimer* m_debounce;
+    QString m_query;
+    quint64 m_generation = 0;      // of queries; only the latest is answered
+
+    // The newest documents, and the newest index built from them. A query
+    // that finds the index behind builds it first, on its worker.
+    QList<SearchIndex::Document> m_documents;
+    quint64 m_documentsGeneration = 0;
+    std::shared_ptr<const SearchIndex> m_index;
+    quint64 m_indexGeneration = 0;
+};
+
+#endif // SEARCHINDEX_H
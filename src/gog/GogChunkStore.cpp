@@ -0,0 +1,400 @@
+#include "GogChunkStore.h"
+
+#include <QAtomicInteger>
+#include <QCoreApplication>
+#include <QDateTime>
+#include <QDir>
+#include <QDirIterator>
+#include <QFileInfo>
+#include <QMutexLocker>
+#include <QStandardPaths>
+#include <QtConcurrent/QtConcurrent>
+
+#include <algorithm>
+
+namespace {
+
+// Where inserts are written before they are known good. Inside the root, so
+// the rename into place never crosses a filesystem.
+const char* const kIncomingDir = "incoming";
+
+QString newTempName(const QString& key)
+{
+    static QAtomicInteger<quint64> counter;
+    return QStringLiteral("%1-%2-%3.part")
+        .arg(key)
+        .arg(QCoreApplication::applicationPid())
+        .arg(counter.fetchAndAddRelaxed(1));
+}
+
+} // namespace
+
+// ---------------------------------------------------------------- sink
+
+GogChunkStore::Sink::Sink(GogChunkStore* store, const QString& compressedMd5,
+                          const QString& tempPath)
+    : m_store(store)
+    , m_key(compressedMd5)
+    , m_file(tempPath)
+{
+}
+
+GogChunkStore::Sink::~Sink()
+{
+    if (!m_done) {
+        m_file.close();
+        QFile::remove(m_file.fileName());
+    }
+}
+
+void GogChunkStore::Sink::append(const char* data, qint64 size)
+{
+    if (m_done || m_failed || size <= 0) {
+        return;
+    }
+    // A full disk here loses the copy, not the download: the stream writing
+    // the game does not depend on this one.
+    if (m_file.write(data, size) != size) {
+        m_failed = true;
+        return;
+    }
+    m_size += size;
+}
+
+bool GogChunkStore::Sink::commit()
+{
+    if (m_done) {
+        return false;
+    }
+    m_done = true;
+    m_file.close();
+    if (m_failed || m_size == 0) {
+        QFile::remove(m_file.fileName());
+        return false;
+    }
+    return m_store->adopt(m_key, m_file.fileName(), m_size);
+}
+
+// ---------------------------------------------------------------- store
+
+GogChunkStore::GogChunkStore(const QString& root, qint64 budgetBytes)
+    : m_root(QDir(root).absolutePath())
+    , m_budget(qMax<qint64>(0, budgetBytes))
+{
+    if (m_budget > 0) {
+        QMutexLocker locker(&m_mutex);
+        startLoading();
+    }
+}
+
+GogChunkStore::~GogChunkStore()
+{
+    m_closing = true;
+    // Waited for unlocked: the walk takes the lock to finish.
+    QFuture<void> loading;
+    {
+        QMutexLocker locker(&m_mutex);
+        loading = m_loading;
+    }
+    loading.waitForFinished();
+}
+
+QString GogChunkStore::defaultRoot()
+{
+    return QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + "/gog-chunks";
+}
+
+bool GogChunkStore::isValidKey(const QString& key)
+{
+    if (key.size() != 32) {
+        return false;
+    }
+    for (const QChar c : key) {
+        if (!c.isDigit() && !(c >= 'a' && c <= 'f') && !(c >= 'A' && c <= 'F')) {
+            return false;
+        }
+    }
+    return true;
+}
+
+QString GogChunkStore::pathFor(const QString& key) const
+{
+    // Lower-cased: manifests are not consistent about case, and a chunk must
+    // not be stored twice because two depots spelled its name differently.
+    const QString name = key.toLower();
+    return m_root + "/" + name.left(2) + "/" + name;
+}
+
+qint64 GogChunkStore::nextStamp()
+{
+    // Strictly increasing, so two uses within one millisecond still order.
+    m_lastStamp = qMax(QDateTime::currentMSecsSinceEpoch(), m_lastStamp + 1);
+    return m_lastStamp;
+}
+
+void GogChunkStore::startLoading() const
+{
+    // Called with the lock held.
+    if (m_loadStarted) {
+        return;
+    }
+    m_loadStarted = true;
+    m_loading = QtConcurrent::run([this] { const_cast<GogChunkStore*>(this)->load(); });
+}
+
+QFuture<void> GogChunkStore::loaded() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_loading;
+}
+
+void GogChunkStore::load()
+{
+    // On a worker, unlocked: a store filling up from the download pool in the
+    // meantime only waits for this at the moment it commits.
+
+    // Inserts a crash interrupted. Never committed, so never trusted. Cleared
+    // before anything can be inserted, since beginInsert() waits for the walk;
+    // it is one flat directory, and almost always an empty one.
+    QDir(m_root + "/" + kIncomingDir).removeRecursively();
+
+    QHash<QString, Entry> found;
+    qint64 foundBytes = 0;
+    QDirIterator it(m_root, QDir::Files, QDirIterator::Subdirectories);
+    while (!m_closing && it.hasNext()) {
+        it.next();
+        const QFileInfo info = it.fileInfo();
+        const QString key = info.fileName();
+        if (!isValidKey(key) || info.absoluteFilePath() != pathFor(key)) {
+            continue;   // not ours; left alone rather than deleted
+        }
+        Entry entry;
+        entry.size = info.size();
+        entry.lastUsed = info.lastModified().toMSecsSinceEpoch();
+        found.insert(key.toLower(), entry);
+        foundBytes += entry.size;
+    }
+
+    QMutexLocker locker(&m_mutex);
+    m_entries = std::move(found);
+    m_storedBytes = foundBytes;
+    m_loaded = true;
+    if (m_budget > 0) {
+        trim();   // for a budget lowered while this ran
+    }
+    m_loadedCondition.wakeAll();
+}
+
+void GogChunkStore::waitUntilLoaded() const
+{
+    // Called with the lock held.
+    startLoading();
+    while (!m_loaded) {
+        m_loadedCondition.wait(&m_mutex);
+    }
+}
+
+bool GogChunkStore::isLoaded() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_loaded;
+}
+
+qint64 GogChunkStore::budget() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_budget;
+}
+
+void GogChunkStore::setBudget(qint64 bytes)
+{
+    QMutexLocker locker(&m_mutex);
+    m_budget = qMax<qint64>(0, bytes);
+    if (m_budget > 0) {
+        startLoading();
+    }
+    if (m_budget > 0 && m_loaded) {
+        trim();
+    }
+}
+
+bool GogChunkStore::contains(const QString& compressedMd5) const
+{
+    if (!isValidKey(compressedMd5)) {
+        return false;
+    }
+    QMutexLocker locker(&m_mutex);
+    if (m_budget <= 0 || !m_loaded) {
+        return false;
+    }
+    return m_entries.contains(compressedMd5.toLower());
+}
+
+QByteArray GogChunkStore::read(const QString& compressedMd5)
+{
+    if (!contains(compressedMd5)) {
+        return QByteArray();
+    }
+    const QString key = compressedMd5.toLower();
+
+    // Read unlocked: ten megabytes off a slow disk should not hold up every
+    // other thread's lookups. If an eviction removes the file meanwhile, the
+    // read simply fails and the chunk is fetched instead.
+    QFile file(pathFor(key));
+    QByteArray body;
+    if (file.open(QIODevice::ReadOnly)) {
+        body = file.readAll();
+    }
+
+    QMutexLocker locker(&m_mutex);
+    auto entry = m_entries.find(key);
+    if (body.isEmpty()) {
+        if (entry != m_entries.end()) {
+            m_storedBytes -= entry->size;
+            m_entries.erase(entry);
+        }
+        return QByteArray();
+    }
+    if (entry != m_entries.end()) {
+        entry->lastUsed = nextStamp();
+        file.setFileTime(QDateTime::fromMSecsSinceEpoch(entry->lastUsed),
+                         QFileDevice::FileModificationTime);
+    }
+    return body;
+}
+
+std::unique_ptr<GogChunkStore::Sink> GogChunkStore::beginInsert(const QString& compressedMd5)
+{
+    if (!isValidKey(compressedMd5) || !isEnabled()) {
+        return nullptr;
+    }
+    {
+        // Not before the walk has cleared out what a crash left in incoming/.
+        QMutexLocker locker(&m_mutex);
+        waitUntilLoaded();
+    }
+    const QString incoming = m_root + "/" + kIncomingDir;
+    if (!QDir().mkpath(incoming)) {
+        return nullptr;
+    }
+
+    std::unique_ptr<Sink> sink(
+        new Sink(this, compressedMd5.toLower(), incoming + "/" + newTempName(compressedMd5)));
+    if (!sink->m_file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        sink->m_done = true;   // nothing to clean up
+        return nullptr;
+    }
+    return sink;
+}
+
+bool GogChunkStore::insert(const QString& compressedMd5, const QByteArray& body)
+{
+    const std::unique_ptr<Sink> sink = beginInsert(compressedMd5);
+    if (!sink) {
+        return false;
+    }
+    sink->append(body);
+    return sink->commit();
+}
+
+bool GogChunkStore::adopt(const QString& key, const QString& tempPath, qint64 size)
+{
+    QMutexLocker locker(&m_mutex);
+    waitUntilLoaded();
+
+    // A chunk bigger than the whole budget would evict everything and then
+    // itself.
+    if (m_budget <= 0 || size > m_budget) {
+        QFile::remove(tempPath);
+        return false;
+    }
+
+    auto existing = m_entries.find(key);
+    if (existing != m_entries.end()) {
+        // Two installs fetched it at once. Same name, same bytes.
+        QFile::remove(tempPath);
+        existing->lastUsed = nextStamp();
+        return true;
+    }
+
+    const QString path = pathFor(key);
+    QDir().mkpath(QFileInfo(path).absolutePath());
+    QFile::remove(path);   // a stray the index does not know about
+    if (!QFile::rename(tempPath, path)) {
+        QFile::remove(tempPath);
+        return false;
+    }
+
+    Entry entry;
+    entry.size = size;
+    entry.lastUsed = nextStamp();
+    m_entries.insert(key, entry);
+    m_storedBytes += size;
+    trim();
+    return true;
+}
+
+void GogChunkStore::remove(const QString& compressedMd5)
+{
+    if (!isValidKey(compressedMd5)) {
+        return;
+    }
+    const QString key = compressedMd5.toLower();
+
+    QMutexLocker locker(&m_mutex);
+    waitUntilLoaded();
+    auto entry = m_entries.find(key);
+    if (entry != m_entries.end()) {
+        m_storedBytes -= entry->size;
+        m_entries.erase(entry);
+    }
+    QFile::remove(pathFor(key));
+}
+
+void GogChunkStore::trim()
+{
+    // Called with the lock held.
+    if (m_storedBytes <= m_budget) {
+        return;
+    }
+
+    QList<QPair<qint64, QString>> byAge;
+    byAge.reserve(m_entries.size());
+    for (auto it = m_entries.cbegin(); it != m_entries.cend(); ++it) {
+        byAge.append({it->lastUsed, it.key()});
+    }
+    std::sort(byAge.begin(), byAge.end());
+
+    for (const auto& [lastUsed, key] : std::as_const(byAge)) {
+        if (m_storedBytes <= m_budget) {
+            break;
+        }
+        QFile::remove(pathFor(key));
+        m_storedBytes -= m_entries.take(key).size;
+    }
+}
+
+qint64 GogChunkStore::storedBytes() const
+{
+    QMutexLocker locker(&m_mutex);
+    waitUntilLoaded();
+    return m_storedBytes;
+}
+
+int GogChunkStore::count() const
+{
+    QMutexLocker locker(&m_mutex);
+    waitUntilLoaded();
+    return static_cast<int>(m_entries.size());
+}
+
+void GogChunkStore::clear()
+{
+    QMutexLocker locker(&m_mutex);
+    waitUntilLoaded();
+    for (auto it = m_entries.cbegin(); it != m_entries.cend(); ++it) {
+        QFile::remove(pathFor(it.key()));
+    }
+    m_entries.clear();
+    m_storedBytes = 0;
+}
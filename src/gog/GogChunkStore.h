@@ -0,0 +1,159 @@
+#ifndef GOGCHUNKSTORE_H
+#define GOGCHUNKSTORE_H
+
+#include <QByteArray>
+#include <QFile>
+#include <QFuture>
+#include <QHash>
+#include <QMutex>
+#include <QString>
+#include <QWaitCondition>
+
+#include <atomic>
+#include <memory>
+
+// Downloaded chunks kept on disk, named by what GOG names them by.
+//
+// The content system addresses every chunk by the md5 of its compressed bytes,
+// and the same chunk turns up over and over: in each language depot that
+// shares a file, in a DLC that ships the base game's textures again, and in
+// every reinstall — after a Proton prefix went wrong, or into a different
+// library folder. Kept here, any of those is a local read instead of another
+// trip to the CDN for the same forty gigabytes.
+//
+// Stored compressed, exactly as served, at <root>/<first two hex>/<md5>. That
+// is half the disk of storing them inflated, and it means a stored chunk goes
+// back through the very same GogChunkStream checks as a downloaded one — so a
+// store that was corrupted by a crash or a bad sector costs a re-download of
+// that chunk, never a broken install.
+//
+// Bounded: once the stored total passes the budget, the least recently used
+// chunks go until it fits again. Recency is the file's mtime, so it survives
+// restarts without an index file of its own to keep consistent. A budget of
+// zero turns the store off, which is the default — it is a trade of disk for
+// bandwidth, and that is the user's call.
+//
+// The directory is the index, and reading it means walking every shard — tens
+// of thousands of files in a store of a useful size. That walk, and clearing
+// out what a crash left half-inserted, happen on a worker once the store is
+// on: as it is opened with a budget, or when setBudget() first gives it one,
+// since both happen with the downloader on the GUI thread. A store that stays
+// off never reads its directory at all. Until the walk is done, contains() and read() answer as if the store
+// were empty, and a budget set meanwhile is applied once it is. What has to
+// know the whole index — committing, removing, the totals — waits for it; all
+// of that happens on the download pool. isLoaded() and loaded() are for a
+// caller that would rather wait than fetch what the store may already have.
+//
+// Thread-safe: chunks are read and inserted from the download pool.
+class GogChunkStore
+{
+public:
+    // An insert in progress. Bytes are appended as the chunk streams in and
+    // only become visible to contains() and read() on commit(); destroyed
+    // without a commit, whatever was written is thrown away.
+    class Sink
+    {
+    public:
+        ~Sink();
+        Sink(const Sink&) = delete;
+        Sink& operator=(const Sink&) = delete;
+
+        void append(const char* data, qint64 size);
+        void append(const QByteArray& data) { append(data.constData(), data.size()); }
+
+        // Call only once the chunk has verified — the store trusts the name it
+        // was opened under. Returns false if the chunk could not be kept, which
+        // is never worth failing a download over.
+        bool commit();
+
+    private:
+        friend class GogChunkStore;
+        Sink(GogChunkStore* store, const QString& compressedMd5, const QString& tempPath);
+
+        GogChunkStore* m_store;
+        QString m_key;
+        QFile m_file;
+        qint64 m_size = 0;
+        bool m_failed = false;
+        bool m_done = false;
+    };
+
+    explicit GogChunkStore(const QString& root, qint64 budgetBytes = 0);
+    ~GogChunkStore();
+    GogChunkStore(const GogChunkStore&) = delete;
+    GogChunkStore& operator=(const GogChunkStore&) = delete;
+
+    // <XDG cache>/<organisation>/<application>/gog-chunks. A cache in the XDG
+    // sense: everything in it can be fetched again.
+    static QString defaultRoot();
+
+    // Whether `key` could name a chunk at all — 32 hex digits. Anything else
+    // is refused by every method rather than trusted as part of a path.
+    static bool isValidKey(const QString& key);
+
+    QString root() const { return m_root; }
+    qint64 budget() const;
+    bool isEnabled() const { return budget() > 0; }
+
+    // Whether the walk has finished, and its future — a finished one for a
+    // store that is off and has not been asked for its totals.
+    bool isLoaded() const;
+    QFuture<void> loaded() const;
+
+    // Shrinking the budget evicts at once, or as soon as the store has loaded;
+    // the first budget above zero starts the walk. Never waits for it.
+    void setBudget(qint64 bytes);
+
+    bool contains(const QString& compressedMd5) const;
+
+    // The compressed body, or an empty array if it is not here. Counts as a
+    // use for eviction.
+    QByteArray read(const QString& compressedMd5);
+
+    // For a whole body already in hand. Same contract as Sink::commit().
+    bool insert(const QString& compressedMd5, const QByteArray& body);
+
+    // Null when the store is off or the key is not one.
+    std::unique_ptr<Sink> beginInsert(const QString& compressedMd5);
+
+    // A chunk that read back wrong. Gone from the index and the disk.
+    void remove(const QString& compressedMd5);
+
+    // These, and clear(), wait for the store to load, starting the walk if the
+    // store is off.
+    qint64 storedBytes() const;
+    int count() const;
+
+    void clear();
+
+private:
+    struct Entry {
+        qint64 size = 0;
+        qint64 lastUsed = 0;   // ms since the epoch; mirrored in the file's mtime
+    };
+
+    QString pathFor(const QString& key) const;
+    qint64 nextStamp();
+    void startLoading() const;
+    void load();
+    void waitUntilLoaded() const;
+    void trim();
+    bool adopt(const QString& key, const QString& tempPath, qint64 size);
+
+    const QString m_root;
+    qint64 m_budget = 0;
+
+    mutable QMutex m_mutex;
+    mutable QWaitCondition m_loadedCondition;
+    bool m_loaded = false;
+    QHash<QString, Entry> m_entries;
+    qint64 m_storedBytes = 0;
+    qint64 m_lastStamp = 0;
+
+    // The walk, once the store is on. Cut short if the store is destroyed first.
+    mutable QFuture<void> m_loading;
+    mutable bool m_loadStarted = false;
+    std::atomic_bool m_closing{false};
+};
+
+#endif // GOGCHUNKSTORE_H
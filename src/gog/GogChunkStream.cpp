@@ -0,0 +1,182 @@
+#include "GogChunkStream.h"
+
+#include "gog/GogFileWriter.h"
+
+#include <zlib.h>
+
+namespace {
+
+// Both buffers are fixed for the stream's life. Sixty-four kilobytes is what
+// inflateData has always used for inflate's output; a megabyte is where larger
+// writes stop getting cheaper per byte.
+constexpr int kOutBufferSize = 64 * 1024;
+constexpr int kStagingSize = 1024 * 1024;
+
+bool matches(const QCryptographicHash& hash, const QString& expected)
+{
+    return expected.isEmpty()
+           || QString::fromLatin1(hash.result().toHex()).compare(expected, Qt::CaseInsensitive) == 0;
+}
+
+} // namespace
+
+struct GogChunkStream::Inflater {
+    z_stream stream = {};
+    bool initialised = false;
+};
+
+GogChunkStream::GogChunkStream(const QString& expectedCompressedMd5, const QString& expectedMd5,
+                               const QString& filePath, qint64 offset,
+                               GogFileWriter* writer)
+    : m_expectedCompressedMd5(expectedCompressedMd5)
+    , m_expectedMd5(expectedMd5)
+    , m_filePath(filePath)
+    , m_offset(offset)
+    , m_inflater(std::make_unique<Inflater>())
+    , m_outBuffer(kOutBufferSize, Qt::Uninitialized)
+    , m_writer(writer)
+{
+    if (!m_writer) {
+        m_ownWriter = std::make_unique<GogFileWriter>(1);
+        m_writer = m_ownWriter.get();
+    }
+
+    // The zlib wrapper, window bits 15 — the content system's format, not the
+    // raw deflate inside a ZIP. See GogContentClient::inflateData.
+    m_inflater->initialised = inflateInit2(&m_inflater->stream, 15) == Z_OK;
+    if (!m_inflater->initialised) {
+        m_inflateFailed = true;
+    }
+}
+
+GogChunkStream::~GogChunkStream()
+{
+    if (m_inflater->initialised) {
+        inflateEnd(&m_inflater->stream);
+    }
+}
+
+void GogChunkStream::feed(const char* data, qint64 size)
+{
+    if (m_finished || size <= 0) {
+        return;
+    }
+    m_bytesIn += size;
+    m_compressedHash.addData(QByteArrayView(data, size));
+
+    // Once inflate has failed or the file has refused a write, there is nothing
+    // left to do with the bytes but hash them: the compressed checksum still
+    // decides whether this was the CDN's fault or ours.
+    if (!m_inflateFailed && m_writeError.isNull()) {
+        inflateAvailable(data, size);
+    }
+}
+
+void GogChunkStream::inflateAvailable(const char* data, qint64 size)
+{
+    z_stream& stream = m_inflater->stream;
+
+    // uInt is 32 bits; a piece from readyRead never comes close, but writeChunk
+    // hands over a whole body and nothing stops that being large.
+    while (size > 0 && !m_inflateFailed && m_writeError.isNull()) {
+        const qint64 slice = qMin<qint64>(size, 1 << 30);
+        stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data));
+        stream.avail_in = static_cast<uInt>(slice);
+        data += slice;
+        size -= slice;
+
+        for (;;) {
+            if (m_streamEnded) {
+                // Bytes after the end of the zlib stream. inflateData stopped
+                // reading there too; the compressed md5 has already seen them,
+                // so a body with trailing junk still fails if it should.
+                stream.avail_in = 0;
+                break;
+            }
+
+            stream.next_out = reinterpret_cast<Bytef*>(m_outBuffer.data());
+            stream.avail_out = static_cast<uInt>(m_outBuffer.size());
+
+            const int status = ::inflate(&stream, Z_NO_FLUSH);
+            if (status != Z_OK && status != Z_STREAM_END && status != Z_BUF_ERROR) {
+                m_inflateFailed = true;
+                return;
+            }
+
+            const qint64 produced = m_outBuffer.size() - static_cast<qint64>(stream.avail_out);
+            if (produced > 0) {
+                m_inflatedHash.addData(QByteArrayView(m_outBuffer.constData(), produced));
+                if (!writeOut(m_outBuffer.constData(), produced)) {
+                    return;
+                }
+            }
+            if (status == Z_STREAM_END) {
+                m_streamEnded = true;
+                continue;
+            }
+            // A full output buffer may mean zlib is holding more, even with
+            // the input used up; only an empty-handed call says it is not.
+            if (status == Z_BUF_ERROR && produced == 0) {
+                break;
+            }
+            if (stream.avail_in == 0 && stream.avail_out != 0) {
+                break;
+            }
+        }
+    }
+}
+
+bool GogChunkStream::writeOut(const char* data, qint64 size)
+{
+    // Reserved on the first output rather than up front, so a chunk that is
+    // garbage from its first byte costs neither the megabyte nor the file.
+    if (m_staging.capacity() < kStagingSize) {
+        m_staging.reserve(kStagingSize);
+    }
+    m_staging.append(data, size);
+    return m_staging.size() < kStagingSize || flush();
+}
+
+bool GogChunkStream::flush()
+{
+    if (m_staging.isEmpty()) {
+        return true;
+    }
+    if (!m_writer->write(m_filePath, m_offset + m_bytesWritten, m_staging.constData(),
+                         m_staging.size(), &m_writeError)) {
+        return false;
+    }
+    m_bytesWritten += m_staging.size();
+    m_staging.resize(0);   // not clear(): that would give the megabyte back
+    return true;
+}
+
+GogChunkStream::Result GogChunkStream::finish()
+{
+    if (m_finished) {
+        return {QStringLiteral("a chunk was finished twice"), true};
+    }
+    m_finished = true;
+
+    if (!matches(m_compressedHash, m_expectedCompressedMd5)) {
+        return {QStringLiteral("the CDN sent a corrupt chunk"), true};
+    }
+    // An empty body, a truncated one and one that is not zlib at all all end
+    // here: none of them reached the end of a stream.
+    if (m_inflateFailed || (!m_streamEnded && m_writeError.isNull())) {
+        return {QStringLiteral("a chunk could not be decompressed"), true};
+    }
+    if (m_writeError.isNull() && !matches(m_inflatedHash, m_expectedMd5)) {
+        return {QStringLiteral("a chunk did not match its checksum after decompressing"), true};
+    }
+    // The staged tail goes out only now the chunk is known good; for a chunk
+    // under a megabyte that is the whole of it, and a bad one never touches
+    // the file.
+    if (m_writeError.isNull()) {
+        flush();
+    }
+    if (!m_writeError.isNull()) {
+        return {m_writeError, false};
+    }
+    return {};
+}
@@ -0,0 +1,93 @@
+#ifndef GOGCHUNKSTREAM_H
+#define GOGCHUNKSTREAM_H
+
+#include <QByteArray>
+#include <QCryptographicHash>
+#include <QString>
+
+#include <memory>
+
+class GogFileWriter;
+
+// One chunk on its way from the socket to its place in a file, without ever
+// being whole in memory.
+//
+// Fed the compressed body piece by piece as it arrives: each piece goes into
+// the compressed md5, through inflate into a fixed output buffer, and every
+// buffer that fills is hashed again and staged for the disk. Staged bytes go
+// out through GogFileWriter a megabyte at a time rather than per 64 KB buffer,
+// since sixteen writes where one would do is most of what a fast disk spends
+// on a chunk. What a chunk costs is therefore those two buffers and zlib's
+// window, whatever its size — not the compressed body plus two copies of the
+// inflated one, which with a dozen 10 MB chunks in flight on a 60 GB install
+// is the difference between downloading and swapping.
+//
+// The price is that the verdict only exists at the end. A corrupt chunk may
+// have been partly written by the time finish() says so, which is harmless: it is
+// never journalled as done, so the range is written again by the retry. What
+// finish() reports is exactly what GogDownloader::writeChunk reported for a
+// whole body, in the same order of precedence — a corrupt body first, then one
+// that would not inflate, then one that inflated to the wrong bytes, and only
+// then a file that would not take the write.
+//
+// Not thread-safe, but not thread-bound either: pieces may be fed from
+// different pool threads as long as they are fed one at a time and in order.
+class GogChunkStream
+{
+public:
+    struct Result {
+        QString error;         // null on success
+        bool retriable = false;
+        bool ok() const { return error.isNull(); }
+    };
+
+    // An empty expected md5 skips that check, as writeChunk always has. Writes
+    // go through `writer` — shared, so chunks of one file share a descriptor —
+    // or, without one, through a writer of the stream's own.
+    GogChunkStream(const QString& expectedCompressedMd5, const QString& expectedMd5,
+                   const QString& filePath, qint64 offset, GogFileWriter* writer = nullptr);
+    ~GogChunkStream();
+    GogChunkStream(const GogChunkStream&) = delete;
+    GogChunkStream& operator=(const GogChunkStream&) = delete;
+
+    void feed(const char* data, qint64 size);
+    void feed(const QByteArray& data) { feed(data.constData(), data.size()); }
+
+    // Everything has arrived. Call once; feeding afterwards is ignored.
+    Result finish();
+
+    qint64 bytesIn() const { return m_bytesIn; }
+    qint64 bytesWritten() const { return m_bytesWritten; }
+
+private:
+    struct Inflater;
+
+    void inflateAvailable(const char* data, qint64 size);
+    bool writeOut(const char* data, qint64 size);
+    bool flush();
+
+    QString m_expectedCompressedMd5;
+    QString m_expectedMd5;
+    QString m_filePath;
+    qint64 m_offset = 0;
+
+    QCryptographicHash m_compressedHash{QCryptographicHash::Md5};
+    QCryptographicHash m_inflatedHash{QCryptographicHash::Md5};
+    std::unique_ptr<Inflater> m_inflater;
+    QByteArray m_outBuffer;
+    QByteArray m_staging;           // inflated, hashed, not yet written
+    std::unique_ptr<GogFileWriter> m_ownWriter;
+    GogFileWriter* m_writer = nullptr;
+
+    qint64 m_bytesIn = 0;
+    qint64 m_bytesWritten = 0;
+
+    // The first thing to go wrong on each side, held until finish() so that the
+    // compressed checksum — which needs every byte — still gets the last word.
+    bool m_inflateFailed = false;
+    bool m_streamEnded = false;
+    QString m_writeError;
+    bool m_finished = false;
+};
+
+#endif // GOGCHUNKSTREAM_H
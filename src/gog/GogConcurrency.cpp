@@ -0,0 +1,99 @@
+#include "GogConcurrency.h"
+
+namespace {
+
+// A window stays open until every slot has delivered a chunk or this much time
+// has passed. On a slow link a 10 MB chunk takes longer than kWindowMs, and a
+// window with one arrival in it measures the chunk size, not the goodput.
+constexpr qint64 kMaxWindowMs = 5 * GogConcurrency::kWindowMs;
+
+// Less than this much more goodput after a raise, and the raise bought nothing.
+constexpr int kRaiseGainPercent = 5;
+
+// How long the limit sits on a plateau before probing above it again. Links
+// change — someone else stops streaming — so it is not held for good.
+constexpr int kPlateauHoldWindows = 8;
+
+} // namespace
+
+GogConcurrency::GogConcurrency(int initial, int ceiling)
+    : m_limit(kFloor)
+    , m_ceiling(qBound(kFloor, ceiling, kHardCeiling))
+{
+    m_limit = qBound(kFloor, initial, m_ceiling);
+}
+
+void GogConcurrency::chunkArrived(qint64 bytes, qint64 latencyMs)
+{
+    m_windowBytes += qMax<qint64>(0, bytes);
+    m_windowLatencySum += qMax<qint64>(0, latencyMs);
+    ++m_windowArrivals;
+}
+
+void GogConcurrency::chunkFailed(bool rotated)
+{
+    m_windowFailures += rotated ? 2 : 1;
+}
+
+void GogConcurrency::startWindow(qint64 nowMs)
+{
+    m_windowStart = nowMs;
+    m_windowBytes = 0;
+    m_windowLatencySum = 0;
+    m_windowArrivals = 0;
+    m_windowFailures = 0;
+}
+
+bool GogConcurrency::evaluate(qint64 nowMs, int verifierBacklog)
+{
+    if (m_windowStart < 0) {
+        startWindow(nowMs);
+        return false;
+    }
+
+    const qint64 elapsed = nowMs - m_windowStart;
+    if (elapsed < kWindowMs) {
+        return false;
+    }
+    // Failures are news at once; a quiet window waits for enough samples.
+    if (m_windowFailures == 0 && m_windowArrivals < m_limit && elapsed < kMaxWindowMs) {
+        return false;
+    }
+
+    const int before = m_limit;
+    const qint64 goodput = m_windowBytes * 1000 / elapsed;
+    const qint64 latency = m_windowArrivals > 0 ? m_windowLatencySum / m_windowArrivals : 0;
+    if (latency > 0 && (m_bestLatencyMs == 0 || latency < m_bestLatencyMs)) {
+        m_bestLatencyMs = latency;
+    }
+
+    if (m_windowFailures > 0) {
+        m_limit = qMax(kFloor, m_limit / 2);
+        m_goodputBeforeRaise = -1;
+        m_holdWindows = qMax(m_holdWindows, 1);
+    } else if (verifierBacklog > m_limit) {
+        m_limit = qMax(kFloor, m_limit - 1);
+        m_goodputBeforeRaise = -1;
+    } else if (m_goodputBeforeRaise >= 0
+               && goodput * 100 < m_goodputBeforeRaise * (100 + kRaiseGainPercent)) {
+        m_limit = qMax(kFloor, m_limit - 1);
+        m_goodputBeforeRaise = -1;
+        m_holdWindows = kPlateauHoldWindows;
+    } else if (m_bestLatencyMs > 0 && latency > m_bestLatencyMs * 2
+               && goodput <= m_lastGoodput) {
+        m_limit = qMax(kFloor, m_limit - 1);
+        m_goodputBeforeRaise = -1;
+    } else if (m_holdWindows > 0) {
+        --m_holdWindows;
+        m_goodputBeforeRaise = -1;
+    } else if (m_windowArrivals > 0 && m_limit < m_ceiling) {
+        m_goodputBeforeRaise = goodput;
+        ++m_limit;
+    } else {
+        m_goodputBeforeRaise = -1;
+    }
+
+    m_lastGoodput = goodput;
+    startWindow(nowMs);
+    return m_limit != before;
+}
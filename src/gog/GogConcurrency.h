@@ -0,0 +1,81 @@
+#ifndef GOGCONCURRENCY_H
+#define GOGCONCURRENCY_H
+
+#include <QtGlobal>
+
+// How many chunk requests the downloader keeps in flight, decided from what the
+// connection is actually doing rather than fixed up front.
+//
+// A fixed four leaves a gigabit line two-thirds idle and, on a congested hotel
+// network, keeps four requests queued behind each other until they hit the
+// transfer timeout. This is additive-increase, multiplicative-decrease over
+// fixed windows, the same shape TCP uses and for the same reason — it converges
+// on the most the path will carry and gets out of the way quickly when it will
+// not carry that any more:
+//
+//   A window with failures in it halves the limit. A rotation to the next CDN
+//   endpoint counts double, because it means a node stopped answering.
+//
+//   A verifier backlog larger than the limit lowers it by one. The disk or the
+//   CPU is the bottleneck then, and more sockets would only grow the queue of
+//   bodies waiting for the pool.
+//
+//   Latency well past the best seen, with no more goodput to show for it,
+//   lowers it by one: the extra requests are queueing, not transferring.
+//
+//   Otherwise, a window busy enough to say anything raises it by one — unless
+//   the previous raise bought less than five percent more goodput, in which
+//   case the raise is undone and the limit holds for a while before probing
+//   again. That plateau is where a link saturates, and what stops the limit
+//   climbing to the ceiling on a connection one request already fills.
+//
+// Pure: time is passed in, so every decision is testable without a socket.
+class GogConcurrency
+{
+public:
+    static constexpr int kFloor = 1;
+    // Past this, more requests only mean more 429s from GOG whatever the link.
+    // Qt negotiates HTTP/2 with the CDN where it can, so this is not bounded by
+    // HTTP/1.1's six connections per host; where it cannot, requests past six
+    // queue inside Qt, show up as latency, and the controller backs off.
+    static constexpr int kHardCeiling = 16;
+    static constexpr int kDefaultInitial = 4;
+    static constexpr int kDefaultCeiling = 8;
+    static constexpr qint64 kWindowMs = 2000;
+
+    explicit GogConcurrency(int initial = kDefaultInitial, int ceiling = kDefaultCeiling);
+
+    int limit() const { return m_limit; }
+    int ceiling() const { return m_ceiling; }
+
+    // A chunk's body arrived whole. `latencyMs` is request to last byte.
+    void chunkArrived(qint64 bytes, qint64 latencyMs);
+
+    // A request failed at the network level. `rotated` when the failure also
+    // moved the download on to the next endpoint.
+    void chunkFailed(bool rotated);
+
+    // Called on a timer. Does nothing until a full window has passed since the
+    // last decision; returns true when the limit changed, so the caller knows
+    // to start more requests.
+    bool evaluate(qint64 nowMs, int verifierBacklog);
+
+private:
+    void startWindow(qint64 nowMs);
+
+    int m_limit;
+    int m_ceiling;
+
+    qint64 m_windowStart = -1;
+    qint64 m_windowBytes = 0;
+    qint64 m_windowLatencySum = 0;
+    int m_windowArrivals = 0;
+    int m_windowFailures = 0;
+
+    qint64 m_bestLatencyMs = 0;         // the lowest per-window average seen
+    qint64 m_lastGoodput = 0;           // bytes/s in the previous window
+    qint64 m_goodputBeforeRaise = -1;   // bytes/s in the window before the last raise
+    int m_holdWindows = 0;
+};
+
+#endif // GOGCONCURRENCY_H
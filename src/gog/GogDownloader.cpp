@@ -1,7 +1,9 @@
 #include "GogDownloader.h"
 #include "gog/GogInstallRegistry.h"
+#include "gog/GogLocalReuse.h"
 #include "gog/GogOfflineClient.h"
 #include "gog/GogPlayTasks.h"
+#include "gog/ZipEntryStream.h"
 #include "gog/ZipReader.h"
 #include "gog/GogRequest.h"
 
@@ -9,24 +11,22 @@
 #include <QDir>
 #include <QFile>
 #include <QFileInfo>
-#include <QFutureWatcher>
 #include <QJsonArray>
 #include <QJsonDocument>
 #include <QJsonObject>
+#include <QMutex>
+#include <QMutexLocker>
 #include <QNetworkReply>
 #include <QSaveFile>
 #include <QSet>
 #include <QSettings>
 #include <QStorageInfo>
-#include <QtConcurrent>
+#include <QThread>
+
+#include <algorithm>
 
 namespace {
 
-// Qt's per-host HTTP/1.1 limit is six, and GOG starts answering 429 around
-// there. Four is the default because it saturates a normal connection without
-// getting anywhere near either ceiling.
-constexpr int kDefaultParallel = 4;
-constexpr int kMaxParallel = 6;
 constexpr int kMaxAttemptsPerChunk = 3;
 
 // How long before a signed link lapses we ask for a new one. Two minutes is
@@ -40,15 +40,58 @@ constexpr int kResignFloorMs = 30 * 1000;
 // download.
 constexpr int kBlindResignIntervalMs = 20 * 60 * 1000;
 
-constexpr int kJournalWriteIntervalMs = 2000;
+// Free space Preflight insists on beyond what the files still need.
+constexpr qint64 kFreeSpaceHeadroom = 64LL * 1024 * 1024;
+
+// Stored chunks placed at once. They need no socket, only the pool and the
+// disk, so they are not counted against the concurrency limit — but each one
+// holds its compressed body in memory until it is written.
+constexpr int kMaxStoreReads = 4;
 
 const char* const kJournalDir = ".protonforge-gog";
 
+// An offline installer fetched by range goes in spans of neighbouring entries,
+// so the thousands of small files a game has are not a request each. Large
+// enough that a request's round trip is noise beside its body, small enough
+// that there are plenty to spread over the connections.
+constexpr qint64 kOfflineSpanBytes = 8 * 1024 * 1024;
+// Bytes of entries not being installed that a span would rather read through
+// than end at: the shell header's neighbours, the odd skipped directory.
+constexpr qint64 kOfflineSpanGap = 64 * 1024;
+constexpr int kMaxAttemptsPerSpan = 3;
+// A central directory is a few megabytes for the largest installers. One that
+// claims to be far more is a damaged tail, not something to download.
+constexpr qint64 kMaxOfflineDirectory = 256 * 1024 * 1024;
+
 QString md5Hex(const QByteArray& data)
 {
     return QString::fromLatin1(QCryptographicHash::hash(data, QCryptographicHash::Md5).toHex());
 }
 
+// Where the concurrency controller starts. Four saturates a normal connection
+// without getting anywhere near GOG's 429s, and the controller finds the rest.
+int parallelStart()
+{
+    return QSettings().value("gog/parallelDownloads", GogConcurrency::kDefaultInitial).toInt();
+}
+
+// The most it may climb to: the request's own override when it carries one —
+// the CLI's --max-parallel — otherwise Settings → GOG. GogConcurrency clamps
+// either to its hard ceiling.
+int parallelCeiling(const GogDownloader::Request& request)
+{
+    if (request.maxParallel > 0) {
+        return request.maxParallel;
+    }
+    return QSettings().value("gog/maxParallelDownloads", GogConcurrency::kDefaultCeiling).toInt();
+}
+
+// Settings → GOG, in gigabytes. Zero — the default — keeps no chunks at all.
+qint64 chunkStoreBudget()
+{
+    return QSettings().value("gog/chunkStoreGB", 0).toLongLong() * 1024 * 1024 * 1024;
+}
+
 } // namespace
 
 GogDownloader& GogDownloader::instance()
@@ -73,10 +116,38 @@ GogDownloader::GogDownloader()
 
     // One slot per possible in-flight chunk, so a finished download never waits
     // on a verify thread while its socket sits idle.
-    m_pool.setMaxThreadCount(kMaxParallel);
+    m_pool.setMaxThreadCount(GogConcurrency::kHardCeiling);
+    m_clock.start();
 
     m_progressTimer.setInterval(100);
-    connect(&m_progressTimer, &QTimer::timeout, this, [this]() { emitProgress(); });
+    connect(&m_progressTimer, &QTimer::timeout, this, [this]() {
+        // The controller rides the progress tick rather than a timer of its
+        // own: it only means anything while chunks are moving, which is
+        // exactly when this one runs.
+        if (m_job && m_job->stage == Stage::Downloading && !m_job->paused
+            && m_concurrency.evaluate(m_clock.elapsed(), m_verifying)) {
+            pump();
+        }
+        // The journal's records go out in batches; this bounds how long one
+        // waits.
+        m_journal.flush();
+        // Unpacking reports by bytes, read off the workers' shared counters.
+        if (m_job && m_unpack) {
+            m_job->bytesCompleted = m_unpack->control.bytesWritten.load();
+            m_job->filesDone = m_unpack->filesDone.loadRelaxed();
+        }
+        if (m_job && m_fetch) {
+            qint64 bytes = m_fetch->settledBytes;
+            int files = m_fetch->settledFiles;
+            for (const std::shared_ptr<OfflineFetch::Pipe>& pipe : std::as_const(m_fetch->pipes)) {
+                bytes += pipe->written.load();
+                files += pipe->filesDone.loadRelaxed();
+            }
+            m_job->bytesCompleted = bytes;
+            m_job->filesDone = files;
+        }
+        emitProgress();
+    });
 
     m_resignTimer.setSingleShot(true);
     connect(&m_resignTimer, &QTimer::timeout, this, [this]() {
@@ -87,6 +158,12 @@ GogDownloader::GogDownloader()
             requestSecureLink();
         }
     });
+
+    connect(&m_storeLoaded, &QFutureWatcher<void>::finished, this, [this]() {
+        if (m_job && m_job->waitingForStore && !m_job->finished) {
+            startDownloading();
+        }
+    });
 }
 
 QString GogDownloader::journalDirName()
@@ -118,29 +195,15 @@ GogDownloader::ChunkResult GogDownloader::writeChunk(const QByteArray& compresse
 {
     // The compressed bytes first: CDN corruption is the common failure, and md5
     // of 10 MB is far cheaper than inflating it only to throw the result away.
+    // A streamed chunk cannot know this until its last byte; a whole one can.
     if (!expectedCompressedMd5.isEmpty()
         && md5Hex(compressed).compare(expectedCompressedMd5, Qt::CaseInsensitive) != 0) {
         return {QStringLiteral("the CDN sent a corrupt chunk"), true};
     }
 
-    const QByteArray inflated = GogContentClient::inflateData(compressed);
-    if (inflated.isNull()) {
-        return {QStringLiteral("a chunk could not be decompressed"), true};
-    }
-
-    if (!expectedMd5.isEmpty()
-        && md5Hex(inflated).compare(expectedMd5, Qt::CaseInsensitive) != 0) {
-        return {QStringLiteral("a chunk did not match its checksum after decompressing"), true};
-    }
-
-    QFile file(filePath);
-    if (!file.open(QIODevice::ReadWrite)) {
-        return {QStringLiteral("cannot write %1: %2").arg(filePath, file.errorString()), false};
-    }
-    if (!file.seek(offset) || file.write(inflated) != inflated.size()) {
-        return {QStringLiteral("writing to %1 failed: %2").arg(filePath, file.errorString()), false};
-    }
-    return {};
+    GogChunkStream stream(QString(), expectedMd5, filePath, offset);
+    stream.feed(compressed);
+    return stream.finish();
 }
 
 bool GogDownloader::isSafeToDiscard(const QString& path, const QString& installRoot)
@@ -172,6 +235,113 @@ bool GogDownloader::isSafeToDiscard(const QString& path, const QString& installR
     return clean.mid(root.size() + 1).contains('/');
 }
 
+struct GogDownloader::ChunkPipe {
+    ChunkPipe(const QString& compressedMd5, const QString& md5, const QString& filePath,
+              qint64 offset, GogFileWriter* writer, std::unique_ptr<GogChunkStore::Sink> sink)
+        : stream(compressedMd5, md5, filePath, offset, writer)
+        , keep(std::move(sink))
+    {
+    }
+
+    GogChunkStream stream;     // touched only by the task that holds `draining`
+    // The same compressed bytes on their way into the chunk store, or null
+    // when it is off. Committed only if the stream verifies.
+    std::unique_ptr<GogChunkStore::Sink> keep;
+
+    QMutex mutex;
+    QList<QByteArray> pending;
+    bool draining = false;
+    bool complete = false;     // the reply finished; nothing more will arrive
+    bool abandoned = false;    // aborted or refused; stop feeding, report nothing
+};
+
+struct GogDownloader::OfflineUnpack {
+    struct Item {
+        ZipReader::Entry entry;
+        QString dest;
+    };
+
+    QString archivePath;
+    ZipReader reader;           // read-only once open; shared by every worker
+    QList<Item> work;           // fixed before the first worker starts
+    QAtomicInt next;            // the next item a worker may take
+    QAtomicInt filesDone;
+    ZipReader::Control control;
+
+    QMutex mutex;
+    int running = 0;            // workers still going
+    QString error;              // the first failure, if any
+};
+
+struct GogDownloader::OfflineFetch {
+    struct Span {
+        qint64 begin = 0;           // in the installer; `end` is exclusive
+        qint64 end = 0;
+        QList<OfflineUnpack::Item> items;   // in archive order
+        int attempts = 0;
+    };
+
+    // One span's reply and the pieces of it not yet on disk, with ChunkPipe's
+    // baton: only the task holding `draining` feeds the streams, in order.
+    struct Pipe {
+        explicit Pipe(const Span& s) : span(s) {}
+
+        const Span span;
+        QMutex mutex;
+        QList<QByteArray> pending;
+        bool draining = false;
+        bool complete = false;      // the reply finished; nothing more will arrive
+        bool abandoned = false;     // paused or cancelled; report nothing
+
+        // GUI thread only: the span's bytes handed over so far, which is where
+        // a request cut short resumes.
+        qint64 received = 0;
+
+        // Touched only by the task holding the baton.
+        qint64 position = 0;
+        int item = 0;
+        std::unique_ptr<ZipEntryStream> stream;
+        QString error;
+        bool retriable = true;
+
+        // Read by the progress timer as the drain writes them.
+        std::atomic<qint64> written{0};
+        QAtomicInt filesDone;
+
+        // Hands the next piece of the span to the streams, starting each
+        // entry's stream at its header and finishing it at its end.
+        void feed(const ZipReader& reader, const QByteArray& piece);
+    };
+
+    QString url;                    // signed; every range is fetched from it
+    int linkSerial = 0;             // bumped each time `url` is signed anew
+    bool linkProven = true;         // something has been answered on `url`
+    bool relinking = false;         // a fresh `url` is on its way; nothing starts
+    ZipReader reader;               // the directory only; no file behind it
+    QNetworkReply* directoryReply = nullptr;
+
+    QList<Span> spans;
+    QList<int> queue;               // spans to fetch, largest first
+    QHash<QNetworkReply*, int> replies;
+    QHash<int, std::shared_ptr<Pipe>> pipes;   // from request until drained
+    QHash<int, qint64> startedAt;
+    QHash<int, int> linkOf;         // span -> the linkSerial its request went out on
+
+    int spansDone = 0;
+    qint64 settledBytes = 0;        // written by spans that have finished
+    int settledFiles = 0;
+};
+
+struct GogDownloader::ReusePass {
+    std::atomic<bool> cancelled{false};
+
+    QMutex mutex;
+    int pending = 0;                              // pool tasks not yet reported
+    QList<GogLocalReuse::FileScan> scans;
+    QHash<int, QList<GogLocalReuse::Copy>> copies; // destination file -> its copies
+    QList<GogLocalReuse::Copy> landed;
+};
+
 // ---------------------------------------------------------------- queue
 
 void GogDownloader::enqueue(const Request& request)
@@ -230,11 +400,14 @@ void GogDownloader::pause(const QString& productId)
         return;
     }
     m_job->paused = true;
+    if (m_unpack) {
+        m_unpack->control.setPaused(true);
+    }
     // In-flight replies are abandoned rather than drained: their chunks go back
     // on the queue and are re-fetched on resume. A part-received chunk is worth
     // nothing, since verification is whole-chunk.
     abortTransfers();
-    saveStateJournal(true);
+    m_journal.compact();
     emitProgress();
 }
 
@@ -244,6 +417,9 @@ void GogDownloader::resume(const QString& productId)
         return;
     }
     m_job->paused = false;
+    if (m_unpack) {
+        m_unpack->control.setPaused(false);
+    }
     emitProgress();
     pump();
 }
@@ -271,7 +447,7 @@ void GogDownloader::cancel(const QString& productId)
     // reference into it.
     const QString id = productId;
     abortTransfers();
-    saveStateJournal(true);
+    m_journal.compact();
     endJob();
     emit installFailed(id, QStringLiteral("Installation cancelled."));
 }
@@ -281,6 +457,13 @@ void GogDownloader::cancelAndDiscard(const QString& productId)
     QString installPath;
     QString root;
     if (isActive(productId)) {
+        // A directory the user pointed the install at held their files before
+        // it held ours; cancelling leaves it as it is.
+        if (!m_job->request.installPath.isEmpty()) {
+            cancel(productId);
+            GogInstallRegistry::instance().remove(productId);
+            return;
+        }
         installPath = m_job->installPath;
         root = m_job->request.installRoot.isEmpty() ? GogInstallRegistry::installRoot()
                                                     : m_job->request.installRoot;
@@ -354,6 +537,7 @@ void GogDownloader::startNext()
 
     ++m_jobGeneration;
     m_verifying = 0;
+    m_storeReads = 0;
 
     m_job = new Job;
     m_job->request = m_pending.takeFirst();
@@ -545,11 +729,16 @@ void GogDownloader::buildPlan()
         }
     }
 
-    const QString root = m_job->request.installRoot.isEmpty()
-                             ? GogInstallRegistry::installRoot()
-                             : m_job->request.installRoot;
-    m_job->installPath = GogInstallRegistry::storeDirectory(root) + "/"
-                         + m_job->plan.installDirectory;
+    if (!m_job->request.installPath.isEmpty()) {
+        m_job->installPath = QDir::cleanPath(m_job->request.installPath);
+    } else {
+        const QString root = m_job->request.installRoot.isEmpty()
+                                 ? GogInstallRegistry::installRoot()
+                                 : m_job->request.installRoot;
+        m_job->installPath = GogInstallRegistry::storeDirectory(root) + "/"
+                             + m_job->plan.installDirectory;
+    }
+    findReusableFiles();
 
     m_job->stage = Stage::Preflight;
     m_job->detail = QStringLiteral("Preparing %1 files…").arg(m_job->plan.files.size());
@@ -576,9 +765,11 @@ void GogDownloader::buildPlan()
     entry.complete    = false;
     GogInstallRegistry::instance().put(entry);
 
-    writePlanJournal();
-    loadStateJournal();
-    requestSecureLink();
+    if (!openJournal(&error)) {
+        failJob(error);
+        return;
+    }
+    reuseLocalChunks();
 }
 
 // ---------------------------------------------------------------- native .sh
@@ -612,6 +803,25 @@ void GogDownloader::tryOfflineInstaller()
         m_job->bytesTotal = total;
         emitProgress();
     });
+    m_contentConnections << connect(&offline, &GogOfflineClient::tailReady, this,
+                                    [this, productId](const QString& id, const QString& url,
+                                                      qint64 size, const QByteArray& tail) {
+        if (m_job && id == productId) onOfflineTail(url, size, tail);
+    });
+    m_contentConnections << connect(&offline, &GogOfflineClient::rangesRefused, this,
+                                    [this, productId](const QString& id) {
+        if (m_job && id == productId) downloadOfflineInstaller();
+    });
+    m_contentConnections << connect(&offline, &GogOfflineClient::linkRefreshed, this,
+                                    [this, productId](const QString& id, const QString& url) {
+        if (m_job && id == productId) onOfflineLink(url);
+    });
+    m_contentConnections << connect(&offline, &GogOfflineClient::linkRefreshFailed, this,
+                                    [this, productId](const QString& id, const QString& reason) {
+        if (m_job && id == productId && m_fetch) {
+            failJob(QStringLiteral("downloading the Linux installer failed: %1").arg(reason));
+        }
+    });
     m_contentConnections << connect(&offline, &GogOfflineClient::downloadFinished, this,
                                     [this, productId](const QString& id, const QString& path) {
         if (m_job && id == productId) onOfflineDownloaded(path);
@@ -656,17 +866,17 @@ void GogDownloader::onOfflineInstallers(const QList<GogOfflineClient::Installer>
         return;
     }
 
-    // The .sh is kept inside the journal directory, so cancelling and
-    // discarding removes the part-downloaded installer along with everything
-    // else rather than leaving several gigabytes behind.
+    // A first guess: what it unpacks to is at least this, and read by range
+    // the installer itself is never on disk. The real figure is only known
+    // once the directory is in, and onOfflineDirectory() checks it then.
+    // downloadOfflineInstaller() asks for twice this if the server turns out
+    // not to do ranges.
     const QStorageInfo storage(m_job->installPath);
     if (chosen.size > 0 && storage.isValid() && storage.bytesAvailable() > 0
-        && storage.bytesAvailable() < chosen.size * 2) {
-        // Twice: the archive and what it unpacks to both have to fit, since the
-        // installer is only deleted once extraction succeeds.
+        && storage.bytesAvailable() < chosen.size) {
         failJob(QStringLiteral("Not enough free space for the Linux installer: about %1 GB "
                                "needed, %2 GB available.")
-                    .arg(chosen.size * 2 / 1073741824.0, 0, 'f', 1)
+                    .arg(chosen.size / 1073741824.0, 0, 'f', 1)
                     .arg(storage.bytesAvailable() / 1073741824.0, 0, 'f', 1));
         return;
     }
@@ -683,6 +893,482 @@ void GogDownloader::onOfflineInstallers(const QList<GogOfflineClient::Installer>
     GogInstallRegistry::instance().put(entry);
 
     m_job->stage = Stage::Downloading;
+    m_job->detail = QStringLiteral("Reading the native Linux installer…");
+    emitProgress();
+
+    // A part-downloaded .sh from an earlier attempt is worth resuming rather
+    // than starting again by range.
+    if (QFileInfo(m_job->offlinePath).size() > 0) {
+        downloadOfflineInstaller();
+        return;
+    }
+    GogOfflineClient::instance().fetchTail(m_job->request.productId, chosen,
+                                           ZipReader::maxTailSize());
+}
+
+void GogDownloader::onOfflineTail(const QString& url, qint64 archiveSize, const QByteArray& tail)
+{
+    auto fetch = std::make_shared<OfflineFetch>();
+    fetch->url = url;
+    if (!fetch->reader.openTail(archiveSize, tail)) {
+        failJob(fetch->reader.errorString());
+        return;
+    }
+    const qint64 directorySize = fetch->reader.centralDirectorySize();
+    if (directorySize > kMaxOfflineDirectory) {
+        failJob(QStringLiteral("The installer's table of contents is implausibly large; the "
+                               "download is probably damaged."));
+        return;
+    }
+
+    // Small, and needed whole before anything else can start, so it is simply
+    // buffered.
+    m_fetch = fetch;
+    QNetworkReply* reply = m_networkManager->get(GogOfflineClient::rangeRequest(
+        url, fetch->reader.centralDirectoryOffset(), directorySize));
+    fetch->directoryReply = reply;
+    connect(reply, &QNetworkReply::finished, this, [this, fetch, reply]() {
+        onOfflineDirectory(fetch, reply);
+    });
+}
+
+void GogDownloader::onOfflineDirectory(const std::shared_ptr<OfflineFetch>& fetch,
+                                       QNetworkReply* reply)
+{
+    reply->deleteLater();
+    if (!m_job || m_job->finished || m_fetch != fetch || fetch->directoryReply != reply) {
+        return;
+    }
+    fetch->directoryReply = nullptr;
+
+    if (reply->error() != QNetworkReply::NoError
+        || reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt() != 206) {
+        m_fetch.reset();
+        failJob(QStringLiteral("downloading the Linux installer failed: %1")
+                    .arg(reply->errorString()));
+        return;
+    }
+    if (!fetch->reader.openCentralDirectory(reply->readAll())) {
+        m_fetch.reset();
+        failJob(fetch->reader.errorString());
+        return;
+    }
+
+    // The same selection unpackOfflineInstaller makes: only data/noarch/ is the
+    // game, and directories cost nothing to make here.
+    const QString prefix = QStringLiteral("data/noarch/");
+    QList<OfflineUnpack::Item> items;
+    qint64 total = 0;
+    for (const ZipReader::Entry& entry : fetch->reader.entries()) {
+        if (!entry.name.startsWith(prefix)) {
+            continue;
+        }
+        const QString relative = ZipReader::safeName(entry.name.mid(prefix.size()));
+        if (relative.isEmpty()) {
+            continue;
+        }
+        const QString dest = m_job->installPath + "/" + relative;
+        if (entry.isDirectory) {
+            QDir().mkpath(dest);
+            continue;
+        }
+        items.append({entry, dest});
+        if (!entry.isSymlink) {
+            total += entry.uncompressedSize;
+        }
+    }
+    if (items.isEmpty()) {
+        m_fetch.reset();
+        failJob(QStringLiteral("The installer contained no game files under %1.").arg(prefix));
+        return;
+    }
+
+    // What the game unpacks to, which for a compressed installer is well over
+    // the installer's own size, with the same headroom the content route
+    // keeps. Checked before the first byte is written, not when the disk
+    // fills half-way through.
+    const qint64 needed = total + kFreeSpaceHeadroom;
+    const QStorageInfo storage(m_job->installPath);
+    if (storage.isValid() && storage.bytesAvailable() > 0 && storage.bytesAvailable() < needed) {
+        m_fetch.reset();
+        failJob(QStringLiteral("Not enough free space for the Linux version: about %1 GB "
+                               "needed, %2 GB available.")
+                    .arg(needed / 1073741824.0, 0, 'f', 1)
+                    .arg(storage.bytesAvailable() / 1073741824.0, 0, 'f', 1));
+        return;
+    }
+
+    // In archive order, neighbours gathered into spans. An entry larger than a
+    // span is a span of its own.
+    std::sort(items.begin(), items.end(),
+              [](const OfflineUnpack::Item& a, const OfflineUnpack::Item& b) {
+        return a.entry.localHeaderOffset < b.entry.localHeaderOffset;
+    });
+    for (const OfflineUnpack::Item& item : std::as_const(items)) {
+        const qint64 begin = fetch->reader.entryHeaderOffset(item.entry);
+        const qint64 end = fetch->reader.entryEnd(item.entry);
+        if (!fetch->spans.isEmpty()) {
+            OfflineFetch::Span& last = fetch->spans.last();
+            if (begin >= last.end && begin - last.end <= kOfflineSpanGap
+                && end - last.begin <= kOfflineSpanBytes) {
+                last.end = end;
+                last.items.append(item);
+                continue;
+            }
+        }
+        OfflineFetch::Span span;
+        span.begin = begin;
+        span.end = end;
+        span.items.append(item);
+        fetch->spans.append(span);
+    }
+    // Largest first, for the reason unpackOfflineInstaller sorts its files.
+    for (int i = 0; i < fetch->spans.size(); ++i) {
+        fetch->queue.append(i);
+    }
+    std::sort(fetch->queue.begin(), fetch->queue.end(), [&fetch](int a, int b) {
+        const OfflineFetch::Span& x = fetch->spans.at(a);
+        const OfflineFetch::Span& y = fetch->spans.at(b);
+        return x.end - x.begin > y.end - y.begin;
+    });
+
+    m_job->filesTotal = static_cast<int>(items.size());
+    m_job->filesDone = 0;
+    m_job->bytesTotal = total;
+    m_job->bytesCompleted = 0;
+    m_job->detail = QStringLiteral("Installing the native Linux version…");
+    m_lastTickBytes = 0;
+    m_lastTickAt = QDateTime::currentDateTime();
+    m_progressTimer.start();
+    emitProgress();
+
+    pumpOfflineFetch();
+}
+
+void GogDownloader::pumpOfflineFetch()
+{
+    if (!m_job || m_job->finished || !m_fetch || m_fetch->directoryReply
+        || m_fetch->relinking) {
+        return;
+    }
+    // The same limit the chunks use, fed the same way: a span is a large
+    // chunk as far as the connection is concerned.
+    const int parallel = m_concurrency.limit();
+    while (!m_job->paused && m_fetch->replies.size() < parallel && !m_fetch->queue.isEmpty()) {
+        startOfflineSpan(m_fetch->queue.takeFirst());
+    }
+}
+
+void GogDownloader::startOfflineSpan(int spanIndex)
+{
+    const std::shared_ptr<OfflineFetch> fetch = m_fetch;
+    OfflineFetch::Span& span = fetch->spans[spanIndex];
+    ++span.attempts;
+
+    // A span whose request was cut short still has its pipe, and its streams
+    // their half-written entries: it picks up at the byte it stopped at.
+    std::shared_ptr<OfflineFetch::Pipe> pipe = fetch->pipes.value(spanIndex);
+    if (!pipe) {
+        pipe = std::make_shared<OfflineFetch::Pipe>(span);
+        pipe->position = span.begin;
+        fetch->pipes.insert(spanIndex, pipe);
+    }
+    const qint64 from = span.begin + pipe->received;
+    if (from >= span.end) {
+        // Every byte arrived before the connection failed; nothing to ask for.
+        QMutexLocker locker(&pipe->mutex);
+        pipe->complete = true;
+        if (!pipe->draining) {
+            pipe->draining = true;
+            locker.unlock();
+            drainOfflineSpan(fetch, spanIndex);
+        }
+        return;
+    }
+
+    QNetworkReply* reply = m_networkManager->get(
+        GogOfflineClient::rangeRequest(fetch->url, from, span.end - from));
+    fetch->replies.insert(reply, spanIndex);
+    fetch->startedAt.insert(spanIndex, m_clock.elapsed());
+    fetch->linkOf.insert(spanIndex, fetch->linkSerial);
+
+    connect(reply, &QNetworkReply::readyRead, this, [this, reply]() {
+        onOfflineSpanData(reply);
+    });
+    connect(reply, &QNetworkReply::finished, this, [this, reply]() {
+        onOfflineSpanReply(reply);
+    });
+}
+
+void GogDownloader::onOfflineSpanData(QNetworkReply* reply)
+{
+    if (!m_job || m_job->finished || !m_fetch || !m_fetch->replies.contains(reply)) {
+        return;
+    }
+    // Anything but the range asked for is not the installer's bytes.
+    if (reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt() != 206) {
+        return;
+    }
+    const int spanIndex = m_fetch->replies.value(reply);
+    if (m_fetch->linkOf.value(spanIndex) == m_fetch->linkSerial) {
+        m_fetch->linkProven = true;
+    }
+    const std::shared_ptr<OfflineFetch::Pipe> pipe = m_fetch->pipes.value(spanIndex);
+    const QByteArray piece = reply->readAll();
+    if (!pipe || piece.isEmpty()) {
+        return;
+    }
+    pipe->received += piece.size();
+    {
+        QMutexLocker locker(&pipe->mutex);
+        pipe->pending.append(piece);
+        if (pipe->draining) {
+            return;
+        }
+        pipe->draining = true;
+    }
+    drainOfflineSpan(m_fetch, spanIndex);
+}
+
+void GogDownloader::onOfflineSpanReply(QNetworkReply* reply)
+{
+    reply->deleteLater();
+    if (!m_job || m_job->finished || !m_fetch || !m_fetch->replies.contains(reply)) {
+        return;   // paused or cancelled; its span is already back on the queue
+    }
+    const std::shared_ptr<OfflineFetch> fetch = m_fetch;
+    const int spanIndex = fetch->replies.take(reply);
+    const qint64 latency = m_clock.elapsed() - fetch->startedAt.take(spanIndex);
+    const int link = fetch->linkOf.take(spanIndex);
+    const std::shared_ptr<OfflineFetch::Pipe> pipe = fetch->pipes.value(spanIndex);
+
+    // A failed request keeps its pipe: the retry resumes from the byte this
+    // one stopped at rather than unpacking the span again from its start.
+    const int status = reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+    if (status == 401 || status == 403) {
+        // The signed URL lapsed under a long install. The chunk route's rule:
+        // refused on a link nothing has yet been answered on, expiry is not
+        // the explanation, and asking again would only spin.
+        if (link == fetch->linkSerial && !fetch->linkProven) {
+            failJob(QStringLiteral("GOG refused the installer even with a freshly signed link "
+                                   "(HTTP %1). Signing in again may help.").arg(status));
+            return;
+        }
+        // Not the span's fault: the attempt is given back.
+        --fetch->spans[spanIndex].attempts;
+        fetch->queue.prepend(spanIndex);
+        if (link == fetch->linkSerial) {
+            requestOfflineLink();
+        } else {
+            pumpOfflineFetch();   // already signed anew since this one went out
+        }
+        return;
+    }
+    if (status != 206 || reply->error() != QNetworkReply::NoError) {
+        if (fetch->spans.at(spanIndex).attempts >= kMaxAttemptsPerSpan) {
+            failJob(QStringLiteral("downloading the Linux installer failed: %1")
+                        .arg(reply->error() != QNetworkReply::NoError
+                                 ? reply->errorString()
+                                 : QStringLiteral("HTTP %1").arg(status)));
+            return;
+        }
+        m_concurrency.chunkFailed(false);
+        fetch->queue.append(spanIndex);
+        pumpOfflineFetch();
+        return;
+    }
+
+    const OfflineFetch::Span& span = fetch->spans.at(spanIndex);
+    m_concurrency.chunkArrived(span.end - span.begin, latency);
+    if (pipe) {
+        const QByteArray tail = reply->readAll();
+        QMutexLocker locker(&pipe->mutex);
+        if (!tail.isEmpty()) {
+            pipe->pending.append(tail);
+        }
+        pipe->complete = true;
+        if (!pipe->draining) {
+            pipe->draining = true;
+            locker.unlock();
+            drainOfflineSpan(fetch, spanIndex);
+        }
+    }
+    pumpOfflineFetch();
+}
+
+void GogDownloader::drainOfflineSpan(const std::shared_ptr<OfflineFetch>& fetch, int spanIndex)
+{
+    // Inflate, CRC and write on the pool, as schedulePipe does for chunks; the
+    // network stays on this thread.
+    const std::shared_ptr<OfflineFetch::Pipe> pipe = fetch->pipes.value(spanIndex);
+    const quint64 generation = m_jobGeneration;
+    m_pool.start([this, fetch, spanIndex, pipe, generation]() {
+        for (;;) {
+            QByteArray piece;
+            {
+                QMutexLocker locker(&pipe->mutex);
+                if (pipe->abandoned) {
+                    pipe->pending.clear();
+                    pipe->draining = false;
+                    return;   // the stream's destructor removes its part-written file
+                }
+                if (pipe->pending.isEmpty()) {
+                    if (!pipe->complete) {
+                        pipe->draining = false;
+                        return;   // caught up with the socket; readyRead restarts us
+                    }
+                    break;
+                }
+                piece = pipe->pending.takeFirst();
+            }
+            pipe->feed(fetch->reader, piece);
+        }
+
+        // The reply ended. An entry it did not reach, or did not finish, was
+        // cut short; the retry fetches the whole span again.
+        if (pipe->error.isNull() && pipe->item < pipe->span.items.size()) {
+            pipe->error = QStringLiteral("%1: the archive ends mid-entry")
+                              .arg(pipe->span.items.at(pipe->item).entry.name);
+        }
+        pipe->stream.reset();
+
+        QMetaObject::invokeMethod(this, [this, fetch, spanIndex, generation]() {
+            if (generation == m_jobGeneration) {
+                onOfflineSpanDrained(fetch, spanIndex);
+            }
+        }, Qt::QueuedConnection);
+    });
+}
+
+void GogDownloader::OfflineFetch::Pipe::feed(const ZipReader& reader, const QByteArray& piece)
+{
+    // On a pool thread, holding the baton.
+    const char* data = piece.constData();
+    qint64 size = piece.size();
+    while (size > 0 && error.isNull() && item < span.items.size()) {
+        const OfflineUnpack::Item& current = span.items.at(item);
+        if (!stream) {
+            // Between entries: whatever sits before the next one's header — a
+            // data descriptor, an entry outside data/noarch/ — is read through.
+            const qint64 gap = reader.entryHeaderOffset(current.entry) - position;
+            if (gap > 0) {
+                const qint64 skip = qMin(gap, size);
+                data += skip;
+                size -= skip;
+                position += skip;
+                continue;
+            }
+            // A symlink's content is its target, kept in memory and not written.
+            stream = std::make_unique<ZipEntryStream>(
+                current.entry, current.entry.isSymlink ? QString() : current.dest, &written);
+        }
+
+        const qint64 used = stream->feed(data, size);
+        data += used;
+        size -= used;
+        position += used;
+        if (!stream->atEnd()) {
+            continue;
+        }
+
+        const QString failure = stream->finish();
+        if (!failure.isNull()) {
+            error = failure;
+            retriable = !stream->writeFailed();
+            stream.reset();
+            return;
+        }
+        if (current.entry.isSymlink) {
+            QFile::remove(current.dest);
+            QDir().mkpath(QFileInfo(current.dest).absolutePath());
+            QFile::link(QString::fromUtf8(stream->content()), current.dest);
+        }
+        stream.reset();
+        filesDone.ref();
+        ++item;
+    }
+}
+
+void GogDownloader::onOfflineSpanDrained(const std::shared_ptr<OfflineFetch>& fetch, int spanIndex)
+{
+    if (!m_job || m_job->finished || m_fetch != fetch) {
+        return;
+    }
+    const std::shared_ptr<OfflineFetch::Pipe> pipe = fetch->pipes.take(spanIndex);
+    if (!pipe) {
+        return;
+    }
+
+    if (!pipe->error.isNull()) {
+        // A disk that will not take the write will not take it on the next
+        // fetch either; bytes that would not unpack may well be fine next time.
+        if (!pipe->retriable || fetch->spans.at(spanIndex).attempts >= kMaxAttemptsPerSpan) {
+            failJob(pipe->error);
+            return;
+        }
+        fetch->queue.append(spanIndex);
+        pumpOfflineFetch();
+        return;
+    }
+
+    fetch->settledBytes += pipe->written.load();
+    fetch->settledFiles += pipe->filesDone.loadRelaxed();
+    if (++fetch->spansDone < fetch->spans.size()) {
+        pumpOfflineFetch();
+        return;
+    }
+
+    m_fetch.reset();
+    m_progressTimer.stop();
+    m_job->filesDone = m_job->filesTotal;
+    m_job->bytesCompleted = m_job->bytesTotal;
+    finishOfflineInstall(fetch->settledBytes);
+}
+
+void GogDownloader::requestOfflineLink()
+{
+    if (!m_fetch || m_fetch->relinking) {
+        return;
+    }
+    // Spans in flight finish on the old link or fail back onto the queue;
+    // none starts until the new one is in.
+    m_fetch->relinking = true;
+    GogOfflineClient::instance().refreshLink(m_job->request.productId, m_job->offlineInstaller);
+}
+
+void GogDownloader::onOfflineLink(const QString& url)
+{
+    if (!m_fetch || !m_fetch->relinking) {
+        return;
+    }
+    m_fetch->relinking = false;
+    m_fetch->url = url;
+    ++m_fetch->linkSerial;
+    m_fetch->linkProven = false;
+    pumpOfflineFetch();
+}
+
+void GogDownloader::downloadOfflineInstaller()
+{
+    // The installer as one file, then unpacked: for a server that does not
+    // answer ranges, and to resume a download an earlier version started.
+    const GogOfflineClient::Installer& chosen = m_job->offlineInstaller;
+
+    // The .sh is kept inside the journal directory, so cancelling and
+    // discarding removes the part-downloaded installer along with everything
+    // else rather than leaving several gigabytes behind.
+    const QStorageInfo storage(m_job->installPath);
+    if (chosen.size > 0 && storage.isValid() && storage.bytesAvailable() > 0
+        && storage.bytesAvailable() < chosen.size * 2) {
+        // Twice: the archive and what it unpacks to both have to fit, since the
+        // installer is only deleted once extraction succeeds.
+        failJob(QStringLiteral("Not enough free space for the Linux installer: about %1 GB "
+                               "needed, %2 GB available.")
+                    .arg(chosen.size * 2 / 1073741824.0, 0, 'f', 1)
+                    .arg(storage.bytesAvailable() / 1073741824.0, 0, 'f', 1));
+        return;
+    }
+
     m_job->detail = QStringLiteral("Downloading the native Linux installer…");
     emitProgress();
 
@@ -699,15 +1385,16 @@ void GogDownloader::onOfflineDownloaded(const QString& path)
 
 void GogDownloader::unpackOfflineInstaller(const QString& path)
 {
-    ZipReader reader;
-    if (!reader.open(path)) {
+    auto unpack = std::make_shared<OfflineUnpack>();
+    unpack->archivePath = path;
+    if (!unpack->reader.open(path)) {
         // MultiPart says so in its own words; anything else is a damaged
         // download, and the partial file is dropped so the next attempt starts
         // clean rather than resuming onto rubbish.
-        if (reader.status() != ZipReader::Status::MultiPart) {
+        if (unpack->reader.status() != ZipReader::Status::MultiPart) {
             QFile::remove(path);
         }
-        failJob(reader.errorString());
+        failJob(unpack->reader.errorString());
         return;
     }
 
@@ -716,18 +1403,10 @@ void GogDownloader::unpackOfflineInstaller(const QString& path)
     // none of it belongs in the install directory.
     const QString prefix = QStringLiteral("data/noarch/");
 
-    int total = 0;
-    for (const ZipReader::Entry& entry : reader.entries()) {
-        if (entry.name.startsWith(prefix) && !entry.isDirectory) {
-            ++total;
-        }
-    }
-    m_job->filesTotal = total;
-    m_job->filesDone = 0;
-
-    int extracted = 0;
-    qint64 written = 0;
-    for (const ZipReader::Entry& entry : reader.entries()) {
+    // Directories and symlinks here, where they cost nothing; the files go to
+    // the pool.
+    qint64 total = 0;
+    for (const ZipReader::Entry& entry : unpack->reader.entries()) {
         if (!entry.name.startsWith(prefix)) {
             continue;
         }
@@ -744,37 +1423,103 @@ void GogDownloader::unpackOfflineInstaller(const QString& path)
         }
 
         if (entry.isSymlink) {
-            const QByteArray target = reader.readEntry(entry);
+            const QByteArray target = unpack->reader.readEntry(entry);
             QFile::remove(dest);
             QDir().mkpath(QFileInfo(dest).absolutePath());
             QFile::link(QString::fromUtf8(target), dest);
             continue;
         }
 
-        QString error;
-        if (!reader.extractEntry(entry, dest, &error)) {
-            failJob(error);
-            return;
-        }
-        ++extracted;
-        written += entry.uncompressedSize;
+        unpack->work.append({entry, dest});
+        total += entry.uncompressedSize;
+    }
 
-        if (extracted % 32 == 0) {
-            m_job->filesDone = extracted;
-            emitProgress();
-        }
+    if (unpack->work.isEmpty()) {
+        failJob(QStringLiteral("The installer contained no game files under %1.").arg(prefix));
+        return;
     }
 
-    reader.close();
+    // Largest first, so the last worker to finish is not the one that picked
+    // up a 4 GB pak file at the very end.
+    std::sort(unpack->work.begin(), unpack->work.end(),
+              [](const OfflineUnpack::Item& a, const OfflineUnpack::Item& b) {
+        return a.entry.uncompressedSize > b.entry.uncompressedSize;
+    });
 
-    if (extracted == 0) {
-        failJob(QStringLiteral("The installer contained no game files under %1.").arg(prefix));
+    m_job->filesTotal = static_cast<int>(unpack->work.size());
+    m_job->filesDone = 0;
+    m_job->bytesTotal = total;
+    m_job->bytesCompleted = 0;
+    m_lastTickBytes = 0;
+    m_lastTickAt = QDateTime::currentDateTime();
+    m_unpack = unpack;
+    m_progressTimer.start();
+
+    // Each worker takes the next entry off a shared counter until none are
+    // left. Inflate is CPU-bound and an NVMe drive is nowhere near busy with
+    // one of them, so several run at once — each through the reader's pread,
+    // which has no seek position to fight over.
+    const int workers = std::min({QThread::idealThreadCount(), m_pool.maxThreadCount(),
+                                  static_cast<int>(unpack->work.size())});
+    unpack->running = qMax(1, workers);
+    for (int i = 0; i < unpack->running; ++i) {
+        m_pool.start([this, unpack]() {
+            for (;;) {
+                const int index = unpack->next.fetchAndAddRelaxed(1);
+                if (index >= unpack->work.size() || unpack->control.cancelled) {
+                    break;
+                }
+                const OfflineUnpack::Item& item = unpack->work.at(index);
+                QString error;
+                if (!unpack->reader.extractEntry(item.entry, item.dest, &error,
+                                                 &unpack->control)) {
+                    QMutexLocker locker(&unpack->mutex);
+                    // The first failure is the one worth reporting; the others
+                    // are most likely this cancellation arriving.
+                    if (unpack->error.isNull()) {
+                        unpack->error = error;
+                    }
+                    unpack->control.cancel();
+                    break;
+                }
+                unpack->filesDone.fetchAndAddRelaxed(1);
+            }
+
+            QMutexLocker locker(&unpack->mutex);
+            if (--unpack->running == 0) {
+                QMetaObject::invokeMethod(this, [this, unpack]() {
+                    onOfflineUnpacked(unpack);
+                }, Qt::QueuedConnection);
+            }
+        });
+    }
+}
+
+void GogDownloader::onOfflineUnpacked(const std::shared_ptr<OfflineUnpack>& unpack)
+{
+    if (!m_job || m_job->finished || m_unpack != unpack) {
+        return;   // cancelled; the job that started this has already ended
+    }
+    m_unpack.reset();
+    m_progressTimer.stop();
+    unpack->reader.close();
+
+    if (!unpack->error.isNull()) {
+        failJob(unpack->error);
         return;
     }
 
+    m_job->filesDone = m_job->filesTotal;
+    m_job->bytesCompleted = m_job->bytesTotal;
+
     // Only now: until extraction succeeded the archive was the only copy.
-    QFile::remove(path);
+    QFile::remove(unpack->archivePath);
+
+    finishOfflineInstall(m_job->bytesTotal);
+}
 
+void GogDownloader::finishOfflineInstall(qint64 written)
+{
     GogInstallRegistry& registry = GogInstallRegistry::instance();
     GogInstallRegistry::Entry entry = registry.entry(m_job->request.productId);
     entry.productId   = m_job->request.productId;
@@ -831,6 +1576,167 @@ void GogDownloader::fallBackToWindows()
     resolveBuilds();
 }
 
+// ---------------------------------------------------------------- already on disk
+
+void GogDownloader::findReusableFiles()
+{
+    // Called before Preflight, which creates every file in the plan: whatever
+    // exists at this point was here before this install and may hold chunks.
+    const bool update = !m_job->installedFingerprints.isEmpty();
+    QSet<QString> changed;
+    if (update) {
+        for (const GogInstallPlan::FileTask& file :
+             GogInstallPlan::diffAgainstFingerprints(m_job->plan, m_job->installedFingerprints)) {
+            changed.insert(file.relPath);
+        }
+    }
+
+    for (int fileIndex = 0; fileIndex < m_job->plan.files.size(); ++fileIndex) {
+        const GogInstallPlan::FileTask& file = m_job->plan.files.at(fileIndex);
+        // An unchanged file is taken whole by buildChunkQueue; hashing it
+        // would only confirm what its fingerprint already says.
+        if (!file.linkTarget.isEmpty() || file.size == 0
+            || (update && !changed.contains(file.relPath))) {
+            continue;
+        }
+        const QFileInfo info(m_job->installPath + "/" + file.relPath);
+        if (info.isFile() && info.size() > 0) {
+            m_job->reuseFiles << fileIndex;
+        }
+    }
+
+    // Only for an update, where they are known to be the game's own. In a
+    // directory the user pointed us at, a file outside the plan is theirs.
+    for (const QString& stale :
+         GogInstallPlan::removedPaths(m_job->plan, m_job->installedFingerprints)) {
+        const QFileInfo info(m_job->installPath + "/" + stale);
+        if (info.isFile() && info.size() > 0) {
+            m_job->reuseLeftovers << info.filePath();
+        }
+    }
+}
+
+void GogDownloader::reuseLocalChunks()
+{
+    // A resumed install made this pass the first time round, and what it found
+    // is in the journal. Hashing every file again to learn the same thing
+    // would cost a resume as much as the original install.
+    if (m_job->reuseFiles.isEmpty() || m_journal.doneCount() > 0) {
+        requestSecureLink();
+        return;
+    }
+
+    m_job->detail = QStringLiteral("Checking %1 file(s) already on disk…")
+                        .arg(m_job->reuseFiles.size());
+    emitProgress();
+
+    auto pass = std::make_shared<ReusePass>();
+    pass->pending = static_cast<int>(m_job->reuseFiles.size() + m_job->reuseLeftovers.size());
+    m_reuse = pass;
+
+    // One pool task per file: hashing is the slow part, and different files
+    // are independent reads that a fast disk serves in parallel.
+    const auto report = [this, pass](const GogLocalReuse::FileScan& scan) {
+        QMutexLocker locker(&pass->mutex);
+        pass->scans << scan;
+        if (--pass->pending == 0) {
+            QMetaObject::invokeMethod(this, [this, pass]() {
+                onFilesScanned(pass);
+            }, Qt::QueuedConnection);
+        }
+    };
+    for (int fileIndex : std::as_const(m_job->reuseFiles)) {
+        const GogInstallPlan::FileTask file = m_job->plan.files.at(fileIndex);
+        const QString path = m_job->installPath + "/" + file.relPath;
+        m_pool.start([pass, report, file, fileIndex, path]() {
+            report(GogLocalReuse::scanFile(file, fileIndex, path, &pass->cancelled));
+        });
+    }
+    const qint64 blockSize = GogLocalReuse::typicalChunkSize(m_job->plan);
+    for (const QString& path : std::as_const(m_job->reuseLeftovers)) {
+        m_pool.start([pass, report, path, blockSize]() {
+            report(GogLocalReuse::scanLeftover(path, blockSize, &pass->cancelled));
+        });
+    }
+}
+
+void GogDownloader::onFilesScanned(const std::shared_ptr<ReusePass>& pass)
+{
+    if (!m_job || m_job->finished || m_reuse != pass) {
+        return;   // the job this pass belonged to has ended
+    }
+
+    for (const GogLocalReuse::FileScan& scan : std::as_const(pass->scans)) {
+        if (scan.fileIndex < 0) {
+            continue;
+        }
+        const GogInstallPlan::FileTask& file = m_job->plan.files.at(scan.fileIndex);
+        for (int chunkIndex : scan.inPlace) {
+            m_journal.markDone(scan.fileIndex, chunkIndex);
+            m_job->reusedBytes += file.chunks.at(chunkIndex).size;
+        }
+    }
+
+    const QList<GogLocalReuse::Copy> copies =
+        GogLocalReuse::planCopies(m_job->plan, m_job->reuseFiles, pass->scans, {});
+    if (copies.isEmpty()) {
+        finishReuse();
+        return;
+    }
+    for (const GogLocalReuse::Copy& copy : copies) {
+        pass->copies[copy.fileIndex] << copy;
+    }
+
+    m_job->detail = QStringLiteral("Copying %1 piece(s) already on disk into place…")
+                        .arg(copies.size());
+    emitProgress();
+
+    // Per destination file, for the same reason as the scans — and so that
+    // one file's copies share its descriptor rather than racing for it.
+    pass->pending = static_cast<int>(pass->copies.size());
+    for (auto it = pass->copies.constBegin(); it != pass->copies.constEnd(); ++it) {
+        const QList<GogLocalReuse::Copy> forFile = it.value();
+        const QString path = m_job->installPath + "/" + m_job->plan.files.at(it.key()).relPath;
+        m_pool.start([this, pass, forFile, path]() {
+            const QList<GogLocalReuse::Copy> landed =
+                GogLocalReuse::copyChunks(forFile, path, m_writer, &pass->cancelled);
+            QMutexLocker locker(&pass->mutex);
+            pass->landed << landed;
+            if (--pass->pending == 0) {
+                QMetaObject::invokeMethod(this, [this, pass]() {
+                    onChunksCopied(pass);
+                }, Qt::QueuedConnection);
+            }
+        });
+    }
+}
+
+void GogDownloader::onChunksCopied(const std::shared_ptr<ReusePass>& pass)
+{
+    if (!m_job || m_job->finished || m_reuse != pass) {
+        return;
+    }
+    for (const GogLocalReuse::Copy& copy : std::as_const(pass->landed)) {
+        m_journal.markDone(copy.fileIndex, copy.chunkIndex);
+        m_job->reusedBytes += copy.size;
+    }
+    finishReuse();
+}
+
+void GogDownloader::finishReuse()
+{
+    m_reuse.reset();
+    if (m_job->reusedBytes > 0) {
+        qInfo("GogDownloader: %lld bytes of %s were already on disk",
+              static_cast<long long>(m_job->reusedBytes),
+              qPrintable(m_job->request.productId));
+        // Folded in now, so a resume reads one bitmap rather than a record
+        // for every chunk this pass found.
+        m_journal.compact();
+    }
+    requestSecureLink();
+}
+
 // ---------------------------------------------------------------- transfer
 
 bool GogDownloader::preflight(QString* error)
@@ -849,10 +1755,19 @@ bool GogDownloader::preflight(QString* error)
         return false;
     }
 
-    // Five percent of headroom: the depots are sparse files until written, and
-    // a filesystem that fills at 99 % takes the install down with it.
+    // What is still to be allocated, not the whole install: a resumed install
+    // already holds most of its space, and files preallocated last time have
+    // all of theirs. The fixed headroom is for the journal, the manifest and
+    // whatever else writes to the drive meanwhile; a filesystem that fills to
+    // the last block takes more than the install down with it.
+    qint64 needed = kFreeSpaceHeadroom;
+    for (const GogInstallPlan::FileTask& task : std::as_const(m_job->plan.files)) {
+        if (task.linkTarget.isEmpty()) {
+            const QString path = m_job->installPath + "/" + task.relPath;
+            needed += qMax<qint64>(0, task.size - GogFileWriter::allocatedBytes(path));
+        }
+    }
     const QStorageInfo storage(m_job->installPath);
-    const qint64 needed = m_job->plan.totalSize + m_job->plan.totalSize / 20;
     if (storage.isValid() && storage.bytesAvailable() > 0 && storage.bytesAvailable() < needed) {
         *error = QStringLiteral("Not enough free space on %1: %2 GB needed, %3 GB available.")
                      .arg(QString::fromUtf8(storage.rootPath().toUtf8()))
@@ -865,8 +1780,10 @@ bool GogDownloader::preflight(QString* error)
         QDir().mkpath(m_job->installPath + "/" + directory);
     }
 
-    // Create every file at its final size up front. Sparse, so it costs nothing,
-    // and it means ENOSPC surfaces here rather than eight gigabytes in.
+    // Create every file at its final size up front, with its blocks allocated:
+    // the filesystem can lay each one out contiguously rather than growing it
+    // a chunk at a time in whatever order the CDN answers, and ENOSPC surfaces
+    // here rather than eight gigabytes in.
     for (const GogInstallPlan::FileTask& task : std::as_const(m_job->plan.files)) {
         const QString path = m_job->installPath + "/" + task.relPath;
         QDir().mkpath(QFileInfo(path).absolutePath());
@@ -875,14 +1792,9 @@ bool GogDownloader::preflight(QString* error)
             continue;   // symlinks are made in finalize, once their targets exist
         }
 
-        QFile file(path);
-        if (!file.open(QIODevice::ReadWrite)) {
-            *error = QStringLiteral("Could not create %1: %2").arg(path, file.errorString());
-            return false;
-        }
-        if (file.size() != task.size && !file.resize(task.size)) {
-            *error = QStringLiteral("Could not reserve space for %1: %2")
-                         .arg(path, file.errorString());
+        const QString failure = GogFileWriter::preallocate(path, task.size);
+        if (!failure.isNull()) {
+            *error = failure;
             return false;
         }
     }
@@ -923,11 +1835,34 @@ void GogDownloader::onSecureLink(const GogContentClient::SecureLink& link)
     }
 
     if (m_job->stage != Stage::Downloading) {
-        m_job->stage = Stage::Downloading;
-        m_job->detail.clear();
-        buildChunkQueue();
-        m_progressTimer.start();
+        startDownloading();
+        return;
+    }
+    pump();
+}
+
+void GogDownloader::startDownloading()
+{
+    // Until the chunk store has read its directory it says it has nothing,
+    // and every chunk it does have would be fetched again. The read began
+    // when the store was opened, so this wait is at most once a session.
+    m_chunkStore.setBudget(chunkStoreBudget());
+    if (m_chunkStore.isEnabled() && !m_chunkStore.isLoaded()) {
+        if (!m_job->waitingForStore) {
+            m_job->waitingForStore = true;
+            m_job->detail = QStringLiteral("Reading the downloads kept for reuse…");
+            m_storeLoaded.setFuture(m_chunkStore.loaded());
+            emitProgress();
+        }
+        return;
     }
+
+    m_job->waitingForStore = false;
+    m_job->stage = Stage::Downloading;
+    m_job->detail.clear();
+    m_concurrency = GogConcurrency(parallelStart(), parallelCeiling(m_job->request));
+    buildChunkQueue();
+    m_progressTimer.start();
     pump();
 }
 
@@ -956,11 +1891,12 @@ void GogDownloader::buildChunkQueue()
         }
     }
 
+    qint64 storedBytes = 0;
     for (int fileIndex = 0; fileIndex < m_job->plan.files.size(); ++fileIndex) {
         const GogInstallPlan::FileTask& file = m_job->plan.files.at(fileIndex);
         if (unchanged.contains(file.relPath)) {
-            for (const ChunkPlacement& placement : chunkPlacements(file)) {
-                m_job->done.insert(placement.journalKey);
+            for (int chunkIndex = 0; chunkIndex < file.chunks.size(); ++chunkIndex) {
+                m_journal.markDone(fileIndex, chunkIndex);
             }
         }
 
@@ -970,7 +1906,7 @@ void GogDownloader::buildChunkQueue()
             const GogContentClient::Chunk& chunk = file.chunks.at(chunkIndex);
             m_job->bytesTotal += chunk.compressedSize;
 
-            if (m_job->done.contains(placements.at(chunkIndex).journalKey)) {
+            if (m_journal.isDone(fileIndex, chunkIndex)) {
                 // Already on disk from an earlier run — counted towards the bar
                 // so a resumed download does not restart at zero.
                 m_job->bytesCompleted += chunk.compressedSize;
@@ -984,6 +1920,10 @@ void GogDownloader::buildChunkQueue()
             task.chunk = chunk;
             m_job->tasks.append(task);
             ++remaining;
+
+            if (m_chunkStore.contains(chunk.compressedMd5)) {
+                storedBytes += chunk.compressedSize;
+            }
         }
 
         if (remaining > 0) {
@@ -993,6 +1933,22 @@ void GogDownloader::buildChunkQueue()
         }
     }
 
+    // Worth saying: otherwise the first minute of a reinstall runs at disk
+    // speed and the estimate that comes out of it means nothing.
+    QStringList notes;
+    if (m_job->reusedBytes > 0) {
+        notes << QStringLiteral("%1 GB was already in place and was not downloaded.")
+                     .arg(m_job->reusedBytes / 1073741824.0, 0, 'f', 1);
+    }
+    if (storedBytes > 0) {
+        notes << QStringLiteral("%1 GB of this install is kept locally and will not be "
+                                "downloaded again.")
+                     .arg(storedBytes / 1073741824.0, 0, 'f', 1);
+    }
+    if (!notes.isEmpty()) {
+        m_job->detail = notes.join(' ');
+    }
+
     m_lastTickBytes = m_job->bytesCompleted;
     m_lastTickAt = QDateTime::currentDateTime();
 }
@@ -1002,16 +1958,36 @@ void GogDownloader::pump()
     if (!m_job || m_job->finished) {
         return;
     }
+    if (m_fetch) {
+        pumpOfflineFetch();
+        return;
+    }
 
-    const int parallel = qBound(1, QSettings().value("gog/parallelDownloads", kDefaultParallel).toInt(),
-                                kMaxParallel);
+    const int parallel = m_concurrency.limit();
 
-    while (!m_job->paused && m_replies.size() < parallel && m_job->nextTask < m_job->tasks.size()) {
-        startChunk(m_job->nextTask++);
+    // In queue order. A chunk the store holds waits for a store slot rather
+    // than taking a network one, and the queue stops at the first chunk that
+    // has to wait — so neither kind can starve the other.
+    while (!m_job->paused && m_job->nextTask < m_job->tasks.size()) {
+        const ChunkTask& task = m_job->tasks.at(m_job->nextTask);
+        if (!task.skipStore && m_chunkStore.contains(task.chunk.compressedMd5)) {
+            if (m_storeReads >= kMaxStoreReads) {
+                break;
+            }
+            startStoredChunk(m_job->nextTask++);
+        } else {
+            if (m_replies.size() >= parallel) {
+                break;
+            }
+            startChunk(m_job->nextTask++);
+        }
+        if (!m_job) {
+            return;   // startChunk failed the job
+        }
     }
 
     const bool queueDrained = m_job->nextTask >= m_job->tasks.size();
-    if (queueDrained && m_replies.isEmpty() && m_verifying == 0
+    if (queueDrained && m_replies.isEmpty() && m_verifying == 0 && m_storeReads == 0
         && m_job->heldForResign.isEmpty() && !m_job->paused) {
         finalizeInstall();
     }
@@ -1040,6 +2016,13 @@ void GogDownloader::startChunk(int taskIndex)
     QNetworkReply* reply = m_networkManager->get(GogRequest::make(QUrl(url)));
     m_replies.insert(taskIndex, reply);
     m_inFlightBytes.insert(taskIndex, 0);
+    m_startedAt.insert(taskIndex, m_clock.elapsed());
+    m_pipes.insert(taskIndex, std::make_shared<ChunkPipe>(
+                                  task.chunk.compressedMd5, task.chunk.md5,
+                                  m_job->installPath + "/"
+                                      + m_job->plan.files.at(task.fileIndex).relPath,
+                                  task.offset, &m_writer,
+                                  m_chunkStore.beginInsert(task.chunk.compressedMd5)));
 
     connect(reply, &QNetworkReply::downloadProgress, this,
             [this, taskIndex](qint64 received, qint64) {
@@ -1047,11 +2030,89 @@ void GogDownloader::startChunk(int taskIndex)
             m_inFlightBytes[taskIndex] = received;
         }
     });
+    connect(reply, &QNetworkReply::readyRead, this, [this, taskIndex, reply]() {
+        onChunkData(taskIndex, reply);
+    });
     connect(reply, &QNetworkReply::finished, this, [this, taskIndex, reply]() {
         onChunkReply(taskIndex, reply);
     });
 }
 
+void GogDownloader::startStoredChunk(int taskIndex)
+{
+    const ChunkTask& task = m_job->tasks.at(taskIndex);
+    const QString compressedMd5 = task.chunk.compressedMd5;
+    const QString md5 = task.chunk.md5;
+    const QString filePath = m_job->installPath + "/" + m_job->plan.files.at(task.fileIndex).relPath;
+    const qint64 offset = task.offset;
+    const quint64 generation = m_jobGeneration;
+
+    ++m_storeReads;
+    m_pool.start([this, taskIndex, compressedMd5, md5, filePath, offset, generation]() {
+        // Through the same checks as a download: a stored chunk is trusted for
+        // its name and nothing else.
+        const QByteArray body = m_chunkStore.read(compressedMd5);
+        GogChunkStream stream(compressedMd5, md5, filePath, offset, &m_writer);
+        stream.feed(body);
+        const ChunkResult result = stream.finish();
+        if (!result.ok() && result.retriable) {
+            m_chunkStore.remove(compressedMd5);
+        }
+
+        QMetaObject::invokeMethod(this, [this, taskIndex, generation, result]() {
+            if (generation != m_jobGeneration) {
+                return;
+            }
+            --m_storeReads;
+            if (!m_job || m_job->finished) {
+                return;
+            }
+            if (!result.ok() && result.retriable) {
+                // Gone or damaged since the queue was built. Not the CDN's
+                // fault, so it costs none of the chunk's attempts.
+                ChunkTask retry = m_job->tasks.at(taskIndex);
+                retry.skipStore = true;
+                m_job->tasks.append(retry);
+                pump();
+                return;
+            }
+            onChunkVerified(taskIndex, result);
+        }, Qt::QueuedConnection);
+    });
+}
+
+void GogDownloader::onChunkData(int taskIndex, QNetworkReply* reply)
+{
+    if (!m_job || m_job->finished || m_replies.value(taskIndex) != reply) {
+        return;
+    }
+    // A 403 has a body too, and it is not a chunk. Left in the reply, it is
+    // simply dropped with it.
+    if (reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt() != 200) {
+        return;
+    }
+    const std::shared_ptr<ChunkPipe> pipe = m_pipes.value(taskIndex);
+    if (!pipe) {
+        return;
+    }
+
+    // Taken off the reply as it arrives, so neither Qt's buffer nor ours ever
+    // holds more than whatever the pool has not caught up with yet.
+    const QByteArray piece = reply->readAll();
+    if (piece.isEmpty()) {
+        return;
+    }
+    {
+        QMutexLocker locker(&pipe->mutex);
+        pipe->pending.append(piece);
+        if (pipe->draining) {
+            return;   // the task already running will get to it
+        }
+        pipe->draining = true;
+    }
+    schedulePipe(taskIndex, pipe);
+}
+
 void GogDownloader::onChunkReply(int taskIndex, QNetworkReply* reply)
 {
     reply->deleteLater();
@@ -1063,8 +2124,12 @@ void GogDownloader::onChunkReply(int taskIndex, QNetworkReply* reply)
     }
     m_replies.remove(taskIndex);
     m_inFlightBytes.remove(taskIndex);
+    const qint64 latency = m_clock.elapsed() - m_startedAt.take(taskIndex);
 
     const int status = reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+    if (status != 200 || reply->error() != QNetworkReply::NoError) {
+        dropPipe(taskIndex);
+    }
 
     if (status == 401 || status == 403) {
         ChunkTask task = m_job->tasks.at(taskIndex);
@@ -1094,25 +2159,84 @@ void GogDownloader::onChunkReply(int taskIndex, QNetworkReply* reply)
             || reply->error() == QNetworkReply::NetworkSessionFailedError
             || reply->error() == QNetworkReply::ProxyConnectionRefusedError
             || reply->error() == QNetworkReply::ServiceUnavailableError;
+        m_concurrency.chunkFailed(connectionProblem);
         retryChunk(taskIndex, connectionProblem);
         return;
     }
 
-    const QByteArray body = reply->readAll();
-    const ChunkTask task = m_job->tasks.at(taskIndex);
-    const QString filePath =
-        m_job->installPath + "/" + m_job->plan.files.at(task.fileIndex).relPath;
+    // Whatever arrived after the last readyRead, and then the verdict: md5,
+    // inflate and write have been keeping pace with the socket on the pool, so
+    // what is left is the tail of the body and the checksums.
+    const std::shared_ptr<ChunkPipe> pipe = m_pipes.take(taskIndex);
+    if (!pipe) {
+        // Succeeded with something other than a 200, so nothing was streamed.
+        // The old whole-body path would have failed to inflate it; same answer.
+        retryChunk(taskIndex, false);
+        return;
+    }
+    m_concurrency.chunkArrived(m_job->tasks.at(taskIndex).chunk.compressedSize, latency);
+    ++m_verifying;
+    const QByteArray tail = reply->readAll();
+    {
+        QMutexLocker locker(&pipe->mutex);
+        if (!tail.isEmpty()) {
+            pipe->pending.append(tail);
+        }
+        pipe->complete = true;
+        if (pipe->draining) {
+            return;   // the running task sees `complete` once it runs dry
+        }
+        pipe->draining = true;
+    }
+    schedulePipe(taskIndex, pipe);
+}
 
+void GogDownloader::schedulePipe(int taskIndex, const std::shared_ptr<ChunkPipe>& pipe)
+{
     // md5, inflate and write are 30–60 ms for a 10 MB chunk. Four of those on
     // the GUI thread is a visible freeze, so they go to the pool while the
-    // network stays here.
-    ++m_verifying;
+    // network stays here — a piece at a time now, rather than all at the end.
     const quint64 generation = m_jobGeneration;
-    auto* watcher = new QFutureWatcher<ChunkResult>(this);
-    connect(watcher, &QFutureWatcher<ChunkResult>::finished, this,
-            [this, watcher, taskIndex, generation]() {
-        const ChunkResult result = watcher->result();
-        watcher->deleteLater();
+    m_pool.start([this, taskIndex, pipe, generation]() {
+        drainPipe(taskIndex, pipe, generation);
+    });
+}
+
+void GogDownloader::drainPipe(int taskIndex, const std::shared_ptr<ChunkPipe>& pipe,
+                              quint64 generation)
+{
+    // On a pool thread. Only one drain per pipe runs at a time — `draining` is
+    // the baton — which is what keeps the pieces in order.
+    for (;;) {
+        QByteArray piece;
+        {
+            QMutexLocker locker(&pipe->mutex);
+            if (pipe->abandoned) {
+                pipe->pending.clear();
+                pipe->draining = false;
+                return;
+            }
+            if (pipe->pending.isEmpty()) {
+                if (!pipe->complete) {
+                    pipe->draining = false;
+                    return;   // caught up with the socket; readyRead restarts us
+                }
+                break;
+            }
+            piece = pipe->pending.takeFirst();
+        }
+        pipe->stream.feed(piece);
+        if (pipe->keep) {
+            pipe->keep->append(piece);
+        }
+    }
+
+    const ChunkResult result = pipe->stream.finish();
+    if (pipe->keep && result.ok()) {
+        pipe->keep->commit();
+    }
+    pipe->keep.reset();
+    QMetaObject::invokeMethod(this, [this, taskIndex, generation, result]() {
         // A verify belonging to a job that has since ended: neither its count
         // nor its outcome has anything to do with whatever is running now.
         if (generation != m_jobGeneration) {
@@ -1120,10 +2244,19 @@ void GogDownloader::onChunkReply(int taskIndex, QNetworkReply* reply)
         }
         --m_verifying;
         onChunkVerified(taskIndex, result);
-    });
-    watcher->setFuture(QtConcurrent::run(&m_pool, &GogDownloader::writeChunk, body,
-                                         task.chunk.compressedMd5, task.chunk.md5,
-                                         filePath, task.offset));
+    }, Qt::QueuedConnection);
+}
+
+void GogDownloader::dropPipe(int taskIndex)
+{
+    const std::shared_ptr<ChunkPipe> pipe = m_pipes.take(taskIndex);
+    if (!pipe) {
+        return;
+    }
+    // Whatever it already wrote stays — harmless, since the chunk is not
+    // journalled as done and its retry writes the same range in full.
+    QMutexLocker locker(&pipe->mutex);
+    pipe->abandoned = true;
 }
 
 void GogDownloader::onChunkVerified(int taskIndex, const ChunkResult& result)
@@ -1145,9 +2278,10 @@ void GogDownloader::onChunkVerified(int taskIndex, const ChunkResult& result)
     }
 
     const ChunkTask& task = m_job->tasks.at(taskIndex);
-    const GogInstallPlan::FileTask& file = m_job->plan.files.at(task.fileIndex);
 
-    m_job->done.insert(chunkPlacements(file).at(task.chunkIndex).journalKey);
+    // On disk first, journalled second: a crash between the two costs this
+    // chunk again, never a hole that the journal calls finished.
+    m_journal.markDone(task.fileIndex, task.chunkIndex);
     m_job->bytesCompleted += task.chunk.compressedSize;
 
     const int remaining = m_job->remainingChunks.value(task.fileIndex, 0) - 1;
@@ -1158,7 +2292,6 @@ void GogDownloader::onChunkVerified(int taskIndex, const ChunkResult& result)
         m_job->remainingChunks[task.fileIndex] = remaining;
     }
 
-    saveStateJournal();
     pump();
 }
 
@@ -1197,6 +2330,9 @@ void GogDownloader::finalizeInstall()
     m_resignTimer.stop();
     emitProgress();
 
+    // Every chunk is verified and written; nothing is left to go through them.
+    m_writer.closeAll();
+
     for (const GogInstallPlan::FileTask& file : std::as_const(m_job->plan.files)) {
         const QString path = m_job->installPath + "/" + file.relPath;
 
@@ -1301,7 +2437,7 @@ void GogDownloader::failJob(const QString& reason)
     abortTransfers();
     // The journal stays: whatever arrived is still on disk and still correct, so
     // the next attempt resumes rather than starting over.
-    saveStateJournal(true);
+    m_journal.compact();
 
     endJob();
     emit installFailed(productId, reason);
@@ -1319,6 +2455,31 @@ void GogDownloader::endJob()
     m_resignTimer.stop();
     abortTransfers();
     disconnectContent();
+    if (m_reuse) {
+        m_reuse->cancelled = true;
+        m_reuse.reset();
+    }
+    if (m_unpack) {
+        m_unpack->control.cancel();
+        m_unpack.reset();
+    }
+    if (m_fetch) {
+        // Spans whose reply had finished are still draining; they stop at
+        // their next piece.
+        for (const std::shared_ptr<OfflineFetch::Pipe>& pipe : std::as_const(m_fetch->pipes)) {
+            QMutexLocker locker(&pipe->mutex);
+            pipe->abandoned = true;
+        }
+        if (m_fetch->directoryReply) {
+            m_fetch->directoryReply->abort();
+        }
+        m_fetch.reset();
+    }
+    if (m_job->offlineRoute) {
+        GogOfflineClient::instance().cancel();
+    }
+    m_writer.closeAll();
+    m_journal.close();
 
     delete m_job;
     m_job = nullptr;
@@ -1338,6 +2499,10 @@ void GogDownloader::abortTransfers()
     const QList<QNetworkReply*> replies = m_replies.values();
     m_replies.clear();
     m_inFlightBytes.clear();
+    m_startedAt.clear();
+    for (int index : indices) {
+        dropPipe(index);
+    }
 
     // Whatever was in flight goes back on the queue before the aborts land: a
     // partially received chunk verifies as nothing, so it has to be fetched
@@ -1352,6 +2517,29 @@ void GogDownloader::abortTransfers()
     for (QNetworkReply* reply : replies) {
         reply->abort();
     }
+
+    // The offline installer's spans the same way: a span part-written is
+    // worth nothing, since its entries verify whole, so it goes back on the
+    // queue and its pipe stops feeding.
+    if (m_fetch) {
+        const QHash<QNetworkReply*, int> spans = m_fetch->replies;
+        m_fetch->replies.clear();
+        for (auto it = spans.cbegin(); it != spans.cend(); ++it) {
+            const std::shared_ptr<OfflineFetch::Pipe> pipe = m_fetch->pipes.take(it.value());
+            if (pipe) {
+                QMutexLocker locker(&pipe->mutex);
+                pipe->abandoned = true;
+            }
+            m_fetch->startedAt.remove(it.value());
+            m_fetch->linkOf.remove(it.value());
+            // Not the span's fault: the attempt is given back.
+            --m_fetch->spans[it.value()].attempts;
+            m_fetch->queue.prepend(it.value());
+        }
+        for (auto it = spans.cbegin(); it != spans.cend(); ++it) {
+            it.key()->abort();
+        }
+    }
 }
 
 void GogDownloader::disconnectContent()
@@ -1369,83 +2557,48 @@ QString GogDownloader::journalPath() const
     return m_job->installPath + "/" + kJournalDir;
 }
 
-void GogDownloader::writePlanJournal()
-{
-    QDir().mkpath(journalPath());
-
-    QJsonArray files;
-    for (const GogInstallPlan::FileTask& task : std::as_const(m_job->plan.files)) {
-        QJsonObject object;
-        object["path"] = task.relPath;
-        object["size"] = static_cast<double>(task.size);
-        files.append(object);
-    }
-
-    QJsonObject root;
-    root["productId"] = m_job->request.productId;
-    root["buildId"]   = m_job->meta.buildId;
-    root["os"]        = m_job->os;
-    root["totalSize"] = static_cast<double>(m_job->plan.totalSize);
-    root["files"]     = files;
-
-    QSaveFile file(journalPath() + "/plan.json");
-    if (file.open(QIODevice::WriteOnly)) {
-        file.write(QJsonDocument(root).toJson(QJsonDocument::Indented));
-        file.commit();
-    }
-}
-
-void GogDownloader::loadStateJournal()
+bool GogDownloader::openJournal(QString* error)
 {
-    QFile file(journalPath() + "/state.json");
-    if (!file.open(QIODevice::ReadOnly)) {
-        return;
-    }
-
-    const QJsonObject root = QJsonDocument::fromJson(file.readAll()).object();
-    // A journal from a different build describes different bytes at different
-    // offsets. Ignoring it costs a re-download; trusting it corrupts the install.
-    if (root.value("buildId").toString() != m_job->meta.buildId) {
-        return;
-    }
-    for (const QJsonValue& value : root.value("done").toArray()) {
-        m_job->done.insert(value.toString());
-    }
-}
-
-void GogDownloader::saveStateJournal(bool force)
-{
-    if (!m_job || m_job->installPath.isEmpty()) {
-        // Nothing resolved yet, so there is no install directory to journal
-        // into — and journalPath() would name "/.protonforge-gog".
-        return;
-    }
-    const QDateTime now = QDateTime::currentDateTime();
-    if (!force && m_lastJournalWrite.isValid()
-        && m_lastJournalWrite.msecsTo(now) < kJournalWriteIntervalMs) {
-        return;
-    }
-    m_lastJournalWrite = now;
-
-    QJsonArray done;
-    for (const QString& key : std::as_const(m_job->done)) {
-        done.append(key);
+    const QString failure = m_journal.open(journalPath(), m_job->meta.buildId, m_job->plan);
+    if (!failure.isNull()) {
+        *error = failure;
+        return false;
     }
 
-    QJsonObject root;
-    root["buildId"] = m_job->meta.buildId;
-    root["done"]    = done;
-
-    QDir().mkpath(journalPath());
-    QSaveFile file(journalPath() + "/state.json");
-    if (file.open(QIODevice::WriteOnly)) {
-        file.write(QJsonDocument(root).toJson(QJsonDocument::Compact));
-        file.commit();
+    // A resume across an upgrade finds the JSON journal earlier versions kept.
+    // Read once, folded into the binary one, and then gone.
+    QFile legacy(journalPath() + "/state.json");
+    if (m_journal.doneCount() == 0 && legacy.open(QIODevice::ReadOnly)) {
+        const QJsonObject root = QJsonDocument::fromJson(legacy.readAll()).object();
+        // A journal from a different build describes different bytes at
+        // different offsets. Ignoring it costs a re-download; trusting it
+        // corrupts the install.
+        if (root.value("buildId").toString() == m_job->meta.buildId) {
+            QSet<QString> keys;
+            for (const QJsonValue& value : root.value("done").toArray()) {
+                keys.insert(value.toString());
+            }
+            for (int fileIndex = 0; fileIndex < m_job->plan.files.size(); ++fileIndex) {
+                const QList<ChunkPlacement> placements =
+                    chunkPlacements(m_job->plan.files.at(fileIndex));
+                for (int chunkIndex = 0; chunkIndex < placements.size(); ++chunkIndex) {
+                    if (keys.contains(placements.at(chunkIndex).journalKey)) {
+                        m_journal.markDone(fileIndex, chunkIndex);
+                    }
+                }
+            }
+            m_journal.compact();
+        }
     }
+    legacy.close();
+    QFile::remove(journalPath() + "/state.json");
+    QFile::remove(journalPath() + "/plan.json");
+    return true;
 }
 
 void GogDownloader::removeJournal()
 {
+    m_journal.close();
     QDir(journalPath()).removeRecursively();
 }
 
@@ -2,6 +2,8 @@
 #define GOGDOWNLOADER_H
 
 #include <QDateTime>
+#include <QElapsedTimer>
+#include <QFutureWatcher>
 #include <QHash>
 #include <QList>
 #include <QNetworkAccessManager>
@@ -12,7 +14,14 @@
 #include <QThreadPool>
 #include <QTimer>
 
+#include <memory>
+
+#include "gog/GogChunkStore.h"
+#include "gog/GogChunkStream.h"
+#include "gog/GogConcurrency.h"
 #include "gog/GogContentClient.h"
+#include "gog/GogFileWriter.h"
+#include "gog/GogInstallJournal.h"
 #include "gog/GogInstallPlan.h"
 #include "gog/GogOfflineClient.h"
 
@@ -84,6 +93,12 @@ public:
         QStringList dlcIds;
         QString installRoot;      // empty means the configured one
         int bitness = 64;
+        int maxParallel = 0;      // ceiling on chunks in flight; 0 means the configured one
+        // Install here rather than under the install root — typically a
+        // directory that already holds the game, from an offline installer or
+        // a backup, so that only what differs is downloaded. Empty means
+        // <root>/GOG/<installDirectory>.
+        QString installPath;
     };
 
     static GogDownloader& instance();
@@ -114,11 +129,11 @@ public:
 
     static QString journalDirName();
 
-    // Where each of a file's chunks lands, paired with the key the journal
-    // records it under. Offsets accumulate the *inflated* size — using the
-    // compressed one instead produces a file of the right length full of
-    // overlapping garbage, with nothing to show for it but a game that will not
-    // start.
+    // Where each of a file's chunks lands, paired with the key the JSON journal
+    // of earlier versions recorded it under, still read once on an upgrade.
+    // Offsets accumulate the *inflated* size — using the compressed one instead
+    // produces a file of the right length full of overlapping garbage, with
+    // nothing to show for it but a game that will not start.
     struct ChunkPlacement {
         QString journalKey;
         qint64 offset = 0;
@@ -130,18 +145,18 @@ public:
     // becomes a broken install, and it is worth being able to prove against a
     // handmade chunk rather than a 24 GB download.
     //
-    // Runs on a worker thread in normal use; it holds no state and opens its
-    // own handle, so chunks of the same file may be written concurrently.
+    // The whole-body form of what a download does piece by piece through
+    // GogChunkStream: with the body already in hand the compressed md5 is
+    // checked first, so a corrupt chunk never touches the file, and the
+    // inflated bytes then go out through the same fixed buffers. It holds no
+    // state and opens its own handle, so chunks of the same file may be written
+    // concurrently.
     //
     // `retriable` says whether fetching the chunk again could plausibly help:
     // true for a corrupt or undecompressable body, false for a file that cannot
     // be written. The caller needs that distinction and must not have to infer
     // it from the wording of the message.
-    struct ChunkResult {
-        QString error;         // null on success
-        bool retriable = false;
-        bool ok() const { return error.isNull(); }
-    };
+    using ChunkResult = GogChunkStream::Result;
     static ChunkResult writeChunk(const QByteArray& compressed,
                                   const QString& expectedCompressedMd5,
                                   const QString& expectedMd5,
@@ -176,8 +191,30 @@ private:
         // whose generation equals the current one means re-signing did not help.
         quint64 linkGeneration = 0;
         bool resigned = false;
+        // The chunk store's copy already failed to verify; go to the CDN.
+        bool skipStore = false;
     };
 
+    // An offline installer being unpacked on the pool: the archive, the
+    // entries still to extract and what the workers share. Defined in the .cpp.
+    struct OfflineUnpack;
+
+    // An offline installer read straight off the CDN, range by range, into
+    // the install directory: the archive's directory, the spans of entries
+    // still to fetch, and each span's bytes on their way to disk. Defined in
+    // the .cpp.
+    struct OfflineFetch;
+
+    // One pass of GogLocalReuse over what is already on disk: the scans and
+    // copies as they come back from the pool, and the flag that stops them.
+    // Defined in the .cpp.
+    struct ReusePass;
+
+    // A chunk's stream plus the pieces of body not yet fed to it. Shared with
+    // whichever pool task is draining it, because that task can outlive the
+    // reply — a pause aborts the one and not the other. Defined in the .cpp.
+    struct ChunkPipe;
+
     struct Job {
         Request request;
         QString installPath;
@@ -192,7 +229,7 @@ private:
         // build under Proton, which is what "prefer native" means.
         bool offlineRoute = false;
         GogOfflineClient::Installer offlineInstaller;
-        QString offlinePath;        // where the .sh is downloaded to
+        QString offlinePath;        // where the .sh is downloaded to, when it is
         QList<GogContentClient::DepotRef> depots;
         QHash<QString, GogContentClient::DepotManifest> manifests;
         int manifestsPending = 0;
@@ -202,6 +239,13 @@ private:
         // fresh install, which is what makes the delta logic a no-op there.
         QHash<QString, QString> installedFingerprints;
 
+        // Found on disk before Preflight created anything: plan files worth
+        // hashing chunk by chunk, and files the previous version had and this
+        // one does not, which can only ever be read from.
+        QList<int> reuseFiles;
+        QStringList reuseLeftovers;
+        qint64 reusedBytes = 0;     // inflated bytes that never needed the network
+
         // Noticed while reading the build meta, which happens before the plan
         // exists — so they are held here and folded in once it does.
         QStringList earlyWarnings;
@@ -210,10 +254,10 @@ private:
         quint64 linkGeneration = 0;
         int endpointIndex = 0;
         bool resignInFlight = false;
+        bool waitingForStore = false;   // signed, but the chunk store is still loading
 
         QList<ChunkTask> tasks;
         int nextTask = 0;
-        QSet<QString> done;            // journal keys of chunks already on disk
 
         // Chunks still outstanding per file, so "142 of 1563 files" is a count
         // rather than a guess.
@@ -246,18 +290,44 @@ private:
     // --- the native .sh route ---
     void tryOfflineInstaller();
     void onOfflineInstallers(const QList<GogOfflineClient::Installer>& installers);
+    void onOfflineTail(const QString& url, qint64 archiveSize, const QByteArray& tail);
+    void onOfflineDirectory(const std::shared_ptr<OfflineFetch>& fetch, QNetworkReply* reply);
+    void pumpOfflineFetch();
+    void startOfflineSpan(int spanIndex);
+    void onOfflineSpanData(QNetworkReply* reply);
+    void onOfflineSpanReply(QNetworkReply* reply);
+    void drainOfflineSpan(const std::shared_ptr<OfflineFetch>& fetch, int spanIndex);
+    void onOfflineSpanDrained(const std::shared_ptr<OfflineFetch>& fetch, int spanIndex);
+    void requestOfflineLink();
+    void onOfflineLink(const QString& url);
+    void downloadOfflineInstaller();
     void onOfflineDownloaded(const QString& path);
     void unpackOfflineInstaller(const QString& path);
+    void onOfflineUnpacked(const std::shared_ptr<OfflineUnpack>& unpack);
+    void finishOfflineInstall(qint64 written);
     void fallBackToWindows();
 
+    // --- what is already on disk ---
+    void findReusableFiles();
+    void reuseLocalChunks();
+    void onFilesScanned(const std::shared_ptr<ReusePass>& pass);
+    void onChunksCopied(const std::shared_ptr<ReusePass>& pass);
+    void finishReuse();
+
     // --- transfer ---
     bool preflight(QString* error);
     void requestSecureLink();
     void onSecureLink(const GogContentClient::SecureLink& link);
+    void startDownloading();
     void buildChunkQueue();
     void pump();
     void startChunk(int taskIndex);
+    void startStoredChunk(int taskIndex);
+    void onChunkData(int taskIndex, QNetworkReply* reply);
     void onChunkReply(int taskIndex, QNetworkReply* reply);
+    void schedulePipe(int taskIndex, const std::shared_ptr<ChunkPipe>& pipe);
+    void drainPipe(int taskIndex, const std::shared_ptr<ChunkPipe>& pipe, quint64 generation);
+    void dropPipe(int taskIndex);
     void onChunkVerified(int taskIndex, const ChunkResult& result);
     void retryChunk(int taskIndex, bool rotateEndpoint);
     void requeue(int taskIndex);
@@ -269,9 +339,7 @@ private:
 
     // --- journal ---
     QString journalPath() const;
-    void writePlanJournal();
-    void loadStateJournal();
-    void saveStateJournal(bool force = false);
+    bool openJournal(QString* error);
     void removeJournal();
 
     void emitProgress();
@@ -288,8 +356,35 @@ private:
 
     QHash<int, QNetworkReply*> m_replies;      // task index -> in-flight reply
     QHash<int, qint64> m_inFlightBytes;
+    QHash<int, qint64> m_startedAt;            // task index -> m_clock when requested
+
+    // How many of those there may be. Re-evaluated on the progress timer from
+    // what the last window delivered; see GogConcurrency.
+    GogConcurrency m_concurrency;
+    QElapsedTimer m_clock;
     int m_verifying = 0;
 
+    // Each in-flight chunk's stream, fed from readyRead.
+    QHash<int, std::shared_ptr<ChunkPipe>> m_pipes;
+    // What every stream writes through: one descriptor per file, not per chunk.
+    GogFileWriter m_writer;
+
+    // Which of the current job's chunks are on disk. Opened once the plan is
+    // known; see GogInstallJournal.
+    GogInstallJournal m_journal;
+
+    // Chunks kept from earlier downloads, shared by every install. Its budget
+    // is re-read from Settings → GOG as each transfer starts.
+    GogChunkStore m_chunkStore{GogChunkStore::defaultRoot()};
+    QFutureWatcher<void> m_storeLoaded;        // for a job that starts before it has
+    int m_storeReads = 0;                      // stored chunks being placed
+
+    // The scan or copy pass in progress, if any. Cancelled when the job ends.
+    std::shared_ptr<ReusePass> m_reuse;
+    // Likewise the offline installer's extraction, from a file or off the CDN.
+    std::shared_ptr<OfflineUnpack> m_unpack;
+    std::shared_ptr<OfflineFetch> m_fetch;
+
     // Verifies outlive the job that started them — the watchers are children of
     // this object, not of the job. Without a generation to check against, a
     // verify from a cancelled install would decrement the *next* install's
@@ -301,7 +396,6 @@ private:
 
     qint64 m_lastTickBytes = 0;
     QDateTime m_lastTickAt;
-    QDateTime m_lastJournalWrite;
     QHash<QString, Progress> m_lastProgress;
 };
 
@@ -0,0 +1,251 @@
+#include "GogFileWriter.h"
+
+#include <QMutexLocker>
+
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+QString errnoString(int error)
+{
+    return QString::fromLocal8Bit(std::strerror(error));
+}
+
+} // namespace
+
+GogFileWriter::Descriptor::~Descriptor()
+{
+    ::close(fd);
+}
+
+GogFileWriter::GogFileWriter(int maxOpen)
+    : m_maxOpen(qMax(1, maxOpen))
+{
+}
+
+GogFileWriter::~GogFileWriter() = default;
+
+QString GogFileWriter::preallocate(const QString& path, qint64 size)
+{
+    const int fd = ::open(path.toLocal8Bit().constData(), O_RDWR | O_CREAT | O_CLOEXEC, 0666);
+    if (fd < 0) {
+        return QStringLiteral("Could not create %1: %2").arg(path, errnoString(errno));
+    }
+    const Descriptor closer(fd);
+
+    struct stat info = {};
+    if (::fstat(fd, &info) != 0) {
+        return QStringLiteral("Could not read %1: %2").arg(path, errnoString(errno));
+    }
+    // Longer than it should be — an earlier version of the file. fallocate only
+    // ever grows, so the tail goes first.
+    if (info.st_size > size && ::ftruncate(fd, size) != 0) {
+        return QStringLiteral("Could not reserve space for %1: %2").arg(path, errnoString(errno));
+    }
+    if (size == 0) {
+        return QString();
+    }
+
+    int rc = 0;
+    do {
+        rc = ::fallocate(fd, 0, 0, size);
+    } while (rc != 0 && errno == EINTR);
+    if (rc == 0) {
+        return QString();
+    }
+
+    const int reason = errno;
+    if (reason == ENOSPC) {
+        return QStringLiteral("Not enough free space for %1.").arg(path);
+    }
+    if (reason != EOPNOTSUPP && reason != ENOSYS) {
+        return QStringLiteral("Could not reserve space for %1: %2").arg(path, errnoString(reason));
+    }
+
+    // Not posix_fallocate: where the filesystem cannot allocate ahead, glibc
+    // emulates it by writing zeros, which for a 30 GB pak file is a second
+    // download's worth of I/O before the first. A sparse file is what every
+    // install used to get, and it is still correct.
+    if (info.st_size != size && ::ftruncate(fd, size) != 0) {
+        return QStringLiteral("Could not reserve space for %1: %2").arg(path, errnoString(errno));
+    }
+    return QString();
+}
+
+qint64 GogFileWriter::allocatedBytes(const QString& path)
+{
+    struct stat info = {};
+    if (::stat(path.toLocal8Bit().constData(), &info) != 0) {
+        return 0;
+    }
+    // st_blocks is in 512-byte units whatever the filesystem's block size.
+    return static_cast<qint64>(info.st_blocks) * 512;
+}
+
+std::shared_ptr<GogFileWriter::Descriptor> GogFileWriter::acquire(const QString& path,
+                                                                   QString* error)
+{
+    QMutexLocker locker(&m_mutex);
+
+    auto it = m_entries.find(path);
+    if (it != m_entries.end()) {
+        it->lastUsed = ++m_tick;
+        return it->descriptor;
+    }
+
+    evictIfFull();
+
+    // Opened under the lock: two workers asking for the same file at once must
+    // end up sharing one descriptor, not racing to cache two.
+    const int fd = ::open(path.toLocal8Bit().constData(), O_WRONLY | O_CREAT | O_CLOEXEC, 0666);
+    if (fd < 0) {
+        if (error) {
+            *error = QStringLiteral("cannot write %1: %2").arg(path, errnoString(errno));
+        }
+        return nullptr;
+    }
+
+    Entry entry;
+    entry.descriptor = std::make_shared<Descriptor>(fd);
+    entry.lastUsed = ++m_tick;
+    m_entries.insert(path, entry);
+    return entry.descriptor;
+}
+
+void GogFileWriter::evictIfFull()
+{
+    // Called with the lock held. Least recently used goes, preferring one
+    // nobody is writing through: evicting a busy one is safe — it closes when
+    // its write ends — but it would only be reopened a moment later.
+    while (m_entries.size() >= m_maxOpen) {
+        auto victim = m_entries.end();
+        bool victimIdle = false;
+        for (auto it = m_entries.begin(); it != m_entries.end(); ++it) {
+            const bool idle = it->descriptor.use_count() == 1;
+            if (victim == m_entries.end() || (idle && !victimIdle)
+                || (idle == victimIdle && it->lastUsed < victim->lastUsed)) {
+                victim = it;
+                victimIdle = idle;
+            }
+        }
+        m_entries.erase(victim);
+    }
+}
+
+bool GogFileWriter::write(const QString& path, qint64 offset, const char* data, qint64 size,
+                          QString* error)
+{
+    const std::shared_ptr<Descriptor> descriptor = acquire(path, error);
+    if (!descriptor) {
+        return false;
+    }
+
+    // pwrite, not seek-and-write: the descriptor is shared, and a file position
+    // shared between threads is a race nobody wins.
+    while (size > 0) {
+        const ssize_t written = ::pwrite(descriptor->fd, data, static_cast<size_t>(size), offset);
+        if (written < 0 && errno == EINTR) {
+            continue;
+        }
+        if (written <= 0) {
+            if (error) {
+                *error = QStringLiteral("writing to %1 failed: %2")
+                             .arg(path, written < 0 ? errnoString(errno)
+                                                    : QStringLiteral("the disk took nothing"));
+            }
+            return false;
+        }
+        data += written;
+        offset += written;
+        size -= written;
+    }
+    return true;
+}
+
+bool GogFileWriter::copyRange(const QString& sourcePath, qint64 sourceOffset, const QString& path,
+                              qint64 offset, qint64 size, QString* error)
+{
+    const int sourceFd = ::open(sourcePath.toLocal8Bit().constData(), O_RDONLY | O_CLOEXEC);
+    if (sourceFd < 0) {
+        if (error) {
+            *error = QStringLiteral("cannot read %1: %2").arg(sourcePath, errnoString(errno));
+        }
+        return false;
+    }
+    const Descriptor source(sourceFd);
+
+    const std::shared_ptr<Descriptor> descriptor = acquire(path, error);
+    if (!descriptor) {
+        return false;
+    }
+
+    // Explicit offsets on both sides, for the same reason write() uses pwrite.
+    loff_t in = sourceOffset;
+    loff_t out = offset;
+    qint64 remaining = size;
+    while (remaining > 0) {
+        const ssize_t copied = ::copy_file_range(source.fd, &in, descriptor->fd, &out,
+                                                 static_cast<size_t>(remaining), 0);
+        if (copied < 0 && errno == EINTR) {
+            continue;
+        }
+        if (copied > 0) {
+            remaining -= copied;
+            continue;
+        }
+        if (copied == 0) {
+            if (error) {
+                *error = QStringLiteral("%1 ended before the range being copied").arg(sourcePath);
+            }
+            return false;
+        }
+        // Across filesystems before 5.3, on some FUSE mounts, or on a kernel
+        // without the call: the same bytes, the slow way.
+        if (errno != EXDEV && errno != ENOSYS && errno != EOPNOTSUPP && errno != EINVAL) {
+            if (error) {
+                *error = QStringLiteral("copying into %1 failed: %2").arg(path, errnoString(errno));
+            }
+            return false;
+        }
+        break;
+    }
+
+    QByteArray buffer;
+    while (remaining > 0) {
+        buffer.resize(static_cast<int>(qMin<qint64>(remaining, 1024 * 1024)));
+        const ssize_t got = ::pread(source.fd, buffer.data(), buffer.size(), in);
+        if (got < 0 && errno == EINTR) {
+            continue;
+        }
+        if (got <= 0) {
+            if (error) {
+                *error = got < 0 ? QStringLiteral("cannot read %1: %2").arg(sourcePath, errnoString(errno))
+                                 : QStringLiteral("%1 ended before the range being copied").arg(sourcePath);
+            }
+            return false;
+        }
+        if (!write(path, out, buffer.constData(), got, error)) {
+            return false;
+        }
+        in += got;
+        out += got;
+        remaining -= got;
+    }
+    return true;
+}
+
+void GogFileWriter::closeAll()
+{
+    QMutexLocker locker(&m_mutex);
+    m_entries.clear();
+}
+
+int GogFileWriter::openCount() const
+{
+    QMutexLocker locker(&m_mutex);
+    return static_cast<int>(m_entries.size());
+}
@@ -0,0 +1,95 @@
+#ifndef GOGFILEWRITER_H
+#define GOGFILEWRITER_H
+
+#include <QHash>
+#include <QMutex>
+#include <QString>
+
+#include <memory>
+
+// Where chunk bytes meet the disk.
+//
+// Opening a file, seeking and closing it again for every 10 MB chunk is cheap
+// once and not cheap a hundred thousand times, and a file that grows one chunk
+// at a time in whatever order the CDN answers ends up in pieces all over an
+// ext4 or btrfs volume. So:
+//
+//   preallocate() reserves each file at its final size before the first byte
+//   arrives — real blocks, not a sparse hole — so the filesystem can lay it out
+//   in one piece, and so running out of space is discovered in Preflight rather
+//   than eight gigabytes in.
+//
+//   write() is pwrite() on a descriptor from a small shared cache, so chunks of
+//   the same file from different pool threads reuse one open file and never
+//   fight over a seek position. The cache is bounded — a manifest can list tens
+//   of thousands of files — and evicts the least recently used descriptor,
+//   preferring one nobody is writing through at that moment.
+//
+// Thread-safe. The mutex only guards the cache; the writes themselves run
+// unlocked and in parallel.
+class GogFileWriter
+{
+public:
+    static constexpr int kDefaultMaxOpen = 32;
+
+    explicit GogFileWriter(int maxOpen = kDefaultMaxOpen);
+    ~GogFileWriter();
+    GogFileWriter(const GogFileWriter&) = delete;
+    GogFileWriter& operator=(const GogFileWriter&) = delete;
+
+    // Creates `path` if it is missing and makes it exactly `size` bytes, with
+    // the space allocated. Falls back to a sparse file on filesystems that
+    // cannot allocate ahead (some FUSE and network mounts), which is what
+    // every install got before. Returns a null QString on success.
+    static QString preallocate(const QString& path, qint64 size);
+
+    // Bytes the filesystem has actually allocated to `path` — zero for a hole,
+    // zero for a file that does not exist. What a resumed install still needs
+    // is the difference between this and the file's size.
+    static qint64 allocatedBytes(const QString& path);
+
+    // All of `size` bytes at `offset`, or false with `error` naming the file.
+    // Creates the file if it does not exist, as QFile::ReadWrite always did.
+    bool write(const QString& path, qint64 offset, const char* data, qint64 size,
+               QString* error);
+
+    // `size` bytes from `sourcePath` at `sourceOffset` into `path` at `offset`,
+    // through copy_file_range — which the kernel turns into a reflink on btrfs
+    // and XFS, and an in-kernel copy elsewhere — falling back to read and write
+    // where it is not supported. The ranges must not overlap.
+    bool copyRange(const QString& sourcePath, qint64 sourceOffset, const QString& path,
+                   qint64 offset, qint64 size, QString* error);
+
+    // Drop the cache. Descriptors mid-write close as their writes finish.
+    // Called when a job ends, so a finished install holds nothing open.
+    void closeAll();
+
+    int openCount() const;
+
+private:
+    // Closes on destruction. Shared between the cache and whoever is writing
+    // through it, so evicting a descriptor that is mid-pwrite only drops the
+    // cache's claim — it closes when the write finishes, never under it.
+    struct Descriptor {
+        explicit Descriptor(int descriptor) : fd(descriptor) {}
+        ~Descriptor();
+        Descriptor(const Descriptor&) = delete;
+        Descriptor& operator=(const Descriptor&) = delete;
+        const int fd;
+    };
+
+    struct Entry {
+        std::shared_ptr<Descriptor> descriptor;
+        quint64 lastUsed = 0;
+    };
+
+    std::shared_ptr<Descriptor> acquire(const QString& path, QString* error);
+    void evictIfFull();
+
+    const int m_maxOpen;
+    mutable QMutex m_mutex;
+    QHash<QString, Entry> m_entries;
+    quint64 m_tick = 0;
+};
+
+#endif // GOGFILEWRITER_H
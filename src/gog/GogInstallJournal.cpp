@@ -0,0 +1,324 @@
+#include "GogInstallJournal.h"
+
+#include <QCryptographicHash>
+#include <QDataStream>
+#include <QDir>
+#include <QFile>
+#include <QSaveFile>
+#include <QtEndian>
+
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace {
+
+constexpr char kDoneMagic[4] = {'P', 'F', 'G', 'D'};
+constexpr char kPlanMagic[4] = {'P', 'F', 'G', 'P'};
+
+// Magic, version, chunk count, reserved, then the 16-byte plan digest.
+constexpr int kHeaderSize = 32;
+// The ordinal, then its complement — a record that is not both is not one.
+constexpr int kRecordSize = 8;
+// The log is folded into the bitmap once it is larger than this or than the
+// bitmap, whichever is more: small enough that a resume never reads much, and
+// large enough that a small game is not rewriting its bitmap every chunk.
+constexpr qint64 kMinLogBytes = 64 * 1024;
+// Gathered records are appended once there are this many, if no flush() came
+// first: half a kilobyte, a few hundred megabytes of chunks.
+constexpr int kRecordsPerWrite = 64;
+
+void putU32(char* at, quint32 value)
+{
+    qToLittleEndian<quint32>(value, at);
+}
+
+quint32 getU32(const char* at)
+{
+    return qFromLittleEndian<quint32>(at);
+}
+
+QByteArray header(const char (&magic)[4], quint32 count, const QByteArray& digest)
+{
+    QByteArray bytes(kHeaderSize, '\0');
+    memcpy(bytes.data(), magic, 4);
+    putU32(bytes.data() + 4, GogInstallJournal::kVersion);
+    putU32(bytes.data() + 8, count);
+    memcpy(bytes.data() + 16, digest.constData(), qMin<qsizetype>(digest.size(), 16));
+    return bytes;
+}
+
+} // namespace
+
+GogInstallJournal::~GogInstallJournal()
+{
+    close();
+}
+
+QString GogInstallJournal::planFileName()
+{
+    return QStringLiteral("plan.bin");
+}
+
+QString GogInstallJournal::doneFileName()
+{
+    return QStringLiteral("done.bin");
+}
+
+QByteArray GogInstallJournal::planDigest(const QString& buildId, const GogInstallPlan::Plan& plan)
+{
+    QCryptographicHash hash(QCryptographicHash::Md5);
+    hash.addData(buildId.toUtf8());
+    for (const GogInstallPlan::FileTask& file : plan.files) {
+        hash.addData(QByteArrayLiteral("\n"));
+        hash.addData(file.relPath.toUtf8());
+        hash.addData(QByteArray::number(file.chunks.size()));
+        // The same paths and counts can hide different bytes: a build id that
+        // was republished, or a depot whose chunking changed.
+        for (const GogContentClient::Chunk& chunk : file.chunks) {
+            hash.addData(QByteArrayLiteral(" "));
+            hash.addData(chunk.md5.toLower().toLatin1());
+            hash.addData(QByteArray::number(chunk.size));
+        }
+    }
+    return hash.result();
+}
+
+QString GogInstallJournal::open(const QString& directory, const QString& buildId,
+                                const GogInstallPlan::Plan& plan)
+{
+    close();
+
+    if (!QDir().mkpath(directory)) {
+        return QStringLiteral("Could not create %1.").arg(directory);
+    }
+    m_directory = directory;
+    m_digest = planDigest(buildId, plan);
+
+    m_firstChunk.clear();
+    m_firstChunk.reserve(plan.files.size());
+    int total = 0;
+    for (const GogInstallPlan::FileTask& file : plan.files) {
+        m_firstChunk << total;
+        total += static_cast<int>(file.chunks.size());
+    }
+    m_firstChunk << total;   // one past the end, so every file has a bound
+    m_done = QBitArray(total);
+    m_doneCount = 0;
+    m_records = 0;
+    m_compactFailed = false;
+
+    // Once per plan. A resume of the same plan finds it already there.
+    const QByteArray planHeader = header(kPlanMagic, static_cast<quint32>(total), m_digest);
+    QFile existing(m_directory + "/" + planFileName());
+    if (!existing.open(QIODevice::ReadOnly) || existing.read(kHeaderSize) != planHeader) {
+        existing.close();
+        QSaveFile out(m_directory + "/" + planFileName());
+        if (!out.open(QIODevice::WriteOnly)) {
+            return QStringLiteral("Could not write the install journal in %1.").arg(directory);
+        }
+        out.write(planHeader);
+        QDataStream stream(&out);
+        stream << buildId << static_cast<quint32>(plan.files.size());
+        for (const GogInstallPlan::FileTask& file : plan.files) {
+            stream << file.relPath << file.size << static_cast<quint32>(file.chunks.size());
+        }
+        if (!out.commit()) {
+            return QStringLiteral("Could not write the install journal in %1.").arg(directory);
+        }
+    }
+
+    if (!load() && !writeSnapshot()) {
+        return QStringLiteral("Could not write the install journal in %1.").arg(directory);
+    }
+    if (!openForAppend()) {
+        return QStringLiteral("Could not write the install journal in %1.").arg(directory);
+    }
+    return QString();
+}
+
+void GogInstallJournal::close()
+{
+    flush();
+    closeDescriptor();
+    m_directory.clear();
+    m_firstChunk.clear();
+    m_done.clear();
+    m_doneCount = 0;
+    m_records = 0;
+}
+
+void GogInstallJournal::closeDescriptor()
+{
+    if (m_fd >= 0) {
+        ::close(m_fd);
+        m_fd = -1;
+    }
+}
+
+int GogInstallJournal::ordinal(int fileIndex, int chunkIndex) const
+{
+    if (fileIndex < 0 || fileIndex + 1 >= m_firstChunk.size() || chunkIndex < 0) {
+        return -1;
+    }
+    const int at = m_firstChunk.at(fileIndex) + chunkIndex;
+    return at < m_firstChunk.at(fileIndex + 1) ? at : -1;
+}
+
+bool GogInstallJournal::isDone(int fileIndex, int chunkIndex) const
+{
+    const int at = ordinal(fileIndex, chunkIndex);
+    return at >= 0 && m_done.testBit(at);
+}
+
+void GogInstallJournal::markDone(int fileIndex, int chunkIndex)
+{
+    const int at = ordinal(fileIndex, chunkIndex);
+    if (at < 0 || m_done.testBit(at)) {
+        return;
+    }
+    m_done.setBit(at);
+    ++m_doneCount;
+
+    if (m_fd < 0) {
+        return;   // not journalled; the chunk is fetched again on resume
+    }
+    char record[kRecordSize];
+    putU32(record, static_cast<quint32>(at));
+    putU32(record + 4, ~static_cast<quint32>(at));
+    m_unflushed.append(record, kRecordSize);
+    ++m_records;
+
+    // After a compaction that failed, not again before the next flush: each
+    // try rewrites the whole bitmap, and the disk that refused it once will
+    // most likely refuse it for the next record too.
+    const qint64 bitmapBytes = (m_done.size() + 7) / 8;
+    if (!m_compactFailed && qint64(m_records) * kRecordSize > qMax(bitmapBytes, kMinLogBytes)) {
+        compact();
+    }
+    if (m_unflushed.size() >= kRecordsPerWrite * kRecordSize) {
+        flush();
+    }
+}
+
+void GogInstallJournal::flush()
+{
+    m_compactFailed = false;
+    if (m_fd < 0 || m_unflushed.isEmpty()) {
+        return;
+    }
+    const char* data = m_unflushed.constData();
+    qint64 remaining = m_unflushed.size();
+    while (remaining > 0) {
+        const ssize_t written = ::write(m_fd, data, static_cast<size_t>(remaining));
+        if (written < 0 && errno == EINTR) {
+            continue;
+        }
+        if (written <= 0) {
+            // What did get out may end mid-record; open() drops that.
+            qWarning("GogInstallJournal: could not record progress in %s",
+                     qPrintable(m_directory));
+            break;
+        }
+        data += written;
+        remaining -= written;
+    }
+    m_unflushed.clear();
+}
+
+void GogInstallJournal::compact()
+{
+    if (m_directory.isEmpty() || m_records == 0) {
+        return;
+    }
+    // The append descriptor names the old file, which the snapshot replaces.
+    if (!writeSnapshot()) {
+        m_compactFailed = true;   // the records stay, and are appended as usual
+        return;
+    }
+    closeDescriptor();
+    if (!openForAppend()) {
+        // The snapshot has everything so far; what is done from here on is
+        // fetched again on resume.
+        qWarning("GogInstallJournal: could not reopen %s to record progress",
+                 qPrintable(m_directory));
+    }
+}
+
+bool GogInstallJournal::load()
+{
+    QFile file(m_directory + "/" + doneFileName());
+    if (!file.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+    const QByteArray bytes = file.readAll();
+    file.close();
+
+    const int total = static_cast<int>(m_done.size());
+    const qint64 bitmapBytes = (total + 7) / 8;
+    if (bytes.size() < kHeaderSize + bitmapBytes
+        || bytes.left(kHeaderSize) != header(kDoneMagic, static_cast<quint32>(total), m_digest)) {
+        return false;
+    }
+
+    const char* bitmap = bytes.constData() + kHeaderSize;
+    for (int at = 0; at < total; ++at) {
+        if (bitmap[at / 8] & (1 << (at % 8))) {
+            m_done.setBit(at);
+            ++m_doneCount;
+        }
+    }
+
+    qint64 pos = kHeaderSize + bitmapBytes;
+    while (pos + kRecordSize <= bytes.size()) {
+        const quint32 at = getU32(bytes.constData() + pos);
+        if (getU32(bytes.constData() + pos + 4) != ~at || at >= static_cast<quint32>(total)) {
+            break;
+        }
+        if (!m_done.testBit(static_cast<int>(at))) {
+            m_done.setBit(static_cast<int>(at));
+            ++m_doneCount;
+        }
+        ++m_records;
+        pos += kRecordSize;
+    }
+
+    // A record torn by a crash, or whatever followed it: dropped, so the next
+    // append lands on a record boundary rather than after the debris.
+    if (pos != bytes.size() && !QFile::resize(file.fileName(), pos)) {
+        return false;
+    }
+    return true;
+}
+
+bool GogInstallJournal::writeSnapshot()
+{
+    const int total = static_cast<int>(m_done.size());
+    QByteArray bitmap((total + 7) / 8, '\0');
+    for (int at = 0; at < total; ++at) {
+        if (m_done.testBit(at)) {
+            bitmap[at / 8] = static_cast<char>(bitmap.at(at / 8) | (1 << (at % 8)));
+        }
+    }
+
+    QSaveFile out(m_directory + "/" + doneFileName());
+    if (!out.open(QIODevice::WriteOnly)) {
+        return false;
+    }
+    out.write(header(kDoneMagic, static_cast<quint32>(total), m_digest));
+    out.write(bitmap);
+    if (!out.commit()) {
+        return false;
+    }
+    m_records = 0;
+    m_unflushed.clear();   // in the bitmap now
+    return true;
+}
+
+bool GogInstallJournal::openForAppend()
+{
+    const QString path = m_directory + "/" + doneFileName();
+    m_fd = ::open(path.toLocal8Bit().constData(), O_WRONLY | O_APPEND | O_CLOEXEC);
+    return m_fd >= 0;
+}
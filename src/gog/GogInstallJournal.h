@@ -0,0 +1,107 @@
+#ifndef GOGINSTALLJOURNAL_H
+#define GOGINSTALLJOURNAL_H
+
+#include <QBitArray>
+#include <QByteArray>
+#include <QList>
+#include <QString>
+
+#include "gog/GogInstallPlan.h"
+
+// What makes an interrupted install resumable: which chunks are already on
+// disk, kept inside the install directory so that deleting the folder is
+// complete cleanup.
+//
+// It used to be two JSON documents, the plan dumped once and the whole `done`
+// set rewritten every two seconds. For a 150,000-chunk game that is megabytes
+// of JSON rewritten continuously and parsed again on resume, to record ten
+// megabytes of progress at a time. So instead:
+//
+//   plan.bin is written once per plan — build, paths, sizes, chunk counts —
+//   and left alone while the plan stays the same.
+//
+//   done.bin is a header, a bitmap of finished chunks, then fixed-size append
+//   records, one per chunk finished since the bitmap was written. Records are
+//   gathered and appended a batch at a time, by flush(): every so many chunks,
+//   and whenever the downloader's progress tick calls it, so a fast local copy
+//   is not one write() per chunk on the GUI thread. Once the records outgrow
+//   the bitmap they are folded into it, atomically through QSaveFile
+//   (compact()).
+//
+// Both carry a digest of the plan: the build, and every file's path and every
+// chunk's md5 and size, in order. A journal from another build, from the same
+// build with other languages, or from a manifest that was republished under the
+// same build id describes other chunks, and trusting it corrupts the install —
+// so it is ignored, which costs a re-download at worst.
+//
+// Crash safety is the append's: a record is gathered only once its chunk is on
+// disk, a torn record at the tail is dropped on open, and each record carries
+// its own check, so garbage past a crash is never read as progress. A crash
+// loses the batch not yet flushed, and those chunks are fetched again.
+//
+// Not thread-safe; the downloader uses it from the GUI thread only.
+class GogInstallJournal
+{
+public:
+    static constexpr quint32 kVersion = 1;
+
+    GogInstallJournal() = default;
+    ~GogInstallJournal();
+    GogInstallJournal(const GogInstallJournal&) = delete;
+    GogInstallJournal& operator=(const GogInstallJournal&) = delete;
+
+    // Opens the journal in `directory` for `plan`, creating the directory, and
+    // writing plan.bin unless it already describes this plan. What an earlier
+    // run of the same plan finished is then available from isDone(). Returns
+    // a null QString on success, an error otherwise.
+    QString open(const QString& directory, const QString& buildId,
+                 const GogInstallPlan::Plan& plan);
+    // Nothing is lost by closing: every record is already written. Forgets
+    // the plan, so isDone() is false for everything until the next open().
+    void close();
+    bool isOpen() const { return m_fd >= 0; }
+
+    bool isDone(int fileIndex, int chunkIndex) const;
+    int doneCount() const { return m_doneCount; }
+
+    // Records a chunk that is on disk. Already recorded is a no-op. Reaches
+    // the disk with the next flush().
+    void markDone(int fileIndex, int chunkIndex);
+
+    // Appends the records gathered since the last flush, in one write. close()
+    // and compact() do this too.
+    void flush();
+
+    // Folds the records into the bitmap now. Called when the transfer stops,
+    // so the next resume reads one bitmap and nothing else.
+    void compact();
+
+    // Records made since the bitmap was last written, flushed or not.
+    int pendingRecords() const { return m_records; }
+
+    // Same build, same files, same chunks in the same order: the same chunk
+    // ordinals naming the same bytes. Anything else gets a different digest.
+    static QByteArray planDigest(const QString& buildId, const GogInstallPlan::Plan& plan);
+
+    static QString planFileName();
+    static QString doneFileName();
+
+private:
+    int ordinal(int fileIndex, int chunkIndex) const;
+    bool load();
+    bool writeSnapshot();
+    bool openForAppend();
+    void closeDescriptor();
+
+    QString m_directory;
+    QByteArray m_digest;
+    QList<int> m_firstChunk;     // per file, its first chunk's ordinal
+    QBitArray m_done;
+    int m_doneCount = 0;
+    int m_records = 0;
+    QByteArray m_unflushed;      // whole records, not yet appended
+    bool m_compactFailed = false; // until the next flush()
+    int m_fd = -1;
+};
+
+#endif // GOGINSTALLJOURNAL_H
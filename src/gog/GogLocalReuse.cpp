@@ -0,0 +1,180 @@
+#include "GogLocalReuse.h"
+
+#include "gog/GogFileWriter.h"
+
+#include <QCryptographicHash>
+#include <QFile>
+
+namespace GogLocalReuse {
+
+namespace {
+
+constexpr qint64 kReadPiece = 1024 * 1024;
+
+bool isCancelled(const std::atomic<bool>* cancelled)
+{
+    return cancelled && cancelled->load(std::memory_order_relaxed);
+}
+
+// The md5 of `size` bytes at `offset`, or a null QString if they could not all
+// be read. A megabyte at a time, so a 100 MB chunk costs the buffer and not
+// the chunk.
+QString md5Range(QFile& file, qint64 offset, qint64 size, QByteArray& buffer)
+{
+    if (!file.seek(offset)) {
+        return QString();
+    }
+    QCryptographicHash hash(QCryptographicHash::Md5);
+    qint64 remaining = size;
+    while (remaining > 0) {
+        buffer.resize(static_cast<int>(qMin(remaining, kReadPiece)));
+        const qint64 got = file.read(buffer.data(), buffer.size());
+        if (got <= 0) {
+            return QString();
+        }
+        hash.addData(QByteArrayView(buffer.constData(), got));
+        remaining -= got;
+    }
+    return QString::fromLatin1(hash.result().toHex());
+}
+
+} // namespace
+
+FileScan scanFile(const GogInstallPlan::FileTask& file, int fileIndex, const QString& path,
+                  const std::atomic<bool>* cancelled)
+{
+    FileScan scan;
+    scan.fileIndex = fileIndex;
+
+    QFile in(path);
+    if (!file.linkTarget.isEmpty() || !in.open(QIODevice::ReadOnly)) {
+        return scan;
+    }
+    const qint64 fileSize = in.size();
+
+    QByteArray buffer;
+    qint64 offset = 0;
+    for (int chunkIndex = 0; chunkIndex < file.chunks.size(); ++chunkIndex) {
+        if (isCancelled(cancelled)) {
+            break;
+        }
+        const GogContentClient::Chunk& chunk = file.chunks.at(chunkIndex);
+        if (!chunk.md5.isEmpty() && chunk.size > 0 && offset + chunk.size <= fileSize
+            && md5Range(in, offset, chunk.size, buffer) == chunk.md5) {
+            scan.inPlace << chunkIndex;
+            scan.sources.insert(chunk.md5, Source{path, offset, chunk.size});
+        }
+        offset += chunk.size;
+    }
+    return scan;
+}
+
+FileScan scanLeftover(const QString& path, qint64 blockSize, const std::atomic<bool>* cancelled)
+{
+    FileScan scan;
+
+    QFile in(path);
+    if (blockSize <= 0 || !in.open(QIODevice::ReadOnly)) {
+        return scan;
+    }
+    const qint64 fileSize = in.size();
+
+    QByteArray buffer;
+    // The last block is whatever is left, which is where a file's short final
+    // chunk sits.
+    for (qint64 offset = 0; offset < fileSize; offset += blockSize) {
+        if (isCancelled(cancelled)) {
+            break;
+        }
+        const qint64 size = qMin(blockSize, fileSize - offset);
+        const QString md5 = md5Range(in, offset, size, buffer);
+        if (!md5.isNull() && !scan.sources.contains(md5)) {
+            scan.sources.insert(md5, Source{path, offset, size});
+        }
+    }
+    return scan;
+}
+
+qint64 typicalChunkSize(const GogInstallPlan::Plan& plan)
+{
+    QHash<qint64, int> counts;
+    qint64 typical = 0;
+    int best = 0;
+    for (const GogInstallPlan::FileTask& file : plan.files) {
+        for (const GogContentClient::Chunk& chunk : file.chunks) {
+            const int count = ++counts[chunk.size];
+            if (count > best) {
+                best = count;
+                typical = chunk.size;
+            }
+        }
+    }
+    return typical;
+}
+
+QList<Copy> planCopies(const GogInstallPlan::Plan& plan, const QList<int>& fileIndices,
+                       const QList<FileScan>& scans, const QHash<int, QSet<int>>& done)
+{
+    QHash<QString, Source> sources;
+    QHash<int, QSet<int>> inPlace;
+    for (const FileScan& scan : scans) {
+        for (auto it = scan.sources.constBegin(); it != scan.sources.constEnd(); ++it) {
+            if (!sources.contains(it.key())) {
+                sources.insert(it.key(), it.value());
+            }
+        }
+        if (scan.fileIndex >= 0) {
+            QSet<int>& chunks = inPlace[scan.fileIndex];
+            for (int chunkIndex : scan.inPlace) {
+                chunks.insert(chunkIndex);
+            }
+        }
+    }
+
+    QList<Copy> copies;
+    for (int fileIndex : fileIndices) {
+        const GogInstallPlan::FileTask& file = plan.files.at(fileIndex);
+        const QSet<int> finished = done.value(fileIndex);
+        const QSet<int> present = inPlace.value(fileIndex);
+
+        qint64 offset = 0;
+        for (int chunkIndex = 0; chunkIndex < file.chunks.size(); ++chunkIndex) {
+            const GogContentClient::Chunk& chunk = file.chunks.at(chunkIndex);
+            const qint64 at = offset;
+            offset += chunk.size;
+            if (finished.contains(chunkIndex) || present.contains(chunkIndex)) {
+                continue;
+            }
+            const auto source = sources.constFind(chunk.md5);
+            // The size as well as the md5: a leftover's last block is short,
+            // and a chunk that only hashes the same is not one to trust.
+            if (source == sources.constEnd() || source->size != chunk.size) {
+                continue;
+            }
+            copies << Copy{fileIndex, chunkIndex, at, chunk.size, *source};
+        }
+    }
+    return copies;
+}
+
+QList<Copy> copyChunks(const QList<Copy>& copies, const QString& destinationPath,
+                       GogFileWriter& writer, const std::atomic<bool>* cancelled)
+{
+    QList<Copy> landed;
+    for (const Copy& copy : copies) {
+        if (isCancelled(cancelled)) {
+            break;
+        }
+        QString error;
+        if (writer.copyRange(copy.source.path, copy.source.offset, destinationPath, copy.offset,
+                             copy.size, &error)) {
+            landed << copy;
+        } else {
+            qWarning("GogLocalReuse: %s; leaving the chunk for the download",
+                     qPrintable(error));
+        }
+    }
+    return landed;
+}
+
+} // namespace GogLocalReuse
@@ -0,0 +1,92 @@
+#ifndef GOGLOCALREUSE_H
+#define GOGLOCALREUSE_H
+
+#include <QHash>
+#include <QList>
+#include <QSet>
+#include <QString>
+
+#include <atomic>
+
+#include "gog/GogInstallPlan.h"
+
+class GogFileWriter;
+
+// Finding the parts of a build that are already on disk, chunk by chunk.
+//
+// diffAgainstFingerprints decides per file, and a 30 GB pak whose manifest
+// changed in one chunk is a changed file — so without this an update fetches
+// all 30 GB for one megabyte of difference. Likewise an install pointed at a
+// directory that already holds the game, from an offline installer or a
+// backup, has no fingerprints at all and would fetch everything.
+//
+// Every chunk names the md5 of its inflated bytes, which is exactly what sits
+// on disk. So:
+//
+//   scanFile() hashes an existing file at each of its new chunks' ranges. A
+//   range that already hashes right is already in place, and is done.
+//
+//   scanLeftover() hashes a file the new build no longer has — the old name of
+//   a renamed file, typically — in fixed blocks, as a source and nothing else.
+//
+//   planCopies() finds, for every chunk still missing, an identical range
+//   elsewhere on disk, and copyChunks() puts it in place with copy_file_range
+//   (a reflink where the filesystem can). Only the rest is downloaded.
+//
+// A copy's source is only ever a range that will not be written again: one
+// that scanned as already in place, or a leftover file, which nothing in the
+// new build touches until finalize deletes it. That is what makes copying
+// within a file that is itself being updated safe — no destination can be
+// anyone's source — without having to order the copies.
+//
+// Runs off the GUI thread; each function takes the whole file's I/O, so the
+// caller parallelises across files. `cancelled`, when given, is checked
+// between chunks.
+namespace GogLocalReuse {
+
+struct Source {
+    QString path;
+    qint64 offset = 0;
+    qint64 size = 0;
+};
+
+struct FileScan {
+    int fileIndex = -1;             // into the plan; -1 for a leftover
+    QList<int> inPlace;             // chunk indices already correct on disk
+    QHash<QString, Source> sources; // inflated md5 -> a range that holds it
+};
+
+struct Copy {
+    int fileIndex = 0;
+    int chunkIndex = 0;
+    qint64 offset = 0;              // in the destination file
+    qint64 size = 0;
+    Source source;
+};
+
+// Ranges past the file's current end cannot match and are not read.
+FileScan scanFile(const GogInstallPlan::FileTask& file, int fileIndex, const QString& path,
+                  const std::atomic<bool>* cancelled = nullptr);
+
+// Hashed in blocks of `blockSize`, the build's chunk size: a renamed file's
+// content sits at exactly the boundaries its new chunks start on.
+FileScan scanLeftover(const QString& path, qint64 blockSize,
+                      const std::atomic<bool>* cancelled = nullptr);
+
+// The build's usual inflated chunk size — the most common one in the plan.
+qint64 typicalChunkSize(const GogInstallPlan::Plan& plan);
+
+// Every chunk of `fileIndices` that is neither already done (`done` maps a
+// file index to its finished chunk indices) nor in place, and whose md5 some
+// scan found a source for.
+QList<Copy> planCopies(const GogInstallPlan::Plan& plan, const QList<int>& fileIndices,
+                       const QList<FileScan>& scans, const QHash<int, QSet<int>>& done);
+
+// Performs `copies`, all into the same file. Returns the ones that landed; a
+// failed copy is simply left for the download.
+QList<Copy> copyChunks(const QList<Copy>& copies, const QString& destinationPath,
+                       GogFileWriter& writer, const std::atomic<bool>* cancelled = nullptr);
+
+} // namespace GogLocalReuse
+
+#endif // GOGLOCALREUSE_H
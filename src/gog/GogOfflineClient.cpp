@@ -1,19 +1,43 @@
 #include "GogOfflineClient.h"
 #include "gog/GogAuth.h"
+#include "gog/GogInstallJournal.h"
 #include "gog/GogRequest.h"
 
+#include <QCryptographicHash>
 #include <QDir>
+#include <QElapsedTimer>
 #include <QFile>
 #include <QFileInfo>
+#include <QFutureWatcher>
 #include <QJsonArray>
 #include <QJsonDocument>
 #include <QJsonObject>
 #include <QNetworkReply>
 #include <QRegularExpression>
+#include <QXmlStreamReader>
+#include <QtConcurrent>
+
+#include <atomic>
+#include <utility>
 
 namespace {
 
 const QString kEmbed = QStringLiteral("https://embed.gog.com");
+const QString kApi = QStringLiteral("https://api.gog.com");
+
+// Connections at once. Past four the CDN gains little per connection, and a
+// household link gains nothing at all.
+constexpr int kConnections = 4;
+// The unit of progress the journal records, and of a retry.
+constexpr qint64 kSegmentBytes = 8 * 1024 * 1024;
+// How far ahead of the md5 the fetch may run. Bytes that arrive ahead of it are
+// held until it catches up, so this is what bounds the memory a slow segment
+// at the front can cost: 64 MiB at most.
+constexpr int kSegmentWindow = 8;
+constexpr int kMaxAttemptsPerSegment = 3;
+// A segment an earlier run finished is hashed back from disk in pieces this
+// large — the one read-back there is, only on resume, and off the GUI thread.
+constexpr qint64 kRehashPiece = 4 * 1024 * 1024;
 
 QString normalizeOs(const QString& raw)
 {
@@ -26,6 +50,46 @@ QString normalizeOs(const QString& raw)
 
 } // namespace
 
+struct GogOfflineClient::Segmented {
+    struct Segment {
+        qint64 begin = 0;
+        qint64 end = 0;
+        qint64 received = 0;       // from `begin`, on disk
+        bool done = false;
+        bool fromEarlierRun = false;
+        int attempts = 0;
+        QNetworkReply* reply = nullptr;
+        QByteArray held;           // arrived before the md5 reached this segment
+    };
+
+    quint64 run = 0;
+    QString url;
+    qint64 total = 0;
+    QFile file;
+    GogInstallJournal journal;
+    QList<Segment> segments;
+    int active = 0;
+
+    QCryptographicHash md5{QCryptographicHash::Md5};
+    int hashNext = 0;              // the first segment not yet wholly hashed
+    QString expectedMd5;
+    bool checksumPending = true;
+
+    QElapsedTimer progressClock;
+
+    // Hashes back what an earlier run fetched. While it runs, the md5 is the
+    // worker's: the segment at hashNext is one of those, so nothing arriving
+    // touches it.
+    QFutureWatcher<bool> rehash;
+    std::atomic_bool cancelled{false};
+
+    ~Segmented()
+    {
+        cancelled = true;
+        rehash.waitForFinished();
+    }
+};
+
 GogOfflineClient& GogOfflineClient::instance()
 {
     static GogOfflineClient client;
@@ -43,6 +107,8 @@ GogOfflineClient::GogOfflineClient()
     m_networkManager->setTransferTimeout(120 * 1000);
 }
 
+GogOfflineClient::~GogOfflineClient() = default;
+
 // --- parsing -----------------------------------------------------------------
 
 qint64 GogOfflineClient::parseSize(const QString& text)
@@ -160,6 +226,93 @@ QString GogOfflineClient::downloadUrl(const QString& manualUrl)
     return kEmbed + (manualUrl.startsWith('/') ? manualUrl : "/" + manualUrl);
 }
 
+bool GogOfflineClient::parseContentRange(const QByteArray& header, qint64* first, qint64* last,
+                                         qint64* total)
+{
+    static const QRegularExpression pattern(
+        QStringLiteral("^\\s*bytes\\s+([0-9]+)-([0-9]+)/([0-9]+|\\*)\\s*$"),
+        QRegularExpression::CaseInsensitiveOption);
+
+    const QRegularExpressionMatch match = pattern.match(QString::fromLatin1(header));
+    if (!match.hasMatch()) {
+        return false;
+    }
+    bool firstOk = false;
+    bool lastOk = false;
+    const qint64 from = match.captured(1).toLongLong(&firstOk);
+    const qint64 to = match.captured(2).toLongLong(&lastOk);
+    if (!firstOk || !lastOk || to < from) {
+        return false;
+    }
+    bool totalOk = true;
+    const qint64 size = match.captured(3) == QLatin1String("*")
+                            ? -1 : match.captured(3).toLongLong(&totalOk);
+    if (!totalOk || (size >= 0 && to >= size)) {
+        return false;
+    }
+    *first = from;
+    *last = to;
+    *total = size;
+    return true;
+}
+
+QNetworkRequest GogOfflineClient::rangeRequest(const QString& url, qint64 offset, qint64 size)
+{
+    QNetworkRequest request = GogRequest::make(QUrl(url));
+    request.setRawHeader("Range", "bytes=" + QByteArray::number(offset) + "-"
+                                      + QByteArray::number(offset + size - 1));
+    return request;
+}
+
+QString GogOfflineClient::downlinkUrl(const QString& productId, const QString& manualUrl)
+{
+    // "/downloads/<slug>/en1installer0": the last part is the installer's id in
+    // the products API, which is where its checksum is published.
+    const QString id = manualUrl.section('/', -1);
+    if (productId.isEmpty() || id.isEmpty() || id.contains('?')) {
+        return QString();
+    }
+    return QStringLiteral("%1/products/%2/downlink/installer/%3").arg(kApi, productId, id);
+}
+
+QString GogOfflineClient::parseChecksumXml(const QByteArray& xml)
+{
+    static const QRegularExpression hex(QStringLiteral("^[0-9a-fA-F]{32}$"));
+
+    QXmlStreamReader reader(xml);
+    while (reader.readNextStartElement()) {
+        if (reader.name() != QLatin1String("file")) {
+            return QString();
+        }
+        const QString md5 = reader.attributes().value(QLatin1String("md5")).toString().trimmed();
+        return hex.match(md5).hasMatch() ? md5.toLower() : QString();
+    }
+    return QString();
+}
+
+GogInstallPlan::Plan GogOfflineClient::segmentPlan(const QString& fileName, qint64 size,
+                                                   qint64 segmentSize)
+{
+    GogInstallPlan::Plan plan;
+    if (size <= 0 || segmentSize <= 0) {
+        return plan;
+    }
+    GogInstallPlan::FileTask file;
+    file.relPath = fileName;
+    file.size = size;
+    for (qint64 at = 0; at < size; at += segmentSize) {
+        GogContentClient::Chunk segment;
+        segment.size = qMin(segmentSize, size - at);
+        segment.compressedSize = segment.size;
+        file.chunks << segment;
+    }
+    plan.files << file;
+    plan.totalSize = size;
+    plan.totalCompressedSize = size;
+    plan.valid = true;
+    return plan;
+}
+
 // --- network -----------------------------------------------------------------
 
 void GogOfflineClient::fetchInstallers(const QString& productId)
@@ -186,7 +339,7 @@ void GogOfflineClient::fetchInstallers(const QString& productId)
 void GogOfflineClient::download(const QString& productId, const Installer& installer,
                                 const QString& destPath)
 {
-    if (m_reply) {
+    if (m_reply || m_segmented) {
         emit downloadFailed(productId, QStringLiteral("another installer is already downloading"));
         return;
     }
@@ -201,14 +354,38 @@ void GogOfflineClient::download(const QString& productId, const Installer& insta
 
     m_productId = productId;
     m_destPath = destPath;
-    // Whatever a previous attempt already fetched. GOG's CDN honours Range, and
-    // a 20 GB installer is not something to start over after a dropped Wi-Fi.
-    m_resumeFrom = QFileInfo(destPath).size();
+    m_installer = installer;
+    ++m_run;
 
     // The token is fetched first rather than inside the request: this URL is an
     // authenticated redirect, and GogRequest::get cannot be used here because it
     // hands back a finished reply — the whole point is to stream the body as it
     // arrives instead of holding twenty gigabytes in memory.
+    authorize([this, url](const QString& token) { startProbe(url, token); });
+}
+
+void GogOfflineClient::fetchTail(const QString& productId, const Installer& installer,
+                                 qint64 tailSize)
+{
+    if (m_reply || m_segmented) {
+        emit downloadFailed(productId, QStringLiteral("another installer is already downloading"));
+        return;
+    }
+
+    const QString url = downloadUrl(installer.manualUrl);
+    if (url.isEmpty()) {
+        emit downloadFailed(productId, QStringLiteral("this installer has no download link"));
+        return;
+    }
+
+    m_productId = productId;
+    authorize([this, url, tailSize](const QString& token) {
+        startTailFetch(url, token, tailSize);
+    });
+}
+
+void GogOfflineClient::authorize(const std::function<void(const QString& token)>& then)
+{
     GogAuth& auth = GogAuth::instance();
     const quint64 requestId = auth.requestToken();
 
@@ -222,12 +399,12 @@ void GogOfflineClient::download(const QString& productId, const Installer& insta
     };
 
     *ready = connect(&auth, &GogAuth::tokenReady, this,
-                     [this, requestId, url, disarm](quint64 id, const QString& token) {
+                     [requestId, then, disarm](quint64 id, const QString& token) {
         if (id != requestId) {
             return;
         }
         disarm();
-        startTransfer(url, token);
+        then(token);
     });
     *failed = connect(&auth, &GogAuth::tokenFailed, this,
                       [this, requestId, disarm](quint64 id, const QString& reason) {
@@ -239,6 +416,504 @@ void GogOfflineClient::download(const QString& productId, const Installer& insta
     });
 }
 
+void GogOfflineClient::startTailFetch(const QString& url, const QString& token, qint64 tailSize)
+{
+    // A suffix range: the last N bytes, whatever the size turns out to be, so
+    // the size and the end of the archive arrive in one round trip.
+    QNetworkRequest request = GogRequest::make(QUrl(url), token);
+    request.setRawHeader("Range", "bytes=-" + QByteArray::number(tailSize));
+
+    QNetworkReply* reply = m_networkManager->get(request);
+    m_reply = reply;
+
+    // A server that ignores Range answers 200 with the whole installer, which
+    // is not something to read into memory. Dropped as soon as it says so.
+    connect(reply, &QNetworkReply::metaDataChanged, this, [this, reply]() {
+        if (m_reply != reply
+            || reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt() != 200) {
+            return;
+        }
+        abortDownload();
+        emit rangesRefused(m_productId);
+    });
+
+    connect(reply, &QNetworkReply::finished, this, [this, reply]() {
+        reply->deleteLater();
+        if (m_reply != reply) {
+            return;   // cancelled, or refused above
+        }
+        m_reply = nullptr;
+
+        if (reply->error() != QNetworkReply::NoError) {
+            emit downloadFailed(m_productId, reply->errorString());
+            return;
+        }
+
+        qint64 first = 0;
+        qint64 last = 0;
+        qint64 total = 0;
+        const int status = reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+        if (status != 206
+            || !parseContentRange(reply->rawHeader("Content-Range"), &first, &last, &total)
+            || total <= 0 || last != total - 1) {
+            emit rangesRefused(m_productId);
+            return;
+        }
+
+        const QByteArray tail = reply->readAll();
+        if (tail.size() != last - first + 1) {
+            emit downloadFailed(m_productId,
+                                QStringLiteral("the end of the installer arrived incomplete"));
+            return;
+        }
+        // Where the redirect led: the signed CDN URL every range after this is
+        // fetched from.
+        emit tailReady(m_productId, reply->url().toString(), total, tail);
+    });
+}
+
+void GogOfflineClient::startProbe(const QString& url, const QString& token)
+{
+    QNetworkRequest request = GogRequest::make(QUrl(url), token);
+    request.setRawHeader("Range", "bytes=0-0");
+
+    QNetworkReply* reply = m_networkManager->get(request);
+    m_reply = reply;
+
+    // A 200 is the whole installer on its way: no ranges, so no segments. The
+    // probe is dropped and the file fetched as one stream, from the start —
+    // the token is still fresh.
+    connect(reply, &QNetworkReply::metaDataChanged, this, [this, reply, url, token]() {
+        if (m_reply != reply
+            || reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt() != 200) {
+            return;
+        }
+        abortDownload();
+        // A segmented attempt leaves a file of full length with holes in it,
+        // which a single stream would take for a finished one.
+        if (QFileInfo::exists(m_destPath + ".parts")) {
+            QDir(m_destPath + ".parts").removeRecursively();
+            QFile::remove(m_destPath);
+        }
+        m_resumeFrom = 0;
+        startTransfer(url, token);
+    });
+
+    connect(reply, &QNetworkReply::finished, this, [this, reply]() {
+        reply->deleteLater();
+        if (m_reply != reply) {
+            return;   // cancelled, or refused above
+        }
+        m_reply = nullptr;
+
+        if (reply->error() != QNetworkReply::NoError) {
+            emit downloadFailed(m_productId, reply->errorString());
+            return;
+        }
+        qint64 first = 0;
+        qint64 last = 0;
+        qint64 total = 0;
+        if (reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt() != 206
+            || !parseContentRange(reply->rawHeader("Content-Range"), &first, &last, &total)
+            || total <= 0) {
+            emit downloadFailed(m_productId,
+                                QStringLiteral("the server did not say how large the installer is"));
+            return;
+        }
+        startSegmented(reply->url().toString(), total);
+    });
+}
+
+void GogOfflineClient::refreshLink(const QString& productId, const Installer& installer)
+{
+    const QString downlink = downlinkUrl(productId, installer.manualUrl);
+    if (downlink.isEmpty()) {
+        emit linkRefreshFailed(productId, QStringLiteral("this installer has no download link"));
+        return;
+    }
+
+    // The same document lookUpChecksum() reads the checksum's URL from; beside
+    // it is the installer's own, signed anew on every ask.
+    GogRequest::get(m_networkManager, QUrl(downlink), this,
+                    [this, productId](QNetworkReply* reply) {
+        const QString url =
+            reply && reply->error() == QNetworkReply::NoError
+                ? QJsonDocument::fromJson(reply->readAll()).object()
+                      .value(QStringLiteral("downlink")).toString()
+                : QString();
+        if (url.isEmpty()) {
+            emit linkRefreshFailed(productId,
+                                   reply && reply->error() != QNetworkReply::NoError
+                                       ? reply->errorString()
+                                       : QStringLiteral("GOG returned no download link"));
+            return;
+        }
+        emit linkRefreshed(productId, url);
+    });
+}
+
+void GogOfflineClient::lookUpChecksum(quint64 run)
+{
+    const QString downlink = downlinkUrl(m_productId, m_installer.manualUrl);
+    const auto settle = [this, run](const QString& md5) {
+        if (!m_segmented || m_segmented->run != run) {
+            return;
+        }
+        m_segmented->expectedMd5 = md5;
+        m_segmented->checksumPending = false;
+        finishSegmented();
+    };
+    if (downlink.isEmpty()) {
+        settle(QString());
+        return;
+    }
+
+    GogRequest::get(m_networkManager, QUrl(downlink), this, [this, settle](QNetworkReply* reply) {
+        const QString checksumUrl =
+            reply && reply->error() == QNetworkReply::NoError
+                ? QJsonDocument::fromJson(reply->readAll()).object()
+                      .value(QStringLiteral("checksum")).toString()
+                : QString();
+        if (checksumUrl.isEmpty()) {
+            settle(QString());
+            return;
+        }
+        GogRequest::getPublic(m_networkManager, QUrl(checksumUrl), this,
+                              [settle](QNetworkReply* xmlReply) {
+            settle(xmlReply && xmlReply->error() == QNetworkReply::NoError
+                       ? parseChecksumXml(xmlReply->readAll()) : QString());
+        });
+    });
+}
+
+void GogOfflineClient::startSegmented(const QString& url, qint64 total)
+{
+    auto segmented = std::make_unique<Segmented>();
+    segmented->run = m_run;
+    segmented->url = url;
+    segmented->total = total;
+
+    // The journal describes a file of exactly this size from exactly this
+    // installer; a file of another length is another download, or a single
+    // stream's prefix.
+    const QString journalDir = m_destPath + ".parts";
+    const qint64 existing = QFileInfo(m_destPath).size();
+    const bool journalled = QFileInfo::exists(journalDir);
+    if (journalled && existing != total) {
+        QDir(journalDir).removeRecursively();
+    }
+
+    const QString buildId = QStringLiteral("%1|%2|%3|%4")
+                                .arg(m_installer.id, m_installer.version,
+                                     m_installer.manualUrl, QString::number(total));
+    const GogInstallPlan::Plan plan =
+        segmentPlan(QFileInfo(m_destPath).fileName(), total, kSegmentBytes);
+    const QString journalError = segmented->journal.open(journalDir, buildId, plan);
+    if (!journalError.isNull()) {
+        emit downloadFailed(m_productId, journalError);
+        return;
+    }
+
+    // What a single stream from an earlier version left behind is a prefix of
+    // the file, and every segment wholly inside it is already fetched.
+    const qint64 streamedPrefix = !journalled && existing < total ? existing : 0;
+
+    segmented->file.setFileName(m_destPath);
+    if (!segmented->file.open(QIODevice::ReadWrite | QIODevice::Unbuffered)
+        || (segmented->file.size() != total && !segmented->file.resize(total))) {
+        emit downloadFailed(m_productId, QStringLiteral("cannot write %1: %2")
+                                             .arg(m_destPath, segmented->file.errorString()));
+        return;
+    }
+    // Sparse: the length is reserved without writing a byte, so the segments
+    // can land anywhere in it.
+
+    for (int i = 0; i < plan.files.first().chunks.size(); ++i) {
+        Segmented::Segment segment;
+        segment.begin = qint64(i) * kSegmentBytes;
+        segment.end = qMin(segment.begin + kSegmentBytes, total);
+        if (segment.end <= streamedPrefix) {
+            segmented->journal.markDone(0, i);
+        }
+        segment.done = segmented->journal.isDone(0, i);
+        segment.fromEarlierRun = segment.done;
+        segment.received = segment.done ? segment.end - segment.begin : 0;
+        segmented->segments << segment;
+    }
+    segmented->progressClock.start();
+    connect(&segmented->rehash, &QFutureWatcher<bool>::finished, this, [this]() { onRehashed(); });
+    m_segmented = std::move(segmented);
+
+    advanceHash();
+    pumpSegments();
+    // May settle at once, when there is nothing to look up, and finish with it.
+    lookUpChecksum(m_run);
+}
+
+void GogOfflineClient::pumpSegments()
+{
+    Segmented* segmented = m_segmented.get();
+    if (!segmented) {
+        return;
+    }
+    const int limit = qMin<int>(segmented->segments.size(), segmented->hashNext + kSegmentWindow);
+    for (int i = segmented->hashNext; i < limit && segmented->active < kConnections; ++i) {
+        const Segmented::Segment& segment = segmented->segments.at(i);
+        if (!segment.done && !segment.reply) {
+            startSegment(i);
+        }
+    }
+}
+
+void GogOfflineClient::startSegment(int index)
+{
+    Segmented::Segment& segment = m_segmented->segments[index];
+    // From where the last attempt stopped: what it received is on disk, and
+    // hashed or held, so asking for it again would count it twice.
+    const qint64 from = segment.begin + segment.received;
+    QNetworkReply* reply =
+        m_networkManager->get(rangeRequest(m_segmented->url, from, segment.end - from));
+    segment.reply = reply;
+    ++segment.attempts;
+    ++m_segmented->active;
+
+    // A server that answers a range with the whole file would write it over
+    // this segment's neighbours, and the md5 with it. Dropped as soon as it
+    // says so; the segments already finished keep.
+    connect(reply, &QNetworkReply::metaDataChanged, this, [this, reply]() {
+        if (reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt() == 200) {
+            failSegmented(QStringLiteral("the server stopped answering ranges"));
+        }
+    });
+    connect(reply, &QNetworkReply::readyRead, this, [this, index]() { onSegmentData(index); });
+    connect(reply, &QNetworkReply::finished, this, [this, index]() { onSegmentFinished(index); });
+}
+
+void GogOfflineClient::onSegmentData(int index)
+{
+    if (!m_segmented) {
+        return;
+    }
+    Segmented::Segment& segment = m_segmented->segments[index];
+    if (!segment.reply
+        || segment.reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt() != 206) {
+        return;
+    }
+
+    const QByteArray data =
+        segment.reply->read(segment.end - segment.begin - segment.received);
+    if (data.isEmpty()) {
+        return;
+    }
+    QFile& file = m_segmented->file;
+    if (!file.seek(segment.begin + segment.received) || file.write(data) != data.size()) {
+        failSegmented(QStringLiteral("cannot write %1: %2").arg(m_destPath, file.errorString()));
+        return;
+    }
+    segment.received += data.size();
+
+    // In file order: the segment the md5 has reached is hashed as it arrives,
+    // anything further on waits in memory until the md5 gets there.
+    if (index == m_segmented->hashNext) {
+        m_segmented->md5.addData(data);
+    } else {
+        segment.held.append(data);
+    }
+    emitSegmentedProgress(false);
+}
+
+void GogOfflineClient::onSegmentFinished(int index)
+{
+    if (!m_segmented) {
+        return;
+    }
+    Segmented::Segment& segment = m_segmented->segments[index];
+    QNetworkReply* reply = segment.reply;
+    if (!reply) {
+        return;
+    }
+    onSegmentData(index);
+    if (!m_segmented) {
+        return;   // the write failed
+    }
+    segment.reply = nullptr;
+    --m_segmented->active;
+    reply->deleteLater();
+
+    if (segment.received < segment.end - segment.begin) {
+        if (segment.attempts >= kMaxAttemptsPerSegment) {
+            failSegmented(reply->error() != QNetworkReply::NoError
+                              ? reply->errorString()
+                              : QStringLiteral("the installer arrived incomplete"));
+            return;
+        }
+        pumpSegments();   // the rest of it, on the next free connection
+        return;
+    }
+
+    // Recorded once its bytes are with the kernel, which is all the journal
+    // promises: a crash loses at most the segments in flight. Flushed at once,
+    // since the journal's batch is 64 records and here each is 8 MiB.
+    segment.done = true;
+    m_segmented->journal.markDone(0, index);
+    m_segmented->journal.flush();
+    advanceHash();
+    pumpSegments();
+    finishSegmented();
+}
+
+void GogOfflineClient::advanceHash()
+{
+    Segmented* segmented = m_segmented.get();
+    if (segmented->rehash.isRunning()) {
+        return;   // onRehashed() carries on from where it got to
+    }
+    while (segmented->hashNext < segmented->segments.size()) {
+        Segmented::Segment& segment = segmented->segments[segmented->hashNext];
+        if (segment.fromEarlierRun) {
+            rehashEarlierRun();
+            return;
+        }
+        if (!segment.held.isEmpty()) {
+            segmented->md5.addData(segment.held);
+            segment.held = QByteArray();
+        }
+        if (!segment.done) {
+            break;
+        }
+        ++segmented->hashNext;
+    }
+}
+
+void GogOfflineClient::rehashEarlierRun()
+{
+    // Fetched by an earlier run, so their bytes went by before this md5
+    // existed. Read back once, the whole run of them at a time; the page cache
+    // usually still has them, but a resumed multi-gigabyte installer is
+    // seconds of reading all the same, and the fetch carries on meanwhile.
+    Segmented* segmented = m_segmented.get();
+    const qint64 from = segmented->segments.at(segmented->hashNext).begin;
+    qint64 to = from;
+    for (int i = segmented->hashNext;
+         i < segmented->segments.size() && segmented->segments.at(i).fromEarlierRun; ++i) {
+        to = segmented->segments.at(i).end;
+    }
+
+    QCryptographicHash* md5 = &segmented->md5;
+    const std::atomic_bool* cancelled = &segmented->cancelled;
+    const QString path = m_destPath;
+    segmented->rehash.setFuture(QtConcurrent::run([path, from, to, md5, cancelled]() {
+        // A descriptor of its own: the GUI thread goes on writing through the other.
+        QFile file(path);
+        if (!file.open(QIODevice::ReadOnly)) {
+            return false;
+        }
+        for (qint64 at = from; at < to; at += kRehashPiece) {
+            if (*cancelled) {
+                return false;
+            }
+            const qint64 length = qMin(kRehashPiece, to - at);
+            if (!file.seek(at)) {
+                return false;
+            }
+            const QByteArray piece = file.read(length);
+            if (piece.size() != length) {
+                return false;
+            }
+            md5->addData(piece);
+        }
+        return true;
+    }));
+}
+
+void GogOfflineClient::onRehashed()
+{
+    Segmented* segmented = m_segmented.get();
+    if (!segmented) {
+        return;
+    }
+    if (!segmented->rehash.result()) {
+        failSegmented(QStringLiteral("cannot read %1 back to check it").arg(m_destPath));
+        return;
+    }
+    while (segmented->hashNext < segmented->segments.size()
+           && segmented->segments.at(segmented->hashNext).fromEarlierRun) {
+        segmented->segments[segmented->hashNext].fromEarlierRun = false;
+        ++segmented->hashNext;
+    }
+    advanceHash();
+    pumpSegments();
+    finishSegmented();
+}
+
+void GogOfflineClient::finishSegmented()
+{
+    Segmented* segmented = m_segmented.get();
+    if (!segmented || segmented->hashNext < segmented->segments.size()
+        || segmented->checksumPending) {
+        return;
+    }
+    emitSegmentedProgress(true);
+
+    const QString expected = segmented->expectedMd5;
+    const QString actual = QString::fromLatin1(segmented->md5.result().toHex());
+    segmented->file.close();
+    segmented->journal.close();
+    m_segmented.reset();
+
+    const QString journalDir = m_destPath + ".parts";
+    if (!expected.isEmpty() && actual != expected) {
+        // Nothing in it can be trusted to resume from, either.
+        QDir(journalDir).removeRecursively();
+        QFile::remove(m_destPath);
+        emit downloadFailed(m_productId,
+                            QStringLiteral("the installer does not match GOG's checksum — the "
+                                           "download is damaged"));
+        return;
+    }
+    QDir(journalDir).removeRecursively();
+    emit downloadFinished(m_productId, m_destPath);
+}
+
+void GogOfflineClient::failSegmented(const QString& reason)
+{
+    stopSegmented();
+    emit downloadFailed(m_productId, reason);
+}
+
+void GogOfflineClient::stopSegmented()
+{
+    if (!m_segmented) {
+        return;
+    }
+    // What is finished stays finished: the journal has it, and the next
+    // attempt fetches only the rest.
+    std::unique_ptr<Segmented> segmented = std::move(m_segmented);
+    for (Segmented::Segment& segment : segmented->segments) {
+        if (QNetworkReply* reply = std::exchange(segment.reply, nullptr)) {
+            reply->disconnect(this);
+            reply->abort();
+            reply->deleteLater();
+        }
+    }
+    segmented->journal.compact();
+    segmented->file.close();
+}
+
+void GogOfflineClient::emitSegmentedProgress(bool force)
+{
+    Segmented* segmented = m_segmented.get();
+    if (!force && segmented->progressClock.elapsed() < 100) {
+        return;
+    }
+    segmented->progressClock.restart();
+    qint64 received = 0;
+    for (const Segmented::Segment& segment : std::as_const(segmented->segments)) {
+        received += segment.received;
+    }
+    emit downloadProgress(m_productId, received, segmented->total);
+}
+
 void GogOfflineClient::startTransfer(const QString& url, const QString& token)
 {
     m_sink = new QFile(m_destPath, this);
@@ -318,6 +993,7 @@ void GogOfflineClient::startTransfer(const QString& url, const QString& token)
 void GogOfflineClient::cancel()
 {
     abortDownload();
+    stopSegmented();
     if (m_sink) {
         m_sink->close();
         delete m_sink;
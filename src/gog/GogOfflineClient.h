@@ -3,9 +3,15 @@
 
 #include <QList>
 #include <QNetworkAccessManager>
+#include <QNetworkRequest>
 #include <QObject>
 #include <QString>
 
+#include <functional>
+#include <memory>
+
+#include "gog/GogInstallPlan.h"
+
 class QFile;
 class QNetworkReply;
 
@@ -22,6 +28,22 @@ class QNetworkReply;
 // holding 20 GB in memory. And the URL is behind a redirect that only resolves
 // with a bearer token, so the request has to be authenticated even though the
 // file it lands on is not.
+//
+// The CDN honours Range, which allows a second way in: fetchTail() resolves the
+// redirect and reads the end of the archive in one request, and from there
+// the installer can be read piecemeal with rangeRequest() — its directory
+// first, then the entries — without ever being written out whole.
+//
+// When the installer is wanted whole after all — an earlier attempt left part
+// of one on disk — download() still uses ranges where it can. One stream to
+// GOG's CDN tops out well below a fast link, so the file is split into
+// segments fetched over several connections at once, into a file preallocated
+// at its full size. Which segments are finished is kept in a
+// GogInstallJournal beside it, one "chunk" per segment, so a resume fetches
+// only the rest. The md5 is computed as the bytes go by, in file order, and
+// checked against the one GOG publishes for the installer: the file is never
+// read back once it is on disk. A server that will not answer ranges gets the
+// single stream it always did.
 class GogOfflineClient : public QObject
 {
     Q_OBJECT
@@ -59,13 +81,54 @@ public:
 
     static QString downloadUrl(const QString& manualUrl);
 
+    // "bytes 100-199/1000" gives 100, 199 and 1000; a total of "*" gives -1.
+    // False for anything else: a reply without one was not a range.
+    static bool parseContentRange(const QByteArray& header, qint64* first, qint64* last,
+                                  qint64* total);
+
+    // `size` bytes at `offset` of the URL fetchTail() landed on. That URL
+    // carries its own signature, so no token goes with it.
+    static QNetworkRequest rangeRequest(const QString& url, qint64 offset, qint64 size);
+
+    // api.gog.com's downlink for the installer `manualUrl` names: a JSON
+    // document giving the CDN URL and, beside it, the URL of the checksum
+    // document. Empty when `manualUrl` has no installer id at its end.
+    static QString downlinkUrl(const QString& productId, const QString& manualUrl);
+
+    // The checksum document: <file name="…" md5="…" total_size="…">, with
+    // per-chunk sums inside that are not needed here. The whole-file md5 in
+    // lower case, or empty when the document carries none — GOG does not
+    // publish one for every file, and its absence is not an error.
+    static QString parseChecksumXml(const QByteArray& xml);
+
+    // A download of `size` bytes cut into segments of `segmentSize`, shaped as
+    // the plan GogInstallJournal keeps progress against: one file, one chunk
+    // per segment.
+    static GogInstallPlan::Plan segmentPlan(const QString& fileName, qint64 size,
+                                            qint64 segmentSize);
+
     // --- async ---
 
     void fetchInstallers(const QString& productId);
 
-    // Streams to `destPath`, resuming from whatever is already there when the
-    // server allows it. Emits downloadProgress throttled to 100 ms.
+    // Fetches the whole installer to `destPath`, in segments over several
+    // connections where the server answers ranges, resuming whatever an earlier
+    // attempt finished. Emits downloadProgress throttled to 100 ms, and
+    // downloadFailed rather than downloadFinished when the result does not
+    // match GOG's checksum.
     void download(const QString& productId, const Installer& installer, const QString& destPath);
+
+    // The last `tailSize` bytes of the installer, or all of it when it is
+    // smaller, together with where the redirect led and the archive's size.
+    // Emits rangesRefused instead when the server answers with the whole file,
+    // which is then not read at all.
+    void fetchTail(const QString& productId, const Installer& installer, qint64 tailSize);
+
+    // A freshly signed CDN URL for the installer, from its downlink document,
+    // for when the one fetchTail() landed on has expired. Emits linkRefreshed
+    // or linkRefreshFailed; nothing else in flight is touched.
+    void refreshLink(const QString& productId, const Installer& installer);
+
     void cancel();
 
 signals:
@@ -76,13 +139,43 @@ signals:
     void downloadFinished(const QString& productId, const QString& path);
     void downloadFailed(const QString& productId, const QString& reason);
 
+    void tailReady(const QString& productId, const QString& url, qint64 archiveSize,
+                   const QByteArray& tail);
+    void rangesRefused(const QString& productId);
+
+    void linkRefreshed(const QString& productId, const QString& url);
+    void linkRefreshFailed(const QString& productId, const QString& reason);
+
 private:
+    struct Segmented;
+
     GogOfflineClient();
-    ~GogOfflineClient() override = default;
+    ~GogOfflineClient() override;
     GogOfflineClient(const GogOfflineClient&) = delete;
     GogOfflineClient& operator=(const GogOfflineClient&) = delete;
 
+    // Fetches a token and hands it to `then`; a failure is a downloadFailed.
+    void authorize(const std::function<void(const QString& token)>& then);
     void startTransfer(const QString& url, const QString& token);
+    // Asks for one byte, to learn whether ranges are honoured, how large the
+    // file is, and where the redirect leads.
+    void startProbe(const QString& url, const QString& token);
+    void lookUpChecksum(quint64 run);
+    void startSegmented(const QString& url, qint64 total);
+    void pumpSegments();
+    void startSegment(int index);
+    void onSegmentData(int index);
+    void onSegmentFinished(int index);
+    void advanceHash();
+    // Hashes the run of segments an earlier run fetched, from hashNext on, on
+    // a worker; onRehashed() takes up from there.
+    void rehashEarlierRun();
+    void onRehashed();
+    void finishSegmented();
+    void failSegmented(const QString& reason);
+    void stopSegmented();
+    void emitSegmentedProgress(bool force);
+    void startTailFetch(const QString& url, const QString& token, qint64 tailSize);
     void abortDownload();
 
     QNetworkAccessManager* m_networkManager;
@@ -90,6 +183,9 @@ private:
     QFile* m_sink = nullptr;
     QString m_productId;
     QString m_destPath;
+    Installer m_installer;
+    std::unique_ptr<Segmented> m_segmented;
+    quint64 m_run = 0;     // bumped per download, so a late checksum reply is ignored
     qint64 m_resumeFrom = 0;
     bool m_rangeHonoured = true;
 };
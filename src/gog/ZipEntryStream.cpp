@@ -0,0 +1,274 @@
+#include "ZipEntryStream.h"
+
+#include <QAtomicInteger>
+#include <QCoreApplication>
+#include <QDir>
+#include <QFileInfo>
+#include <QtEndian>
+
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+
+#include <zlib.h>
+
+namespace {
+
+constexpr quint32 kSigLocalHeader = 0x04034b50;
+constexpr int kLocalHeaderFixedSize = 30;
+
+// Inflate's output buffer, fixed for the stream's life; the same size
+// extractEntry has always streamed in.
+constexpr int kOutBufferSize = 256 * 1024;
+
+// Beside the destination, so the rename into place never crosses a filesystem,
+// and unique to the stream.
+QString newTempName(const QString& destPath)
+{
+    static QAtomicInteger<quint64> counter;
+    return QStringLiteral("%1.%2-%3.part")
+        .arg(destPath)
+        .arg(QCoreApplication::applicationPid())
+        .arg(counter.fetchAndAddRelaxed(1));
+}
+
+} // namespace
+
+struct ZipEntryStream::Inflater {
+    z_stream stream = {};
+    bool initialised = false;
+};
+
+ZipEntryStream::ZipEntryStream(const ZipReader::Entry& entry, const QString& destPath,
+                               std::atomic<qint64>* bytesWritten)
+    : m_entry(entry)
+    , m_destPath(destPath)
+    , m_bytesWritten(bytesWritten)
+    , m_dataRemaining(entry.compressedSize)
+    , m_inflater(std::make_unique<Inflater>())
+    , m_crc(crc32(0L, nullptr, 0))
+{
+    if (entry.method != 0 && entry.method != 8) {
+        fail(QStringLiteral("%1: unsupported compression method %2")
+                 .arg(entry.name).arg(entry.method));
+        return;
+    }
+
+    if (entry.method == 8) {
+        // Raw deflate, window bits -15 — a ZIP stores the deflate stream with
+        // no zlib wrapper around it, unlike the content system's bodies.
+        m_inflater->initialised = inflateInit2(&m_inflater->stream, -15) == Z_OK;
+        if (!m_inflater->initialised) {
+            fail(QStringLiteral("%1: could not start decompression").arg(entry.name));
+            return;
+        }
+        m_outBuffer = QByteArray(kOutBufferSize, Qt::Uninitialized);
+    }
+
+    if (!m_destPath.isEmpty()) {
+        QDir().mkpath(QFileInfo(m_destPath).absolutePath());
+        m_out.setFileName(newTempName(m_destPath));
+        if (!m_out.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+            m_writeFailed = true;
+            fail(QStringLiteral("cannot write %1: %2").arg(m_destPath, m_out.errorString()));
+        }
+    }
+}
+
+ZipEntryStream::~ZipEntryStream()
+{
+    if (m_inflater->initialised) {
+        inflateEnd(&m_inflater->stream);
+    }
+    if (!m_succeeded) {
+        discard();
+    }
+}
+
+void ZipEntryStream::discard()
+{
+    if (m_out.fileName().isEmpty()) {
+        return;
+    }
+    m_out.close();
+    QFile::remove(m_out.fileName());
+}
+
+void ZipEntryStream::fail(const QString& message)
+{
+    if (m_error.isNull()) {
+        m_error = message;
+    }
+}
+
+bool ZipEntryStream::atEnd() const
+{
+    return m_phase == Phase::Done || !m_error.isNull();
+}
+
+qint64 ZipEntryStream::feed(const char* data, qint64 size)
+{
+    qint64 used = 0;
+    while (used < size && !atEnd() && !m_finished) {
+        const char* at = data + used;
+        const qint64 left = size - used;
+
+        switch (m_phase) {
+        case Phase::Header: {
+            const qint64 take = qMin<qint64>(left, kLocalHeaderFixedSize - m_header.size());
+            m_header.append(at, take);
+            used += take;
+            if (m_header.size() < kLocalHeaderFixedSize) {
+                break;
+            }
+            const auto* p = reinterpret_cast<const uchar*>(m_header.constData());
+            if (qFromLittleEndian<quint32>(p) != kSigLocalHeader) {
+                fail(QStringLiteral("%1: no local header where the directory said")
+                         .arg(m_entry.name));
+                break;
+            }
+            m_skip = qFromLittleEndian<quint16>(p + 26) + qFromLittleEndian<quint16>(p + 28);
+            m_phase = m_skip > 0 ? Phase::Skip
+                                 : (m_dataRemaining > 0 ? Phase::Data : Phase::Done);
+            break;
+        }
+        case Phase::Skip: {
+            const qint64 take = qMin(left, m_skip);
+            m_skip -= take;
+            used += take;
+            if (m_skip == 0) {
+                m_phase = m_dataRemaining > 0 ? Phase::Data : Phase::Done;
+            }
+            break;
+        }
+        case Phase::Data: {
+            const qint64 take = qMin(left, m_dataRemaining);
+            consumeData(at, take);
+            m_dataRemaining -= take;
+            used += take;
+            if (m_dataRemaining == 0) {
+                m_phase = Phase::Done;
+            }
+            break;
+        }
+        case Phase::Done:
+            break;
+        }
+    }
+    return used;
+}
+
+void ZipEntryStream::consumeData(const char* data, qint64 size)
+{
+    if (m_entry.method == 0) {
+        m_crc = crc32(m_crc, reinterpret_cast<const Bytef*>(data), static_cast<uInt>(size));
+        write(data, size);
+        return;
+    }
+
+    // Whatever follows the end of the deflate stream inside the entry's
+    // compressed size is padding; it is consumed and ignored.
+    if (m_streamEnded) {
+        return;
+    }
+    z_stream& stream = m_inflater->stream;
+    stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data));
+    stream.avail_in = static_cast<uInt>(size);
+
+    while (stream.avail_in > 0 && !m_streamEnded && m_error.isNull()) {
+        stream.next_out = reinterpret_cast<Bytef*>(m_outBuffer.data());
+        stream.avail_out = static_cast<uInt>(m_outBuffer.size());
+
+        const int status = inflate(&stream, Z_NO_FLUSH);
+        if (status != Z_OK && status != Z_STREAM_END && status != Z_BUF_ERROR) {
+            fail(QStringLiteral("%1: could not be decompressed").arg(m_entry.name));
+            return;
+        }
+        m_streamEnded = status == Z_STREAM_END;
+
+        const qint64 produced = m_outBuffer.size() - static_cast<qint64>(stream.avail_out);
+        if (produced > 0) {
+            m_crc = crc32(m_crc, reinterpret_cast<const Bytef*>(m_outBuffer.constData()),
+                          static_cast<uInt>(produced));
+            if (!write(m_outBuffer.constData(), produced)) {
+                return;
+            }
+        }
+        if (status == Z_BUF_ERROR && produced == 0) {
+            break;   // wants more input than this piece had
+        }
+    }
+}
+
+bool ZipEntryStream::write(const char* data, qint64 size)
+{
+    if (m_destPath.isEmpty()) {
+        m_content.append(data, size);
+        return true;
+    }
+    if (m_out.write(data, size) != size) {
+        m_writeFailed = true;
+        fail(QStringLiteral("cannot write %1: %2").arg(m_destPath, m_out.errorString()));
+        return false;
+    }
+    if (m_bytesWritten) {
+        *m_bytesWritten += size;
+    }
+    return true;
+}
+
+QString ZipEntryStream::finish()
+{
+    if (m_finished) {
+        return m_succeeded ? QString() : m_error;
+    }
+    m_finished = true;
+
+    if (m_error.isNull()
+        && (m_phase != Phase::Done || (m_entry.method == 8 && !m_streamEnded))) {
+        fail(QStringLiteral("%1: the archive ends mid-entry").arg(m_entry.name));
+    }
+
+    // A truncated download that still unpacks is worse than one that fails: the
+    // game breaks later, somewhere unrelated, with nothing pointing back here.
+    // The entry's CRC is the central directory's, real even for an entry whose
+    // local header defers it to a data descriptor, so zero is compared too.
+    if (m_error.isNull() && m_crc != m_entry.crc) {
+        fail(QStringLiteral("%1: checksum mismatch — the download is damaged")
+                 .arg(m_entry.name));
+    }
+
+    if (!m_error.isNull()) {
+        discard();
+        m_content.clear();
+        return m_error;
+    }
+
+    if (!m_destPath.isEmpty()) {
+        // close() would swallow a failed flush; the disk filling up on the
+        // last buffer is still a failed write.
+        if (!m_out.flush()) {
+            m_writeFailed = true;
+            fail(QStringLiteral("cannot write %1: %2").arg(m_destPath, m_out.errorString()));
+            discard();
+            return m_error;
+        }
+        m_out.close();
+        if (m_entry.isExecutable()) {
+            m_out.setPermissions(m_out.permissions() | QFileDevice::ExeOwner
+                                 | QFileDevice::ExeGroup | QFileDevice::ExeOther);
+        }
+        // rename(2) rather than QFile::rename, which will not replace a file
+        // already there: a reinstall over an old copy, or a retry's twin.
+        if (std::rename(QFile::encodeName(m_out.fileName()).constData(),
+                        QFile::encodeName(m_destPath).constData()) != 0) {
+            m_writeFailed = true;
+            fail(QStringLiteral("cannot write %1: %2")
+                     .arg(m_destPath, QString::fromLocal8Bit(std::strerror(errno))));
+            discard();
+            return m_error;
+        }
+    }
+    m_succeeded = true;
+    return QString();
+}
@@ -0,0 +1,103 @@
+#ifndef ZIPENTRYSTREAM_H
+#define ZIPENTRYSTREAM_H
+
+#include <QByteArray>
+#include <QFile>
+#include <QString>
+
+#include <atomic>
+#include <memory>
+
+#include "gog/ZipReader.h"
+
+// One archive entry on its way into its file, fed the archive's bytes from the
+// entry's local header onwards — wherever those bytes come from. ZipReader
+// feeds it from the installer on disk; GogDownloader feeds it straight from a
+// ranged request to GOG's CDN, so a native install never needs the installer
+// itself on disk.
+//
+// The local header is parsed here rather than trusted from the central
+// directory, for the reason ZipReader::entryDataOffset gives: its name and
+// extra lengths decide where the data begins, and they are often not the
+// directory's. Everything after the entry's data — a data descriptor, the next
+// entry — is not consumed, so a caller feeding a run of entries knows where the
+// next one starts.
+//
+// The verdict is finish()'s, in the same order of precedence extractEntry has
+// always used: a malformed header, then bytes that would not inflate, then an
+// entry that ended early, then a CRC that does not match, and a file that would
+// not take the write. The file is written under a temporary name of its own
+// and only renamed into place by a successful finish(), so an entry that fails,
+// or is dropped half-way, leaves nothing behind — and a second stream for the
+// same path, a retry started before the first has let go, cannot have its file
+// deleted from under it.
+//
+// It is not synced on the way, as QSaveFile would: a game is thousands of
+// small files, and an fsync apiece was most of the time they took to install.
+// An install cut short by a crash is unpacked again, not trusted.
+//
+// Not thread-safe, but not thread-bound: fed one piece at a time, in order,
+// from whichever thread.
+class ZipEntryStream
+{
+public:
+    // An empty `destPath` keeps the content in memory instead — a symlink's
+    // content is its target, and has no business becoming a file. Bytes
+    // written to disk are added to `bytesWritten` as they go, when given.
+    ZipEntryStream(const ZipReader::Entry& entry, const QString& destPath,
+                   std::atomic<qint64>* bytesWritten = nullptr);
+    ~ZipEntryStream();
+    ZipEntryStream(const ZipEntryStream&) = delete;
+    ZipEntryStream& operator=(const ZipEntryStream&) = delete;
+
+    // Returns how much of `data` belonged to the entry. Less than `size` only
+    // once the entry is complete, or has failed.
+    qint64 feed(const char* data, qint64 size);
+    qint64 feed(const QByteArray& data) { return feed(data.constData(), data.size()); }
+
+    // The entry's data has all been fed, or feeding more cannot help.
+    bool atEnd() const;
+
+    // Returns a null QString on success. Call once.
+    QString finish();
+
+    // In-memory mode only.
+    QByteArray content() const { return m_content; }
+
+    // The failure was the disk's, not the archive's: fetching the bytes again
+    // will not help.
+    bool writeFailed() const { return m_writeFailed; }
+
+private:
+    struct Inflater;
+
+    enum class Phase { Header, Skip, Data, Done };
+
+    void consumeData(const char* data, qint64 size);
+    bool write(const char* data, qint64 size);
+    void fail(const QString& message);
+    void discard();
+
+    ZipReader::Entry m_entry;
+    QString m_destPath;
+    std::atomic<qint64>* m_bytesWritten = nullptr;
+
+    Phase m_phase = Phase::Header;
+    QByteArray m_header;            // until the fixed local header is complete
+    qint64 m_skip = 0;              // its name and extra field
+    qint64 m_dataRemaining = 0;
+
+    QFile m_out;                    // under its temporary name
+    QByteArray m_content;
+    std::unique_ptr<Inflater> m_inflater;
+    QByteArray m_outBuffer;
+    quint32 m_crc = 0;
+
+    bool m_streamEnded = false;
+    bool m_writeFailed = false;
+    QString m_error;                // the first thing to go wrong
+    bool m_finished = false;
+    bool m_succeeded = false;
+};
+
+#endif // ZIPENTRYSTREAM_H
@@ -1,9 +1,19 @@
 #include "ZipReader.h"
 #include "gog/GogContentClient.h"
+#include "gog/ZipEntryStream.h"
 
+#include <QAtomicInteger>
+#include <QCoreApplication>
 #include <QDir>
 #include <QFileInfo>
-
+#include <QMutexLocker>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <limits>
+#include <unistd.h>
 #include <zlib.h>
 
 namespace {
@@ -18,6 +28,9 @@ constexpr int kEocdFixedSize = 22;
 constexpr int kCentralHeaderFixedSize = 46;
 constexpr int kLocalHeaderFixedSize = 30;
 
+constexpr int kZip64EocdSize = 56;
+constexpr int kZip64LocatorSize = 20;
+
 // A ZIP comment is a 16-bit length, so the record can be at most this far from
 // the end of the file.
 constexpr int kMaxCommentSize = 0xFFFF;
@@ -27,6 +40,24 @@ constexpr quint32 kZip64Marker32 = 0xFFFFFFFFu;
 constexpr quint16 kZip64Marker16 = 0xFFFFu;
 
 constexpr int kStreamBufferSize = 256 * 1024;
+// A stored entry is copied in pieces this large, so a pause or cancel is seen
+// between them and progress moves while a multi-gigabyte file goes across.
+constexpr qint64 kCopyPieceSize = 8 * 1024 * 1024;
+
+// The most readAt() hands back at once: a QByteArray is sized by int here, and
+// an entry past it is one to extract, not to hold.
+constexpr qint64 kMaxReadSize = std::numeric_limits<int>::max();
+
+// Beside the destination, as ZipEntryStream names its own, so the rename into
+// place never crosses a filesystem, and unique to the extraction.
+QString newTempName(const QString& destPath)
+{
+    static QAtomicInteger<quint64> counter;
+    return QStringLiteral("%1.%2-%3.part")
+        .arg(destPath)
+        .arg(QCoreApplication::applicationPid())
+        .arg(counter.fetchAndAddRelaxed(1));
+}
 
 quint16 readU16(const QByteArray& data, int offset)
 {
@@ -56,6 +87,61 @@ quint64 readU64(const QByteArray& data, int offset)
            | (static_cast<quint64>(readU32(data, offset + 4)) << 32);
 }
 
+// `size` bytes from `inFd` at `inOffset` to `outFd` at `outOffset`, inside the
+// kernel where it can: copy_file_range, which on a filesystem that supports it
+// shares the blocks rather than copying them at all. Falls back to plain reads
+// and writes for the cases GogFileWriter::copyRange lists.
+bool copyBytes(int inFd, qint64 inOffset, int outFd, qint64 outOffset, qint64 size)
+{
+    loff_t in = inOffset;
+    loff_t out = outOffset;
+    qint64 remaining = size;
+    while (remaining > 0) {
+        const ssize_t copied = ::copy_file_range(inFd, &in, outFd, &out,
+                                                 static_cast<size_t>(remaining), 0);
+        if (copied < 0 && errno == EINTR) {
+            continue;
+        }
+        if (copied > 0) {
+            remaining -= copied;
+            continue;
+        }
+        if (copied == 0
+            || (errno != EXDEV && errno != ENOSYS && errno != EOPNOTSUPP && errno != EINVAL)) {
+            return false;
+        }
+        break;
+    }
+
+    QByteArray buffer;
+    while (remaining > 0) {
+        buffer.resize(static_cast<int>(qMin<qint64>(remaining, kStreamBufferSize)));
+        const ssize_t got = ::pread(inFd, buffer.data(), buffer.size(), in);
+        if (got < 0 && errno == EINTR) {
+            continue;
+        }
+        if (got <= 0) {
+            return false;
+        }
+        qint64 sent = 0;
+        while (sent < got) {
+            const ssize_t n = ::pwrite(outFd, buffer.constData() + sent,
+                                       static_cast<size_t>(got - sent), out + sent);
+            if (n < 0 && errno == EINTR) {
+                continue;
+            }
+            if (n <= 0) {
+                return false;
+            }
+            sent += n;
+        }
+        in += got;
+        out += got;
+        remaining -= got;
+    }
+    return true;
+}
+
 // The ZIP64 extra field (header id 0x0001) carries whichever of the four values
 // were too large for their 32-bit slots, in a fixed order and only when the
 // slot held the sentinel. Reading them unconditionally is a common bug: the
@@ -93,6 +179,37 @@ void applyZip64Extra(const QByteArray& extra, bool needUncompressed, bool needCo
 
 } // namespace
 
+void ZipReader::Control::setPaused(bool on)
+{
+    QMutexLocker locker(&m_mutex);
+    paused = on;
+    if (!on) {
+        m_changed.wakeAll();
+    }
+}
+
+void ZipReader::Control::cancel()
+{
+    QMutexLocker locker(&m_mutex);
+    cancelled = true;
+    paused = false;
+    m_changed.wakeAll();
+}
+
+bool ZipReader::Control::stopRequested()
+{
+    // A paused extraction holds its place rather than giving it up: the entry
+    // it is in the middle of may be gigabytes long. Unpaused, this is two
+    // atomic loads and no lock.
+    if (paused.load() && !cancelled.load()) {
+        QMutexLocker locker(&m_mutex);
+        while (paused.load() && !cancelled.load()) {
+            m_changed.wait(&m_mutex);
+        }
+    }
+    return cancelled.load();
+}
+
 ZipReader::~ZipReader()
 {
     close();
@@ -100,11 +217,22 @@ ZipReader::~ZipReader()
 
 void ZipReader::close()
 {
+    if (m_map) {
+        m_file.unmap(const_cast<uchar*>(m_map));
+        m_map = nullptr;
+    }
     if (m_file.isOpen()) {
         m_file.close();
     }
     m_entries.clear();
+    m_index.clear();
+    m_headerOffsets.clear();
+    m_fileSize = 0;
     m_baseOffset = 0;
+    m_archiveSize = 0;
+    m_cdStart = 0;
+    m_cdSize = 0;
+    m_entryCount = 0;
     m_status = Status::NotOpen;
     m_error.clear();
 }
@@ -122,6 +250,13 @@ QString ZipReader::safeName(const QString& entryName)
     return GogContentClient::sanitizeDepotPath(entryName);
 }
 
+qint64 ZipReader::maxTailSize()
+{
+    // The EOCD with the longest comment it can carry, and in front of it the
+    // ZIP64 locator and record.
+    return kMaxCommentSize + kEocdFixedSize + kZip64LocatorSize + kZip64EocdSize;
+}
+
 bool ZipReader::open(const QString& path)
 {
     close();
@@ -132,11 +267,60 @@ bool ZipReader::open(const QString& path)
         return false;
     }
 
+    // Mapped where it can be, so the directory is parsed where it lies and a
+    // stored entry is handed out without being copied. A file that will not
+    // map is read with pread instead, through the same readAt().
+    const qint64 fileSize = m_file.size();
+    m_fileSize = fileSize;
+    if (fileSize > 0) {
+        m_map = m_file.map(0, fileSize);
+    }
+    const qint64 tailLen = qMin(fileSize, maxTailSize());
+    if (!parseTail(fileSize, readAt(fileSize - tailLen, tailLen))) {
+        return false;
+    }
+    if (m_cdStart + m_cdSize > fileSize) {
+        fail(Status::Corrupt, QStringLiteral("the central directory lies outside the file"));
+        return false;
+    }
+    const QByteArray cd = readAt(m_cdStart, m_cdSize);
+    if (cd.size() != m_cdSize) {
+        fail(Status::Corrupt, QStringLiteral("the central directory is truncated"));
+        return false;
+    }
+    return parseCentralDirectory(cd);
+}
+
+bool ZipReader::openTail(qint64 archiveSize, const QByteArray& tail)
+{
+    close();
+    return parseTail(archiveSize, tail);
+}
+
+bool ZipReader::openCentralDirectory(const QByteArray& directory)
+{
+    if (m_status != Status::NotOpen || !m_error.isEmpty() || m_archiveSize <= 0) {
+        if (m_error.isEmpty()) {
+            fail(Status::NotOpen, QStringLiteral("no central directory has been located"));
+        }
+        return false;
+    }
+    if (directory.size() != m_cdSize) {
+        fail(Status::Corrupt, QStringLiteral("the central directory is truncated"));
+        return false;
+    }
+    return parseCentralDirectory(directory);
+}
+
+bool ZipReader::parseTail(qint64 archiveSize, const QByteArray& tail)
+{
+    m_archiveSize = archiveSize;
+
     qint64 cdEnd = 0;
     qint64 cdOffset = 0;
     qint64 cdSize = 0;
     qint64 entryCount = 0;
-    if (!findEndOfCentralDirectory(&cdEnd, &cdOffset, &cdSize, &entryCount)) {
+    if (!findEndOfCentralDirectory(tail, &cdEnd, &cdOffset, &cdSize, &entryCount)) {
         return false;
     }
 
@@ -144,31 +328,32 @@ bool ZipReader::open(const QString& path)
     // at cdEnd, so its real start is cdEnd - cdSize; the archive therefore
     // begins that many bytes before the offset the ZIP claims it does.
     m_baseOffset = cdEnd - cdSize - cdOffset;
-    if (m_baseOffset < 0) {
+    if (m_baseOffset < 0 || cdSize < 0 || cdEnd - cdSize < 0) {
         fail(Status::Corrupt, QStringLiteral("the central directory is larger than the file"));
         return false;
     }
-
-    return readCentralDirectory(m_baseOffset + cdOffset, cdSize, entryCount);
+    m_cdStart = m_baseOffset + cdOffset;
+    m_cdSize = cdSize;
+    m_entryCount = entryCount;
+    return true;
 }
 
-bool ZipReader::findEndOfCentralDirectory(qint64* cdEnd, qint64* cdOffset, qint64* cdSize,
-                                          qint64* entryCount)
+bool ZipReader::findEndOfCentralDirectory(const QByteArray& tail, qint64* cdEnd,
+                                          qint64* cdOffset, qint64* cdSize, qint64* entryCount)
 {
-    const qint64 fileSize = m_file.size();
-    const qint64 searchLen = qMin<qint64>(fileSize, kMaxCommentSize + kEocdFixedSize);
-    if (searchLen < kEocdFixedSize) {
+    const qint64 fileSize = m_archiveSize;
+    if (tail.size() < kEocdFixedSize || tail.size() > fileSize) {
         fail(Status::NotAZip, QStringLiteral("the file is too small to be a ZIP archive"));
         return false;
     }
-
-    m_file.seek(fileSize - searchLen);
-    const QByteArray tail = m_file.read(searchLen);
+    const qint64 tailStart = fileSize - tail.size();
 
     // Backwards, so a file whose *content* happens to contain the signature does
-    // not win over the real record at the end.
+    // not win over the real record at the end. No further back than a comment
+    // can reach: the extra room in the tail is for the ZIP64 records.
+    const int searchFloor = qMax(0, static_cast<int>(tail.size()) - kMaxCommentSize - kEocdFixedSize);
     int found = -1;
-    for (int i = tail.size() - kEocdFixedSize; i >= 0; --i) {
+    for (int i = tail.size() - kEocdFixedSize; i >= searchFloor; --i) {
         if (readU32(tail, i) == kSigEocd) {
             found = i;
             break;
@@ -179,7 +364,7 @@ bool ZipReader::findEndOfCentralDirectory(qint64* cdEnd, qint64* cdOffset, qint6
         return false;
     }
 
-    const qint64 eocdPos = fileSize - searchLen + found;
+    const qint64 eocdPos = tailStart + found;
     *cdEnd = eocdPos;
 
     quint16 diskNumber   = readU16(tail, found + 4);
@@ -192,7 +377,7 @@ bool ZipReader::findEndOfCentralDirectory(qint64* cdEnd, qint64* cdOffset, qint6
     // ZIP64: the locator sits immediately before the EOCD and points at the real
     // record. Looked for whenever it is there, not only when a sentinel appears
     // — some writers emit both forms.
-    const int locatorPos = found - 20;
+    const int locatorPos = found - kZip64LocatorSize;
     if (locatorPos >= 0 && readU32(tail, locatorPos) == kSigZip64Locator) {
         const qint64 zip64Pos = static_cast<qint64>(readU64(tail, locatorPos + 8));
         const quint32 totalDisks = readU32(tail, locatorPos + 16);
@@ -200,12 +385,14 @@ bool ZipReader::findEndOfCentralDirectory(qint64* cdEnd, qint64* cdOffset, qint6
         // The locator's offset is absolute within the archive; for an SFX the
         // shell header shifts it, and the base is not known yet. Both readings
         // are tried, so neither a plain nor an appended archive is refused.
-        for (const qint64 candidate : {zip64Pos, eocdPos - 20 - 56}) {
-            if (candidate < 0 || candidate + 56 > fileSize) {
+        // Either way the record is in the tail: it sits right before the
+        // locator, and only a record somewhere else would need another read.
+        for (const qint64 candidate : {zip64Pos, eocdPos - kZip64LocatorSize - kZip64EocdSize}) {
+            if (candidate < tailStart || candidate + kZip64EocdSize > fileSize) {
                 continue;
             }
-            m_file.seek(candidate);
-            const QByteArray record = m_file.read(56);
+            const QByteArray record =
+                tail.mid(static_cast<int>(candidate - tailStart), kZip64EocdSize);
             if (readU32(record, 0) != kSigZip64Eocd) {
                 continue;
             }
@@ -252,20 +439,9 @@ bool ZipReader::findEndOfCentralDirectory(qint64* cdEnd, qint64* cdOffset, qint6
     return true;
 }
 
-bool ZipReader::readCentralDirectory(qint64 cdStart, qint64 cdSize, qint64 entryCount)
+bool ZipReader::parseCentralDirectory(const QByteArray& cd)
 {
-    if (cdStart < 0 || cdSize < 0 || cdStart + cdSize > m_file.size()) {
-        fail(Status::Corrupt, QStringLiteral("the central directory lies outside the file"));
-        return false;
-    }
-
-    m_file.seek(cdStart);
-    const QByteArray cd = m_file.read(cdSize);
-    if (cd.size() != cdSize) {
-        fail(Status::Corrupt, QStringLiteral("the central directory is truncated"));
-        return false;
-    }
-
+    const qint64 entryCount = m_entryCount;
     int pos = 0;
     for (qint64 i = 0; i < entryCount; ++i) {
         if (pos + kCentralHeaderFixedSize > cd.size() || readU32(cd, pos) != kSigCentralHeader) {
@@ -284,9 +460,15 @@ bool ZipReader::readCentralDirectory(qint64 cdStart, qint64 cdSize, qint64 entry
         entry.compressedSize   = readU32(cd, pos + 20);
         entry.uncompressedSize = readU32(cd, pos + 24);
         entry.localHeaderOffset = readU32(cd, pos + 42);
-        entry.name = QString::fromUtf8(cd.mid(pos + kCentralHeaderFixedSize, nameLen));
+        if (pos + kCentralHeaderFixedSize + nameLen + extraLen > cd.size()) {
+            fail(Status::Corrupt, QStringLiteral("the central directory is malformed"));
+            return false;
+        }
+        const char* name = cd.constData() + pos + kCentralHeaderFixedSize;
+        entry.name = QString::fromUtf8(name, nameLen);
 
-        const QByteArray extra = cd.mid(pos + kCentralHeaderFixedSize + nameLen, extraLen);
+        // A view, not a copy: read where it lies in the directory.
+        const QByteArray extra = QByteArray::fromRawData(name + nameLen, extraLen);
         applyZip64Extra(extra,
                         entry.uncompressedSize == static_cast<qint64>(kZip64Marker32),
                         entry.compressedSize == static_cast<qint64>(kZip64Marker32),
@@ -301,26 +483,81 @@ bool ZipReader::readCentralDirectory(qint64 cdStart, qint64 cdSize, qint64 entry
         entry.isDirectory = entry.name.endsWith('/')
                             || (entry.unixMode & 0170000) == 0040000;
 
+        m_index.insert(entry.name, static_cast<int>(m_entries.size()));
         m_entries.append(entry);
+        m_headerOffsets.append(m_baseOffset + entry.localHeaderOffset);
         pos += kCentralHeaderFixedSize + nameLen + extraLen + commentLen;
     }
+    std::sort(m_headerOffsets.begin(), m_headerOffsets.end());
 
     m_status = Status::Ok;
     return true;
 }
 
-qint64 ZipReader::entryDataOffset(const Entry& entry, QString* error)
+QByteArray ZipReader::readAt(qint64 offset, qint64 size) const
+{
+    if (offset < 0 || offset >= m_fileSize || size <= 0) {
+        return QByteArray();
+    }
+    const qint64 length = qMin(size, m_fileSize - offset);
+    if (length > kMaxReadSize) {
+        return QByteArray();   // short, so every caller already calls it a failure
+    }
+
+    if (m_map) {
+        return QByteArray::fromRawData(reinterpret_cast<const char*>(m_map + offset),
+                                       static_cast<int>(length));
+    }
+
+    QByteArray data(static_cast<int>(length), Qt::Uninitialized);
+    const int fd = m_file.handle();
+    qint64 got = 0;
+    while (got < length) {
+        const ssize_t n = ::pread(fd, data.data() + got, static_cast<size_t>(length - got),
+                                  offset + got);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            break;
+        }
+        got += n;
+    }
+    data.truncate(static_cast<int>(got));
+    return data;
+}
+
+const ZipReader::Entry* ZipReader::findEntry(const QString& name) const
+{
+    const auto found = m_index.constFind(name);
+    return found != m_index.cend() ? &m_entries.at(found.value()) : nullptr;
+}
+
+qint64 ZipReader::entryHeaderOffset(const Entry& entry) const
+{
+    return m_baseOffset + entry.localHeaderOffset;
+}
+
+qint64 ZipReader::entryEnd(const Entry& entry) const
+{
+    // Entries are laid end to end, each header followed by its data and maybe
+    // a data descriptor, so nothing of this one reaches past the next header.
+    const qint64 header = entryHeaderOffset(entry);
+    const auto next = std::upper_bound(m_headerOffsets.cbegin(), m_headerOffsets.cend(), header);
+    return next != m_headerOffsets.cend() ? *next : m_cdStart;
+}
+
+qint64 ZipReader::entryDataOffset(const Entry& entry, QString* error) const
 {
     const qint64 headerPos = m_baseOffset + entry.localHeaderOffset;
-    if (headerPos < 0 || headerPos + kLocalHeaderFixedSize > m_file.size()) {
+    if (headerPos < 0 || headerPos + kLocalHeaderFixedSize > m_fileSize) {
         if (error) {
             *error = QStringLiteral("%1: its local header lies outside the file").arg(entry.name);
         }
         return -1;
     }
 
-    m_file.seek(headerPos);
-    const QByteArray header = m_file.read(kLocalHeaderFixedSize);
+    const QByteArray header = readAt(headerPos, kLocalHeaderFixedSize);
     if (readU32(header, 0) != kSigLocalHeader) {
         if (error) {
             *error = QStringLiteral("%1: no local header where the directory said").arg(entry.name);
@@ -337,7 +574,7 @@ qint64 ZipReader::entryDataOffset(const Entry& entry, QString* error)
     return headerPos + kLocalHeaderFixedSize + nameLen + extraLen;
 }
 
-QByteArray ZipReader::readEntry(const Entry& entry, QString* error)
+QByteArray ZipReader::readEntry(const Entry& entry, QString* error) const
 {
     if (m_status != Status::Ok) {
         if (error) {
@@ -351,8 +588,15 @@ QByteArray ZipReader::readEntry(const Entry& entry, QString* error)
         return QByteArray();
     }
 
-    m_file.seek(dataOffset);
-    const QByteArray raw = m_file.read(entry.compressedSize);
+    // Whole, in memory: an entry this large is one for extractEntry().
+    if (entry.compressedSize > kMaxReadSize || entry.uncompressedSize > kMaxReadSize) {
+        if (error) {
+            *error = QStringLiteral("%1: too large to read into memory").arg(entry.name);
+        }
+        return QByteArray();
+    }
+
+    const QByteArray raw = readAt(dataOffset, entry.compressedSize);
     if (raw.size() != entry.compressedSize) {
         if (error) {
             *error = QStringLiteral("%1: the archive ends mid-entry").arg(entry.name);
@@ -382,7 +626,8 @@ QByteArray ZipReader::readEntry(const Entry& entry, QString* error)
     return out;
 }
 
-bool ZipReader::extractEntry(const Entry& entry, const QString& destPath, QString* error)
+bool ZipReader::extractEntry(const Entry& entry, const QString& destPath, QString* error,
+                             Control* control) const
 {
     if (m_status != Status::Ok) {
         if (error) {
@@ -390,136 +635,127 @@ bool ZipReader::extractEntry(const Entry& entry, const QString& destPath, QStrin
         }
         return false;
     }
-    if (entry.method != 0 && entry.method != 8) {
-        if (error) {
-            *error = QStringLiteral("%1: unsupported compression method %2")
-                         .arg(entry.name).arg(entry.method);
-        }
-        return false;
-    }
-
-    QDir().mkpath(QFileInfo(destPath).absolutePath());
 
     const qint64 dataOffset = entryDataOffset(entry, error);
     if (dataOffset < 0) {
         return false;
     }
 
-    QFile out(destPath);
-    if (!out.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
-        if (error) {
-            *error = QStringLiteral("cannot write %1: %2").arg(destPath, out.errorString());
-        }
-        return false;
+    // Nothing to inflate, and the bytes are already in the page cache: let the
+    // kernel move them. Anything else — and a symlink, which has no file to
+    // copy into — goes through the stream.
+    if (m_map && entry.method == 0 && !destPath.isEmpty()) {
+        return extractStored(entry, dataOffset, destPath, error, control);
     }
 
-    m_file.seek(dataOffset);
-    qint64 remaining = entry.compressedSize;
-    quint32 crc = crc32(0L, nullptr, 0);
-    bool ok = true;
-    QString failure;
-
-    if (entry.method == 0) {
-        QByteArray buffer;
-        while (remaining > 0) {
-            buffer = m_file.read(qMin<qint64>(remaining, kStreamBufferSize));
-            if (buffer.isEmpty()) {
-                ok = false;
-                failure = QStringLiteral("%1: the archive ends mid-entry").arg(entry.name);
-                break;
-            }
-            crc = crc32(crc, reinterpret_cast<const Bytef*>(buffer.constData()), buffer.size());
-            if (out.write(buffer) != buffer.size()) {
-                ok = false;
-                failure = QStringLiteral("cannot write %1: %2").arg(destPath, out.errorString());
-                break;
-            }
-            remaining -= buffer.size();
-        }
-    } else {
-        // Streamed rather than read whole: a GOG installer's payload runs to
-        // gigabytes, and buffering it is the difference between working and
-        // being killed by the OOM reaper.
-        z_stream stream = {};
-        if (inflateInit2(&stream, -15) != Z_OK) {
+    // From the local header, which the stream reads for itself, to the end of
+    // the entry's data. Streamed rather than read whole: a GOG installer's
+    // payload runs to gigabytes, and buffering it is the difference between
+    // working and being killed by the OOM reaper.
+    ZipEntryStream stream(entry, destPath, control ? &control->bytesWritten : nullptr);
+    qint64 position = m_baseOffset + entry.localHeaderOffset;
+    const qint64 end = dataOffset + entry.compressedSize;
+    while (position < end && !stream.atEnd()) {
+        if (control && control->stopRequested()) {
             if (error) {
-                *error = QStringLiteral("%1: could not start decompression").arg(entry.name);
+                *error = QStringLiteral("%1: extraction cancelled").arg(entry.name);
             }
-            return false;
+            return false;   // the stream removes what it wrote
         }
-
-        QByteArray inBuffer;
-        QByteArray outBuffer(kStreamBufferSize, Qt::Uninitialized);
-        int status = Z_OK;
-
-        while (status != Z_STREAM_END) {
-            if (stream.avail_in == 0) {
-                if (remaining <= 0) {
-                    ok = false;
-                    failure = QStringLiteral("%1: the archive ends mid-entry").arg(entry.name);
-                    break;
-                }
-                inBuffer = m_file.read(qMin<qint64>(remaining, kStreamBufferSize));
-                if (inBuffer.isEmpty()) {
-                    ok = false;
-                    failure = QStringLiteral("%1: the archive ends mid-entry").arg(entry.name);
-                    break;
-                }
-                remaining -= inBuffer.size();
-                stream.next_in = reinterpret_cast<Bytef*>(inBuffer.data());
-                stream.avail_in = static_cast<uInt>(inBuffer.size());
-            }
-
-            stream.next_out = reinterpret_cast<Bytef*>(outBuffer.data());
-            stream.avail_out = static_cast<uInt>(outBuffer.size());
-
-            status = inflate(&stream, Z_NO_FLUSH);
-            if (status != Z_OK && status != Z_STREAM_END && status != Z_BUF_ERROR) {
-                ok = false;
-                failure = QStringLiteral("%1: could not be decompressed").arg(entry.name);
-                break;
-            }
-
-            const qint64 produced = outBuffer.size() - static_cast<qint64>(stream.avail_out);
-            if (produced > 0) {
-                crc = crc32(crc, reinterpret_cast<const Bytef*>(outBuffer.constData()),
-                            static_cast<uInt>(produced));
-                if (out.write(outBuffer.constData(), produced) != produced) {
-                    ok = false;
-                    failure = QStringLiteral("cannot write %1: %2").arg(destPath, out.errorString());
-                    break;
-                }
-            }
-            if (status == Z_BUF_ERROR && produced == 0 && stream.avail_in == 0 && remaining <= 0) {
-                ok = false;
-                failure = QStringLiteral("%1: the archive ends mid-entry").arg(entry.name);
-                break;
-            }
+        const QByteArray buffer = readAt(position, qMin<qint64>(end - position, kStreamBufferSize));
+        if (buffer.isEmpty()) {
+            break;          // finish() calls it an entry that ends early
         }
-        inflateEnd(&stream);
+        stream.feed(buffer.constData(), buffer.size());
+        position += buffer.size();
     }
 
-    out.close();
-
-    // A truncated download that still unpacks is worse than one that fails: the
-    // game breaks later, somewhere unrelated, with nothing pointing back here.
-    if (ok && entry.crc != 0 && crc != entry.crc) {
-        ok = false;
-        failure = QStringLiteral("%1: checksum mismatch — the download is damaged").arg(entry.name);
+    const QString failure = stream.finish();
+    if (!failure.isNull()) {
+        if (error) {
+            *error = failure;
+        }
+        return false;
     }
+    return true;
+}
 
-    if (!ok) {
-        out.remove();
+bool ZipReader::extractStored(const Entry& entry, qint64 dataOffset, const QString& destPath,
+                              QString* error, Control* control) const
+{
+    const auto report = [error](const QString& message) {
         if (error) {
-            *error = failure;
+            *error = message;
         }
         return false;
+    };
+
+    if (dataOffset + entry.compressedSize > m_fileSize) {
+        return report(QStringLiteral("%1: the archive ends mid-entry").arg(entry.name));
     }
 
+    // Checked before anything is written, from the mapping, so a damaged entry
+    // never becomes a file even for a moment. Stored means the data is the
+    // content: the CRC over one is the CRC over the other.
+    const char* data = reinterpret_cast<const char*>(m_map + dataOffset);
+    quint32 crc = crc32(0L, nullptr, 0);
+    for (qint64 done = 0; done < entry.compressedSize; done += kCopyPieceSize) {
+        if (control && control->stopRequested()) {
+            return report(QStringLiteral("%1: extraction cancelled").arg(entry.name));
+        }
+        const qint64 piece = qMin(kCopyPieceSize, entry.compressedSize - done);
+        crc = crc32(crc, reinterpret_cast<const Bytef*>(data + done), static_cast<uInt>(piece));
+    }
+    // Compared even when zero, which is not "unknown": an entry written with a
+    // data descriptor has zero only in its local header, and the directory this
+    // came from holds the real value. Zero there is an empty file's CRC.
+    if (crc != entry.crc) {
+        return report(QStringLiteral("%1: checksum mismatch — the download is damaged")
+                          .arg(entry.name));
+    }
+
+    // Under a temporary name, renamed into place once it is all there, for the
+    // same reasons the stream does it: a cancelled or failed entry leaves
+    // nothing behind, and there is no fsync per file as QSaveFile would do.
+    QDir().mkpath(QFileInfo(destPath).absolutePath());
+    QFile out(newTempName(destPath));
+    const auto discard = [&out] {
+        out.close();
+        QFile::remove(out.fileName());
+    };
+    if (!out.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        return report(QStringLiteral("cannot write %1: %2").arg(destPath, out.errorString()));
+    }
+    // Written through the descriptor only, so there is nothing buffered to
+    // flush before it closes.
+    const int outFd = out.handle();
+    for (qint64 done = 0; done < entry.compressedSize;) {
+        if (control && control->stopRequested()) {
+            discard();
+            return report(QStringLiteral("%1: extraction cancelled").arg(entry.name));
+        }
+        const qint64 piece = qMin(kCopyPieceSize, entry.compressedSize - done);
+        if (!copyBytes(m_file.handle(), dataOffset + done, outFd, done, piece)) {
+            const QString reason = QString::fromLocal8Bit(strerror(errno));
+            discard();
+            return report(QStringLiteral("cannot write %1: %2").arg(destPath, reason));
+        }
+        done += piece;
+        if (control) {
+            control->bytesWritten += piece;
+        }
+    }
+    out.close();
     if (entry.isExecutable()) {
-        QFile written(destPath);
-        written.setPermissions(written.permissions() | QFileDevice::ExeOwner
-                               | QFileDevice::ExeGroup | QFileDevice::ExeOther);
+        out.setPermissions(out.permissions() | QFileDevice::ExeOwner
+                           | QFileDevice::ExeGroup | QFileDevice::ExeOther);
+    }
+    // rename(2), which replaces a file already there, as QFile::rename will not.
+    if (std::rename(QFile::encodeName(out.fileName()).constData(),
+                    QFile::encodeName(destPath).constData()) != 0) {
+        const QString reason = QString::fromLocal8Bit(strerror(errno));
+        QFile::remove(out.fileName());
+        return report(QStringLiteral("cannot write %1: %2").arg(destPath, reason));
     }
     return true;
 }
@@ -2,8 +2,13 @@
 #define ZIPREADER_H
 
 #include <QFile>
+#include <QHash>
 #include <QList>
+#include <QMutex>
 #include <QString>
+#include <QWaitCondition>
+
+#include <atomic>
 
 // A read-only ZIP reader, written for GOG's Linux offline installers.
 //
@@ -24,6 +29,25 @@
 // Entry names come off the network, so every one of them goes through
 // GogContentClient::sanitizeDepotPath before it becomes a path on disk — see
 // safeName(). Nothing here writes outside the directory it is given.
+//
+// Once open() has succeeded, reading is const and thread-safe: every read is a
+// pread() at an explicit offset, with no shared seek position, so any number of
+// threads may extract different entries from one reader at once.
+//
+// open() maps the file when it can, and then reads are not even that: the
+// central directory is parsed where it lies, a stored entry is read as a view
+// of the mapping, and extracting one is a copy_file_range() from the installer
+// to its file, which the kernel does without the bytes ever reaching this
+// process. GOG packs much of a game's payload stored — it is already
+// compressed — so for those entries there is no read loop at all. A file that
+// will not map is read through pread() exactly as before.
+//
+// The archive need not be on disk at all. openTail() and openCentralDirectory()
+// take the two pieces of it that describe the rest, fetched however the caller
+// likes, and leave a reader with entries() and entryEnd() but no file: what
+// each entry needs is then a range of the archive, to be fed to a
+// ZipEntryStream as it arrives. That is how GogDownloader installs without the
+// installer ever touching the disk.
 class ZipReader
 {
 public:
@@ -41,6 +65,28 @@ public:
         bool isExecutable() const { return (unixMode & 0111) != 0; }
     };
 
+    // Shared by everything extracting from one archive at once. extractEntry
+    // adds to `bytesWritten` as it writes, waits between buffers while
+    // `paused`, and gives up at its next buffer once `cancelled` is set.
+    //
+    // Set both through the methods: a paused worker sleeps on the condition
+    // until one of them wakes it, rather than polling the flags.
+    struct Control {
+        std::atomic<qint64> bytesWritten{0};
+        std::atomic<bool> paused{false};
+        std::atomic<bool> cancelled{false};
+
+        void setPaused(bool on);
+        void cancel();   // also ends a pause
+
+        // Between buffers: blocks while paused, then whether to give up.
+        bool stopRequested();
+
+    private:
+        QMutex m_mutex;
+        QWaitCondition m_changed;
+    };
+
     enum class Status {
         Ok,
         NotOpen,
@@ -57,6 +103,22 @@ public:
     bool open(const QString& path);
     void close();
 
+    // --- an archive that is somewhere else ---
+
+    // How much of the end of an archive openTail() needs: the EOCD record with
+    // the longest comment it can have, and the ZIP64 records before it.
+    static qint64 maxTailSize();
+
+    // The last min(archiveSize, maxTailSize()) bytes of the archive. On
+    // success, centralDirectoryOffset() and centralDirectorySize() say which
+    // range to fetch for openCentralDirectory(); status() is still NotOpen.
+    bool openTail(qint64 archiveSize, const QByteArray& tail);
+    qint64 centralDirectoryOffset() const { return m_cdStart; }
+    qint64 centralDirectorySize() const { return m_cdSize; }
+    // Finishes what openTail() started. readEntry() and extractEntry() still
+    // need a file, and fail without one.
+    bool openCentralDirectory(const QByteArray& directory);
+
     Status status() const { return m_status; }
     QString errorString() const { return m_error; }
 
@@ -64,21 +126,41 @@ public:
     // archive — that offset is what every other offset has to be measured from.
     qint64 baseOffset() const { return m_baseOffset; }
 
-    QList<Entry> entries() const { return m_entries; }
+    // Valid until the next open() or close(). A reference rather than a copy:
+    // an installer can carry a hundred thousand entries, and callers mostly
+    // just iterate them.
+    const QList<Entry>& entries() const { return m_entries; }
+
+    // The entry with exactly this name, or nullptr. Hashed once when the
+    // directory is parsed, so a lookup does not walk every entry. The pointer
+    // lives as long as entries() does.
+    const Entry* findEntry(const QString& name) const;
 
     // Whole entry in memory. For the small ones — a manifest, a .info file.
-    QByteArray readEntry(const Entry& entry, QString* error = nullptr);
+    // A stored entry of a mapped archive comes back as a view of the mapping,
+    // not a copy: it is valid only while the reader stays open, and a caller
+    // that keeps it longer must detach it first.
+    QByteArray readEntry(const Entry& entry, QString* error = nullptr) const;
 
     // Streamed to disk, because a GOG installer's payload does not fit in RAM.
     // Creates parent directories, applies the executable bit, and verifies the
     // CRC — a truncated download that still unpacks is worse than one that
-    // fails, because the game only breaks later.
-    bool extractEntry(const Entry& entry, const QString& destPath, QString* error = nullptr);
+    // fails, because the game only breaks later. A cancelled or failed entry
+    // leaves no file behind.
+    bool extractEntry(const Entry& entry, const QString& destPath, QString* error = nullptr,
+                      Control* control = nullptr) const;
+
+    // The range of the file an entry occupies: from its local header up to,
+    // not including, entryEnd() — the next entry's header, or the central
+    // directory. Generous by a data descriptor at most, and needs nothing
+    // from the entry's own bytes, so it can be fetched before any are read.
+    qint64 entryHeaderOffset(const Entry& entry) const;
+    qint64 entryEnd(const Entry& entry) const;
 
     // Where this entry's bytes actually begin in the file. Public because the
     // local header's own name and extra lengths decide it, and nothing outside
     // this class can work that out.
-    qint64 entryDataOffset(const Entry& entry, QString* error = nullptr);
+    qint64 entryDataOffset(const Entry& entry, QString* error = nullptr) const;
 
     // The entry's name as a path safely under an install directory, or empty
     // when it escapes. Public so the caller can filter before extracting.
@@ -94,14 +176,30 @@ private:
     // for a classic archive, the ZIP64 record for a ZIP64 one. It is what the
     // archive's base offset is derived from, and using the wrong one is how a
     // ZIP64 self-extracting archive reads as corrupt.
-    bool findEndOfCentralDirectory(qint64* cdEnd, qint64* cdOffset, qint64* cdSize,
-                                   qint64* entryCount);
-    bool readCentralDirectory(qint64 cdStart, qint64 cdSize, qint64 entryCount);
+    bool findEndOfCentralDirectory(const QByteArray& tail, qint64* cdEnd, qint64* cdOffset,
+                                   qint64* cdSize, qint64* entryCount);
+    bool parseTail(qint64 archiveSize, const QByteArray& tail);
+    bool parseCentralDirectory(const QByteArray& directory);
     void fail(Status status, const QString& message);
+    // Up to `size` bytes at `offset` in the file; shorter only at its end. A
+    // view of the mapping when there is one, which is why nothing returned
+    // from here may outlive the reader.
+    QByteArray readAt(qint64 offset, qint64 size) const;
+    // A stored entry straight from the mapping into its file.
+    bool extractStored(const Entry& entry, qint64 dataOffset, const QString& destPath,
+                       QString* error, Control* control) const;
 
     QFile m_file;
+    const uchar* m_map = nullptr;    // the whole file, when it would map
+    qint64 m_fileSize = 0;           // at open; an installer is not rewritten under us
     QList<Entry> m_entries;
+    QHash<QString, int> m_index;     // name to its place in m_entries
+    QList<qint64> m_headerOffsets;   // in the file, sorted; for entryEnd()
     qint64 m_baseOffset = 0;
+    qint64 m_archiveSize = 0;
+    qint64 m_cdStart = 0;            // in the file, not the archive
+    qint64 m_cdSize = 0;
+    qint64 m_entryCount = 0;
     Status m_status = Status::NotOpen;
     QString m_error;
 };
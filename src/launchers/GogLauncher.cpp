@@ -77,6 +77,14 @@ QList<Game> GogLauncher::discoverGames()
     return games;
 }
 
+ILauncher::WatchSet GogLauncher::watchSet() const
+{
+    WatchSet set;
+    set.directories = {GogInstallRegistry::storeDirectory()};
+    set.files = {GogInstallRegistry::filePath()};
+    return set;
+}
+
 bool GogLauncher::refreshGameState(Game& game) const
 {
     const GogInstallRegistry::Entry entry = GogInstallRegistry::instance().entry(game.id());
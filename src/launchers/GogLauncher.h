@@ -25,6 +25,11 @@ public:
     LauncherTraits traits() const override { return {}; }
 
     QList<Game> discoverGames() override;
+
+    // The registry, and the store directory for an install removed by hand.
+    // Either moving is a rediscovery — the default gameAt() — since the list
+    // is one small file away.
+    WatchSet watchSet() const override;
     bool applySettings(const Game& game, const DLSSSettings& settings) override;
     QString getLaunchCommand(const Game& game, const DLSSSettings& settings) override;
     bool isAvailable() const override;
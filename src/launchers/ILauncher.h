@@ -2,7 +2,11 @@
 #define ILAUNCHER_H
 
 #include <QString>
+#include <QStringList>
+#include <QHash>
 #include <QList>
+#include <QPair>
+#include <functional>
 #include "core/Game.h"
 #include "core/DLSSSettings.h"
 
@@ -28,9 +32,37 @@ public:
     // Game discovery
     virtual QList<Game> discoverGames() = 0;
 
+    // Discovery in pieces, for a caller that wants to show games as they are
+    // found rather than once the last one is. `batch`, when set, is called any
+    // number of times, from any thread, each time with games not handed over
+    // before; what is returned is everything, exactly as discoverGames() would
+    // return it. The default finds everything first and hands it over as one
+    // batch, which is right for a launcher that answers from memory.
+    using GameBatchSink = std::function<void(const QList<Game>&)>;
+    virtual QList<Game> discoverGamesIncrementally(const GameBatchSink& batch)
+    {
+        QList<Game> games = discoverGames();
+        if (batch && !games.isEmpty()) {
+            batch(games);
+        }
+        return games;
+    }
+
     // Apply settings to launcher configuration (e.g., write to localconfig.vdf)
     virtual bool applySettings(const Game& game, const DLSSSettings& settings) = 0;
 
+    // Several games' settings at once, true only if every one was applied. A
+    // launcher whose store is one file for all its games overrides this to
+    // write it once; the default applies them in turn.
+    virtual bool applySettingsToAll(const QList<QPair<Game, DLSSSettings>>& changes)
+    {
+        bool all = true;
+        for (const auto& change : changes) {
+            all = applySettings(change.first, change.second) && all;
+        }
+        return all;
+    }
+
     // The launch options this launcher already has stored for a game, if it
     // stores any at all. Empty when it does not.
     virtual QString readLaunchOptions(const Game& game) const
@@ -39,6 +71,21 @@ public:
         return QString();
     }
 
+    // The same for many games at once, by game id, leaving out games with
+    // none — for reports over a whole library. A launcher that keeps them all
+    // in one place answers from one read; the default asks game by game.
+    virtual QHash<QString, QString> readAllLaunchOptions(const QList<Game>& games) const
+    {
+        QHash<QString, QString> options;
+        for (const Game& game : games) {
+            const QString value = readLaunchOptions(game);
+            if (!value.isEmpty()) {
+                options.insert(game.id(), value);
+            }
+        }
+        return options;
+    }
+
     // Re-read whatever install state the launcher keeps on disk and update the
     // game in place; returns true if anything changed. Runs on a worker thread,
     // so implementations must not touch the network or any singleton.
@@ -48,6 +95,45 @@ public:
         return false;
     }
 
+    // Settle what discovery left pending on these games — platformPending(),
+    // today — because finding out was too slow to do while the list was
+    // waiting. Returns the games it changed, settled; the rest are left out.
+    // Runs on a worker thread, under the same rules as refreshGameState().
+    virtual QList<Game> classifyGames(const QList<Game>& games) const
+    {
+        Q_UNUSED(games);
+        return {};
+    }
+
+    // --- watching ---
+    //
+    // What LibraryWatcher needs to follow this launcher's games on disk instead
+    // of re-reading all of them on a timer.
+
+    // Where discovery reads from. `directories` are watched for entries coming
+    // and going; in each, the files matching `filePatterns` are also watched
+    // for their contents. `files` are watched for their contents alone.
+    struct WatchSet {
+        QStringList directories;
+        QStringList filePatterns;
+        QStringList files;
+    };
+    virtual WatchSet watchSet() const { return {}; }
+
+    // What a change at `path` — a watched file, a matching file that came or
+    // went in a watched directory, or a watched directory itself — means for
+    // the list. Updated fills `game` with what discovery would now say about
+    // it; Removed fills in at least its id. Runs on a worker thread, under the
+    // same rules as refreshGameState(). The default is to rediscover, which is
+    // always correct and merely slow.
+    enum class WatchVerdict { Unrelated, Updated, Removed, Rediscover };
+    virtual WatchVerdict gameAt(const QString& path, Game* game) const
+    {
+        Q_UNUSED(path);
+        Q_UNUSED(game);
+        return WatchVerdict::Rediscover;
+    }
+
     // Get launch command string for clipboard/manual use
     virtual QString getLaunchCommand(const Game& game, const DLSSSettings& settings) = 0;
 
@@ -2,6 +2,30 @@
 #include "SteamLauncher.h"
 #include "GogLauncher.h"
 
+#include <QTimer>
+#include <QtConcurrent>
+
+namespace {
+
+// Long enough for a disk to spin up and a large library to be walked; short
+// enough that nobody wonders whether the list is ever coming.
+constexpr int kDefaultDiscoveryTimeoutMs = 20000;
+
+// Identity and traits are stamped here, centrally, rather than by each
+// discoverGames(). One place decides what a game's launcher is called and what
+// it needs from the app, so no two implementations can disagree and none has
+// to remember.
+QList<Game> stamped(QList<Game> games, const QString& name, const LauncherTraits& traits)
+{
+    for (Game& game : games) {
+        game.setLauncher(name);
+        game.setTraits(traits);
+    }
+    return games;
+}
+
+} // namespace
+
 LauncherManager& LauncherManager::instance()
 {
     static LauncherManager instance;
@@ -9,6 +33,7 @@ LauncherManager& LauncherManager::instance()
 }
 
 LauncherManager::LauncherManager()
+    : m_discoveryTimeoutMs(kDefaultDiscoveryTimeoutMs)
 {
     registerBuiltinLaunchers();
     // Seed the change-detection baseline without emitting: nobody is connected
@@ -85,28 +110,157 @@ QList<Game> LauncherManager::discoverAllGames()
     QList<Game> allGames;
 
     for (const auto& launcher : availableLaunchers()) {
-        QList<Game> games = launcher->discoverGames();
+        allGames.append(stamped(launcher->discoverGames(), launcher->name(), launcher->traits()));
+    }
 
-        // Identity and traits are stamped here, centrally, rather than by each
-        // discoverGames(). One place decides what a game's launcher is called
-        // and what it needs from the app, so no two implementations can
-        // disagree and none has to remember.
+    emit gamesDiscovered(allGames);
+    return allGames;
+}
+
+quint64 LauncherManager::discoverAllGamesAsync()
+{
+    const quint64 generation = ++m_discoveryGeneration;
+    m_discoveryOrder.clear();
+    m_discoveryPending.clear();
+    m_discoveryFound.clear();
+    m_discoveryTimedOut.clear();
+    m_discoveryFinished = false;
+
+    for (const auto& launcher : availableLaunchers()) {
         const QString name = launcher->name();
         const LauncherTraits traits = launcher->traits();
-        for (Game& game : games) {
-            game.setLauncher(name);
-            game.setTraits(traits);
+        m_discoveryOrder << name;
+        m_discoveryPending.insert(name);
+        QTimer::singleShot(m_discoveryTimeoutMs, this, [this, generation, name] {
+            onLauncherTimedOut(generation, name);
+        });
+
+        // Still busy with an earlier call: that worker's answer is as fresh as
+        // a new one would be, and asking again would only stack a second
+        // walk of the same sleeping drive behind it.
+        if (m_discoveryRunning.contains(name)) {
+            continue;
+        }
+        m_discoveryRunning.insert(name, generation);
+
+        // The launcher is held by the worker, not borrowed: the registry's copy
+        // is only dropped by resetForTesting(), but a hung worker outlives
+        // anything. The manager itself is a process-lifetime singleton.
+        (void)QtConcurrent::run(&m_discoveryPool, [this, launcher, generation, name, traits] {
+            const QList<Game> games = launcher->discoverGamesIncrementally(
+                [this, generation, name, traits](const QList<Game>& batch) {
+                    const QList<Game> games = stamped(batch, name, traits);
+                    QMetaObject::invokeMethod(this, [this, generation, name, games] {
+                        onLauncherBatch(generation, name, games);
+                    }, Qt::QueuedConnection);
+                });
+            const QList<Game> all = stamped(games, name, traits);
+            QMetaObject::invokeMethod(this, [this, generation, name, all] {
+                onLauncherDiscovered(generation, name, all);
+            }, Qt::QueuedConnection);
+        });
+    }
+
+    // Even with nothing to ask, the answer comes from the event loop, so a
+    // caller can rely on having connected before it arrives.
+    QMetaObject::invokeMethod(this, [this, generation] {
+        finishDiscoveryIfDone(generation);
+    }, Qt::QueuedConnection);
+    return generation;
+}
+
+void LauncherManager::onLauncherBatch(quint64 generation, const QString& name,
+                                      const QList<Game>& games)
+{
+    // Whichever discovery the worker was started for, it is the one answering
+    // for this one. A launcher that has been given up on delivers once, whole,
+    // when it returns; its stragglers would only be counted twice.
+    if (generation < m_discoveryEpoch || !m_discoveryPending.contains(name)) {
+        return;
+    }
+    // Kept as well as shown: if the launcher times out after this, the list
+    // it finishes with must still hold what was already on screen.
+    m_discoveryFound[name].append(games);
+    emit gamesBatchDiscovered(m_discoveryGeneration, games);
+}
+
+void LauncherManager::onLauncherDiscovered(quint64 generation, const QString& name,
+                                           const QList<Game>& games)
+{
+    if (m_discoveryRunning.value(name) == generation) {
+        m_discoveryRunning.remove(name);
+    }
+    if (generation < m_discoveryEpoch) {
+        return;
+    }
+
+    // In time: the whole answer replaces the batches it streamed.
+    if (m_discoveryPending.remove(name)) {
+        m_discoveryFound.insert(name, games);
+        finishDiscoveryIfDone(m_discoveryGeneration);
+        return;
+    }
+
+    // Late. The newest list holds what the launcher streamed before it was
+    // given up on; only the rest is new to it.
+    if (m_discoveryTimedOut.removeAll(name) == 0) {
+        return;
+    }
+    QSet<QString> delivered;
+    for (const Game& game : m_discoveryFound.value(name)) {
+        delivered.insert(game.settingsKey());
+    }
+    QList<Game> missing;
+    for (const Game& game : games) {
+        if (!delivered.contains(game.settingsKey())) {
+            missing << game;
         }
+    }
+    m_discoveryFound.insert(name, games);
+    if (!missing.isEmpty()) {
+        emit gamesBatchDiscovered(m_discoveryGeneration, missing);
+    }
+}
 
-        allGames.append(games);
+void LauncherManager::onLauncherTimedOut(quint64 generation, const QString& name)
+{
+    if (generation != m_discoveryGeneration || !m_discoveryPending.remove(name)) {
+        return;
+    }
+    m_discoveryTimedOut << name;
+    finishDiscoveryIfDone(generation);
+}
+
+void LauncherManager::finishDiscoveryIfDone(quint64 generation)
+{
+    // Once only: the check queued by discoverAllGamesAsync() and the last
+    // launcher's answer can both land here.
+    if (generation != m_discoveryGeneration || m_discoveryFinished
+        || !m_discoveryPending.isEmpty()) {
+        return;
+    }
+    m_discoveryFinished = true;
+
+    QList<Game> allGames;
+    for (const QString& name : m_discoveryOrder) {
+        allGames.append(m_discoveryFound.value(name));
     }
 
     emit gamesDiscovered(allGames);
-    return allGames;
+    emit discoveryFinished(generation, allGames, m_discoveryTimedOut);
 }
 
 void LauncherManager::resetForTesting()
 {
     m_launchers.clear();
     m_available.clear();
+
+    // Whatever is still out there belongs to launchers the test has dropped.
+    m_discoveryEpoch = ++m_discoveryGeneration;
+    m_discoveryRunning.clear();
+    m_discoveryOrder.clear();
+    m_discoveryPending.clear();
+    m_discoveryFound.clear();
+    m_discoveryTimedOut.clear();
+    m_discoveryTimeoutMs = kDefaultDiscoveryTimeoutMs;
 }
@@ -2,9 +2,12 @@
 #define LAUNCHERMANAGER_H
 
 #include <QObject>
+#include <QHash>
 #include <QList>
 #include <QSet>
 #include <QString>
+#include <QStringList>
+#include <QThreadPool>
 #include <memory>
 #include "ILauncher.h"
 #include "core/Game.h"
@@ -36,8 +39,35 @@ public:
     // Only those that can answer right now. Discovery uses this.
     QList<std::shared_ptr<ILauncher>> availableLaunchers() const;
 
+    // Blocking: every available launcher in turn, on the calling thread. For
+    // the CLI and the store dialog, which need the whole list before they can
+    // do anything with it.
     QList<Game> discoverAllGames();
 
+    // The same discovery without holding up the calling thread, which must be
+    // the one this object lives on. Every available launcher runs on a worker
+    // of its own, at once; what each finds arrives as gamesBatchDiscovered() as
+    // it is found, and discoveryFinished() carries the whole list, in registry
+    // order, once the last launcher has answered.
+    //
+    // Or once it has been given up on. A launcher that has not answered within
+    // the discovery timeout is named in discoveryFinished()'s `timedOut`, and
+    // the list carries whatever batches it had streamed by then. A Steam
+    // library on an external drive that has gone to sleep costs the list the
+    // rest of that library, not the list. Its worker cannot be stopped, only
+    // stopped waiting for: when it does answer, the games it found that were
+    // not already in the list arrive as one late gamesBatchDiscovered() of the
+    // newest discovery. A launcher still busy from an earlier call is not asked
+    // again; its running worker answers for this discovery instead, within the
+    // same timeout.
+    //
+    // Returns the generation every signal of this discovery carries. Starting
+    // another supersedes it: the old one's batches and verdict are dropped.
+    quint64 discoverAllGamesAsync();
+
+    // How long discoverAllGamesAsync() waits for any one launcher.
+    void setDiscoveryTimeout(int msec) { m_discoveryTimeoutMs = msec; }
+
     // Re-evaluate ILauncher::isAvailable() across the registry and emit
     // availabilityChanged() only if the set actually moved. Called on refresh
     // and whenever a store's sign-in state changes.
@@ -52,6 +82,9 @@ public:
 
 signals:
     void gamesDiscovered(const QList<Game>& games);
+    void gamesBatchDiscovered(quint64 generation, const QList<Game>& games);
+    void discoveryFinished(quint64 generation, const QList<Game>& games,
+                           const QStringList& timedOut);
     void availabilityChanged();
 
 private:
@@ -63,8 +96,28 @@ private:
     void registerBuiltinLaunchers();
     QSet<QString> currentlyAvailable() const;
 
+    void onLauncherBatch(quint64 generation, const QString& name, const QList<Game>& games);
+    void onLauncherDiscovered(quint64 generation, const QString& name, const QList<Game>& games);
+    void onLauncherTimedOut(quint64 generation, const QString& name);
+    void finishDiscoveryIfDone(quint64 generation);
+
     QList<std::shared_ptr<ILauncher>> m_launchers;
     QSet<QString> m_available;   // names, for change detection only
+
+    // discoverAllGamesAsync()'s state, GUI thread only. The workers touch none
+    // of it; they post back to this object.
+    QThreadPool m_discoveryPool;
+    int m_discoveryTimeoutMs;
+    quint64 m_discoveryGeneration = 0;
+    QStringList m_discoveryOrder;                 // launchers asked, registry order
+    QSet<QString> m_discoveryPending;             // asked, not yet answered or given up on
+    // Per launcher: its streamed batches, then its whole answer in their
+    // place. Kept after the finish, so a late answer only adds what is new.
+    QHash<QString, QList<Game>> m_discoveryFound;
+    QStringList m_discoveryTimedOut;
+    bool m_discoveryFinished = false;
+    QHash<QString, quint64> m_discoveryRunning;   // workers not yet returned -> their generation
+    quint64 m_discoveryEpoch = 0;                 // workers older than this answer nobody
 };
 
 #endif // LAUNCHERMANAGER_H
@@ -0,0 +1,341 @@
+#include "LibraryWatcher.h"
+#include "LauncherManager.h"
+
+#include <QDateTime>
+#include <QDir>
+#include <QFileInfo>
+#include <QFileSystemWatcher>
+#include <QFutureWatcher>
+#include <QTimer>
+#include <QtConcurrent>
+
+namespace {
+
+// Long enough to fold the burst of writes Steam makes while it applies an
+// update into one read, short enough that the badge still feels immediate.
+constexpr int kDefaultSettleMs = 1000;
+
+// The poll only matters where inotify says nothing, and there nothing is
+// urgent: it replaces a 60-second poll that parsed everything with a
+// five-minute one that parses only what it finds changed.
+constexpr int kDefaultPollMs = 5 * 60 * 1000;
+
+struct Job {
+    std::shared_ptr<ILauncher> launcher;
+    QString name;
+    LauncherTraits traits;
+    QStringList paths;
+};
+
+struct Outcome {
+    QList<Game> updated;
+    QStringList removedKeys;
+    bool rediscover = false;
+};
+
+Outcome resolve(const QList<Job>& jobs)
+{
+    QHash<QString, Game> updated;
+    QSet<QString> removed;
+    Outcome outcome;
+
+    for (const Job& job : jobs) {
+        for (const QString& path : job.paths) {
+            Game game;
+            const ILauncher::WatchVerdict verdict = job.launcher->gameAt(path, &game);
+            if (verdict == ILauncher::WatchVerdict::Rediscover) {
+                outcome.rediscover = true;
+                break;   // the rest of this launcher's changes come with it
+            }
+            if (verdict == ILauncher::WatchVerdict::Unrelated) {
+                continue;
+            }
+            // Stamped the way LauncherManager stamps discovery's games, so the
+            // key matches the one the list already has.
+            game.setLauncher(job.name);
+            game.setTraits(job.traits);
+            if (verdict == ILauncher::WatchVerdict::Updated) {
+                updated.insert(game.settingsKey(), game);
+                removed.remove(game.settingsKey());
+            } else {
+                removed.insert(game.settingsKey());
+                updated.remove(game.settingsKey());
+            }
+        }
+    }
+
+    outcome.updated = updated.values();
+    outcome.removedKeys = QStringList(removed.cbegin(), removed.cend());
+    return outcome;
+}
+
+} // namespace
+
+LibraryWatcher::LibraryWatcher(QObject* parent)
+    : QObject(parent)
+    , m_settleTimer(new QTimer(this))
+    , m_pollTimer(new QTimer(this))
+{
+    m_settleTimer->setSingleShot(true);
+    m_settleTimer->setInterval(kDefaultSettleMs);
+    connect(m_settleTimer, &QTimer::timeout, this, &LibraryWatcher::settle);
+
+    m_pollTimer->setInterval(kDefaultPollMs);
+    connect(m_pollTimer, &QTimer::timeout, this, &LibraryWatcher::poll);
+}
+
+LibraryWatcher::~LibraryWatcher() = default;
+
+void LibraryWatcher::setSettleDelay(int msec)
+{
+    m_settleTimer->setInterval(msec);
+}
+
+void LibraryWatcher::setPollInterval(int msec)
+{
+    m_pollTimer->setInterval(msec);
+}
+
+void LibraryWatcher::rewatch()
+{
+    watch(LauncherManager::instance().availableLaunchers());
+}
+
+void LibraryWatcher::watch(const QList<std::shared_ptr<ILauncher>>& launchers)
+{
+    // A fresh watcher rather than a long removePaths(): the old one's paths go
+    // with it, and so does anything it still had queued.
+    delete m_watcher;
+    m_watcher = new QFileSystemWatcher(this);
+    connect(m_watcher, &QFileSystemWatcher::directoryChanged,
+            this, &LibraryWatcher::onDirectoryChanged);
+    connect(m_watcher, &QFileSystemWatcher::fileChanged, this, &LibraryWatcher::onFileChanged);
+
+    m_sources.clear();
+    m_directorySource.clear();
+    m_directoryPatterns.clear();
+    m_listings.clear();
+    m_fileSource.clear();
+    m_fileStamps.clear();
+    m_pending.clear();
+
+    QStringList paths;
+    for (const auto& launcher : launchers) {
+        const int source = m_sources.size();
+        m_sources.append({launcher, launcher->name(), launcher->traits()});
+        const ILauncher::WatchSet set = launcher->watchSet();
+
+        for (const QString& dir : set.directories) {
+            if (!QFileInfo(dir).isDir() || m_directorySource.contains(dir)) {
+                continue;
+            }
+            m_directorySource.insert(dir, source);
+            m_directoryPatterns.insert(dir, set.filePatterns);
+            const Listing listing = listDirectory(dir);
+            m_listings.insert(dir, listing);
+            paths << dir;
+            if (!set.filePatterns.isEmpty()) {
+                for (auto it = listing.constBegin(); it != listing.constEnd(); ++it) {
+                    paths << dir + "/" + it.key();
+                }
+            }
+        }
+
+        for (const QString& file : set.files) {
+            m_fileSource.insert(file, source);
+            m_fileStamps.insert(file, stamp(file));
+            if (QFileInfo::exists(file)) {
+                paths << file;
+            }
+        }
+    }
+
+    // Whatever inotify will not take — out of watches, or a filesystem that
+    // does not do it — the poll still covers.
+    if (!paths.isEmpty()) {
+        m_watcher->addPaths(paths);
+    }
+    if (m_sources.isEmpty()) {
+        m_pollTimer->stop();
+    } else {
+        m_pollTimer->start();
+    }
+}
+
+void LibraryWatcher::poll()
+{
+    for (auto it = m_directorySource.constBegin(); it != m_directorySource.constEnd(); ++it) {
+        rescanDirectory(it.key());
+    }
+
+    for (auto it = m_fileSource.constBegin(); it != m_fileSource.constEnd(); ++it) {
+        const qint64 now = stamp(it.key());
+        if (now != m_fileStamps.value(it.key())) {
+            m_fileStamps.insert(it.key(), now);
+            note(it.key(), it.value());
+            if (now != 0 && m_watcher && !m_watcher->files().contains(it.key())) {
+                m_watcher->addPath(it.key());
+            }
+        }
+    }
+}
+
+void LibraryWatcher::onDirectoryChanged(const QString& dir)
+{
+    rescanDirectory(dir);
+}
+
+void LibraryWatcher::rescanDirectory(const QString& dir)
+{
+    const int source = m_directorySource.value(dir, -1);
+    if (source < 0) {
+        return;
+    }
+
+    const Listing before = m_listings.value(dir);
+    const Listing now = listDirectory(dir);
+    m_listings.insert(dir, now);
+
+    // A library that went away and came back — a drive remounted — is watched
+    // again from here.
+    if (m_watcher && !now.isEmpty() && !m_watcher->directories().contains(dir)) {
+        m_watcher->addPath(dir);
+    }
+
+    if (m_directoryPatterns.value(dir).isEmpty()) {
+        // Watched for its entries alone, and the launcher is told about the
+        // directory rather than about what is in it.
+        if (QSet<QString>(before.keyBegin(), before.keyEnd())
+            != QSet<QString>(now.keyBegin(), now.keyEnd())) {
+            note(dir, source);
+        }
+        return;
+    }
+
+    QStringList arrived;
+    for (auto it = now.constBegin(); it != now.constEnd(); ++it) {
+        const auto was = before.constFind(it.key());
+        if (was == before.constEnd()) {
+            arrived << dir + "/" + it.key();
+            note(dir + "/" + it.key(), source);
+        } else if (was.value() != it.value()) {
+            note(dir + "/" + it.key(), source);
+        }
+    }
+    for (auto it = before.constBegin(); it != before.constEnd(); ++it) {
+        if (!now.contains(it.key())) {
+            note(dir + "/" + it.key(), source);
+        }
+    }
+    if (m_watcher && !arrived.isEmpty()) {
+        m_watcher->addPaths(arrived);
+    }
+}
+
+void LibraryWatcher::onFileChanged(const QString& path)
+{
+    const qint64 now = stamp(path);
+
+    // Compared with what was last seen, here as in the poll, so whichever of
+    // the two gets to a change first is the only one to report it.
+    bool seen = false;
+    int source = m_fileSource.value(path, -1);
+    if (source >= 0) {
+        seen = m_fileStamps.value(path) == now;
+        m_fileStamps.insert(path, now);
+    } else {
+        const QString dir = path.left(path.lastIndexOf('/'));
+        source = m_directorySource.value(dir, -1);
+        if (source < 0) {
+            return;
+        }
+        Listing& listing = m_listings[dir];
+        const QString name = path.mid(dir.size() + 1);
+        seen = listing.value(name) == now;
+        if (now != 0) {
+            listing.insert(name, now);
+        } else {
+            listing.remove(name);
+        }
+    }
+    if (!seen) {
+        note(path, source);
+    }
+
+    // A file replaced by a rename is a new inode, and the watch stayed with
+    // the old one.
+    if (now != 0 && m_watcher && !m_watcher->files().contains(path)) {
+        m_watcher->addPath(path);
+    }
+}
+
+void LibraryWatcher::note(const QString& path, int source)
+{
+    m_pending.insert(path, source);
+    // Not restarted by every change: Steam writing a manifest each second for
+    // the length of an update must not hold the badge back until it stops.
+    if (!m_resolving && !m_settleTimer->isActive()) {
+        m_settleTimer->start();
+    }
+}
+
+void LibraryWatcher::settle()
+{
+    if (m_resolving || m_pending.isEmpty()) {
+        return;
+    }
+
+    QHash<int, QStringList> bySource;
+    for (auto it = m_pending.constBegin(); it != m_pending.constEnd(); ++it) {
+        bySource[it.value()] << it.key();
+    }
+    m_pending.clear();
+
+    QList<Job> jobs;
+    for (auto it = bySource.constBegin(); it != bySource.constEnd(); ++it) {
+        const Source& source = m_sources.at(it.key());
+        jobs.append({source.launcher, source.name, source.traits, it.value()});
+    }
+
+    m_resolving = true;
+    auto* watcher = new QFutureWatcher<Outcome>(this);
+    connect(watcher, &QFutureWatcher<Outcome>::finished, this, [this, watcher]() {
+        const Outcome outcome = watcher->result();
+        watcher->deleteLater();
+        m_resolving = false;
+
+        if (outcome.rediscover) {
+            emit rediscoveryNeeded();
+        }
+        if (!outcome.updated.isEmpty() || !outcome.removedKeys.isEmpty()) {
+            emit gamesChanged(outcome.updated, outcome.removedKeys);
+        }
+        if (!m_pending.isEmpty()) {
+            m_settleTimer->start();
+        }
+    });
+    watcher->setFuture(QtConcurrent::run([jobs]() { return resolve(jobs); }));
+}
+
+LibraryWatcher::Listing LibraryWatcher::listDirectory(const QString& dir) const
+{
+    Listing listing;
+    const QStringList patterns = m_directoryPatterns.value(dir);
+    if (patterns.isEmpty()) {
+        for (const QString& name :
+             QDir(dir).entryList(QDir::Dirs | QDir::Files | QDir::NoDotAndDotDot)) {
+            listing.insert(name, 0);
+        }
+        return listing;
+    }
+    for (const QFileInfo& info : QDir(dir).entryInfoList(patterns, QDir::Files)) {
+        listing.insert(info.fileName(), info.lastModified().toMSecsSinceEpoch());
+    }
+    return listing;
+}
+
+qint64 LibraryWatcher::stamp(const QString& path)
+{
+    const QFileInfo info(path);
+    return info.exists() ? info.lastModified().toMSecsSinceEpoch() : 0;
+}
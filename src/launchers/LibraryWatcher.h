@@ -0,0 +1,104 @@
+#ifndef LIBRARYWATCHER_H
+#define LIBRARYWATCHER_H
+
+#include <QHash>
+#include <QList>
+#include <QObject>
+#include <QSet>
+#include <QString>
+#include <QStringList>
+#include <memory>
+
+#include "ILauncher.h"
+#include "core/Game.h"
+
+class QFileSystemWatcher;
+class QTimer;
+
+// Follows the launchers' files on disk and says precisely what moved.
+//
+// The game list used to find out about updates by copying itself to a worker
+// once a minute, which re-parsed every appmanifest whether anything had changed
+// or not: thousands of VDF parses a minute on a large library, to notice the
+// one game Steam was patching. Here the kernel says which file changed, and
+// only that file is read again.
+//
+// What is watched comes from each launcher's watchSet(), and what a change
+// means from its gameAt(), so nothing in here knows what a manifest is. Changes
+// are collected for a moment before anything is read — Steam rewrites a
+// manifest many times over the course of one update — and then resolved on a
+// worker, a launcher at a time:
+//
+//   gamesChanged() carries the games as discovery would now list them, stamped
+//   with their launcher like any other, and the settingsKey() of those that are
+//   gone. A game the list does not have yet is an addition.
+//
+//   rediscoveryNeeded() is for the changes that cannot be answered one game at
+//   a time: a library added, GOG's registry rewritten.
+//
+// inotify is not everywhere — a library on NFS or SMB changes on another
+// machine and this one is never told — so a slow poll runs underneath. It only
+// stats: directory listings and file mtimes are compared with what was last
+// seen, and only what differs goes down the same path as an event would.
+//
+// GUI thread only. The workers it starts touch nothing but the launchers.
+class LibraryWatcher : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit LibraryWatcher(QObject* parent = nullptr);
+    ~LibraryWatcher() override;
+
+    // Watch every available launcher's watchSet(), replacing whatever was
+    // watched before. Called after each discovery, since a new library or a
+    // new launcher only shows up there.
+    void rewatch();
+
+    // The same, for launchers of the caller's choosing.
+    void watch(const QList<std::shared_ptr<ILauncher>>& launchers);
+
+    // How long changes are collected before they are read, and how often the
+    // fallback poll runs. For tests; the defaults suit a real library.
+    void setSettleDelay(int msec);
+    void setPollInterval(int msec);
+
+    // Run the fallback poll now.
+    void poll();
+
+signals:
+    void gamesChanged(const QList<Game>& updated, const QStringList& removedKeys);
+    void rediscoveryNeeded();
+
+private:
+    struct Source {
+        std::shared_ptr<ILauncher> launcher;
+        QString name;
+        LauncherTraits traits;
+    };
+    using Listing = QHash<QString, qint64>;   // entry name -> mtime, ms
+
+    void onDirectoryChanged(const QString& dir);
+    void onFileChanged(const QString& path);
+    void rescanDirectory(const QString& dir);
+    void note(const QString& path, int source);
+    void settle();
+    Listing listDirectory(const QString& dir) const;
+    static qint64 stamp(const QString& path);
+
+    QFileSystemWatcher* m_watcher = nullptr;
+    QTimer* m_settleTimer;
+    QTimer* m_pollTimer;
+
+    QList<Source> m_sources;
+    QHash<QString, int> m_directorySource;        // watched directory -> source
+    QHash<QString, QStringList> m_directoryPatterns;
+    QHash<QString, Listing> m_listings;           // what each directory held
+    QHash<QString, int> m_fileSource;             // files watched for themselves
+    QHash<QString, qint64> m_fileStamps;
+
+    QHash<QString, int> m_pending;                // changed path -> source
+    bool m_resolving = false;
+};
+
+#endif // LIBRARYWATCHER_H
@@ -0,0 +1,211 @@
+#include "LocalConfigIndex.h"
+#include "parsers/VDFTokenizer.h"
+#include "utils/SteamPaths.h"
+
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QMutexLocker>
+
+namespace {
+
+using TokenType = VDFTokenizer::TokenType;
+
+const char* const kAppsPath[] = {"UserLocalConfigStore", "Software", "Valve", "Steam", "apps"};
+constexpr int kAppsDepth = 5;
+
+bool keyIs(QByteArrayView key, const char* name)
+{
+    return qstrnicmp(key.data(), key.size(), name, qsizetype(qstrlen(name))) == 0;
+}
+
+// From just inside an app's '{' to just past its '}': its own LaunchOptions,
+// the first if Steam ever wrote two, and nothing from its nested blocks.
+bool readApp(VDFTokenizer& tokens, QString* launchOptions, bool* found)
+{
+    while (true) {
+        const VDFTokenizer::Token key = tokens.next();
+        if (key.type == TokenType::CloseBrace) {
+            return true;
+        }
+        if (key.type != TokenType::String) {
+            return false;
+        }
+        const VDFTokenizer::Token value = tokens.next();
+        if (value.type == TokenType::OpenBrace) {
+            if (!tokens.skipBlock()) {
+                return false;
+            }
+        } else if (value.type == TokenType::String) {
+            if (!*found && keyIs(tokens.text(key), "LaunchOptions")) {
+                *launchOptions = VDFTokenizer::decode(tokens.text(value), value.escaped);
+                *found = true;
+            }
+        } else {
+            return false;
+        }
+    }
+}
+
+} // namespace
+
+LocalConfigIndex& LocalConfigIndex::instance()
+{
+    static LocalConfigIndex index{QString()};
+    return index;
+}
+
+LocalConfigIndex::LocalConfigIndex(const QString& userDataPath)
+    : m_userDataPath(userDataPath)
+{
+}
+
+QHash<QString, QString> LocalConfigIndex::parse(QByteArrayView content, QString* error)
+{
+    auto fail = [error](const QString& message) {
+        if (error) {
+            *error = message;
+        }
+        return QHash<QString, QString>();
+    };
+
+    QHash<QString, QString> options;
+    VDFTokenizer tokens(content);
+    // As LocalConfigPatch: levels of kAppsPath we are inside, every other
+    // block skipped whole.
+    int depth = 0;
+
+    while (true) {
+        const VDFTokenizer::Token key = tokens.next();
+        if (key.type == TokenType::EndOfFile) {
+            // Cut short after the apps block is still every answer there is.
+            return options;
+        }
+        if (key.type == TokenType::CloseBrace) {
+            if (depth == 0) {
+                return fail(QStringLiteral("Unexpected '}' at position %1").arg(key.begin));
+            }
+            --depth;
+            continue;
+        }
+        if (key.type != TokenType::String) {
+            return fail(tokens.errorString().isEmpty()
+                            ? QStringLiteral("Expected a key at position %1").arg(key.begin)
+                            : tokens.errorString());
+        }
+
+        const VDFTokenizer::Token value = tokens.next();
+        if (value.type == TokenType::String) {
+            continue;
+        }
+        if (value.type != TokenType::OpenBrace) {
+            return fail(tokens.errorString().isEmpty()
+                            ? QStringLiteral("Expected a value at position %1").arg(value.begin)
+                            : tokens.errorString());
+        }
+
+        const QByteArrayView name = tokens.text(key);
+        if (depth < kAppsDepth && keyIs(name, kAppsPath[depth])) {
+            ++depth;
+            continue;
+        }
+        if (depth == kAppsDepth) {
+            QString launchOptions;
+            bool found = false;
+            if (!readApp(tokens, &launchOptions, &found)) {
+                return fail(tokens.errorString().isEmpty()
+                                ? QStringLiteral("Malformed section for app %1")
+                                      .arg(QString::fromUtf8(name))
+                                : tokens.errorString());
+            }
+            const QString appId = VDFTokenizer::decode(name, key.escaped);
+            if (found && !options.contains(appId)) {
+                options.insert(appId, launchOptions);
+            }
+            continue;
+        }
+        if (!tokens.skipBlock()) {
+            return fail(tokens.errorString());
+        }
+    }
+}
+
+QList<QHash<QString, QString>> LocalConfigIndex::currentOptions()
+{
+    // Asked each time rather than fixed at construction: Steam may not have
+    // been found, or been installed, when the first question came.
+    const QString userData = m_userDataPath.isNull() ? SteamPaths::userDataPath() : m_userDataPath;
+    QList<QHash<QString, QString>> perUser;
+    if (userData.isEmpty()) {
+        return perUser;
+    }
+
+    const QStringList userDirs = QDir(userData).entryList(QDir::Dirs | QDir::NoDotAndDotDot);
+    for (const QString& userId : userDirs) {
+        const QString path = userData + "/" + userId + "/config/localconfig.vdf";
+        const QFileInfo info(path);
+        if (!info.isFile()) {
+            m_files.remove(path);
+            continue;
+        }
+
+        File& file = m_files[path];
+        const qint64 size = info.size();
+        const qint64 mtime = info.lastModified().toMSecsSinceEpoch();
+        if (file.size != size || file.mtime != mtime) {
+            file.size = size;
+            file.mtime = mtime;
+            file.options.clear();
+
+            // A file that will not read counts as one with no options until
+            // it changes, which is what the per-game read made of it too.
+            QFile in(path);
+            if (in.open(QIODevice::ReadOnly)) {
+                QString error;
+                file.options = parse(in.readAll(), &error);
+                if (!error.isEmpty()) {
+                    qWarning("LocalConfigIndex: %s: %s", qUtf8Printable(path), qUtf8Printable(error));
+                }
+            }
+        }
+        perUser.append(file.options);
+    }
+    return perUser;
+}
+
+QString LocalConfigIndex::launchOptions(const QString& appId)
+{
+    if (appId.isEmpty()) {
+        return QString();
+    }
+
+    QMutexLocker locker(&m_mutex);
+    for (const QHash<QString, QString>& options : currentOptions()) {
+        const QString value = options.value(appId);
+        if (!value.isEmpty()) {
+            return value;
+        }
+    }
+    return QString();
+}
+
+QHash<QString, QString> LocalConfigIndex::allLaunchOptions()
+{
+    QMutexLocker locker(&m_mutex);
+    QHash<QString, QString> all;
+    for (const QHash<QString, QString>& options : currentOptions()) {
+        for (auto it = options.constBegin(); it != options.constEnd(); ++it) {
+            if (!it.value().isEmpty() && !all.contains(it.key())) {
+                all.insert(it.key(), it.value());
+            }
+        }
+    }
+    return all;
+}
+
+void LocalConfigIndex::invalidate(const QString& configPath)
+{
+    QMutexLocker locker(&m_mutex);
+    m_files.remove(configPath);
+}
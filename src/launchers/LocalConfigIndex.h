@@ -0,0 +1,69 @@
+#ifndef LOCALCONFIGINDEX_H
+#define LOCALCONFIGINDEX_H
+
+#include <QByteArrayView>
+#include <QHash>
+#include <QList>
+#include <QMutex>
+#include <QString>
+
+// The launch options every Steam user has set, app by app, out of each
+// userdata/<id>/config/localconfig.vdf — read once per version of the file.
+//
+// Asking for one game's options used to mean listing userdata and reading each
+// user's localconfig.vdf, several megabytes apiece, down to that app's block;
+// the next game asked the same of the same files. Here each file is read
+// once, to the end, into app id → LaunchOptions, and kept with its size and
+// mtime. Every question after that costs a directory listing and a stat per
+// user, and a file is only read again when one of the two moves — which is
+// when Steam writes it on exit, or we do.
+//
+// Where more than one user has options for an app, the first user in
+// directory order that has non-empty ones wins, as it always has.
+//
+// Thread-safe.
+class LocalConfigIndex
+{
+public:
+    // Over Steam's userdata directory, wherever that is at the time.
+    static LocalConfigIndex& instance();
+
+    // Over any directory laid out like userdata, for tests. A null path is
+    // Steam's.
+    explicit LocalConfigIndex(const QString& userDataPath);
+
+    LocalConfigIndex(const LocalConfigIndex&) = delete;
+    LocalConfigIndex& operator=(const LocalConfigIndex&) = delete;
+
+    // Empty when no user has any set.
+    QString launchOptions(const QString& appId);
+
+    // Every app any user has options for, in one pass over the users.
+    QHash<QString, QString> allLaunchOptions();
+
+    // Drop what is known about one file, for a writer whose write might not
+    // move its size or mtime far enough to be seen.
+    void invalidate(const QString& configPath);
+
+    // One localconfig.vdf's app id → LaunchOptions. Keys on the way to the
+    // apps block and LaunchOptions itself are matched without regard to case;
+    // blocks off that path are stepped over unread.
+    static QHash<QString, QString> parse(QByteArrayView content, QString* error = nullptr);
+
+private:
+    struct File {
+        qint64 size = -1;
+        qint64 mtime = -1;
+        QHash<QString, QString> options;
+    };
+
+    // What each user's localconfig.vdf holds now, in directory order, reading
+    // only the files that changed. Under the mutex.
+    QList<QHash<QString, QString>> currentOptions();
+
+    QString m_userDataPath;
+    QMutex m_mutex;
+    QHash<QString, File> m_files;   // by path
+};
+
+#endif // LOCALCONFIGINDEX_H
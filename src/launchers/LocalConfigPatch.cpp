@@ -0,0 +1,322 @@
+#include "LocalConfigPatch.h"
+#include "parsers/VDFTokenizer.h"
+
+#include <QFile>
+#include <QList>
+#include <QSaveFile>
+
+#include <algorithm>
+
+namespace {
+
+using TokenType = VDFTokenizer::TokenType;
+
+// Where the apps block is, from the top.
+const char* const kAppsPath[] = {"UserLocalConfigStore", "Software", "Valve", "Steam", "apps"};
+constexpr int kAppsDepth = 5;
+
+struct Edit {
+    qint32 at = 0;
+    qint32 length = 0;      // of what is replaced; 0 for an insertion
+    QByteArray text;
+};
+
+// Escape a value for a VDF quoted string, matching what VDFTokenizer un-escapes.
+QByteArray vdfEscape(const QString& value)
+{
+    const QByteArray utf8 = value.toUtf8();
+    QByteArray out;
+    out.reserve(utf8.size() + 8);
+    for (const char c : utf8) {
+        switch (c) {
+        case '\\': out += "\\\\"; break;
+        case '"':  out += "\\\""; break;
+        case '\n': out += "\\n";  break;
+        case '\t': out += "\\t";  break;
+        default:   out += c;      break;
+        }
+    }
+    return out;
+}
+
+bool keyIs(QByteArrayView key, const char* name)
+{
+    return qstrnicmp(key.data(), key.size(), name, qsizetype(qstrlen(name))) == 0;
+}
+
+qint32 lineStart(const QByteArray& text, qint32 index)
+{
+    return index > 0 ? static_cast<qint32>(text.lastIndexOf('\n', index - 1) + 1) : 0;
+}
+
+// Indentation of the line the given index sits on, so an inserted key lines up
+// with its neighbours instead of standing out.
+QByteArray indentOf(const QByteArray& text, qint32 index)
+{
+    const qint32 start = lineStart(text, index);
+    qint32 i = start;
+    while (i < text.size() && (text.at(i) == '\t' || text.at(i) == ' ')) {
+        ++i;
+    }
+    return text.mid(start, i - start);
+}
+
+// `lines`, each already indented and ending in a newline, put just before
+// the '}' at `close` of the block opened at `open`. On the close's own line
+// when it has one, so the brace keeps its indentation.
+Edit insertBeforeClose(const QByteArray& text, qint32 open, qint32 close, const QByteArray& lines)
+{
+    const qint32 start = lineStart(text, close);
+    bool ownLine = true;
+    for (qint32 i = start; i < close; ++i) {
+        if (text.at(i) != '\t' && text.at(i) != ' ') {
+            ownLine = false;
+            break;
+        }
+    }
+
+    Edit edit;
+    if (ownLine) {
+        edit.at = start;
+        edit.text = lines;
+    } else {
+        edit.at = close;
+        edit.text = "\n" + lines + indentOf(text, open);
+    }
+    return edit;
+}
+
+// What one app's section holds, as far as writing its options goes.
+struct AppSection {
+    qint32 open = 0;
+    qint32 close = 0;
+    QList<VDFTokenizer::Token> launchOptions;   // every one, should Steam repeat it
+};
+
+// From just inside an app's '{' to just past its '}'.
+bool scanApp(VDFTokenizer& tokens, AppSection* section)
+{
+    while (true) {
+        const VDFTokenizer::Token key = tokens.next();
+        if (key.type == TokenType::CloseBrace) {
+            section->close = key.begin;
+            return true;
+        }
+        if (key.type != TokenType::String) {
+            return false;
+        }
+        const VDFTokenizer::Token value = tokens.next();
+        if (value.type == TokenType::OpenBrace) {
+            if (!tokens.skipBlock()) {
+                return false;
+            }
+        } else if (value.type == TokenType::String) {
+            if (keyIs(tokens.text(key), "LaunchOptions")) {
+                section->launchOptions.append(value);
+            }
+        } else {
+            return false;
+        }
+    }
+}
+
+} // namespace
+
+namespace LocalConfigPatch {
+
+bool apply(QByteArray* content, const QHash<QString, QString>& optionsByAppId, QString* error)
+{
+    auto fail = [error](const QString& message) {
+        if (error) {
+            *error = message;
+        }
+        return false;
+    };
+
+    if (optionsByAppId.isEmpty()) {
+        return true;
+    }
+
+    QHash<QByteArray, QString> wanted;
+    for (auto it = optionsByAppId.constBegin(); it != optionsByAppId.constEnd(); ++it) {
+        if (!it.key().isEmpty()) {
+            wanted.insert(it.key().toUtf8(), it.value());
+        }
+    }
+
+    const QByteArray& text = *content;
+    VDFTokenizer tokens(text);
+
+    // Levels of kAppsPath we are inside. Every block off that path is skipped
+    // whole, so this is also the depth.
+    int depth = 0;
+    qint32 appsOpen = -1;
+    qint32 appsClose = -1;
+    QHash<QByteArray, QList<AppSection>> sections;
+
+    while (true) {
+        const VDFTokenizer::Token key = tokens.next();
+        if (key.type == TokenType::EndOfFile) {
+            if (depth != 0) {
+                return fail(QStringLiteral("Unexpected end of file, expected '}'"));
+            }
+            break;
+        }
+        if (key.type == TokenType::CloseBrace) {
+            if (depth == 0) {
+                return fail(QStringLiteral("Unexpected '}' at position %1").arg(key.begin));
+            }
+            if (depth == kAppsDepth && appsClose < 0) {
+                appsClose = key.begin;
+            }
+            --depth;
+            continue;
+        }
+        if (key.type != TokenType::String) {
+            return fail(tokens.errorString().isEmpty()
+                            ? QStringLiteral("Expected a key at position %1").arg(key.begin)
+                            : tokens.errorString());
+        }
+
+        const VDFTokenizer::Token value = tokens.next();
+        if (value.type == TokenType::String) {
+            continue;
+        }
+        if (value.type != TokenType::OpenBrace) {
+            return fail(tokens.errorString().isEmpty()
+                            ? QStringLiteral("Expected a value at position %1").arg(value.begin)
+                            : tokens.errorString());
+        }
+
+        const QByteArrayView name = tokens.text(key);
+        if (depth < kAppsDepth && keyIs(name, kAppsPath[depth])) {
+            ++depth;
+            if (depth == kAppsDepth && appsOpen < 0) {
+                appsOpen = value.begin;
+            }
+            continue;
+        }
+        if (depth == kAppsDepth && wanted.contains(name.toByteArray())) {
+            AppSection section;
+            section.open = value.begin;
+            if (!scanApp(tokens, &section)) {
+                return fail(tokens.errorString().isEmpty()
+                                ? QStringLiteral("Malformed section for app %1")
+                                      .arg(QString::fromUtf8(name))
+                                : tokens.errorString());
+            }
+            sections[name.toByteArray()].append(section);
+            continue;
+        }
+        if (!tokens.skipBlock()) {
+            return fail(tokens.errorString());
+        }
+    }
+
+    if (appsOpen < 0 || appsClose < 0) {
+        return fail(QStringLiteral("No UserLocalConfigStore/Software/Valve/Steam/apps block"));
+    }
+
+    QList<Edit> edits;
+    QByteArray newSections;
+    const QByteArray appIndent = indentOf(text, appsOpen) + "\t";
+
+    // In id order, so new sections come out the same whatever the hash did.
+    QList<QByteArray> appIds = wanted.keys();
+    std::sort(appIds.begin(), appIds.end());
+
+    for (const QByteArray& appId : appIds) {
+        const QByteArray quoted = "\"" + vdfEscape(wanted.value(appId)) + "\"";
+        const auto found = sections.constFind(appId);
+
+        if (found == sections.constEnd()) {
+            newSections += appIndent + "\"" + appId + "\"\n"
+                           + appIndent + "{\n"
+                           + appIndent + "\t\"LaunchOptions\"\t\t" + quoted + "\n"
+                           + appIndent + "}\n";
+            continue;
+        }
+
+        for (const AppSection& section : *found) {
+            if (section.launchOptions.isEmpty()) {
+                const QByteArray line = indentOf(text, section.open) + "\t\"LaunchOptions\"\t\t"
+                                        + quoted + "\n";
+                edits.append(insertBeforeClose(text, section.open, section.close, line));
+                continue;
+            }
+            for (const VDFTokenizer::Token& value : section.launchOptions) {
+                // Quotes and all; a bare value gets them.
+                const bool isQuoted = value.begin > 0 && text.at(value.begin - 1) == '"';
+                Edit edit;
+                edit.at = isQuoted ? value.begin - 1 : value.begin;
+                edit.length = isQuoted ? value.length + 2 : value.length;
+                edit.text = quoted;
+                edits.append(edit);
+            }
+        }
+    }
+    if (!newSections.isEmpty()) {
+        edits.append(insertBeforeClose(text, appsOpen, appsClose, newSections));
+    }
+
+    // Insertions at one spot stay in the order they were made.
+    std::stable_sort(edits.begin(), edits.end(),
+                     [](const Edit& a, const Edit& b) { return a.at < b.at; });
+
+    QByteArray out;
+    qsizetype growth = 0;
+    for (const Edit& edit : edits) {
+        growth += edit.text.size() - edit.length;
+    }
+    out.reserve(text.size() + growth);
+
+    qint32 copied = 0;
+    for (const Edit& edit : edits) {
+        out.append(text.constData() + copied, edit.at - copied);
+        out.append(edit.text);
+        copied = edit.at + edit.length;
+    }
+    out.append(text.constData() + copied, text.size() - copied);
+
+    *content = out;
+    return true;
+}
+
+bool applyToFile(const QString& path, const QHash<QString, QString>& optionsByAppId, QString* error)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        if (error) {
+            *error = "Cannot open file: " + path;
+        }
+        return false;
+    }
+    const QByteArray original = file.readAll();
+    file.close();
+
+    QByteArray content = original;
+    if (!apply(&content, optionsByAppId, error)) {
+        return false;
+    }
+    if (content == original) {
+        return true;
+    }
+
+    QSaveFile out(path);
+    if (!out.open(QIODevice::WriteOnly)) {
+        if (error) {
+            *error = "Cannot write file: " + path;
+        }
+        return false;
+    }
+    out.write(content);
+    if (!out.commit()) {
+        if (error) {
+            *error = "Could not commit file: " + path;
+        }
+        return false;
+    }
+    return true;
+}
+
+} // namespace LocalConfigPatch
@@ -0,0 +1,40 @@
+#ifndef LOCALCONFIGPATCH_H
+#define LOCALCONFIGPATCH_H
+
+#include <QByteArray>
+#include <QHash>
+#include <QString>
+
+// Writing LaunchOptions into a user's localconfig.vdf, for any number of apps
+// in one pass over the file.
+//
+// localconfig.vdf is Steam's file, several megabytes of it, and re-emitting it
+// from a parse tree would mean taking responsibility for every key in it. So
+// the file is read once with VDFTokenizer, only down the path to the apps
+// block and only into the sections of the apps being written — everything
+// else is stepped over by counting braces — and what comes out of that is the
+// byte span of each LaunchOptions value, or where one would go. The edits are
+// spliced into a copy and every other byte is left as it was.
+//
+// Keys on the way down are matched without regard to case: Steam's casing of
+// "Software", "Valve" and "apps" has varied between client versions. App ids
+// are matched exactly. An app with no section yet gets one — Steam only
+// writes a section once there is something in it, so that is the ordinary
+// case for a game whose options were never set.
+namespace LocalConfigPatch {
+
+// Writes each app's options into `content`. False, with `content` untouched,
+// when there is no apps block to write into or the way to it does not parse.
+bool apply(QByteArray* content, const QHash<QString, QString>& optionsByAppId,
+           QString* error = nullptr);
+
+// The same over a file, written through a temporary and renamed over the
+// original — there is no backup, and a half-written localconfig.vdf loses
+// every game's settings rather than one game's. A file that already says what
+// it should is not written at all.
+bool applyToFile(const QString& path, const QHash<QString, QString>& optionsByAppId,
+                 QString* error = nullptr);
+
+} // namespace LocalConfigPatch
+
+#endif // LOCALCONFIGPATCH_H
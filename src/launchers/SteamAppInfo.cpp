@@ -0,0 +1,344 @@
+#include "SteamAppInfo.h"
+#include "network/JsonDiskCache.h"
+#include "parsers/BinaryVDF.h"
+#include "utils/SteamPaths.h"
+
+#include <QDataStream>
+#include <QDateTime>
+#include <QDir>
+#include <QFileInfo>
+#include <QMutexLocker>
+#include <QSaveFile>
+#include <QtEndian>
+
+#include <algorithm>
+
+namespace {
+
+// appinfo.vdf's own magic, one per layout Steam has shipped since 2017:
+//   v27  per app: id, size, state, last update, PICS token, text SHA-1,
+//        change number, then the KeyValues
+//   v28  adds a binary SHA-1 of the KeyValues after the change number
+//   v29  as v28, with keys moved to a string table whose offset follows the
+//        universe in the file header
+constexpr quint32 kMagic27 = 0x07564427;
+constexpr quint32 kMagic28 = 0x07564428;
+constexpr quint32 kMagic29 = 0x07564429;
+
+// Ours, for the index file. Bumped with its layout.
+constexpr char kIndexMagic[4] = {'P', 'F', 'A', 'I'};
+constexpr quint32 kIndexVersion = 1;
+
+QString normalizedPath(QString path)
+{
+    path.replace('\\', '/');
+    while (path.startsWith("./")) {
+        path.remove(0, 2);
+    }
+    return path;
+}
+
+} // namespace
+
+SteamAppInfo& SteamAppInfo::instance()
+{
+    static SteamAppInfo appInfo(SteamPaths::appInfoPath(),
+                                JsonDiskCache::directory("steam") + "/appinfo.index");
+    return appInfo;
+}
+
+SteamAppInfo::SteamAppInfo(const QString& path, const QString& indexPath)
+    : m_path(path)
+    , m_indexPath(indexPath)
+{
+}
+
+bool SteamAppInfo::buildIndex(QByteArrayView file, QHash<quint32, Span>* index,
+                              quint64* stringTableOffset, QString* error)
+{
+    auto fail = [error](const QString& message) {
+        if (error) {
+            *error = message;
+        }
+        return false;
+    };
+
+    if (file.size() < 8) {
+        return fail(QStringLiteral("Not an appinfo.vdf file"));
+    }
+    const char* data = file.data();
+    const quint32 magic = qFromLittleEndian<quint32>(data);
+    if (magic != kMagic27 && magic != kMagic28 && magic != kMagic29) {
+        return fail(QStringLiteral("Unsupported appinfo.vdf version 0x%1").arg(magic, 8, 16, QLatin1Char('0')));
+    }
+
+    qsizetype pos = 8;
+    qsizetype limit = file.size();
+    *stringTableOffset = 0;
+    if (magic == kMagic29) {
+        if (file.size() < 16) {
+            return fail(QStringLiteral("appinfo.vdf header cut short"));
+        }
+        const quint64 tableOffset = qFromLittleEndian<quint64>(data + 8);
+        if (tableOffset < 16 || tableOffset > static_cast<quint64>(file.size())) {
+            return fail(QStringLiteral("appinfo.vdf string table lies outside the file"));
+        }
+        *stringTableOffset = tableOffset;
+        limit = static_cast<qsizetype>(tableOffset);
+        pos = 16;
+    }
+
+    // What sits between an entry's size field and its KeyValues.
+    const qsizetype fixedFields = magic == kMagic27 ? 40 : 60;
+
+    index->clear();
+    while (true) {
+        if (limit - pos < 4) {
+            return fail(QStringLiteral("appinfo.vdf cut short"));
+        }
+        const quint32 appId = qFromLittleEndian<quint32>(data + pos);
+        if (appId == 0) {
+            return true;
+        }
+        if (limit - pos < 8) {
+            return fail(QStringLiteral("appinfo.vdf cut short"));
+        }
+        const quint32 size = qFromLittleEndian<quint32>(data + pos + 4);
+        const qsizetype body = pos + 8;
+        if (size < fixedFields || static_cast<qsizetype>(size) > limit - body) {
+            return fail(QStringLiteral("appinfo.vdf entry for %1 runs past the end").arg(appId));
+        }
+
+        Span span;
+        span.offset = static_cast<quint64>(body + fixedFields);
+        span.size = size - static_cast<quint32>(fixedFields);
+        index->insert(appId, span);
+        pos = body + size;
+    }
+}
+
+QByteArray SteamAppInfo::serializeIndex(qint64 fileSize, qint64 fileMtime,
+                                        quint64 stringTableOffset,
+                                        const QHash<quint32, Span>& index)
+{
+    QByteArray out;
+    out.reserve(36 + index.size() * 16);
+    out.append(kIndexMagic, sizeof kIndexMagic);
+
+    QDataStream stream(&out, QIODevice::Append);
+    stream << kIndexVersion << fileSize << fileMtime << stringTableOffset
+           << static_cast<quint32>(index.size());
+    for (auto it = index.constBegin(); it != index.constEnd(); ++it) {
+        stream << it.key() << it.value().offset << it.value().size;
+    }
+    return out;
+}
+
+bool SteamAppInfo::parseIndex(const QByteArray& data, qint64 fileSize, qint64 fileMtime,
+                              quint64* stringTableOffset, QHash<quint32, Span>* index)
+{
+    if (!data.startsWith(QByteArray(kIndexMagic, sizeof kIndexMagic))) {
+        return false;
+    }
+
+    QDataStream stream(data.mid(sizeof kIndexMagic));
+    quint32 version = 0;
+    qint64 size = 0;
+    qint64 mtime = 0;
+    quint64 tableOffset = 0;
+    quint32 count = 0;
+    stream >> version >> size >> mtime >> tableOffset >> count;
+    if (stream.status() != QDataStream::Ok || version != kIndexVersion
+        || size != fileSize || mtime != fileMtime) {
+        return false;
+    }
+
+    QHash<quint32, Span> entries;
+    entries.reserve(count);
+    for (quint32 i = 0; i < count; ++i) {
+        quint32 appId = 0;
+        Span span;
+        stream >> appId >> span.offset >> span.size;
+        if (stream.status() != QDataStream::Ok
+            || span.offset + span.size > static_cast<quint64>(fileSize)) {
+            return false;
+        }
+        entries.insert(appId, span);
+    }
+
+    *stringTableOffset = tableOffset;
+    *index = entries;
+    return true;
+}
+
+void SteamAppInfo::release()
+{
+    m_indexed = false;
+    m_file.close();
+    m_index.clear();
+    m_keys.clear();
+    m_stringTableOffset = 0;
+}
+
+bool SteamAppInfo::ensureCurrent(QString* error)
+{
+    const QFileInfo info(m_path);
+    if (m_path.isEmpty() || !info.isFile()) {
+        release();
+        m_fileSize = -1;
+        if (error) {
+            *error = QStringLiteral("No appinfo.vdf at %1").arg(m_path);
+        }
+        return false;
+    }
+
+    // A file that would not index stays that way until it changes: every
+    // game discovery asks about must not walk it again.
+    const qint64 size = info.size();
+    const qint64 mtime = info.lastModified().toMSecsSinceEpoch();
+    if (size == m_fileSize && mtime == m_fileMtime) {
+        if (!m_indexed && error) {
+            *error = QStringLiteral("appinfo.vdf is unreadable");
+        }
+        return m_indexed;
+    }
+
+    // Steam wrote a new one: nothing known about the old holds.
+    release();
+    m_fileSize = size;
+    m_fileMtime = mtime;
+
+    auto fail = [this, error](const QString& message) {
+        release();
+        if (error) {
+            *error = message;
+        }
+        return false;
+    };
+
+    m_file.setFileName(m_path);
+    if (size <= 0 || !m_file.open(QIODevice::ReadOnly)) {
+        return fail(QStringLiteral("Cannot open %1").arg(m_path));
+    }
+
+    // The whole file only when there is no index for it, and only for as long
+    // as the walk takes.
+    QByteArray whole;
+    bool indexed = false;
+    QFile saved(m_indexPath);
+    if (saved.open(QIODevice::ReadOnly)) {
+        indexed = parseIndex(saved.readAll(), size, mtime, &m_stringTableOffset, &m_index);
+    }
+    if (!indexed) {
+        whole = m_file.read(size);
+        if (whole.size() != size) {
+            return fail(QStringLiteral("Cannot read %1").arg(m_path));
+        }
+        QString why;
+        if (!buildIndex(whole, &m_index, &m_stringTableOffset, &why)) {
+            return fail(why);
+        }
+        // Best effort, like every cache here: without it the next run walks
+        // the file again and is otherwise none the worse.
+        QDir().mkpath(QFileInfo(m_indexPath).absolutePath());
+        QSaveFile out(m_indexPath);
+        if (out.open(QIODevice::WriteOnly)) {
+            out.write(serializeIndex(size, mtime, m_stringTableOffset, m_index));
+            out.commit();
+        }
+    }
+
+    if (m_stringTableOffset >= static_cast<quint64>(size)) {
+        return fail(QStringLiteral("appinfo.vdf string table lies outside the file"));
+    }
+    if (m_stringTableOffset > 0) {
+        const qint64 tableOffset = static_cast<qint64>(m_stringTableOffset);
+        QByteArray table;
+        if (!whole.isEmpty()) {
+            table = whole.sliced(tableOffset);
+        } else if (m_file.seek(tableOffset)) {
+            table = m_file.read(size - tableOffset);
+        }
+        m_keys = BinaryVDF::parseStringTable(table);
+        if (m_keys.isEmpty()) {
+            return fail(QStringLiteral("appinfo.vdf string table is unreadable"));
+        }
+    }
+    m_indexed = true;
+    return true;
+}
+
+bool SteamAppInfo::contains(quint32 appId)
+{
+    QMutexLocker locker(&m_mutex);
+    return ensureCurrent(nullptr) && m_index.contains(appId);
+}
+
+VDFNode SteamAppInfo::appSection(quint32 appId, QString* error)
+{
+    QMutexLocker locker(&m_mutex);
+    if (!ensureCurrent(error)) {
+        return VDFNode();
+    }
+    const auto it = m_index.constFind(appId);
+    if (it == m_index.constEnd()) {
+        if (error) {
+            *error = QStringLiteral("App %1 is not in appinfo.vdf").arg(appId);
+        }
+        return VDFNode();
+    }
+    if (it->offset + it->size > static_cast<quint64>(m_fileSize)) {
+        if (error) {
+            *error = QStringLiteral("App %1 lies outside appinfo.vdf").arg(appId);
+        }
+        return VDFNode();
+    }
+
+    QByteArray bytes;
+    if (m_file.seek(static_cast<qint64>(it->offset))) {
+        bytes = m_file.read(it->size);
+    }
+    if (bytes.size() != static_cast<qsizetype>(it->size)) {
+        if (error) {
+            *error = QStringLiteral("Cannot read app %1 from appinfo.vdf").arg(appId);
+        }
+        return VDFNode();
+    }
+    VDFNode root;
+    if (!BinaryVDF::parse(bytes, &root, error, m_keys)) {
+        return VDFNode();
+    }
+    return root.child("appinfo");
+}
+
+QString SteamAppInfo::appType(quint32 appId)
+{
+    return appSection(appId).child("common").getString("type").toLower();
+}
+
+QList<SteamAppInfo::LaunchEntry> SteamAppInfo::launchEntries(quint32 appId)
+{
+    const QMap<QString, VDFNode> launch = appSection(appId).child("config").child("launch").children();
+
+    // Keyed "0", "1", ... "10": the map's string order is not Steam's.
+    QList<QPair<int, VDFNode>> ordered;
+    for (auto it = launch.constBegin(); it != launch.constEnd(); ++it) {
+        ordered.append({it.key().toInt(), it.value()});
+    }
+    std::stable_sort(ordered.begin(), ordered.end(),
+                     [](const auto& a, const auto& b) { return a.first < b.first; });
+
+    QList<LaunchEntry> entries;
+    for (const auto& keyed : ordered) {
+        const VDFNode& node = keyed.second;
+        LaunchEntry entry;
+        entry.executable = normalizedPath(node.getString("executable"));
+        entry.arguments = node.getString("arguments");
+        entry.workingDir = normalizedPath(node.getString("workingdir"));
+        entry.type = node.getString("type").toLower();
+        entry.osList = node.child("config").getString("oslist").toLower();
+        entry.description = node.getString("description");
+        entries.append(entry);
+    }
+    return entries;
+}
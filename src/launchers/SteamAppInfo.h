@@ -0,0 +1,100 @@
+#ifndef STEAMAPPINFO_H
+#define STEAMAPPINFO_H
+
+#include <QByteArray>
+#include <QFile>
+#include <QHash>
+#include <QList>
+#include <QMutex>
+#include <QString>
+
+#include "parsers/VDFParser.h"
+
+// What Steam itself knows about every app, out of appcache/appinfo.vdf: its
+// type, the OSes it ships for, and the launch entries the Play button picks
+// from — executable, arguments and working directory per OS.
+//
+// The file is binary and often over 100 MB, and nobody wants more than one app
+// of it at a time. So it is never parsed whole. Once per version of the file,
+// the entry headers are walked — an app id and a length each, skipped over
+// without decoding what is between — into an index of where each app's data
+// lies. The index is kept under the cache directory, keyed by the file's size
+// and mtime, so the walk is paid once per Steam restart rather than once per
+// run. After that, asking about an app decodes that app's few kilobytes and
+// nothing else.
+//
+// The file is read, never mapped: Steam rewrites it in place while it runs,
+// and a mapping of a file that shrinks underneath is a SIGBUS where a read is
+// only short. The walk reads it whole once and lets go of the copy; a lookup
+// reads its app's span and nothing else. The index is rebuilt whenever the
+// file's size or mtime moves, which is checked on every lookup, and a span
+// read while Steam was writing fails to decode rather than decoding wrong.
+//
+// Thread-safe; discovery asks from its worker threads.
+class SteamAppInfo
+{
+public:
+    struct LaunchEntry {
+        QString executable;   // relative to the install directory, '/'-separated
+        QString arguments;
+        QString workingDir;
+        QString type;         // "default", "option1", "none", ...
+        QString osList;       // "windows", "linux", "macos", or empty for any
+        QString description;
+    };
+
+    struct Span {
+        quint64 offset = 0;   // of the app's KeyValues data
+        quint32 size = 0;
+    };
+
+    // Over <Steam root>/appcache/appinfo.vdf, the index in the cache directory.
+    static SteamAppInfo& instance();
+
+    // Over any file, for tests.
+    SteamAppInfo(const QString& path, const QString& indexPath);
+
+    SteamAppInfo(const SteamAppInfo&) = delete;
+    SteamAppInfo& operator=(const SteamAppInfo&) = delete;
+
+    bool contains(quint32 appId);
+
+    // The app's "appinfo" block — common, config, extended, depots — or an
+    // empty node when the app is unknown or the file unreadable.
+    VDFNode appSection(quint32 appId, QString* error = nullptr);
+
+    // common/type, lower-cased: "game", "tool", "config", "application", ...
+    QString appType(quint32 appId);
+
+    // config/launch, in Steam's order.
+    QList<LaunchEntry> launchEntries(quint32 appId);
+
+    // The index, from the file's bytes: where each app's data lies, and the
+    // string table's offset for a v29 file (0 before). False on a file that
+    // is not appinfo.vdf or is cut short.
+    static bool buildIndex(QByteArrayView file, QHash<quint32, Span>* index,
+                           quint64* stringTableOffset, QString* error);
+
+    static QByteArray serializeIndex(qint64 fileSize, qint64 fileMtime, quint64 stringTableOffset,
+                                     const QHash<quint32, Span>& index);
+    static bool parseIndex(const QByteArray& data, qint64 fileSize, qint64 fileMtime,
+                           quint64* stringTableOffset, QHash<quint32, Span>* index);
+
+private:
+    bool ensureCurrent(QString* error);
+    void release();
+
+    QString m_path;
+    QString m_indexPath;
+
+    QMutex m_mutex;
+    QFile m_file;
+    bool m_indexed = false;
+    qint64 m_fileSize = -1;      // what the index is of
+    qint64 m_fileMtime = -1;
+    quint64 m_stringTableOffset = 0;
+    QList<QByteArray> m_keys;
+    QHash<quint32, Span> m_index;
+};
+
+#endif // STEAMAPPINFO_H
@@ -0,0 +1,177 @@
+#include "SteamClassificationCache.h"
+#include "network/JsonDiskCache.h"
+
+#include <QDateTime>
+#include <QDir>
+#include <QDirIterator>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QMutexLocker>
+#include <QSaveFile>
+
+namespace {
+
+// Bumped when what a verdict means changes, so an old file is a clean miss
+// rather than a wrong answer.
+constexpr int kFormatVersion = 1;
+
+} // namespace
+
+SteamClassificationCache& SteamClassificationCache::instance()
+{
+    static SteamClassificationCache cache(filePath());
+    return cache;
+}
+
+SteamClassificationCache::SteamClassificationCache(const QString& path)
+    : m_path(path)
+{
+}
+
+QString SteamClassificationCache::filePath()
+{
+    return JsonDiskCache::directory("steam") + "/platforms.json";
+}
+
+QHash<QString, SteamClassificationCache::Entry> SteamClassificationCache::parse(const QByteArray& json)
+{
+    QHash<QString, Entry> entries;
+    const QJsonObject root = QJsonDocument::fromJson(json).object();
+    if (root.value("version").toInt() != kFormatVersion) {
+        return entries;
+    }
+
+    const QJsonObject apps = root.value("apps").toObject();
+    for (auto it = apps.constBegin(); it != apps.constEnd(); ++it) {
+        const QJsonObject app = it.value().toObject();
+        if (it.key().isEmpty() || !app.contains("native")) {
+            continue;
+        }
+        Entry entry;
+        // Doubles in JSON; both fit in the 53 bits a double holds exactly.
+        entry.buildId = static_cast<qint64>(app.value("buildId").toDouble());
+        entry.dirStamp = static_cast<qint64>(app.value("dirStamp").toDouble());
+        entry.nativeLinux = app.value("native").toBool();
+        entries.insert(it.key(), entry);
+    }
+    return entries;
+}
+
+QByteArray SteamClassificationCache::serialize(const QHash<QString, Entry>& entries)
+{
+    QJsonObject apps;
+    for (auto it = entries.constBegin(); it != entries.constEnd(); ++it) {
+        QJsonObject app;
+        app["buildId"] = static_cast<double>(it.value().buildId);
+        app["dirStamp"] = static_cast<double>(it.value().dirStamp);
+        app["native"] = it.value().nativeLinux;
+        apps[it.key()] = app;
+    }
+
+    QJsonObject root;
+    root["version"] = kFormatVersion;
+    root["apps"] = apps;
+    return QJsonDocument(root).toJson(QJsonDocument::Compact);
+}
+
+bool SteamClassificationCache::hasWindowsExecutables(const QString& installPath)
+{
+    if (installPath.isEmpty() || !QDir(installPath).exists()) {
+        return false;
+    }
+    QDirIterator it(installPath, {"*.exe"}, QDir::Files, QDirIterator::Subdirectories);
+    return it.hasNext();
+}
+
+qint64 SteamClassificationCache::directoryStamp(const QString& installPath)
+{
+    const QFileInfo info(installPath);
+    if (!info.isDir()) {
+        return 0;
+    }
+    return info.lastModified().toMSecsSinceEpoch();
+}
+
+void SteamClassificationCache::ensureLoaded() const
+{
+    if (m_loaded) {
+        return;
+    }
+    m_loaded = true;
+    QFile file(m_path);
+    if (file.open(QIODevice::ReadOnly)) {
+        m_entries = parse(file.readAll());
+    }
+}
+
+bool SteamClassificationCache::lookup(const QString& appId, qint64 buildId, qint64 dirStamp,
+                                      bool* nativeLinux) const
+{
+    if (dirStamp == 0) {
+        return false;
+    }
+    QMutexLocker locker(&m_mutex);
+    ensureLoaded();
+    const auto it = m_entries.constFind(appId);
+    if (it == m_entries.constEnd() || it->buildId != buildId || it->dirStamp != dirStamp) {
+        return false;
+    }
+    if (nativeLinux) {
+        *nativeLinux = it->nativeLinux;
+    }
+    return true;
+}
+
+bool SteamClassificationCache::lastKnown(const QString& appId, bool* nativeLinux) const
+{
+    QMutexLocker locker(&m_mutex);
+    ensureLoaded();
+    const auto it = m_entries.constFind(appId);
+    if (it == m_entries.constEnd()) {
+        return false;
+    }
+    if (nativeLinux) {
+        *nativeLinux = it->nativeLinux;
+    }
+    return true;
+}
+
+void SteamClassificationCache::store(const QString& appId, qint64 buildId, qint64 dirStamp,
+                                     bool nativeLinux)
+{
+    if (appId.isEmpty()) {
+        return;
+    }
+    QMutexLocker locker(&m_mutex);
+    ensureLoaded();
+    Entry& entry = m_entries[appId];
+    if (entry.buildId == buildId && entry.dirStamp == dirStamp
+        && entry.nativeLinux == nativeLinux) {
+        return;
+    }
+    entry.buildId = buildId;
+    entry.dirStamp = dirStamp;
+    entry.nativeLinux = nativeLinux;
+    m_dirty = true;
+}
+
+bool SteamClassificationCache::save()
+{
+    QMutexLocker locker(&m_mutex);
+    if (!m_dirty) {
+        return true;
+    }
+    QDir().mkpath(QFileInfo(m_path).absolutePath());
+    QSaveFile file(m_path);
+    if (!file.open(QIODevice::WriteOnly)) {
+        return false;
+    }
+    file.write(serialize(m_entries));
+    if (!file.commit()) {
+        return false;
+    }
+    m_dirty = false;
+    return true;
+}
@@ -0,0 +1,89 @@
+#ifndef STEAMCLASSIFICATIONCACHE_H
+#define STEAMCLASSIFICATIONCACHE_H
+
+#include <QByteArray>
+#include <QHash>
+#include <QMutex>
+#include <QString>
+
+// Whether each installed Steam game is native Linux or Windows, remembered
+// between runs.
+//
+// Steam's manifest does not say. What discovery used to do instead was walk the
+// whole install directory looking for a single .exe — which for a Windows game
+// usually ends a few entries in, and for a large native one means stat'ing
+// tens of thousands of files, on every start and every Refresh, to arrive at
+// the answer it arrived at last time. The answer only changes when the files
+// do, so it is kept here, keyed by what moves when they do:
+//
+//   the build id, which Steam bumps on every update it applies, and
+//   the install directory's mtime, which moves when something at its top
+//     level is added or removed behind Steam's back — a mod, a manual copy.
+//
+// An entry that matches both is the answer, at the cost of one stat. One that
+// does not is still the best guess available until the walk has been redone,
+// which SteamLauncher leaves to a background pass rather than to discovery.
+//
+// Thread-safe: discovery consults it from several workers at once.
+class SteamClassificationCache
+{
+public:
+    struct Entry {
+        qint64 buildId = 0;
+        qint64 dirStamp = 0;      // install directory mtime, ms since the epoch
+        bool nativeLinux = false;
+    };
+
+    // The one under the cache directory. Others, at a path of the caller's
+    // choosing, are for tests.
+    static SteamClassificationCache& instance();
+    explicit SteamClassificationCache(const QString& path);
+
+    static QString filePath();
+
+    // --- pure, so the format is testable without a filesystem ---
+
+    static QHash<QString, Entry> parse(const QByteArray& json);
+    static QByteArray serialize(const QHash<QString, Entry>& entries);
+
+    // --- the expensive part, and the cheap one ---
+
+    // The walk itself: true when there is an .exe anywhere under `installPath`.
+    // A directory that does not exist has none.
+    static bool hasWindowsExecutables(const QString& installPath);
+
+    // The install directory's mtime, or 0 when it cannot be stat'ed.
+    static qint64 directoryStamp(const QString& installPath);
+
+    // --- state ---
+
+    // True, with `nativeLinux` set, when `appId` was classified at this build
+    // and this stamp. A stamp of 0 never matches: a directory that could not be
+    // stat'ed is not known to be unchanged.
+    bool lookup(const QString& appId, qint64 buildId, qint64 dirStamp, bool* nativeLinux) const;
+
+    // Whatever was last decided for `appId`, at any build. False when nothing
+    // ever was.
+    bool lastKnown(const QString& appId, bool* nativeLinux) const;
+
+    void store(const QString& appId, qint64 buildId, qint64 dirStamp, bool nativeLinux);
+
+    // Writes the file when anything was stored since the last save. Best
+    // effort, like every other cache here: a failed write costs a walk next
+    // time, not a wrong answer.
+    bool save();
+
+private:
+    SteamClassificationCache(const SteamClassificationCache&) = delete;
+    SteamClassificationCache& operator=(const SteamClassificationCache&) = delete;
+
+    void ensureLoaded() const;
+
+    QString m_path;
+    mutable QMutex m_mutex;
+    mutable bool m_loaded = false;
+    mutable QHash<QString, Entry> m_entries;
+    bool m_dirty = false;
+};
+
+#endif // STEAMCLASSIFICATIONCACHE_H
@@ -1,15 +1,21 @@
 #include "SteamLauncher.h"
 #include "SteamStoreService.h"
-#include "parsers/VDFParser.h"
+#include "SteamAppInfo.h"
+#include "SteamClassificationCache.h"
+#include "LocalConfigIndex.h"
+#include "LocalConfigPatch.h"
+#include "parsers/VDFQuery.h"
 #include "utils/EnvBuilder.h"
 #include "utils/SteamPaths.h"
 #include <QDir>
 #include <QFile>
-#include <QSaveFile>
 #include <QFileInfo>
+#include <QHash>
+#include <QMutex>
+#include <QMutexLocker>
 #include <QRegularExpression>
-#include <QTextStream>
-#include <QDirIterator>
+#include <QThread>
+#include <QThreadPool>
 
 namespace {
 
@@ -23,6 +29,43 @@ bool updatePending(int stateFlags)
     return (stateFlags & kStateUpdateRequired) != 0;
 }
 
+// Manifests per slice: one slice is one task on discovery's pool and one batch
+// handed to the caller. Small enough that the first games show up at once, big
+// enough that a 1,500-game library is not 1,500 trips to the GUI thread.
+constexpr int kManifestsPerSlice = 32;
+
+// Discovery is waiting on disks far more than on the CPU, so the pool is not
+// sized by cores alone; but every thread is another seek on the same HDD.
+constexpr int kMinDiscoveryThreads = 4;
+constexpr int kMaxDiscoveryThreads = 8;
+
+// Steam's own tools and runtimes, installed like games and listed in the same
+// manifests, but nothing anyone wants to configure DLSS for.
+bool isSteamTool(const Game& game)
+{
+    // Steam says so itself when its appinfo is at hand; the names below are
+    // for when it is not.
+    const QString type = SteamAppInfo::instance().appType(game.id().toUInt());
+    if (type == "tool" || type == "config") {
+        return true;
+    }
+
+    static const QStringList filterPatterns = {
+        "Steamworks Common Redistributables",
+        "Steam Linux Runtime",
+        "Proton",
+        "SteamVR",
+        "Steam Audio",
+        "Steamworks Shared"
+    };
+    for (const QString& pattern : filterPatterns) {
+        if (game.name().contains(pattern, Qt::CaseInsensitive)) {
+            return true;
+        }
+    }
+    return false;
+}
+
 } // namespace
 
 SteamLauncher::SteamLauncher()
@@ -60,6 +103,19 @@ QString SteamLauncher::readLaunchOptions(const Game& game) const
     return readLaunchOptions(game.id());
 }
 
+QHash<QString, QString> SteamLauncher::readAllLaunchOptions(const QList<Game>& games) const
+{
+    const QHash<QString, QString> all = readAllLaunchOptions();
+    QHash<QString, QString> options;
+    for (const Game& game : games) {
+        const auto it = all.constFind(game.id());
+        if (it != all.constEnd()) {
+            options.insert(game.id(), it.value());
+        }
+    }
+    return options;
+}
+
 bool SteamLauncher::refreshGameState(Game& game) const
 {
     return checkUpdateStatus(game);
@@ -87,27 +143,18 @@ QStringList SteamLauncher::libraryPaths()
         paths << defaultPath;
     }
 
-    // Parse libraryfolders.vdf for additional library folders
-    QString libraryFoldersPath = defaultPath + "/libraryfolders.vdf";
-    VDFParser parser;
-    if (parser.parseFile(libraryFoldersPath)) {
-        VDFNode root = parser.root();
-
-        // libraryfolders.vdf structure:
-        // "libraryfolders" { "0" { "path" "..." } "1" { "path" "..." } ... }
-        if (root.hasChild("libraryfolders")) {
-            VDFNode folders = root.child("libraryfolders");
-            for (auto it = folders.children().constBegin(); it != folders.children().constEnd(); ++it) {
-                // Keys are numeric indices
-                bool isNumber;
-                it.key().toInt(&isNumber);
-                if (isNumber && it.value().hasChild("path")) {
-                    QString libPath = it.value().getString("path");
-                    QString steamApps = libPath + "/steamapps";
-                    if (QDir(steamApps).exists() && !paths.contains(steamApps)) {
-                        paths << steamApps;
-                    }
-                }
+    // Parse libraryfolders.vdf for additional library folders:
+    // "libraryfolders" { "0" { "path" "..." "apps" { ... } } "1" { ... } ... }
+    // Only the paths are read; each library's "apps" list is stepped over.
+    // A path is only ever found inside a numbered library block — the other
+    // keys at that level (ContentStatsID and the like) are plain values.
+    const QString libraryFoldersPath = defaultPath + "/libraryfolders.vdf";
+    VDFQuery folders({"libraryfolders/*/path"});
+    if (folders.runFile(libraryFoldersPath)) {
+        for (const QString& libPath : folders.values("libraryfolders/*/path")) {
+            const QString steamApps = libPath + "/steamapps";
+            if (QDir(steamApps).exists() && !paths.contains(steamApps)) {
+                paths << steamApps;
             }
         }
     }
@@ -117,45 +164,80 @@ QStringList SteamLauncher::libraryPaths()
 
 QList<Game> SteamLauncher::discoverGames()
 {
-    QList<Game> games;
-    QStringList libraries = libraryPaths();
-
-    // Filter patterns for non-game apps
-    QStringList filterPatterns = {
-        "Steamworks Common Redistributables",
-        "Steam Linux Runtime",
-        "Proton",
-        "SteamVR",
-        "Steam Audio",
-        "Steamworks Shared"
-    };
+    // Nobody is coming back for what discovery left pending, so it is settled
+    // before returning.
+    QList<Game> games = discoverGamesIncrementally(nullptr);
+    QList<Game> pending;
+    for (const Game& game : games) {
+        if (game.platformPending()) {
+            pending << game;
+        }
+    }
+    if (pending.isEmpty()) {
+        return games;
+    }
 
-    for (const QString& libraryPath : libraries) {
-        QDir dir(libraryPath);
-        QStringList manifests = dir.entryList({"appmanifest_*.acf"}, QDir::Files);
+    QHash<QString, Game> settled;
+    for (const Game& game : classifyGames(pending)) {
+        settled.insert(game.id(), game);
+    }
+    for (Game& game : games) {
+        game = settled.value(game.id(), game);
+    }
+    return games;
+}
 
-        for (const QString& manifest : manifests) {
-            QString manifestPath = libraryPath + "/" + manifest;
-            Game game = parseAppManifest(manifestPath, libraryPath);
+QList<Game> SteamLauncher::discoverGamesIncrementally(const GameBatchSink& batch)
+{
+    const QStringList libraries = libraryPaths();
 
-            if (game.id().isEmpty() || game.name().isEmpty()) {
-                continue;
-            }
+    // A pool of discovery's own rather than the global one: a library on a
+    // disk that is still spinning up holds its thread for seconds, and the
+    // global pool is where the image cache and the update checks run.
+    QThreadPool pool;
+    pool.setMaxThreadCount(qBound(kMinDiscoveryThreads, QThread::idealThreadCount(),
+                                  kMaxDiscoveryThreads));
 
-            // Filter out Steam tools and runtimes
-            bool shouldFilter = false;
-            for (const QString& pattern : filterPatterns) {
-                if (game.name().contains(pattern, Qt::CaseInsensitive)) {
-                    shouldFilter = true;
-                    break;
-                }
-            }
+    QMutex mutex;
+    QList<Game> games;
+    auto deliver = [&mutex, &games, &batch](const QList<Game>& found) {
+        if (found.isEmpty()) {
+            return;
+        }
+        {
+            QMutexLocker lock(&mutex);
+            games.append(found);
+        }
+        if (batch) {
+            batch(found);
+        }
+    };
 
-            if (!shouldFilter) {
-                games << game;
+    for (const QString& libraryPath : libraries) {
+        // Each library lists itself and queues its own slices, so a slow
+        // listing holds back that library's games and nobody else's. The pool
+        // is thread-safe, and waitForDone() below also waits for whatever is
+        // queued from inside it.
+        pool.start([this, &pool, &deliver, libraryPath] {
+            const QStringList manifests =
+                QDir(libraryPath).entryList({"appmanifest_*.acf"}, QDir::Files);
+            for (qsizetype from = 0; from < manifests.size(); from += kManifestsPerSlice) {
+                const QStringList slice = manifests.mid(from, kManifestsPerSlice);
+                pool.start([this, &deliver, libraryPath, slice] {
+                    QList<Game> found;
+                    for (const QString& manifest : slice) {
+                        Game game = parseAppManifest(libraryPath + "/" + manifest, libraryPath);
+                        if (game.id().isEmpty() || game.name().isEmpty() || isSteamTool(game)) {
+                            continue;
+                        }
+                        found << game;
+                    }
+                    deliver(found);
+                });
             }
-        }
+        });
     }
+    pool.waitForDone();
 
     // Sort by name
     std::sort(games.begin(), games.end(), [](const Game& a, const Game& b) {
@@ -165,28 +247,113 @@ QList<Game> SteamLauncher::discoverGames()
     return games;
 }
 
-Game SteamLauncher::parseAppManifest(const QString& manifestPath, const QString& libraryPath)
+QList<Game> SteamLauncher::classifyGames(const QList<Game>& games) const
 {
-    Game game;
-    VDFParser parser;
+    SteamClassificationCache& platforms = SteamClassificationCache::instance();
 
-    if (!parser.parseFile(manifestPath)) {
-        return game;
+    QList<Game> settled;
+    for (Game game : games) {
+        if (!game.platformPending()) {
+            continue;
+        }
+        // Stamped before the walk, so a directory that changes during it is
+        // seen as changed next time rather than cached as seen.
+        const qint64 dirStamp = SteamClassificationCache::directoryStamp(game.installPath());
+        bool nativeLinux = false;
+        // Asked again first: the same game can be handed over twice — once from
+        // a batch, once from the finished list — and the walk is the one thing
+        // worth not doing twice.
+        if (!platforms.lookup(game.id(), game.buildId(), dirStamp, &nativeLinux)) {
+            nativeLinux = !SteamClassificationCache::hasWindowsExecutables(game.installPath());
+            if (dirStamp != 0) {
+                platforms.store(game.id(), game.buildId(), dirStamp, nativeLinux);
+            }
+        }
+        game.setIsNativeLinux(nativeLinux);
+        game.setPlatformPending(false);
+        settled << game;
     }
+    platforms.save();
+    return settled;
+}
 
-    VDFNode root = parser.root();
-    if (!root.hasChild("AppState")) {
-        return game;
+ILauncher::WatchSet SteamLauncher::watchSet() const
+{
+    WatchSet set;
+    const QString defaultPath = SteamPaths::steamAppsPath();
+    if (defaultPath.isEmpty()) {
+        return set;
     }
+    set.directories = libraryPaths();
+    set.filePatterns = {"appmanifest_*.acf"};
+    set.files = {defaultPath + "/libraryfolders.vdf"};
+    return set;
+}
 
-    VDFNode appState = root.child("AppState");
+ILauncher::WatchVerdict SteamLauncher::gameAt(const QString& path, Game* game) const
+{
+    const QString fileName = path.mid(path.lastIndexOf('/') + 1);
+    if (fileName == QLatin1String("libraryfolders.vdf")) {
+        return WatchVerdict::Rediscover;
+    }
+
+    static const QRegularExpression manifestName(QStringLiteral("^appmanifest_(\\d+)\\.acf$"));
+    const QRegularExpressionMatch match = manifestName.match(fileName);
+    if (!match.hasMatch()) {
+        return WatchVerdict::Unrelated;
+    }
+
+    // The same string discovery builds the library path from, so the game
+    // this produces compares equal to the one already in the list.
+    QString libraryPath = path.left(path.lastIndexOf('/'));
+    QString manifestPath = path;
+    if (!QFileInfo::exists(manifestPath)) {
+        // Steam moves a game between libraries by writing the new manifest and
+        // deleting the old one, and the two can arrive in either order.
+        manifestPath.clear();
+        for (const QString& library : libraryPaths()) {
+            if (QFileInfo::exists(library + "/" + fileName)) {
+                libraryPath = library;
+                manifestPath = library + "/" + fileName;
+                break;
+            }
+        }
+        if (manifestPath.isEmpty()) {
+            game->setId(match.captured(1));
+            return WatchVerdict::Removed;
+        }
+    }
+
+    Game parsed = parseAppManifest(manifestPath, libraryPath);
+    if (parsed.id().isEmpty() || parsed.name().isEmpty()) {
+        // Caught half-written. Steam finishing the write is another change.
+        return WatchVerdict::Unrelated;
+    }
+    if (isSteamTool(parsed)) {
+        return WatchVerdict::Unrelated;
+    }
+    *game = parsed;
+    return WatchVerdict::Updated;
+}
 
-    QString appId = appState.getString("appid");
-    QString gameName = appState.getString("name");
-    QString installDir = appState.getString("installdir");
-    qint64 sizeOnDisk = appState.getInt("SizeOnDisk");
-    int stateFlags = static_cast<int>(appState.getInt("StateFlags", 4));
-    qint64 buildId = appState.getInt("buildid", 0);
+Game SteamLauncher::parseAppManifest(const QString& manifestPath, const QString& libraryPath) const
+{
+    Game game;
+
+    // Everything wanted is in the first dozen lines of AppState; the depot
+    // and user-config blocks after them are never read.
+    VDFQuery manifest({"AppState", "AppState/appid", "AppState/name", "AppState/installdir",
+                       "AppState/SizeOnDisk", "AppState/StateFlags", "AppState/buildid"});
+    if (!manifest.runFile(manifestPath) || !manifest.contains("AppState")) {
+        return game;
+    }
+
+    QString appId = manifest.value("AppState/appid");
+    QString gameName = manifest.value("AppState/name");
+    QString installDir = manifest.value("AppState/installdir");
+    qint64 sizeOnDisk = manifest.intValue("AppState/SizeOnDisk");
+    int stateFlags = static_cast<int>(manifest.intValue("AppState/StateFlags", 4));
+    qint64 buildId = manifest.intValue("AppState/buildid", 0);
 
     if (appId.isEmpty() || gameName.isEmpty()) {
         return game;
@@ -204,22 +371,22 @@ Game SteamLauncher::parseAppManifest(const QString& manifestPath, const QString&
     game.setBuildId(buildId);
     game.setLibraryPath(libraryPath);
 
-    // Detect if this is a native Linux game or Windows game running via Proton
-    // Check for presence of .exe files - if found, it's a Windows game
-    QString installPath = libraryPath + "/common/" + installDir;
-    bool hasExeFiles = false;
-
-    QDir gameDir(installPath);
-    if (gameDir.exists()) {
-        QDirIterator it(installPath, {"*.exe"}, QDir::Files, QDirIterator::Subdirectories);
-        if (it.hasNext()) {
-            hasExeFiles = true;
-        }
+    // Native Linux or Windows via Proton: decided by whether there is an .exe
+    // anywhere in the install, which is a walk of the whole tree. Only done
+    // here when the cache says nothing about this build in this directory, and
+    // even then not here — classifyGames() does it off discovery's path, and
+    // until then the game carries the last verdict it had, or Windows.
+    const qint64 dirStamp = SteamClassificationCache::directoryStamp(game.installPath());
+    SteamClassificationCache& platforms = SteamClassificationCache::instance();
+    bool nativeLinux = false;
+    if (platforms.lookup(appId, buildId, dirStamp, &nativeLinux)) {
+        game.setIsNativeLinux(nativeLinux);
+    } else {
+        platforms.lastKnown(appId, &nativeLinux);
+        game.setIsNativeLinux(nativeLinux);
+        game.setPlatformPending(true);
     }
 
-    // Windows games have .exe files, native Linux games don't
-    game.setIsNativeLinux(!hasExeFiles);
-
     // Steam CDN header image URL
     game.setImageUrl(QString("https://steamcdn-a.akamaihd.net/steam/apps/%1/header.jpg").arg(appId));
 
@@ -234,8 +401,10 @@ QString SteamLauncher::getLaunchCommand(const Game& game, const DLSSSettings& se
 
 bool SteamLauncher::applySettings(const Game& game, const DLSSSettings& settings)
 {
-    QString launchOptions = getLaunchCommand(game, settings);
-    return writeToLocalConfig(game.id(), launchOptions);
+    if (game.id().isEmpty()) {
+        return false;
+    }
+    return writeToLocalConfig({{game.id(), getLaunchCommand(game, settings)}});
 }
 
 QString SteamLauncher::localConfigPath() const
@@ -243,160 +412,21 @@ QString SteamLauncher::localConfigPath() const
     return SteamPaths::userDataPath();
 }
 
-namespace {
-
-// --- editing localconfig.vdf in place --------------------------------------
-//
-// This is a surgical text edit rather than a parse-and-rewrite, and deliberately
-// so: localconfig.vdf is Steam's file, it is large, and re-emitting it from a
-// parse tree would mean taking responsibility for every key in it. Only the one
-// value is touched and the rest of the bytes are left alone.
-//
-// It used to be done with the regex "\"<appid>\"\\s*\\{[^}]*\\}", which cannot
-// work: a [^}]* body stops at the first closing brace, and real app sections
-// contain nested blocks (BadgeData and friends) in no guaranteed order. Depending
-// on where the nested block sat, the edit either landed inside it or the section
-// was never found at all — and in the latter case the file was still rewritten
-// and success still reported. Hence brace counting.
-
-// Escape a value for a VDF quoted string, matching what VDFParser un-escapes.
-QString vdfEscape(const QString& value)
-{
-    QString out;
-    out.reserve(value.size() + 8);
-    for (const QChar c : value) {
-        switch (c.unicode()) {
-        case '\\': out += "\\\\"; break;
-        case '"':  out += "\\\""; break;
-        case '\n': out += "\\n";  break;
-        case '\t': out += "\\t";  break;
-        default:   out += c;      break;
-        }
-    }
-    return out;
-}
-
-// End of the quoted string that starts at `quote` (the index of its opening
-// quote), i.e. the index of its closing quote. -1 when unterminated.
-int endOfQuoted(const QString& text, int quote)
-{
-    for (int i = quote + 1; i < text.size(); ++i) {
-        if (text.at(i) == '\\') {
-            ++i;                    // skip the escaped character
-            continue;
-        }
-        if (text.at(i) == '"') {
-            return i;
-        }
-    }
-    return -1;
-}
-
-// The '}' matching the '{' at `open`, skipping braces inside quoted strings.
-// -1 when the block is unbalanced.
-int matchingBrace(const QString& text, int open)
-{
-    int depth = 0;
-    for (int i = open; i < text.size(); ++i) {
-        const QChar c = text.at(i);
-        if (c == '"') {
-            const int end = endOfQuoted(text, i);
-            if (end < 0) {
-                return -1;
-            }
-            i = end;
-            continue;
-        }
-        if (c == '{') {
-            ++depth;
-        } else if (c == '}') {
-            if (--depth == 0) {
-                return i;
-            }
-        }
-    }
-    return -1;
-}
-
-// Find the quoted key `key` at the top level of the block [from, to), i.e. not
-// inside any nested block, comparing case-insensitively — Steam's key casing has
-// varied between client versions. Returns the index of its opening quote, or -1.
-int findKeyAtDepth(const QString& text, const QString& key, int from, int to)
+bool SteamLauncher::applySettingsToAll(const QList<QPair<Game, DLSSSettings>>& changes)
 {
-    int depth = 0;
-    for (int i = from; i < to && i < text.size(); ++i) {
-        const QChar c = text.at(i);
-        if (c == '"') {
-            const int end = endOfQuoted(text, i);
-            if (end < 0) {
-                return -1;
-            }
-            if (depth == 0
-                && QStringView(text).mid(i + 1, end - i - 1)
-                       .compare(key, Qt::CaseInsensitive) == 0) {
-                return i;
-            }
-            i = end;
-            continue;
+    QHash<QString, QString> optionsByAppId;
+    for (const auto& change : changes) {
+        if (change.first.id().isEmpty()) {
+            return false;
         }
-        if (c == '{') {
-            ++depth;
-        } else if (c == '}') {
-            if (depth == 0) {
-                return -1;      // left the block we were searching
-            }
-            --depth;
-        }
-    }
-    return -1;
-}
-
-// The block belonging to key `key` inside [from, to): returns its '{' and '}' in
-// *open and *close. False when the key or its block is not there.
-bool findBlock(const QString& text, const QString& key, int from, int to,
-               int* open, int* close)
-{
-    const int keyQuote = findKeyAtDepth(text, key, from, to);
-    if (keyQuote < 0) {
-        return false;
-    }
-    const int keyEnd = endOfQuoted(text, keyQuote);
-    if (keyEnd < 0) {
-        return false;
-    }
-    int i = keyEnd + 1;
-    while (i < to && text.at(i).isSpace()) {
-        ++i;
-    }
-    if (i >= to || text.at(i) != '{') {
-        return false;           // the key holds a value, not a block
+        optionsByAppId.insert(change.first.id(), getLaunchCommand(change.first, change.second));
     }
-    const int end = matchingBrace(text, i);
-    if (end < 0) {
-        return false;
-    }
-    *open = i;
-    *close = end;
-    return true;
+    return writeToLocalConfig(optionsByAppId);
 }
 
-// Indentation of the line the given index sits on, so an inserted key lines up
-// with its neighbours instead of standing out.
-QString indentOf(const QString& text, int index)
+bool SteamLauncher::writeToLocalConfig(const QHash<QString, QString>& optionsByAppId)
 {
-    const int lineStart = text.lastIndexOf('\n', index) + 1;
-    int i = lineStart;
-    while (i < text.size() && (text.at(i) == '\t' || text.at(i) == ' ')) {
-        ++i;
-    }
-    return text.mid(lineStart, i - lineStart);
-}
-
-} // namespace
-
-bool SteamLauncher::writeToLocalConfig(const QString& appId, const QString& launchOptions)
-{
-    if (appId.isEmpty()) {
+    if (optionsByAppId.isEmpty()) {
         return false;
     }
 
@@ -410,108 +440,24 @@ bool SteamLauncher::writeToLocalConfig(const QString& appId, const QString& laun
         return false;
     }
 
-    // True only once a file has actually been changed. A run that finds nothing
-    // to edit has to report failure — the caller is telling a user their settings
+    // True only once a file holds the options. A run that finds nothing to
+    // edit has to report failure — the caller is telling a user their settings
     // were applied to Steam, and there is no other way for it to find out.
     bool wrote = false;
 
     for (const QString& userId : userDirs) {
         const QString configPath = localConfigPath() + "/" + userId + "/config/localconfig.vdf";
-        QFile file(configPath);
-        if (!file.exists()) {
-            continue;
-        }
-        if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
-            qWarning("SteamLauncher: cannot read %s", qUtf8Printable(configPath));
-            continue;
-        }
-        QString content = QTextStream(&file).readAll();
-        file.close();
-
-        // Walk down to the apps block. Every level is matched case-insensitively
-        // and only at its own depth, so a key of the same name elsewhere in the
-        // file cannot be mistaken for it.
-        int from = 0;
-        int to = content.size();
-        bool navigated = true;
-        for (const QString& key : {QStringLiteral("UserLocalConfigStore"),
-                                   QStringLiteral("Software"),
-                                   QStringLiteral("Valve"),
-                                   QStringLiteral("Steam"),
-                                   QStringLiteral("apps")}) {
-            int open = 0;
-            int close = 0;
-            if (!findBlock(content, key, from, to, &open, &close)) {
-                qWarning("SteamLauncher: %s has no '%s' block",
-                         qUtf8Printable(configPath), qUtf8Printable(key));
-                navigated = false;
-                break;
-            }
-            from = open + 1;
-            to = close;
-        }
-        if (!navigated) {
-            continue;
-        }
-        const int appsFrom = from;
-        const int appsTo = to;
-
-        const QString escaped = vdfEscape(launchOptions);
-
-        int appOpen = 0;
-        int appClose = 0;
-        if (findBlock(content, appId, appsFrom, appsTo, &appOpen, &appClose)) {
-            // The app has a section. Replace its LaunchOptions if it has one,
-            // otherwise add one — in both cases at the section's own depth, so a
-            // nested block cannot swallow the edit.
-            const int keyQuote = findKeyAtDepth(content, QStringLiteral("LaunchOptions"),
-                                                appOpen + 1, appClose);
-            if (keyQuote >= 0) {
-                const int keyEnd = endOfQuoted(content, keyQuote);
-                int valueQuote = keyEnd + 1;
-                while (valueQuote < appClose && content.at(valueQuote).isSpace()) {
-                    ++valueQuote;
-                }
-                if (valueQuote >= appClose || content.at(valueQuote) != '"') {
-                    qWarning("SteamLauncher: LaunchOptions for %s has no value",
-                             qUtf8Printable(appId));
-                    continue;
-                }
-                const int valueEnd = endOfQuoted(content, valueQuote);
-                if (valueEnd < 0) {
-                    continue;
-                }
-                content.replace(valueQuote, valueEnd - valueQuote + 1, "\"" + escaped + "\"");
-            } else {
-                const QString indent = indentOf(content, appOpen) + "\t";
-                content.insert(appClose,
-                               indent + "\"LaunchOptions\"\t\t\"" + escaped + "\"\n"
-                                   + indentOf(content, appOpen));
-            }
-        } else {
-            // No section for this app. Steam only writes one once there is
-            // something to write, so this is the ordinary case for a game whose
-            // launch options have never been set — it has to be created, not
-            // silently skipped.
-            const QString indent = indentOf(content, appsFrom > 0 ? appsFrom - 1 : 0) + "\t";
-            const QString section = indent + "\"" + appId + "\"\n"
-                                    + indent + "{\n"
-                                    + indent + "\t\"LaunchOptions\"\t\t\"" + escaped + "\"\n"
-                                    + indent + "}\n";
-            content.insert(appsTo, section);
-        }
-
-        // Written through a temporary file and renamed over the original: this is
-        // Steam's file, there is no backup, and a half-written localconfig.vdf
-        // loses every game's settings rather than one game's.
-        QSaveFile out(configPath);
-        if (!out.open(QIODevice::WriteOnly | QIODevice::Text)) {
-            qWarning("SteamLauncher: cannot write %s", qUtf8Printable(configPath));
+        if (!QFile::exists(configPath)) {
             continue;
         }
-        QTextStream(&out) << content;
-        if (!out.commit()) {
-            qWarning("SteamLauncher: could not commit %s", qUtf8Printable(configPath));
+        // Every app in one pass and one write, however many there are.
+        QString error;
+        const bool applied = LocalConfigPatch::applyToFile(configPath, optionsByAppId, &error);
+        // A rewrite within the same millisecond at the same size would look
+        // unchanged to the index.
+        LocalConfigIndex::instance().invalidate(configPath);
+        if (!applied) {
+            qWarning("SteamLauncher: %s: %s", qUtf8Printable(configPath), qUtf8Printable(error));
             continue;
         }
         wrote = true;
@@ -520,76 +466,14 @@ bool SteamLauncher::writeToLocalConfig(const QString& appId, const QString& laun
     return wrote;
 }
 
-namespace {
-// localconfig.vdf key casing varies between Steam versions (e.g. "apps" vs
-// "Apps", "valve" vs "Valve"), so navigate children case-insensitively.
-VDFNode childCI(const VDFNode& node, const QString& key)
+QString SteamLauncher::readLaunchOptions(const QString& appId)
 {
-    if (node.hasChild(key)) {
-        return node.child(key);
-    }
-    const QMap<QString, VDFNode> kids = node.children();
-    for (auto it = kids.constBegin(); it != kids.constEnd(); ++it) {
-        if (it.key().compare(key, Qt::CaseInsensitive) == 0) {
-            return it.value();
-        }
-    }
-    return VDFNode();
+    return LocalConfigIndex::instance().launchOptions(appId);
 }
 
-QString getStringCI(const VDFNode& node, const QString& key)
+QHash<QString, QString> SteamLauncher::readAllLaunchOptions()
 {
-    if (node.hasChild(key)) {
-        return node.getString(key);
-    }
-    const QMap<QString, VDFNode> kids = node.children();
-    for (auto it = kids.constBegin(); it != kids.constEnd(); ++it) {
-        if (it.key().compare(key, Qt::CaseInsensitive) == 0 && it.value().isValue()) {
-            return it.value().value();
-        }
-    }
-    return QString();
-}
-} // namespace
-
-QString SteamLauncher::readLaunchOptions(const QString& appId)
-{
-    if (appId.isEmpty()) {
-        return QString();
-    }
-
-    QDir userDataDir(SteamPaths::userDataPath());
-    if (!userDataDir.exists()) {
-        return QString();
-    }
-
-    const QStringList userDirs = userDataDir.entryList(QDir::Dirs | QDir::NoDotAndDotDot);
-    for (const QString& userId : userDirs) {
-        const QString configPath = SteamPaths::userDataPath() + "/" + userId + "/config/localconfig.vdf";
-        if (!QFile::exists(configPath)) {
-            continue;
-        }
-
-        VDFParser parser;
-        if (!parser.parseFile(configPath)) {
-            continue;
-        }
-
-        // UserLocalConfigStore -> Software -> Valve -> Steam -> apps -> <appId> -> LaunchOptions
-        VDFNode node = childCI(parser.root(), "UserLocalConfigStore");
-        node = childCI(node, "Software");
-        node = childCI(node, "Valve");
-        node = childCI(node, "Steam");
-        node = childCI(node, "apps");
-        node = childCI(node, appId);
-
-        const QString opts = getStringCI(node, "LaunchOptions");
-        if (!opts.isEmpty()) {
-            return opts;
-        }
-    }
-
-    return QString();
+    return LocalConfigIndex::instance().allLaunchOptions();
 }
 
 bool SteamLauncher::checkUpdateStatus(Game& game)
@@ -600,19 +484,15 @@ bool SteamLauncher::checkUpdateStatus(Game& game)
 
     QString manifestPath = game.libraryPath() + "/appmanifest_" + game.id() + ".acf";
 
-    VDFParser parser;
-    if (!parser.parseFile(manifestPath)) {
-        return false;
-    }
-
-    VDFNode root = parser.root();
-    if (!root.hasChild("AppState")) {
+    // The two keys sit near the top of AppState; the read stops there, before
+    // the depot lists below them.
+    VDFQuery manifest({"AppState", "AppState/StateFlags", "AppState/buildid"});
+    if (!manifest.runFile(manifestPath) || !manifest.contains("AppState")) {
         return false;
     }
 
-    VDFNode appState = root.child("AppState");
-    int newStateFlags = static_cast<int>(appState.getInt("StateFlags", 4));
-    qint64 newBuildId = appState.getInt("buildid", 0);
+    int newStateFlags = static_cast<int>(manifest.intValue("AppState/StateFlags", 4));
+    qint64 newBuildId = manifest.intValue("AppState/buildid", 0);
 
     const bool changed = (newStateFlags != game.stateFlags()) || (newBuildId != game.buildId());
 
@@ -2,6 +2,7 @@
 #define STEAMLAUNCHER_H
 
 #include "ILauncher.h"
+#include <QHash>
 #include <QStringList>
 #include <memory>
 
@@ -15,13 +16,41 @@ public:
     QString name() const override { return "Steam"; }
     LauncherTraits traits() const override;
     QList<Game> discoverGames() override;
+
+    // Every library at once, each on its own worker, and each library's
+    // manifests parsed a slice at a time across the rest. What takes the time is
+    // not the ACF itself but the directory walk that tells a Windows game from a
+    // native one, and on a disk that has to spin up first, the listing; neither
+    // should wait on another library's. Slices go to `batch` as they finish, in
+    // no particular order; the returned list is sorted, as discoverGames()'s
+    // always has been.
+    QList<Game> discoverGamesIncrementally(const GameBatchSink& batch) override;
+
+    // Whether a game is native is remembered in SteamClassificationCache, and
+    // discovery only trusts a verdict made at the same build in the same
+    // directory; anything else comes back platformPending(). This walks the
+    // install directories of those and records what it found. discoverGames()
+    // runs it before returning; the incremental form leaves it to the caller's
+    // background pass.
+    QList<Game> classifyGames(const QList<Game>& games) const override;
+
+    // Every library's appmanifests, and libraryfolders.vdf for the libraries
+    // themselves. A manifest that changed is re-read on its own; one that went
+    // away is a removal unless another library has it now, which is what a
+    // move between drives looks like; a change to the library list is a
+    // rediscovery.
+    WatchSet watchSet() const override;
+    WatchVerdict gameAt(const QString& path, Game* game) const override;
     bool applySettings(const Game& game, const DLSSSettings& settings) override;
+    // One pass over each user's localconfig.vdf and one write, for all of them.
+    bool applySettingsToAll(const QList<QPair<Game, DLSSSettings>>& changes) override;
     QString getLaunchCommand(const Game& game, const DLSSSettings& settings) override;
     bool isAvailable() const override;
 
     // ILauncher's per-game entry points. Both forward to the static overloads
     // below, which stay public because Cli and the test lab call them directly.
     QString readLaunchOptions(const Game& game) const override;
+    QHash<QString, QString> readAllLaunchOptions(const QList<Game>& games) const override;
     bool refreshGameState(Game& game) const override;
 
     // Owned but not installed Steam games, via the Web API. Created lazily
@@ -40,14 +69,21 @@ public:
     // Reads the existing Steam launch options (the "%command%" string) for a
     // game from localconfig.vdf. Returns an empty string if none is set or the
     // config can't be read. Iterates all Steam users; returns the first match.
+    // Served from LocalConfigIndex, which reads each file once per change.
     static QString readLaunchOptions(const QString& appId);
 
+    // Every app's, by app id, the same way.
+    static QHash<QString, QString> readAllLaunchOptions();
+
 private:
     std::unique_ptr<SteamStoreService> m_storeService;
 
-    Game parseAppManifest(const QString& manifestPath, const QString& libraryPath);
+    // Runs on discovery's workers, several at once: reads nothing but its
+    // arguments and the disk.
+    Game parseAppManifest(const QString& manifestPath, const QString& libraryPath) const;
     QString localConfigPath() const;
-    bool writeToLocalConfig(const QString& appId, const QString& launchOptions);
+    // Into every user's localconfig.vdf; true if any of them now holds them.
+    bool writeToLocalConfig(const QHash<QString, QString>& optionsByAppId);
 };
 
 #endif // STEAMLAUNCHER_H
@@ -1,22 +1,70 @@
 #include "ImageCache.h"
+#include <QBuffer>
 #include <QDir>
 #include <QFile>
 #include <QCryptographicHash>
+#include <QFutureWatcher>
+#include <QImageReader>
 #include <QNetworkReply>
+#include <QSaveFile>
 #include <QStandardPaths>
 #include <QPainter>
+#include <QtConcurrent>
+
+#include <algorithm>
+#include <iterator>
+
+namespace {
+
+// A few screens of list art, and the details panel, many times over; a fraction
+// of what holding every full-size cover took.
+constexpr qint64 kDefaultMemoryBudget = 64LL * 1024 * 1024;
+
+// Decoding is short and CPU-bound. Two threads keep up with scrolling and
+// leave the rest of the machine to the game being launched.
+constexpr int kDecodeThreads = 2;
+
+// Enough to fill a screen quickly; few enough that the store and API requests
+// the user is waiting on still get through.
+constexpr int kMaxDownloads = 4;
+
+// 15 s, 30 s, 1 min... for a network error; six steps on, about 16 minutes,
+// for a URL that is not there. Never more than six hours.
+constexpr qint64 kRetryFirstMs = 15 * 1000;
+constexpr qint64 kRetryMaxMs = 6LL * 60 * 60 * 1000;
+constexpr int kMissingHeadStart = 6;
+
+} // namespace
 
 ImageCache& ImageCache::instance()
 {
-    static ImageCache instance;
+    static ImageCache instance(cacheDir());
     return instance;
 }
 
-ImageCache::ImageCache()
-    : m_networkManager(new QNetworkAccessManager(this))
+ImageCache::ImageCache(const QString& directory, QObject* parent)
+    : QObject(parent)
+    , m_directory(directory)
+    , m_networkManager(new QNetworkAccessManager(this))
+    , m_thumbnails(directory + "/thumbnails")
+    , m_retryFirstMs(kRetryFirstMs)
+    , m_retryMaxMs(kRetryMaxMs)
 {
+    m_clock.start();
+    m_memoryCache.setMaxCost(kDefaultMemoryBudget);
+    m_decodePool.setMaxThreadCount(kDecodeThreads);
+
     // Ensure cache directory exists
-    QDir().mkpath(cacheDir());
+    QDir().mkpath(m_directory);
+
+    // A store left over its cap, or mostly dead, by the last session is
+    // rewritten here rather than in its constructor: this may be the first
+    // paint, and that would wait on up to the whole cap read and written.
+    (void)QtConcurrent::run(&m_decodePool, [store = &m_thumbnails] {
+        if (store->wantsCompaction()) {
+            store->compact();
+        }
+    });
 }
 
 QString ImageCache::cacheDir()
@@ -29,93 +77,324 @@ QString ImageCache::cacheFilePath(const QString& url) const
 {
     // Use MD5 hash of URL as filename
     QByteArray hash = QCryptographicHash::hash(url.toUtf8(), QCryptographicHash::Md5);
-    return cacheDir() + "/" + hash.toHex() + ".jpg";
+    return m_directory + "/" + hash.toHex() + ".jpg";
+}
+
+QString ImageCache::variantKey(const QString& url, const QSize& size)
+{
+    return url + QLatin1Char('\n') + QString::number(size.width()) + QLatin1Char('x')
+           + QString::number(size.height());
+}
+
+QSize ImageCache::fittedSize(const QSize& original, const QSize& bounds)
+{
+    if (bounds.isEmpty() || original.isEmpty()) {
+        return original;
+    }
+    return original.scaled(bounds, Qt::KeepAspectRatio).expandedTo(QSize(1, 1));
+}
+
+QImage ImageCache::decode(QIODevice* device, const QSize& bounds)
+{
+    QImageReader reader(device);
+    const QSize original = reader.size();
+    if (!bounds.isEmpty() && original.isValid()) {
+        reader.setScaledSize(fittedSize(original, bounds));
+    }
+    QImage image = reader.read();
+    // A format that cannot tell its size before decoding is scaled after.
+    if (!image.isNull() && !bounds.isEmpty() && !original.isValid()) {
+        image = image.scaled(bounds, Qt::KeepAspectRatio, Qt::SmoothTransformation);
+    }
+    return image;
+}
+
+qint64 ImageCache::retryDelay(int failures, bool missing, qint64 firstMs, qint64 maxMs)
+{
+    const int doublings = qBound(0, failures - 1 + (missing ? kMissingHeadStart : 0), 40);
+    return qMin(maxMs, firstMs << doublings);
 }
 
 QPixmap ImageCache::getImage(const QString& url, const QSize& size)
 {
-    if (url.isEmpty()) {
-        return placeholderImage(size);
+    const QPixmap pixmap = findImage(url, size);
+    return pixmap.isNull() ? placeholderImage(size) : pixmap;
+}
+
+QPixmap ImageCache::findImage(const QString& url, const QSize& size)
+{
+    // Not again until its backoff is over (e.g. games without Steam
+    // artwork), or every repaint would retry.
+    if (url.isEmpty() || hasFailed(url)) {
+        return QPixmap();
+    }
+    const QString key = variantKey(url, size);
+    if (const QPixmap* cached = m_memoryCache.object(key)) {
+        return *cached;
     }
+    const QImage stored = m_thumbnails.find(key);
+    if (!stored.isNull()) {
+        return remember(key, stored);
+    }
+    load(url, size);
+    return QPixmap();
+}
 
-    // Check memory cache first
-    if (m_memoryCache.contains(url)) {
-        QPixmap cached = m_memoryCache[url];
-        if (!size.isEmpty()) {
-            return cached.scaled(size, Qt::KeepAspectRatio, Qt::SmoothTransformation);
-        }
-        return cached;
+bool ImageCache::isReady(const QString& url, const QSize& size) const
+{
+    const QString key = variantKey(url, size);
+    return m_memoryCache.contains(key) || m_thumbnails.contains(key);
+}
+
+bool ImageCache::hasFailed(const QString& url) const
+{
+    const auto failure = m_failures.constFind(url);
+    return failure != m_failures.cend() && m_clock.elapsed() < failure->retryAt;
+}
+
+bool ImageCache::hasImage(const QString& url) const
+{
+    return QFile::exists(cacheFilePath(url));
+}
+
+void ImageCache::setMemoryBudget(qint64 bytes)
+{
+    m_memoryCache.setMaxCost(bytes);
+}
+
+void ImageCache::setRetryBackoff(qint64 firstMs, qint64 maxMs)
+{
+    m_retryFirstMs = firstMs;
+    m_retryMaxMs = maxMs;
+}
+
+void ImageCache::setVisibleUrls(const QObject* view, const QStringList& urls)
+{
+    if (!m_visible.contains(view)) {
+        connect(view, &QObject::destroyed, this, [this, view]() {
+            setVisibleUrls(view, {});
+            m_visible.remove(view);
+        });
     }
+    m_visible.insert(view, QSet<QString>(urls.cbegin(), urls.cend()));
 
-    // Check disk cache
-    QPixmap diskCached = loadFromDisk(url);
-    if (!diskCached.isNull()) {
-        m_memoryCache[url] = diskCached;
-        if (!size.isEmpty()) {
-            return diskCached.scaled(size, Qt::KeepAspectRatio, Qt::SmoothTransformation);
+    for (auto it = m_queue.begin(); it != m_queue.end();) {
+        it->visible = isVisible(it.key());
+        if (it->visible) {
+            it->tracked = true;
+        } else if (it->tracked) {
+            // Scrolled away before its turn. Forgetting the sizes it was for
+            // lets the next ask start it over.
+            m_loading.remove(it.key());
+            it = m_queue.erase(it);
+            continue;
         }
-        return diskCached;
+        ++it;
     }
+}
 
-    // Fetch from network — but not again for URLs that already failed this
-    // session (e.g. games without Steam artwork), or every repaint would
-    // retry forever.
-    if (!m_failedUrls.contains(url)) {
-        fetchImage(url);
+bool ImageCache::isVisible(const QString& url) const
+{
+    for (const QSet<QString>& urls : m_visible) {
+        if (urls.contains(url)) {
+            return true;
+        }
     }
-
-    return placeholderImage(size);
+    return false;
 }
 
-bool ImageCache::hasImage(const QString& url) const
+bool ImageCache::before(const Queued& a, const Queued& b)
 {
-    if (m_memoryCache.contains(url)) {
-        return true;
+    if (a.visible != b.visible) {
+        return a.visible;
     }
-    return QFile::exists(cacheFilePath(url));
+    return a.sequence > b.sequence;
+}
+
+QStringList ImageCache::queuedDownloads() const
+{
+    QStringList urls = m_queue.keys();
+    std::sort(urls.begin(), urls.end(), [this](const QString& a, const QString& b) {
+        return before(m_queue.value(a), m_queue.value(b));
+    });
+    return urls;
 }
 
 void ImageCache::clearCache()
 {
     m_memoryCache.clear();
-    m_failedUrls.clear();
+    m_failures.clear();
+    m_thumbnails.clear();
 
-    QDir dir(cacheDir());
+    QDir dir(m_directory);
     QStringList files = dir.entryList(QDir::Files);
     for (const QString& file : files) {
         dir.remove(file);
     }
 }
 
-QPixmap ImageCache::loadFromDisk(const QString& url) const
+void ImageCache::load(const QString& url, const QSize& size)
 {
-    QString path = cacheFilePath(url);
-    if (QFile::exists(path)) {
-        QPixmap pixmap;
-        if (pixmap.load(path)) {
-            return pixmap;
-        }
+    QList<QSize>& loading = m_loading[url];
+    const bool asked = loading.contains(size);
+    if (!asked) {
+        loading.append(size);
+    }
+
+    // A download is decoded at every size asked for by the time it lands.
+    // One still waiting moves up: it is what is being drawn now.
+    if (m_downloading.contains(url)) {
+        return;
+    }
+    if (m_queue.contains(url)) {
+        fetchImage(url);
+        return;
+    }
+    if (asked) {
+        return;   // being decoded
+    }
+    if (hasImage(url)) {
+        decodeInBackground(url, {size}, QByteArray());
+    } else {
+        fetchImage(url);
     }
-    return QPixmap();
 }
 
-void ImageCache::saveToDisk(const QString& url, const QByteArray& data)
+void ImageCache::decodeInBackground(const QString& url, const QList<QSize>& sizes,
+                                    const QByteArray& data)
 {
-    QString path = cacheFilePath(url);
-    QFile file(path);
-    if (file.open(QIODevice::WriteOnly)) {
-        file.write(data);
-        file.close();
+    const QString path = cacheFilePath(url);
+
+    auto* watcher = new QFutureWatcher<Decoded>(this);
+    connect(watcher, &QFutureWatcher<Decoded>::finished, this, [this, watcher, url]() {
+        const Decoded result = watcher->result();
+        watcher->deleteLater();
+        onDecoded(url, result);
+    });
+
+    ThumbnailStore* store = &m_thumbnails;
+    watcher->setFuture(QtConcurrent::run(&m_decodePool, [store, url, path, sizes, data]() -> Decoded {
+        Decoded result;
+        result.downloaded = !data.isEmpty();
+
+        QByteArray bytes = data;
+        if (bytes.isEmpty()) {
+            QFile file(path);
+            if (!file.open(QIODevice::ReadOnly)) {
+                return result;
+            }
+            bytes = file.readAll();
+        }
+
+        // One read, however many sizes: each decode runs over the same bytes.
+        for (const QSize& size : sizes) {
+            QBuffer buffer(&bytes);
+            buffer.open(QIODevice::ReadOnly);
+            const QImage image = decode(&buffer, size);
+            if (image.isNull()) {
+                return result;
+            }
+            // Converted here rather than on the GUI thread: this is the
+            // format both QPixmap and the thumbnail store take as it is.
+            result.variants.append({size, image.convertToFormat(image.hasAlphaChannel()
+                                                    ? QImage::Format_ARGB32_Premultiplied
+                                                    : QImage::Format_RGB32)});
+        }
+        // Written here, before the GUI thread hears of them, so a variant that
+        // is ready is already in the store; the GUI thread only reads it.
+        for (const auto& [size, image] : std::as_const(result.variants)) {
+            store->insert(variantKey(url, size), image);
+        }
+        if (store->wantsCompaction()) {
+            store->compact();
+        }
+        if (sizes.isEmpty()) {
+            QBuffer buffer(&bytes);
+            buffer.open(QIODevice::ReadOnly);
+            if (!QImageReader(&buffer).canRead()) {
+                return result;
+            }
+        }
+        result.ok = true;
+
+        // Only what decodes is kept: an error page served with a 200 would
+        // otherwise be read back, and fail, on every start.
+        if (result.downloaded) {
+            QSaveFile file(path);
+            if (file.open(QIODevice::WriteOnly)) {
+                file.write(bytes);
+                file.commit();
+            }
+        }
+        return result;
+    }));
+}
+
+void ImageCache::onDecoded(const QString& url, const Decoded& result)
+{
+    if (!result.ok) {
+        if (result.downloaded) {
+            recordFailure(url, true);   // an error page, most likely; it will not change soon
+        } else {
+            // A damaged or vanished file: download it again.
+            QFile::remove(cacheFilePath(url));
+            fetchImage(url);
+        }
+        return;
+    }
+
+    QList<QSize>& loading = m_loading[url];
+    for (const auto& [size, image] : result.variants) {
+        remember(variantKey(url, size), image);
+        loading.removeAll(size);
     }
+    if (loading.isEmpty()) {
+        m_loading.remove(url);
+    }
+    m_failures.remove(url);
+    emit imageReady(url);
+}
+
+QPixmap ImageCache::remember(const QString& key, const QImage& image)
+{
+    const QPixmap pixmap = QPixmap::fromImage(image);
+    const qint64 cost = qint64(pixmap.width()) * pixmap.height() * pixmap.depth() / 8;
+    // A variant larger than the whole budget is dropped here, not kept.
+    m_memoryCache.insert(key, new QPixmap(pixmap), cost);
+    return pixmap;
 }
 
 void ImageCache::fetchImage(const QString& url)
 {
-    if (m_pendingRequests.contains(url)) {
+    if (m_downloading.contains(url)) {
         return;
     }
+    // Asked again while waiting: it moves up among the newest.
+    Queued& queued = m_queue[url];
+    queued.sequence = ++m_sequence;
+    queued.visible = isVisible(url);
+    queued.tracked = queued.tracked || queued.visible;
+    startDownloads();
+}
 
-    m_pendingRequests.insert(url);
+void ImageCache::startDownloads()
+{
+    while (m_downloading.size() < kMaxDownloads && !m_queue.isEmpty()) {
+        auto best = m_queue.begin();
+        for (auto it = std::next(best); it != m_queue.end(); ++it) {
+            if (before(*it, *best)) {
+                best = it;
+            }
+        }
+        const QString url = best.key();
+        m_queue.erase(best);
+        startDownload(url);
+    }
+}
+
+void ImageCache::startDownload(const QString& url)
+{
+    m_downloading.insert(url);
 
     QNetworkRequest request{QUrl(url)};
     request.setAttribute(QNetworkRequest::RedirectPolicyAttribute,
@@ -124,28 +403,34 @@ void ImageCache::fetchImage(const QString& url)
     QNetworkReply* reply = m_networkManager->get(request);
 
     connect(reply, &QNetworkReply::finished, this, [this, reply, url]() {
-        m_pendingRequests.remove(url);
+        m_downloading.remove(url);
         reply->deleteLater();
 
-        if (reply->error() != QNetworkReply::NoError) {
-            m_failedUrls.insert(url);
-            emit imageFailed(url);
-            return;
-        }
-
-        QByteArray data = reply->readAll();
-        QPixmap pixmap;
-        if (pixmap.loadFromData(data)) {
-            m_memoryCache[url] = pixmap;
-            saveToDisk(url, data);
-            emit imageReady(url);
+        const QByteArray data = reply->error() == QNetworkReply::NoError ? reply->readAll()
+                                                                           : QByteArray();
+        if (data.isEmpty()) {
+            const bool missing = reply->error() == QNetworkReply::ContentNotFoundError
+                                 || reply->error() == QNetworkReply::ContentGoneError
+                                 || reply->error() == QNetworkReply::NoError;
+            recordFailure(url, missing);
         } else {
-            m_failedUrls.insert(url);
-            emit imageFailed(url);
+            // Decoded, and checked, at every size asked for while it downloaded.
+            decodeInBackground(url, m_loading.value(url), data);
         }
+        startDownloads();
     });
 }
 
+void ImageCache::recordFailure(const QString& url, bool missing)
+{
+    m_loading.remove(url);
+    Failure& failure = m_failures[url];
+    ++failure.count;
+    failure.retryAt = m_clock.elapsed()
+                      + retryDelay(failure.count, missing, m_retryFirstMs, m_retryMaxMs);
+    emit imageFailed(url);
+}
+
 QPixmap ImageCache::placeholderImage(const QSize& size) const
 {
     QSize actualSize = size.isEmpty() ? QSize(460, 215) : size;
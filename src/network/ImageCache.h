@@ -1,26 +1,104 @@
 #ifndef IMAGECACHE_H
 #define IMAGECACHE_H
 
+#include <QCache>
+#include <QElapsedTimer>
+#include <QHash>
+#include <QImage>
+#include <QList>
 #include <QObject>
 #include <QPixmap>
 #include <QNetworkAccessManager>
-#include <QMap>
 #include <QSet>
+#include <QThreadPool>
+#include "network/ThumbnailStore.h"
 
+class QIODevice;
+
+// Cover art for the game and store lists: downloaded once, kept on disk, and
+// held in memory only at the sizes the views draw it.
+//
+// Memory used to be a QMap of every full-resolution cover ever shown, never
+// trimmed, and getImage() rescaled the cover with SmoothTransformation on each
+// call. The delegate calls it on every repaint, so a large library grew memory
+// without bound and scrolling spent its time rescaling the same covers.
+//
+// Now memory holds scaled variants, keyed by url and size, in a QCache with a
+// byte budget. The least recently drawn variant goes first. A variant not in
+// memory is decoded on a worker by QImageReader straight at its target size;
+// a JPEG decoder skips most of the work that way. The worker hands back a
+// QImage, and the QPixmap is made on the GUI thread, the only place one may
+// be made. Until then getImage() answers with a placeholder, and
+// imageReady(url) says when to ask again.
+//
+// Every variant decoded is also written to a ThumbnailStore, by the worker
+// that decoded it; the store's compactions run on the same workers. A variant
+// that has left memory, or was drawn in an earlier session, comes back from
+// there synchronously, with no decode. Only sizes never drawn before, and
+// covers never downloaded, take the trip to the worker.
+//
+// Downloads are scheduled rather than fired. Every view used to start one
+// per URL the moment it asked, so opening a big library started thousands at
+// once. Those starved the API calls the user was waiting on. Now at most a
+// few run at a time, and the rest wait in a queue:
+//
+//   - URLs some view has on screen (setVisibleUrls()) go first. Next come
+//     other requests, newest first: what was asked for last is what the user
+//     is looking at.
+//   - A queued URL that a view showed, and no view shows any more, is dropped,
+//     with every size it was asked for. It is asked for again if it scrolls
+//     back. A download already running is left to finish: a cover is small,
+//     and the bytes are half there. So anything that shows a cover outside a
+//     list, a details panel, registers it too, or a list scrolling past the
+//     same URL takes its cover with it.
+//   - A failed fetch is retried after a backoff that doubles with each
+//     failure. A URL that does not exist, or is not an image, starts further
+//     along: most such URLs are games that simply have no artwork.
 class ImageCache : public QObject {
     Q_OBJECT
 
 public:
     static ImageCache& instance();
 
-    // Get cached image or trigger fetch
+    // A cache kept in `directory`; instance() uses cacheDir(). Public for
+    // tests.
+    explicit ImageCache(const QString& directory, QObject* parent = nullptr);
+
+    // The artwork fitted inside `size`, aspect kept (an empty size means as
+    // downloaded). A placeholder while it is decoded or downloaded.
     QPixmap getImage(const QString& url, const QSize& size = QSize());
 
-    // Check if image is cached
+    // As getImage(), but null rather than a placeholder until it is ready.
+    // For painting code that draws its own loading state.
+    QPixmap findImage(const QString& url, const QSize& size);
+
+    // True once the artwork at that size is in memory or in the thumbnail
+    // store: getImage() would return it rather than a placeholder.
+    bool isReady(const QString& url, const QSize& size) const;
+
+    // True once it has been downloaded, whatever sizes are in memory.
     bool hasImage(const QString& url) const;
 
-    // True if a fetch for this URL failed this session (no retry until restart)
-    bool hasFailed(const QString& url) const { return m_failedUrls.contains(url); }
+    // True while a failed fetch waits out its backoff. Asking again after
+    // that retries it.
+    bool hasFailed(const QString& url) const;
+
+    // What `view` has on screen now, replacing what it last said. Cleared
+    // when the view is destroyed.
+    void setVisibleUrls(const QObject* view, const QStringList& urls);
+
+    // The first retry's delay, doubled per failure up to `maxMs`.
+    void setRetryBackoff(qint64 firstMs, qint64 maxMs);
+
+    int activeDownloads() const { return int(m_downloading.size()); }
+    // Best first.
+    QStringList queuedDownloads() const;
+
+    // What the variants in memory may add up to, in bytes. Lowering it evicts
+    // at once.
+    void setMemoryBudget(qint64 bytes);
+    qint64 memoryBudget() const { return m_memoryCache.maxCost(); }
+    qint64 memoryUsed() const { return m_memoryCache.totalCost(); }
 
     // Clear cache
     void clearCache();
@@ -28,26 +106,81 @@ public:
     // Cache directory
     static QString cacheDir();
 
+    // --- pure helpers, public for tests ---
+
+    // `original` fitted inside `bounds` with its aspect kept, at least 1x1.
+    // `original` itself when `bounds` is empty.
+    static QSize fittedSize(const QSize& original, const QSize& bounds);
+
+    // Decodes an image straight at fittedSize(). Null if it is not one.
+    static QImage decode(QIODevice* device, const QSize& bounds);
+
+    // How long after its `failures`th failure a URL is tried again.
+    static qint64 retryDelay(int failures, bool missing, qint64 firstMs, qint64 maxMs);
+
 signals:
     void imageReady(const QString& url);
     void imageFailed(const QString& url);
 
 private:
-    ImageCache();
-    ~ImageCache() = default;
     ImageCache(const ImageCache&) = delete;
     ImageCache& operator=(const ImageCache&) = delete;
 
+    // What a worker made of one url: a variant per size asked for, or
+    // nothing if the bytes were no image.
+    struct Decoded {
+        bool ok = false;
+        bool downloaded = false;   // from the network, rather than the disk
+        QList<QPair<QSize, QImage>> variants;
+    };
+
+    struct Queued {
+        bool visible = false;    // on some view's screen
+        bool tracked = false;    // was, at some point: dropped once it is not
+        quint64 sequence = 0;    // newer asks first
+    };
+
+    struct Failure {
+        int count = 0;
+        qint64 retryAt = 0;      // m_clock time
+    };
+
+    static QString variantKey(const QString& url, const QSize& size);
+
+    void load(const QString& url, const QSize& size);
     void fetchImage(const QString& url);
+    void startDownloads();
+    void startDownload(const QString& url);
+    void recordFailure(const QString& url, bool missing);
+    bool isVisible(const QString& url) const;
+    static bool before(const Queued& a, const Queued& b);
+    // `data` empty means read the file. Downloaded data is written to disk
+    // once it has decoded.
+    void decodeInBackground(const QString& url, const QList<QSize>& sizes,
+                            const QByteArray& data);
+    void onDecoded(const QString& url, const Decoded& result);
     QString cacheFilePath(const QString& url) const;
-    QPixmap loadFromDisk(const QString& url) const;
-    void saveToDisk(const QString& url, const QByteArray& data);
     QPixmap placeholderImage(const QSize& size) const;
+    QPixmap remember(const QString& key, const QImage& image);
 
+    QString m_directory;
     QNetworkAccessManager* m_networkManager;
-    QMap<QString, QPixmap> m_memoryCache;
-    QSet<QString> m_pendingRequests;
-    QSet<QString> m_failedUrls;
+    QCache<QString, QPixmap> m_memoryCache;   // variantKey() -> pixmap, cost in bytes
+    QHash<QString, QList<QSize>> m_loading;   // url -> sizes on their way
+    ThumbnailStore m_thumbnails;   // in a directory of its own: clearCache() empties ours
+
+    QHash<QString, Queued> m_queue;
+    QSet<QString> m_downloading;
+    QHash<const QObject*, QSet<QString>> m_visible;
+    quint64 m_sequence = 0;
+    QHash<QString, Failure> m_failures;
+    QElapsedTimer m_clock;
+    qint64 m_retryFirstMs;
+    qint64 m_retryMaxMs;
+
+    // Its own pool, so a screenful of covers never queues ahead of a search
+    // or a discovery.
+    QThreadPool m_decodePool;
 };
 
 #endif // IMAGECACHE_H
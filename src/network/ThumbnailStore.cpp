@@ -0,0 +1,459 @@
+#include "ThumbnailStore.h"
+
+#include <QCryptographicHash>
+#include <QDir>
+#include <QSaveFile>
+#include <QtEndian>
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <mutex>
+
+// Both files are native-endian: they never leave the machine that wrote them.
+struct ThumbnailStore::IndexHeader {
+    char magic[8];
+    quint32 version;
+    quint32 capacity;     // slots, a power of two
+    quint32 count;
+    quint32 clock;        // advanced on every write and hit; Slot::lastUsed reads it
+    quint64 dataBytes;    // the data file's length after the last write; more is a torn append
+    quint64 liveBytes;
+};
+
+struct ThumbnailStore::Slot {
+    quint64 hash;         // 0: empty. Nothing is ever removed, so no tombstones.
+    quint64 offset;       // of the record in the data file
+    quint32 length;       // of its pixels
+    quint32 lastUsed;
+    quint16 width;
+    quint16 height;
+    quint32 format;       // QImage::Format
+};
+
+namespace {
+
+constexpr char kMagic[8] = {'P', 'F', 'T', 'H', 'U', 'M', 'B', 'S'};
+constexpr quint32 kVersion = 1;
+constexpr quint32 kInitialCapacity = 1024;
+
+// Repeated before each variant's pixels. A slot whose record does not match
+// it is a miss, never garbage on screen.
+struct RecordHeader {
+    quint32 magic;
+    quint32 length;
+    quint64 hash;
+};
+constexpr quint32 kRecordMagic = 0x52544650;   // "PFTR"
+
+// Dead bytes are only worth a rewrite once there are this many.
+constexpr quint64 kCompactSlack = 8 * 1024 * 1024;
+
+// How long a lookup waits on a writer. Appending a thumbnail takes well under
+// this; a compaction takes seconds, and is not waited for.
+constexpr std::chrono::milliseconds kLookupWait{5};
+
+quint64 keyHash(const QString& key)
+{
+    const QByteArray digest = QCryptographicHash::hash(key.toUtf8(), QCryptographicHash::Md5);
+    const quint64 hash = qFromLittleEndian<quint64>(digest.constData());
+    return hash ? hash : 1;
+}
+
+quint64 recordSize(quint32 length)
+{
+    return sizeof(RecordHeader) + length;
+}
+
+// Room for `count` at under 70% full.
+quint32 capacityFor(qsizetype count)
+{
+    quint32 capacity = kInitialCapacity;
+    while (qsizetype(capacity) * 7 <= count * 10) {
+        capacity *= 2;
+    }
+    return capacity;
+}
+
+} // namespace
+
+ThumbnailStore::ThumbnailStore(const QString& directory, qint64 maxBytes)
+    : m_directory(directory)
+    , m_maxBytes(maxBytes)
+{
+    static_assert(sizeof(IndexHeader) == 40, "index layout");
+    static_assert(sizeof(Slot) == 32, "index layout");
+    static_assert(sizeof(RecordHeader) == 16, "record layout");
+
+    QDir().mkpath(m_directory);
+    if (!open()) {
+        reset();
+    }
+}
+
+
+QString ThumbnailStore::indexPath() const
+{
+    return m_directory + "/thumbnails.idx";
+}
+
+QString ThumbnailStore::dataPath() const
+{
+    return m_directory + "/thumbnails.dat";
+}
+
+ThumbnailStore::IndexHeader* ThumbnailStore::header() const
+{
+    return reinterpret_cast<IndexHeader*>(m_indexMap);
+}
+
+ThumbnailStore::Slot* ThumbnailStore::slots() const
+{
+    return reinterpret_cast<Slot*>(m_indexMap + sizeof(IndexHeader));
+}
+
+bool ThumbnailStore::open()
+{
+    m_index.setFileName(indexPath());
+    m_data.setFileName(dataPath());
+    if (!m_index.open(QIODevice::ReadWrite) || !m_data.open(QIODevice::ReadWrite)) {
+        return false;
+    }
+
+    IndexHeader head;
+    if (m_index.read(reinterpret_cast<char*>(&head), sizeof(head)) != qint64(sizeof(head))
+        || memcmp(head.magic, kMagic, sizeof(kMagic)) != 0 || head.version != kVersion
+        || head.capacity < kInitialCapacity || (head.capacity & (head.capacity - 1)) != 0
+        || qint64(head.count) * 10 >= qint64(head.capacity) * 7
+        || m_index.size() != qint64(sizeof(IndexHeader) + head.capacity * sizeof(Slot))) {
+        return false;
+    }
+
+    // Shorter than the index says: offsets point past the end. Longer: an
+    // append that never reached the index, which is simply dropped.
+    if (m_data.size() < qint64(head.dataBytes)) {
+        return false;
+    }
+    if (m_data.size() > qint64(head.dataBytes) && !m_data.resize(qint64(head.dataBytes))) {
+        return false;
+    }
+
+    m_indexMap = m_index.map(0, m_index.size());
+    return m_indexMap && mapData();
+}
+
+void ThumbnailStore::reset()
+{
+    m_dataMap = nullptr;
+    m_dataMapSize = 0;
+    m_data.close();
+    m_indexMap = nullptr;
+    m_index.close();
+
+    QFile::remove(dataPath());
+    m_data.setFileName(dataPath());
+    if (!m_data.open(QIODevice::ReadWrite)) {
+        return;   // stays closed: every lookup misses, every write is dropped
+    }
+    writeIndex(kInitialCapacity, {}, 0, 0, 0);
+}
+
+bool ThumbnailStore::writeIndex(quint32 capacity, const QList<Slot>& live, quint32 clock,
+                                quint64 dataBytes, quint64 liveBytes)
+{
+    QByteArray bytes(qsizetype(sizeof(IndexHeader) + capacity * sizeof(Slot)), '\0');
+    auto* head = reinterpret_cast<IndexHeader*>(bytes.data());
+    memcpy(head->magic, kMagic, sizeof(kMagic));
+    head->version = kVersion;
+    head->capacity = capacity;
+    head->count = quint32(live.size());
+    head->clock = clock;
+    head->dataBytes = dataBytes;
+    head->liveBytes = liveBytes;
+
+    auto* table = reinterpret_cast<Slot*>(bytes.data() + sizeof(IndexHeader));
+    for (const Slot& slot : live) {
+        quint32 i = quint32(slot.hash) & (capacity - 1);
+        while (table[i].hash != 0) {
+            i = (i + 1) & (capacity - 1);
+        }
+        table[i] = slot;
+    }
+
+    m_indexMap = nullptr;
+    m_index.close();
+
+    QSaveFile file(indexPath());
+    if (!file.open(QIODevice::WriteOnly) || file.write(bytes) != bytes.size() || !file.commit()) {
+        return false;
+    }
+    m_index.setFileName(indexPath());
+    if (!m_index.open(QIODevice::ReadWrite)) {
+        return false;
+    }
+    m_indexMap = m_index.map(0, m_index.size());
+    return m_indexMap != nullptr;
+}
+
+bool ThumbnailStore::mapData()
+{
+    if (m_dataMap) {
+        m_data.unmap(m_dataMap);
+        m_dataMap = nullptr;
+    }
+    m_dataMapSize = m_data.size();
+    if (m_dataMapSize == 0) {
+        return true;   // nothing to map yet
+    }
+    m_dataMap = m_data.map(0, m_dataMapSize);
+    return m_dataMap != nullptr;
+}
+
+ThumbnailStore::Slot* ThumbnailStore::lookup(quint64 hash) const
+{
+    if (!m_indexMap) {
+        return nullptr;
+    }
+    const quint32 mask = header()->capacity - 1;
+    Slot* table = slots();
+    for (quint32 i = quint32(hash) & mask; table[i].hash != 0; i = (i + 1) & mask) {
+        if (table[i].hash == hash) {
+            return &table[i];
+        }
+    }
+    return nullptr;
+}
+
+const uchar* ThumbnailStore::record(const Slot& slot)
+{
+    const qint64 end = qint64(slot.offset + recordSize(slot.length));
+    if (end > m_dataMapSize && (end > m_data.size() || !mapData())) {
+        return nullptr;
+    }
+    const auto* head = reinterpret_cast<const RecordHeader*>(m_dataMap + slot.offset);
+    if (head->magic != kRecordMagic || head->length != slot.length || head->hash != slot.hash) {
+        return nullptr;
+    }
+    return m_dataMap + slot.offset;
+}
+
+QImage ThumbnailStore::find(const QString& key)
+{
+    std::unique_lock<QMutex> locker(m_mutex, std::defer_lock);
+    if (!locker.try_lock_for(kLookupWait)) {
+        return QImage();
+    }
+    Slot* slot = lookup(keyHash(key));
+    if (!slot || slot->height == 0) {
+        return QImage();
+    }
+    const uchar* bytes = record(*slot);
+    if (!bytes) {
+        return QImage();
+    }
+    slot->lastUsed = ++header()->clock;
+
+    // Borrowed from the mapping, then copied out: a later compaction would
+    // pull the pages out from under anything still pointing at them.
+    const QImage view(bytes + sizeof(RecordHeader), slot->width, slot->height,
+                      qsizetype(slot->length / slot->height), QImage::Format(slot->format));
+    return view.copy();
+}
+
+bool ThumbnailStore::contains(const QString& key) const
+{
+    std::unique_lock<QMutex> locker(m_mutex, std::defer_lock);
+    if (!locker.try_lock_for(kLookupWait)) {
+        return false;
+    }
+    return lookup(keyHash(key)) != nullptr;
+}
+
+void ThumbnailStore::insert(const QString& key, const QImage& image)
+{
+    if (image.isNull() || image.width() > 0xffff || image.height() > 0xffff) {
+        return;
+    }
+    // What QPixmap uploads without converting; a no-op for what ImageCache
+    // hands over.
+    const QImage pixels = image.convertToFormat(image.hasAlphaChannel()
+                                                    ? QImage::Format_ARGB32_Premultiplied
+                                                    : QImage::Format_RGB32);
+    const qint64 length = pixels.sizeInBytes();
+
+    QMutexLocker locker(&m_mutex);
+    // No one variant may crowd out the rest.
+    if (!m_indexMap || qint64(recordSize(quint32(length))) > m_maxBytes / 4) {
+        return;
+    }
+
+    const quint64 hash = keyHash(key);
+    const quint64 offset = header()->dataBytes;
+    const RecordHeader head{kRecordMagic, quint32(length), hash};
+    if (!m_data.seek(qint64(offset))
+        || m_data.write(reinterpret_cast<const char*>(&head), sizeof(head)) != qint64(sizeof(head))
+        || m_data.write(reinterpret_cast<const char*>(pixels.constBits()), length) != length
+        || !m_data.flush()) {
+        m_data.resize(qint64(offset));
+        return;
+    }
+
+    // Only now is the record reachable: the data is written before the index
+    // ever points at it.
+    Slot* slot = lookup(hash);
+    if (slot) {
+        header()->liveBytes -= recordSize(slot->length);
+    } else {
+        if ((qint64(header()->count) + 1) * 10 >= qint64(header()->capacity) * 7) {
+            grow();
+            if (!m_indexMap) {
+                return;
+            }
+        }
+        const quint32 mask = header()->capacity - 1;
+        quint32 i = quint32(hash) & mask;
+        while (slots()[i].hash != 0) {
+            i = (i + 1) & mask;
+        }
+        slot = &slots()[i];
+        ++header()->count;
+    }
+    *slot = Slot{hash, offset, quint32(length), ++header()->clock,
+                 quint16(pixels.width()), quint16(pixels.height()), quint32(pixels.format())};
+    header()->dataBytes = offset + recordSize(quint32(length));
+    header()->liveBytes += recordSize(quint32(length));
+}
+
+QList<ThumbnailStore::Slot> ThumbnailStore::liveSlots() const
+{
+    QList<Slot> live;
+    if (!m_indexMap) {
+        return live;
+    }
+    live.reserve(header()->count);
+    const Slot* table = slots();
+    for (quint32 i = 0; i < header()->capacity; ++i) {
+        if (table[i].hash != 0) {
+            live.append(table[i]);
+        }
+    }
+    return live;
+}
+
+void ThumbnailStore::grow()
+{
+    const IndexHeader head = *header();
+    if (!writeIndex(head.capacity * 2, liveSlots(), head.clock, head.dataBytes, head.liveBytes)) {
+        reset();
+    }
+}
+
+bool ThumbnailStore::wantsCompaction() const
+{
+    QMutexLocker locker(&m_mutex);
+    if (!m_indexMap) {
+        return false;
+    }
+    const IndexHeader* head = header();
+    return qint64(head->dataBytes) > m_maxBytes
+           || (head->dataBytes > kCompactSlack && head->liveBytes < head->dataBytes / 2);
+}
+
+void ThumbnailStore::compact()
+{
+    QMutexLocker locker(&m_mutex);
+    compactLocked();
+}
+
+void ThumbnailStore::compactLocked()
+{
+    if (!m_indexMap) {
+        return;
+    }
+    const quint32 clock = header()->clock;
+    QList<Slot> live = liveSlots();
+    std::sort(live.begin(), live.end(), [](const Slot& a, const Slot& b) {
+        return a.lastUsed > b.lastUsed;
+    });
+
+    // Down to three quarters, so the next few writes do not compact again.
+    const quint64 budget = quint64(m_maxBytes) / 4 * 3;
+    QSaveFile file(dataPath());
+    if (!file.open(QIODevice::WriteOnly)) {
+        return;
+    }
+    QList<Slot> kept;
+    quint64 written = 0;
+    for (const Slot& slot : live) {
+        const quint64 size = recordSize(slot.length);
+        if (written + size > budget) {
+            break;
+        }
+        const uchar* bytes = record(slot);
+        if (!bytes) {
+            continue;
+        }
+        if (file.write(reinterpret_cast<const char*>(bytes), qint64(size)) != qint64(size)) {
+            return;   // uncommitted: the old file stands
+        }
+        Slot moved = slot;
+        moved.offset = written;
+        kept.append(moved);
+        written += size;
+    }
+
+    // The new data goes in before the index that points into it. An old index
+    // left by a crash in between finds records that do not carry its hashes:
+    // misses, never the wrong cover.
+    if (m_dataMap) {
+        m_data.unmap(m_dataMap);
+        m_dataMap = nullptr;
+    }
+    m_dataMapSize = 0;
+    m_data.close();
+    if (!file.commit()) {
+        reset();
+        return;
+    }
+    m_data.setFileName(dataPath());
+    if (!m_data.open(QIODevice::ReadWrite) || !mapData()
+        || !writeIndex(capacityFor(kept.size()), kept, clock, written, written)) {
+        reset();
+    }
+}
+
+void ThumbnailStore::clear()
+{
+    QMutexLocker locker(&m_mutex);
+    reset();
+}
+
+void ThumbnailStore::setMaxBytes(qint64 bytes)
+{
+    QMutexLocker locker(&m_mutex);
+    m_maxBytes = bytes;
+}
+
+qint64 ThumbnailStore::maxBytes() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_maxBytes;
+}
+
+int ThumbnailStore::count() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_indexMap ? int(header()->count) : 0;
+}
+
+qint64 ThumbnailStore::liveBytes() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_indexMap ? qint64(header()->liveBytes) : 0;
+}
+
+qint64 ThumbnailStore::dataBytes() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_indexMap ? qint64(header()->dataBytes) : 0;
+}
@@ -0,0 +1,99 @@
+#ifndef THUMBNAILSTORE_H
+#define THUMBNAILSTORE_H
+
+#include <QFile>
+#include <QImage>
+#include <QList>
+#include <QMutex>
+#include <QString>
+
+// Every cover the lists have drawn, at the size they drew it, packed into one
+// file and ready to hand to the screen.
+//
+// ImageCache keeps each download as a file of its own. Starting with a big
+// library meant thousands of opens and full-size JPEG decodes before the list
+// looked complete. This store keeps the scaled variants instead. Their pixels
+// are stored in the format QPixmap uploads, and each is appended to a single
+// data file. A hash index, mapped into memory, says where each one starts.
+// Looking a cover up probes the mapped index and copies the pixels out of the
+// page cache; no file is opened and nothing is decoded.
+//
+// The data file is only ever appended to. Writing a variant again leaves its
+// old bytes dead, and a growing library pushes the file past its cap.
+// compact() rewrites the file with only the live variants, most recently
+// drawn first, until they fill three quarters of the cap. That is up to the
+// whole cap read and written again, so the store never does it on its own:
+// the owner asks wantsCompaction() and runs it off the GUI thread. ImageCache
+// does so on its decode pool, once at start and after each write.
+//
+// Thread-safe, one process. Writes come from the workers that decoded them;
+// lookups come from painting code. A lookup that would have to wait on a
+// compaction misses instead, and the caller decodes the cover again rather
+// than freeze the list.
+//
+// If either file fails its checks, the store starts empty. It is a cache:
+// everything in it can be decoded again.
+class ThumbnailStore
+{
+public:
+    static constexpr qint64 kDefaultMaxBytes = 192LL * 1024 * 1024;
+
+    explicit ThumbnailStore(const QString& directory, qint64 maxBytes = kDefaultMaxBytes);
+
+    // A copy of what `key` holds, or null. Marks it as just drawn. Null too
+    // while a compaction holds the store.
+    QImage find(const QString& key);
+    bool contains(const QString& key) const;
+
+    // Replaces whatever `key` held. Best-effort: if the write fails, the store
+    // stays as it was. Never compacts, however far past the cap it goes.
+    void insert(const QString& key, const QImage& image);
+
+    // Takes effect at the next compact().
+    void setMaxBytes(qint64 bytes);
+    qint64 maxBytes() const;
+
+    int count() const;
+    qint64 liveBytes() const;
+    qint64 dataBytes() const;   // the data file: live and dead
+
+    // Past the cap, or mostly dead bytes.
+    bool wantsCompaction() const;
+    void compact();
+    void clear();
+
+private:
+    struct IndexHeader;
+    struct Slot;
+
+    bool open();
+    void reset();
+    void compactLocked();
+    bool writeIndex(quint32 capacity, const QList<Slot>& slots, quint32 clock,
+                    quint64 dataBytes, quint64 liveBytes);
+    bool mapData();
+    void grow();
+    QList<Slot> liveSlots() const;
+
+    IndexHeader* header() const;
+    Slot* slots() const;
+    Slot* lookup(quint64 hash) const;
+    const uchar* record(const Slot& slot);
+
+    QString indexPath() const;
+    QString dataPath() const;
+
+    QString m_directory;
+    qint64 m_maxBytes;
+
+    // Over everything below: the mappings move when the files are rewritten.
+    mutable QMutex m_mutex;
+
+    QFile m_index;
+    uchar* m_indexMap = nullptr;   // null when the store could not open
+    QFile m_data;
+    uchar* m_dataMap = nullptr;
+    qint64 m_dataMapSize = 0;      // appended since is mapped on demand
+};
+
+#endif // THUMBNAILSTORE_H
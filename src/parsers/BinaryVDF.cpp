@@ -0,0 +1,239 @@
+#include "BinaryVDF.h"
+
+#include <QtEndian>
+
+#include <cstring>
+
+namespace {
+
+// Real files nest a handful of levels; the limit only stops a corrupt one
+// from recursing until the stack gives out.
+constexpr int kMaxDepth = 64;
+
+class Reader
+{
+public:
+    Reader(QByteArrayView data, const QList<QByteArray>& keys, QString* error)
+        : m_data(data)
+        , m_keys(keys)
+        , m_error(error)
+    {
+    }
+
+    bool readMap(VDFNode* node, int depth)
+    {
+        if (depth > kMaxDepth) {
+            return fail(QStringLiteral("Nested too deeply"));
+        }
+
+        while (m_pos < m_data.size()) {
+            const quint8 type = static_cast<quint8>(m_data.at(m_pos++));
+            if (type == BinaryVDF::End || type == BinaryVDF::EndAlt) {
+                return true;
+            }
+
+            QString key;
+            if (!readKey(&key)) {
+                return false;
+            }
+
+            VDFNode child;
+            switch (type) {
+            case BinaryVDF::Map:
+                if (!readMap(&child, depth + 1)) {
+                    return false;
+                }
+                break;
+            case BinaryVDF::String: {
+                QByteArrayView text;
+                if (!readCString(&text)) {
+                    return false;
+                }
+                // Left null when empty, as the text parser leaves `"k" ""`.
+                if (!text.isEmpty()) {
+                    child.setValue(QString::fromUtf8(text));
+                }
+                break;
+            }
+            case BinaryVDF::Int32:
+            case BinaryVDF::Pointer:
+            case BinaryVDF::Color: {
+                const char* p = take(4);
+                if (!p) {
+                    return false;
+                }
+                child.setValue(QString::number(qFromLittleEndian<qint32>(p)));
+                break;
+            }
+            case BinaryVDF::Float32: {
+                const char* p = take(4);
+                if (!p) {
+                    return false;
+                }
+                const quint32 bits = qFromLittleEndian<quint32>(p);
+                float value;
+                std::memcpy(&value, &bits, sizeof value);
+                child.setValue(QString::number(value));
+                break;
+            }
+            case BinaryVDF::UInt64: {
+                const char* p = take(8);
+                if (!p) {
+                    return false;
+                }
+                child.setValue(QString::number(qFromLittleEndian<quint64>(p)));
+                break;
+            }
+            case BinaryVDF::Int64: {
+                const char* p = take(8);
+                if (!p) {
+                    return false;
+                }
+                child.setValue(QString::number(qFromLittleEndian<qint64>(p)));
+                break;
+            }
+            case BinaryVDF::WString: {
+                QString text;
+                if (!readWString(&text)) {
+                    return false;
+                }
+                if (!text.isEmpty()) {
+                    child.setValue(text);
+                }
+                break;
+            }
+            default:
+                return fail(QStringLiteral("Unknown type 0x%1 at offset %2")
+                                .arg(type, 2, 16, QLatin1Char('0'))
+                                .arg(m_pos - 1));
+            }
+            node->setChild(key, child);
+        }
+
+        // Out of data without an end byte: how shortcuts.vdf and an appinfo
+        // section's outermost map may legitimately finish, and how a truncated
+        // file looks everywhere else.
+        if (depth > 0) {
+            return fail(QStringLiteral("Unexpected end of data"));
+        }
+        return true;
+    }
+
+private:
+    bool fail(const QString& message)
+    {
+        if (m_error) {
+            *m_error = message;
+        }
+        return false;
+    }
+
+    const char* take(qsizetype n)
+    {
+        if (m_data.size() - m_pos < n) {
+            fail(QStringLiteral("Unexpected end of data"));
+            return nullptr;
+        }
+        const char* p = m_data.data() + m_pos;
+        m_pos += n;
+        return p;
+    }
+
+    bool readCString(QByteArrayView* out)
+    {
+        const char* begin = m_data.data() + m_pos;
+        const void* nul = std::memchr(begin, '\0', m_data.size() - m_pos);
+        if (!nul) {
+            return fail(QStringLiteral("Unterminated string"));
+        }
+        const qsizetype length = static_cast<const char*>(nul) - begin;
+        *out = QByteArrayView(begin, length);
+        m_pos += length + 1;
+        return true;
+    }
+
+    bool readWString(QString* out)
+    {
+        QString text;
+        while (true) {
+            const char* p = take(2);
+            if (!p) {
+                return false;
+            }
+            const char16_t unit = qFromLittleEndian<quint16>(p);
+            if (unit == 0) {
+                break;
+            }
+            text += QChar(unit);
+        }
+        *out = text;
+        return true;
+    }
+
+    bool readKey(QString* key)
+    {
+        if (m_keys.isEmpty()) {
+            QByteArrayView text;
+            if (!readCString(&text)) {
+                return false;
+            }
+            *key = QString::fromUtf8(text);
+            return true;
+        }
+        const char* p = take(4);
+        if (!p) {
+            return false;
+        }
+        const quint32 index = qFromLittleEndian<quint32>(p);
+        if (index >= static_cast<quint32>(m_keys.size())) {
+            return fail(QStringLiteral("Key index %1 outside the string table").arg(index));
+        }
+        *key = QString::fromUtf8(m_keys.at(index));
+        return true;
+    }
+
+    QByteArrayView m_data;
+    const QList<QByteArray>& m_keys;
+    QString* m_error;
+    qsizetype m_pos = 0;
+};
+
+} // namespace
+
+namespace BinaryVDF {
+
+bool parse(QByteArrayView data, VDFNode* root, QString* error, const QList<QByteArray>& keys)
+{
+    Reader reader(data, keys, error);
+    return reader.readMap(root, 0);
+}
+
+QList<QByteArray> parseStringTable(QByteArrayView data)
+{
+    if (data.size() < 4) {
+        return {};
+    }
+    const quint32 count = qFromLittleEndian<quint32>(data.data());
+    // Every string is at least its NUL; a count the data cannot hold is
+    // corruption, not a reason to reserve gigabytes.
+    if (count > static_cast<quint32>(data.size() - 4)) {
+        return {};
+    }
+
+    QList<QByteArray> strings;
+    strings.reserve(count);
+    qsizetype pos = 4;
+    for (quint32 i = 0; i < count; ++i) {
+        const char* begin = data.data() + pos;
+        const void* nul = std::memchr(begin, '\0', data.size() - pos);
+        if (!nul) {
+            return {};
+        }
+        const qsizetype length = static_cast<const char*>(nul) - begin;
+        strings.append(QByteArray(begin, length));
+        pos += length + 1;
+    }
+    return strings;
+}
+
+} // namespace BinaryVDF
@@ -0,0 +1,51 @@
+#ifndef BINARYVDF_H
+#define BINARYVDF_H
+
+#include <QByteArray>
+#include <QByteArrayView>
+#include <QList>
+#include <QString>
+
+#include "VDFParser.h"
+
+// Valve's binary KeyValues, as in appcache/appinfo.vdf and userdata/<id>/
+// config/shortcuts.vdf.
+//
+// Each entry is a type byte, a key, and a value whose encoding the type says:
+// a nested map ended by an 0x08, a NUL-terminated UTF-8 string, a
+// little-endian integer or float. Decoded into the same VDFNode tree the text
+// parser builds, numbers as their decimal text, so getString()/getInt() read
+// both kinds of file alike.
+//
+// appinfo.vdf from v29 on keeps every key once, in a string table at the end
+// of the file, and an entry names its key by index into it; pass the table
+// as `keys`. Without one, keys are inline strings.
+namespace BinaryVDF {
+
+enum Type : quint8 {
+    Map       = 0x00,
+    String    = 0x01,
+    Int32     = 0x02,
+    Float32   = 0x03,
+    Pointer   = 0x04,
+    WString   = 0x05,
+    Color     = 0x06,
+    UInt64    = 0x07,
+    End       = 0x08,
+    Int64     = 0x0A,
+    EndAlt    = 0x0B,
+};
+
+// Decode the entries of one map, up to its end byte or the end of `data`,
+// into `root`'s children. False with `error` set on anything truncated or of
+// an unknown type; `root` is then incomplete.
+bool parse(QByteArrayView data, VDFNode* root, QString* error,
+           const QList<QByteArray>& keys = {});
+
+// A NUL-terminated string table as appinfo.vdf v29 lays it out: a uint32
+// count, then that many strings. Empty on anything malformed.
+QList<QByteArray> parseStringTable(QByteArrayView data);
+
+} // namespace BinaryVDF
+
+#endif // BINARYVDF_H
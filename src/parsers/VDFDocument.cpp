@@ -0,0 +1,295 @@
+#include "VDFDocument.h"
+#include "VDFParser.h"
+#include "VDFTokenizer.h"
+
+#include <QFile>
+
+#include <cstring>
+#include <limits>
+
+// --- VDFDocument ------------------------------------------------------------
+
+bool VDFDocument::parseFile(const QString& filePath)
+{
+    QFile file(filePath);
+    if (!file.open(QIODevice::ReadOnly)) {
+        m_bytes.clear();
+        m_nodes.clear();
+        m_error = "Cannot open file: " + filePath;
+        return false;
+    }
+    return parse(file.readAll());
+}
+
+bool VDFDocument::parse(const QByteArray& utf8)
+{
+    m_bytes = utf8;
+    m_nodes.clear();
+    m_error.clear();
+
+    // Offsets are 32-bit to keep a node small; nothing Steam writes is close.
+    if (m_bytes.size() > std::numeric_limits<qint32>::max()) {
+        return fail(QStringLiteral("File too large"));
+    }
+
+    // Rough, but it saves most of the regrowing: a key and value with their
+    // quotes and indentation come to a few dozen bytes.
+    m_nodes.reserve(m_bytes.size() / 32 + 1);
+    Node root;
+    root.flags = Object;
+    m_nodes.append(root);
+
+    struct Frame {
+        qint32 node;
+        qint32 lastChild;
+    };
+    QVector<Frame> stack;
+    stack.append({0, -1});
+
+    VDFTokenizer tokenizer(m_bytes);
+    using TokenType = VDFTokenizer::TokenType;
+
+    while (true) {
+        const VDFTokenizer::Token keyToken = tokenizer.next();
+
+        if (keyToken.type == TokenType::EndOfFile) {
+            if (stack.size() > 1) {
+                return fail(QStringLiteral("Unexpected end of file, expected '}'"));
+            }
+            return true;
+        }
+
+        if (keyToken.type == TokenType::CloseBrace && stack.size() > 1) {
+            stack.removeLast();
+            continue;
+        }
+
+        if (keyToken.type == TokenType::Error) {
+            return fail(tokenizer.errorString());
+        }
+
+        if (keyToken.type != TokenType::String) {
+            return fail("Expected string key at position " + QString::number(tokenizer.position()));
+        }
+
+        const VDFTokenizer::Token valueToken = tokenizer.next();
+        if (valueToken.type == TokenType::Error) {
+            return fail(tokenizer.errorString());
+        }
+        if (valueToken.type != TokenType::OpenBrace && valueToken.type != TokenType::String) {
+            return fail("Expected value or '{' at position " + QString::number(tokenizer.position()));
+        }
+
+        Node node;
+        node.keyBegin = keyToken.begin;
+        node.keyLength = keyToken.length;
+        if (keyToken.escaped) {
+            node.flags |= KeyEscaped;
+        }
+        if (valueToken.type == TokenType::OpenBrace) {
+            node.flags |= Object;
+        } else {
+            node.valueBegin = valueToken.begin;
+            node.valueLength = valueToken.length;
+            if (valueToken.escaped) {
+                node.flags |= ValueEscaped;
+            }
+        }
+
+        const qint32 index = m_nodes.size();
+        m_nodes.append(node);
+
+        Frame& parent = stack.last();
+        if (parent.lastChild < 0) {
+            m_nodes[parent.node].firstChild = index;
+        } else {
+            m_nodes[parent.lastChild].nextSibling = index;
+        }
+        parent.lastChild = index;
+        ++m_nodes[parent.node].childCount;
+
+        if (node.flags & Object) {
+            stack.append({index, -1});
+        }
+    }
+}
+
+VDFRef VDFDocument::root() const
+{
+    return m_nodes.isEmpty() ? VDFRef() : VDFRef(this, 0);
+}
+
+bool VDFDocument::fail(const QString& message)
+{
+    m_nodes.clear();
+    m_error = message;
+    return false;
+}
+
+QByteArrayView VDFDocument::view(qint32 begin, qint32 length) const
+{
+    return QByteArrayView(m_bytes.constData() + begin, length);
+}
+
+QString VDFDocument::decode(qint32 begin, qint32 length, bool escaped) const
+{
+    return VDFTokenizer::decode(view(begin, length), escaped);
+}
+
+bool VDFDocument::keyEquals(const Node& node, QByteArrayView key, bool caseInsensitive) const
+{
+    QByteArray decoded;
+    QByteArrayView mine = view(node.keyBegin, node.keyLength);
+    if (node.flags & KeyEscaped) {
+        decoded = VDFTokenizer::unescape(mine);
+        mine = decoded;
+    }
+    if (mine.size() != key.size()) {
+        return false;
+    }
+    if (caseInsensitive) {
+        return qstrnicmp(mine.data(), mine.size(), key.data(), key.size()) == 0;
+    }
+    return std::memcmp(mine.data(), key.data(), mine.size()) == 0;
+}
+
+// --- VDFRef -----------------------------------------------------------------
+
+bool VDFRef::isObject() const
+{
+    return m_doc && (m_doc->m_nodes.at(m_index).flags & VDFDocument::Object);
+}
+
+bool VDFRef::isValue() const
+{
+    return m_doc && !(m_doc->m_nodes.at(m_index).flags & VDFDocument::Object);
+}
+
+QByteArrayView VDFRef::rawKey() const
+{
+    if (!m_doc) {
+        return QByteArrayView();
+    }
+    const VDFDocument::Node& node = m_doc->m_nodes.at(m_index);
+    return m_doc->view(node.keyBegin, node.keyLength);
+}
+
+QString VDFRef::key() const
+{
+    if (!m_doc) {
+        return QString();
+    }
+    const VDFDocument::Node& node = m_doc->m_nodes.at(m_index);
+    return m_doc->decode(node.keyBegin, node.keyLength, node.flags & VDFDocument::KeyEscaped);
+}
+
+QByteArrayView VDFRef::rawValue() const
+{
+    if (!isValue()) {
+        return QByteArrayView();
+    }
+    const VDFDocument::Node& node = m_doc->m_nodes.at(m_index);
+    return m_doc->view(node.valueBegin, node.valueLength);
+}
+
+QString VDFRef::value() const
+{
+    if (!isValue()) {
+        return QString();
+    }
+    const VDFDocument::Node& node = m_doc->m_nodes.at(m_index);
+    return m_doc->decode(node.valueBegin, node.valueLength,
+                         node.flags & VDFDocument::ValueEscaped);
+}
+
+VDFRef VDFRef::child(QByteArrayView key) const
+{
+    if (!m_doc) {
+        return VDFRef();
+    }
+    // Walked to the end rather than stopping at the first: a repeated key
+    // replaced the earlier one in the old parser's map, and still does here.
+    qint32 found = -1;
+    for (qint32 i = m_doc->m_nodes.at(m_index).firstChild; i >= 0;
+         i = m_doc->m_nodes.at(i).nextSibling) {
+        if (m_doc->keyEquals(m_doc->m_nodes.at(i), key, false)) {
+            found = i;
+        }
+    }
+    return found < 0 ? VDFRef() : VDFRef(m_doc, found);
+}
+
+VDFRef VDFRef::childCaseInsensitive(QByteArrayView key) const
+{
+    const VDFRef exact = child(key);
+    if (exact.isValid() || !m_doc) {
+        return exact;
+    }
+    for (qint32 i = m_doc->m_nodes.at(m_index).firstChild; i >= 0;
+         i = m_doc->m_nodes.at(i).nextSibling) {
+        if (m_doc->keyEquals(m_doc->m_nodes.at(i), key, true)) {
+            return VDFRef(m_doc, i);
+        }
+    }
+    return VDFRef();
+}
+
+VDFRef VDFRef::firstChild() const
+{
+    if (!m_doc) {
+        return VDFRef();
+    }
+    const qint32 first = m_doc->m_nodes.at(m_index).firstChild;
+    return first < 0 ? VDFRef() : VDFRef(m_doc, first);
+}
+
+VDFRef VDFRef::nextSibling() const
+{
+    if (!m_doc) {
+        return VDFRef();
+    }
+    const qint32 next = m_doc->m_nodes.at(m_index).nextSibling;
+    return next < 0 ? VDFRef() : VDFRef(m_doc, next);
+}
+
+int VDFRef::childCount() const
+{
+    return m_doc ? m_doc->m_nodes.at(m_index).childCount : 0;
+}
+
+QString VDFRef::getString(QByteArrayView key, const QString& defaultValue) const
+{
+    const VDFRef found = child(key);
+    return found.isValue() ? found.value() : defaultValue;
+}
+
+qint64 VDFRef::getInt(QByteArrayView key, qint64 defaultValue) const
+{
+    const VDFRef found = child(key);
+    if (!found.isValue()) {
+        return defaultValue;
+    }
+    // Numbers never carry escapes worth decoding; converted from the bytes
+    // where they lie.
+    const QByteArrayView raw = found.rawValue();
+    bool ok = false;
+    const qint64 val = QByteArray::fromRawData(raw.data(), raw.size()).toLongLong(&ok);
+    return ok ? val : defaultValue;
+}
+
+VDFNode VDFRef::toNode() const
+{
+    VDFNode node;
+    if (isValue()) {
+        // An empty string is left null, which is what made the old parser's
+        // `"label" ""` neither value nor object.
+        if (!rawValue().isEmpty()) {
+            node.setValue(value());
+        }
+        return node;
+    }
+    for (VDFRef c = firstChild(); c.isValid(); c = c.nextSibling()) {
+        node.setChild(c.key(), c.toNode());
+    }
+    return node;
+}
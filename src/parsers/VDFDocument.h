@@ -0,0 +1,136 @@
+#ifndef VDFDOCUMENT_H
+#define VDFDOCUMENT_H
+
+#include <QByteArray>
+#include <QByteArrayView>
+#include <QString>
+#include <QVector>
+
+class VDFDocument;
+class VDFNode;
+
+// One node of a VDFDocument: the document and an index into its arena, so it
+// is two words to copy and looking something up copies nothing else.
+//
+// A default-constructed or not-found ref is invalid, and everything asked of
+// an invalid ref answers empty — child() of nothing is nothing — so a path can
+// be walked without a check at every step:
+//
+//   doc.root().child("AppState").getString("name")
+//
+// Unlike VDFNode, an empty string is a value and an empty block is an object:
+// these say what the file says. VDFNode's older answers are kept where they
+// are, in VDFParser.
+//
+// Only valid for as long as its document is alive and not re-parsed.
+class VDFRef {
+public:
+    VDFRef() = default;
+
+    bool isValid() const { return m_doc != nullptr; }
+    bool isObject() const;
+    bool isValue() const;
+
+    // Key and value as written, escapes and all, pointing into the document's
+    // bytes; and decoded. For a value the raw view is what to compare or
+    // convert when no escape is involved, which is almost always.
+    QByteArrayView rawKey() const;
+    QString key() const;
+    QByteArrayView rawValue() const;
+    QString value() const;
+
+    // The last child of that name, as the old parser's map would have kept
+    // it. Case-insensitively: an exact match if there is one, else the first
+    // that differs only in ASCII case — localconfig.vdf's casing changes
+    // between Steam versions.
+    VDFRef child(QByteArrayView key) const;
+    VDFRef childCaseInsensitive(QByteArrayView key) const;
+
+    // Children in file order:
+    //   for (VDFRef c = node.firstChild(); c.isValid(); c = c.nextSibling())
+    VDFRef firstChild() const;
+    VDFRef nextSibling() const;
+    int childCount() const;
+
+    // A child's value, or the default when it is missing or a block.
+    QString getString(QByteArrayView key, const QString& defaultValue = QString()) const;
+    qint64 getInt(QByteArrayView key, qint64 defaultValue = 0) const;
+
+    // This subtree as the VDFNode tree the old parser built.
+    VDFNode toNode() const;
+
+private:
+    friend class VDFDocument;
+    VDFRef(const VDFDocument* doc, int index) : m_doc(doc), m_index(index) {}
+
+    const VDFDocument* m_doc = nullptr;
+    int m_index = -1;
+};
+
+// A VDF file parsed where it lies.
+//
+// The old parser decoded the whole file into a QString, walked it a QChar at a
+// time, and built a QMap of QMaps with a QString for every key and value; a
+// 5 MB localconfig.vdf came to hundreds of thousands of allocations before the
+// one launch option anyone wanted was looked at. Here the bytes stay as they
+// are and a node is a record in one flat vector — where its key and value sit
+// in the bytes, its first child, its next sibling. A QString is made when a
+// caller asks for one, and only for what it asks for.
+//
+// The dialect is VDFParser's, byte for byte; VDFTokenizer has it. Nesting is
+// walked with an explicit stack, so a hostile file cannot run it out of call
+// stack.
+//
+// The document keeps a reference to the bytes it was given and never copies
+// them. parse() takes a QByteArray::fromRawData() over a mapping as readily as
+// an owned array, as long as the mapping outlives the document.
+class VDFDocument {
+public:
+    VDFDocument() = default;
+
+    bool parse(const QByteArray& utf8);
+
+    // Read rather than mapped: Steam rewrites these files in place while it
+    // runs, and a mapped file truncated under a reader is a SIGBUS. One read
+    // into one array is the only copy made.
+    bool parseFile(const QString& filePath);
+
+    // The unnamed block holding the file's top-level keys. Invalid until a
+    // parse succeeds.
+    VDFRef root() const;
+
+    int nodeCount() const { return m_nodes.size(); }
+    QString errorString() const { return m_error; }
+
+private:
+    friend class VDFRef;
+
+    enum Flag : quint8 {
+        Object       = 0x1,
+        KeyEscaped   = 0x2,
+        ValueEscaped = 0x4,
+    };
+
+    struct Node {
+        qint32 keyBegin = 0;
+        qint32 keyLength = 0;
+        qint32 valueBegin = 0;
+        qint32 valueLength = 0;
+        qint32 firstChild = -1;
+        qint32 nextSibling = -1;
+        qint32 childCount = 0;
+        quint8 flags = 0;
+    };
+
+    bool fail(const QString& message);
+
+    QByteArrayView view(qint32 begin, qint32 length) const;
+    QString decode(qint32 begin, qint32 length, bool escaped) const;
+    bool keyEquals(const Node& node, QByteArrayView key, bool caseInsensitive) const;
+
+    QByteArray m_bytes;
+    QVector<Node> m_nodes;
+    QString m_error;
+};
+
+#endif // VDFDOCUMENT_H
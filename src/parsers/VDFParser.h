@@ -5,6 +5,8 @@
 #include <QVariant>
 #include <QMap>
 
+#include "VDFDocument.h"
+
 // VDF (Valve Data Format) parser
 // Parses files like appmanifest_*.acf, libraryfolders.vdf, config.vdf
 
@@ -33,6 +35,13 @@ private:
     QMap<QString, VDFNode> m_children;
 };
 
+// The VDFNode tree the app has always used, now built from a VDFDocument: the
+// same dialect and the same answers, quirks included (tst_vdfparser pins
+// them). The tree is only built when root() is first asked for, so code that
+// goes straight to document() pays for none of it.
+//
+// Prefer VDFDocument for anything read often or from a large file: root()
+// still makes a QString and a map entry for every key in the file.
 class VDFParser {
 public:
     VDFParser() = default;
@@ -40,31 +49,14 @@ public:
     bool parse(const QString& content);
     bool parseFile(const QString& filePath);
 
-    VDFNode root() const { return m_root; }
-    QString errorString() const { return m_error; }
+    VDFNode root() const;
+    const VDFDocument& document() const { return m_document; }
+    QString errorString() const { return m_document.errorString(); }
 
 private:
-    enum class TokenType {
-        String,
-        OpenBrace,
-        CloseBrace,
-        EndOfFile,
-        Error
-    };
-
-    struct Token {
-        TokenType type;
-        QString value;
-    };
-
-    Token nextToken();
-    bool parseNode(VDFNode& node);
-    void skipWhitespace();
-
-    QString m_content;
-    int m_pos = 0;
-    VDFNode m_root;
-    QString m_error;
+    VDFDocument m_document;
+    mutable VDFNode m_root;
+    mutable bool m_rootBuilt = false;
 };
 
 #endif // VDFPARSER_H
@@ -0,0 +1,221 @@
+#include "VDFQuery.h"
+#include "VDFTokenizer.h"
+
+#include <QFile>
+#include <QVarLengthArray>
+
+#include <cstring>
+#include <limits>
+
+namespace {
+
+// Which paths are still live at each level is a bit each, so a level costs
+// one word on the stack and a key is tested only against what can match it.
+constexpr int kMaxPaths = 64;
+
+} // namespace
+
+VDFQuery::VDFQuery(const QStringList& paths, Qt::CaseSensitivity keyCase)
+    : m_keyCase(keyCase)
+{
+    Q_ASSERT(paths.size() <= kMaxPaths);
+    for (const QString& text : paths.mid(0, kMaxPaths)) {
+        if (m_index.contains(text)) {
+            continue;
+        }
+        Path path;
+        path.text = text;
+        const QStringList components = text.split('/', Qt::SkipEmptyParts);
+        for (int i = 0; i < components.size(); ++i) {
+            path.components << components.at(i).toUtf8();
+            if (components.at(i) == QLatin1String("*") && path.firstWildcard < 0) {
+                path.firstWildcard = i;
+            }
+        }
+        if (path.components.isEmpty()) {
+            continue;
+        }
+        m_index.insert(text, m_paths.size());
+        m_paths.append(path);
+    }
+}
+
+bool VDFQuery::runFile(const QString& filePath)
+{
+    QFile file(filePath);
+    if (!file.open(QIODevice::ReadOnly)) {
+        for (Path& path : m_paths) {
+            path.matches.clear();
+        }
+        m_stoppedEarly = false;
+        return fail("Cannot open file: " + filePath);
+    }
+    const QByteArray bytes = file.readAll();
+    return run(bytes);
+}
+
+bool VDFQuery::run(QByteArrayView utf8)
+{
+    for (Path& path : m_paths) {
+        path.matches.clear();
+    }
+    m_stoppedEarly = false;
+    m_error.clear();
+
+    if (utf8.size() > std::numeric_limits<qint32>::max()) {
+        return fail(QStringLiteral("File too large"));
+    }
+
+    using TokenType = VDFTokenizer::TokenType;
+    const quint64 all = m_paths.size() == kMaxPaths
+        ? ~quint64(0)
+        : (quint64(1) << m_paths.size()) - 1;
+    quint64 settled = 0;
+
+    // The paths still live inside each open block, the file itself first.
+    QVarLengthArray<quint64, 16> stack;
+    stack.append(all);
+
+    VDFTokenizer tokenizer(utf8);
+
+    while (true) {
+        if (settled == all) {
+            m_stoppedEarly = true;
+            return true;
+        }
+
+        const VDFTokenizer::Token keyToken = tokenizer.next();
+
+        if (keyToken.type == TokenType::EndOfFile) {
+            if (stack.size() > 1) {
+                return fail(QStringLiteral("Unexpected end of file, expected '}'"));
+            }
+            return true;
+        }
+
+        if (keyToken.type == TokenType::CloseBrace && stack.size() > 1) {
+            // A path that ran through this block and has no * above it
+            // cannot match anywhere else now.
+            const int depth = stack.size() - 1;
+            const quint64 live = stack.last();
+            for (int i = 0; i < m_paths.size(); ++i) {
+                const int wildcard = m_paths.at(i).firstWildcard;
+                if ((live & (quint64(1) << i)) && (wildcard < 0 || wildcard >= depth)) {
+                    settled |= quint64(1) << i;
+                }
+            }
+            stack.removeLast();
+            continue;
+        }
+
+        if (keyToken.type == TokenType::Error) {
+            return fail(tokenizer.errorString());
+        }
+
+        if (keyToken.type != TokenType::String) {
+            return fail("Expected string key at position " + QString::number(tokenizer.position()));
+        }
+
+        const VDFTokenizer::Token valueToken = tokenizer.next();
+        if (valueToken.type == TokenType::Error) {
+            return fail(tokenizer.errorString());
+        }
+        if (valueToken.type != TokenType::OpenBrace && valueToken.type != TokenType::String) {
+            return fail("Expected value or '{' at position " + QString::number(tokenizer.position()));
+        }
+
+        const bool isBlock = valueToken.type == TokenType::OpenBrace;
+        const int depth = stack.size() - 1;
+        const quint64 live = stack.last() & ~settled;
+        quint64 inside = 0;
+
+        for (int i = 0; i < m_paths.size(); ++i) {
+            if (!(live & (quint64(1) << i))) {
+                continue;
+            }
+            Path& path = m_paths[i];
+            if (!matches(path, depth, tokenizer.text(keyToken), keyToken.escaped)) {
+                continue;
+            }
+            if (depth + 1 == path.components.size()) {
+                path.matches << (isBlock ? QString()
+                                         : VDFTokenizer::decode(tokenizer.text(valueToken),
+                                                                valueToken.escaped));
+                if (path.firstWildcard < 0) {
+                    settled |= quint64(1) << i;
+                }
+            } else if (isBlock) {
+                inside |= quint64(1) << i;
+            }
+        }
+
+        if (!isBlock) {
+            continue;
+        }
+        if (inside == 0) {
+            if (!tokenizer.skipBlock()) {
+                return fail(tokenizer.errorString());
+            }
+            continue;
+        }
+        stack.append(inside);
+    }
+}
+
+bool VDFQuery::matches(const Path& path, int depth, QByteArrayView key, bool escaped) const
+{
+    const QByteArray& want = path.components.at(depth);
+    if (want == "*") {
+        return true;
+    }
+
+    QByteArray decoded;
+    if (escaped) {
+        decoded = VDFTokenizer::unescape(key);
+        key = decoded;
+    }
+    if (key.size() != want.size()) {
+        return false;
+    }
+    if (m_keyCase == Qt::CaseInsensitive) {
+        return qstrnicmp(key.data(), key.size(), want.constData(), want.size()) == 0;
+    }
+    return std::memcmp(key.data(), want.constData(), key.size()) == 0;
+}
+
+bool VDFQuery::fail(const QString& message)
+{
+    m_error = message;
+    return false;
+}
+
+bool VDFQuery::contains(const QString& path) const
+{
+    const int i = m_index.value(path, -1);
+    return i >= 0 && !m_paths.at(i).matches.isEmpty();
+}
+
+QString VDFQuery::value(const QString& path, const QString& defaultValue) const
+{
+    const int i = m_index.value(path, -1);
+    if (i < 0 || m_paths.at(i).matches.isEmpty()) {
+        return defaultValue;
+    }
+    return m_paths.at(i).matches.first();
+}
+
+qint64 VDFQuery::intValue(const QString& path, qint64 defaultValue) const
+{
+    if (!contains(path)) {
+        return defaultValue;
+    }
+    bool ok = false;
+    const qint64 val = value(path).toLongLong(&ok);
+    return ok ? val : defaultValue;
+}
+
+QStringList VDFQuery::values(const QString& path) const
+{
+    const int i = m_index.value(path, -1);
+    return i < 0 ? QStringList() : m_paths.at(i).matches;
+}
@@ -0,0 +1,82 @@
+#ifndef VDFQUERY_H
+#define VDFQUERY_H
+
+#include <QByteArray>
+#include <QByteArrayView>
+#include <QHash>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+// A handful of values out of a VDF file, read in one pass and nothing kept
+// but those values.
+//
+// Most reads want two or three keys: a manifest's StateFlags and buildid for
+// the update badge, one app's LaunchOptions out of a localconfig.vdf of
+// several megabytes. Paths say what is wanted, a component per level:
+//
+//   VDFQuery query({"AppState/StateFlags", "AppState/buildid"});
+//   if (query.runFile(manifestPath)) {
+//       const qint64 buildId = query.intValue("AppState/buildid");
+//   }
+//
+// A block no path goes into is stepped over by counting braces, without a
+// token being made of anything in it. And the read stops as soon as nothing
+// it has not seen could still turn up: when every path has its value, or
+// when the block a path ran through has closed without it. For
+// localconfig.vdf that is the end of one app's block, not of the file.
+//
+// A component of * matches any key, and a path with one collects every match
+// in file order — "libraryfolders/*/path" is all of a Steam install's library
+// paths. Such a path is only settled when the block holding the * closes.
+//
+// A path may end at a block, to ask whether it is there: contains() answers,
+// and its value is null.
+//
+// Only the first match of a path without * is kept. The old tree parser kept
+// the last, but Steam never writes a key twice, and stopping early is the
+// point.
+//
+// Errors are the tree parser's in everything that is read. What is skipped is
+// not checked: a truncated or broken block nobody asked about does not fail
+// the query — nor does a file cut short after every answer was found.
+class VDFQuery {
+public:
+    explicit VDFQuery(const QStringList& paths,
+                      Qt::CaseSensitivity keyCase = Qt::CaseSensitive);
+
+    bool run(QByteArrayView utf8);
+
+    // Read into memory rather than mapped, for VDFDocument's reason.
+    bool runFile(const QString& filePath);
+
+    bool contains(const QString& path) const;
+    // The first match, or the default.
+    QString value(const QString& path, const QString& defaultValue = QString()) const;
+    qint64 intValue(const QString& path, qint64 defaultValue = 0) const;
+    // Every match, in file order.
+    QStringList values(const QString& path) const;
+
+    // Whether the last run settled every path before the end of the file.
+    bool stoppedEarly() const { return m_stoppedEarly; }
+    QString errorString() const { return m_error; }
+
+private:
+    struct Path {
+        QString text;
+        QList<QByteArray> components;
+        int firstWildcard = -1;     // index of the first *, or -1
+        QStringList matches;
+    };
+
+    bool matches(const Path& path, int depth, QByteArrayView key, bool escaped) const;
+    bool fail(const QString& message);
+
+    QVector<Path> m_paths;
+    QHash<QString, int> m_index;
+    Qt::CaseSensitivity m_keyCase;
+    bool m_stoppedEarly = false;
+    QString m_error;
+};
+
+#endif // VDFQUERY_H
@@ -0,0 +1,198 @@
+#include "VDFTokenizer.h"
+
+namespace {
+
+bool isSpace(char c)
+{
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\v' || c == '\f';
+}
+
+// A bare key is letters, digits and underscores to begin with. Bytes above
+// ASCII are the pieces of a UTF-8 letter; the old parser decoded first and
+// asked QChar, and in Valve's files a non-ASCII byte outside quotes is never
+// anything but a letter.
+bool isBareStart(char c)
+{
+    const uchar u = static_cast<uchar>(c);
+    return (u >= 'a' && u <= 'z') || (u >= 'A' && u <= 'Z') || (u >= '0' && u <= '9')
+        || u == '_' || u >= 0x80;
+}
+
+bool isBare(char c)
+{
+    return isBareStart(c) || c == '-' || c == '.';
+}
+
+} // namespace
+
+VDFTokenizer::VDFTokenizer(QByteArrayView bytes)
+    : m_bytes(bytes)
+{
+    // QTextStream dropped a byte-order mark, and so does this.
+    if (m_bytes.size() >= 3 && m_bytes.at(0) == '\xEF' && m_bytes.at(1) == '\xBB'
+        && m_bytes.at(2) == '\xBF') {
+        m_pos = 3;
+    }
+}
+
+void VDFTokenizer::skipWhitespace()
+{
+    const char* data = m_bytes.data();
+    const qint32 size = static_cast<qint32>(m_bytes.size());
+
+    while (m_pos < size) {
+        if (isSpace(data[m_pos])) {
+            ++m_pos;
+            continue;
+        }
+
+        // Skip // comments
+        if (data[m_pos] == '/' && m_pos + 1 < size && data[m_pos + 1] == '/') {
+            while (m_pos < size && data[m_pos] != '\n') {
+                ++m_pos;
+            }
+            continue;
+        }
+
+        break;
+    }
+}
+
+// From just inside an opening quote to just past the closing one.
+bool VDFTokenizer::skipQuoted()
+{
+    const char* data = m_bytes.data();
+    const qint32 size = static_cast<qint32>(m_bytes.size());
+
+    while (m_pos < size) {
+        if (data[m_pos] == '"') {
+            ++m_pos;
+            return true;
+        }
+        if (data[m_pos] == '\\' && m_pos + 1 < size) {
+            ++m_pos;
+        }
+        ++m_pos;
+    }
+    return false;
+}
+
+VDFTokenizer::Token VDFTokenizer::next()
+{
+    skipWhitespace();
+
+    const char* data = m_bytes.data();
+    const qint32 size = static_cast<qint32>(m_bytes.size());
+    Token token;
+
+    if (m_pos >= size) {
+        token.type = TokenType::EndOfFile;
+        return token;
+    }
+
+    const char c = data[m_pos];
+
+    if (c == '{' || c == '}') {
+        token.type = c == '{' ? TokenType::OpenBrace : TokenType::CloseBrace;
+        token.begin = m_pos++;
+        token.length = 1;
+        return token;
+    }
+
+    if (c == '"') {
+        token.begin = ++m_pos;
+        while (m_pos < size) {
+            if (data[m_pos] == '"') {
+                token.type = TokenType::String;
+                token.length = m_pos - token.begin;
+                ++m_pos;
+                return token;
+            }
+            if (data[m_pos] == '\\' && m_pos + 1 < size) {
+                token.escaped = true;
+                ++m_pos;
+            }
+            ++m_pos;
+        }
+        m_error = QStringLiteral("Unterminated string");
+        return token;
+    }
+
+    // Unquoted string (some VDF files use unquoted keys)
+    if (isBareStart(c)) {
+        token.type = TokenType::String;
+        token.begin = m_pos;
+        while (m_pos < size && isBare(data[m_pos])) {
+            ++m_pos;
+        }
+        token.length = m_pos - token.begin;
+        return token;
+    }
+
+    m_error = QString("Unexpected character '%1' at position %2")
+                  .arg(QChar::fromLatin1(c))
+                  .arg(m_pos);
+    return token;
+}
+
+bool VDFTokenizer::skipBlock()
+{
+    const char* data = m_bytes.data();
+    const qint32 size = static_cast<qint32>(m_bytes.size());
+    int depth = 1;
+
+    while (m_pos < size) {
+        const char c = data[m_pos];
+        if (c == '"') {
+            ++m_pos;
+            if (!skipQuoted()) {
+                break;
+            }
+            continue;
+        }
+        if (c == '/' && m_pos + 1 < size && data[m_pos + 1] == '/') {
+            while (m_pos < size && data[m_pos] != '\n') {
+                ++m_pos;
+            }
+            continue;
+        }
+        ++m_pos;
+        if (c == '{') {
+            ++depth;
+        } else if (c == '}' && --depth == 0) {
+            return true;
+        }
+    }
+
+    m_error = QStringLiteral("Unexpected end of file, expected '}'");
+    return false;
+}
+
+QByteArrayView VDFTokenizer::text(const Token& token) const
+{
+    return QByteArrayView(m_bytes.data() + token.begin, token.length);
+}
+
+QByteArray VDFTokenizer::unescape(QByteArrayView raw)
+{
+    QByteArray out;
+    out.reserve(raw.size());
+    for (qsizetype i = 0; i < raw.size(); ++i) {
+        char c = raw.at(i);
+        if (c == '\\' && i + 1 < raw.size()) {
+            c = raw.at(++i);
+            if (c == 'n') {
+                c = '\n';
+            } else if (c == 't') {
+                c = '\t';
+            }
+        }
+        out += c;
+    }
+    return out;
+}
+
+QString VDFTokenizer::decode(QByteArrayView raw, bool escaped)
+{
+    return escaped ? QString::fromUtf8(unescape(raw)) : QString::fromUtf8(raw);
+}
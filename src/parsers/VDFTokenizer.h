@@ -0,0 +1,62 @@
+#ifndef VDFTOKENIZER_H
+#define VDFTOKENIZER_H
+
+#include <QByteArray>
+#include <QByteArrayView>
+#include <QString>
+
+// The VDF dialect at the byte level, shared by VDFDocument, which keeps every
+// node, and VDFQuery, which keeps almost none.
+//
+// Quoted strings with \n \t \\ \" escapes (any other escape keeps the
+// character and drops the backslash), bare strings of letters, digits and
+// _ - ., // comments to the end of the line, a leading UTF-8 byte-order mark
+// ignored. A string token is the span of bytes it covers, escapes left in
+// place: decoding is for whoever wants the text.
+//
+// Works over a view; the bytes must outlive it.
+class VDFTokenizer {
+public:
+    enum class TokenType {
+        String,
+        OpenBrace,
+        CloseBrace,
+        EndOfFile,
+        Error
+    };
+
+    struct Token {
+        TokenType type = TokenType::Error;
+        qint32 begin = 0;
+        qint32 length = 0;
+        bool escaped = false;
+    };
+
+    explicit VDFTokenizer(QByteArrayView bytes);
+
+    Token next();
+
+    // Just after an opening brace, move past its matching close without
+    // making a token of anything in between. Only braces, quotes and comments
+    // are looked at, so what is skipped is not checked either: a malformed
+    // block nobody asked about does not fail the read. False if the file
+    // ends first.
+    bool skipBlock();
+
+    qint32 position() const { return m_pos; }
+    QByteArrayView text(const Token& token) const;
+    QString errorString() const { return m_error; }
+
+    static QByteArray unescape(QByteArrayView raw);
+    static QString decode(QByteArrayView raw, bool escaped);
+
+private:
+    void skipWhitespace();
+    bool skipQuoted();
+
+    QByteArrayView m_bytes;
+    qint32 m_pos = 0;
+    QString m_error;
+};
+
+#endif // VDFTOKENIZER_H
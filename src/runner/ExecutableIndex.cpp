@@ -0,0 +1,661 @@
+#include "ExecutableIndex.h"
+#include "network/JsonDiskCache.h"
+
+#include <QCoreApplication>
+#include <QDateTime>
+#include <QDir>
+#include <QDirIterator>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QMutexLocker>
+#include <QSaveFile>
+#include <QtConcurrent>
+#include <QtEndian>
+
+#include <algorithm>
+#include <utility>
+
+namespace {
+
+// Bumped when the ranking changes, so an old file is a clean miss rather than
+// yesterday's answer.
+constexpr int kFormatVersion = 1;
+
+// Enough of each file for its headers; a PE header past this is rare enough
+// to be ranked as an unknown PE.
+constexpr qint64 kHeadBytes = 4096;
+
+// Candidates kept per platform. The first that still exists is the answer;
+// the rest are there for a file that went away without the stamp moving.
+constexpr int kKept = 16;
+
+// Files that are never the game, wherever they are. The list GameRunner has
+// always skipped by.
+const char* const kWindowsNameRejects[] = {
+    "unins", "setup", "install", "crash", "report", "launcher", "redist", "vcredist",
+    "directx", "dotnet", "easyanticheat", "battleye", "regroup", "tts", "voice",
+};
+const char* const kLinuxNameRejects[] = {"uninstall", "setup", "crash"};
+
+// Directories whose contents are never the game: Steam's and publishers'
+// redistributable drops, anti-cheat installers.
+const char* const kDirectoryRejects[] = {
+    "_commonredist", "commonredist", "redist", "redistributables", "__installer",
+    "installer", "directx", "dotnet", "vcredist", "easyanticheat", "battleye",
+};
+
+qint64 directoryStamp(const QString& installPath)
+{
+    const QFileInfo info(installPath);
+    return info.isDir() ? info.lastModified().toMSecsSinceEpoch() : 0;
+}
+
+bool rejectedByName(const QString& relativePath, ExecutableIndex::Platform platform)
+{
+    const QString lower = relativePath.toLower();
+    const qsizetype slash = lower.lastIndexOf('/');
+    const QString fileName = lower.mid(slash + 1);
+
+    const QStringList directories = lower.left(slash < 0 ? 0 : slash).split('/', Qt::SkipEmptyParts);
+    for (const QString& directory : directories) {
+        for (const char* reject : kDirectoryRejects) {
+            if (directory == QLatin1String(reject)) {
+                return true;
+            }
+        }
+    }
+
+    if (platform == ExecutableIndex::Platform::Windows) {
+        if (!fileName.endsWith(".exe")) {
+            return true;
+        }
+        for (const char* reject : kWindowsNameRejects) {
+            if (fileName.contains(QLatin1String(reject))) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    if (fileName.endsWith(".sh") || fileName.endsWith(".py") || fileName.endsWith(".so")
+        || fileName.contains(".so.") || fileName.endsWith(".exe") || fileName.endsWith(".dll")) {
+        return true;
+    }
+    for (const char* reject : kLinuxNameRejects) {
+        if (fileName.contains(QLatin1String(reject))) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// The names a game's executable tends to go by: its title without spaces,
+// with underscores or dashes for them, and its install directory's name.
+QStringList nameVariants(const Game& game)
+{
+    const QString name = game.name().toLower();
+    QString noSpaces = name;
+    noSpaces.remove(' ');
+    QString underscored = name;
+    underscored.replace(' ', '_');
+    QString dashed = name;
+    dashed.replace(' ', '-');
+
+    QStringList variants{name, noSpaces, underscored, dashed,
+                         QFileInfo(game.installPath()).fileName().toLower()};
+    variants.removeAll(QString());
+    variants.removeDuplicates();
+    return variants;
+}
+
+ExecutableIndex::BinaryInfo inspectFile(const QString& path)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return {};
+    }
+    return ExecutableIndex::inspect(file.read(kHeadBytes));
+}
+
+QJsonArray toJson(const QStringList& list)
+{
+    QJsonArray array;
+    for (const QString& item : list) {
+        array.append(item);
+    }
+    return array;
+}
+
+QStringList fromJson(const QJsonValue& value)
+{
+    QStringList list;
+    for (const QJsonValue& item : value.toArray()) {
+        if (!item.toString().isEmpty()) {
+            list << item.toString();
+        }
+    }
+    return list;
+}
+
+} // namespace
+
+ExecutableIndex& ExecutableIndex::instance()
+{
+    static ExecutableIndex index(filePath());
+    // The pass runs on the global pool, which the exit waits for.
+    static const bool stopsAtQuit = [] {
+        if (QCoreApplication* app = QCoreApplication::instance()) {
+            QObject::connect(app, &QCoreApplication::aboutToQuit, app, [] {
+                index.cancel();
+            });
+        }
+        return true;
+    }();
+    Q_UNUSED(stopsAtQuit);
+    return index;
+}
+
+ExecutableIndex::ExecutableIndex(const QString& path)
+    : m_path(path)
+{
+}
+
+ExecutableIndex::~ExecutableIndex()
+{
+    cancel();
+    QFuture<void> refresh;
+    {
+        QMutexLocker locker(&m_mutex);
+        refresh = m_refreshFuture;
+    }
+    refresh.waitForFinished();
+}
+
+QString ExecutableIndex::filePath()
+{
+    return JsonDiskCache::directory("runner") + "/executables.json";
+}
+
+ExecutableIndex::BinaryInfo ExecutableIndex::inspect(QByteArrayView head)
+{
+    BinaryInfo info;
+    const char* data = head.data();
+    const qsizetype size = head.size();
+
+    if (size >= 2 && data[0] == '#' && data[1] == '!') {
+        info.format = BinaryInfo::Format::Script;
+        return info;
+    }
+
+    if (size >= 64 && data[0] == 'M' && data[1] == 'Z') {
+        const quint32 peOffset = qFromLittleEndian<quint32>(data + 0x3C);
+        // The COFF header, and the optional header as far as its subsystem.
+        if (peOffset > static_cast<quint32>(size) || size - peOffset < 24 + 70) {
+            // Past what was read, or not a PE at all. An MZ with a .exe name
+            // is still worth ranking, low.
+            info.format = BinaryInfo::Format::PE;
+            return info;
+        }
+        const char* pe = data + peOffset;
+        if (pe[0] != 'P' || pe[1] != 'E' || pe[2] != 0 || pe[3] != 0) {
+            return info;    // a DOS program, or a 16-bit one
+        }
+        info.format = BinaryInfo::Format::PE;
+        const quint16 machine = qFromLittleEndian<quint16>(pe + 4);
+        const quint16 characteristics = qFromLittleEndian<quint16>(pe + 22);
+        const quint16 magic = qFromLittleEndian<quint16>(pe + 24);
+        const quint16 subsystem = qFromLittleEndian<quint16>(pe + 24 + 68);
+        info.is64 = magic == 0x20b || machine == 0x8664 || machine == 0xAA64;
+        info.library = (characteristics & 0x2000) != 0;     // IMAGE_FILE_DLL
+        info.console = subsystem == 3;                       // WINDOWS_CUI
+        return info;
+    }
+
+    if (size >= 20 && data[0] == '\x7f' && data[1] == 'E' && data[2] == 'L' && data[3] == 'F') {
+        info.format = BinaryInfo::Format::ELF;
+        info.is64 = data[4] == 2;
+        const bool little = data[5] == 1;
+        auto u16 = [little](const char* p) {
+            return little ? qFromLittleEndian<quint16>(p) : qFromBigEndian<quint16>(p);
+        };
+        auto u32 = [little](const char* p) {
+            return little ? qFromLittleEndian<quint32>(p) : qFromBigEndian<quint32>(p);
+        };
+        auto u64 = [little](const char* p) {
+            return little ? qFromLittleEndian<quint64>(p) : qFromBigEndian<quint64>(p);
+        };
+
+        const quint16 type = u16(data + 16);
+        if (type != 2 && type != 3) {   // ET_EXEC, ET_DYN
+            info.library = true;
+            return info;
+        }
+        if (type == 2) {
+            return info;
+        }
+
+        // ET_DYN is both a PIE executable and a shared object; only the
+        // executable asks for an interpreter.
+        const qsizetype headerSize = info.is64 ? 64 : 52;
+        if (size < headerSize) {
+            return info;
+        }
+        const quint64 phoff = info.is64 ? u64(data + 32) : u32(data + 28);
+        const quint16 phentsize = u16(data + (info.is64 ? 54 : 42));
+        const quint16 phnum = u16(data + (info.is64 ? 56 : 44));
+        if (phentsize < 4 || phoff + quint64(phentsize) * phnum > quint64(size)) {
+            return info;    // not in what was read: give it the benefit of the doubt
+        }
+        bool interpreter = false;
+        for (quint16 i = 0; i < phnum; ++i) {
+            if (u32(data + phoff + quint64(i) * phentsize) == 3) {    // PT_INTERP
+                interpreter = true;
+                break;
+            }
+        }
+        info.library = !interpreter;
+        return info;
+    }
+
+    return info;
+}
+
+int ExecutableIndex::score(const QString& relativePath, const BinaryInfo& info, qint64 size,
+                           const Game& game, Platform platform)
+{
+    if (rejectedByName(relativePath, platform)) {
+        return kRejected;
+    }
+
+    int score = 0;
+    if (platform == Platform::Windows) {
+        if (info.library) {
+            return kRejected;
+        }
+        if (info.format == BinaryInfo::Format::PE) {
+            score += info.is64 ? 100 : -100;
+            if (info.console) {
+                score -= 150;
+            }
+        } else {
+            // Unreadable, or not a PE at all. The old walk took any *.exe, so
+            // it stays a candidate, behind everything that is one.
+            score -= 300;
+        }
+    } else {
+        if (info.library) {
+            return kRejected;
+        }
+        switch (info.format) {
+        case BinaryInfo::Format::ELF:    score += info.is64 ? 100 : -100; break;
+        case BinaryInfo::Format::Script: score -= 50; break;
+        default:                         return kRejected;
+        }
+        if (relativePath.contains("x86_64") || relativePath.contains("x64")) {
+            score += 50;
+        }
+    }
+
+    // The name, above all: the old search took a match at any depth over
+    // anything shallower.
+    const QString fileName = QFileInfo(relativePath).fileName().toLower();
+    const QString baseName = platform == Platform::Windows ? QFileInfo(relativePath).completeBaseName().toLower()
+                                                           : fileName;
+    const QStringList variants = nameVariants(game);
+    if (variants.contains(baseName)) {
+        score += 400;
+    } else {
+        for (const QString& variant : variants) {
+            if (baseName.contains(variant) || (baseName.size() >= 3 && variant.contains(baseName))) {
+                score += 200;
+                break;
+            }
+        }
+    }
+
+    // Shallower is likelier; bigger is likelier, up to a point.
+    score -= 25 * static_cast<int>(relativePath.count('/'));
+    score += 10 * static_cast<int>(std::min<qint64>(size / (10 * 1024 * 1024), 10));
+    return score;
+}
+
+ExecutableIndex::Entry ExecutableIndex::scan(const Game& game, const std::atomic_bool* cancel)
+{
+    Entry entry;
+    entry.buildId = game.buildId();
+    entry.dirStamp = directoryStamp(game.installPath());
+    if (entry.dirStamp == 0) {
+        return entry;
+    }
+
+    struct Ranked {
+        QString path;
+        int score;
+    };
+    QList<Ranked> windows;
+    QList<Ranked> native;
+
+    const QDir root(game.installPath());
+    QDirIterator it(game.installPath(), QDir::Files, QDirIterator::Subdirectories);
+    while (it.hasNext()) {
+        if (cancel && cancel->load()) {
+            entry.dirStamp = 0;
+            return entry;
+        }
+        it.next();
+        const QFileInfo info = it.fileInfo();
+        const bool isExe = info.fileName().endsWith(".exe", Qt::CaseInsensitive);
+        if (!isExe && !info.isExecutable()) {
+            continue;
+        }
+
+        const Platform platform = isExe ? Platform::Windows : Platform::Linux;
+        const QString relative = root.relativeFilePath(info.filePath());
+        // Before opening it: on a mount where every file is executable, this
+        // is what keeps the walk from reading the whole game.
+        if (rejectedByName(relative, platform)) {
+            continue;
+        }
+        const int rank = score(relative, inspectFile(info.filePath()), info.size(), game, platform);
+        if (rank == kRejected) {
+            continue;
+        }
+        (isExe ? windows : native).append({relative, rank});
+    }
+
+    auto ranked = [](QList<Ranked>& list) {
+        std::sort(list.begin(), list.end(), [](const Ranked& a, const Ranked& b) {
+            if (a.score != b.score) {
+                return a.score > b.score;
+            }
+            return a.path < b.path;
+        });
+        QStringList paths;
+        for (int i = 0; i < list.size() && i < kKept; ++i) {
+            paths << list.at(i).path;
+        }
+        return paths;
+    };
+    entry.windowsExes = ranked(windows);
+    entry.linuxExes = ranked(native);
+    return entry;
+}
+
+QHash<QString, ExecutableIndex::Entry> ExecutableIndex::parse(const QByteArray& json)
+{
+    QHash<QString, Entry> entries;
+    const QJsonObject root = QJsonDocument::fromJson(json).object();
+    if (root.value("version").toInt() != kFormatVersion) {
+        return entries;
+    }
+
+    const QJsonObject games = root.value("games").toObject();
+    for (auto it = games.constBegin(); it != games.constEnd(); ++it) {
+        const QJsonObject game = it.value().toObject();
+        if (it.key().isEmpty() || !game.contains("dirStamp")) {
+            continue;
+        }
+        Entry entry;
+        // Doubles in JSON; both fit in the 53 bits a double holds exactly.
+        entry.buildId = static_cast<qint64>(game.value("buildId").toDouble());
+        entry.dirStamp = static_cast<qint64>(game.value("dirStamp").toDouble());
+        entry.windowsExes = fromJson(game.value("windows"));
+        entry.linuxExes = fromJson(game.value("linux"));
+        entries.insert(it.key(), entry);
+    }
+    return entries;
+}
+
+QByteArray ExecutableIndex::serialize(const QHash<QString, Entry>& entries)
+{
+    QJsonObject games;
+    for (auto it = entries.constBegin(); it != entries.constEnd(); ++it) {
+        QJsonObject game;
+        game["buildId"] = static_cast<double>(it.value().buildId);
+        game["dirStamp"] = static_cast<double>(it.value().dirStamp);
+        game["windows"] = toJson(it.value().windowsExes);
+        game["linux"] = toJson(it.value().linuxExes);
+        games[it.key()] = game;
+    }
+
+    QJsonObject root;
+    root["version"] = kFormatVersion;
+    root["games"] = games;
+    return QJsonDocument(root).toJson(QJsonDocument::Compact);
+}
+
+void ExecutableIndex::ensureLoaded() const
+{
+    if (m_loaded) {
+        return;
+    }
+    m_loaded = true;
+    QFile file(m_path);
+    if (file.open(QIODevice::ReadOnly)) {
+        m_entries = parse(file.readAll());
+    }
+}
+
+bool ExecutableIndex::lookup(const Game& game, Entry* entry, bool* current) const
+{
+    const qint64 stamp = directoryStamp(game.installPath());
+    QMutexLocker locker(&m_mutex);
+    ensureLoaded();
+    const auto it = m_entries.constFind(game.settingsKey());
+    if (it == m_entries.constEnd()) {
+        return false;
+    }
+    if (entry) {
+        *entry = it.value();
+    }
+    if (current) {
+        *current = stamp != 0 && it->buildId == game.buildId() && it->dirStamp == stamp;
+    }
+    return true;
+}
+
+bool ExecutableIndex::isCurrent(const Game& game) const
+{
+    bool current = false;
+    return lookup(game, nullptr, &current) && current;
+}
+
+void ExecutableIndex::store(const Game& game, const Entry& entry)
+{
+    if (entry.dirStamp == 0) {
+        return;
+    }
+    QMutexLocker locker(&m_mutex);
+    ensureLoaded();
+    m_entries.insert(game.settingsKey(), entry);
+    m_dirty = true;
+}
+
+bool ExecutableIndex::save()
+{
+    QMutexLocker locker(&m_mutex);
+    if (!m_dirty) {
+        return true;
+    }
+
+    QDir().mkpath(QFileInfo(m_path).absolutePath());
+    QSaveFile file(m_path);
+    if (!file.open(QIODevice::WriteOnly)) {
+        return false;
+    }
+    file.write(serialize(m_entries));
+    if (!file.commit()) {
+        return false;
+    }
+    m_dirty = false;
+    return true;
+}
+
+QString ExecutableIndex::executable(const Game& game, Platform platform)
+{
+    if (game.installPath().isEmpty()) {
+        return QString();
+    }
+
+    auto firstOnDisk = [&game, platform](const Entry& entry) {
+        const QStringList& candidates =
+            platform == Platform::Windows ? entry.windowsExes : entry.linuxExes;
+        for (const QString& relative : candidates) {
+            const QFileInfo exe(game.installPath() + "/" + relative);
+            if (exe.isFile() && (platform == Platform::Windows || exe.isExecutable())) {
+                return exe.absoluteFilePath();
+            }
+        }
+        return QString();
+    };
+
+    Entry entry;
+    bool current = false;
+    const bool known = lookup(game, &entry, &current);
+    const QString found = known && (current || !m_walkOnMiss) ? firstOnDisk(entry) : QString();
+    if (!found.isEmpty()) {
+        if (!current) {
+            // Most likely still right: an update rarely renames the game, and a
+            // log file written into the install root moves the stamp all the
+            // same. Answered now, and checked behind the user's back.
+            walkSoon(game, false);
+        }
+        return found;
+    }
+
+    if (m_walkOnMiss) {
+        entry = scan(game);
+        store(game, entry);
+        save();
+        return firstOnDisk(entry);
+    }
+
+    // A walk can take seconds, and this is a click on Play. Walked next in the
+    // background instead; the caller says so and the user tries again. Every
+    // candidate gone with the stamp unmoved is a file deleted deeper down: the
+    // entry is forgotten, so the pass walks it.
+    walkSoon(game, known && current);
+    return QString();
+}
+
+void ExecutableIndex::walkSoon(const Game& game, bool forget)
+{
+    {
+        QMutexLocker locker(&m_mutex);
+        if (forget) {
+            m_entries.remove(game.settingsKey());
+        }
+        const bool queued = std::any_of(m_urgentGames.cbegin(), m_urgentGames.cend(),
+                                        [&game](const Game& urgent) {
+                                            return urgent.settingsKey() == game.settingsKey();
+                                        });
+        if (!queued) {
+            m_urgentGames.append(game);
+        }
+        if (m_refreshRunning) {
+            return;
+        }
+        m_refreshRunning = true;
+    }
+    startRefresh({});
+}
+
+bool ExecutableIndex::pending(const Game& game) const
+{
+    if (isCurrent(game)) {
+        return false;
+    }
+    QMutexLocker locker(&m_mutex);
+    return m_refreshRunning;
+}
+
+QList<Game> ExecutableIndex::takeUrgent()
+{
+    QMutexLocker locker(&m_mutex);
+    return std::exchange(m_urgentGames, {});
+}
+
+int ExecutableIndex::refresh(const QList<Game>& games)
+{
+    int walked = 0;
+    const auto walk = [this, &walked](const Game& game) {
+        if (m_cancelled || game.installPath().isEmpty() || isCurrent(game)) {
+            return;
+        }
+        store(game, scan(game, &m_cancelled));
+        ++walked;
+    };
+    for (const Game& game : games) {
+        for (const Game& urgent : takeUrgent()) {
+            walk(urgent);
+        }
+        walk(game);
+    }
+    for (const Game& urgent : takeUrgent()) {
+        walk(urgent);
+    }
+    if (walked > 0) {
+        save();
+    }
+    return walked;
+}
+
+void ExecutableIndex::refreshInBackground(const QList<Game>& games)
+{
+    {
+        QMutexLocker locker(&m_mutex);
+        if (m_refreshRunning) {
+            // Merged rather than replaced: a watcher's few changed games must
+            // not drop a discovery's whole library from the queue.
+            m_refreshQueued = true;
+            QHash<QString, int> at;
+            for (int i = 0; i < m_queuedGames.size(); ++i) {
+                at.insert(m_queuedGames.at(i).settingsKey(), i);
+            }
+            for (const Game& game : games) {
+                const auto it = at.constFind(game.settingsKey());
+                if (it != at.constEnd()) {
+                    m_queuedGames[it.value()] = game;
+                } else {
+                    at.insert(game.settingsKey(), static_cast<int>(m_queuedGames.size()));
+                    m_queuedGames.append(game);
+                }
+            }
+            return;
+        }
+        m_refreshRunning = true;
+    }
+    startRefresh(games);
+}
+
+void ExecutableIndex::startRefresh(const QList<Game>& games)
+{
+    // One game at a time on one worker: these are directory walks, and
+    // several at once on a spinning disk only take longer together.
+    QMutexLocker locker(&m_mutex);
+    m_refreshFuture = QtConcurrent::run([this, games]() {
+        QList<Game> next = games;
+        while (true) {
+            refresh(next);
+            QMutexLocker locker(&m_mutex);
+            if (m_cancelled || (!m_refreshQueued && m_urgentGames.isEmpty())) {
+                m_refreshRunning = false;
+                return;
+            }
+            m_refreshQueued = false;
+            next = std::exchange(m_queuedGames, {});
+        }
+    });
+}
+
+void ExecutableIndex::cancel()
+{
+    m_cancelled = true;
+    QMutexLocker locker(&m_mutex);
+    m_refreshQueued = false;
+    m_queuedGames.clear();
+    m_urgentGames.clear();
+}
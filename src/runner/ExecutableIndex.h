@@ -0,0 +1,154 @@
+#ifndef EXECUTABLEINDEX_H
+#define EXECUTABLEINDEX_H
+
+#include <QByteArrayView>
+#include <QFuture>
+#include <QHash>
+#include <QMutex>
+#include <QString>
+#include <QStringList>
+
+#include <atomic>
+
+#include "core/Game.h"
+
+// Which file in a game's install directory is the game, ranked, remembered
+// between runs.
+//
+// GameRunner used to find out at launch: a walk of the whole install
+// directory for *.exe, or for anything executable on the native path, on
+// every launch and every --dry-run — seconds, on a game of a hundred thousand
+// files, before anything happened. The answer only changes when the files do,
+// so it is worked out once, after discovery and off the GUI thread, and kept
+// here keyed the way SteamClassificationCache keys its verdicts: the build id
+// and the install directory's mtime. A launch is then a lookup and a stat.
+//
+// One walk ranks both kinds, since a game's platform can still be pending when
+// the walk runs. Candidates are scored on more than their name: each one's
+// header is read, so a PE that is a DLL in disguise, a 32-bit helper, a
+// console tool, an ELF shared object or a data file that merely has the
+// execute bit (everything on an NTFS mount does) loses to the real thing or
+// is dropped. Installers, redistributables and crash reporters are dropped by
+// name and by the directory they sit in.
+//
+// The GUI never walks. An entry gone stale — a Steam update moves the build
+// id, and most games write logs or settings into their install root, which
+// moves the stamp — still answers with the first of its candidates that is on
+// disk, and the game goes to the front of the background pass to be walked
+// again. Only a game with no usable candidate at all is told to wait. The pass
+// stops between files once the application is quitting, so a walk of a
+// sleeping drive never holds up the exit.
+//
+// Thread-safe.
+class ExecutableIndex
+{
+public:
+    enum class Platform { Windows, Linux };
+
+    // What a file's first bytes say it is.
+    struct BinaryInfo {
+        enum class Format { Other, PE, ELF, Script };
+        Format format = Format::Other;
+        bool is64 = false;
+        bool library = false;     // a DLL, or an ELF with no interpreter
+        bool console = false;     // PE console subsystem
+    };
+
+    struct Entry {
+        qint64 buildId = 0;
+        qint64 dirStamp = 0;        // install directory mtime, ms since the epoch
+        QStringList windowsExes;    // relative to the install directory, best first
+        QStringList linuxExes;
+    };
+
+    // The one under the cache directory. Others, at a path of the caller's
+    // choosing, are for tests.
+    static ExecutableIndex& instance();
+    explicit ExecutableIndex(const QString& path);
+    // Stops the background pass and waits for the file it is on.
+    ~ExecutableIndex();
+
+    static QString filePath();
+
+    // The best candidate for `platform` that is still on disk, from the
+    // game's entry even when it is stale; a stale one is walked again in the
+    // background, ahead of everything else. With no candidate on disk, empty,
+    // and pending() says the walk is on its way. With setWalkOnMiss(), the game
+    // is walked now instead of in the background, and a stale entry is not
+    // trusted: for the command line, which has no GUI to keep responsive and
+    // no background pass to wait for.
+    QString executable(const Game& game, Platform platform);
+    void setWalkOnMiss(bool walk) { m_walkOnMiss = walk; }
+
+    // True while a background pass runs and the game has no current entry:
+    // the answer is on its way.
+    bool pending(const Game& game) const;
+
+    // Walks every game whose entry is not current, and saves. Blocking; what
+    // refreshInBackground() runs. Returns how many were walked. Games missed
+    // by executable() meanwhile are walked first.
+    int refresh(const QList<Game>& games);
+
+    // refresh() on a worker thread. A call while one is running adds its
+    // games to whatever is queued behind it, the newer copy of a game winning.
+    // instance() stops it on aboutToQuit.
+    void refreshInBackground(const QList<Game>& games);
+
+    // Stops the background pass at the next file, and drops what is queued.
+    // What was walked before is still saved.
+    void cancel();
+
+    // True, with `entry` filled, when the game was indexed at all. `current`
+    // says whether that was at its current build and directory stamp.
+    bool lookup(const Game& game, Entry* entry, bool* current = nullptr) const;
+    bool isCurrent(const Game& game) const;
+    void store(const Game& game, const Entry& entry);
+
+    // Best effort, like every other cache here.
+    bool save();
+
+    // --- pure, so ranking and the format are testable without a filesystem ---
+
+    static BinaryInfo inspect(QByteArrayView head);
+
+    // Higher is likelier; kRejected for a file that is not a candidate at all.
+    static constexpr int kRejected = -1000000;
+    static int score(const QString& relativePath, const BinaryInfo& info, qint64 size,
+                     const Game& game, Platform platform);
+
+    static QHash<QString, Entry> parse(const QByteArray& json);
+    static QByteArray serialize(const QHash<QString, Entry>& entries);
+
+    // The walk: both platforms' candidates, ranked. Stamped with the game's
+    // build id and the directory's mtime as they were before it started. An
+    // entry stamped 0, which store() ignores, when `cancel` is set part-way.
+    static Entry scan(const Game& game, const std::atomic_bool* cancel = nullptr);
+
+private:
+    ExecutableIndex(const ExecutableIndex&) = delete;
+    ExecutableIndex& operator=(const ExecutableIndex&) = delete;
+
+    void ensureLoaded() const;
+    void startRefresh(const QList<Game>& games);
+    // Puts the game at the front of the background pass, starting one if
+    // none runs. `forget` drops its entry first, so the pass walks it even
+    // though the stamp says it is current.
+    void walkSoon(const Game& game, bool forget);
+    QList<Game> takeUrgent();
+
+    QString m_path;
+    mutable QMutex m_mutex;
+    mutable bool m_loaded = false;
+    mutable QHash<QString, Entry> m_entries;    // by Game::settingsKey()
+    bool m_dirty = false;
+
+    bool m_refreshRunning = false;
+    bool m_refreshQueued = false;
+    QList<Game> m_queuedGames;
+    QList<Game> m_urgentGames;                  // missed at launch; walked next
+    QFuture<void> m_refreshFuture;
+    std::atomic_bool m_cancelled{false};
+    std::atomic_bool m_walkOnMiss{false};
+};
+
+#endif // EXECUTABLEINDEX_H
@@ -3,12 +3,14 @@
 #include "utils/ProtonManager.h"
 #include "utils/SteamPaths.h"
 #include "utils/SteamClient.h"
-#include "parsers/VDFParser.h"
+#include "parsers/VDFDocument.h"
+#include "parsers/VDFQuery.h"
+#include "launchers/SteamAppInfo.h"
 #include "launchers/SteamLauncher.h"
+#include "ExecutableIndex.h"
 #include <QDir>
 #include <QFile>
 #include <QFileInfo>
-#include <QDirIterator>
 #include <QStandardPaths>
 #include <QTimer>
 
@@ -182,37 +184,18 @@ QString GameRunner::findProtonFromConfig(const QString& appId) const
 {
     // Check Steam config for per-game Proton setting
     const QString configPath = SteamPaths::configVdfPath();
-    if (configPath.isEmpty()) {
+    if (configPath.isEmpty() || appId.isEmpty()) {
         return QString();
     }
 
-    VDFParser parser;
-    if (!parser.parseFile(configPath)) {
+    // Read up to the one mapping wanted, stepping over the rest of config.vdf.
+    const QString namePath =
+        "InstallConfigStore/Software/Valve/Steam/CompatToolMapping/" + appId + "/name";
+    VDFQuery config({namePath});
+    if (!config.runFile(configPath)) {
         return QString();
     }
-
-    VDFNode root = parser.root();
-
-    // Navigate to: InstallConfigStore/Software/Valve/Steam/CompatToolMapping/<appId>
-    if (!root.hasChild("InstallConfigStore")) return QString();
-
-    VDFNode installConfig = root.child("InstallConfigStore");
-    if (!installConfig.hasChild("Software")) return QString();
-
-    VDFNode software = installConfig.child("Software");
-    if (!software.hasChild("Valve")) return QString();
-
-    VDFNode valve = software.child("Valve");
-    if (!valve.hasChild("Steam")) return QString();
-
-    VDFNode steam = valve.child("Steam");
-    if (!steam.hasChild("CompatToolMapping")) return QString();
-
-    VDFNode mapping = steam.child("CompatToolMapping");
-    if (!mapping.hasChild(appId)) return QString();
-
-    VDFNode appMapping = mapping.child(appId);
-    QString toolName = appMapping.getString("name");
+    const QString toolName = config.value(namePath);
 
     if (toolName.isEmpty()) {
         return QString();
@@ -248,17 +231,12 @@ QString GameRunner::findRequiredRuntimeTool(const QString& protonPath, bool* req
         return QString();
     }
 
-    VDFParser parser;
-    if (!parser.parseFile(manifestPath)) {
-        return QString();
-    }
-
-    VDFNode root = parser.root();
-    if (!root.hasChild("manifest")) {
+    VDFDocument manifest;
+    if (!manifest.parseFile(manifestPath)) {
         return QString();
     }
 
-    const QString toolAppId = root.child("manifest").getString("require_tool_appid");
+    const QString toolAppId = manifest.root().child("manifest").getString("require_tool_appid");
     if (toolAppId.isEmpty()) {
         // This Proton runs directly on the host; nothing to wrap it in.
         return QString();
@@ -276,13 +254,10 @@ QString GameRunner::findToolByAppId(const QString& appId) const
         const QString manifestPath = libPath + "/appmanifest_" + appId + ".acf";
         if (!QFile::exists(manifestPath)) continue;
 
-        VDFParser parser;
-        if (!parser.parseFile(manifestPath)) continue;
-
-        VDFNode root = parser.root();
-        if (!root.hasChild("AppState")) continue;
+        VDFQuery manifest({"AppState/installdir"});
+        if (!manifest.runFile(manifestPath)) continue;
 
-        const QString installDir = root.child("AppState").getString("installdir");
+        const QString installDir = manifest.value("AppState/installdir");
         if (installDir.isEmpty()) continue;
 
         const QString toolPath = libPath + "/common/" + installDir;
@@ -348,43 +323,39 @@ QString GameRunner::findProtonPath(const Game& game, const DLSSSettings& setting
     return findDefaultProton();
 }
 
-QStringList GameRunner::findExecutables(const QString& installPath) const
+QString GameRunner::findExecutableFromAppInfo(const Game& game, const QString& os) const
 {
-    QStringList executables;
-
-    QDirIterator it(installPath, {"*.exe"}, QDir::Files, QDirIterator::Subdirectories);
-    while (it.hasNext()) {
-        QString path = it.next();
-
-        // Skip common non-game executables
-        QString filename = QFileInfo(path).fileName().toLower();
-        if (filename.contains("unins") ||
-            filename.contains("setup") ||
-            filename.contains("install") ||
-            filename.contains("crash") ||
-            filename.contains("report") ||
-            filename.contains("launcher") ||  // Often separate launcher exes
-            filename.contains("redist") ||
-            filename.contains("vcredist") ||
-            filename.contains("directx") ||
-            filename.contains("dotnet") ||
-            filename.contains("easyanticheat") ||
-            filename.contains("battleye") ||
-            filename.contains("regroup") ||  // Log utilities
-            filename.contains("tts") ||  // Text-to-speech utilities
-            filename.contains("voice")) {
+    bool numeric = false;
+    const quint32 appId = game.id().toUInt(&numeric);
+    if (game.launcher() != "Steam" || !numeric || game.installPath().isEmpty()) {
+        return QString();
+    }
+
+    // Steam's order, with the entry marked default ahead of the alternatives
+    // ("Launch in safe mode", "Launch the editor") that follow it.
+    const QList<SteamAppInfo::LaunchEntry> entries = SteamAppInfo::instance().launchEntries(appId);
+    QList<SteamAppInfo::LaunchEntry> ranked;
+    QList<SteamAppInfo::LaunchEntry> alternatives;
+    for (const SteamAppInfo::LaunchEntry& entry : entries) {
+        if (entry.executable.isEmpty() || entry.type == "none" || entry.type == "server"
+            || (!entry.osList.isEmpty() && !entry.osList.split(',').contains(os))) {
             continue;
         }
-
-        executables << path;
+        if (entry.type.isEmpty() || entry.type == "default") {
+            ranked.append(entry);
+        } else {
+            alternatives.append(entry);
+        }
     }
+    ranked += alternatives;
 
-    // Sort by path depth (shallower = more likely main exe)
-    std::sort(executables.begin(), executables.end(), [](const QString& a, const QString& b) {
-        return a.count('/') < b.count('/');
-    });
-
-    return executables;
+    for (const SteamAppInfo::LaunchEntry& entry : ranked) {
+        const QFileInfo exe(game.installPath() + "/" + entry.executable);
+        if (exe.isFile() && (os != "linux" || exe.isExecutable())) {
+            return exe.absoluteFilePath();
+        }
+    }
+    return QString();
 }
 
 QString GameRunner::findGameExecutable(const Game& game)
@@ -394,37 +365,15 @@ QString GameRunner::findGameExecutable(const Game& game)
         return game.executablePath();
     }
 
-    QStringList executables = findExecutables(game.installPath());
-    if (executables.isEmpty()) {
-        return QString();
-    }
-
-    // Prefer executables that match the game name
-    QString gameName = game.name().toLower();
-    QString installDirName = QFileInfo(game.installPath()).fileName().toLower();
-
-    for (const QString& exe : executables) {
-        QString exeName = QFileInfo(exe).baseName().toLower();
-
-        // Check if executable name matches game name or install directory name
-        if (exeName == gameName || exeName == installDirName) {
-            return exe;
-        }
-    }
-
-    // Check for partial matches (e.g., "GameName.exe" vs "Game Name")
-    for (const QString& exe : executables) {
-        QString exeName = QFileInfo(exe).baseName().toLower();
-        QString gameNameNoSpaces = gameName;
-        gameNameNoSpaces.remove(' ');
-
-        if (exeName == gameNameNoSpaces || gameNameNoSpaces.contains(exeName)) {
-            return exe;
-        }
+    const QString fromAppInfo = findExecutableFromAppInfo(game, QStringLiteral("windows"));
+    if (!fromAppInfo.isEmpty()) {
+        return fromAppInfo;
     }
 
-    // Fall back to first executable (already sorted by path depth)
-    return executables.first();
+    // Ranked and remembered after discovery. Empty when the background pass
+    // has not reached this game, or its files have changed; it walks the
+    // game next.
+    return ExecutableIndex::instance().executable(game, ExecutableIndex::Platform::Windows);
 }
 
 bool GameRunner::launch(const Game& game, const DLSSSettings& settings)
@@ -540,7 +489,9 @@ GameRunner::LaunchPlan GameRunner::resolveProtonLaunch(const Game& game, const D
 
     QString gameExe = findGameExecutable(game);
     if (gameExe.isEmpty()) {
-        plan.error = "Could not find game executable";
+        plan.error = ExecutableIndex::instance().pending(game)
+                         ? "Still looking for the game's executable; try again in a moment"
+                         : "Could not find game executable";
         return plan;
     }
 
@@ -768,63 +719,12 @@ QString GameRunner::findLinuxExecutable(const Game& game)
         return game.executablePath();
     }
 
-    QString installPath = game.installPath();
-    QStringList candidates;
-
-    // Common Linux executable patterns
-    QStringList nameVariants;
-    QString gameName = game.name().toLower();
-    QString gameNameNoSpaces = gameName;
-    gameNameNoSpaces.remove(' ');
-    QString installDirName = QFileInfo(installPath).fileName().toLower();
-
-    nameVariants << gameNameNoSpaces << gameName.replace(' ', '_')
-                 << gameName.replace(' ', '-') << installDirName;
-
-    // Search for executables (files with execute permission, no extension)
-    QDirIterator it(installPath, QDir::Files | QDir::Executable, QDirIterator::Subdirectories);
-    while (it.hasNext()) {
-        QString path = it.next();
-        QString filename = QFileInfo(path).fileName().toLower();
-
-        // Skip common non-game files
-        if (filename.contains("uninstall") || filename.contains("setup") ||
-            filename.endsWith(".sh") || filename.endsWith(".py") ||
-            filename.endsWith(".so") || filename.contains("crash")) {
-            continue;
-        }
-
-        candidates << path;
-    }
-
-    // Sort candidates by path depth (shallower first)
-    std::sort(candidates.begin(), candidates.end(), [](const QString& a, const QString& b) {
-        return a.count('/') < b.count('/');
-    });
-
-    // Prefer executables matching game name
-    for (const QString& exe : candidates) {
-        QString exeName = QFileInfo(exe).fileName().toLower();
-        for (const QString& variant : nameVariants) {
-            if (exeName == variant || exeName.contains(variant)) {
-                return exe;
-            }
-        }
+    const QString fromAppInfo = findExecutableFromAppInfo(game, QStringLiteral("linux"));
+    if (!fromAppInfo.isEmpty()) {
+        return fromAppInfo;
     }
 
-    // Look for x86_64 executables (more likely to be the main game)
-    for (const QString& exe : candidates) {
-        if (exe.contains("x86_64") || exe.contains("x64")) {
-            return exe;
-        }
-    }
-
-    // Return first candidate if we found any
-    if (!candidates.isEmpty()) {
-        return candidates.first();
-    }
-
-    return QString();
+    return ExecutableIndex::instance().executable(game, ExecutableIndex::Platform::Linux);
 }
 
 GameRunner::LaunchPlan GameRunner::resolveNativeLaunch(const Game& game, const DLSSSettings& settings)
@@ -833,7 +733,9 @@ GameRunner::LaunchPlan GameRunner::resolveNativeLaunch(const Game& game, const D
 
     QString gameExe = findLinuxExecutable(game);
     if (gameExe.isEmpty()) {
-        plan.error = "Could not find game executable";
+        plan.error = ExecutableIndex::instance().pending(game)
+                         ? "Still looking for the game's executable; try again in a moment"
+                         : "Could not find game executable";
         return plan;
     }
 
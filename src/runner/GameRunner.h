@@ -85,8 +85,11 @@ private:
     // (*required == false) or none is installed (*required == true).
     QString findRequiredRuntimeTool(const QString& protonPath, bool* required) const;
     QString findToolByAppId(const QString& appId) const;
-    QStringList findExecutables(const QString& installPath) const;
     QString findLinuxExecutable(const Game& game);
+    // The executable Steam's own Play button would start for `os` ("windows"
+    // or "linux"), from the game's appinfo launch entries; empty when Steam
+    // has none that exists on disk, or the game is not Steam's.
+    QString findExecutableFromAppInfo(const Game& game, const QString& os) const;
 
     LaunchPlan resolveProtonLaunch(const Game& game, const DLSSSettings& settings);
     LaunchPlan resolveNativeLaunch(const Game& game, const DLSSSettings& settings);
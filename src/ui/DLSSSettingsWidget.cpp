@@ -1029,6 +1029,13 @@ void DLSSSettingsWidget::setGame(const Game& game)
     // this game: selecting fifty games left fifty live lambdas, and a cover
     // that arrived late would repaint the panel for a game the user had long
     // since navigated away from.)
+    //
+    // Registered as on screen, as StoreLibraryDialog does its own: the game
+    // list shares the URL, and its scrolling away must not drop the cover this
+    // panel is still waiting for.
+    ImageCache::instance().setVisibleUrls(this, game.imageUrl().isEmpty()
+                                                    ? QStringList()
+                                                    : QStringList{game.imageUrl()});
     m_gameImageLabel->setPixmap(ImageCache::instance().getImage(game.imageUrl(), QSize(230, 107)));
 
     // Fetch the ProtonDB tier for the badge. ProtonDB is keyed by Steam appid,
@@ -1057,6 +1064,15 @@ void DLSSSettingsWidget::updateGameStatus(const Game& game)
     m_currentGame.setBuildId(game.buildId());
     m_currentGame.setNeedsUpdate(game.needsUpdate());
     m_updateAvailableLabel->setVisible(m_currentGame.needsUpdate());
+
+    // The background classification settled the platform, and discovery's
+    // guess was wrong: the badge, the Proton selector and the gating all
+    // follow from it.
+    m_currentGame.setPlatformPending(game.platformPending());
+    if (m_currentGame.isNativeLinux() != game.isNativeLinux()) {
+        m_currentGame.setIsNativeLinux(game.isNativeLinux());
+        setGame(m_currentGame);
+    }
 }
 
 void DLSSSettingsWidget::setGameRunning(bool running)
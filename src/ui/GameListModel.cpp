@@ -0,0 +1,183 @@
+#include "GameListModel.h"
+
+#include <climits>
+
+namespace {
+
+QString gameTooltip(const Game& game)
+{
+    return QString("%1\nApp ID: %2\nBuild ID: %3\nPath: %4%5")
+        .arg(game.name(), game.id(), QString::number(game.buildId()),
+             game.installPath(),
+             game.needsUpdate() ? "\n\nUpdate available" : "");
+}
+
+} // namespace
+
+// ---------------------------------------------------------------------------
+// GameListModel
+// ---------------------------------------------------------------------------
+GameListModel::GameListModel(QObject* parent)
+    : QAbstractListModel(parent)
+{
+}
+
+int GameListModel::rowCount(const QModelIndex& parent) const
+{
+    return parent.isValid() ? 0 : static_cast<int>(m_games.size());
+}
+
+QVariant GameListModel::data(const QModelIndex& index, int role) const
+{
+    if (!index.isValid() || index.row() >= m_games.size()) {
+        return QVariant();
+    }
+
+    const Game& game = m_games.at(index.row());
+    switch (role) {
+    case Qt::DisplayRole:
+    case NameRole:        return game.name();
+    case Qt::ToolTipRole: return gameTooltip(game);
+    case GameRole:        return QVariant::fromValue(game);
+    case LauncherRole:    return game.launcher();
+    case ImageUrlRole:    return game.imageUrl();
+    case IsNativeRole:    return game.isNativeLinux();
+    case NeedsUpdateRole: return game.needsUpdate();
+    default:              return QVariant();
+    }
+}
+
+void GameListModel::setGames(const QList<Game>& games)
+{
+    beginResetModel();
+    m_games = games;
+    rebuildRows();
+    endResetModel();
+}
+
+void GameListModel::appendGames(const QList<Game>& games)
+{
+    if (games.isEmpty()) {
+        return;
+    }
+    const int first = static_cast<int>(m_games.size());
+    beginInsertRows(QModelIndex(), first, first + static_cast<int>(games.size()) - 1);
+    m_games.append(games);
+    for (int row = first; row < m_games.size(); ++row) {
+        m_rows.insert(m_games.at(row).settingsKey(), row);
+    }
+    endInsertRows();
+}
+
+void GameListModel::replaceGame(int row, const Game& game)
+{
+    if (row < 0 || row >= m_games.size()) {
+        return;
+    }
+    m_rows.remove(m_games.at(row).settingsKey());
+    m_games[row] = game;
+    m_rows.insert(game.settingsKey(), row);
+    const QModelIndex changed = index(row);
+    emit dataChanged(changed, changed);
+}
+
+void GameListModel::removeGames(const QSet<QString>& settingsKeys)
+{
+    if (settingsKeys.isEmpty()) {
+        return;
+    }
+
+    // From the end, one removal per run of adjacent rows, so the rows still
+    // to visit keep their numbers.
+    bool removedAny = false;
+    int row = static_cast<int>(m_games.size()) - 1;
+    while (row >= 0) {
+        if (!settingsKeys.contains(m_games.at(row).settingsKey())) {
+            --row;
+            continue;
+        }
+        const int last = row;
+        while (row > 0 && settingsKeys.contains(m_games.at(row - 1).settingsKey())) {
+            --row;
+        }
+        beginRemoveRows(QModelIndex(), row, last);
+        m_games.remove(row, last - row + 1);
+        endRemoveRows();
+        removedAny = true;
+        --row;
+    }
+
+    if (removedAny) {
+        rebuildRows();
+    }
+}
+
+void GameListModel::rebuildRows()
+{
+    m_rows.clear();
+    m_rows.reserve(m_games.size());
+    for (int row = 0; row < m_games.size(); ++row) {
+        m_rows.insert(m_games.at(row).settingsKey(), row);
+    }
+}
+
+// ---------------------------------------------------------------------------
+// GameFilterProxyModel
+// ---------------------------------------------------------------------------
+GameFilterProxyModel::GameFilterProxyModel(QObject* parent)
+    : QSortFilterProxyModel(parent)
+{
+    setDynamicSortFilter(true);
+}
+
+void GameFilterProxyModel::setMatches(const QStringList& rankedKeys, bool active)
+{
+    m_searching = active;
+    m_rank.clear();
+    if (active) {
+        m_rank.reserve(rankedKeys.size());
+        for (int i = 0; i < rankedKeys.size(); ++i) {
+            m_rank.insert(rankedKeys.at(i), i);
+        }
+    }
+    invalidateFilter();
+    // Best match first while searching; the library's own order otherwise.
+    sort(active ? 0 : -1);
+}
+
+void GameFilterProxyModel::setSourceName(const QString& launcher)
+{
+    if (launcher == m_sourceName) {
+        return;
+    }
+    m_sourceName = launcher;
+    invalidateFilter();
+}
+
+bool GameFilterProxyModel::matches(const Game& game) const
+{
+    if (!m_sourceName.isEmpty() && game.launcher() != m_sourceName) {
+        return false;
+    }
+    return !m_searching || m_rank.contains(game.settingsKey());
+}
+
+bool GameFilterProxyModel::filterAcceptsRow(int sourceRow, const QModelIndex& sourceParent) const
+{
+    Q_UNUSED(sourceParent);
+    // Straight to the Game: going through data() would box each field in a
+    // QVariant for every row on every answer.
+    const auto* games = static_cast<const GameListModel*>(sourceModel());
+    return matches(games->gameAt(sourceRow));
+}
+
+bool GameFilterProxyModel::lessThan(const QModelIndex& left, const QModelIndex& right) const
+{
+    const auto* games = static_cast<const GameListModel*>(sourceModel());
+    const int leftRank = m_rank.value(games->gameAt(left.row()).settingsKey(), INT_MAX);
+    const int rightRank = m_rank.value(games->gameAt(right.row()).settingsKey(), INT_MAX);
+    if (leftRank != rightRank) {
+        return leftRank < rightRank;
+    }
+    return left.row() < right.row();
+}
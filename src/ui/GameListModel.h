@@ -0,0 +1,96 @@
+#ifndef GAMELISTMODEL_H
+#define GAMELISTMODEL_H
+
+#include <QAbstractListModel>
+#include <QHash>
+#include <QList>
+#include <QSet>
+#include <QSortFilterProxyModel>
+#include "core/Game.h"
+
+// The game library as a list model: one row per game, read by the view one
+// visible row at a time.
+//
+// GameListWidget used to be a QListWidget with one QListWidgetItem per game.
+// Each item held a copy of the Game and seven roles of derived data, and it
+// asked ImageCache for its artwork when it was created. Every keystroke in the
+// search box threw the items away and built them again. With a few thousand
+// games across several stores, setGames() took seconds, and typing stalled
+// the GUI thread. Here the games are held once. Nothing is derived per row
+// until the view asks for it, and the view only asks about rows it paints.
+// Loading state and artwork are not stored at all: the delegate asks
+// ImageCache when it paints. An off-screen row costs nothing beyond its Game.
+//
+// Rows are addressed by Game::settingsKey(), never by id(). Two launchers can
+// hand out the same id.
+class GameListModel : public QAbstractListModel {
+    Q_OBJECT
+
+public:
+    enum Role {
+        GameRole = Qt::UserRole,
+        NameRole,
+        LauncherRole,
+        ImageUrlRole,
+        IsNativeRole,
+        NeedsUpdateRole,
+    };
+
+    explicit GameListModel(QObject* parent = nullptr);
+
+    int rowCount(const QModelIndex& parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex& index, int role = Qt::DisplayRole) const override;
+
+    const QList<Game>& games() const { return m_games; }
+    const Game& gameAt(int row) const { return m_games.at(row); }
+
+    // -1 when no game has that key.
+    int rowOf(const QString& settingsKey) const { return m_rows.value(settingsKey, -1); }
+
+    void setGames(const QList<Game>& games);
+    void appendGames(const QList<Game>& games);
+    // In place: the row keeps its position, and the view repaints it if shown.
+    void replaceGame(int row, const Game& game);
+    void removeGames(const QSet<QString>& settingsKeys);
+
+private:
+    void rebuildRows();
+
+    QList<Game> m_games;
+    QHash<QString, int> m_rows;   // settingsKey() -> row
+};
+
+// What the list shows of GameListModel: the chosen source, and whatever the
+// last search found, best match first.
+//
+// The search itself is not done here. SearchIndex answers it off the GUI
+// thread, and the answer arrives as a ranked list of keys. Being a proxy, this
+// filters appended rows as they arrive and rows that change as they change.
+// Only a new answer, or a new source, looks at every row again, and then it
+// only looks the row's key up in a hash: it never builds an item or touches an
+// image.
+class GameFilterProxyModel : public QSortFilterProxyModel {
+    Q_OBJECT
+
+public:
+    explicit GameFilterProxyModel(QObject* parent = nullptr);
+
+    // settingsKey()s, best first. Inactive shows every row, in model order.
+    void setMatches(const QStringList& rankedKeys, bool active);
+    // A launcher name; empty shows every source.
+    void setSourceName(const QString& launcher);
+
+    // The one place that decides whether a game is shown.
+    bool matches(const Game& game) const;
+
+protected:
+    bool filterAcceptsRow(int sourceRow, const QModelIndex& sourceParent) const override;
+    bool lessThan(const QModelIndex& left, const QModelIndex& right) const override;
+
+private:
+    bool m_searching = false;
+    QHash<QString, int> m_rank;   // settingsKey() -> position in the answer
+    QString m_sourceName;
+};
+
+#endif // GAMELISTMODEL_H
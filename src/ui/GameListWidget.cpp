@@ -1,4 +1,6 @@
 #include "GameListWidget.h"
+#include "GameListModel.h"
+#include "core/SearchIndex.h"
 #include "AppStyle.h"
 #include "network/ImageCache.h"
 #include "BadgeRow.h"
@@ -21,31 +23,18 @@
 #include <QAction>
 #include <QHBoxLayout>
 #include <QEvent>
+#include <QSet>
 #include <QSettings>
 #include <QtConcurrent>
 
-// ---------------------------------------------------------------------------
-// Custom roles stored on each game list item
-// ---------------------------------------------------------------------------
-static constexpr int RoleGame        = Qt::UserRole;
-static constexpr int RoleImageLoaded = Qt::UserRole + 1;
-static constexpr int RoleIsNative    = Qt::UserRole + 2;
-static constexpr int RoleGameName    = Qt::UserRole + 3;
-static constexpr int RoleImageUrl    = Qt::UserRole + 4;
-static constexpr int RoleNeedsUpdate = Qt::UserRole + 5;
-static constexpr int RoleImageFailed = Qt::UserRole + 6;
-static constexpr int RoleLauncher    = Qt::UserRole + 7;
-
-// Built in two places — when an item is created and when an update check
-// changes it — so it lives here rather than being written out twice and
-// drifting.
-static QString gameTooltip(const Game& game)
-{
-    return QString("%1\nApp ID: %2\nBuild ID: %3\nPath: %4%5")
-        .arg(game.name(), game.id(), QString::number(game.buildId()),
-             game.installPath(),
-             game.needsUpdate() ? "\n\nUpdate available" : "");
-}
+namespace {
+
+// The cover's box in a row. The delegate draws it at this size and the list
+// asks ImageCache for it at this size: the cache keys variants by size, so the
+// two disagreeing would decode a variant nothing draws.
+constexpr QSize kArtSize(120, 68);
+
+} // namespace
 
 // ---------------------------------------------------------------------------
 // GameItemDelegate – paints each game as a modern card with artwork
@@ -69,11 +58,9 @@ public:
         const bool  selected = option.state & QStyle::State_Selected;
         const bool  hovered  = option.state & QStyle::State_MouseOver;
 
-        const bool    imageLoaded = index.data(RoleImageLoaded).toBool();
-        const bool    imageFailed = index.data(RoleImageFailed).toBool();
-        const bool    isNative    = index.data(RoleIsNative).toBool();
-        const QString gameName    = index.data(RoleGameName).toString();
-        const QString imageUrl    = index.data(RoleImageUrl).toString();
+        const bool    isNative = index.data(GameListModel::IsNativeRole).toBool();
+        const QString gameName = index.data(GameListModel::NameRole).toString();
+        const QString imageUrl = index.data(GameListModel::ImageUrlRole).toString();
 
         // --- Card background ---
         const QColor bg = selected ? QColor("#1a3a0a")
@@ -87,8 +74,8 @@ public:
         p->drawRoundedRect(r, 8, 8);
 
         // --- Artwork area ---
-        const int artW = 120;
-        const int artH = 68;
+        const int artW = kArtSize.width();
+        const int artH = kArtSize.height();
         const int artX = r.left() + 12;
         const int artY = r.top() + (r.height() - artH) / 2;
         const QRect artRect(artX, artY, artW, artH);
@@ -104,17 +91,21 @@ public:
         QPainterPath clipPath;
         clipPath.addRoundedRect(QRectF(artRect), 6, 6);
 
-        if (imageLoaded && !imageUrl.isEmpty()) {
-            QPixmap pixmap = ImageCache::instance().getImage(imageUrl, QSize(artW, artH));
-            if (!pixmap.isNull()) {
-                p->setClipPath(clipPath);
-                p->drawPixmap(artRect, pixmap);
-                p->setClipping(false);
-            } else {
-                drawPlaceholder(p, clipPath, artRect);
-            }
+        // Asked here rather than remembered per row: only painted rows ever
+        // ask, and the answer cannot go stale. The cache holds the art at this
+        // size, so drawing it never rescales.
+        ImageCache& images = ImageCache::instance();
+        const bool imageFailed = !imageUrl.isEmpty() && images.hasFailed(imageUrl);
+        const QPixmap pixmap = imageUrl.isEmpty() || imageFailed
+                                   ? QPixmap()
+                                   : images.findImage(imageUrl, QSize(artW, artH));
+
+        if (!pixmap.isNull()) {
+            p->setClipPath(clipPath);
+            p->drawPixmap(artRect, pixmap);
+            p->setClipping(false);
         } else if (!imageUrl.isEmpty() && !imageFailed) {
-            // Image still loading — draw shimmer
+            // Downloading or decoding — draw shimmer
             drawShimmer(p, clipPath, artRect);
         } else {
             // No artwork URL, or the download failed — show the static placeholder
@@ -149,13 +140,13 @@ public:
         QList<BadgeRow::Badge> badges;
         // Only worth the space once there is more than one source to tell apart;
         // a Steam-only user sees exactly what they saw before.
-        const QString source = index.data(RoleLauncher).toString();
+        const QString source = index.data(GameListModel::LauncherRole).toString();
         if (m_owner->showsSourceBadge() && !source.isEmpty()) {
             badges += {source.toUpper(), StoreVisuals::accentColor(source)};
         }
         badges += isNative ? BadgeRow::Badge{"LINUX", QColor("#e8710a")}
                            : BadgeRow::Badge{"WINDOWS", QColor("#1565c0")};
-        if (index.data(RoleNeedsUpdate).toBool()) {
+        if (index.data(GameListModel::NeedsUpdateRole).toBool()) {
             badges += {"UPDATE", QColor(AppStyle::ColorBadgeUpdate)};
         }
 
@@ -296,64 +287,96 @@ GameListWidget::GameListWidget(QWidget* parent)
     layout->addLayout(searchRow);
 
     // Game list
-    m_listWidget = new QListWidget(this);
-    m_listWidget->setIconSize(QSize(0, 0));
-    m_listWidget->setSpacing(0);
-    m_listWidget->setAlternatingRowColors(false);
-    m_listWidget->setMouseTracking(true);
-    m_listWidget->setContextMenuPolicy(Qt::CustomContextMenu);
-    m_listWidget->setVerticalScrollMode(QAbstractItemView::ScrollPerPixel);
-    m_listWidget->verticalScrollBar()->setSingleStep(20);
+    m_model = new GameListModel(this);
+    m_proxy = new GameFilterProxyModel(this);
+    m_proxy->setSourceModel(m_model);
+    m_search = new AsyncSearch(this);
+
+    m_listView = new QListView(this);
+    m_listView->setModel(m_proxy);
+    m_listView->setIconSize(QSize(0, 0));
+    m_listView->setSpacing(0);
+    m_listView->setAlternatingRowColors(false);
+    m_listView->setMouseTracking(true);
+    m_listView->setContextMenuPolicy(Qt::CustomContextMenu);
+    m_listView->setVerticalScrollMode(QAbstractItemView::ScrollPerPixel);
+    m_listView->verticalScrollBar()->setSingleStep(20);
+    // Every card is the same height. Without this the view asks the delegate
+    // for the size of every row, shown or not, to lay the list out.
+    m_listView->setUniformItemSizes(true);
 
     // Set custom delegate
-    m_listWidget->setItemDelegate(new GameItemDelegate(this));
+    m_listView->setItemDelegate(new GameItemDelegate(this));
 
     // Transparent background so delegate draws everything
     // Scrollbar styles are loaded from style.qss via class name "GameListWidget"
-    m_listWidget->setStyleSheet(
-        "QListWidget {"
+    m_listView->setStyleSheet(
+        "QListView {"
         "  background-color: transparent;"
         "  border: none;"
         "  outline: none;"
         "}"
-        "QListWidget::item {"
+        "QListView::item {"
         "  background: transparent;"
         "  border: none;"
         "}"
-        "QListWidget::item:selected {"
+        "QListView::item:selected {"
         "  background: transparent;"
         "}"
-        "QListWidget::item:hover {"
+        "QListView::item:hover {"
         "  background: transparent;"
         "}"
     );
 
-    layout->addWidget(m_listWidget);
+    layout->addWidget(m_listView);
+    // A taller window shows more rows, and those want their artwork too.
+    m_listView->viewport()->installEventFilter(this);
 
     // Shimmer timer
     m_shimmerTimer = new QTimer(this);
     m_shimmerTimer->setInterval(30);
     connect(m_shimmerTimer, &QTimer::timeout, this, [this]() {
+        // Runs only while something on screen is still loading; what is
+        // scrolled away can wait until it is scrolled back.
+        if (!visibleRowsLoading()) {
+            m_shimmerTimer->stop();
+            return;
+        }
         m_shimmerPhase += 0.02;
         if (m_shimmerPhase > 1.0)
             m_shimmerPhase = 0.0;
-        m_listWidget->viewport()->update();
+        m_listView->viewport()->update();
     });
 
-    // Update check timer (re-reads ACF files every 60s in background thread)
-    m_updateCheckTimer = new QTimer(this);
-    m_updateCheckTimer->setInterval(60000);
-    connect(m_updateCheckTimer, &QTimer::timeout, this, &GameListWidget::checkForUpdates);
-
     // Connections
     connect(m_searchBox, &QLineEdit::textChanged, this, &GameListWidget::onSearchTextChanged);
+    connect(m_search, &AsyncSearch::resultsReady, this,
+            [this](const QString& query, const QStringList& keys) {
+        m_proxy->setMatches(keys, !query.isEmpty());
+    });
     connect(m_sourceFilter, &QComboBox::currentIndexChanged, this,
             &GameListWidget::onSourceFilterChanged);
-    connect(m_listWidget, &QListWidget::itemClicked, this, &GameListWidget::onItemClicked);
-    connect(m_listWidget, &QListWidget::currentItemChanged, this, &GameListWidget::onCurrentItemChanged);
+    connect(m_listView, &QListView::clicked, this, &GameListWidget::onClicked);
+    connect(m_listView->selectionModel(), &QItemSelectionModel::currentChanged, this,
+            &GameListWidget::onCurrentChanged);
     connect(&ImageCache::instance(), &ImageCache::imageReady, this, &GameListWidget::onImageReady);
     connect(&ImageCache::instance(), &ImageCache::imageFailed, this, &GameListWidget::onImageFailed);
-    connect(m_listWidget, &QListWidget::customContextMenuRequested, this, &GameListWidget::showContextMenu);
+    connect(m_listView, &QListView::customContextMenuRequested, this, &GameListWidget::showContextMenu);
+
+    // Whatever comes into view asks for its artwork: scrolling, filtering,
+    // rows arriving from a discovery still under way. Queued, so a burst of
+    // these costs one look at the viewport, after the view has laid out.
+    auto visibleChanged = [this]() {
+        QMetaObject::invokeMethod(this, [this]() {
+            requestVisibleImages();
+            ensureShimmerRunning();
+        }, Qt::QueuedConnection);
+    };
+    connect(m_listView->verticalScrollBar(), &QScrollBar::valueChanged, this, visibleChanged);
+    connect(m_proxy, &QAbstractItemModel::modelReset, this, visibleChanged);
+    connect(m_proxy, &QAbstractItemModel::layoutChanged, this, visibleChanged);
+    connect(m_proxy, &QAbstractItemModel::rowsInserted, this, visibleChanged);
+    connect(m_proxy, &QAbstractItemModel::rowsRemoved, this, visibleChanged);
 }
 
 bool GameListWidget::eventFilter(QObject* obj, QEvent* event)
@@ -383,67 +406,81 @@ bool GameListWidget::eventFilter(QObject* obj, QEvent* event)
 
         return true;
     }
+    if (m_listView && obj == m_listView->viewport() && event->type() == QEvent::Resize) {
+        requestVisibleImages();
+        ensureShimmerRunning();
+    }
     return QWidget::eventFilter(obj, event);
 }
 
 void GameListWidget::setGames(const QList<Game>& games)
 {
-    m_games = games;
+    m_model->setGames(games);
+    refreshSearchDocuments();
     m_shimmerPhase = 0.0;
     refreshSourceFilter();
-    updateFilter();
+    m_proxy->setSourceName(m_sourceFilterName);
     ensureShimmerRunning();
-
-    if (!m_games.isEmpty()) {
-        m_updateCheckTimer->start();
-    } else {
-        m_updateCheckTimer->stop();
-    }
+    classifyPendingGames();
 }
 
 void GameListWidget::addGame(const Game& game)
 {
-    m_games.append(game);
-    if (matchesFilter(game)) {
-        m_listWidget->addItem(createGameItem(game));
-        ensureShimmerRunning();
+    addGames({game});
+}
+
+void GameListWidget::addGames(const QList<Game>& games)
+{
+    if (games.isEmpty()) {
+        return;
     }
+    // The proxy filters the new rows as they are inserted; only a batch that
+    // brought in, or left out, the source the user had chosen makes it look
+    // at the rest again.
+    m_model->appendGames(games);
+    refreshSearchDocuments();
+    refreshSourceFilter();
+    m_proxy->setSourceName(m_sourceFilterName);
+    ensureShimmerRunning();
+    classifyPendingGames();
 }
 
 void GameListWidget::clear()
 {
-    m_games.clear();
-    m_listWidget->clear();
+    m_model->setGames({});
+    refreshSearchDocuments();
+    ImageCache::instance().setVisibleUrls(this, {});
     m_shimmerTimer->stop();
-    m_updateCheckTimer->stop();
 }
 
-void GameListWidget::onSearchTextChanged(const QString& text)
+int GameListWidget::gameCount() const
 {
-    m_filterText = text;
-    updateFilter();
+    return m_model->rowCount();
 }
 
-void GameListWidget::onSourceFilterChanged()
+void GameListWidget::onSearchTextChanged(const QString& text)
 {
-    m_sourceFilterName = m_sourceFilter->currentData().toString();
-    QSettings().setValue("ui/sourceFilter", m_sourceFilterName);
-    updateFilter();
+    // Debounced and answered off this thread; the proxy takes the answer.
+    m_search->setQuery(text);
 }
 
-// The one place that decides whether a game is shown, so the list and addGame()
-// can never disagree about it.
-bool GameListWidget::matchesFilter(const Game& game) const
+void GameListWidget::refreshSearchDocuments()
 {
-    if (!m_sourceFilterName.isEmpty() && game.launcher() != m_sourceFilterName) {
-        return false;
+    QList<SearchIndex::Document> documents;
+    documents.reserve(m_model->games().size());
+    for (const Game& game : m_model->games()) {
+        // Typing "gog" finds the GOG games, not just games with "gog" in the
+        // title; typing an app id finds that game.
+        documents.append({game.settingsKey(), game.name(), {game.id(), game.launcher()}});
     }
-    if (m_filterText.isEmpty()) {
-        return true;
-    }
-    // Typing "gog" finds the GOG games, not just games with "gog" in the title.
-    return game.name().contains(m_filterText, Qt::CaseInsensitive)
-        || game.launcher().contains(m_filterText, Qt::CaseInsensitive);
+    m_search->setDocuments(documents);
+}
+
+void GameListWidget::onSourceFilterChanged()
+{
+    m_sourceFilterName = m_sourceFilter->currentData().toString();
+    QSettings().setValue("ui/sourceFilter", m_sourceFilterName);
+    m_proxy->setSourceName(m_sourceFilterName);
 }
 
 // Rebuild the source dropdown from the sources actually present, preserving the
@@ -451,8 +488,10 @@ bool GameListWidget::matchesFilter(const Game& game) const
 void GameListWidget::refreshSourceFilter()
 {
     QStringList sources;
-    for (const Game& game : m_games) {
-        if (!game.launcher().isEmpty() && !sources.contains(game.launcher())) {
+    QSet<QString> seen;
+    for (const Game& game : m_model->games()) {
+        if (!game.launcher().isEmpty() && !seen.contains(game.launcher())) {
+            seen.insert(game.launcher());
             sources << game.launcher();
         }
     }
@@ -481,118 +520,106 @@ void GameListWidget::refreshSourceFilter()
     m_sourceFilter->setVisible(sources.size() > 1);
 }
 
-void GameListWidget::updateFilter()
+const Game& GameListWidget::gameAt(const QModelIndex& viewIndex) const
 {
-    m_listWidget->clear();
+    return m_model->gameAt(m_proxy->mapToSource(viewIndex).row());
+}
 
-    for (const Game& game : m_games) {
-        if (matchesFilter(game)) {
-            m_listWidget->addItem(createGameItem(game));
+QList<QModelIndex> GameListWidget::visibleRows() const
+{
+    QList<QModelIndex> rows;
+    const QRect viewport = m_listView->viewport()->rect();
+    QModelIndex index = m_listView->indexAt(viewport.topLeft());
+    if (!index.isValid()) {
+        index = m_proxy->index(0, 0);
+    }
+    for (int row = index.row(); index.isValid() && row < m_proxy->rowCount(); ++row) {
+        index = m_proxy->index(row, 0);
+        const QRect rect = m_listView->visualRect(index);
+        if (rect.top() > viewport.bottom()) {
+            break;
+        }
+        if (rect.bottom() >= viewport.top()) {
+            rows << index;
         }
     }
+    return rows;
 }
 
-QListWidgetItem* GameListWidget::createGameItem(const Game& game)
+void GameListWidget::requestVisibleImages()
 {
-    QListWidgetItem* item = new QListWidgetItem();
-    item->setSizeHint(QSize(0, 100));
-    item->setData(RoleGame, QVariant::fromValue(game));
-    item->setData(RoleGameName, game.name());
-    item->setData(RoleIsNative, game.isNativeLinux());
-    item->setData(RoleImageUrl, game.imageUrl());
-    item->setData(RoleNeedsUpdate, game.needsUpdate());
-    item->setData(RoleLauncher, game.launcher());
-
-    // Check if image is already cached (or already failed this session, so
-    // recreated items don't fall back into the shimmering state)
-    bool cached = ImageCache::instance().hasImage(game.imageUrl());
-    item->setData(RoleImageLoaded, cached);
-    item->setData(RoleImageFailed, ImageCache::instance().hasFailed(game.imageUrl()));
-
-    if (!cached && !game.imageUrl().isEmpty()) {
-        // Trigger fetch (getImage will start download if not cached)
-        ImageCache::instance().getImage(game.imageUrl(), QSize(120, 68));
+    ImageCache& images = ImageCache::instance();
+    QStringList urls;
+    for (const QModelIndex& index : visibleRows()) {
+        const QString& url = gameAt(index).imageUrl();
+        if (!url.isEmpty()) {
+            urls << url;
+        }
     }
+    // Before asking, so what is asked for now is queued ahead of the rest.
+    images.setVisibleUrls(this, urls);
+    for (const QString& url : urls) {
+        // A lookup when it is ready; otherwise starts the decode, or the
+        // download when it is not on disk either.
+        images.findImage(url, kArtSize);
+    }
+}
 
-    item->setToolTip(gameTooltip(game));
-
-    return item;
+bool GameListWidget::visibleRowsLoading() const
+{
+    const ImageCache& images = ImageCache::instance();
+    for (const QModelIndex& index : visibleRows()) {
+        const QString& url = gameAt(index).imageUrl();
+        if (!url.isEmpty() && !images.hasFailed(url) && !images.isReady(url, kArtSize)) {
+            return true;
+        }
+    }
+    return false;
 }
 
-void GameListWidget::onItemClicked(QListWidgetItem* item)
+void GameListWidget::onClicked(const QModelIndex& index)
 {
-    if (!item) return;
+    if (!index.isValid()) return;
 
-    Game game = item->data(RoleGame).value<Game>();
-    emit gameSelected(game);
+    emit gameSelected(gameAt(index));
 }
 
-void GameListWidget::onCurrentItemChanged(QListWidgetItem* current, QListWidgetItem* previous)
+void GameListWidget::onCurrentChanged(const QModelIndex& current, const QModelIndex& previous)
 {
     Q_UNUSED(previous);
-    if (!current) return;
+    if (!current.isValid()) return;
 
-    Game game = current->data(RoleGame).value<Game>();
-    emit gameSelected(game);
+    emit gameSelected(gameAt(current));
 }
 
 void GameListWidget::onImageReady(const QString& url)
 {
-    finishImage(url, true);
+    Q_UNUSED(url);
+    // Only painted rows look the image up, so repainting the viewport is all
+    // a finished download needs; the shimmer stops itself on its next tick.
+    m_listView->viewport()->update();
 }
 
 void GameListWidget::onImageFailed(const QString& url)
 {
-    finishImage(url, false);
-}
-
-void GameListWidget::finishImage(const QString& url, bool success)
-{
-    bool anyPending = false;
-    for (int i = 0; i < m_listWidget->count(); ++i) {
-        QListWidgetItem* item = m_listWidget->item(i);
-        if (item->data(RoleImageUrl).toString() == url) {
-            item->setData(success ? RoleImageLoaded : RoleImageFailed, true);
-        }
-        if (itemStillLoading(item)) {
-            anyPending = true;
-        }
-    }
-
-    // Stop shimmer when no visible image is pending anymore
-    if (!anyPending) {
-        m_shimmerTimer->stop();
-    }
-
-    m_listWidget->viewport()->update();
-}
-
-bool GameListWidget::itemStillLoading(const QListWidgetItem* item)
-{
-    return !item->data(RoleImageLoaded).toBool() &&
-           !item->data(RoleImageFailed).toBool() &&
-           !item->data(RoleImageUrl).toString().isEmpty();
+    Q_UNUSED(url);
+    m_listView->viewport()->update();
 }
 
 void GameListWidget::ensureShimmerRunning()
 {
-    // Check if any visible items still need images
-    for (int i = 0; i < m_listWidget->count(); ++i) {
-        if (itemStillLoading(m_listWidget->item(i))) {
-            if (!m_shimmerTimer->isActive()) {
-                m_shimmerTimer->start();
-            }
-            return;
-        }
+    if (!m_shimmerTimer->isActive() && visibleRowsLoading()) {
+        m_shimmerTimer->start();
     }
 }
 
 void GameListWidget::showContextMenu(const QPoint& pos)
 {
-    QListWidgetItem* item = m_listWidget->itemAt(pos);
-    if (!item) return;
+    const QModelIndex index = m_listView->indexAt(pos);
+    if (!index.isValid()) return;
 
-    Game game = item->data(RoleGame).value<Game>();
+    // A copy: the menu runs an event loop, and the list can change under it.
+    const Game game = gameAt(index);
 
     QMenu menu(this);
 
@@ -609,7 +636,7 @@ void GameListWidget::showContextMenu(const QPoint& pos)
         openCompatDataAction->setEnabled(QDir(compatDataPath).exists());
     }
 
-    QAction* selectedAction = menu.exec(m_listWidget->mapToGlobal(pos));
+    QAction* selectedAction = menu.exec(m_listView->viewport()->mapToGlobal(pos));
 
     if (selectedAction == openLocationAction) {
         QDesktopServices::openUrl(QUrl::fromLocalFile(game.installPath()));
@@ -618,43 +645,76 @@ void GameListWidget::showContextMenu(const QPoint& pos)
     }
 }
 
-void GameListWidget::checkForUpdates()
+void GameListWidget::applyGameChanges(const QList<Game>& updated, const QStringList& removedKeys)
 {
-    if (m_updateCheckRunning || m_games.isEmpty()) {
-        return;
+    if (!removedKeys.isEmpty()) {
+        m_model->removeGames(QSet<QString>(removedKeys.cbegin(), removedKeys.cend()));
+        refreshSearchDocuments();
     }
 
-    m_updateCheckRunning = true;
+    QHash<QString, Game> changed;
+    QList<Game> added;
+    for (const Game& game : updated) {
+        if (m_model->rowOf(game.settingsKey()) >= 0) {
+            changed.insert(game.settingsKey(), game);
+        } else {
+            added << game;
+        }
+    }
 
-    // Copy game list for the worker thread
-    QList<Game> gamesCopy = m_games;
+    applyUpdateResults(changed);
+    if (!added.isEmpty()) {
+        addGames(added);   // classifies whatever it brought
+    } else {
+        if (!removedKeys.isEmpty()) {
+            refreshSourceFilter();
+        }
+        classifyPendingGames();
+    }
+}
 
-    // Snapshot the launchers here, on the GUI thread. The worker must not reach
-    // into the singleton, and each launcher decides for itself whether it has
-    // any on-disk state worth re-reading — which is why this no longer parses
-    // Steam's appmanifest by hand.
-    QHash<QString, std::shared_ptr<ILauncher>> launchers;
-    for (const auto& launcher : LauncherManager::instance().launchers()) {
-        launchers.insert(launcher->name(), launcher);
+void GameListWidget::classifyPendingGames()
+{
+    if (m_classifyRunning) {
+        m_classifyQueued = true;
+        return;
     }
 
+    // Grouped by launcher here, on the GUI thread: the worker must not reach
+    // into the LauncherManager singleton.
+    QHash<QString, QList<Game>> pending;
+    for (const Game& game : m_model->games()) {
+        if (game.platformPending()) {
+            pending[game.launcher()] << game;
+        }
+    }
+    if (pending.isEmpty()) {
+        return;
+    }
+    QList<std::pair<std::shared_ptr<ILauncher>, QList<Game>>> work;
+    for (auto it = pending.constBegin(); it != pending.constEnd(); ++it) {
+        if (const auto launcher = LauncherManager::instance().launcher(it.key())) {
+            work.append({launcher, it.value()});
+        }
+    }
+
+    m_classifyRunning = true;
     auto* watcher = new QFutureWatcher<QHash<QString, Game>>(this);
     connect(watcher, &QFutureWatcher<QHash<QString, Game>>::finished, this, [this, watcher]() {
         applyUpdateResults(watcher->result());
         watcher->deleteLater();
-        m_updateCheckRunning = false;
+        m_classifyRunning = false;
+        if (m_classifyQueued) {
+            m_classifyQueued = false;
+            classifyPendingGames();
+        }
     });
 
-    watcher->setFuture(QtConcurrent::run([gamesCopy, launchers]() -> QHash<QString, Game> {
+    watcher->setFuture(QtConcurrent::run([work]() -> QHash<QString, Game> {
         QHash<QString, Game> changed;
-        for (const Game& game : gamesCopy) {
-            const auto launcher = launchers.value(game.launcher());
-            if (!launcher) {
-                continue;
-            }
-            Game updated = game;
-            if (launcher->refreshGameState(updated)) {
-                changed.insert(updated.settingsKey(), updated);
+        for (const auto& [launcher, games] : work) {
+            for (const Game& game : launcher->classifyGames(games)) {
+                changed.insert(game.settingsKey(), game);
             }
         }
         return changed;
@@ -667,29 +727,24 @@ void GameListWidget::applyUpdateResults(const QHash<QString, Game>& changed)
         return;
     }
 
-    for (int i = 0; i < m_games.size(); ++i) {
-        const auto it = changed.constFind(m_games[i].settingsKey());
-        if (it == changed.constEnd()) {
+    for (auto it = changed.constBegin(); it != changed.constEnd(); ++it) {
+        const int row = m_model->rowOf(it.key());
+        if (row < 0) {
             continue;
         }
-        m_games[i] = it.value();
-        emit gameUpdateStatusChanged(m_games[i]);
-    }
-
-    // Update the visible list items
-    for (int i = 0; i < m_listWidget->count(); ++i) {
-        QListWidgetItem* item = m_listWidget->item(i);
-        const Game game = item->data(RoleGame).value<Game>();
-        const auto it = changed.constFind(game.settingsKey());
-        if (it == changed.constEnd()) {
-            continue;
+        const Game& current = m_model->gameAt(row);
+        Game settled = it.value();
+        // The watcher and the classification pass work on snapshots of their
+        // own; a manifest re-read before the platform was settled must not put
+        // the guess back. A new build is a new question, though.
+        if (settled.platformPending() && !current.platformPending()
+            && settled.buildId() == current.buildId()) {
+            settled.setIsNativeLinux(current.isNativeLinux());
+            settled.setPlatformPending(false);
         }
-
-        const Game& updated = it.value();
-        item->setData(RoleGame, QVariant::fromValue(updated));
-        item->setData(RoleNeedsUpdate, updated.needsUpdate());
-        item->setToolTip(gameTooltip(updated));
+        // One dataChanged per game: the proxy re-filters that row alone, and
+        // the view repaints it only if it is on screen.
+        m_model->replaceGame(row, settled);
+        emit gameUpdateStatusChanged(settled);
     }
-
-    m_listWidget->viewport()->update();
 }
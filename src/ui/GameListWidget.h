@@ -2,7 +2,7 @@
 #define GAMELISTWIDGET_H
 
 #include <QWidget>
-#include <QListWidget>
+#include <QListView>
 #include <QLineEdit>
 #include <QComboBox>
 #include <QPushButton>
@@ -10,8 +10,13 @@
 #include <QTimer>
 #include <QFutureWatcher>
 #include <QHash>
+#include <QSet>
 #include "core/Game.h"
 
+class AsyncSearch;
+class GameListModel;
+class GameFilterProxyModel;
+
 class GameListWidget : public QWidget {
     Q_OBJECT
 
@@ -20,8 +25,17 @@ public:
 
     void setGames(const QList<Game>& games);
     void addGame(const Game& game);
+    // A batch from a discovery still under way: appended, with the source
+    // filter brought up to date once for the lot rather than once a game.
+    void addGames(const QList<Game>& games);
     void clear();
 
+    // What LibraryWatcher saw change on disk: games re-read, to be updated in
+    // place or added, and the settingsKey() of games that are gone.
+    void applyGameChanges(const QList<Game>& updated, const QStringList& removedKeys);
+
+    int gameCount() const;
+
     qreal shimmerPhase() const { return m_shimmerPhase; }
 
     // Whether the per-game source badge is worth drawing. False while only one
@@ -37,22 +51,33 @@ signals:
 private slots:
     void onSearchTextChanged(const QString& text);
     void onSourceFilterChanged();
-    void onItemClicked(QListWidgetItem* item);
-    void onCurrentItemChanged(QListWidgetItem* current, QListWidgetItem* previous);
+    void onClicked(const QModelIndex& index);
+    void onCurrentChanged(const QModelIndex& current, const QModelIndex& previous);
     void onImageReady(const QString& url);
     void onImageFailed(const QString& url);
     void showContextMenu(const QPoint& pos);
 
 private:
     bool eventFilter(QObject* obj, QEvent* event) override;
-    void updateFilter();
-    bool matchesFilter(const Game& game) const;
     void refreshSourceFilter();
-    QListWidgetItem* createGameItem(const Game& game);
-    void finishImage(const QString& url, bool success);
-    static bool itemStillLoading(const QListWidgetItem* item);
+    // Hands the search what the model now holds. Called after every change to
+    // the games; it costs nothing until someone searches.
+    void refreshSearchDocuments();
+    // The game behind a row of the view, which counts rows of the proxy.
+    const Game& gameAt(const QModelIndex& viewIndex) const;
+    // The rows the viewport shows right now. With every row the same height
+    // this is a division, however long the list.
+    QList<QModelIndex> visibleRows() const;
+    // Only rows on screen ask ImageCache for their artwork; the rest ask when
+    // they are scrolled to. Also tells it what is on screen, so those
+    // downloads go first and the ones scrolled past are dropped.
+    void requestVisibleImages();
+    bool visibleRowsLoading() const;
     void ensureShimmerRunning();
-    void checkForUpdates();
+    // One background pass over whatever discovery left platformPending(),
+    // reported through applyUpdateResults() like any other change. Asked for
+    // again while one runs, it runs once more afterwards for the newcomers.
+    void classifyPendingGames();
     // Keyed by Game::settingsKey(), not by id(): two launchers can hand out the
     // same numeric id, and keying on it alone stamps one game's install state
     // onto the other's.
@@ -60,17 +85,18 @@ private:
 
     QLineEdit* m_searchBox;
     QComboBox* m_sourceFilter;
-    QListWidget* m_listWidget;
-    QList<Game> m_games;
-    QString m_filterText;
+    QListView* m_listView = nullptr;
+    GameListModel* m_model;
+    GameFilterProxyModel* m_proxy;
+    AsyncSearch* m_search;
     QString m_sourceFilterName;   // launcher name, empty = all
     bool m_showSourceBadge = false;
 
     QTimer* m_shimmerTimer;
     qreal m_shimmerPhase = 0.0;
 
-    QTimer* m_updateCheckTimer;
-    bool m_updateCheckRunning = false;
+    bool m_classifyRunning = false;
+    bool m_classifyQueued = false;
 };
 
 #endif // GAMELISTWIDGET_H
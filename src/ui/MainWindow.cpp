@@ -1,5 +1,6 @@
 #include "MainWindow.h"
 #include "launchers/LauncherManager.h"
+#include "launchers/LibraryWatcher.h"
 #include "launchers/SteamLauncher.h"
 #include "launchers/IStoreService.h"
 #include "core/SettingsManager.h"
@@ -8,6 +9,7 @@
 #include "utils/GpuInfoCache.h"
 #include "utils/SteamPaths.h"
 #include "utils/SteamClient.h"
+#include "runner/ExecutableIndex.h"
 #include "gog/GogDownloader.h"
 #include "ui/ProtonVersionDialog.h"
 #include "ui/SettingsDialog.h"
@@ -34,6 +36,7 @@
 MainWindow::MainWindow(QWidget* parent)
     : QMainWindow(parent)
     , m_gameRunner(new GameRunner(this))
+    , m_libraryWatcher(new LibraryWatcher(this))
 {
     setupUI();
     setupMenuBar();
@@ -45,6 +48,24 @@ MainWindow::MainWindow(QWidget* parent)
     // refreshGameList: the latter triggers the check that emits this.
     connect(&LauncherManager::instance(), &LauncherManager::availabilityChanged,
             this, &MainWindow::loadGames);
+    connect(&LauncherManager::instance(), &LauncherManager::gamesBatchDiscovered,
+            this, &MainWindow::onGamesBatchDiscovered);
+    connect(&LauncherManager::instance(), &LauncherManager::discoveryFinished,
+            this, &MainWindow::onDiscoveryFinished);
+
+    // Between discoveries, the list follows the disk: a manifest Steam
+    // rewrites is re-read on its own, and only a change that cannot be put
+    // down to one game — a library added, GOG's registry rewritten — brings
+    // the whole list back round.
+    connect(m_libraryWatcher, &LibraryWatcher::gamesChanged, this,
+            [this](const QList<Game>& updated, const QStringList& removedKeys) {
+                m_gameList->applyGameChanges(updated, removedKeys);
+                m_gameCountLabel->setText(QString::number(m_gameList->gameCount()));
+                // An update moves the build id: walked again now, not at the
+                // next discovery.
+                ExecutableIndex::instance().refreshInBackground(updated);
+            });
+    connect(m_libraryWatcher, &LibraryWatcher::rediscoveryNeeded, this, &MainWindow::loadGames);
 
     // An install can finish long after the store dialog was closed — downloads
     // are app-global, not dialog-owned. Connected here so the new game reaches
@@ -162,6 +183,14 @@ void MainWindow::setupUI()
     connect(m_gameList, &GameListWidget::refreshRequested, this, &MainWindow::refreshGameList);
     connect(m_gameList, &GameListWidget::gameUpdateStatusChanged,
             m_settingsWidget, &DLSSSettingsWidget::updateGameStatus);
+    connect(m_gameList, &GameListWidget::gameUpdateStatusChanged, this, [this](const Game& game) {
+        // The selection is a copy, so a platform settled after it was made has
+        // to be carried across, or Play uses the guess.
+        if (game.settingsKey() == m_currentGame.settingsKey()) {
+            m_currentGame.setIsNativeLinux(game.isNativeLinux());
+            m_currentGame.setPlatformPending(game.platformPending());
+        }
+    });
     connect(m_settingsWidget, &DLSSSettingsWidget::settingsChanged, this, &MainWindow::onSettingsChanged);
     connect(m_settingsWidget, &DLSSSettingsWidget::playClicked, this, &MainWindow::onPlayClicked);
     connect(m_settingsWidget, &DLSSSettingsWidget::copyClicked, this, &MainWindow::onCopyToClipboard);
@@ -335,10 +364,50 @@ void MainWindow::setupToolBar()
 void MainWindow::loadGames()
 {
     m_gamesLoadedThisRefresh = true;
-    QList<Game> games = LauncherManager::instance().discoverAllGames();
+
+    // Discovery runs off this thread and reports back. An empty list fills in
+    // as games are found, since anything beats an empty window; a list already
+    // on screen stays as it is until the new one is whole, rather than being
+    // emptied under the user's cursor and rebuilt a batch at a time.
+    m_streamDiscovery = m_gameList->gameCount() == 0;
+    m_discoveryGeneration = LauncherManager::instance().discoverAllGamesAsync();
+    statusBar()->showMessage("Looking for games...");
+}
+
+void MainWindow::onGamesBatchDiscovered(quint64 generation, const QList<Game>& games)
+{
+    if (generation != m_discoveryGeneration || !m_streamDiscovery) {
+        return;
+    }
+    m_gameList->addGames(games);
+    m_gameCountLabel->setText(QString::number(m_gameList->gameCount()));
+}
+
+void MainWindow::onDiscoveryFinished(quint64 generation, const QList<Game>& games,
+                                     const QStringList& timedOut)
+{
+    if (generation != m_discoveryGeneration) {
+        return;
+    }
+    // The settled list, in launcher order and sorted the way each launcher
+    // sorts, replaces whatever order the batches arrived in. Anything a slow
+    // launcher finds from here on is appended as it comes.
     m_gameList->setGames(games);
+    m_streamDiscovery = true;
+    m_libraryWatcher->rewatch();
     m_gameCountLabel->setText(QString::number(games.count()));
-    statusBar()->showMessage(QString("Found %1 games").arg(games.count()), 3000);
+    // Rank each game's executables now, off this thread, so a launch finds
+    // them instead of walking the install directory.
+    ExecutableIndex::instance().refreshInBackground(games);
+
+    if (timedOut.isEmpty()) {
+        statusBar()->showMessage(QString("Found %1 games").arg(games.count()), 3000);
+    } else {
+        statusBar()->showMessage(QString("Found %1 games; still waiting on %2")
+                                     .arg(games.count())
+                                     .arg(timedOut.join(", ")),
+                                 10000);
+    }
 }
 
 void MainWindow::refreshGameList()
@@ -415,6 +484,18 @@ void MainWindow::onPlayClicked()
         return;
     }
 
+    // Clicked before the background pass got to it. Native or Proton is the
+    // one thing a launch cannot guess, so it is settled here, on the spot.
+    if (m_currentGame.platformPending()) {
+        if (const auto launcher = LauncherManager::instance().launcher(m_currentGame.launcher())) {
+            const QList<Game> settled = launcher->classifyGames({m_currentGame});
+            if (!settled.isEmpty()) {
+                m_currentGame.setIsNativeLinux(settled.first().isNativeLinux());
+                m_currentGame.setPlatformPending(false);
+            }
+        }
+    }
+
     DLSSSettings settings = m_settingsWidget->settings();
 
     // Set the user-selected executable path on the game
@@ -12,6 +12,8 @@
 #include "runner/GameRunner.h"
 #include "utils/GPUDetector.h"
 
+class LibraryWatcher;
+
 class MainWindow : public QMainWindow {
     Q_OBJECT
 
@@ -48,6 +50,9 @@ private:
     void setupMenuBar();
     void setupToolBar();
     void loadGames();
+    void onGamesBatchDiscovered(quint64 generation, const QList<Game>& games);
+    void onDiscoveryFinished(quint64 generation, const QList<Game>& games,
+                             const QStringList& timedOut);
     void checkProtonOnStartup();
     QWidget* createWelcomeWidget();
 
@@ -58,11 +63,14 @@ private:
     QWidget* m_welcomeWidget;
     QLabel* m_gameCountLabel;
     GameRunner* m_gameRunner;
+    LibraryWatcher* m_libraryWatcher;
 
     Game m_currentGame;
     bool m_dialogInstallActive = false;
     bool m_authWarningShown = false;  // show the expired-token warning at most once per session
     bool m_gamesLoadedThisRefresh = false;  // see refreshGameList()
+    quint64 m_discoveryGeneration = 0;      // the discovery the list is waiting on
+    bool m_streamDiscovery = false;         // see loadGames()
 };
 
 #endif // MAINWINDOW_H
@@ -13,6 +13,7 @@
 #include <QFileDialog>
 #include <QFileInfo>
 #include "gog/GogAuth.h"
+#include "gog/GogConcurrency.h"
 #include "gog/GogInstallRegistry.h"
 #include "launchers/SteamStoreService.h"
 #include <QTimer>
@@ -398,6 +399,33 @@ QWidget* SettingsDialog::buildGogPage()
     languageHint->setWordWrap(true);
     languageHint->setStyleSheet("color: #777; font-size: 11px;");
 
+    auto* parallelLabel = new QLabel("Most downloads at once");
+    parallelLabel->setStyleSheet("color: #ccc; font-size: 12px;");
+
+    m_gogParallelBox = new QSpinBox;
+    m_gogParallelBox->setRange(GogConcurrency::kFloor, GogConcurrency::kHardCeiling);
+
+    auto* parallelHint = new QLabel(
+        "A ceiling, not a fixed number: installs start at four and adjust to what "
+        "the connection carries. Lower it if downloads keep timing out.");
+    parallelHint->setWordWrap(true);
+    parallelHint->setStyleSheet("color: #777; font-size: 11px;");
+
+    auto* chunkStoreLabel = new QLabel("Keep downloaded data for reuse");
+    chunkStoreLabel->setStyleSheet("color: #ccc; font-size: 12px;");
+
+    m_gogChunkStoreBox = new QSpinBox;
+    m_gogChunkStoreBox->setRange(0, 1024);
+    m_gogChunkStoreBox->setSuffix(" GB");
+    m_gogChunkStoreBox->setSpecialValueText("Off");
+
+    auto* chunkStoreHint = new QLabel(
+        "Reinstalling a game, switching its language or installing it to a second "
+        "library reads what is kept here instead of downloading it again. The oldest "
+        "data goes first once the limit is reached.");
+    chunkStoreHint->setWordWrap(true);
+    chunkStoreHint->setStyleSheet("color: #777; font-size: 11px;");
+
     layout->addWidget(header);
     layout->addWidget(status);
     layout->addSpacing(12);
@@ -409,6 +437,14 @@ QWidget* SettingsDialog::buildGogPage()
     layout->addWidget(languageLabel);
     layout->addWidget(m_gogLanguageBox);
     layout->addWidget(languageHint);
+    layout->addSpacing(12);
+    layout->addWidget(parallelLabel);
+    layout->addWidget(m_gogParallelBox, 0, Qt::AlignLeft);
+    layout->addWidget(parallelHint);
+    layout->addSpacing(12);
+    layout->addWidget(chunkStoreLabel);
+    layout->addWidget(m_gogChunkStoreBox, 0, Qt::AlignLeft);
+    layout->addWidget(chunkStoreHint);
     layout->addStretch();
     return page;
 }
@@ -425,6 +461,9 @@ void SettingsDialog::loadSettings()
     const int languageIndex =
         m_gogLanguageBox->findData(settings.value("gog/language", "en-US").toString());
     m_gogLanguageBox->setCurrentIndex(languageIndex >= 0 ? languageIndex : 0);
+    m_gogParallelBox->setValue(
+        settings.value("gog/maxParallelDownloads", GogConcurrency::kDefaultCeiling).toInt());
+    m_gogChunkStoreBox->setValue(settings.value("gog/chunkStoreGB", 0).toInt());
 }
 
 void SettingsDialog::saveSettings()
@@ -451,6 +490,8 @@ void SettingsDialog::saveSettings()
     installRoot.isEmpty() ? settings.remove("gog/installRoot")
                           : settings.setValue("gog/installRoot", installRoot);
     settings.setValue("gog/language", m_gogLanguageBox->currentData().toString());
+    settings.setValue("gog/maxParallelDownloads", m_gogParallelBox->value());
+    settings.setValue("gog/chunkStoreGB", m_gogChunkStoreBox->value());
 
     // Nothing reports success, only failure — so give the write a moment to fail
     // and accept if it did not. A keychain round trip is milliseconds; this is
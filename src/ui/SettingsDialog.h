@@ -7,6 +7,7 @@
 #include <QComboBox>
 #include <QLineEdit>
 #include <QPushButton>
+#include <QSpinBox>
 
 #include "core/SecretStore.h"
 
@@ -35,6 +36,8 @@ private:
     QLineEdit*      m_steamIdEdit = nullptr;
     QLineEdit*      m_gogInstallRootEdit = nullptr;
     QComboBox*      m_gogLanguageBox = nullptr;
+    QSpinBox*       m_gogParallelBox = nullptr;
+    QSpinBox*       m_gogChunkStoreBox = nullptr;
     QPushButton*    m_saveButton = nullptr;
 };
 
@@ -40,6 +40,7 @@ QLabel* sectionLabel(const QString& text, QWidget* parent)
 
 StoreLibraryDialog::StoreLibraryDialog(QWidget* parent)
     : QDialog(parent)
+    , m_search(new AsyncSearch(this))
 {
     setWindowTitle("Game Stores");
     resize(1000, 620);
@@ -244,6 +245,12 @@ void StoreLibraryDialog::setupUI()
     connect(m_entryList, &QListWidget::itemSelectionChanged, this,
             &StoreLibraryDialog::onEntrySelected);
     connect(m_searchBox, &QLineEdit::textChanged, this, &StoreLibraryDialog::onSearchChanged);
+    connect(m_search, &AsyncSearch::resultsReady, this,
+            [this](const QString& query, const QStringList& ids) {
+        m_filterText = query;
+        m_matchingIds = ids;
+        rebuildEntryList();
+    });
     connect(m_middleAction, &QPushButton::clicked, this, &StoreLibraryDialog::onSignInClicked);
     connect(m_signOutButton, &QPushButton::clicked, this, &StoreLibraryDialog::onSignOutClicked);
     connect(m_refreshButton, &QPushButton::clicked, this, &StoreLibraryDialog::onRefreshClicked);
@@ -281,6 +288,7 @@ void StoreLibraryDialog::populateStores()
                 m_entriesByLauncher.insert(service->launcherName(), entries);
                 if (currentService() == service) {
                     m_libraryBusy->hide();
+                    refreshSearchDocuments();
                     refreshInstalledState();
                     rebuildEntryList();
                 }
@@ -437,6 +445,7 @@ StoreEntry StoreLibraryDialog::entryById(const QString& id) const
 void StoreLibraryDialog::onStoreSelected()
 {
     clearDetails();
+    refreshSearchDocuments();
     refreshInstalledState();
     showStoreState();
 }
@@ -494,13 +503,34 @@ void StoreLibraryDialog::rebuildEntryList()
                                  : QString();
     m_searchBox->setVisible(true);
 
-    m_entryList->clear();
-    for (const StoreEntry& entry : entries) {
-        if (!m_filterText.isEmpty()
-            && !entry.title.contains(m_filterText, Qt::CaseInsensitive)) {
-            continue;
+    // While searching, only the matches get a row, in the order the search
+    // ranked them. A store library can run to tens of thousands of entries,
+    // and a row per entry is what made each keystroke slow.
+    QList<const StoreEntry*> shown;
+    if (m_filterText.isEmpty()) {
+        shown.reserve(entries.size());
+        for (const StoreEntry& entry : entries) {
+            shown.append(&entry);
         }
+    } else {
+        QHash<QString, const StoreEntry*> byId;
+        byId.reserve(entries.size());
+        for (const StoreEntry& entry : entries) {
+            byId.insert(entry.id, &entry);
+        }
+        // An answer can predate the entries; ids it names that have gone are
+        // skipped, and the search runs again for the new ones.
+        for (const QString& id : m_matchingIds) {
+            if (const StoreEntry* entry = byId.value(id)) {
+                shown.append(entry);
+            }
+        }
+    }
 
+    m_entryList->setUpdatesEnabled(false);
+    m_entryList->clear();
+    for (const StoreEntry* shownEntry : shown) {
+        const StoreEntry& entry = *shownEntry;
         const bool isInstalled = m_installed.ids.contains(entry.id);
         const bool isUpdatable = m_installed.needUpdate.contains(entry.id);
 
@@ -524,6 +554,7 @@ void StoreLibraryDialog::rebuildEntryList()
             m_entryList->setCurrentItem(item);
         }
     }
+    m_entryList->setUpdatesEnabled(true);
 
     if (m_entryList->count() == 0) {
         m_middleMessage->setText(entries.isEmpty()
@@ -539,8 +570,23 @@ void StoreLibraryDialog::rebuildEntryList()
 
 void StoreLibraryDialog::onSearchChanged(const QString& text)
 {
-    m_filterText = text;
-    rebuildEntryList();
+    // The list is rebuilt when the answer arrives, not on each keystroke.
+    m_search->setQuery(text);
+}
+
+void StoreLibraryDialog::refreshSearchDocuments()
+{
+    // Only the store on screen is searched; switching stores swaps the
+    // documents, and a standing query is run again over the new ones.
+    QList<SearchIndex::Document> documents;
+    if (IStoreService* service = currentService()) {
+        const QList<StoreEntry> entries = m_entriesByLauncher.value(service->launcherName());
+        documents.reserve(entries.size());
+        for (const StoreEntry& entry : entries) {
+            documents.append({entry.id, entry.title, {entry.id}});
+        }
+    }
+    m_search->setDocuments(documents);
 }
 
 void StoreLibraryDialog::onEntrySelected()
@@ -571,6 +617,11 @@ void StoreLibraryDialog::showDetails(const StoreEntry& entry)
 
     m_detailTitle->setText(entry.title);
 
+    // The one cover on screen. Clicking down the list drops the covers still
+    // queued for the entries clicked past.
+    ImageCache::instance().setVisibleUrls(this, entry.imageUrl.isEmpty()
+                                                    ? QStringList()
+                                                    : QStringList{entry.imageUrl});
     if (!entry.imageUrl.isEmpty()) {
         const QPixmap art = ImageCache::instance().getImage(entry.imageUrl, QSize(230, 107));
         m_detailImage->setPixmap(art);
@@ -781,6 +832,7 @@ void StoreLibraryDialog::showProgress(const QString& id, const StoreInstallProgr
 
 void StoreLibraryDialog::clearDetails()
 {
+    ImageCache::instance().setVisibleUrls(this, {});
     m_detailImage->clear();
     m_detailTitle->clear();
     m_detailBody->clear();
@@ -13,6 +13,7 @@
 #include <QStackedWidget>
 
 #include "core/Game.h"
+#include "core/SearchIndex.h"
 #include "launchers/IStoreService.h"
 
 // Browsing what you own, across every store ProtonForge can talk to.
@@ -53,6 +54,7 @@ private:
     void showStoreState();
     void refreshInstalledState();
     void rebuildEntryList();
+    void refreshSearchDocuments();
     void showDetails(const StoreEntry& entry);
     void clearDetails();
     void refreshDetails();
@@ -103,7 +105,14 @@ private:
     InstalledState m_installed;
     QString m_installingId;
     bool m_installPaused = false;
+
+    // The search box is answered off the GUI thread, so the list shows the
+    // last answer rather than the text as typed. m_filterText is the query that
+    // answer was for, and empty while not searching; m_matchingIds are the ids
+    // it found, best first.
+    AsyncSearch* m_search;
     QString m_filterText;
+    QStringList m_matchingIds;
 };
 
 #endif // STORELIBRARYDIALOG_H
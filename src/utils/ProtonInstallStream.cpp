@@ -0,0 +1,482 @@
+#include "ProtonInstallStream.h"
+
+#include <QDir>
+#include <QFileInfo>
+#include <QNetworkAccessManager>
+#include <QNetworkReply>
+#include <QProcess>
+#include <QRegularExpression>
+#include <QTimer>
+
+#include <utility>
+
+namespace {
+
+// What the reply may hold before it stops reading from the socket, and what
+// tar's stdin may have queued before the reply stops being read. Together the
+// most an install holds in memory, whatever the archive's size.
+constexpr qint64 kReplyBuffer = 4 * 1024 * 1024;
+constexpr qint64 kPipeBacklog = 8 * 1024 * 1024;
+constexpr qint64 kPiece = 1024 * 1024;
+
+// A dropped connection is resumed this many times before the install fails.
+constexpr int kMaxAttempts = 4;
+
+// Reset by every byte that moves, so it bounds a hang — a wedged tar, a
+// connection that neither delivers nor fails — rather than a slow link.
+constexpr int kStallMs = 10 * 60 * 1000;
+
+QString archiveStem(const QString& fileName)
+{
+    static const QRegularExpression suffix(QStringLiteral("\\.tar(\\.[A-Za-z0-9]+)?$"));
+    QString stem = fileName;
+    stem.remove(suffix);
+    return stem;
+}
+
+// A reply whose status says the request itself was wrong: retrying it sends
+// the same request to the same answer.
+bool isPermanent(QNetworkReply* reply)
+{
+    const int status = reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+    return status >= 400 && status < 500;
+}
+
+} // namespace
+
+ProtonInstallStream::ProtonInstallStream(QNetworkAccessManager* manager,
+                                         const QString& compatDir, QObject* parent)
+    : QObject(parent)
+    , m_manager(manager)
+    , m_compatDir(compatDir)
+{
+}
+
+ProtonInstallStream::~ProtonInstallStream()
+{
+    // Quietly: whoever is deleting it is no longer listening.
+    if (!m_settled) {
+        m_settled = true;
+        tearDown();
+    }
+}
+
+// --- pure --------------------------------------------------------------------
+
+QString ProtonInstallStream::parseSha512Sum(const QByteArray& text, const QString& fileName)
+{
+    // "<128 hex>  name", or "<128 hex> *name" for a binary-mode sum.
+    static const QRegularExpression line(
+        QStringLiteral("^([0-9a-fA-F]{128})(?:\\s+\\*?(.*))?$"));
+
+    const QStringList lines =
+        QString::fromUtf8(text).split('\n', Qt::SkipEmptyParts);
+    QString onlyUnnamed;
+    int digests = 0;
+    for (const QString& raw : lines) {
+        const QRegularExpressionMatch match = line.match(raw.trimmed());
+        if (!match.hasMatch()) {
+            continue;
+        }
+        ++digests;
+        const QString name = QFileInfo(match.captured(2).trimmed()).fileName();
+        if (name == fileName) {
+            return match.captured(1).toLower();
+        }
+        if (name.isEmpty()) {
+            onlyUnnamed = match.captured(1).toLower();
+        }
+    }
+    return digests == 1 ? onlyUnnamed : QString();
+}
+
+QStringList ProtonInstallStream::tarArguments(const QString& fileName)
+{
+    QString filter;
+    if (fileName.endsWith(QLatin1String(".tar.xz"))) {
+        filter = QStringLiteral("--xz");
+    } else if (fileName.endsWith(QLatin1String(".tar.gz"))
+               || fileName.endsWith(QLatin1String(".tgz"))) {
+        filter = QStringLiteral("--gzip");
+    } else if (fileName.endsWith(QLatin1String(".tar.zst"))) {
+        filter = QStringLiteral("--zstd");
+    } else if (!fileName.endsWith(QLatin1String(".tar"))) {
+        return {};
+    }
+    QStringList arguments{QStringLiteral("--extract")};
+    if (!filter.isEmpty()) {
+        arguments << filter;
+    }
+    arguments << QStringLiteral("--file") << QStringLiteral("-");
+    return arguments;
+}
+
+qint64 ProtonInstallStream::contentRangeStart(const QByteArray& header)
+{
+    const QByteArray value = header.trimmed();
+    if (!value.startsWith("bytes ")) {
+        return -1;
+    }
+    const qsizetype dash = value.indexOf('-', 6);
+    if (dash < 0) {
+        return -1;
+    }
+    bool ok = false;
+    const qint64 start = value.mid(6, dash - 6).trimmed().toLongLong(&ok);
+    return ok && start >= 0 ? start : -1;
+}
+
+QString ProtonInstallStream::stagingPath(const QString& compatDir, const QString& fileName)
+{
+    // Dot-prefixed: Steam lists every directory here as a compatibility tool,
+    // and a half-unpacked one must not be offered.
+    return compatDir + "/.protonforge-staging-" + archiveStem(fileName);
+}
+
+QString ProtonInstallStream::promoteStaged(const QString& staging, const QString& target)
+{
+    const QStringList names =
+        QDir(staging).entryList(QDir::Dirs | QDir::NoDotAndDotDot | QDir::Hidden);
+    if (names.isEmpty()) {
+        return QStringLiteral("the archive held no directory");
+    }
+
+    QDir dir(target);
+    for (const QString& name : names) {
+        const QString dest = target + "/" + name;
+        const QString aside = target + "/.protonforge-old-" + name;
+        QDir(aside).removeRecursively();
+
+        const bool replacing = QFileInfo::exists(dest);
+        if (replacing && !dir.rename(name, QFileInfo(aside).fileName())) {
+            return QStringLiteral("could not move the installed %1 aside").arg(name);
+        }
+        if (!QDir().rename(staging + "/" + name, dest)) {
+            if (replacing) {
+                dir.rename(QFileInfo(aside).fileName(), name);
+            }
+            return QStringLiteral("could not move %1 into %2").arg(name, target);
+        }
+        if (replacing) {
+            QDir(aside).removeRecursively();
+        }
+    }
+    return QString();
+}
+
+// --- the install -------------------------------------------------------------
+
+void ProtonInstallStream::start(const QNetworkRequest& archiveRequest, const QString& fileName,
+                                const QNetworkRequest& checksumRequest)
+{
+    m_archiveRequest = archiveRequest;
+    m_fileName = fileName;
+
+    if (tarArguments(fileName).isEmpty()) {
+        fail(QStringLiteral("Extraction failed: %1 is not an archive ProtonForge can unpack")
+                 .arg(fileName));
+        return;
+    }
+    if (!QDir().mkpath(m_compatDir)) {
+        fail(QStringLiteral("Extraction failed: cannot create %1").arg(m_compatDir));
+        return;
+    }
+    m_staging = stagingPath(m_compatDir, fileName);
+    QDir(m_staging).removeRecursively();   // an earlier attempt's leftovers
+    if (!QDir().mkpath(m_staging)) {
+        fail(QStringLiteral("Extraction failed: cannot create %1").arg(m_staging));
+        return;
+    }
+
+    m_watchdog = new QTimer(this);
+    m_watchdog->setSingleShot(true);
+    connect(m_watchdog, &QTimer::timeout, this, [this]() {
+        fail(QStringLiteral("Installation failed: no progress for 10 minutes"));
+    });
+    touch();
+
+    if (checksumRequest.url().isEmpty()) {
+        startArchive();
+        return;
+    }
+
+    // Small, and needed before the archive's last byte rather than its first,
+    // but fetched first anyway: a release whose checksum cannot be had is one
+    // to refuse before spending the bandwidth.
+    QNetworkReply* reply = m_manager->get(checksumRequest);
+    m_reply = reply;
+    connect(reply, &QNetworkReply::finished, this, [this, reply]() {
+        reply->deleteLater();
+        if (m_reply != reply) {
+            return;
+        }
+        m_reply = nullptr;
+        if (reply->error() != QNetworkReply::NoError) {
+            fail(QStringLiteral("Download failed: could not fetch the release's checksum: %1")
+                     .arg(reply->errorString()));
+            return;
+        }
+        m_expectedSha512 = parseSha512Sum(reply->readAll(), m_fileName);
+        if (m_expectedSha512.isEmpty()) {
+            fail(QStringLiteral("Download failed: the release's checksum file does not "
+                                "list %1").arg(m_fileName));
+            return;
+        }
+        startArchive();
+    });
+}
+
+void ProtonInstallStream::startArchive()
+{
+    m_tar = new QProcess(this);
+    m_tar->setWorkingDirectory(m_staging);
+    m_tar->setStandardOutputFile(QProcess::nullDevice());
+
+    connect(m_tar, QOverload<int, QProcess::ExitStatus>::of(&QProcess::finished), this,
+            [this](int exitCode, QProcess::ExitStatus status) {
+        onTarFinished(exitCode, status == QProcess::NormalExit);
+    });
+    // Only the failure to start needs handling here: everything else that can
+    // go wrong with tar also ends in finished(), with its own explanation.
+    connect(m_tar, &QProcess::errorOccurred, this, [this](QProcess::ProcessError error) {
+        if (error == QProcess::FailedToStart) {
+            fail(QStringLiteral("Extraction failed: could not run tar — is it installed?"));
+        }
+    });
+    // Whatever tar has taken leaves room for more of the reply.
+    connect(m_tar, &QProcess::bytesWritten, this, [this]() {
+        touch();
+        drain();
+    });
+
+    m_tar->start(QStringLiteral("tar"), tarArguments(m_fileName));
+    request();
+}
+
+void ProtonInstallStream::request()
+{
+    QNetworkRequest request = m_archiveRequest;
+    if (m_fed > 0) {
+        request.setRawHeader("Range", "bytes=" + QByteArray::number(m_fed) + "-");
+    }
+    ++m_attempts;
+    m_replyDone = false;
+    m_skip = 0;
+    m_requestFrom = m_fed;
+    m_accepted = false;
+    m_refusal.clear();
+    m_refusalPermanent = false;
+
+    QNetworkReply* reply = m_manager->get(request);
+    m_reply = reply;
+    reply->setReadBufferSize(kReplyBuffer);
+
+    connect(reply, &QNetworkReply::metaDataChanged, this, [this, reply]() {
+        if (m_reply != reply || m_accepted || !m_refusal.isNull()) {
+            return;
+        }
+        const int status = reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+        if (status == 0 || (status >= 300 && status < 400)) {
+            return;   // a redirect on the way to GitHub's storage; not the answer yet
+        }
+        if (status == 200) {
+            // The whole file. When a resume was asked for, what tar already
+            // has is read past rather than fed twice.
+            m_skip = m_fed;
+            m_accepted = true;
+            return;
+        }
+        if (status == 206) {
+            const qint64 start = contentRangeStart(reply->rawHeader("Content-Range"));
+            if (start == m_fed) {
+                m_accepted = true;
+                return;
+            }
+            m_refusal = QStringLiteral("the server resumed at byte %1 rather than %2")
+                            .arg(start).arg(m_fed);
+        } else {
+            const QString reason =
+                reply->attribute(QNetworkRequest::HttpReasonPhraseAttribute).toString();
+            m_refusal = QStringLiteral("the server answered HTTP %1 %2")
+                            .arg(status).arg(reason).trimmed();
+            m_refusalPermanent = status >= 400 && status < 500;
+        }
+        // Its body is not the archive. finished() follows, and settleReply()
+        // retries or fails under the reason above.
+        reply->abort();
+    });
+    connect(reply, &QNetworkReply::downloadProgress, this,
+            [this, reply](qint64, qint64 total) {
+        if (m_reply != reply || total <= 0) {
+            return;
+        }
+        // A 206 reports the rest of the file, from where this request began.
+        const int status = reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+        m_total = status == 206 ? m_requestFrom + total : total;
+    });
+    connect(reply, &QNetworkReply::readyRead, this, [this, reply]() {
+        if (m_reply == reply) {
+            drain();
+        }
+    });
+    connect(reply, &QNetworkReply::finished, this, [this, reply]() {
+        if (m_reply != reply) {
+            reply->deleteLater();
+            return;
+        }
+        m_replyDone = true;
+        drain();
+    });
+}
+
+void ProtonInstallStream::drain()
+{
+    if (!m_reply || !m_tar || m_inputClosed) {
+        return;
+    }
+    while (m_accepted && m_reply->bytesAvailable() > 0 && m_tar->bytesToWrite() < kPipeBacklog) {
+        QByteArray piece = m_reply->read(kPiece);
+        if (m_skip > 0) {
+            const qint64 dropped = qMin<qint64>(m_skip, piece.size());
+            piece.remove(0, static_cast<int>(dropped));
+            m_skip -= dropped;
+        }
+        if (piece.isEmpty()) {
+            continue;
+        }
+        m_sha512.addData(piece);
+        m_tar->write(piece);
+        m_fed += piece.size();
+        touch();
+        emit progress(m_fed, m_total);
+    }
+    if (m_replyDone && (!m_accepted || m_reply->bytesAvailable() == 0)) {
+        settleReply();
+    }
+}
+
+void ProtonInstallStream::settleReply()
+{
+    QNetworkReply* reply = m_reply;
+    m_reply = nullptr;
+    reply->deleteLater();
+
+    if (!m_refusal.isNull()) {
+        if (m_refusalPermanent || m_attempts >= kMaxAttempts) {
+            fail(QStringLiteral("Download failed: %1").arg(m_refusal));
+            return;
+        }
+        request();
+        return;
+    }
+    if (reply->error() == QNetworkReply::NoError) {
+        if (!m_accepted) {
+            // Finished without a status that says what the body was.
+            fail(QStringLiteral("Download failed: the server sent no usable response"));
+            return;
+        }
+        completeDownload();
+        return;
+    }
+    if (reply->error() == QNetworkReply::OperationCanceledError) {
+        return;   // cancel() or fail() got there first
+    }
+    if (isPermanent(reply) || m_attempts >= kMaxAttempts) {
+        fail(QStringLiteral("Download failed: %1").arg(reply->errorString()));
+        return;
+    }
+    request();   // the rest of it, from where tar is
+}
+
+void ProtonInstallStream::completeDownload()
+{
+    if (!m_expectedSha512.isEmpty()) {
+        const QString actual = QString::fromLatin1(m_sha512.result().toHex());
+        if (actual != m_expectedSha512) {
+            fail(QStringLiteral("Download failed: the archive does not match the release's "
+                                "SHA-512 checksum — it is damaged or was tampered with"));
+            return;
+        }
+    }
+    // Verified: tar may now see the end of its input, and finish.
+    m_inputClosed = true;
+    m_tar->closeWriteChannel();
+    emit extractionStarted();
+}
+
+void ProtonInstallStream::onTarFinished(int exitCode, bool normalExit)
+{
+    if (m_settled) {
+        return;
+    }
+    if (!m_inputClosed) {
+        // Before the end of the input: the archive is corrupt, or the disk
+        // is full. Either way what it said is the explanation.
+        const QString detail = QString::fromLocal8Bit(m_tar->readAllStandardError()).trimmed();
+        fail(QStringLiteral("Extraction failed: %1")
+                 .arg(detail.isEmpty() ? QStringLiteral("tar stopped early") : detail));
+        return;
+    }
+    if (!normalExit || exitCode != 0) {
+        const QString detail = QString::fromLocal8Bit(m_tar->readAllStandardError()).trimmed();
+        fail(QStringLiteral("Extraction failed: %1")
+                 .arg(detail.isEmpty() ? m_tar->errorString() : detail));
+        return;
+    }
+    succeed();
+}
+
+void ProtonInstallStream::succeed()
+{
+    const QString error = promoteStaged(m_staging, m_compatDir);
+    QDir(m_staging).removeRecursively();
+    if (!error.isNull()) {
+        fail(QStringLiteral("Extraction failed: %1").arg(error));
+        return;
+    }
+    m_settled = true;
+    m_watchdog->stop();
+    emit finished(true, QString());
+}
+
+void ProtonInstallStream::cancel()
+{
+    fail(QStringLiteral("Installation cancelled"));
+}
+
+void ProtonInstallStream::fail(const QString& message)
+{
+    if (m_settled) {
+        return;
+    }
+    m_settled = true;
+    tearDown();
+    emit finished(false, message);
+}
+
+void ProtonInstallStream::tearDown()
+{
+    if (m_watchdog) {
+        m_watchdog->stop();
+    }
+    if (QNetworkReply* reply = std::exchange(m_reply, nullptr)) {
+        reply->disconnect(this);
+        reply->abort();
+        reply->deleteLater();
+    }
+    if (m_tar) {
+        m_tar->disconnect(this);
+        m_tar->kill();
+        m_tar->waitForFinished(5000);
+    }
+    if (!m_staging.isEmpty()) {
+        QDir(m_staging).removeRecursively();
+    }
+}
+
+void ProtonInstallStream::touch()
+{
+    if (m_watchdog) {
+        m_watchdog->start(kStallMs);
+    }
+}
@@ -0,0 +1,138 @@
+#ifndef PROTONINSTALLSTREAM_H
+#define PROTONINSTALLSTREAM_H
+
+#include <QCryptographicHash>
+#include <QNetworkRequest>
+#include <QObject>
+#include <QPointer>
+#include <QString>
+#include <QStringList>
+
+class QNetworkAccessManager;
+class QNetworkReply;
+class QProcess;
+class QTimer;
+
+// One Proton release on its way from GitHub into compatibilitytools.d, without
+// ever being an archive on disk.
+//
+// ProtonManager used to buffer the whole asset in the reply, write it to the
+// temp directory once the reply finished, and only then run `tar` on it: four
+// to six hundred megabytes of RAM per install, and the archive written and
+// read back in full before the first file appeared. Here the reply's bytes go
+// to tar's stdin as they arrive, so the download and the extraction overlap
+// and the archive only ever exists as a few megabytes in flight. When tar
+// falls behind, the reply is simply not read, and its bounded read buffer
+// pushes back on the connection rather than on memory.
+//
+// What makes that safe to do with an unverified download:
+//
+//   The tree is unpacked into a staging directory inside compatibilitytools.d
+//   and renamed into place only once everything checks out. Steam never sees a
+//   half-extracted tool, and an install that fails leaves the old version of
+//   the tool exactly where it was.
+//
+//   The SHA-512 is computed as the bytes go by, and checked against the
+//   release's own .sha512sum asset before tar is told the input has ended.
+//   A mismatch throws the staging directory away; nothing is read twice.
+//
+//   A connection that drops part-way is resumed with a Range request from
+//   the byte tar has reached, a few times, with tar still waiting on the other
+//   end of the pipe. A server that answers the resume with the whole file has
+//   its first bytes skipped instead.
+//
+//   Nothing reaches tar or the hash until the response's status says what the
+//   body is: a 200, or a 206 that starts at the byte tar has reached. An error
+//   page, or a 206 from anywhere else, is aborted and goes the way of any
+//   other failed request, under its own HTTP error rather than as a damaged
+//   archive.
+//
+// Single-use: start() once, then wait for finished().
+class ProtonInstallStream : public QObject
+{
+    Q_OBJECT
+
+public:
+    ProtonInstallStream(QNetworkAccessManager* manager, const QString& compatDir,
+                        QObject* parent = nullptr);
+    ~ProtonInstallStream() override;
+
+    // `checksumRequest` with an empty URL skips the check: not every release
+    // publishes one. Both requests are sent as given, headers and all.
+    void start(const QNetworkRequest& archiveRequest, const QString& fileName,
+               const QNetworkRequest& checksumRequest);
+    void cancel();
+
+    // --- pure ---
+
+    // The digest `sha512sum` printed for `fileName`, in lower case, or empty
+    // when the text has none. A one-line file with no name, as some releases
+    // publish, is taken to be about the archive.
+    static QString parseSha512Sum(const QByteArray& text, const QString& fileName);
+
+    // tar's arguments for an archive of this name arriving on stdin: with no
+    // file to seek in, the compression has to be named rather than sniffed.
+    // Empty for a kind tar is not asked to handle.
+    static QStringList tarArguments(const QString& fileName);
+
+    // Where a 206's body begins, from "bytes <first>-<last>/<total>"; -1 when
+    // the header is missing or is not that.
+    static qint64 contentRangeStart(const QByteArray& header);
+
+    // Where `fileName` is unpacked before it is moved into `compatDir`. On the
+    // same filesystem, so the move is a rename.
+    static QString stagingPath(const QString& compatDir, const QString& fileName);
+
+    // Moves every directory at the top of `staging` into `target`, replacing a
+    // directory of the same name: the old one is renamed aside first and only
+    // deleted once the new one is in, and put back if the new one will not go.
+    // Returns a null QString on success, an error otherwise.
+    static QString promoteStaged(const QString& staging, const QString& target);
+
+signals:
+    void progress(qint64 received, qint64 total);
+    // The download is complete and verified; tar is finishing what it has.
+    void extractionStarted();
+    // `message` is an error when `ok` is false, and empty otherwise.
+    void finished(bool ok, const QString& message);
+
+private:
+    void startArchive();
+    void request();
+    void drain();
+    void settleReply();
+    void completeDownload();
+    void onTarFinished(int exitCode, bool normalExit);
+    void succeed();
+    void fail(const QString& message);
+    void tearDown();
+    void touch();
+
+    QNetworkAccessManager* m_manager;
+    QString m_compatDir;
+    QString m_fileName;
+    QString m_staging;
+    QNetworkRequest m_archiveRequest;
+
+    // The manager owns its replies and may be destroyed before this stream
+    // is: ProtonManager's network manager is an earlier child than it.
+    QPointer<QNetworkReply> m_reply;
+    bool m_replyDone = false;
+    QProcess* m_tar = nullptr;
+    QTimer* m_watchdog = nullptr;
+
+    QCryptographicHash m_sha512{QCryptographicHash::Sha512};
+    QString m_expectedSha512;
+    qint64 m_fed = 0;            // bytes handed to tar, and hashed
+    qint64 m_skip = 0;           // leading bytes of a 200 that tar already has
+    qint64 m_requestFrom = 0;    // where the current request's body begins
+    bool m_accepted = false;     // the current reply's status allows its body
+    QString m_refusal;           // why it did not, once it has been aborted
+    bool m_refusalPermanent = false;
+    qint64 m_total = 0;
+    int m_attempts = 0;
+    bool m_inputClosed = false;
+    bool m_settled = false;
+};
+
+#endif // PROTONINSTALLSTREAM_H
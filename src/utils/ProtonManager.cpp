@@ -1,4 +1,5 @@
 #include "ProtonManager.h"
+#include "ProtonInstallStream.h"
 #include "core/SecretStore.h"
 #include "SteamPaths.h"
 #include <QDir>
@@ -8,15 +9,35 @@
 #include <QJsonArray>
 #include <QNetworkReply>
 #include <QNetworkRequest>
-#include <QProcess>
-#include <QTimer>
-#include <memory>
 #include <QSettings>
-#include <QStandardPaths>
 #include <QRegularExpression>
 #include <QSet>
 #include <algorithm>
 
+namespace {
+
+// Both forks publish "<archive without its extension>.sha512sum" beside the
+// archive itself.
+QString checksumAssetUrl(const QJsonArray& assets, const QString& archiveName)
+{
+    QString stem = archiveName;
+    for (const char* suffix : {".tar.xz", ".tar.gz", ".tar.zst"}) {
+        if (stem.endsWith(QLatin1String(suffix))) {
+            stem.chop(static_cast<int>(qstrlen(suffix)));
+            break;
+        }
+    }
+    for (const QJsonValue& assetValue : assets) {
+        const QJsonObject asset = assetValue.toObject();
+        if (asset["name"].toString() == stem + ".sha512sum") {
+            return asset["browser_download_url"].toString();
+        }
+    }
+    return QString();
+}
+
+} // namespace
+
 ProtonManager& ProtonManager::instance()
 {
     static ProtonManager instance;
@@ -26,8 +47,6 @@ ProtonManager& ProtonManager::instance()
 ProtonManager::ProtonManager()
     : m_networkManager(new QNetworkAccessManager(this))
 {
-    m_downloadPath = QStandardPaths::writableLocation(QStandardPaths::TempLocation);
-
     // Register metatype for use in QVariant
     qRegisterMetaType<ProtonRelease>("ProtonRelease");
     qRegisterMetaType<ProtonRelease>("ProtonManager::ProtonRelease");
@@ -37,7 +56,7 @@ QString ProtonManager::protonCachyOSPath()
 {
     // Despite the historical name, this returns the compatibilitytools.d
     // directory of whichever Steam install (native or Flatpak) was detected.
-    // New Proton installs land here via extractArchive().
+    // New Proton installs land here via ProtonInstallStream.
     return SteamPaths::defaultInstallCompatPath();
 }
 
@@ -305,6 +324,7 @@ ProtonManager::ProtonRelease ProtonManager::parseReleaseFromJson(const QJsonObje
             name.startsWith("proton-cachyos")) {
             release.fileName = name;
             release.downloadUrl = asset["browser_download_url"].toString();
+            release.checksumUrl = checksumAssetUrl(assets, name);
             release.versionNumber = parseVersion(name);
 
             // Extract version for display name
@@ -589,6 +609,7 @@ ProtonManager::ProtonRelease ProtonManager::parseProtonGEReleaseFromJson(const Q
         if (name.startsWith("GE-Proton") && name.endsWith(".tar.gz") && !name.contains("sha512sum")) {
             release.fileName = name;
             release.downloadUrl = asset["browser_download_url"].toString();
+            release.checksumUrl = checksumAssetUrl(assets, name);
             release.versionNumber = parseProtonGEVersion(release.version);
             release.displayName = QString("Proton-GE %1").arg(release.version);
             break;
@@ -645,107 +666,40 @@ void ProtonManager::updateProtonCachyOS()
 
 void ProtonManager::downloadRelease(const ProtonRelease& release)
 {
+    if (m_install) {
+        emit installationComplete(false, "Another Proton version is still being installed");
+        return;
+    }
     emit installationStarted();
 
-    QString filePath = m_downloadPath + "/" + release.fileName;
-
-    QNetworkRequest request(QUrl(release.downloadUrl));
+    QNetworkRequest request{QUrl(release.downloadUrl)};
     applyGitHubHeaders(request, false);
+    QNetworkRequest checksumRequest;
+    if (!release.checksumUrl.isEmpty()) {
+        checksumRequest.setUrl(QUrl(release.checksumUrl));
+        applyGitHubHeaders(checksumRequest, false);
+    }
 
-    QNetworkReply* reply = m_networkManager->get(request);
+    // Straight from the reply into tar, verified on the way and renamed into
+    // compatibilitytools.d only when complete — there is no archive on disk to
+    // clean up, and no copy of it in memory.
+    auto* install = new ProtonInstallStream(m_networkManager, protonCachyOSPath(), this);
+    m_install = install;
+    const QString name = release.type == ProtonGE ? "Proton-GE" : "Proton-CachyOS";
 
-    connect(reply, &QNetworkReply::downloadProgress, this, [this, release](qint64 received, qint64 total) {
-        QString name = release.type == ProtonGE ? "Proton-GE" : "Proton-CachyOS";
+    connect(install, &ProtonInstallStream::progress, this,
+            [this, name](qint64 received, qint64 total) {
         emit downloadProgress(received, total, name);
     });
-
-    connect(reply, &QNetworkReply::finished, this, [this, reply, filePath, release]() {
-        reply->deleteLater();
-
-        if (reply->error() != QNetworkReply::NoError) {
-            emit installationComplete(false, "Download failed: " + reply->errorString());
-            return;
-        }
-
-        // Save file
-        QFile file(filePath);
-        if (!file.open(QIODevice::WriteOnly)) {
-            emit installationComplete(false, "Cannot write to: " + filePath);
-            return;
-        }
-
-        file.write(reply->readAll());
-        file.close();
-
-        // Extract archive
-        extractArchive(filePath, release);
-    });
-}
-
-void ProtonManager::extractArchive(const QString& archivePath, const ProtonRelease& release)
-{
-    // Ensure target directory exists
-    QDir().mkpath(protonCachyOSPath());
-
-    // Extract using tar
-    QProcess* process = new QProcess(this);
-
-    // Guaranteed to run exactly once, however the extraction ends. Without this
-    // the install could never finish: only `finished` was connected, and QProcess
-    // does not emit that when the program fails to start — a missing `tar` left
-    // the progress UI waiting forever, as did a wedged one, since there was no
-    // timeout either.
-    // Shared, because all three handlers below hold a copy of `report` and
-    // whichever fires first has to lock the others out.
-    auto done = std::make_shared<bool>(false);
-    auto* watchdog = new QTimer(process);
-    auto report = [this, process, watchdog, done, archivePath, release](bool ok, const QString& detail) {
-        if (*done)
-            return;
-        *done = true;
-        watchdog->stop();
-        process->deleteLater();
-
-        // Clean up downloaded archive
-        QFile::remove(archivePath);
-
-        if (ok) {
-            const QString name = release.type == ProtonGE ? "Proton-GE" : "Proton-CachyOS";
-            emit installationComplete(true, name + " installed successfully");
-        } else {
-            emit installationComplete(false, "Extraction failed: " + detail);
-        }
-    };
-
-    connect(process, QOverload<int, QProcess::ExitStatus>::of(&QProcess::finished),
-            this, [process, report](int exitCode, QProcess::ExitStatus status) {
-        const bool ok = status == QProcess::NormalExit && exitCode == 0;
-        report(ok, ok ? QString() : process->errorString());
-    });
-
-    connect(process, &QProcess::errorOccurred, this,
-            [process, report](QProcess::ProcessError error) {
-        if (error == QProcess::FailedToStart) {
-            report(false, "could not run tar — is it installed?");
-        } else if (error != QProcess::Crashed) {
-            // Crashes arrive via finished() as well; anything else would not.
-            report(false, process->errorString());
-        }
-    });
-
-    // Generous: this unpacks a few hundred MB onto whatever disk the user has.
-    // It exists to bound a hang, not to police slow hardware.
-    watchdog->setSingleShot(true);
-    connect(watchdog, &QTimer::timeout, this, [process, report]() {
-        process->kill();
-        report(false, "tar did not finish within 10 minutes");
+    connect(install, &ProtonInstallStream::extractionStarted,
+            this, &ProtonManager::extractionStarted);
+    connect(install, &ProtonInstallStream::finished, this,
+            [this, install, name](bool ok, const QString& message) {
+        install->deleteLater();
+        emit installationComplete(ok, ok ? name + " installed successfully" : message);
     });
-    watchdog->start(10 * 60 * 1000);
 
-    // Extract to compatibilitytools.d
-    process->setWorkingDirectory(protonCachyOSPath());
-    emit extractionStarted();
-    process->start("tar", {"xf", archivePath});
+    install->start(request, release.fileName, checksumRequest);
 }
 
 bool ProtonManager::deleteProtonVersion(const ProtonRelease& release)
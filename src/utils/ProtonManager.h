@@ -3,10 +3,13 @@
 
 #include <QObject>
 #include <QNetworkAccessManager>
+#include <QPointer>
 #include <QVersionNumber>
 #include <QList>
 #include <QJsonObject>
 
+class ProtonInstallStream;
+
 class ProtonManager : public QObject {
     Q_OBJECT
 
@@ -22,6 +25,7 @@ public:
         QString version;
         QString downloadUrl;
         QString fileName;
+        QString checksumUrl;  // the release's <archive>.sha512sum, when it has one
         QVersionNumber versionNumber;
         ProtonType type = ProtonCachyOS;
         QString displayName;  // Human-readable name
@@ -109,8 +113,8 @@ private:
     // present in `releases` as entries with an empty downloadUrl (non-installable,
     // but still deletable via deleteProtonVersion).
     void appendInstalledOnlyReleases(QList<ProtonRelease>& releases) const;
+    // Streams the archive into tar as it downloads; see ProtonInstallStream.
     void downloadRelease(const ProtonRelease& release);
-    void extractArchive(const QString& archivePath, const ProtonRelease& release);
     ProtonRelease parseLatestRelease(const QByteArray& jsonData);
     QList<ProtonRelease> parseReleases(const QByteArray& jsonData, int maxCount = 5);
     QList<ProtonRelease> parseProtonGEReleases(const QByteArray& jsonData, int maxCount = 5);
@@ -131,7 +135,7 @@ private:
     ProtonRelease m_latestRelease;
     QList<ProtonRelease> m_availableReleases;
     QList<ProtonRelease> m_pendingCachyOSReleases;
-    QString m_downloadPath;
+    QPointer<ProtonInstallStream> m_install;
     QString m_lastFetchError;
     bool m_lastFetchAuthError = false;
     int m_pendingRequests = 0;
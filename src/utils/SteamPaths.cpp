@@ -154,6 +154,12 @@ QString loginUsersPath()
     return root.isEmpty() ? QString() : root + "/config/loginusers.vdf";
 }
 
+QString appInfoPath()
+{
+    const QString root = steamRoot();
+    return root.isEmpty() ? QString() : root + "/appcache/appinfo.vdf";
+}
+
 QString steamRuntimePath()
 {
     const QString root = steamRoot();
@@ -91,16 +91,17 @@ info "newest release: $TAG"
 # ---------------------------------------------------------------------------
 part "c) a downloaded archive extracts into compatibilitytools.d"
 
-# The app extracts with `tar xf` (ProtonManager.cpp) and expects to end up with a
-# directory holding an executable `proton`. Doing the same here proves the archive
+# The app streams the archive into `tar --extract --file -` as it downloads
+# (ProtonInstallStream.cpp) and expects to end up with a directory holding an
+# executable `proton`. Doing the same here proves the archive
 # layout still matches that expectation — which is a CachyOS packaging decision,
 # not something this project controls.
 URL="$(json_get "$RELEASES" '
 [a["browser_download_url"] for r in d for a in r.get("assets", [])
- if a["name"].endswith((".tar.xz", ".tar.zst", ".tar.gz"))][0]')"
+ if a["name"].endswith((".tar.xz", ".tar.zst", ".tar.gz", ".tar"))][0]')"
 SIZE="$(json_get "$RELEASES" '
 [a["size"] for r in d for a in r.get("assets", [])
- if a["name"].endswith((".tar.xz", ".tar.zst", ".tar.gz"))][0]')"
+ if a["name"].endswith((".tar.xz", ".tar.zst", ".tar.gz", ".tar"))][0]')"
 info "downloading $(basename "$URL") ($(( SIZE / 1024 / 1024 )) MB)"
 
 ARCHIVE="$LAB_RUN_DIR/$(basename "$URL")"
@@ -116,8 +117,17 @@ fi
 
 COMPAT="$NATIVE/compatibilitytools.d"
 rm -rf "$COMPAT"; mkdir -p "$COMPAT"
-if tar -C "$COMPAT" -xf "$ARCHIVE" 2>"$(case_log tar)"; then
-    ok "tar xf extracts it, as ProtonManager does"
+# The arguments ProtonInstallStream::tarArguments() gives: a plain .tar names
+# no filter at all, rather than an empty one.
+FILTER=
+case "$ARCHIVE" in
+    *.tar.xz)  FILTER=--xz ;;
+    *.tar.gz)  FILTER=--gzip ;;
+    *.tar.zst) FILTER=--zstd ;;
+    *.tar)     ;;
+esac
+if tar -C "$COMPAT" --extract ${FILTER:+"$FILTER"} --file - <"$ARCHIVE" 2>"$(case_log tar)"; then
+    ok "tar extracts it from a pipe, as ProtonInstallStream does"
 else
     fail "extraction failed" "$(tail -n 10 "$(case_log tar)")"
     case_finish
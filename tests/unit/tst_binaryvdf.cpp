@@ -0,0 +1,205 @@
+// Binary KeyValues is what Steam keeps its app cache and the user's non-Steam
+// shortcuts in. Decoded into the VDFNode tree the text parser builds, so what
+// matters is that every type comes out as the text parser would have had it,
+// and that a file cut short is an error rather than half an answer.
+
+#include <QTest>
+#include <QtEndian>
+
+#include "parsers/BinaryVDF.h"
+
+namespace {
+
+// Writes binary KeyValues. With a key table, keys are indices into it, as in
+// appinfo.vdf v29.
+class KVWriter
+{
+public:
+    explicit KVWriter(QList<QByteArray>* keys = nullptr) : m_keys(keys) {}
+
+    KVWriter& map(const QByteArray& name) { type(BinaryVDF::Map); key(name); return *this; }
+    KVWriter& end() { type(BinaryVDF::End); return *this; }
+
+    KVWriter& str(const QByteArray& name, const QByteArray& value)
+    {
+        type(BinaryVDF::String);
+        key(name);
+        m_bytes += value;
+        m_bytes += '\0';
+        return *this;
+    }
+
+    KVWriter& i32(const QByteArray& name, qint32 value)
+    {
+        type(BinaryVDF::Int32);
+        key(name);
+        char buf[4];
+        qToLittleEndian(value, buf);
+        m_bytes.append(buf, 4);
+        return *this;
+    }
+
+    KVWriter& u64(const QByteArray& name, quint64 value)
+    {
+        type(BinaryVDF::UInt64);
+        key(name);
+        char buf[8];
+        qToLittleEndian(value, buf);
+        m_bytes.append(buf, 8);
+        return *this;
+    }
+
+    KVWriter& raw(const QByteArray& bytes) { m_bytes += bytes; return *this; }
+
+    QByteArray bytes() const { return m_bytes; }
+
+private:
+    void type(quint8 t) { m_bytes += char(t); }
+
+    void key(const QByteArray& name)
+    {
+        if (!m_keys) {
+            m_bytes += name;
+            m_bytes += '\0';
+            return;
+        }
+        qsizetype index = m_keys->indexOf(name);
+        if (index < 0) {
+            index = m_keys->size();
+            m_keys->append(name);
+        }
+        char buf[4];
+        qToLittleEndian(static_cast<quint32>(index), buf);
+        m_bytes.append(buf, 4);
+    }
+
+    QList<QByteArray>* m_keys;
+    QByteArray m_bytes;
+};
+
+} // namespace
+
+class TstBinaryVdf : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void decodesEveryCommonType();
+    void readsKeysFromAStringTable();
+    void anEmptyStringIsNeitherValueNorObject();
+    void rejectsTruncatedData_data();
+    void rejectsTruncatedData();
+    void rejectsAnUnknownType();
+    void rejectsAKeyOutsideTheTable();
+    void parsesAStringTable();
+};
+
+void TstBinaryVdf::decodesEveryCommonType()
+{
+    const QByteArray data = KVWriter()
+                                .map("root")
+                                .str("name", "Half-Life 2")
+                                .i32("negative", -5)
+                                .u64("token", 18446744073709551615ULL)
+                                .map("nested").str("deep", "yes").end()
+                                .end()
+                                .end()
+                                .bytes();
+
+    VDFNode root;
+    QString error;
+    QVERIFY2(BinaryVDF::parse(data, &root, &error), qPrintable(error));
+
+    const VDFNode node = root.child("root");
+    QCOMPARE(node.getString("name"), QString("Half-Life 2"));
+    QCOMPARE(node.getInt("negative"), -5LL);
+    QCOMPARE(node.getString("token"), QString("18446744073709551615"));
+    QCOMPARE(node.child("nested").getString("deep"), QString("yes"));
+}
+
+void TstBinaryVdf::readsKeysFromAStringTable()
+{
+    QList<QByteArray> keys;
+    const QByteArray data = KVWriter(&keys)
+                                .map("appinfo")
+                                .i32("appid", 570)
+                                .map("common").str("name", "Dota 2").end()
+                                .end()
+                                .bytes();
+
+    VDFNode root;
+    QString error;
+    QVERIFY2(BinaryVDF::parse(data, &root, &error, keys), qPrintable(error));
+    QCOMPARE(root.child("appinfo").getInt("appid"), 570LL);
+    QCOMPARE(root.child("appinfo").child("common").getString("name"), QString("Dota 2"));
+}
+
+void TstBinaryVdf::anEmptyStringIsNeitherValueNorObject()
+{
+    // As the text parser has `"label" ""`, so getString() falls back alike.
+    const QByteArray data = KVWriter().str("label", "").end().bytes();
+    VDFNode root;
+    QVERIFY(BinaryVDF::parse(data, &root, nullptr));
+    QVERIFY(root.hasChild("label"));
+    QCOMPARE(root.getString("label", "fallback"), QString("fallback"));
+}
+
+void TstBinaryVdf::rejectsTruncatedData_data()
+{
+    QTest::addColumn<QByteArray>("data");
+
+    const QByteArray whole = KVWriter()
+                                 .map("root").str("name", "x").i32("n", 1).end()
+                                 .end()
+                                 .bytes();
+    // Every cut inside the nested map, where an end byte is still owed.
+    for (int cut = 1; cut < whole.size() - 2; ++cut) {
+        QTest::addRow("cut at %d", cut) << whole.left(cut);
+    }
+}
+
+void TstBinaryVdf::rejectsTruncatedData()
+{
+    QFETCH(QByteArray, data);
+
+    VDFNode root;
+    QString error;
+    QVERIFY(!BinaryVDF::parse(data, &root, &error));
+    QVERIFY(!error.isEmpty());
+}
+
+void TstBinaryVdf::rejectsAnUnknownType()
+{
+    VDFNode root;
+    QString error;
+    QVERIFY(!BinaryVDF::parse(QByteArray("\x42key\0", 5), &root, &error));
+    QVERIFY(error.contains("0x42"));
+}
+
+void TstBinaryVdf::rejectsAKeyOutsideTheTable()
+{
+    QList<QByteArray> keys;
+    const QByteArray data = KVWriter(&keys).str("a", "b").str("c", "d").end().bytes();
+    keys.removeLast();
+
+    VDFNode root;
+    QString error;
+    QVERIFY(!BinaryVDF::parse(data, &root, &error, keys));
+    QVERIFY(!error.isEmpty());
+}
+
+void TstBinaryVdf::parsesAStringTable()
+{
+    QByteArray data;
+    char buf[4];
+    qToLittleEndian(quint32(3), buf);
+    data.append(buf, 4);
+    data.append("appinfo\0common\0name\0", 20);
+
+    QCOMPARE(BinaryVDF::parseStringTable(data), (QList<QByteArray>{"appinfo", "common", "name"}));
+    QVERIFY(BinaryVDF::parseStringTable(data.left(data.size() - 1)).isEmpty());
+    QVERIFY(BinaryVDF::parseStringTable(QByteArray("\xff\xff\xff\x0f", 4)).isEmpty());
+}
+
+QTEST_MAIN(TstBinaryVdf)
+#include "tst_binaryvdf.moc"
@@ -0,0 +1,432 @@
+// Which file in an install directory is the game, ranked once and remembered.
+//
+// What must hold:
+//   A file's header decides what it is: a PE's bitness, DLL flag and
+//     subsystem; an ELF's class and whether it asks for an interpreter; a
+//     script's #!. Anything else is Other.
+//   The game's own name outranks everything; a real 64-bit binary outranks a
+//     32-bit one, a console tool or something that only looks like an .exe.
+//     Installers, redistributables, crash reporters, libraries and data files
+//     with the execute bit are not candidates at all.
+//   An entry is only current at the build and directory stamp it was taken
+//     at; a launch never answers with a file that has gone.
+//   The file round-trips, and one of another version is a clean miss.
+//   A launch never walks on the GUI's time: a stale entry still answers with
+//     a candidate that is on disk and is walked again behind it; a miss is
+//     reported as one and walked next in the background, and the pass stops
+//     when told to.
+
+#include <QTest>
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QTemporaryDir>
+#include <QtEndian>
+
+#include <cstring>
+
+#include "runner/ExecutableIndex.h"
+#include "core/Game.h"
+
+namespace {
+
+using Info = ExecutableIndex::BinaryInfo;
+using Platform = ExecutableIndex::Platform;
+
+constexpr quint16 kAmd64 = 0x8664;
+constexpr quint16 kI386 = 0x14c;
+constexpr quint16 kPE32 = 0x10b;
+constexpr quint16 kPE32Plus = 0x20b;
+constexpr quint16 kDll = 0x2000;
+constexpr quint16 kGui = 2;
+constexpr quint16 kConsole = 3;
+
+QByteArray pe(quint16 machine, quint16 magic, quint16 characteristics, quint16 subsystem)
+{
+    QByteArray head(512, '\0');
+    head[0] = 'M';
+    head[1] = 'Z';
+    qToLittleEndian<quint32>(0x80, head.data() + 0x3C);
+    char* coff = head.data() + 0x80;
+    memcpy(coff, "PE\0\0", 4);
+    qToLittleEndian<quint16>(machine, coff + 4);
+    qToLittleEndian<quint16>(characteristics, coff + 22);
+    qToLittleEndian<quint16>(magic, coff + 24);
+    qToLittleEndian<quint16>(subsystem, coff + 24 + 68);
+    return head;
+}
+
+// Two program headers: a PT_LOAD, then PT_INTERP or PT_DYNAMIC.
+QByteArray elf(bool is64, quint16 type, bool interpreter)
+{
+    QByteArray head(512, '\0');
+    memcpy(head.data(), "\x7f" "ELF", 4);
+    head[4] = is64 ? 2 : 1;
+    head[5] = 1;    // little-endian
+    qToLittleEndian<quint16>(type, head.data() + 16);
+
+    const quint32 phoff = is64 ? 64 : 52;
+    const quint16 phentsize = is64 ? 56 : 32;
+    if (is64) {
+        qToLittleEndian<quint64>(phoff, head.data() + 32);
+    } else {
+        qToLittleEndian<quint32>(phoff, head.data() + 28);
+    }
+    qToLittleEndian<quint16>(phentsize, head.data() + (is64 ? 54 : 42));
+    qToLittleEndian<quint16>(2, head.data() + (is64 ? 56 : 44));
+    qToLittleEndian<quint32>(1, head.data() + phoff);
+    qToLittleEndian<quint32>(interpreter ? 3 : 2, head.data() + phoff + phentsize);
+    return head;
+}
+
+Info info(Info::Format format, bool is64 = true, bool library = false, bool console = false)
+{
+    Info result;
+    result.format = format;
+    result.is64 = is64;
+    result.library = library;
+    result.console = console;
+    return result;
+}
+
+bool writeFile(const QString& path, const QByteArray& content, bool executable = false)
+{
+    if (!QDir().mkpath(QFileInfo(path).absolutePath())) {
+        return false;
+    }
+    QFile file(path);
+    if (!file.open(QIODevice::WriteOnly) || file.write(content) != content.size()) {
+        return false;
+    }
+    file.close();
+    if (executable) {
+        return file.setPermissions(file.permissions() | QFileDevice::ExeOwner | QFileDevice::ExeUser);
+    }
+    return true;
+}
+
+} // namespace
+
+class TstExecutableIndex : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void inspectsHeaders_data();
+    void inspectsHeaders();
+
+    void ranksTheGameFirst();
+    void rejectsWhatIsNeverTheGame_data();
+    void rejectsWhatIsNeverTheGame();
+
+    void roundTripsTheFile();
+    void missesAnotherVersion();
+
+    void scansBothPlatformsInOneWalk();
+    void remembersWhatItFound();
+    void walksAgainForANewBuild();
+    void skipsACandidateThatWentAway();
+    void walksAMissInTheBackground();
+    void stopsWhenCancelled();
+};
+
+void TstExecutableIndex::inspectsHeaders_data()
+{
+    QTest::addColumn<QByteArray>("head");
+    QTest::addColumn<int>("format");
+    QTest::addColumn<bool>("is64");
+    QTest::addColumn<bool>("library");
+    QTest::addColumn<bool>("console");
+
+    const int PE = int(Info::Format::PE);
+    const int ELF = int(Info::Format::ELF);
+    QTest::newRow("PE32+ GUI") << pe(kAmd64, kPE32Plus, 0, kGui) << PE << true << false << false;
+    QTest::newRow("PE32 DLL") << pe(kI386, kPE32, kDll, kGui) << PE << false << true << false;
+    QTest::newRow("PE32 console") << pe(kI386, kPE32, 0, kConsole) << PE << false << false << true;
+    QTest::newRow("ELF64 PIE") << elf(true, 3, true) << ELF << true << false << false;
+    QTest::newRow("ELF64 shared object") << elf(true, 3, false) << ELF << true << true << false;
+    QTest::newRow("ELF32 exec") << elf(false, 2, false) << ELF << false << false << false;
+    QTest::newRow("ELF relocatable") << elf(true, 1, false) << ELF << true << true << false;
+    QTest::newRow("script") << QByteArray("#!/bin/sh\nexec ./game\n") << int(Info::Format::Script)
+                            << false << false << false;
+    QTest::newRow("garbage") << QByteArray("not a real pe binary\n") << int(Info::Format::Other)
+                             << false << false << false;
+    QTest::newRow("empty") << QByteArray() << int(Info::Format::Other) << false << false << false;
+}
+
+void TstExecutableIndex::inspectsHeaders()
+{
+    QFETCH(QByteArray, head);
+    QFETCH(int, format);
+    QFETCH(bool, is64);
+    QFETCH(bool, library);
+    QFETCH(bool, console);
+
+    const Info result = ExecutableIndex::inspect(head);
+    QCOMPARE(int(result.format), format);
+    QCOMPARE(result.is64, is64);
+    QCOMPARE(result.library, library);
+    QCOMPARE(result.console, console);
+}
+
+void TstExecutableIndex::ranksTheGameFirst()
+{
+    Game game("367520", "Hollow Knight", "Steam");
+    game.setInstallPath("/games/Hollow Knight");
+    auto score = [&game](const QString& path, const Info& binary, Platform platform = Platform::Windows) {
+        return ExecutableIndex::score(path, binary, 100 * 1024 * 1024, game, platform);
+    };
+
+    const int exact = score("hollow_knight.exe", info(Info::Format::PE));
+    const int partial = score("hollow_knight_beta.exe", info(Info::Format::PE));
+    const int other64 = score("game.exe", info(Info::Format::PE));
+    const int other32 = score("game.exe", info(Info::Format::PE, false));
+    const int console = score("game.exe", info(Info::Format::PE, true, false, true));
+    const int notPE = score("game.exe", info(Info::Format::Other));
+    QVERIFY(exact > partial);
+    QVERIFY(partial > other64);
+    QVERIFY(other64 > other32);
+    QVERIFY(other32 > notPE);
+    QVERIFY(other64 > console);
+    QVERIFY(notPE != ExecutableIndex::kRejected);
+
+    // Shallower wins between equals.
+    QVERIFY(score("hollow_knight.exe", info(Info::Format::PE))
+            > score("bin/x64/hollow_knight.exe", info(Info::Format::PE)));
+
+    // Natively, the 64-bit build over the 32-bit one and over a wrapper script.
+    const int native64 = score("hollow_knight.x86_64", info(Info::Format::ELF), Platform::Linux);
+    const int native32 = score("hollow_knight.x86", info(Info::Format::ELF, false), Platform::Linux);
+    const int script = score("run_hollow_knight", info(Info::Format::Script, false), Platform::Linux);
+    QVERIFY(native64 > native32);
+    QVERIFY(native64 > script);
+    QVERIFY(script != ExecutableIndex::kRejected);
+}
+
+void TstExecutableIndex::rejectsWhatIsNeverTheGame_data()
+{
+    QTest::addColumn<QString>("path");
+    QTest::addColumn<int>("format");
+    QTest::addColumn<bool>("library");
+    QTest::addColumn<bool>("windows");
+
+    const int PE = int(Info::Format::PE);
+    const int ELF = int(Info::Format::ELF);
+    QTest::newRow("DLL named .exe") << "game.exe" << PE << true << true;
+    QTest::newRow("uninstaller") << "unins000.exe" << PE << false << true;
+    QTest::newRow("crash reporter") << "UnityCrashHandler64.exe" << PE << false << true;
+    QTest::newRow("redist directory") << "_CommonRedist/DirectX/Jun2010/game.exe" << PE << false << true;
+    QTest::newRow("anti-cheat directory") << "EasyAntiCheat/game.exe" << PE << false << true;
+    QTest::newRow("not an exe") << "game.dll" << PE << false << true;
+    QTest::newRow("shared object") << "lib/libgame.so.1" << ELF << false << false;
+    QTest::newRow("ELF library") << "game" << ELF << true << false;
+    QTest::newRow("data with execute bit") << "game" << int(Info::Format::Other) << false << false;
+    QTest::newRow("windows exe natively") << "game.exe" << PE << false << false;
+    QTest::newRow("shell script by name") << "start.sh" << int(Info::Format::Script) << false << false;
+}
+
+void TstExecutableIndex::rejectsWhatIsNeverTheGame()
+{
+    QFETCH(QString, path);
+    QFETCH(int, format);
+    QFETCH(bool, library);
+    QFETCH(bool, windows);
+
+    const Game game("1", "Game", "Steam");
+    const Info binary = info(Info::Format(format), true, library);
+    QCOMPARE(ExecutableIndex::score(path, binary, 1024, game, windows ? Platform::Windows : Platform::Linux),
+             ExecutableIndex::kRejected);
+}
+
+void TstExecutableIndex::roundTripsTheFile()
+{
+    QHash<QString, ExecutableIndex::Entry> entries;
+    ExecutableIndex::Entry entry;
+    entry.buildId = 12345678;
+    entry.dirStamp = 1700000000123;
+    entry.windowsExes = {"hollow_knight.exe", "tools/editor.exe"};
+    entry.linuxExes = {"hollow_knight.x86_64"};
+    entries.insert("Steam:367520", entry);
+    entries.insert("GOG:1207664663", ExecutableIndex::Entry{0, 42, {"bin/x64/witcher3.exe"}, {}});
+
+    const QHash<QString, ExecutableIndex::Entry> back =
+        ExecutableIndex::parse(ExecutableIndex::serialize(entries));
+    QCOMPARE(back.size(), 2);
+    const ExecutableIndex::Entry read = back.value("Steam:367520");
+    QCOMPARE(read.buildId, entry.buildId);
+    QCOMPARE(read.dirStamp, entry.dirStamp);
+    QCOMPARE(read.windowsExes, entry.windowsExes);
+    QCOMPARE(read.linuxExes, entry.linuxExes);
+    QCOMPARE(back.value("GOG:1207664663").windowsExes, QStringList{"bin/x64/witcher3.exe"});
+}
+
+void TstExecutableIndex::missesAnotherVersion()
+{
+    QByteArray json = ExecutableIndex::serialize({{"Steam:570", ExecutableIndex::Entry{1, 2, {"a.exe"}, {}}}});
+    QCOMPARE(ExecutableIndex::parse(json).size(), 1);
+    json.replace("\"version\":1", "\"version\":0");
+    QVERIFY(ExecutableIndex::parse(json).isEmpty());
+    QVERIFY(ExecutableIndex::parse("not json").isEmpty());
+}
+
+namespace {
+
+// A game with a bit of everything a real install has lying around.
+Game makeInstall(const QString& root)
+{
+    const QString install = root + "/Hollow Knight";
+    const bool ok = writeFile(install + "/hollow_knight.exe", pe(kAmd64, kPE32Plus, 0, kGui))
+        && writeFile(install + "/tools/editor.exe", pe(kI386, kPE32, 0, kConsole))
+        && writeFile(install + "/UnityCrashHandler64.exe", pe(kAmd64, kPE32Plus, 0, kGui))
+        && writeFile(install + "/UnityPlayer.dll", pe(kAmd64, kPE32Plus, kDll, kGui))
+        && writeFile(install + "/_CommonRedist/vcredist_x64.exe", pe(kAmd64, kPE32Plus, 0, kGui))
+        && writeFile(install + "/hollow_knight.x86_64", elf(true, 3, true), true)
+        && writeFile(install + "/lib/libsteam_api.so", elf(true, 3, false), true)
+        && writeFile(install + "/data.assets", QByteArray(64, 'x'), true);
+    if (!ok) {
+        qWarning("could not build the install tree under %s", qUtf8Printable(root));
+    }
+
+    Game game("367520", "Hollow Knight", "Steam");
+    game.setInstallPath(install);
+    game.setBuildId(100);
+    return game;
+}
+
+} // namespace
+
+void TstExecutableIndex::scansBothPlatformsInOneWalk()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    const Game game = makeInstall(dir.path());
+
+    const ExecutableIndex::Entry entry = ExecutableIndex::scan(game);
+    QCOMPARE(entry.buildId, qint64(100));
+    QVERIFY(entry.dirStamp != 0);
+    QCOMPARE(entry.windowsExes, (QStringList{"hollow_knight.exe", "tools/editor.exe"}));
+    QCOMPARE(entry.linuxExes, QStringList{"hollow_knight.x86_64"});
+}
+
+void TstExecutableIndex::remembersWhatItFound()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    const Game game = makeInstall(dir.path());
+    const QString indexPath = dir.path() + "/cache/executables.json";
+
+    {
+        ExecutableIndex index(indexPath);
+        index.setWalkOnMiss(true);   // as the command line has it
+        QVERIFY(!index.lookup(game, nullptr));
+        QVERIFY(!index.isCurrent(game));
+        QCOMPARE(index.executable(game, Platform::Windows), game.installPath() + "/hollow_knight.exe");
+        QCOMPARE(index.executable(game, Platform::Linux), game.installPath() + "/hollow_knight.x86_64");
+        QVERIFY(QFile::exists(indexPath));
+    }
+
+    // A second run knows it without walking.
+    ExecutableIndex index(indexPath);
+    ExecutableIndex::Entry entry;
+    bool current = false;
+    QVERIFY(index.lookup(game, &entry, &current));
+    QVERIFY(current);
+    QCOMPARE(entry.windowsExes.value(0), QString("hollow_knight.exe"));
+
+    // And refresh() has nothing left to do.
+    QCOMPARE(index.refresh({game}), 0);
+}
+
+void TstExecutableIndex::walksAgainForANewBuild()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    Game game = makeInstall(dir.path());
+
+    ExecutableIndex index(dir.path() + "/executables.json");
+    QCOMPARE(index.refresh({game}), 1);
+    QVERIFY(index.isCurrent(game));
+
+    // Known still, but stale.
+    game.setBuildId(101);
+    QVERIFY(index.lookup(game, nullptr));
+    QVERIFY(!index.isCurrent(game));
+    QCOMPARE(index.refresh({game}), 1);
+    QVERIFY(index.isCurrent(game));
+}
+
+void TstExecutableIndex::skipsACandidateThatWentAway()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    const Game game = makeInstall(dir.path());
+    const qint64 stamp = QFileInfo(game.installPath()).lastModified().toMSecsSinceEpoch();
+
+    ExecutableIndex index(dir.path() + "/executables.json");
+    index.setWalkOnMiss(true);
+
+    // Deleted deeper down, so the directory stamp never moved: the next one on
+    // the list answers.
+    index.store(game, ExecutableIndex::Entry{100, stamp, {"gone/game.exe", "tools/editor.exe"}, {}});
+    QCOMPARE(index.executable(game, Platform::Windows), game.installPath() + "/tools/editor.exe");
+
+    // Every one gone: walked again rather than nothing.
+    index.store(game, ExecutableIndex::Entry{100, stamp, {"gone/game.exe"}, {}});
+    QCOMPARE(index.executable(game, Platform::Windows), game.installPath() + "/hollow_knight.exe");
+    ExecutableIndex::Entry entry;
+    QVERIFY(index.lookup(game, &entry));
+    QCOMPARE(entry.windowsExes.value(0), QString("hollow_knight.exe"));
+    QVERIFY(index.isCurrent(game));
+}
+
+void TstExecutableIndex::walksAMissInTheBackground()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    const Game game = makeInstall(dir.path());
+    const qint64 stamp = QFileInfo(game.installPath()).lastModified().toMSecsSinceEpoch();
+
+    ExecutableIndex index(dir.path() + "/executables.json");
+
+    // Never seen: nothing yet, and the answer on its way.
+    QVERIFY(index.executable(game, Platform::Windows).isEmpty());
+    QTRY_VERIFY(index.isCurrent(game));
+    QVERIFY(!index.pending(game));
+    QCOMPARE(index.executable(game, Platform::Windows), game.installPath() + "/hollow_knight.exe");
+
+    // Stale, as after an update or a log written into the install root: the
+    // stored answer still plays, and the walk that confirms it runs behind.
+    Game updated = game;
+    updated.setBuildId(101);
+    index.store(updated, ExecutableIndex::Entry{100, stamp - 1000, {"tools/editor.exe"}, {}});
+    QCOMPARE(index.executable(updated, Platform::Windows),
+             updated.installPath() + "/tools/editor.exe");
+    QTRY_VERIFY(index.isCurrent(updated));
+    QCOMPARE(index.executable(updated, Platform::Windows),
+             updated.installPath() + "/hollow_knight.exe");
+
+    // Every candidate gone without the stamp moving: forgotten and walked again.
+    index.store(game, ExecutableIndex::Entry{100, stamp, {"gone/game.exe"}, {}});
+    QVERIFY(index.executable(game, Platform::Windows).isEmpty());
+    QTRY_COMPARE(index.executable(game, Platform::Windows),
+                 game.installPath() + "/hollow_knight.exe");
+}
+
+void TstExecutableIndex::stopsWhenCancelled()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    const Game game = makeInstall(dir.path());
+
+    ExecutableIndex index(dir.path() + "/executables.json");
+    index.cancel();
+    QCOMPARE(index.refresh({game}), 0);
+
+    // Stopped part-way, a walk leaves nothing that would pass for current.
+    const std::atomic_bool stop{true};
+    QCOMPARE(ExecutableIndex::scan(game, &stop).dirStamp, qint64(0));
+}
+
+QTEST_MAIN(TstExecutableIndex)
+#include "tst_executableindex.moc"
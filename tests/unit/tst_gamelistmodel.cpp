@@ -0,0 +1,185 @@
+// The game list's model and its filter: what the list shows and in what order.
+//
+// Rows are found by settingsKey(), so the same id from two launchers is two
+// rows, and rowOf() has to stay right after every append, replace and removal —
+// the widget looks up selections and image replies through it.
+//
+// What must hold:
+//   setGames() and appendGames() give one row per game, in the order given.
+//   removeGames() takes out any set of rows, adjacent or not, and every row
+//     left is still found where it now is.
+//   replaceGame() keeps the row in place, under the new game's key.
+//   The proxy shows every row in model order until a search is active; then
+//     only the matches, best first, narrowed further by the chosen source.
+
+#include <QTest>
+#include <QSignalSpy>
+
+#include "ui/GameListModel.h"
+
+namespace {
+
+Game game(const QString& launcher, const QString& id, const QString& name)
+{
+    return Game(id, name, launcher);
+}
+
+QStringList namesShown(const QAbstractItemModel& model)
+{
+    QStringList names;
+    for (int row = 0; row < model.rowCount(); ++row) {
+        names << model.index(row, 0).data(GameListModel::NameRole).toString();
+    }
+    return names;
+}
+
+} // namespace
+
+class TstGameListModel : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void holdsOneRowPerGame();
+    void findsRowsByKeyNotById();
+    void removesAnySetOfRows();
+    void replacesInPlace();
+    void showsEverythingUntilASearch();
+    void ordersMatchesBestFirst();
+    void narrowsBySource();
+};
+
+void TstGameListModel::holdsOneRowPerGame()
+{
+    GameListModel model;
+    model.setGames({game("Steam", "1", "Alpha"), game("Steam", "2", "Beta")});
+    QCOMPARE(model.rowCount(), 2);
+    QCOMPARE(namesShown(model), QStringList({"Alpha", "Beta"}));
+
+    QSignalSpy inserted(&model, &QAbstractItemModel::rowsInserted);
+    model.appendGames({game("GOG", "3", "Gamma")});
+    QCOMPARE(inserted.count(), 1);
+    QCOMPARE(model.rowCount(), 3);
+    QCOMPARE(model.rowOf("GOG:3"), 2);
+    QCOMPARE(model.gameAt(2).name(), QString("Gamma"));
+
+    // An empty append is not an insertion.
+    model.appendGames({});
+    QCOMPARE(inserted.count(), 1);
+
+    model.setGames({game("Steam", "9", "Omega")});
+    QCOMPARE(model.rowCount(), 1);
+    QCOMPARE(model.rowOf("Steam:1"), -1);
+    QCOMPARE(model.rowOf("Steam:9"), 0);
+}
+
+void TstGameListModel::findsRowsByKeyNotById()
+{
+    GameListModel model;
+    model.setGames({game("Steam", "42", "From Steam"), game("GOG", "42", "From GOG")});
+    QCOMPARE(model.rowOf("Steam:42"), 0);
+    QCOMPARE(model.rowOf("GOG:42"), 1);
+    QCOMPARE(model.rowOf("42"), -1);
+}
+
+void TstGameListModel::removesAnySetOfRows()
+{
+    GameListModel model;
+    QList<Game> games;
+    for (int i = 0; i < 8; ++i) {
+        games << game("Steam", QString::number(i), QStringLiteral("Game %1").arg(i));
+    }
+    model.setGames(games);
+
+    // Two runs of adjacent rows and a single one, and a key that is not there.
+    model.removeGames({"Steam:1", "Steam:2", "Steam:5", "Steam:6", "Steam:7", "Steam:99"});
+    QCOMPARE(namesShown(model), QStringList({"Game 0", "Game 3", "Game 4"}));
+    QCOMPARE(model.rowOf("Steam:0"), 0);
+    QCOMPARE(model.rowOf("Steam:3"), 1);
+    QCOMPARE(model.rowOf("Steam:4"), 2);
+    QCOMPARE(model.rowOf("Steam:5"), -1);
+
+    QSignalSpy removed(&model, &QAbstractItemModel::rowsRemoved);
+    model.removeGames({"Steam:99"});
+    model.removeGames({});
+    QCOMPARE(removed.count(), 0);
+}
+
+void TstGameListModel::replacesInPlace()
+{
+    GameListModel model;
+    model.setGames({game("Steam", "1", "Alpha"), game("Steam", "2", "Beta")});
+
+    QSignalSpy changed(&model, &QAbstractItemModel::dataChanged);
+    model.replaceGame(0, game("GOG", "7", "Alpha (GOG)"));
+    QCOMPARE(changed.count(), 1);
+    QCOMPARE(changed.at(0).at(0).toModelIndex().row(), 0);
+    QCOMPARE(model.rowOf("Steam:1"), -1);
+    QCOMPARE(model.rowOf("GOG:7"), 0);
+    QCOMPARE(model.rowOf("Steam:2"), 1);
+
+    // Out of range is ignored rather than trusted.
+    model.replaceGame(5, game("Steam", "3", "Gamma"));
+    QCOMPARE(model.rowCount(), 2);
+    QCOMPARE(changed.count(), 1);
+}
+
+void TstGameListModel::showsEverythingUntilASearch()
+{
+    GameListModel model;
+    model.setGames({game("Steam", "1", "Alpha"), game("GOG", "2", "Beta"),
+                    game("Steam", "3", "Gamma")});
+    GameFilterProxyModel proxy;
+    proxy.setSourceModel(&model);
+    QCOMPARE(namesShown(proxy), QStringList({"Alpha", "Beta", "Gamma"}));
+
+    // An inactive answer shows every row, whatever keys it carries.
+    proxy.setMatches({"GOG:2"}, false);
+    QCOMPARE(namesShown(proxy), QStringList({"Alpha", "Beta", "Gamma"}));
+
+    // Appended rows are filtered as they arrive.
+    proxy.setMatches({"Steam:4", "GOG:2"}, true);
+    QCOMPARE(namesShown(proxy), QStringList({"Beta"}));
+    model.appendGames({game("Steam", "4", "Delta"), game("Steam", "5", "Epsilon")});
+    QCOMPARE(namesShown(proxy), QStringList({"Delta", "Beta"}));
+}
+
+void TstGameListModel::ordersMatchesBestFirst()
+{
+    GameListModel model;
+    model.setGames({game("Steam", "1", "Alpha"), game("Steam", "2", "Beta"),
+                    game("Steam", "3", "Gamma")});
+    GameFilterProxyModel proxy;
+    proxy.setSourceModel(&model);
+
+    proxy.setMatches({"Steam:3", "Steam:1"}, true);
+    QCOMPARE(namesShown(proxy), QStringList({"Gamma", "Alpha"}));
+
+    // A search cleared: the library's own order again.
+    proxy.setMatches({}, false);
+    QCOMPARE(namesShown(proxy), QStringList({"Alpha", "Beta", "Gamma"}));
+}
+
+void TstGameListModel::narrowsBySource()
+{
+    GameListModel model;
+    model.setGames({game("Steam", "1", "Alpha"), game("GOG", "2", "Beta"),
+                    game("Steam", "3", "Gamma")});
+    GameFilterProxyModel proxy;
+    proxy.setSourceModel(&model);
+
+    proxy.setSourceName("Steam");
+    QCOMPARE(namesShown(proxy), QStringList({"Alpha", "Gamma"}));
+    QVERIFY(proxy.matches(model.gameAt(0)));
+    QVERIFY(!proxy.matches(model.gameAt(1)));
+
+    // Both at once: a match from another source stays hidden.
+    proxy.setMatches({"GOG:2", "Steam:3"}, true);
+    QCOMPARE(namesShown(proxy), QStringList({"Gamma"}));
+
+    proxy.setSourceName(QString());
+    QCOMPARE(namesShown(proxy), QStringList({"Beta", "Gamma"}));
+}
+
+QTEST_MAIN(TstGameListModel)
+#include "tst_gamelistmodel.moc"
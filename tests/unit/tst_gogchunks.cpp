@@ -17,6 +17,9 @@
 //     body is worth another try; a disk that will not take the write is not,
 //     and three rounds of downloading ten megabytes to fail identically is
 //     worse than saying so at once.
+//   A download feeds the body through GogChunkStream in whatever pieces the
+//     socket delivers. How it is cut up must not change a byte of the result
+//     or a word of the verdict.
 
 #include <QTest>
 #include <QCryptographicHash>
@@ -77,6 +80,10 @@ private slots:
     void rejectsGarbage();
     void reportsAFileItCannotOpen();
 
+    void streamsAChunkFedInPieces();
+    void streamReportsCorruptionOnceEverythingHasArrived();
+    void streamRejectsATruncatedBody();
+
 private:
     QTemporaryDir m_dir;
     QString m_file;
@@ -303,5 +310,80 @@ void TstGogChunks::reportsAFileItCannotOpen()
     QVERIFY(!result.retriable);
 }
 
+void TstGogChunks::streamsAChunkFedInPieces()
+{
+    // Several times the stream's 64 KB output buffer, and not all one byte, so
+    // the output really does go out in more than one write.
+    QByteArray plain;
+    for (int i = 0; i < 300 * 1024; ++i) {
+        plain.append(static_cast<char>((i * 31) % 251));
+    }
+    const Chunk chunk = chunkFor(plain);
+    const QByteArray body = deflate(plain);
+
+    QFile create(m_file);
+    QVERIFY(create.open(QIODevice::WriteOnly));
+    QVERIFY(create.resize(16 + plain.size()));
+    create.close();
+
+    // Seven bytes at a time: smaller than zlib's header, so a piece boundary
+    // falls everywhere it possibly can.
+    GogChunkStream stream(chunk.compressedMd5, chunk.md5, m_file, 16);
+    for (int i = 0; i < body.size(); i += 7) {
+        stream.feed(body.mid(i, 7));
+    }
+    const GogChunkStream::Result result = stream.finish();
+    QVERIFY2(result.ok(), qPrintable(result.error));
+    QCOMPARE(stream.bytesIn(), static_cast<qint64>(body.size()));
+    QCOMPARE(stream.bytesWritten(), static_cast<qint64>(plain.size()));
+
+    QFile written(m_file);
+    QVERIFY(written.open(QIODevice::ReadOnly));
+    QCOMPARE(written.readAll(), QByteArray(16, '\0') + plain);
+}
+
+void TstGogChunks::streamReportsCorruptionOnceEverythingHasArrived()
+{
+    const QByteArray plain(64 * 1024, 'z');
+    const Chunk chunk = chunkFor(plain);
+
+    // Damaged near the end, after the stream has already inflated and written
+    // most of it. The verdict must still be "corrupt", and still retriable.
+    QByteArray damaged = deflate(plain);
+    damaged[damaged.size() - 6] = static_cast<char>(damaged.at(damaged.size() - 6) ^ 0xFF);
+
+    GogChunkStream stream(chunk.compressedMd5, chunk.md5, m_file, 0);
+    for (int i = 0; i < damaged.size(); i += 100) {
+        stream.feed(damaged.mid(i, 100));
+    }
+    const GogChunkStream::Result result = stream.finish();
+
+    QVERIFY(!result.ok());
+    QVERIFY2(result.error.contains("corrupt"), qPrintable(result.error));
+    QVERIFY(result.retriable);
+}
+
+void TstGogChunks::streamRejectsATruncatedBody()
+{
+    // A connection that closed early looks like success to everything but the
+    // stream itself. Without the compressed md5 to catch it, the missing end
+    // of the zlib stream has to.
+    const QByteArray plain(32 * 1024, 'r');
+    const QByteArray body = deflate(plain);
+
+    QFile create(m_file);
+    QVERIFY(create.open(QIODevice::WriteOnly));
+    QVERIFY(create.resize(plain.size()));
+    create.close();
+
+    GogChunkStream stream(QString(), QString(), m_file, 0);
+    stream.feed(body.left(body.size() - 8));
+    const GogChunkStream::Result result = stream.finish();
+
+    QVERIFY(!result.ok());
+    QVERIFY2(result.error.contains("decompress"), qPrintable(result.error));
+    QVERIFY(result.retriable);
+}
+
 QTEST_MAIN(TstGogChunks)
 #include "tst_gogchunks.moc"
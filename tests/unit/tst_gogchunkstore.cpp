@@ -0,0 +1,280 @@
+// Chunks kept from earlier downloads.
+//
+// The store is only worth having if it is never the reason an install is
+// wrong or a disk is full. So: a chunk goes in only when committed, under its
+// own name and nowhere else; the budget holds, and what goes first is what was
+// used longest ago; a store reopened after a restart knows what it had, once
+// it has read its directory off the caller's thread; a store that is off never
+// reads it, until it is turned on; and a name that is not an md5 never becomes
+// part of a path.
+
+#include <QTest>
+#include <QCryptographicHash>
+#include <QDir>
+#include <QFile>
+#include <QTemporaryDir>
+
+#include "gog/GogChunkStore.h"
+
+namespace {
+
+QString md5Of(const QByteArray& data)
+{
+    return QString::fromLatin1(QCryptographicHash::hash(data, QCryptographicHash::Md5).toHex());
+}
+
+} // namespace
+
+class TstGogChunkStore : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void init();
+
+    void keepsNothingWhenOff();
+    void loadsOnceTurnedOn();
+    void readsBackWhatWasInserted();
+    void ignoresTheCaseOfTheName();
+    void keepsOnlyWhatWasCommitted();
+    void evictsTheLeastRecentlyUsed();
+    void shrinkingTheBudgetEvictsAtOnce();
+    void refusesAChunkLargerThanTheBudget();
+    void remembersWhatItHadAfterARestart();
+    void appliesABudgetSetWhileLoading();
+    void forgetsAChunkWhoseFileWentMissing();
+    void refusesNamesThatAreNotAnMd5();
+
+private:
+    QTemporaryDir m_dir;
+    QString m_root;
+};
+
+void TstGogChunkStore::init()
+{
+    QVERIFY(m_dir.isValid());
+    m_root = m_dir.path() + "/chunks";
+    QDir(m_root).removeRecursively();
+}
+
+void TstGogChunkStore::keepsNothingWhenOff()
+{
+    GogChunkStore store(m_root, 0);
+    const QByteArray body(100, 'a');
+
+    QVERIFY(!store.isEnabled());
+    QVERIFY(!store.insert(md5Of(body), body));
+    QVERIFY(!store.beginInsert(md5Of(body)));
+    QVERIFY(!store.contains(md5Of(body)));
+    QVERIFY(!QDir(m_root).exists());
+    QVERIFY(!store.isLoaded());
+}
+
+void TstGogChunkStore::loadsOnceTurnedOn()
+{
+    const QByteArray a(1000, 'a');
+    {
+        GogChunkStore store(m_root, 3000);
+        QVERIFY(store.insert(md5Of(a), a));
+    }
+    QFile stray(m_root + "/incoming/" + md5Of(a) + "-1-1.part");
+    QVERIFY(stray.open(QIODevice::WriteOnly));
+    stray.close();
+
+    // Off: the directory is not walked, and nothing is cleared out of it.
+    GogChunkStore store(m_root, 0);
+    QVERIFY(!store.isLoaded());
+    QVERIFY(store.loaded().isFinished());
+    QVERIFY(stray.exists());
+
+    store.setBudget(3000);
+    store.loaded().waitForFinished();
+    QVERIFY(store.isLoaded());
+    QVERIFY(store.contains(md5Of(a)));
+    QVERIFY(!stray.exists());
+}
+
+void TstGogChunkStore::readsBackWhatWasInserted()
+{
+    GogChunkStore store(m_root, 1024 * 1024);
+    const QByteArray body(1000, 'a');
+    const QString key = md5Of(body);
+
+    QVERIFY(!store.contains(key));
+    QVERIFY(store.read(key).isEmpty());
+
+    QVERIFY(store.insert(key, body));
+    QVERIFY(store.contains(key));
+    QCOMPARE(store.read(key), body);
+    QCOMPARE(store.count(), 1);
+    QCOMPARE(store.storedBytes(), qint64(1000));
+
+    // Under its own name, sharded by the first two digits.
+    QVERIFY(QFile::exists(m_root + "/" + key.left(2) + "/" + key));
+
+    // Two installs finishing the same chunk at once keep one copy.
+    QVERIFY(store.insert(key, body));
+    QCOMPARE(store.count(), 1);
+    QCOMPARE(store.storedBytes(), qint64(1000));
+}
+
+void TstGogChunkStore::ignoresTheCaseOfTheName()
+{
+    GogChunkStore store(m_root, 1024 * 1024);
+    const QByteArray body(10, 'c');
+    const QString key = md5Of(body);
+
+    QVERIFY(store.insert(key.toUpper(), body));
+    QVERIFY(store.contains(key));
+    QCOMPARE(store.read(key.toUpper()), body);
+    QCOMPARE(store.count(), 1);
+}
+
+void TstGogChunkStore::keepsOnlyWhatWasCommitted()
+{
+    GogChunkStore store(m_root, 1024 * 1024);
+    const QByteArray body(3000, 'b');
+    const QString key = md5Of(body);
+
+    {
+        // A download that was aborted or failed to verify halfway.
+        const std::unique_ptr<GogChunkStore::Sink> sink = store.beginInsert(key);
+        QVERIFY(sink);
+        sink->append(body.left(1000));
+        QVERIFY(!store.contains(key));
+    }
+    QVERIFY(!store.contains(key));
+    QCOMPARE(store.count(), 0);
+    QVERIFY(QDir(m_root + "/incoming").isEmpty());
+
+    const std::unique_ptr<GogChunkStore::Sink> sink = store.beginInsert(key);
+    QVERIFY(sink);
+    sink->append(body.left(1000));
+    sink->append(body.mid(1000));
+    QVERIFY(!store.contains(key));
+    QVERIFY(sink->commit());
+    QCOMPARE(store.read(key), body);
+
+    // Once only.
+    QVERIFY(!sink->commit());
+}
+
+void TstGogChunkStore::evictsTheLeastRecentlyUsed()
+{
+    GogChunkStore store(m_root, 3000);
+    const QByteArray a(1000, 'a'), b(1000, 'b'), c(1000, 'c'), d(1000, 'd');
+
+    QVERIFY(store.insert(md5Of(a), a));
+    QVERIFY(store.insert(md5Of(b), b));
+    QVERIFY(store.insert(md5Of(c), c));
+
+    // Reading `a` makes `b` the oldest.
+    QCOMPARE(store.read(md5Of(a)), a);
+    QVERIFY(store.insert(md5Of(d), d));
+
+    QVERIFY(store.contains(md5Of(a)));
+    QVERIFY(!store.contains(md5Of(b)));
+    QVERIFY(store.contains(md5Of(c)));
+    QVERIFY(store.contains(md5Of(d)));
+    QCOMPARE(store.storedBytes(), qint64(3000));
+    QVERIFY(!QFile::exists(m_root + "/" + md5Of(b).left(2) + "/" + md5Of(b)));
+}
+
+void TstGogChunkStore::shrinkingTheBudgetEvictsAtOnce()
+{
+    GogChunkStore store(m_root, 3000);
+    const QByteArray a(1000, 'a'), b(1000, 'b'), c(1000, 'c');
+    QVERIFY(store.insert(md5Of(a), a));
+    QVERIFY(store.insert(md5Of(b), b));
+    QVERIFY(store.insert(md5Of(c), c));
+
+    store.setBudget(1500);
+    QCOMPARE(store.count(), 1);
+    QVERIFY(store.contains(md5Of(c)));
+    QVERIFY(store.storedBytes() <= 1500);
+}
+
+void TstGogChunkStore::refusesAChunkLargerThanTheBudget()
+{
+    GogChunkStore store(m_root, 1500);
+    const QByteArray small(1000, 's');
+    const QByteArray large(2000, 'l');
+    QVERIFY(store.insert(md5Of(small), small));
+
+    // Kept, it would have evicted everything and then itself.
+    QVERIFY(!store.insert(md5Of(large), large));
+    QVERIFY(store.contains(md5Of(small)));
+    QVERIFY(!store.contains(md5Of(large)));
+}
+
+void TstGogChunkStore::remembersWhatItHadAfterARestart()
+{
+    const QByteArray a(1000, 'a'), b(1000, 'b');
+    {
+        GogChunkStore store(m_root, 3000);
+        QVERIFY(store.insert(md5Of(a), a));
+        QVERIFY(store.insert(md5Of(b), b));
+    }
+
+    // A crash mid-insert leaves a part file; it is never mistaken for a chunk.
+    QFile stray(m_root + "/incoming/" + md5Of(a) + "-1-1.part");
+    QVERIFY(stray.open(QIODevice::WriteOnly));
+    stray.write("partial");
+    stray.close();
+
+    GogChunkStore store(m_root, 3000);
+    QCOMPARE(store.count(), 2);
+    QCOMPARE(store.storedBytes(), qint64(2000));
+    QCOMPARE(store.read(md5Of(b)), b);
+    QVERIFY(!stray.exists());
+}
+
+void TstGogChunkStore::appliesABudgetSetWhileLoading()
+{
+    const QByteArray a(1000, 'a'), b(1000, 'b'), c(1000, 'c');
+    {
+        GogChunkStore store(m_root, 3000);
+        QVERIFY(store.insert(md5Of(a), a));
+        QVERIFY(store.insert(md5Of(b), b));
+        QVERIFY(store.insert(md5Of(c), c));
+    }
+
+    // Set straight after opening, whether or not the walk has finished by
+    // then; it holds either way.
+    GogChunkStore store(m_root, 3000);
+    store.setBudget(1500);
+    store.loaded().waitForFinished();
+    QVERIFY(store.isLoaded());
+    QCOMPARE(store.count(), 1);
+    QVERIFY(store.storedBytes() <= 1500);
+}
+
+void TstGogChunkStore::forgetsAChunkWhoseFileWentMissing()
+{
+    GogChunkStore store(m_root, 3000);
+    const QByteArray a(1000, 'a');
+    QVERIFY(store.insert(md5Of(a), a));
+
+    QVERIFY(QFile::remove(m_root + "/" + md5Of(a).left(2) + "/" + md5Of(a)));
+    QVERIFY(store.read(md5Of(a)).isEmpty());
+    QVERIFY(!store.contains(md5Of(a)));
+    QCOMPARE(store.storedBytes(), qint64(0));
+}
+
+void TstGogChunkStore::refusesNamesThatAreNotAnMd5()
+{
+    GogChunkStore store(m_root, 1024 * 1024);
+    const QByteArray body(10, 'x');
+
+    QVERIFY(!GogChunkStore::isValidKey(QString()));
+    QVERIFY(!GogChunkStore::isValidKey(QStringLiteral("../../../../etc/passwd")));
+    QVERIFY(!GogChunkStore::isValidKey(QStringLiteral("0123456789abcdef0123456789abcdeg")));
+    QVERIFY(GogChunkStore::isValidKey(QStringLiteral("0123456789abcdef0123456789ABCDEF")));
+
+    QVERIFY(!store.insert(QStringLiteral("../escape"), body));
+    QVERIFY(!store.contains(QStringLiteral("../escape")));
+    QCOMPARE(store.count(), 0);
+}
+
+QTEST_MAIN(TstGogChunkStore)
+#include "tst_gogchunkstore.moc"
@@ -0,0 +1,195 @@
+// How many chunks the downloader keeps in flight.
+//
+// The controller's mistakes are all quiet ones. One that never raises leaves
+// a fast line idle; one that never stops raising ends up sixteen deep on a link
+// one request fills, where every extra request only adds latency; one that
+// ignores failures keeps a flaky connection timing out chunk after chunk. None
+// of that fails an install, it just makes it slow, so the decisions are pinned
+// here against a modelled link rather than left to be noticed.
+
+#include <QTest>
+
+#include "gog/GogConcurrency.h"
+
+namespace {
+
+constexpr qint64 kMegabyte = 1024 * 1024;
+
+// One window of traffic: a chunk per slot, together carrying `goodput` bytes a
+// second, each taking `latencyMs` from request to last byte.
+bool runWindow(GogConcurrency& controller, qint64* now, qint64 goodput,
+               qint64 latencyMs = 500, int verifierBacklog = 0)
+{
+    const int arrivals = controller.limit();
+    const qint64 bytesEach = goodput * (GogConcurrency::kWindowMs / 1000) / arrivals;
+    for (int i = 0; i < arrivals; ++i) {
+        controller.chunkArrived(bytesEach, latencyMs);
+    }
+    *now += GogConcurrency::kWindowMs;
+    return controller.evaluate(*now, verifierBacklog);
+}
+
+// A link that carries one megabyte a second per request, up to ten.
+qint64 linkGoodput(int inFlight)
+{
+    return qMin(inFlight, 10) * kMegabyte;
+}
+
+} // namespace
+
+class TstGogConcurrency : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void clampsTheStartingPointAndTheCeiling();
+    void climbsWhileEachRaisePaysForItself();
+    void settlesWhereTheLinkSaturates();
+    void neverPassesTheCeiling();
+    void halvesOnFailure();
+    void backsOffWhenTheVerifierFallsBehind();
+    void backsOffWhenLatencyClimbsForNothing();
+    void waitsForEnoughSamplesBeforeDeciding();
+};
+
+void TstGogConcurrency::clampsTheStartingPointAndTheCeiling()
+{
+    QCOMPARE(GogConcurrency(4, 2).limit(), 2);
+    QCOMPARE(GogConcurrency(0, 8).limit(), GogConcurrency::kFloor);
+    QCOMPARE(GogConcurrency(4, 100).ceiling(), GogConcurrency::kHardCeiling);
+    QCOMPARE(GogConcurrency(4, 0).ceiling(), GogConcurrency::kFloor);
+}
+
+void TstGogConcurrency::climbsWhileEachRaisePaysForItself()
+{
+    GogConcurrency controller(4, 16);
+    qint64 now = 0;
+    controller.evaluate(now, 0);
+
+    for (int expected = 5; expected <= 10; ++expected) {
+        QVERIFY(runWindow(controller, &now, linkGoodput(controller.limit())));
+        QCOMPARE(controller.limit(), expected);
+    }
+}
+
+void TstGogConcurrency::settlesWhereTheLinkSaturates()
+{
+    GogConcurrency controller(4, 16);
+    qint64 now = 0;
+    controller.evaluate(now, 0);
+
+    // Up to ten, one past it to find out, and back.
+    for (int i = 0; i < 8; ++i) {
+        runWindow(controller, &now, linkGoodput(controller.limit()));
+    }
+    QCOMPARE(controller.limit(), 10);
+
+    // And it stays there rather than probing every window: each probe costs a
+    // window of latency for nothing.
+    for (int i = 0; i < 8; ++i) {
+        runWindow(controller, &now, linkGoodput(controller.limit()));
+        QCOMPARE(controller.limit(), 10);
+    }
+}
+
+void TstGogConcurrency::neverPassesTheCeiling()
+{
+    GogConcurrency controller(4, 6);
+    qint64 now = 0;
+    controller.evaluate(now, 0);
+
+    // A link with no limit at all: every raise pays, and the ceiling is all
+    // that stops it.
+    for (int i = 0; i < 20; ++i) {
+        runWindow(controller, &now, controller.limit() * 4 * kMegabyte);
+        QVERIFY(controller.limit() <= 6);
+    }
+    QCOMPARE(controller.limit(), 6);
+}
+
+void TstGogConcurrency::halvesOnFailure()
+{
+    GogConcurrency controller(8, 16);
+    qint64 now = 0;
+    controller.evaluate(now, 0);
+
+    // No arrivals needed: a failure is reason enough, and waiting for samples
+    // on a link that is failing is how four slots all hit the timeout.
+    controller.chunkFailed(false);
+    now += GogConcurrency::kWindowMs;
+    QVERIFY(controller.evaluate(now, 0));
+    QCOMPARE(controller.limit(), 4);
+
+    controller.chunkFailed(true);
+    now += GogConcurrency::kWindowMs;
+    QVERIFY(controller.evaluate(now, 0));
+    QCOMPARE(controller.limit(), 2);
+
+    // One clean window is not yet proof the trouble is over.
+    QVERIFY(!runWindow(controller, &now, linkGoodput(controller.limit())));
+    QCOMPARE(controller.limit(), 2);
+    QVERIFY(runWindow(controller, &now, linkGoodput(controller.limit())));
+    QCOMPARE(controller.limit(), 3);
+
+    // And never below one, or the download would stop.
+    for (int i = 0; i < 4; ++i) {
+        controller.chunkFailed(true);
+        now += GogConcurrency::kWindowMs;
+        controller.evaluate(now, 0);
+    }
+    QCOMPARE(controller.limit(), GogConcurrency::kFloor);
+}
+
+void TstGogConcurrency::backsOffWhenTheVerifierFallsBehind()
+{
+    GogConcurrency controller(4, 16);
+    qint64 now = 0;
+    controller.evaluate(now, 0);
+
+    // More bodies waiting for the pool than there are requests in flight: the
+    // disk is the bottleneck, and a faster link cannot help it.
+    QVERIFY(runWindow(controller, &now, linkGoodput(4), 500, 6));
+    QCOMPARE(controller.limit(), 3);
+}
+
+void TstGogConcurrency::backsOffWhenLatencyClimbsForNothing()
+{
+    GogConcurrency controller(4, 16);
+    qint64 now = 0;
+    controller.evaluate(now, 0);
+
+    runWindow(controller, &now, 4 * kMegabyte, 500);
+    QCOMPARE(controller.limit(), 5);
+    runWindow(controller, &now, 5 * kMegabyte, 500);
+    QCOMPARE(controller.limit(), 6);
+    // The raise to six bought nothing, so it is undone.
+    runWindow(controller, &now, 5 * kMegabyte, 500);
+    QCOMPARE(controller.limit(), 5);
+    // Then something else takes the line: latency triples and nothing more
+    // arrives. That is queueing, and it lowers the limit even while it holds.
+    runWindow(controller, &now, 5 * kMegabyte, 1500);
+    QCOMPARE(controller.limit(), 4);
+}
+
+void TstGogConcurrency::waitsForEnoughSamplesBeforeDeciding()
+{
+    GogConcurrency controller(4, 16);
+    qint64 now = 0;
+    controller.evaluate(now, 0);
+
+    // Two 10 MB chunks in a window on a slow link measure the chunk size, not
+    // the link.
+    controller.chunkArrived(10 * kMegabyte, 4000);
+    controller.chunkArrived(10 * kMegabyte, 4000);
+    now += GogConcurrency::kWindowMs;
+    QVERIFY(!controller.evaluate(now, 0));
+    QCOMPARE(controller.limit(), 4);
+
+    // Though not forever: a link that slow still gets a decision.
+    now += 4 * GogConcurrency::kWindowMs;
+    QVERIFY(controller.evaluate(now, 0));
+    QCOMPARE(controller.limit(), 5);
+}
+
+QTEST_MAIN(TstGogConcurrency)
+#include "tst_gogconcurrency.moc"
@@ -0,0 +1,201 @@
+// Where chunk bytes meet the disk.
+//
+// Preallocation has to leave every file at exactly its final size — shorter
+// and the tail of the game is missing, longer and an old version's bytes ride
+// along past the end. Writes from several threads into one file have to land
+// where they were aimed, which a shared seek position would quietly break. And
+// the descriptor cache has to stay bounded: a manifest with forty thousand
+// files must not end at EMFILE.
+
+#include <QTest>
+#include <QFile>
+#include <QFileInfo>
+#include <QTemporaryDir>
+#include <QtConcurrent>
+
+#include "gog/GogFileWriter.h"
+
+class TstGogFileWriter : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void init();
+
+    void preallocatesToTheExactSize();
+    void shrinksAFileThatIsTooLong();
+    void allocatesRealBlocks();
+    void writesLandAtTheirOffsets();
+    void writesFromManyThreadsLandAtTheirOffsets();
+    void keepsTheNumberOfOpenFilesBounded();
+    void copiesARangeFromAnotherFile();
+    void namesAFileItCannotWrite();
+
+private:
+    QTemporaryDir m_dir;
+    QString m_file;
+};
+
+void TstGogFileWriter::init()
+{
+    QVERIFY(m_dir.isValid());
+    m_file = m_dir.path() + "/game.dat";
+    QFile::remove(m_file);
+}
+
+void TstGogFileWriter::preallocatesToTheExactSize()
+{
+    QVERIFY(GogFileWriter::preallocate(m_file, 300000).isNull());
+    QCOMPARE(QFileInfo(m_file).size(), qint64(300000));
+
+    // Idempotent: a resumed install preallocates again over what is there.
+    QVERIFY(GogFileWriter::preallocate(m_file, 300000).isNull());
+    QCOMPARE(QFileInfo(m_file).size(), qint64(300000));
+
+    QVERIFY(GogFileWriter::preallocate(m_dir.path() + "/empty.dat", 0).isNull());
+    QCOMPARE(QFileInfo(m_dir.path() + "/empty.dat").size(), qint64(0));
+}
+
+void TstGogFileWriter::shrinksAFileThatIsTooLong()
+{
+    {
+        QFile file(m_file);
+        QVERIFY(file.open(QIODevice::WriteOnly));
+        file.write(QByteArray(5000, 'o'));
+    }
+
+    // An update that made the file smaller: the old tail must not survive.
+    QVERIFY(GogFileWriter::preallocate(m_file, 1000).isNull());
+    QCOMPARE(QFileInfo(m_file).size(), qint64(1000));
+
+    QFile file(m_file);
+    QVERIFY(file.open(QIODevice::ReadOnly));
+    QCOMPARE(file.readAll(), QByteArray(1000, 'o'));
+}
+
+void TstGogFileWriter::allocatesRealBlocks()
+{
+    QCOMPARE(GogFileWriter::allocatedBytes(m_file), qint64(0));
+
+    const qint64 size = 4 * 1024 * 1024;
+    QVERIFY(GogFileWriter::preallocate(m_file, size).isNull());
+    const qint64 allocated = GogFileWriter::allocatedBytes(m_file);
+    if (allocated == 0) {
+        QSKIP("The filesystem under the temporary directory cannot allocate ahead; "
+              "preallocate() fell back to a sparse file, as it should.");
+    }
+    QVERIFY(allocated >= size);
+}
+
+void TstGogFileWriter::writesLandAtTheirOffsets()
+{
+    QVERIFY(GogFileWriter::preallocate(m_file, 30).isNull());
+
+    GogFileWriter writer;
+    QString error;
+    QVERIFY(writer.write(m_file, 20, "cccccccccc", 10, &error));
+    QVERIFY(writer.write(m_file, 0, "aaaaaaaaaa", 10, &error));
+    QVERIFY(writer.write(m_file, 10, "bbbbbbbbbb", 10, &error));
+    QVERIFY2(error.isNull(), qPrintable(error));
+    QCOMPARE(writer.openCount(), 1);
+    writer.closeAll();
+    QCOMPARE(writer.openCount(), 0);
+
+    QFile file(m_file);
+    QVERIFY(file.open(QIODevice::ReadOnly));
+    QCOMPARE(file.readAll(), QByteArray("aaaaaaaaaabbbbbbbbbbcccccccccc"));
+}
+
+void TstGogFileWriter::writesFromManyThreadsLandAtTheirOffsets()
+{
+    constexpr int kPieces = 64;
+    constexpr int kPieceSize = 64 * 1024;
+    QVERIFY(GogFileWriter::preallocate(m_file, qint64(kPieces) * kPieceSize).isNull());
+
+    QList<int> pieces;
+    for (int i = kPieces - 1; i >= 0; --i) {
+        pieces.append(i);
+    }
+
+    GogFileWriter writer;
+    QAtomicInt failures;
+    QtConcurrent::blockingMap(pieces, [&](int piece) {
+        const QByteArray bytes(kPieceSize, char('A' + piece % 26));
+        if (!writer.write(m_file, qint64(piece) * kPieceSize, bytes.constData(), bytes.size(),
+                          nullptr)) {
+            failures.ref();
+        }
+    });
+    QCOMPARE(failures.loadRelaxed(), 0);
+    writer.closeAll();
+
+    QFile file(m_file);
+    QVERIFY(file.open(QIODevice::ReadOnly));
+    for (int piece = 0; piece < kPieces; ++piece) {
+        QCOMPARE(file.read(kPieceSize), QByteArray(kPieceSize, char('A' + piece % 26)));
+    }
+}
+
+void TstGogFileWriter::keepsTheNumberOfOpenFilesBounded()
+{
+    GogFileWriter writer(3);
+    QString error;
+    for (int i = 0; i < 10; ++i) {
+        const QString path = m_dir.path() + QStringLiteral("/file%1.dat").arg(i);
+        QVERIFY2(writer.write(path, 0, "x", 1, &error), qPrintable(error));
+        QVERIFY(writer.openCount() <= 3);
+    }
+    QCOMPARE(writer.openCount(), 3);
+
+    // An evicted file is simply opened again.
+    QVERIFY2(writer.write(m_dir.path() + "/file0.dat", 1, "y", 1, &error), qPrintable(error));
+    writer.closeAll();
+
+    QFile file(m_dir.path() + "/file0.dat");
+    QVERIFY(file.open(QIODevice::ReadOnly));
+    QCOMPARE(file.readAll(), QByteArray("xy"));
+}
+
+void TstGogFileWriter::copiesARangeFromAnotherFile()
+{
+    const QString source = m_dir.path() + "/old.dat";
+    {
+        QFile file(source);
+        QVERIFY(file.open(QIODevice::WriteOnly));
+        file.write("0123456789abcdefghij");
+    }
+    QVERIFY(GogFileWriter::preallocate(m_file, 20).isNull());
+
+    GogFileWriter writer;
+    QString error;
+    QVERIFY2(writer.copyRange(source, 10, m_file, 5, 10, &error), qPrintable(error));
+
+    // A source shorter than the range is an error, not a short copy.
+    QVERIFY(!writer.copyRange(source, 15, m_file, 0, 10, &error));
+    QVERIFY2(error.contains(source), qPrintable(error));
+    writer.closeAll();
+
+    QFile file(m_file);
+    QVERIFY(file.open(QIODevice::ReadOnly));
+    const QByteArray bytes = file.readAll();
+    QCOMPARE(bytes.size(), 20);
+    QCOMPARE(bytes.mid(5, 10), QByteArray("abcdefghij"));
+}
+
+void TstGogFileWriter::namesAFileItCannotWrite()
+{
+    const QString missing = m_dir.path() + "/no/such/directory/game.dat";
+
+    GogFileWriter writer;
+    QString error;
+    QVERIFY(!writer.write(missing, 0, "x", 1, &error));
+    QVERIFY2(error.contains(missing), qPrintable(error));
+    QCOMPARE(writer.openCount(), 0);
+
+    const QString failure = GogFileWriter::preallocate(missing, 10);
+    QVERIFY(!failure.isNull());
+    QVERIFY2(failure.contains(missing), qPrintable(failure));
+}
+
+QTEST_MAIN(TstGogFileWriter)
+#include "tst_gogfilewriter.moc"
@@ -0,0 +1,261 @@
+// What makes an interrupted install resumable.
+//
+// The journal is only worth having if it never calls a chunk finished that is
+// not. So: what was recorded is what a reopen finds, whether or not it was
+// compacted; a journal written for another plan, down to a single chunk's
+// md5, finds nothing; a record torn by a crash is dropped without taking the
+// ones before it along; records reach the disk a batch at a time rather than
+// a write per chunk; and the log stays bounded however many chunks a game has.
+
+#include <QTest>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QTemporaryDir>
+
+#include "gog/GogInstallJournal.h"
+
+namespace {
+
+GogInstallPlan::Plan planOf(const QList<int>& chunkCounts)
+{
+    GogInstallPlan::Plan plan;
+    for (int i = 0; i < chunkCounts.size(); ++i) {
+        GogInstallPlan::FileTask file;
+        file.relPath = QStringLiteral("data/file%1.pak").arg(i);
+        for (int c = 0; c < chunkCounts.at(i); ++c) {
+            GogContentClient::Chunk chunk;
+            chunk.size = 100;
+            file.chunks << chunk;
+            file.size += chunk.size;
+        }
+        plan.files << file;
+    }
+    plan.valid = true;
+    return plan;
+}
+
+} // namespace
+
+class TstGogInstallJournal : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void init();
+
+    void startsEmpty();
+    void remembersWhatWasRecorded();
+    void remembersAcrossACompaction();
+    void ignoresAJournalForAnotherPlan();
+    void dropsATornRecord();
+    void writesRecordsInBatches();
+    void keepsTheLogBounded();
+    void writesThePlanOnce();
+    void refusesChunksOutsideThePlan();
+
+private:
+    QTemporaryDir m_dir;
+    QString m_journal;
+};
+
+void TstGogInstallJournal::init()
+{
+    QVERIFY(m_dir.isValid());
+    m_journal = m_dir.path() + "/.protonforge-gog";
+    QDir(m_journal).removeRecursively();
+}
+
+void TstGogInstallJournal::startsEmpty()
+{
+    GogInstallJournal journal;
+    QVERIFY(journal.open(m_journal, "b1", planOf({3, 2})).isNull());
+    QVERIFY(journal.isOpen());
+    QCOMPARE(journal.doneCount(), 0);
+    QVERIFY(!journal.isDone(0, 0));
+    QVERIFY(QFileInfo::exists(m_journal + "/" + GogInstallJournal::planFileName()));
+    QVERIFY(QFileInfo::exists(m_journal + "/" + GogInstallJournal::doneFileName()));
+}
+
+void TstGogInstallJournal::remembersWhatWasRecorded()
+{
+    const GogInstallPlan::Plan plan = planOf({3, 2});
+    {
+        GogInstallJournal journal;
+        QVERIFY(journal.open(m_journal, "b1", plan).isNull());
+        journal.markDone(0, 2);
+        journal.markDone(1, 0);
+        journal.markDone(1, 0);   // twice is once
+        QCOMPARE(journal.doneCount(), 2);
+        QCOMPARE(journal.pendingRecords(), 2);
+    }
+
+    GogInstallJournal journal;
+    QVERIFY(journal.open(m_journal, "b1", plan).isNull());
+    QCOMPARE(journal.doneCount(), 2);
+    QVERIFY(journal.isDone(0, 2));
+    QVERIFY(journal.isDone(1, 0));
+    QVERIFY(!journal.isDone(0, 0));
+    QVERIFY(!journal.isDone(1, 1));
+}
+
+void TstGogInstallJournal::remembersAcrossACompaction()
+{
+    const GogInstallPlan::Plan plan = planOf({4});
+    {
+        GogInstallJournal journal;
+        QVERIFY(journal.open(m_journal, "b1", plan).isNull());
+        journal.markDone(0, 1);
+        journal.compact();
+        QCOMPARE(journal.pendingRecords(), 0);
+        // Appended after the snapshot, to the new file.
+        journal.markDone(0, 3);
+    }
+
+    GogInstallJournal journal;
+    QVERIFY(journal.open(m_journal, "b1", plan).isNull());
+    QCOMPARE(journal.doneCount(), 2);
+    QVERIFY(journal.isDone(0, 1));
+    QVERIFY(journal.isDone(0, 3));
+    QCOMPARE(journal.pendingRecords(), 1);
+}
+
+void TstGogInstallJournal::ignoresAJournalForAnotherPlan()
+{
+    {
+        GogInstallJournal journal;
+        QVERIFY(journal.open(m_journal, "b1", planOf({3, 2})).isNull());
+        journal.markDone(0, 0);
+    }
+
+    // A new build: the same ordinals name different bytes.
+    GogInstallJournal journal;
+    QVERIFY(journal.open(m_journal, "b2", planOf({3, 2})).isNull());
+    QCOMPARE(journal.doneCount(), 0);
+    journal.close();
+
+    // The same build with another language: other files, other chunks.
+    QVERIFY(journal.open(m_journal, "b1", planOf({3, 2, 1})).isNull());
+    QCOMPARE(journal.doneCount(), 0);
+    journal.markDone(0, 0);
+    journal.close();
+
+    // The same paths and counts, but a chunk with other bytes in it.
+    GogInstallPlan::Plan changed = planOf({3, 2, 1});
+    changed.files[0].chunks[0].md5 = QStringLiteral("0123456789abcdef0123456789abcdef");
+    QVERIFY(journal.open(m_journal, "b1", changed).isNull());
+    QCOMPARE(journal.doneCount(), 0);
+}
+
+void TstGogInstallJournal::dropsATornRecord()
+{
+    const GogInstallPlan::Plan plan = planOf({5});
+    {
+        GogInstallJournal journal;
+        QVERIFY(journal.open(m_journal, "b1", plan).isNull());
+        journal.markDone(0, 0);
+        journal.markDone(0, 1);
+    }
+    {
+        // Half a record, as a crash mid-append would leave it.
+        QFile file(m_journal + "/" + GogInstallJournal::doneFileName());
+        QVERIFY(file.open(QIODevice::Append));
+        file.write("\x04\x00\x00", 3);
+    }
+    {
+        GogInstallJournal journal;
+        QVERIFY(journal.open(m_journal, "b1", plan).isNull());
+        QCOMPARE(journal.doneCount(), 2);
+        // Lands on a record boundary, not after the debris.
+        journal.markDone(0, 4);
+    }
+
+    GogInstallJournal journal;
+    QVERIFY(journal.open(m_journal, "b1", plan).isNull());
+    QCOMPARE(journal.doneCount(), 3);
+    QVERIFY(journal.isDone(0, 4));
+}
+
+void TstGogInstallJournal::writesRecordsInBatches()
+{
+    const GogInstallPlan::Plan plan = planOf({500});
+    const QString doneFile = m_journal + "/" + GogInstallJournal::doneFileName();
+
+    GogInstallJournal journal;
+    QVERIFY(journal.open(m_journal, "b1", plan).isNull());
+    const qint64 empty = QFileInfo(doneFile).size();
+
+    // Gathered, not written.
+    journal.markDone(0, 0);
+    journal.markDone(0, 1);
+    journal.markDone(0, 2);
+    QCOMPARE(journal.pendingRecords(), 3);
+    QCOMPARE(QFileInfo(doneFile).size(), empty);
+
+    journal.flush();
+    QCOMPARE(QFileInfo(doneFile).size(), empty + 3 * 8);
+
+    // Nor does it wait for a flush forever.
+    for (int c = 3; c < 200; ++c) {
+        journal.markDone(0, c);
+    }
+    QVERIFY(QFileInfo(doneFile).size() > empty + 3 * 8);
+    QVERIFY(QFileInfo(doneFile).size() < empty + 200 * 8);
+
+    // Whatever is still gathered goes out on close.
+    journal.close();
+    QCOMPARE(QFileInfo(doneFile).size(), empty + 200 * 8);
+    QVERIFY(journal.open(m_journal, "b1", plan).isNull());
+    QCOMPARE(journal.doneCount(), 200);
+}
+
+void TstGogInstallJournal::keepsTheLogBounded()
+{
+    constexpr int kChunks = 150000;
+    const GogInstallPlan::Plan plan = planOf({kChunks});
+
+    GogInstallJournal journal;
+    QVERIFY(journal.open(m_journal, "b1", plan).isNull());
+    for (int c = 0; c < kChunks; ++c) {
+        journal.markDone(0, c);
+    }
+    QCOMPARE(journal.doneCount(), kChunks);
+
+    // Header, a bitmap of one bit per chunk, and a bounded tail of records —
+    // not eight bytes for every chunk ever finished.
+    const qint64 size = QFileInfo(m_journal + "/" + GogInstallJournal::doneFileName()).size();
+    QVERIFY2(size < 128 * 1024, qPrintable(QString::number(size)));
+    journal.close();
+
+    QVERIFY(journal.open(m_journal, "b1", plan).isNull());
+    QCOMPARE(journal.doneCount(), kChunks);
+}
+
+void TstGogInstallJournal::writesThePlanOnce()
+{
+    const GogInstallPlan::Plan plan = planOf({2});
+    const QString planFile = m_journal + "/" + GogInstallJournal::planFileName();
+
+    GogInstallJournal journal;
+    QVERIFY(journal.open(m_journal, "b1", plan).isNull());
+    journal.close();
+    const QDateTime written = QFileInfo(planFile).lastModified();
+
+    QTest::qSleep(20);
+    QVERIFY(journal.open(m_journal, "b1", plan).isNull());
+    QCOMPARE(QFileInfo(planFile).lastModified(), written);
+}
+
+void TstGogInstallJournal::refusesChunksOutsideThePlan()
+{
+    GogInstallJournal journal;
+    QVERIFY(journal.open(m_journal, "b1", planOf({2, 2})).isNull());
+    journal.markDone(0, 2);    // would be file 1's first chunk
+    journal.markDone(2, 0);
+    journal.markDone(-1, 0);
+    QCOMPARE(journal.doneCount(), 0);
+    QVERIFY(!journal.isDone(1, 0));
+}
+
+QTEST_MAIN(TstGogInstallJournal)
+#include "tst_goginstalljournal.moc"
@@ -0,0 +1,214 @@
+// Finding the parts of a build that are already on disk.
+//
+// Reuse is only worth having if it never puts a wrong byte in a file. So: a
+// chunk counts as in place only when its own range hashes right, not when the
+// file is merely the right size; a range past the end of a short file is never
+// a match; a renamed file's old copy is found as a source but never marked as
+// anything to keep; and a copy lands exactly where the chunk belongs.
+
+#include <QTest>
+#include <QCryptographicHash>
+#include <QFile>
+#include <QTemporaryDir>
+
+#include "gog/GogFileWriter.h"
+#include "gog/GogLocalReuse.h"
+
+namespace {
+
+QString md5Of(const QByteArray& data)
+{
+    return QString::fromLatin1(QCryptographicHash::hash(data, QCryptographicHash::Md5).toHex());
+}
+
+GogContentClient::Chunk chunkOf(const QByteArray& data)
+{
+    GogContentClient::Chunk chunk;
+    chunk.md5 = md5Of(data);
+    chunk.compressedMd5 = md5Of("z" + data);   // only has to be distinct
+    chunk.size = data.size();
+    chunk.compressedSize = data.size();
+    return chunk;
+}
+
+GogInstallPlan::FileTask fileOf(const QString& relPath, const QList<QByteArray>& pieces)
+{
+    GogInstallPlan::FileTask file;
+    file.relPath = relPath;
+    for (const QByteArray& piece : pieces) {
+        file.chunks << chunkOf(piece);
+        file.size += piece.size();
+    }
+    return file;
+}
+
+void writeFile(const QString& path, const QByteArray& data)
+{
+    QFile file(path);
+    QVERIFY(file.open(QIODevice::WriteOnly));
+    file.write(data);
+}
+
+QByteArray readFile(const QString& path)
+{
+    QFile file(path);
+    return file.open(QIODevice::ReadOnly) ? file.readAll() : QByteArray();
+}
+
+const QByteArray kA(1000, 'a');
+const QByteArray kB(1000, 'b');
+const QByteArray kC(1000, 'c');
+const QByteArray kD(1000, 'd');
+
+} // namespace
+
+class TstGogLocalReuse : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void init();
+
+    void findsTheChunksAlreadyInPlace();
+    void ignoresRangesPastTheEnd();
+    void findsARenamedFilesContent();
+    void skipsWhatIsDoneOrInPlace();
+    void copiesIntoTheRightRange();
+    void picksTheCommonChunkSize();
+    void stopsWhenCancelled();
+
+private:
+    QTemporaryDir m_dir;
+};
+
+void TstGogLocalReuse::init()
+{
+    QVERIFY(m_dir.isValid());
+}
+
+void TstGogLocalReuse::findsTheChunksAlreadyInPlace()
+{
+    // The update changed the middle chunk and nothing else.
+    const QString path = m_dir.path() + "/game.pak";
+    writeFile(path, kA + kB + kC);
+    const GogInstallPlan::FileTask file = fileOf("game.pak", {kA, kD, kC});
+
+    const GogLocalReuse::FileScan scan = GogLocalReuse::scanFile(file, 0, path);
+    QCOMPARE(scan.fileIndex, 0);
+    QCOMPARE(scan.inPlace, (QList<int>{0, 2}));
+    QVERIFY(scan.sources.contains(md5Of(kA)));
+    QCOMPARE(scan.sources.value(md5Of(kC)).offset, qint64(2000));
+    // The old middle is about to be overwritten, so it is no one's source.
+    QVERIFY(!scan.sources.contains(md5Of(kB)));
+}
+
+void TstGogLocalReuse::ignoresRangesPastTheEnd()
+{
+    const QString path = m_dir.path() + "/short.pak";
+    writeFile(path, kA + kB.left(500));
+    const GogInstallPlan::FileTask file = fileOf("short.pak", {kA, kB});
+
+    const GogLocalReuse::FileScan scan = GogLocalReuse::scanFile(file, 3, path);
+    QCOMPARE(scan.inPlace, (QList<int>{0}));
+
+    // A file that is not there is nothing in place, not an error.
+    QVERIFY(GogLocalReuse::scanFile(file, 3, m_dir.path() + "/missing.pak").inPlace.isEmpty());
+}
+
+void TstGogLocalReuse::findsARenamedFilesContent()
+{
+    // Last chunk short, as a real file's is.
+    const QByteArray tail = kD.left(300);
+    const QString old = m_dir.path() + "/old_name.pak";
+    writeFile(old, kB + kC + tail);
+
+    const GogLocalReuse::FileScan scan = GogLocalReuse::scanLeftover(old, 1000);
+    QCOMPARE(scan.fileIndex, -1);
+    QVERIFY(scan.inPlace.isEmpty());
+    QCOMPARE(scan.sources.size(), 3);
+    QCOMPARE(scan.sources.value(md5Of(kC)).offset, qint64(1000));
+    QCOMPARE(scan.sources.value(md5Of(tail)).size, qint64(300));
+
+    GogInstallPlan::Plan plan;
+    plan.files << fileOf("new_name.pak", {kA, kB, kC, tail});
+
+    const QList<GogLocalReuse::Copy> copies =
+        GogLocalReuse::planCopies(plan, {0}, {scan}, {});
+    QCOMPARE(copies.size(), 3);
+    QCOMPARE(copies.at(0).chunkIndex, 1);
+    QCOMPARE(copies.at(0).offset, qint64(1000));
+    QCOMPARE(copies.at(0).source.offset, qint64(0));
+    QCOMPARE(copies.at(2).chunkIndex, 3);
+    QCOMPARE(copies.at(2).size, qint64(300));
+}
+
+void TstGogLocalReuse::skipsWhatIsDoneOrInPlace()
+{
+    const QString path = m_dir.path() + "/game.pak";
+    writeFile(path, kA + kB + kC);
+
+    GogInstallPlan::Plan plan;
+    // kA moved to the end, and one chunk repeats one that is in place.
+    plan.files << fileOf("game.pak", {kA, kB, kC, kA, kB});
+    const GogLocalReuse::FileScan scan = GogLocalReuse::scanFile(plan.files.at(0), 0, path);
+    QCOMPARE(scan.inPlace, (QList<int>{0, 1, 2}));
+
+    QList<GogLocalReuse::Copy> copies = GogLocalReuse::planCopies(plan, {0}, {scan}, {});
+    QCOMPARE(copies.size(), 2);
+    QCOMPARE(copies.at(0).chunkIndex, 3);
+    QCOMPARE(copies.at(0).offset, qint64(3000));
+
+    // Already journalled as done: nothing to copy for it.
+    copies = GogLocalReuse::planCopies(plan, {0}, {scan}, {{0, {3}}});
+    QCOMPARE(copies.size(), 1);
+    QCOMPARE(copies.at(0).chunkIndex, 4);
+}
+
+void TstGogLocalReuse::copiesIntoTheRightRange()
+{
+    const QString old = m_dir.path() + "/old_name.pak";
+    writeFile(old, kB + kC);
+    const QString path = m_dir.path() + "/new_name.pak";
+    QVERIFY(GogFileWriter::preallocate(path, 3000).isNull());
+
+    GogInstallPlan::Plan plan;
+    plan.files << fileOf("new_name.pak", {kA, kC, kB});
+    const QList<GogLocalReuse::Copy> copies = GogLocalReuse::planCopies(
+        plan, {0}, {GogLocalReuse::scanLeftover(old, 1000)}, {});
+    QCOMPARE(copies.size(), 2);
+
+    GogFileWriter writer;
+    const QList<GogLocalReuse::Copy> landed = GogLocalReuse::copyChunks(copies, path, writer);
+    QCOMPARE(landed.size(), 2);
+    writer.closeAll();
+
+    const QByteArray bytes = readFile(path);
+    QCOMPARE(bytes.size(), 3000);
+    QCOMPARE(bytes.mid(1000), kC + kB);
+
+    // A source that has gone away is left for the download, not fatal.
+    QFile::remove(old);
+    QVERIFY(GogLocalReuse::copyChunks(copies, path, writer).isEmpty());
+}
+
+void TstGogLocalReuse::picksTheCommonChunkSize()
+{
+    GogInstallPlan::Plan plan;
+    plan.files << fileOf("a", {kA, kB, kC.left(10)}) << fileOf("b", {kD, kA.left(20)});
+    QCOMPARE(GogLocalReuse::typicalChunkSize(plan), qint64(1000));
+    QCOMPARE(GogLocalReuse::typicalChunkSize(GogInstallPlan::Plan()), qint64(0));
+}
+
+void TstGogLocalReuse::stopsWhenCancelled()
+{
+    const QString path = m_dir.path() + "/game.pak";
+    writeFile(path, kA + kB);
+    const std::atomic<bool> cancelled{true};
+
+    const GogInstallPlan::FileTask file = fileOf("game.pak", {kA, kB});
+    QVERIFY(GogLocalReuse::scanFile(file, 0, path, &cancelled).inPlace.isEmpty());
+    QVERIFY(GogLocalReuse::scanLeftover(path, 1000, &cancelled).sources.isEmpty());
+}
+
+QTEST_MAIN(TstGogLocalReuse)
+#include "tst_goglocalreuse.moc"
@@ -41,6 +41,16 @@ private slots:
     void buildsTheDownloadUrl_data();
     void buildsTheDownloadUrl();
 
+    void parsesContentRange_data();
+    void parsesContentRange();
+    void asksForExactlyTheRange();
+
+    void buildsTheDownlinkUrl_data();
+    void buildsTheDownlinkUrl();
+    void readsGogsChecksum_data();
+    void readsGogsChecksum();
+    void cutsTheInstallerIntoSegments();
+
     void survivesGarbage_data();
     void survivesGarbage();
 
@@ -176,6 +186,126 @@ void TstGogOffline::buildsTheDownloadUrl()
     QCOMPARE(GogOfflineClient::downloadUrl(manualUrl), expected);
 }
 
+void TstGogOffline::parsesContentRange_data()
+{
+    // Reading a 200 as though it were the tail, or trusting a total that is not
+    // there, puts the wrong bytes where the archive's directory should be.
+    QTest::addColumn<QByteArray>("header");
+    QTest::addColumn<bool>("valid");
+    QTest::addColumn<qint64>("first");
+    QTest::addColumn<qint64>("last");
+    QTest::addColumn<qint64>("total");
+
+    QTest::newRow("tail") << QByteArray("bytes 3000-3999/4000") << true
+                          << qint64(3000) << qint64(3999) << qint64(4000);
+    QTest::newRow("over 4 GB") << QByteArray("bytes 0-0/21474836480") << true
+                               << qint64(0) << qint64(0) << qint64(21474836480);
+    QTest::newRow("unknown total") << QByteArray("bytes 10-19/*") << true
+                                   << qint64(10) << qint64(19) << qint64(-1);
+    QTest::newRow("empty") << QByteArray() << false << qint64(0) << qint64(0) << qint64(0);
+    QTest::newRow("unsatisfied") << QByteArray("bytes */4000") << false
+                                 << qint64(0) << qint64(0) << qint64(0);
+    QTest::newRow("backwards") << QByteArray("bytes 20-10/4000") << false
+                               << qint64(0) << qint64(0) << qint64(0);
+    QTest::newRow("past the end") << QByteArray("bytes 0-4000/4000") << false
+                                  << qint64(0) << qint64(0) << qint64(0);
+    QTest::newRow("other unit") << QByteArray("items 0-1/2") << false
+                                << qint64(0) << qint64(0) << qint64(0);
+}
+
+void TstGogOffline::parsesContentRange()
+{
+    QFETCH(QByteArray, header);
+    QFETCH(bool, valid);
+
+    qint64 first = 0;
+    qint64 last = 0;
+    qint64 total = 0;
+    QCOMPARE(GogOfflineClient::parseContentRange(header, &first, &last, &total), valid);
+    if (valid) {
+        QTEST(first, "first");
+        QTEST(last, "last");
+        QTEST(total, "total");
+    }
+}
+
+void TstGogOffline::asksForExactlyTheRange()
+{
+    const QNetworkRequest request =
+        GogOfflineClient::rangeRequest("https://cdn.gog.com/x.sh?sig=1", 4096, 1024);
+    QCOMPARE(request.rawHeader("Range"), QByteArray("bytes=4096-5119"));
+    // The CDN's URL is signed; a token on it would only leak the token.
+    QVERIFY(!request.hasRawHeader("Authorization"));
+}
+
+void TstGogOffline::buildsTheDownlinkUrl_data()
+{
+    QTest::addColumn<QString>("manualUrl");
+    QTest::addColumn<QString>("expected");
+
+    QTest::newRow("relative")
+        << "/downlink/fixture_game/en1installer1"
+        << "https://api.gog.com/products/1207658924/downlink/installer/en1installer1";
+    QTest::newRow("trailing slash") << "/downlink/fixture_game/" << "";
+    QTest::newRow("query") << "/downlink/x?token=1" << "";
+    QTest::newRow("empty") << "" << "";
+}
+
+void TstGogOffline::buildsTheDownlinkUrl()
+{
+    QFETCH(QString, manualUrl);
+    QFETCH(QString, expected);
+    QCOMPARE(GogOfflineClient::downlinkUrl("1207658924", manualUrl), expected);
+}
+
+void TstGogOffline::readsGogsChecksum_data()
+{
+    // A checksum that is misread is worse than none: it fails every download
+    // of that installer as damaged.
+    QTest::addColumn<QByteArray>("xml");
+    QTest::addColumn<QString>("expected");
+
+    QTest::newRow("with chunks")
+        << QByteArray("<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+                      "<file name=\"game_1.0.sh\" available=\"1\" notavailablemsg=\"\" "
+                      "md5=\"0CC175B9C0F1B6A831C399E269772661\" chunks=\"2\" "
+                      "timestamp=\"2024-01-01 00:00:00\" total_size=\"20971520\">\n"
+                      "  <chunk id=\"0\" from=\"0\" to=\"10485759\" method=\"md5\">"
+                      "900150983cd24fb0d6963f7d28e17f72</chunk>\n"
+                      "</file>")
+        << "0cc175b9c0f1b6a831c399e269772661";
+    QTest::newRow("no md5") << QByteArray("<file name=\"x.sh\" chunks=\"0\"/>") << "";
+    QTest::newRow("not an md5") << QByteArray("<file md5=\"abc\"/>") << "";
+    QTest::newRow("other document") << QByteArray("<html>403</html>") << "";
+    QTest::newRow("empty") << QByteArray() << "";
+}
+
+void TstGogOffline::readsGogsChecksum()
+{
+    QFETCH(QByteArray, xml);
+    QFETCH(QString, expected);
+    QCOMPARE(GogOfflineClient::parseChecksumXml(xml), expected);
+}
+
+void TstGogOffline::cutsTheInstallerIntoSegments()
+{
+    const GogInstallPlan::Plan plan = GogOfflineClient::segmentPlan("installer.sh", 2500, 1000);
+    QVERIFY(plan.valid);
+    QCOMPARE(plan.files.size(), 1);
+    QCOMPARE(plan.files.first().size, qint64(2500));
+
+    // Every byte in exactly one segment, the last one short.
+    QList<qint64> sizes;
+    for (const GogContentClient::Chunk& segment : plan.files.first().chunks) {
+        sizes << segment.size;
+    }
+    QCOMPARE(sizes, (QList<qint64>{1000, 1000, 500}));
+
+    QCOMPARE(GogOfflineClient::segmentPlan("installer.sh", 2000, 1000).files.first().chunks.size(),
+             2);
+    QVERIFY(!GogOfflineClient::segmentPlan("installer.sh", 0, 1000).valid);
+}
+
 void TstGogOffline::survivesGarbage_data()
 {
     QTest::addColumn<QByteArray>("json");
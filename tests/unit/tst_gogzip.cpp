@@ -20,8 +20,11 @@
 #include <QCryptographicHash>
 #include <QDir>
 #include <QFile>
+#include <QFileInfo>
 #include <QTemporaryDir>
+#include <QtConcurrent>
 
+#include "gog/ZipEntryStream.h"
 #include "gog/ZipReader.h"
 
 class TstGogZip : public QObject
@@ -35,17 +38,28 @@ private slots:
 
     void readsADeflatedEntry();
     void readsAStoredEntry();
+    void findsEntriesByName();
     void extractsToDiskAndKeepsTheExecutableBit();
     void extractedBytesMatchTheOriginal();
+    void extractsAStoredEntry();
+    void extractsFromManyThreadsAtOnce();
+    void stopsWhenCancelled();
+    void waitsOutAPauseUntilResumedOrCancelled();
 
     void readsZip64Records();
     void refusesASplitArchive();
 
+    void readsAnArchiveFromItsTailAndDirectory_data();
+    void readsAnArchiveFromItsTailAndDirectory();
+    void streamsAnEntryFromItsRange();
+    void streamRefusesAnEntryCutShort();
+
     void refusesNamesThatEscape_data();
     void refusesNamesThatEscape();
 
     void rejectsAnArchiveWhoseEntryIsTruncated();
     void rejectsDataThatUnpacksCleanlyButIsWrong();
+    void checksAZeroChecksumLikeAnyOther();
     void refusesThingsThatAreNotArchives_data();
     void refusesThingsThatAreNotArchives();
 
@@ -55,14 +69,16 @@ private:
         return QStringLiteral(PROTONFORGE_FIXTURES_DIR) + "/gog/" + name;
     }
 
+    static QByteArray contents(const QString& path)
+    {
+        QFile file(path);
+        return file.open(QIODevice::ReadOnly) ? file.readAll() : QByteArray();
+    }
+
     static ZipReader::Entry entryNamed(const ZipReader& reader, const QString& name)
     {
-        for (const ZipReader::Entry& entry : reader.entries()) {
-            if (entry.name == name) {
-                return entry;
-            }
-        }
-        return {};
+        const ZipReader::Entry* entry = reader.findEntry(name);
+        return entry ? *entry : ZipReader::Entry();
     }
 };
 
@@ -139,6 +155,23 @@ void TstGogZip::readsAStoredEntry()
     QCOMPARE(reader.readEntry(entry, &error), QByteArray("stored bytes, not deflated"));
 }
 
+void TstGogZip::findsEntriesByName()
+{
+    ZipReader reader;
+    QVERIFY(reader.open(fixture("sfx-installer.sh")));
+
+    // Every entry is found under its own name, and is that entry — not a copy
+    // that happens to match.
+    for (const ZipReader::Entry& entry : reader.entries()) {
+        QCOMPARE(reader.findEntry(entry.name), &entry);
+    }
+    QVERIFY(!reader.findEntry("data/noarch/missing"));
+    QVERIFY(!reader.findEntry("data/noarch"));   // the directory is "data/noarch/"
+
+    reader.close();
+    QVERIFY(!reader.findEntry("data/noarch/start.sh"));
+}
+
 void TstGogZip::extractsToDiskAndKeepsTheExecutableBit()
 {
     QTemporaryDir dir;
@@ -188,6 +221,136 @@ void TstGogZip::extractedBytesMatchTheOriginal()
     QVERIFY(bytes.startsWith("ELF"));
 }
 
+void TstGogZip::extractsAStoredEntry()
+{
+    // The other path: nothing to inflate, so the bytes are copied from the
+    // installer to the file as they are, and counted as they go.
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+
+    ZipReader reader;
+    QVERIFY(reader.open(fixture("sfx-installer.sh")));
+    const ZipReader::Entry entry = entryNamed(reader, "data/noarch/game/data/stored.dat");
+    QCOMPARE(entry.method, quint16(0));
+
+    // A reinstall: the old copy is replaced, not refused.
+    const QString dest = dir.path() + "/data/stored.dat";
+    QVERIFY(QDir().mkpath(dir.path() + "/data"));
+    {
+        QFile old(dest);
+        QVERIFY(old.open(QIODevice::WriteOnly));
+        old.write("an older build's bytes, and more of them");
+    }
+
+    ZipReader::Control control;
+    QString error;
+    QVERIFY2(reader.extractEntry(entry, dest, &error, &control), qPrintable(error));
+    QCOMPARE(contents(dest), QByteArray("stored bytes, not deflated"));
+    QCOMPARE(control.bytesWritten.load(), entry.uncompressedSize);
+    // Only the finished file, no temporary beside it.
+    QCOMPARE(QDir(dir.path() + "/data").entryList(QDir::Files), QStringList{"stored.dat"});
+}
+
+void TstGogZip::extractsFromManyThreadsAtOnce()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+
+    ZipReader reader;
+    QVERIFY(reader.open(fixture("sfx-installer.sh")));
+
+    // Every regular file, each several times over, all through one reader: a
+    // shared seek position would hand one thread another's bytes, and the CRC
+    // would say so.
+    QList<ZipReader::Entry> files;
+    for (const ZipReader::Entry& entry : reader.entries()) {
+        if (!entry.isDirectory && !entry.isSymlink) {
+            files << entry;
+        }
+    }
+    QList<int> jobs;
+    for (int i = 0; i < files.size() * 8; ++i) {
+        jobs << i;
+    }
+
+    ZipReader::Control control;
+    QAtomicInt failures;
+    QtConcurrent::blockingMap(jobs, [&](int job) {
+        const ZipReader::Entry& entry = files.at(job % files.size());
+        const QString dest = dir.path() + QStringLiteral("/%1/").arg(job) + entry.name;
+        if (!reader.extractEntry(entry, dest, nullptr, &control)) {
+            failures.ref();
+        }
+    });
+    QCOMPARE(failures.loadRelaxed(), 0);
+
+    qint64 expected = 0;
+    for (const ZipReader::Entry& entry : std::as_const(files)) {
+        expected += entry.uncompressedSize * 8;
+    }
+    QCOMPARE(control.bytesWritten.load(), expected);
+}
+
+void TstGogZip::stopsWhenCancelled()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+
+    ZipReader reader;
+    QVERIFY(reader.open(fixture("sfx-installer.sh")));
+    const ZipReader::Entry entry = entryNamed(reader, "data/noarch/game/bin/game");
+
+    ZipReader::Control control;
+    control.cancel();
+    const QString dest = dir.path() + "/game";
+    QString error;
+    QVERIFY(!reader.extractEntry(entry, dest, &error, &control));
+    QVERIFY2(error.contains("cancelled"), qPrintable(error));
+    // Nothing half-written is left for the game to trip over.
+    QVERIFY(!QFile::exists(dest));
+}
+
+void TstGogZip::waitsOutAPauseUntilResumedOrCancelled()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+
+    ZipReader reader;
+    QVERIFY(reader.open(fixture("sfx-installer.sh")));
+    const ZipReader::Entry entry = entryNamed(reader, "data/noarch/game/bin/game");
+
+    // Paused before it starts: it holds at its first buffer, and resuming
+    // lets it finish.
+    {
+        ZipReader::Control control;
+        control.setPaused(true);
+        const QString dest = dir.path() + "/resumed";
+        QFuture<bool> done = QtConcurrent::run([&] {
+            return reader.extractEntry(entry, dest, nullptr, &control);
+        });
+        QTest::qWait(100);
+        QVERIFY(!done.isFinished());
+        control.setPaused(false);
+        QVERIFY(done.result());
+        QVERIFY(QFile::exists(dest));
+    }
+
+    // Cancelled while paused: it wakes and gives up.
+    {
+        ZipReader::Control control;
+        control.setPaused(true);
+        const QString dest = dir.path() + "/cancelled";
+        QFuture<bool> done = QtConcurrent::run([&] {
+            return reader.extractEntry(entry, dest, nullptr, &control);
+        });
+        QTest::qWait(100);
+        QVERIFY(!done.isFinished());
+        control.cancel();
+        QVERIFY(!done.result());
+        QVERIFY(!QFile::exists(dest));
+    }
+}
+
 void TstGogZip::readsZip64Records()
 {
     // The classic EOCD in this fixture is all sentinels, so a reader that skips
@@ -215,6 +378,134 @@ void TstGogZip::refusesASplitArchive()
     QVERIFY(!ZipReader::namesASplitArchive(fixture("sfx-installer.sh")));
 }
 
+void TstGogZip::readsAnArchiveFromItsTailAndDirectory_data()
+{
+    QTest::addColumn<QString>("name");
+    QTest::newRow("self-extracting") << "sfx-installer.sh";
+    QTest::newRow("zip64") << "zip64.zip";
+}
+
+void TstGogZip::readsAnArchiveFromItsTailAndDirectory()
+{
+    // What a ranged install has: the end of the file, then the range the end
+    // points at, and nothing else. It has to come to the same entries as the
+    // whole file does.
+    QFETCH(QString, name);
+    const QByteArray whole = contents(fixture(name));
+    QVERIFY(!whole.isEmpty());
+
+    ZipReader local;
+    QVERIFY(local.open(fixture(name)));
+
+    ZipReader remote;
+    const qint64 tailLen = qMin<qint64>(whole.size(), ZipReader::maxTailSize());
+    QVERIFY2(remote.openTail(whole.size(), whole.right(tailLen)), qPrintable(remote.errorString()));
+    QCOMPARE(remote.status(), ZipReader::Status::NotOpen);
+    QCOMPARE(remote.baseOffset(), local.baseOffset());
+
+    const QByteArray directory = whole.mid(remote.centralDirectoryOffset(),
+                                           remote.centralDirectorySize());
+    QVERIFY(remote.openCentralDirectory(directory));
+    QCOMPARE(remote.status(), ZipReader::Status::Ok);
+    QCOMPARE(remote.entries().size(), local.entries().size());
+    for (int i = 0; i < local.entries().size(); ++i) {
+        QCOMPARE(remote.entries().at(i).name, local.entries().at(i).name);
+        QCOMPARE(remote.entries().at(i).crc, local.entries().at(i).crc);
+        // Every entry's range starts at its header and stops before the
+        // directory.
+        QVERIFY(remote.entryHeaderOffset(remote.entries().at(i))
+                < remote.entryEnd(remote.entries().at(i)));
+        QVERIFY(remote.entryEnd(remote.entries().at(i)) <= remote.centralDirectoryOffset());
+    }
+
+    // Split archives are refused from the tail alone, before anything else is
+    // fetched.
+    const QByteArray split = contents(fixture("multipart.zip"));
+    ZipReader refused;
+    QVERIFY(!refused.openTail(split.size(),
+                              split.right(qMin<qint64>(split.size(), ZipReader::maxTailSize()))));
+    QCOMPARE(refused.status(), ZipReader::Status::MultiPart);
+}
+
+void TstGogZip::streamsAnEntryFromItsRange()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+
+    const QByteArray whole = contents(fixture("sfx-installer.sh"));
+    ZipReader reader;
+    QVERIFY(reader.open(fixture("sfx-installer.sh")));
+
+    for (const ZipReader::Entry& entry : reader.entries()) {
+        if (entry.isDirectory) {
+            continue;
+        }
+        // The entry's range, and the next entry's header after it as a
+        // range of several entries would have: the stream stops at its own end.
+        const qint64 begin = reader.entryHeaderOffset(entry);
+        const QByteArray range = whole.mid(begin, reader.entryEnd(entry) - begin + 64);
+
+        // A few bytes at a time, so the header and the data both arrive split.
+        const QString dest = dir.path() + "/" + QString::number(begin);
+        std::atomic<qint64> written{0};
+        ZipEntryStream stream(entry, entry.isSymlink ? QString() : dest, &written);
+        qint64 consumed = 0;
+        for (qint64 at = 0; at < range.size() && !stream.atEnd(); at += 7) {
+            consumed += stream.feed(range.constData() + at, qMin<qint64>(7, range.size() - at));
+        }
+        QVERIFY2(stream.finish().isNull(), qPrintable(entry.name));
+        QVERIFY(consumed <= reader.entryEnd(entry) - begin);
+
+        const QByteArray expected = reader.readEntry(entry);
+        if (entry.isSymlink) {
+            QCOMPARE(stream.content(), expected);
+            QVERIFY(!QFile::exists(dest));
+        } else {
+            QCOMPARE(contents(dest), expected);
+            QCOMPARE(written.load(), entry.uncompressedSize);
+            QCOMPARE(QFileInfo(dest).isExecutable(), entry.isExecutable());
+        }
+    }
+}
+
+void TstGogZip::streamRefusesAnEntryCutShort()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+
+    const QByteArray whole = contents(fixture("sfx-installer.sh"));
+    ZipReader reader;
+    QVERIFY(reader.open(fixture("sfx-installer.sh")));
+    const ZipReader::Entry entry = entryNamed(reader, "data/noarch/game/bin/game");
+
+    // A connection that dropped half-way through the entry.
+    const qint64 begin = reader.entryHeaderOffset(entry);
+    const QString dest = dir.path() + "/game";
+    {
+        ZipEntryStream stream(entry, dest);
+        stream.feed(whole.mid(begin, (reader.entryEnd(entry) - begin) / 2));
+        QVERIFY(!stream.atEnd());
+        const QString error = stream.finish();
+        QVERIFY2(error.contains("mid-entry"), qPrintable(error));
+    }
+    QVERIFY(!QFile::exists(dest));
+
+    // Dropped before finishing at all — cancelled — leaves nothing either.
+    {
+        ZipEntryStream stream(entry, dest);
+        stream.feed(whole.mid(begin, reader.entryEnd(entry) - begin));
+    }
+    QVERIFY(!QFile::exists(dest));
+    // Nor under the temporary name it was being written to.
+    QVERIFY(QDir(dir.path()).entryList(QDir::Files | QDir::Hidden).isEmpty());
+
+    // The wrong range: no local header where it should be.
+    ZipEntryStream stream(entry, dest);
+    stream.feed(whole.mid(begin + 1, 64));
+    QVERIFY(stream.atEnd());
+    QVERIFY2(stream.finish().contains("local header"), "a misplaced range was accepted");
+}
+
 void TstGogZip::refusesNamesThatEscape_data()
 {
     QTest::addColumn<QString>("name");
@@ -326,6 +617,41 @@ void TstGogZip::rejectsDataThatUnpacksCleanlyButIsWrong()
     QVERIFY(!QFile::exists(dest));
 }
 
+void TstGogZip::checksAZeroChecksumLikeAnyOther()
+{
+    // Zero is a CRC like any other — an empty file's — and not a sign that the
+    // archive left it out: the central directory always has the real one, even
+    // for an entry whose local header defers it to a data descriptor. Skipped
+    // on zero, an entry damaged there too would go through unchecked.
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+
+    const QByteArray whole = contents(fixture("sfx-installer.sh"));
+    ZipReader reader;
+    QVERIFY(reader.open(fixture("sfx-installer.sh")));
+
+    for (const QString& name : {QStringLiteral("data/noarch/game/data/stored.dat"),
+                                QStringLiteral("data/noarch/start.sh")}) {
+        ZipReader::Entry entry = entryNamed(reader, name);
+        QVERIFY(entry.crc != 0);
+        entry.crc = 0;
+
+        QString error;
+        const QString dest = dir.path() + "/extracted";
+        QVERIFY2(!reader.extractEntry(entry, dest, &error), qPrintable(name));
+        QVERIFY2(error.contains("checksum"), qPrintable(error));
+        QVERIFY(!QFile::exists(dest));
+
+        const qint64 begin = reader.entryHeaderOffset(entry);
+        const QByteArray range = whole.mid(begin, reader.entryEnd(entry) - begin);
+        const QString streamed = dir.path() + "/streamed";
+        ZipEntryStream stream(entry, streamed);
+        stream.feed(range.constData(), range.size());
+        QVERIFY2(stream.finish().contains("checksum"), qPrintable(name));
+        QVERIFY(!QFile::exists(streamed));
+    }
+}
+
 void TstGogZip::refusesThingsThatAreNotArchives_data()
 {
     QTest::addColumn<QByteArray>("content");
@@ -0,0 +1,317 @@
+// Cover art held in memory at the sizes drawn, within a byte budget.
+//
+// What must hold:
+//   A cover is decoded straight at the size asked for, its aspect kept; the
+//     views never rescale it on paint.
+//   Until it is decoded, getImage() answers with a placeholder and
+//     findImage() with nothing; imageReady() says when to ask again.
+//   Each size is cached on its own; the least recently drawn leaves memory
+//     first once the budget is spent.
+//   A size once decoded comes back from the thumbnail store at once, in this
+//     session or the next, with no decode.
+//   What downloads but does not decode is a failure, and is not kept.
+//   Only a few downloads run at once. Of those waiting, what a view shows
+//     goes first, then the newest ask. One a view stopped showing is dropped.
+//   A failure is retried once its backoff is over, not before; the backoff
+//     doubles, starts later for a URL that is not there, and is capped.
+//
+// Sources are file:// URLs: the same code path as a download, with no network.
+
+#include <QTest>
+#include <QBuffer>
+#include <QSignalSpy>
+#include <QTemporaryDir>
+#include <QUrl>
+
+#include "network/ImageCache.h"
+
+namespace {
+
+QByteArray encoded(const QSize& size, const char* format)
+{
+    QImage image(size, QImage::Format_RGB32);
+    image.fill(QColor(30, 120, 200));
+    QByteArray bytes;
+    QBuffer buffer(&bytes);
+    buffer.open(QIODevice::WriteOnly);
+    image.save(&buffer, format);
+    return bytes;
+}
+
+QString writeFile(const QTemporaryDir& dir, const QString& name, const QByteArray& bytes)
+{
+    const QString path = dir.filePath(name);
+    QFile file(path);
+    if (!file.open(QIODevice::WriteOnly)) {
+        return QString();
+    }
+    file.write(bytes);
+    return QUrl::fromLocalFile(path).toString();
+}
+
+} // namespace
+
+class TstImageCache : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void fitsInsideBounds_data();
+    void fitsInsideBounds();
+    void decodesAtTheFittedSize_data();
+    void decodesAtTheFittedSize();
+    void rejectsWhatIsNoImage();
+
+    void answersOnceDecoded();
+    void cachesEachSizeWithinTheBudget();
+    void remembersDrawnSizesAcrossSessions();
+    void failsOnWhatDoesNotDecode();
+
+    void backsOff_data();
+    void backsOff();
+    void schedulesVisibleFirstAndDropsWhatScrolledAway();
+    void retriesOnceTheBackoffIsOver();
+};
+
+void TstImageCache::fitsInsideBounds_data()
+{
+    QTest::addColumn<QSize>("original");
+    QTest::addColumn<QSize>("bounds");
+    QTest::addColumn<QSize>("expected");
+
+    QTest::newRow("wider") << QSize(460, 215) << QSize(120, 68) << QSize(120, 56);
+    QTest::newRow("taller") << QSize(600, 900) << QSize(120, 68) << QSize(45, 68);
+    QTest::newRow("same aspect") << QSize(920, 430) << QSize(230, 107) << QSize(228, 107);
+    QTest::newRow("no bounds") << QSize(460, 215) << QSize() << QSize(460, 215);
+    QTest::newRow("never vanishes") << QSize(4000, 10) << QSize(120, 68) << QSize(120, 1);
+}
+
+void TstImageCache::fitsInsideBounds()
+{
+    QFETCH(QSize, original);
+    QFETCH(QSize, bounds);
+    QFETCH(QSize, expected);
+    QCOMPARE(ImageCache::fittedSize(original, bounds), expected);
+}
+
+void TstImageCache::decodesAtTheFittedSize_data()
+{
+    QTest::addColumn<QByteArray>("format");
+    QTest::newRow("jpeg") << QByteArray("JPG");
+    QTest::newRow("png") << QByteArray("PNG");
+}
+
+void TstImageCache::decodesAtTheFittedSize()
+{
+    QFETCH(QByteArray, format);
+
+    QByteArray bytes = encoded(QSize(460, 215), format.constData());
+    QBuffer buffer(&bytes);
+    QVERIFY(buffer.open(QIODevice::ReadOnly));
+    QCOMPARE(ImageCache::decode(&buffer, QSize(120, 68)).size(), QSize(120, 56));
+
+    buffer.seek(0);
+    QCOMPARE(ImageCache::decode(&buffer, QSize()).size(), QSize(460, 215));
+}
+
+void TstImageCache::rejectsWhatIsNoImage()
+{
+    QByteArray bytes("<html>Not Found</html>");
+    QBuffer buffer(&bytes);
+    QVERIFY(buffer.open(QIODevice::ReadOnly));
+    QVERIFY(ImageCache::decode(&buffer, QSize(120, 68)).isNull());
+}
+
+void TstImageCache::answersOnceDecoded()
+{
+    QTemporaryDir sources;
+    QTemporaryDir cacheDir;
+    const QString url = writeFile(sources, "cover.png", encoded(QSize(460, 215), "PNG"));
+    QVERIFY(!url.isEmpty());
+
+    ImageCache cache(cacheDir.path());
+    QSignalSpy ready(&cache, &ImageCache::imageReady);
+
+    QVERIFY(cache.findImage(url, QSize(120, 68)).isNull());
+    QCOMPARE(cache.getImage(url, QSize(120, 68)).size(), QSize(120, 68));   // placeholder
+    QVERIFY(!cache.isReady(url, QSize(120, 68)));
+
+    QVERIFY(ready.wait());
+    QCOMPARE(ready.at(0).at(0).toString(), url);
+    QVERIFY(cache.isReady(url, QSize(120, 68)));
+    QVERIFY(cache.hasImage(url));
+    QCOMPARE(cache.findImage(url, QSize(120, 68)).size(), QSize(120, 56));
+    QVERIFY(cache.memoryUsed() > 0);
+}
+
+void TstImageCache::cachesEachSizeWithinTheBudget()
+{
+    QTemporaryDir sources;
+    QTemporaryDir cacheDir;
+    const QString url = writeFile(sources, "cover.png", encoded(QSize(460, 215), "PNG"));
+
+    ImageCache cache(cacheDir.path());
+    QSignalSpy ready(&cache, &ImageCache::imageReady);
+
+    const QSize list(120, 68);
+    const QSize details(230, 107);
+    cache.findImage(url, list);
+    QVERIFY(ready.wait());
+    cache.findImage(url, details);
+    QTRY_VERIFY(cache.isReady(url, details));
+    QVERIFY(cache.isReady(url, list));
+    QCOMPARE(cache.findImage(url, details).size(), QSize(228, 107));
+
+    // Room for the larger one only: the list size, drawn least recently, goes.
+    cache.findImage(url, details);
+    cache.setMemoryBudget(228 * 107 * 4);
+    QCOMPARE(cache.memoryUsed(), qint64(228 * 107 * 4));
+
+    // And comes back from the thumbnail store without a trip to the worker.
+    QCOMPARE(cache.findImage(url, list).size(), QSize(120, 56));
+    QCOMPARE(ready.count(), 2);
+}
+
+void TstImageCache::remembersDrawnSizesAcrossSessions()
+{
+    QTemporaryDir sources;
+    QTemporaryDir cacheDir;
+    const QString url = writeFile(sources, "cover.jpg", encoded(QSize(460, 215), "JPG"));
+
+    {
+        ImageCache cache(cacheDir.path());
+        QSignalSpy ready(&cache, &ImageCache::imageReady);
+        cache.findImage(url, QSize(120, 68));
+        QVERIFY(ready.wait());
+    }
+
+    ImageCache cache(cacheDir.path());
+    QVERIFY(cache.isReady(url, QSize(120, 68)));
+    QCOMPARE(cache.findImage(url, QSize(120, 68)).size(), QSize(120, 56));
+    QVERIFY(!cache.isReady(url, QSize(230, 107)));
+}
+
+void TstImageCache::failsOnWhatDoesNotDecode()
+{
+    QTemporaryDir sources;
+    QTemporaryDir cacheDir;
+    const QString url = writeFile(sources, "cover.jpg", "<html>Not Found</html>");
+
+    ImageCache cache(cacheDir.path());
+    QSignalSpy failed(&cache, &ImageCache::imageFailed);
+
+    QVERIFY(cache.findImage(url, QSize(120, 68)).isNull());
+    QVERIFY(failed.wait());
+    QVERIFY(cache.hasFailed(url));
+    QVERIFY(!cache.hasImage(url));
+
+    const QString missing = QUrl::fromLocalFile(sources.filePath("missing.jpg")).toString();
+    cache.findImage(missing, QSize(120, 68));
+    QVERIFY(failed.wait());
+    QVERIFY(cache.hasFailed(missing));
+}
+
+void TstImageCache::backsOff_data()
+{
+    QTest::addColumn<int>("failures");
+    QTest::addColumn<bool>("missing");
+    QTest::addColumn<qint64>("expected");
+
+    const qint64 first = 15000;
+    QTest::newRow("first") << 1 << false << first;
+    QTest::newRow("doubles") << 3 << false << 4 * first;
+    QTest::newRow("missing starts later") << 1 << true << 64 * first;
+    QTest::newRow("capped") << 30 << false << qint64(3600000);
+    QTest::newRow("capped, missing") << 60 << true << qint64(3600000);
+}
+
+void TstImageCache::backsOff()
+{
+    QFETCH(int, failures);
+    QFETCH(bool, missing);
+    QFETCH(qint64, expected);
+    QCOMPARE(ImageCache::retryDelay(failures, missing, 15000, 3600000), expected);
+}
+
+void TstImageCache::schedulesVisibleFirstAndDropsWhatScrolledAway()
+{
+    QTemporaryDir sources;
+    QTemporaryDir cacheDir;
+    const QByteArray cover = encoded(QSize(46, 21), "PNG");
+    QStringList urls;
+    for (int i = 0; i < 10; ++i) {
+        urls << writeFile(sources, QString("cover%1.png").arg(i), cover);
+    }
+
+    ImageCache cache(cacheDir.path());
+    QSignalSpy ready(&cache, &ImageCache::imageReady);
+    QObject view;
+    const QSize size(120, 68);
+
+    for (const QString& url : urls) {
+        cache.findImage(url, size);
+    }
+    QCOMPARE(cache.activeDownloads(), 4);
+    QCOMPARE(cache.queuedDownloads(),
+             (QStringList{urls[9], urls[8], urls[7], urls[6], urls[5], urls[4]}));
+
+    // On screen: first, whatever order it was asked in.
+    cache.setVisibleUrls(&view, {urls[5]});
+    QCOMPARE(cache.queuedDownloads().value(0), urls[5]);
+
+    // Scrolled away before its turn: dropped. Never shown: kept.
+    cache.setVisibleUrls(&view, {});
+    QVERIFY(!cache.queuedDownloads().contains(urls[5]));
+    QCOMPARE(cache.queuedDownloads().size(), 5);
+
+    // Still on another view's screen, a details panel's: kept.
+    QObject panel;
+    cache.setVisibleUrls(&view, {urls[6]});
+    cache.setVisibleUrls(&panel, {urls[6]});
+    cache.setVisibleUrls(&view, {});
+    QVERIFY(cache.queuedDownloads().contains(urls[6]));
+    cache.setVisibleUrls(&panel, {});
+    QVERIFY(!cache.queuedDownloads().contains(urls[6]));
+    QCOMPARE(cache.queuedDownloads().size(), 4);
+
+    // Asked for again while waiting: the newest ask.
+    cache.findImage(urls[4], size);
+    QCOMPARE(cache.queuedDownloads().value(0), urls[4]);
+
+    QTRY_COMPARE(ready.count(), 8);
+    QCOMPARE(cache.activeDownloads(), 0);
+    QVERIFY(!cache.isReady(urls[5], size));
+
+    // And back in view, it starts over.
+    cache.findImage(urls[5], size);
+    QTRY_VERIFY(cache.isReady(urls[5], size));
+}
+
+void TstImageCache::retriesOnceTheBackoffIsOver()
+{
+    QTemporaryDir sources;
+    QTemporaryDir cacheDir;
+    const QString url = QUrl::fromLocalFile(sources.filePath("late.png")).toString();
+
+    ImageCache cache(cacheDir.path());
+    cache.setRetryBackoff(200, 1000);
+    QSignalSpy ready(&cache, &ImageCache::imageReady);
+    QSignalSpy failed(&cache, &ImageCache::imageFailed);
+
+    cache.findImage(url, QSize(120, 68));
+    QVERIFY(failed.wait());
+    QVERIFY(cache.hasFailed(url));
+
+    // Still backing off: asking starts nothing.
+    QVERIFY(cache.findImage(url, QSize(120, 68)).isNull());
+    QCOMPARE(cache.activeDownloads() + cache.queuedDownloads().size(), 0);
+
+    writeFile(sources, "late.png", encoded(QSize(46, 21), "PNG"));
+    QTRY_VERIFY(!cache.hasFailed(url));
+    QVERIFY(cache.findImage(url, QSize(120, 68)).isNull());
+    QVERIFY(ready.wait());
+    QVERIFY(cache.isReady(url, QSize(120, 68)));
+}
+
+QTEST_MAIN(TstImageCache)
+#include "tst_imagecache.moc"
@@ -8,10 +8,18 @@
 // stamping of launcher identity onto discovered games.
 //
 // ILauncher has no Qt dependencies, which makes a fake one three lines of work.
+//
+// The asynchronous discovery gets the same questions plus its own: every
+// launcher's games reach the final list in registry order, and a launcher that
+// does not answer is given up on rather than waited for — keeping what it had
+// streamed — and the rest of its games still arrive, late, when it finally does.
 
 #include <QTest>
+#include <QSemaphore>
 #include <QSignalSpy>
 
+#include <atomic>
+
 #include "launchers/LauncherManager.h"
 #include "launchers/ILauncher.h"
 
@@ -33,15 +41,35 @@ public:
     QList<Game> discoverGames() override
     {
         ++m_discoverCalls;
+        if (m_gate) {
+            m_gate->acquire();
+        }
         return m_games;
     }
 
+    QList<Game> discoverGamesIncrementally(const GameBatchSink& batch) override
+    {
+        if (!m_streamedFirst.isEmpty() && batch) {
+            batch(m_streamedFirst);
+        }
+        QList<Game> games = discoverGames();
+        if (batch && m_streamedFirst.isEmpty() && !games.isEmpty()) {
+            batch(games);
+        }
+        return games;
+    }
+
     bool applySettings(const Game&, const DLSSSettings&) override { return false; }
     QString getLaunchCommand(const Game&, const DLSSSettings&) override { return QString(); }
 
     void setAvailable(bool available) { m_available = available; }
     void setGames(const QList<Game>& games) { m_games = games; }
     void setTraits(const LauncherTraits& traits) { m_traits = traits; }
+    // Discovery waits on `gate` before answering: a drive that will not wake.
+    void setGate(QSemaphore* gate) { m_gate = gate; }
+    // Streamed before discovery waits on the gate: the first library folder
+    // read before the drive stalled. Part of what setGames() answers with.
+    void setStreamedFirst(const QList<Game>& games) { m_streamedFirst = games; }
     int discoverCalls() const { return m_discoverCalls; }
 
 private:
@@ -49,7 +77,9 @@ private:
     bool m_available;
     LauncherTraits m_traits;
     QList<Game> m_games;
-    int m_discoverCalls = 0;
+    QList<Game> m_streamedFirst;
+    QSemaphore* m_gate = nullptr;
+    std::atomic<int> m_discoverCalls{0};   // discovery may run on a worker
 };
 
 } // namespace
@@ -68,6 +98,13 @@ private slots:
     void availabilityChangedOnlyFiresOnAnActualChange();
     void availabilityChangedFiresWhenALauncherGoesAway();
 
+    void asyncDiscoveryFinishesWithEveryLauncherInOrder();
+    void asyncDiscoveryStampsItsBatches();
+    void asyncDiscoveryWithNothingToAskStillFinishes();
+    void aLauncherThatDoesNotAnswerIsLeftBehind();
+    void aLauncherThatTimesOutKeepsWhatItStreamed();
+    void aLauncherStillBusyAnswersTheNextDiscovery();
+
 private:
     LauncherManager& manager() { return LauncherManager::instance(); }
 
@@ -190,5 +227,152 @@ void TstLauncherManager::availabilityChangedFiresWhenALauncherGoesAway()
     QVERIFY2(manager().launcher("GOG") != nullptr, "it is still registered, just not usable");
 }
 
+void TstLauncherManager::asyncDiscoveryFinishesWithEveryLauncherInOrder()
+{
+    auto steam = std::make_shared<FakeLauncher>("Steam", true);
+    auto gog = std::make_shared<FakeLauncher>("GOG", true);
+    steam->setGames({Game("1", "First", QString()), Game("2", "Second", QString())});
+    gog->setGames({Game("3", "Third", QString())});
+    manager().registerLauncher(steam);
+    manager().registerLauncher(gog);
+
+    QSignalSpy finished(&manager(), &LauncherManager::discoveryFinished);
+    const quint64 generation = manager().discoverAllGamesAsync();
+    QVERIFY(finished.wait());
+
+    QCOMPARE(finished.count(), 1);
+    QCOMPARE(finished.first().at(0).value<quint64>(), generation);
+    // Whichever worker answered first, the list is the registry's order.
+    const auto games = finished.first().at(1).value<QList<Game>>();
+    QCOMPARE(games.size(), 3);
+    QCOMPARE(games.at(0).name(), QStringLiteral("First"));
+    QCOMPARE(games.at(2).name(), QStringLiteral("Third"));
+    QVERIFY(finished.first().at(2).toStringList().isEmpty());
+}
+
+void TstLauncherManager::asyncDiscoveryStampsItsBatches()
+{
+    LauncherTraits traits;
+    traits.usesSteamEnv = true;
+    auto launcher = std::make_shared<FakeLauncher>("Steam", true);
+    launcher->setTraits(traits);
+    launcher->setGames({Game("1245620", "ELDEN RING", QString())});
+    manager().registerLauncher(launcher);
+
+    QSignalSpy batches(&manager(), &LauncherManager::gamesBatchDiscovered);
+    QSignalSpy finished(&manager(), &LauncherManager::discoveryFinished);
+    manager().discoverAllGamesAsync();
+    QVERIFY(finished.wait());
+
+    // A batch lands in the list as it is, so it has to be as finished a game
+    // as the final list's.
+    QCOMPARE(batches.count(), 1);
+    const auto games = batches.first().at(1).value<QList<Game>>();
+    QCOMPARE(games.first().settingsKey(), QStringLiteral("Steam:1245620"));
+    QVERIFY(games.first().traits().usesSteamEnv);
+}
+
+void TstLauncherManager::asyncDiscoveryWithNothingToAskStillFinishes()
+{
+    manager().registerLauncher(std::make_shared<FakeLauncher>("GOG", false));
+
+    // The window's "Looking for games..." has to end even on a machine with no
+    // store at all.
+    QSignalSpy finished(&manager(), &LauncherManager::discoveryFinished);
+    manager().discoverAllGamesAsync();
+    QVERIFY(finished.wait());
+    QVERIFY(finished.first().at(1).value<QList<Game>>().isEmpty());
+}
+
+void TstLauncherManager::aLauncherThatDoesNotAnswerIsLeftBehind()
+{
+    QSemaphore gate;
+    auto steam = std::make_shared<FakeLauncher>("Steam", true);
+    auto gog = std::make_shared<FakeLauncher>("GOG", true);
+    steam->setGames({Game("1", "On the sleeping drive", QString())});
+    steam->setGate(&gate);
+    gog->setGames({Game("2", "Right here", QString())});
+    manager().registerLauncher(steam);
+    manager().registerLauncher(gog);
+    manager().setDiscoveryTimeout(100);
+
+    QSignalSpy batches(&manager(), &LauncherManager::gamesBatchDiscovered);
+    QSignalSpy finished(&manager(), &LauncherManager::discoveryFinished);
+    const quint64 generation = manager().discoverAllGamesAsync();
+    QVERIFY(finished.wait());
+
+    const auto games = finished.first().at(1).value<QList<Game>>();
+    QCOMPARE(games.size(), 1);
+    QCOMPARE(games.first().name(), QStringLiteral("Right here"));
+    QCOMPARE(finished.first().at(2).toStringList(), QStringList{"Steam"});
+
+    // The drive wakes up: its games are not lost, they are late.
+    batches.clear();
+    gate.release();
+    QTRY_COMPARE(batches.count(), 1);
+    QCOMPARE(batches.first().at(0).value<quint64>(), generation);
+    QCOMPARE(batches.first().at(1).value<QList<Game>>().first().name(),
+             QStringLiteral("On the sleeping drive"));
+}
+
+void TstLauncherManager::aLauncherThatTimesOutKeepsWhatItStreamed()
+{
+    QSemaphore gate;
+    const Game first("1", "Read before the stall", QString());
+    const Game rest("2", "Read after it", QString());
+    auto steam = std::make_shared<FakeLauncher>("Steam", true);
+    steam->setStreamedFirst({first});
+    steam->setGames({first, rest});
+    steam->setGate(&gate);
+    manager().registerLauncher(steam);
+    manager().setDiscoveryTimeout(100);
+
+    QSignalSpy batches(&manager(), &LauncherManager::gamesBatchDiscovered);
+    QSignalSpy finished(&manager(), &LauncherManager::discoveryFinished);
+    manager().discoverAllGamesAsync();
+    QVERIFY(finished.wait());
+
+    // What was on screen when it was given up on stays in the list.
+    const auto games = finished.first().at(1).value<QList<Game>>();
+    QCOMPARE(games.size(), 1);
+    QCOMPARE(games.first().name(), first.name());
+    QCOMPARE(finished.first().at(2).toStringList(), QStringList{"Steam"});
+
+    // The late answer adds only what the list does not have yet.
+    batches.clear();
+    gate.release();
+    QTRY_COMPARE(batches.count(), 1);
+    const auto late = batches.first().at(1).value<QList<Game>>();
+    QCOMPARE(late.size(), 1);
+    QCOMPARE(late.first().name(), rest.name());
+}
+
+void TstLauncherManager::aLauncherStillBusyAnswersTheNextDiscovery()
+{
+    QSemaphore gate;
+    auto steam = std::make_shared<FakeLauncher>("Steam", true);
+    steam->setGames({Game("1", "On the sleeping drive", QString())});
+    steam->setGate(&gate);
+    manager().registerLauncher(steam);
+    manager().setDiscoveryTimeout(100);
+
+    QSignalSpy finished(&manager(), &LauncherManager::discoveryFinished);
+    manager().discoverAllGamesAsync();
+    QVERIFY(finished.wait());
+    QCOMPARE(finished.first().at(2).toStringList(), QStringList{"Steam"});
+
+    // Asked again while the first walk still hangs: not asked twice, and not
+    // given up on before it had its own timeout to answer in.
+    manager().setDiscoveryTimeout(5000);
+    finished.clear();
+    const quint64 generation = manager().discoverAllGamesAsync();
+    gate.release();
+    QVERIFY(finished.wait());
+    QCOMPARE(finished.first().at(0).value<quint64>(), generation);
+    QCOMPARE(finished.first().at(1).value<QList<Game>>().size(), 1);
+    QVERIFY(finished.first().at(2).toStringList().isEmpty());
+    QCOMPARE(steam->discoverCalls(), 1);
+}
+
 QTEST_MAIN(TstLauncherManager)
 #include "tst_launchermanager.moc"
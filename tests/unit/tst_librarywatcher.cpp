@@ -0,0 +1,190 @@
+// LibraryWatcher replaced a 60-second timer that re-parsed every manifest in
+// every library. What it has to get right is the part the timer got right by
+// brute force:
+//
+//   A changed file is read again, and nothing else is.
+//   A file that went away is a removal, keyed the way the list keys games.
+//   A change the launcher cannot put down to one game asks for a rediscovery.
+//
+// The fallback poll is driven by hand here. It goes down the same path as an
+// inotify event, and unlike inotify it is there in every sandbox a test runs in.
+
+#include <QTest>
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QSignalSpy>
+#include <QTemporaryDir>
+
+#include <atomic>
+
+#include "launchers/LibraryWatcher.h"
+#include "launchers/ILauncher.h"
+
+namespace {
+
+// One game per file: game_<id>.txt, its name the file's contents. Without
+// patterns it watches a directory for its entries alone, and has nothing to
+// say about a change there but the default: rediscover.
+class FakeLauncher : public ILauncher
+{
+public:
+    FakeLauncher(QString name, QString directory, QStringList patterns)
+        : m_name(std::move(name))
+        , m_directory(std::move(directory))
+        , m_patterns(std::move(patterns))
+    {
+    }
+
+    QString name() const override { return m_name; }
+    bool isAvailable() const override { return true; }
+    QList<Game> discoverGames() override { return {}; }
+    bool applySettings(const Game&, const DLSSSettings&) override { return false; }
+    QString getLaunchCommand(const Game&, const DLSSSettings&) override { return QString(); }
+
+    WatchSet watchSet() const override
+    {
+        WatchSet set;
+        set.directories = {m_directory};
+        set.filePatterns = m_patterns;
+        return set;
+    }
+
+    WatchVerdict gameAt(const QString& path, Game* game) const override
+    {
+        ++m_reads;
+        if (m_patterns.isEmpty()) {
+            return ILauncher::gameAt(path, game);
+        }
+        const QString fileName = path.mid(path.lastIndexOf('/') + 1);
+        game->setId(fileName.mid(5).chopped(4));
+        QFile file(path);
+        if (!file.open(QIODevice::ReadOnly)) {
+            return WatchVerdict::Removed;
+        }
+        game->setName(QString::fromUtf8(file.readAll()));
+        return WatchVerdict::Updated;
+    }
+
+    int reads() const { return m_reads; }
+
+private:
+    QString m_name;
+    QString m_directory;
+    QStringList m_patterns;
+    mutable std::atomic<int> m_reads{0};
+};
+
+void write(const QString& path, const QByteArray& content, int secondsAgo)
+{
+    QFile file(path);
+    QVERIFY(file.open(QIODevice::WriteOnly));
+    file.write(content);
+    // mtimes are what the poll compares; make the change unmistakable even
+    // on a filesystem with coarse ones.
+    QVERIFY(file.setFileTime(QDateTime::currentDateTime().addSecs(-secondsAgo),
+                             QFileDevice::FileModificationTime));
+}
+
+} // namespace
+
+class TstLibraryWatcher : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void init();
+
+    void leavesUnchangedFilesAlone();
+    void rereadsOnlyTheFileThatChanged();
+    void reportsAGameThatArrived();
+    void reportsAGameThatWentAway();
+    void aChangeItCannotPlaceIsARediscovery();
+
+private:
+    QString root() const { return m_root->path(); }
+
+    std::unique_ptr<QTemporaryDir> m_root;
+    std::shared_ptr<FakeLauncher> m_launcher;
+    std::shared_ptr<FakeLauncher> m_store;
+    std::unique_ptr<LibraryWatcher> m_watcher;
+};
+
+void TstLibraryWatcher::init()
+{
+    m_root = std::make_unique<QTemporaryDir>();
+    QVERIFY(m_root->isValid());
+    QVERIFY(QDir().mkpath(root() + "/manifests"));
+    QVERIFY(QDir().mkpath(root() + "/installs"));
+    write(root() + "/manifests/game_1.txt", "One", 100);
+    write(root() + "/manifests/game_2.txt", "Two", 100);
+    write(root() + "/manifests/notes.md", "not a game", 100);
+
+    m_launcher = std::make_shared<FakeLauncher>("Fake", root() + "/manifests",
+                                                QStringList{"game_*.txt"});
+    m_store = std::make_shared<FakeLauncher>("Store", root() + "/installs", QStringList());
+    m_watcher = std::make_unique<LibraryWatcher>();
+    m_watcher->setSettleDelay(0);
+    m_watcher->watch({m_launcher, m_store});
+}
+
+void TstLibraryWatcher::leavesUnchangedFilesAlone()
+{
+    QSignalSpy changed(m_watcher.get(), &LibraryWatcher::gamesChanged);
+    m_watcher->poll();
+    QTest::qWait(50);
+
+    QCOMPARE(changed.count(), 0);
+    QCOMPARE(m_launcher->reads(), 0);
+    QCOMPARE(m_store->reads(), 0);
+}
+
+void TstLibraryWatcher::rereadsOnlyTheFileThatChanged()
+{
+    QSignalSpy changed(m_watcher.get(), &LibraryWatcher::gamesChanged);
+    write(root() + "/manifests/game_2.txt", "Two, patched", 10);
+    m_watcher->poll();
+
+    QTRY_COMPARE(changed.count(), 1);
+    const auto updated = changed.first().at(0).value<QList<Game>>();
+    QCOMPARE(updated.size(), 1);
+    QCOMPARE(updated.first().settingsKey(), QStringLiteral("Fake:2"));
+    QCOMPARE(updated.first().name(), QStringLiteral("Two, patched"));
+    QCOMPARE(m_launcher->reads(), 1);
+}
+
+void TstLibraryWatcher::reportsAGameThatArrived()
+{
+    QSignalSpy changed(m_watcher.get(), &LibraryWatcher::gamesChanged);
+    write(root() + "/manifests/game_3.txt", "Three", 10);
+    m_watcher->poll();
+
+    QTRY_COMPARE(changed.count(), 1);
+    const auto updated = changed.first().at(0).value<QList<Game>>();
+    QCOMPARE(updated.size(), 1);
+    QCOMPARE(updated.first().settingsKey(), QStringLiteral("Fake:3"));
+}
+
+void TstLibraryWatcher::reportsAGameThatWentAway()
+{
+    QSignalSpy changed(m_watcher.get(), &LibraryWatcher::gamesChanged);
+    QVERIFY(QFile::remove(root() + "/manifests/game_1.txt"));
+    m_watcher->poll();
+
+    QTRY_COMPARE(changed.count(), 1);
+    QVERIFY(changed.first().at(0).value<QList<Game>>().isEmpty());
+    QCOMPARE(changed.first().at(1).toStringList(), QStringList{"Fake:1"});
+}
+
+void TstLibraryWatcher::aChangeItCannotPlaceIsARediscovery()
+{
+    QSignalSpy rediscover(m_watcher.get(), &LibraryWatcher::rediscoveryNeeded);
+    QVERIFY(QDir().mkpath(root() + "/installs/Some Game"));
+    m_watcher->poll();
+
+    QTRY_COMPARE(rediscover.count(), 1);
+    QCOMPARE(m_launcher->reads(), 0);
+}
+
+QTEST_MAIN(TstLibraryWatcher)
+#include "tst_librarywatcher.moc"
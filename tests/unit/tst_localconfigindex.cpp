@@ -0,0 +1,196 @@
+// Every user's launch options, read once per version of each localconfig.vdf.
+//
+// What must hold:
+//   An app's answer is its own LaunchOptions — not one from a nested block of
+//     the same name, and whatever casing this Steam uses on the way down.
+//   With several users, the first in directory order with non-empty options
+//     wins, as the per-game read always had it.
+//   A file is read again when its size or mtime moves, and only then; a
+//     writer can make it forget one file outright.
+//   A file that will not parse answers nothing rather than half an answer.
+
+#include <QTest>
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QTemporaryDir>
+
+#include "launchers/LocalConfigIndex.h"
+
+namespace {
+
+QByteArray config(const QByteArray& apps, const QByteArray& appsKey = "apps")
+{
+    return "\"UserLocalConfigStore\"\n{\n"
+           "\t\"Software\"\n\t{\n\t\t\"Valve\"\n\t\t{\n\t\t\t\"Steam\"\n\t\t\t{\n"
+           "\t\t\t\t\"" + appsKey + "\"\n\t\t\t\t{\n"
+           + apps
+           + "\t\t\t\t}\n\t\t\t}\n\t\t}\n\t}\n}\n";
+}
+
+QByteArray app(const QByteArray& appId, const QByteArray& body)
+{
+    return "\"" + appId + "\"\n{\n" + body + "}\n";
+}
+
+bool writeConfig(const QString& userData, const QString& userId, const QByteArray& content,
+                 const QDateTime& mtime)
+{
+    const QString dir = userData + "/" + userId + "/config";
+    if (!QDir().mkpath(dir)) {
+        return false;
+    }
+    QFile file(dir + "/localconfig.vdf");
+    if (!file.open(QIODevice::WriteOnly) || file.write(content) != content.size()) {
+        return false;
+    }
+    return file.setFileTime(mtime, QFileDevice::FileModificationTime);
+}
+
+} // namespace
+
+class TstLocalConfigIndex : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void readsEachAppsOwnOptions();
+    void followsEveryCasing();
+    void keepsTheFirstOfADuplicate();
+    void answersNothingForAnUnreadableFile_data();
+    void answersNothingForAnUnreadableFile();
+
+    void theFirstUserWithOptionsWins();
+    void rereadsAFileThatChanged();
+    void forgetsAFileWhenTold();
+    void answersNothingWithoutUserData();
+};
+
+void TstLocalConfigIndex::readsEachAppsOwnOptions()
+{
+    const QByteArray content = config(
+        app("570", "\"LastPlayed\" \"1\"\n\"LaunchOptions\" \"-novid\"\n")
+        + app("1245620", "\"BadgeData\"\n{\n\"LaunchOptions\" \"nested\"\n}\n")
+        + app("220", "\"LaunchOptions\" \"WINEDLLOVERRIDES=\\\"dxgi=n,b\\\" %command%\"\n"));
+
+    QString error;
+    const QHash<QString, QString> options = LocalConfigIndex::parse(content, &error);
+    QVERIFY2(error.isEmpty(), qPrintable(error));
+    QCOMPARE(options.size(), 2);
+    QCOMPARE(options.value("570"), QString("-novid"));
+    QCOMPARE(options.value("220"), QString("WINEDLLOVERRIDES=\"dxgi=n,b\" %command%"));
+    QVERIFY(!options.contains("1245620"));
+}
+
+void TstLocalConfigIndex::followsEveryCasing()
+{
+    QByteArray content = config(app("570", "\"launchoptions\" \"-novid\"\n"), "Apps");
+    content.replace("\"Software\"", "\"software\"");
+    content.replace("\"Valve\"", "\"valve\"");
+
+    QCOMPARE(LocalConfigIndex::parse(content).value("570"), QString("-novid"));
+}
+
+void TstLocalConfigIndex::keepsTheFirstOfADuplicate()
+{
+    const QByteArray content = config(
+        app("570", "\"LaunchOptions\" \"first\"\n\"LaunchOptions\" \"second\"\n")
+        + app("570", "\"LaunchOptions\" \"third\"\n"));
+    QCOMPARE(LocalConfigIndex::parse(content).value("570"), QString("first"));
+}
+
+void TstLocalConfigIndex::answersNothingForAnUnreadableFile_data()
+{
+    QTest::addColumn<QByteArray>("content");
+
+    const QByteArray whole = config(app("570", "\"LaunchOptions\" \"-novid\"\n"));
+    QTest::newRow("stray brace") << "}\n" + whole;
+    QTest::newRow("unterminated string") << whole.left(whole.indexOf("-novid"));
+    QTest::newRow("garbage") << QByteArray("\x01\x02\x03", 3);
+}
+
+void TstLocalConfigIndex::answersNothingForAnUnreadableFile()
+{
+    QFETCH(QByteArray, content);
+
+    QString error;
+    QVERIFY(LocalConfigIndex::parse(content, &error).isEmpty());
+    QVERIFY(!error.isEmpty());
+}
+
+void TstLocalConfigIndex::theFirstUserWithOptionsWins()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    const QDateTime when = QDateTime::currentDateTime().addSecs(-3600);
+    QVERIFY(writeConfig(dir.path(), "100", config(app("570", "\"LaunchOptions\" \"\"\n")
+                                                  + app("220", "\"LaunchOptions\" \"-console\"\n")), when));
+    QVERIFY(writeConfig(dir.path(), "200", config(app("570", "\"LaunchOptions\" \"-novid\"\n")
+                                                  + app("220", "\"LaunchOptions\" \"-other\"\n")), when));
+
+    LocalConfigIndex index(dir.path());
+    QCOMPARE(index.launchOptions("570"), QString("-novid"));
+    QCOMPARE(index.launchOptions("220"), QString("-console"));
+    QVERIFY(index.launchOptions("440").isEmpty());
+
+    const QHash<QString, QString> all = index.allLaunchOptions();
+    QCOMPARE(all.size(), 2);
+    QCOMPARE(all.value("570"), QString("-novid"));
+    QCOMPARE(all.value("220"), QString("-console"));
+}
+
+void TstLocalConfigIndex::rereadsAFileThatChanged()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    const QDateTime when = QDateTime::currentDateTime().addSecs(-3600);
+    QVERIFY(writeConfig(dir.path(), "100", config(app("570", "\"LaunchOptions\" \"-a\"\n")), when));
+
+    LocalConfigIndex index(dir.path());
+    QCOMPARE(index.launchOptions("570"), QString("-a"));
+
+    // Same size and mtime: not read again, so the old answer stands.
+    QVERIFY(writeConfig(dir.path(), "100", config(app("570", "\"LaunchOptions\" \"-b\"\n")), when));
+    QCOMPARE(index.launchOptions("570"), QString("-a"));
+
+    // Steam writes it on exit: the mtime moves, and so does the answer.
+    QVERIFY(writeConfig(dir.path(), "100", config(app("570", "\"LaunchOptions\" \"-b\"\n")),
+                        when.addSecs(60)));
+    QCOMPARE(index.launchOptions("570"), QString("-b"));
+
+    // And a user's file going away takes its options with it.
+    QVERIFY(QFile::remove(dir.path() + "/100/config/localconfig.vdf"));
+    QVERIFY(index.launchOptions("570").isEmpty());
+}
+
+void TstLocalConfigIndex::forgetsAFileWhenTold()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    const QDateTime when = QDateTime::currentDateTime().addSecs(-3600);
+    const QString path = dir.path() + "/100/config/localconfig.vdf";
+    QVERIFY(writeConfig(dir.path(), "100", config(app("570", "\"LaunchOptions\" \"-a\"\n")), when));
+
+    LocalConfigIndex index(dir.path());
+    QCOMPARE(index.launchOptions("570"), QString("-a"));
+
+    QVERIFY(writeConfig(dir.path(), "100", config(app("570", "\"LaunchOptions\" \"-b\"\n")), when));
+    index.invalidate(path);
+    QCOMPARE(index.launchOptions("570"), QString("-b"));
+}
+
+void TstLocalConfigIndex::answersNothingWithoutUserData()
+{
+    LocalConfigIndex none(QStringLiteral(""));
+    QVERIFY(none.launchOptions("570").isEmpty());
+    QVERIFY(none.allLaunchOptions().isEmpty());
+
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    QVERIFY(QDir().mkpath(dir.path() + "/100/config"));
+    LocalConfigIndex empty(dir.path());
+    QVERIFY(empty.allLaunchOptions().isEmpty());
+}
+
+QTEST_MAIN(TstLocalConfigIndex)
+#include "tst_localconfigindex.moc"
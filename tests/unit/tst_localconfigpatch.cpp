@@ -0,0 +1,236 @@
+// Writing LaunchOptions into Steam's localconfig.vdf.
+//
+// The file is Steam's, and it holds every game's settings, so:
+//   Nothing but the values being written may change — every other byte comes
+//     out as it went in, comments and odd spacing included.
+//   The app's own LaunchOptions is the one written, wherever its nested blocks
+//     sit and whatever casing this Steam uses on the way down.
+//   A game with no section yet gets one; one with a section but no options
+//     gets the key added inside it.
+//   Anything it cannot make sense of is left unwritten and reported.
+// What is written has to read back, through the same reader the app uses.
+
+#include <QTest>
+#include <QDateTime>
+#include <QFile>
+#include <QFileInfo>
+#include <QTemporaryDir>
+
+#include "launchers/LocalConfigPatch.h"
+#include "parsers/VDFDocument.h"
+#include "parsers/VDFQuery.h"
+
+namespace {
+
+const QByteArray kConfig =
+    "\"UserLocalConfigStore\"\n"
+    "{\n"
+    "\t\"friends\"\n"
+    "\t{\n"
+    "\t\t\"apps\"\t\"{ not this one }\"\n"
+    "\t}\n"
+    "\t\"Software\"\n"
+    "\t{\n"
+    "\t\t\"Valve\"\n"
+    "\t\t{\n"
+    "\t\t\t\"Steam\"\n"
+    "\t\t\t{\n"
+    "\t\t\t\t// a comment Steam never writes, kept anyway\n"
+    "\t\t\t\t\"apps\"\n"
+    "\t\t\t\t{\n"
+    "\t\t\t\t\t\"570\"\n"
+    "\t\t\t\t\t{\n"
+    "\t\t\t\t\t\t\"LastPlayed\"\t\t\"1700000000\"\n"
+    "\t\t\t\t\t\t\"LaunchOptions\"\t\t\"-novid\"\n"
+    "\t\t\t\t\t}\n"
+    "\t\t\t\t\t\"1245620\"\n"
+    "\t\t\t\t\t{\n"
+    "\t\t\t\t\t\t\"BadgeData\"\n"
+    "\t\t\t\t\t\t{\n"
+    "\t\t\t\t\t\t\t\"LaunchOptions\"\t\t\"nested, not ours\"\n"
+    "\t\t\t\t\t\t}\n"
+    "\t\t\t\t\t\t\"Playtime\"\t\t\"12\"\n"
+    "\t\t\t\t\t}\n"
+    "\t\t\t\t}\n"
+    "\t\t\t}\n"
+    "\t\t}\n"
+    "\t}\n"
+    "}\n";
+
+QString readBack(const QByteArray& content, const QString& appId)
+{
+    const QString path = "UserLocalConfigStore/Software/Valve/Steam/apps/" + appId + "/LaunchOptions";
+    VDFQuery query({path}, Qt::CaseInsensitive);
+    if (!query.run(content)) {
+        return QStringLiteral("<unreadable>");
+    }
+    return query.value(path);
+}
+
+} // namespace
+
+class TstLocalConfigPatch : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void replacesOnlyTheValue();
+    void addsTheKeyToASectionWithoutIt();
+    void createsAMissingSection();
+    void writesManyAppsInOnePass();
+    void followsEveryCasing();
+    void escapesWhatItWrites();
+    void quotesABareValue();
+    void refusesWhatItCannotRead_data();
+    void refusesWhatItCannotRead();
+    void leavesAnUnchangedFileAlone();
+};
+
+void TstLocalConfigPatch::replacesOnlyTheValue()
+{
+    QByteArray content = kConfig;
+    QString error;
+    QVERIFY2(LocalConfigPatch::apply(&content, {{"570", "PROTON_ENABLE_HDR=1 %command%"}}, &error),
+             qPrintable(error));
+
+    QByteArray expected = kConfig;
+    expected.replace("\"-novid\"", "\"PROTON_ENABLE_HDR=1 %command%\"");
+    QCOMPARE(content, expected);
+}
+
+void TstLocalConfigPatch::addsTheKeyToASectionWithoutIt()
+{
+    QByteArray content = kConfig;
+    QVERIFY(LocalConfigPatch::apply(&content, {{"1245620", "-dx12"}}));
+
+    QCOMPARE(readBack(content, "1245620"), QString("-dx12"));
+    // Not inside BadgeData, whose own LaunchOptions stays as it was.
+    QVERIFY(content.contains("\"nested, not ours\""));
+    QVERIFY(content.contains("\t\t\t\t\t\t\"LaunchOptions\"\t\t\"-dx12\"\n\t\t\t\t\t}\n"));
+    QCOMPARE(readBack(content, "570"), QString("-novid"));
+}
+
+void TstLocalConfigPatch::createsAMissingSection()
+{
+    QByteArray content = kConfig;
+    QVERIFY(LocalConfigPatch::apply(&content, {{"220", "-console"}}));
+
+    QCOMPARE(readBack(content, "220"), QString("-console"));
+    QVERIFY(content.contains("\t\t\t\t\t\"220\"\n\t\t\t\t\t{\n"
+                             "\t\t\t\t\t\t\"LaunchOptions\"\t\t\"-console\"\n"
+                             "\t\t\t\t\t}\n\t\t\t\t}\n"));
+    // Everything before the insertion is as it was.
+    const qsizetype at = content.indexOf("\t\t\t\t\t\"220\"");
+    QCOMPARE(content.left(at), kConfig.left(at));
+}
+
+void TstLocalConfigPatch::writesManyAppsInOnePass()
+{
+    QHash<QString, QString> options;
+    options.insert("570", "-high");
+    options.insert("1245620", "-dx12");
+    for (int i = 0; i < 50; ++i) {
+        options.insert(QString::number(100000 + i), QString("-app%1").arg(i));
+    }
+
+    QByteArray content = kConfig;
+    QString error;
+    QVERIFY2(LocalConfigPatch::apply(&content, options, &error), qPrintable(error));
+
+    VDFDocument document;
+    QVERIFY2(document.parse(content), qPrintable(document.errorString()));
+    for (auto it = options.constBegin(); it != options.constEnd(); ++it) {
+        QCOMPARE(readBack(content, it.key()), it.value());
+    }
+    QCOMPARE(content.count("\"LaunchOptions\""), options.size() + 1);   // + BadgeData's
+
+    // And again over its own output changes nothing.
+    QByteArray again = content;
+    QVERIFY(LocalConfigPatch::apply(&again, options));
+    QCOMPARE(again, content);
+}
+
+void TstLocalConfigPatch::followsEveryCasing()
+{
+    QByteArray content = kConfig;
+    content.replace("\"Software\"", "\"software\"");
+    content.replace("\"Valve\"", "\"valve\"");
+    content.replace("\t\"apps\"\n", "\t\"Apps\"\n");
+    content.replace("\"LaunchOptions\"\t\t\"-novid\"", "\"launchoptions\"\t\t\"-novid\"");
+
+    QVERIFY(LocalConfigPatch::apply(&content, {{"570", "-high"}}));
+    QCOMPARE(readBack(content, "570"), QString("-high"));
+    QCOMPARE(content.toLower().count("\"launchoptions\""), 2);   // replaced, not added beside
+}
+
+void TstLocalConfigPatch::escapesWhatItWrites()
+{
+    const QString options = "WINEDLLOVERRIDES=\"dxgi=n,b\" C:\\game\t%command%";
+    QByteArray content = kConfig;
+    QVERIFY(LocalConfigPatch::apply(&content, {{"570", options}}));
+    QCOMPARE(readBack(content, "570"), options);
+}
+
+void TstLocalConfigPatch::quotesABareValue()
+{
+    QByteArray content = kConfig;
+    content.replace("\"LaunchOptions\"\t\t\"-novid\"", "LaunchOptions\t\tnovid");
+
+    QVERIFY(LocalConfigPatch::apply(&content, {{"570", "-high -console"}}));
+    QVERIFY(content.contains("\tLaunchOptions\t\t\"-high -console\"\n"));
+    QCOMPARE(readBack(content, "570"), QString("-high -console"));
+}
+
+void TstLocalConfigPatch::refusesWhatItCannotRead_data()
+{
+    QTest::addColumn<QByteArray>("content");
+
+    QTest::newRow("empty") << QByteArray();
+    QTest::newRow("no apps block") << QByteArray("\"UserLocalConfigStore\"\n{\n\t\"Software\"\n\t{\n\t}\n}\n");
+    QTest::newRow("cut short") << kConfig.left(kConfig.size() - 10);
+    QTest::newRow("stray brace") << kConfig + "}\n";
+    QTest::newRow("unterminated string") << kConfig.left(kConfig.indexOf("-novid"));
+}
+
+void TstLocalConfigPatch::refusesWhatItCannotRead()
+{
+    QFETCH(QByteArray, content);
+
+    QByteArray patched = content;
+    QString error;
+    QVERIFY(!LocalConfigPatch::apply(&patched, {{"570", "-high"}}, &error));
+    QVERIFY(!error.isEmpty());
+    QCOMPARE(patched, content);
+}
+
+void TstLocalConfigPatch::leavesAnUnchangedFileAlone()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    const QString path = dir.filePath("localconfig.vdf");
+    {
+        QFile file(path);
+        QVERIFY(file.open(QIODevice::WriteOnly));
+        file.write(kConfig);
+        QVERIFY(file.setFileTime(QDateTime::currentDateTime().addSecs(-3600),
+                                 QFileDevice::FileModificationTime));
+    }
+    const QDateTime before = QFileInfo(path).lastModified();
+
+    QVERIFY(LocalConfigPatch::applyToFile(path, {{"570", "-novid"}}));
+    QCOMPARE(QFileInfo(path).lastModified(), before);
+
+    QString error;
+    QVERIFY2(LocalConfigPatch::applyToFile(path, {{"570", "-high"}, {"220", "-console"}}, &error),
+             qPrintable(error));
+    QFile file(path);
+    QVERIFY(file.open(QIODevice::ReadOnly));
+    const QByteArray written = file.readAll();
+    QCOMPARE(readBack(written, "570"), QString("-high"));
+    QCOMPARE(readBack(written, "220"), QString("-console"));
+
+    QVERIFY(!LocalConfigPatch::applyToFile(dir.filePath("missing.vdf"), {{"570", "-high"}}, &error));
+}
+
+QTEST_MAIN(TstLocalConfigPatch)
+#include "tst_localconfigpatch.moc"
@@ -0,0 +1,219 @@
+// Installing Proton without an archive on disk.
+//
+// The download goes straight into tar, so the pieces that decide whether what
+// lands in compatibilitytools.d can be trusted are the ones tested here:
+//
+//   The checksum has to be found for the right file. A .sha512sum that lists
+//     several and is read for the first one fails every install, or worse,
+//     passes the wrong one.
+//   tar reads from a pipe, where it cannot sniff the compression, so the
+//     filter has to be named from the archive's name.
+//   A resumed body is only spliced on where its Content-Range says it starts,
+//     so that start has to be read right, and anything else read as none.
+//   The unpacked tree is renamed into place, and a failed rename must leave the
+//     installed version of the tool where it was.
+
+#include <QTest>
+#include <QDir>
+#include <QFile>
+#include <QTemporaryDir>
+
+#include "utils/ProtonInstallStream.h"
+
+namespace {
+
+const QByteArray kDigest =
+    "cf83e1357eefb8bdf1542850d66d8007d620e4050b5715dc83f4a921d36ce9ce"
+    "47d0d13c5d85f2b0ff8318d2877eec2f63b931bd47417a81a538327af927da3e";
+
+void makeTool(const QString& root, const QString& name, const QByteArray& marker)
+{
+    QDir().mkpath(root + "/" + name + "/files");
+    QFile proton(root + "/" + name + "/proton");
+    QVERIFY(proton.open(QIODevice::WriteOnly));
+    proton.write(marker);
+}
+
+QByteArray marker(const QString& toolDir)
+{
+    QFile proton(toolDir + "/proton");
+    return proton.open(QIODevice::ReadOnly) ? proton.readAll() : QByteArray();
+}
+
+} // namespace
+
+class TstProtonInstallStream : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void readsTheChecksumForTheArchive_data();
+    void readsTheChecksumForTheArchive();
+
+    void namesTheCompression_data();
+    void namesTheCompression();
+
+    void readsWhereAResumeStarts_data();
+    void readsWhereAResumeStarts();
+
+    void stagesOutOfSteamsSight();
+    void promotesANewTool();
+    void replacesAnInstalledTool();
+    void refusesAnEmptyArchive();
+    void restoresTheInstalledToolWhenTheMoveFails();
+};
+
+void TstProtonInstallStream::readsTheChecksumForTheArchive_data()
+{
+    QTest::addColumn<QByteArray>("text");
+    QTest::addColumn<QString>("expected");
+
+    const QString digest = QString::fromLatin1(kDigest);
+    QTest::newRow("sha512sum output")
+        << QByteArray(kDigest + "  GE-Proton9-20.tar.gz\n") << digest;
+    QTest::newRow("binary mode")
+        << QByteArray(kDigest + " *GE-Proton9-20.tar.gz\n") << digest;
+    QTest::newRow("with a path")
+        << QByteArray(kDigest + "  ./build/GE-Proton9-20.tar.gz\n") << digest;
+    QTest::newRow("upper case")
+        << QByteArray(kDigest.toUpper() + "  GE-Proton9-20.tar.gz\n") << digest;
+    QTest::newRow("bare digest") << QByteArray(kDigest + "\n") << digest;
+    QTest::newRow("among others")
+        << QByteArray(QByteArray(128, 'a') + "  GE-Proton9-20.tar.zst\n"
+                      + kDigest + "  GE-Proton9-20.tar.gz\n")
+        << digest;
+    QTest::newRow("only for another file")
+        << QByteArray(kDigest + "  GE-Proton9-19.tar.gz\n") << "";
+    QTest::newRow("a sha256") << QByteArray(QByteArray(64, 'a') + "  GE-Proton9-20.tar.gz\n")
+                              << "";
+    QTest::newRow("html") << QByteArray("<html>Not Found</html>") << "";
+    QTest::newRow("empty") << QByteArray() << "";
+}
+
+void TstProtonInstallStream::readsTheChecksumForTheArchive()
+{
+    QFETCH(QByteArray, text);
+    QFETCH(QString, expected);
+    QCOMPARE(ProtonInstallStream::parseSha512Sum(text, "GE-Proton9-20.tar.gz"), expected);
+}
+
+void TstProtonInstallStream::namesTheCompression_data()
+{
+    QTest::addColumn<QString>("fileName");
+    QTest::addColumn<QStringList>("arguments");
+
+    QTest::newRow("cachyos")
+        << "proton-cachyos-10.0-20250601-slr-x86_64.tar.xz"
+        << QStringList{"--extract", "--xz", "--file", "-"};
+    QTest::newRow("ge") << "GE-Proton9-20.tar.gz"
+                        << QStringList{"--extract", "--gzip", "--file", "-"};
+    QTest::newRow("zstd") << "tool.tar.zst"
+                          << QStringList{"--extract", "--zstd", "--file", "-"};
+    QTest::newRow("plain") << "tool.tar" << QStringList{"--extract", "--file", "-"};
+    QTest::newRow("checksum") << "GE-Proton9-20.sha512sum" << QStringList();
+    QTest::newRow("zip") << "tool.zip" << QStringList();
+}
+
+void TstProtonInstallStream::namesTheCompression()
+{
+    QFETCH(QString, fileName);
+    QFETCH(QStringList, arguments);
+    QCOMPARE(ProtonInstallStream::tarArguments(fileName), arguments);
+}
+
+void TstProtonInstallStream::readsWhereAResumeStarts_data()
+{
+    QTest::addColumn<QByteArray>("header");
+    QTest::addColumn<qint64>("start");
+
+    QTest::newRow("resume") << QByteArray("bytes 1048576-524287999/524288000") << qint64(1048576);
+    QTest::newRow("from zero") << QByteArray("bytes 0-99/100") << qint64(0);
+    QTest::newRow("unknown total") << QByteArray("bytes 500-999/*") << qint64(500);
+    QTest::newRow("padded") << QByteArray("  bytes 42-99/100 ") << qint64(42);
+    QTest::newRow("missing") << QByteArray() << qint64(-1);
+    QTest::newRow("unsatisfied") << QByteArray("bytes */100") << qint64(-1);
+    QTest::newRow("other unit") << QByteArray("items 0-9/10") << qint64(-1);
+    QTest::newRow("garbage") << QByteArray("bytes x-9/10") << qint64(-1);
+}
+
+void TstProtonInstallStream::readsWhereAResumeStarts()
+{
+    QFETCH(QByteArray, header);
+    QFETCH(qint64, start);
+    QCOMPARE(ProtonInstallStream::contentRangeStart(header), start);
+}
+
+void TstProtonInstallStream::stagesOutOfSteamsSight()
+{
+    const QString staging =
+        ProtonInstallStream::stagingPath("/compat", "GE-Proton9-20.tar.gz");
+    // Beside the tools, so the final move is a rename; hidden, so Steam does
+    // not list a half-unpacked one.
+    QCOMPARE(QFileInfo(staging).absolutePath(), QStringLiteral("/compat"));
+    QVERIFY(QFileInfo(staging).fileName().startsWith('.'));
+    QVERIFY(staging.endsWith("GE-Proton9-20"));
+}
+
+void TstProtonInstallStream::promotesANewTool()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    const QString compat = dir.path() + "/compatibilitytools.d";
+    const QString staging = ProtonInstallStream::stagingPath(compat, "GE-Proton9-20.tar.gz");
+    makeTool(staging, "GE-Proton9-20", "new");
+
+    QVERIFY(ProtonInstallStream::promoteStaged(staging, compat).isNull());
+    QCOMPARE(marker(compat + "/GE-Proton9-20"), QByteArray("new"));
+    QVERIFY(!QFileInfo::exists(staging + "/GE-Proton9-20"));
+}
+
+void TstProtonInstallStream::replacesAnInstalledTool()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    const QString compat = dir.path() + "/compatibilitytools.d";
+    makeTool(compat, "GE-Proton9-20", "old");
+    const QString staging = ProtonInstallStream::stagingPath(compat, "GE-Proton9-20.tar.gz");
+    makeTool(staging, "GE-Proton9-20", "new");
+
+    QVERIFY(ProtonInstallStream::promoteStaged(staging, compat).isNull());
+    QCOMPARE(marker(compat + "/GE-Proton9-20"), QByteArray("new"));
+
+    // Nothing left over beside it for Steam to offer.
+    QDir(staging).removeRecursively();
+    QCOMPARE(QDir(compat).entryList(QDir::Dirs | QDir::NoDotAndDotDot | QDir::Hidden),
+             QStringList{"GE-Proton9-20"});
+}
+
+void TstProtonInstallStream::refusesAnEmptyArchive()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    const QString compat = dir.path() + "/compatibilitytools.d";
+    makeTool(compat, "GE-Proton9-20", "old");
+    const QString staging = ProtonInstallStream::stagingPath(compat, "GE-Proton9-20.tar.gz");
+    QVERIFY(QDir().mkpath(staging));
+
+    QVERIFY(!ProtonInstallStream::promoteStaged(staging, compat).isNull());
+    QCOMPARE(marker(compat + "/GE-Proton9-20"), QByteArray("old"));
+}
+
+void TstProtonInstallStream::restoresTheInstalledToolWhenTheMoveFails()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    // A move no filesystem allows, whoever runs the test: the new tree into a
+    // directory inside itself.
+    const QString staging = dir.path() + "/staging";
+    makeTool(staging, "GE-Proton9-20", "new");
+    const QString compat = staging + "/GE-Proton9-20/files";
+    makeTool(compat, "GE-Proton9-20", "old");
+
+    QVERIFY(!ProtonInstallStream::promoteStaged(staging, compat).isNull());
+    QCOMPARE(marker(compat + "/GE-Proton9-20"), QByteArray("old"));
+    QCOMPARE(QDir(compat).entryList(QDir::Dirs | QDir::NoDotAndDotDot | QDir::Hidden),
+             QStringList{"GE-Proton9-20"});
+}
+
+QTEST_MAIN(TstProtonInstallStream)
+#include "tst_protoninstallstream.moc"
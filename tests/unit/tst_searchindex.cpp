@@ -0,0 +1,216 @@
+// What the library and store search boxes find, and in what order.
+//
+// What must hold:
+//   Titles are found without regard to case, accents, punctuation or
+//     apostrophes; by id or launcher name; by initials.
+//   An exact title ranks first, then a title that starts with the query, then
+//     one with a word that does, then one that merely contains it. Words in
+//     another order come after those, and titles within a typo or two last.
+//   A short word allows no typo: "gog" must not find "Doom".
+//   Nothing typed means everything, in the order given.
+//   Only the answer to the latest query is delivered.
+
+#include <QTest>
+#include <QSignalSpy>
+
+#include "core/SearchIndex.h"
+
+namespace {
+
+QList<SearchIndex::Document> library()
+{
+    return {
+        {"Steam:292030", "The Witcher 3: Wild Hunt", {"292030", "Steam"}},
+        {"GOG:1207664663", "The Witcher 3: Wild Hunt - Game of the Year Edition", {"1207664663", "GOG"}},
+        {"Steam:1086940", "Baldur's Gate 3", {"1086940", "Steam"}},
+        {"Steam:1174180", "Red Dead Redemption 2", {"1174180", "Steam"}},
+        {"Steam:379720", "DOOM", {"379720", "Steam"}},
+        {"Steam:1091500", "Cyberpunk 2077", {"1091500", "Steam"}},
+        {"GOG:1495134320", "Pokémon Mystery Dungeon", {"1495134320", "GOG"}},
+        {"Steam:20900", "The Witcher: Enhanced Edition", {"20900", "Steam"}},
+    };
+}
+
+} // namespace
+
+class TstSearchIndex : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void normalizes_data();
+    void normalizes();
+    void measuresPrefixDistance_data();
+    void measuresPrefixDistance();
+
+    void findsByTitleIdLauncherAndInitials_data();
+    void findsByTitleIdLauncherAndInitials();
+    void ranksCloserMatchesFirst();
+    void toleratesTyposInLongerWords();
+    void allowsNoTypoInShortWords();
+    void matchesEverythingWhenEmpty();
+
+    void deliversOnlyTheLatestAnswer();
+    void searchesTheNewestDocuments();
+};
+
+void TstSearchIndex::normalizes_data()
+{
+    QTest::addColumn<QString>("text");
+    QTest::addColumn<QString>("expected");
+
+    QTest::newRow("case and punctuation") << "The Witcher 3: Wild Hunt" << "the witcher 3 wild hunt";
+    QTest::newRow("accents") << "Pokémon Ōkami" << "pokemon okami";
+    QTest::newRow("apostrophes") << "Baldur's Gate, Assassin’s Creed" << "baldurs gate assassins creed";
+    QTest::newRow("symbols") << "  DOOM™ — Eternal®  " << "doom eternal";
+    QTest::newRow("compatibility forms") << "ＦＩＮＡＬ ＦＡＮＴＡＳＹ Ⅶ" << "final fantasy vii";
+    QTest::newRow("empty") << "" << "";
+    QTest::newRow("nothing searchable") << " - : " << "";
+}
+
+void TstSearchIndex::normalizes()
+{
+    QFETCH(QString, text);
+    QFETCH(QString, expected);
+    QCOMPARE(SearchIndex::normalize(text), expected);
+}
+
+void TstSearchIndex::measuresPrefixDistance_data()
+{
+    QTest::addColumn<QString>("query");
+    QTest::addColumn<QString>("word");
+    QTest::addColumn<int>("max");
+    QTest::addColumn<int>("expected");
+
+    QTest::newRow("prefix") << "witch" << "witcher" << 2 << 0;
+    QTest::newRow("substitution") << "wutcher" << "witcher" << 2 << 1;
+    QTest::newRow("swap") << "wticher" << "witcher" << 2 << 1;
+    QTest::newRow("missing letter") << "witcer" << "witcher" << 2 << 1;
+    QTest::newRow("extra letter") << "witchher" << "witcher" << 2 << 1;
+    QTest::newRow("typo in a prefix") << "cyberpnk" << "cyberpunk" << 2 << 1;
+    QTest::newRow("capped") << "zzzzzz" << "witcher" << 2 << 3;
+    QTest::newRow("empty query") << "" << "witcher" << 1 << 0;
+}
+
+void TstSearchIndex::measuresPrefixDistance()
+{
+    QFETCH(QString, query);
+    QFETCH(QString, word);
+    QFETCH(int, max);
+    QFETCH(int, expected);
+    QCOMPARE(SearchIndex::prefixDistance(query, word, max), expected);
+}
+
+void TstSearchIndex::findsByTitleIdLauncherAndInitials_data()
+{
+    QTest::addColumn<QString>("query");
+    QTest::addColumn<QString>("first");
+
+    QTest::newRow("title") << "cyberpunk" << "Steam:1091500";
+    QTest::newRow("accent folded") << "pokemon" << "GOG:1495134320";
+    QTest::newRow("apostrophe dropped") << "baldurs gate" << "Steam:1086940";
+    QTest::newRow("id") << "1174180" << "Steam:1174180";
+    QTest::newRow("launcher") << "gog" << "GOG:1207664663";
+    QTest::newRow("initials") << "rdr2" << "Steam:1174180";
+    QTest::newRow("short prefix") << "cy" << "Steam:1091500";
+}
+
+void TstSearchIndex::findsByTitleIdLauncherAndInitials()
+{
+    QFETCH(QString, query);
+    QFETCH(QString, first);
+
+    const SearchIndex index(library());
+    const QStringList keys = index.searchKeys(query);
+    QVERIFY2(!keys.isEmpty(), qPrintable(query));
+    QCOMPARE(keys.first(), first);
+}
+
+void TstSearchIndex::ranksCloserMatchesFirst()
+{
+    const SearchIndex index(library());
+
+    // Both Witcher 3s start with it; the first Witcher has no "3" at all.
+    // Order among equals is the order given.
+    QCOMPARE(index.searchKeys("the witcher 3"), (QStringList{"Steam:292030", "GOG:1207664663"}));
+    QCOMPARE(index.searchKeys("witcher 3"), (QStringList{"Steam:292030", "GOG:1207664663"}));
+
+    // The words in another order still find it.
+    QCOMPARE(index.searchKeys("hunt witcher"), (QStringList{"Steam:292030", "GOG:1207664663"}));
+
+    // An exact title beats a longer title that starts with it.
+    const SearchIndex doom({{"a", "DOOM Eternal", {}}, {"b", "DOOM", {}}});
+    QCOMPARE(doom.searchKeys("doom"), (QStringList{"b", "a"}));
+}
+
+void TstSearchIndex::toleratesTyposInLongerWords()
+{
+    const SearchIndex index(library());
+    QCOMPARE(index.searchKeys("cyberpnuk").value(0), QString("Steam:1091500"));
+    QCOMPARE(index.searchKeys("redemtpion").value(0), QString("Steam:1174180"));
+    QVERIFY(index.searchKeys("witcher3").contains("Steam:292030"));
+
+    // A typo ranks below the real thing.
+    const SearchIndex close({{"typo", "Witcher", {}}, {"exact", "Wticher", {}}});
+    QCOMPARE(close.searchKeys("wticher"), (QStringList{"exact", "typo"}));
+}
+
+void TstSearchIndex::allowsNoTypoInShortWords()
+{
+    const SearchIndex index(library());
+    QVERIFY(!index.searchKeys("gog").contains("Steam:379720"));
+    QVERIFY(index.searchKeys("dom").isEmpty());
+    QVERIFY(index.searchKeys("xyzzy").isEmpty());
+}
+
+void TstSearchIndex::matchesEverythingWhenEmpty()
+{
+    const SearchIndex index(library());
+    QCOMPARE(index.search(QString()), (QList<int>{0, 1, 2, 3, 4, 5, 6, 7}));
+    QCOMPARE(index.search(" :: ").size(), 8);
+    QVERIFY(SearchIndex().search("anything").isEmpty());
+}
+
+void TstSearchIndex::deliversOnlyTheLatestAnswer()
+{
+    AsyncSearch search;
+    search.setDelay(0);
+    search.setDocuments(library());
+    QSignalSpy spy(&search, &AsyncSearch::resultsReady);
+
+    search.setQuery("cyber");
+    search.setQuery("doom");
+    QVERIFY(spy.wait());
+    QCOMPARE(spy.count(), 1);
+    QCOMPARE(spy.at(0).at(0).toString(), QString("doom"));
+    QCOMPARE(spy.at(0).at(1).toStringList(), QStringList{"Steam:379720"});
+
+    // Clearing answers at once, with no filter.
+    spy.clear();
+    search.setQuery(QString());
+    QCOMPARE(spy.count(), 1);
+    QVERIFY(spy.at(0).at(0).toString().isEmpty());
+    QVERIFY(!search.isActive());
+}
+
+void TstSearchIndex::searchesTheNewestDocuments()
+{
+    AsyncSearch search;
+    search.setDelay(0);
+    search.setDocuments(library());
+    QSignalSpy spy(&search, &AsyncSearch::resultsReady);
+
+    search.setQuery("hades");
+    QVERIFY(spy.wait());
+    QVERIFY(spy.last().at(1).toStringList().isEmpty());
+
+    // A game arriving while a query stands is searched for at once.
+    QList<SearchIndex::Document> more = library();
+    more.append({"Steam:1145360", "Hades", {"1145360", "Steam"}});
+    search.setDocuments(more);
+    QVERIFY(spy.wait());
+    QCOMPARE(spy.last().at(1).toStringList(), QStringList{"Steam:1145360"});
+}
+
+QTEST_MAIN(TstSearchIndex)
+#include "tst_searchindex.moc"
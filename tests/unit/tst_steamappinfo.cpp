@@ -0,0 +1,399 @@
+// appinfo.vdf, read one app at a time through an index of where each app lies.
+//
+// What must hold:
+//   The index agrees with the file for every layout Steam has shipped that we
+//     claim to read (v28, and v29 with its string table).
+//   A file that is not appinfo.vdf, or is cut short, indexes to nothing rather
+//     than to spans that run off the end of the mapping.
+//   A saved index is only believed for the exact file it was built from: size
+//     and mtime both. Steam rewrites the file on every restart, and a stale
+//     offset decodes some other app's bytes.
+//   Launch entries come back in Steam's numeric order, not the map's "10"
+//     before "2", with Windows paths turned into ours.
+
+#include <QTest>
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QTemporaryDir>
+#include <QtEndian>
+
+#include "launchers/SteamAppInfo.h"
+#include "parsers/BinaryVDF.h"
+
+namespace {
+
+void putU32(QByteArray* out, quint32 value)
+{
+    char buf[4];
+    qToLittleEndian(value, buf);
+    out->append(buf, 4);
+}
+
+void putU64(QByteArray* out, quint64 value)
+{
+    char buf[8];
+    qToLittleEndian(value, buf);
+    out->append(buf, 8);
+}
+
+// Binary KeyValues for one app. Keys inline, or as indices into a shared
+// table for v29.
+class AppWriter
+{
+public:
+    explicit AppWriter(QList<QByteArray>* keys) : m_keys(keys) {}
+
+    AppWriter& map(const QByteArray& name) { m_bytes += char(BinaryVDF::Map); key(name); return *this; }
+    AppWriter& end() { m_bytes += char(BinaryVDF::End); return *this; }
+
+    AppWriter& str(const QByteArray& name, const QByteArray& value)
+    {
+        m_bytes += char(BinaryVDF::String);
+        key(name);
+        m_bytes += value;
+        m_bytes += '\0';
+        return *this;
+    }
+
+    QByteArray bytes() const { return m_bytes; }
+
+private:
+    void key(const QByteArray& name)
+    {
+        if (!m_keys) {
+            m_bytes += name;
+            m_bytes += '\0';
+            return;
+        }
+        qsizetype index = m_keys->indexOf(name);
+        if (index < 0) {
+            index = m_keys->size();
+            m_keys->append(name);
+        }
+        putU32(&m_bytes, static_cast<quint32>(index));
+    }
+
+    QList<QByteArray>* m_keys;
+    QByteArray m_bytes;
+};
+
+QByteArray appData(QList<QByteArray>* keys, const QByteArray& name, const QByteArray& type,
+                   bool withLaunch)
+{
+    AppWriter w(keys);
+    w.map("appinfo").map("common").str("name", name).str("type", type).end();
+    if (withLaunch) {
+        // Keyed out of order, and past 9, as Steam's are on older titles.
+        w.map("config").map("launch")
+            .map("10").str("executable", "tools\\editor.exe").str("type", "option1")
+                .map("config").str("oslist", "windows").end().end()
+            .map("2").str("executable", "game.sh").str("type", "default")
+                .map("config").str("oslist", "linux").end().end()
+            .map("0").str("executable", ".\\bin\\Game.exe").str("arguments", "-dx12")
+                .str("workingdir", "bin").str("type", "default")
+                .map("config").str("oslist", "windows").end().end()
+            .end().end();
+    }
+    w.end().end();
+    return w.bytes();
+}
+
+// A whole appinfo.vdf with the given apps, in the v28 or v29 layout.
+QByteArray appInfoFile(quint32 magic, const QList<QPair<quint32, QByteArray>>& apps,
+                       const QList<QByteArray>& keys = {})
+{
+    QByteArray out;
+    putU32(&out, magic);
+    putU32(&out, 1);                         // universe
+    const qsizetype tableOffsetAt = out.size();
+    if (magic == 0x07564429) {
+        putU64(&out, 0);                     // patched below
+    }
+
+    for (const auto& app : apps) {
+        putU32(&out, app.first);
+        putU32(&out, static_cast<quint32>(60 + app.second.size()));
+        out.append(60, '\x5a');              // state, tokens, hashes: unread
+        out.append(app.second);
+    }
+    putU32(&out, 0);
+
+    if (magic == 0x07564429) {
+        const quint64 tableOffset = static_cast<quint64>(out.size());
+        qToLittleEndian(tableOffset, out.data() + tableOffsetAt);
+        putU32(&out, static_cast<quint32>(keys.size()));
+        for (const QByteArray& key : keys) {
+            out.append(key);
+            out.append('\0');
+        }
+    }
+    return out;
+}
+
+QByteArray v28File()
+{
+    return appInfoFile(0x07564428, {
+        {220, appData(nullptr, "Half-Life 2", "Game", true)},
+        {228980, appData(nullptr, "Steamworks Common Redistributables", "Tool", false)},
+    });
+}
+
+QByteArray v29File()
+{
+    QList<QByteArray> keys;
+    const QByteArray hl2 = appData(&keys, "Half-Life 2", "Game", true);
+    const QByteArray sdk = appData(&keys, "Proton 9.0", "Tool", false);
+    return appInfoFile(0x07564429, {{220, hl2}, {2805730, sdk}}, keys);
+}
+
+bool writeFile(const QString& path, const QByteArray& data, const QDateTime& mtime)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::WriteOnly) || file.write(data) != data.size()) {
+        return false;
+    }
+    return file.setFileTime(mtime, QFileDevice::FileModificationTime);
+}
+
+} // namespace
+
+class TstSteamAppInfo : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void indexesEveryApp_data();
+    void indexesEveryApp();
+    void rejectsWhatIsNotAppInfo_data();
+    void rejectsWhatIsNotAppInfo();
+    void roundTripsTheIndex();
+    void distrustsAnIndexOfAnotherFile();
+
+    void readsOneApp_data();
+    void readsOneApp();
+    void ordersLaunchEntriesAsSteamDoes();
+    void answersNothingForAMissingFile();
+    void savesTheIndexAndFollowsARewrite();
+};
+
+void TstSteamAppInfo::indexesEveryApp_data()
+{
+    QTest::addColumn<QByteArray>("file");
+    QTest::addColumn<bool>("hasTable");
+
+    QTest::newRow("v28") << v28File() << false;
+    QTest::newRow("v29") << v29File() << true;
+}
+
+void TstSteamAppInfo::indexesEveryApp()
+{
+    QFETCH(QByteArray, file);
+    QFETCH(bool, hasTable);
+
+    QHash<quint32, SteamAppInfo::Span> index;
+    quint64 tableOffset = 0;
+    QString error;
+    QVERIFY2(SteamAppInfo::buildIndex(file, &index, &tableOffset, &error), qPrintable(error));
+    QCOMPARE(index.size(), 2);
+    QVERIFY(index.contains(220));
+    QCOMPARE(tableOffset > 0, hasTable);
+
+    // Each span starts at the app's KeyValues: a map type byte.
+    for (const SteamAppInfo::Span& span : std::as_const(index)) {
+        QVERIFY(span.offset + span.size <= static_cast<quint64>(file.size()));
+        QCOMPARE(file.at(static_cast<qsizetype>(span.offset)), char(BinaryVDF::Map));
+    }
+}
+
+void TstSteamAppInfo::rejectsWhatIsNotAppInfo_data()
+{
+    QTest::addColumn<QByteArray>("file");
+
+    const QByteArray whole = v28File();
+    QTest::newRow("empty") << QByteArray();
+    QTest::newRow("text vdf") << QByteArray("\"appinfo\"\n{\n}\n");
+    QTest::newRow("v26") << appInfoFile(0x07564426, {});
+    QTest::newRow("no terminator") << whole.left(whole.size() - 4);
+    QTest::newRow("entry cut short") << whole.left(whole.size() / 2);
+
+    QByteArray tableOutside = v29File();
+    qToLittleEndian(quint64(1) << 40, tableOutside.data() + 8);
+    QTest::newRow("table outside") << tableOutside;
+}
+
+void TstSteamAppInfo::rejectsWhatIsNotAppInfo()
+{
+    QFETCH(QByteArray, file);
+
+    QHash<quint32, SteamAppInfo::Span> index;
+    quint64 tableOffset = 0;
+    QString error;
+    QVERIFY(!SteamAppInfo::buildIndex(file, &index, &tableOffset, &error));
+    QVERIFY(!error.isEmpty());
+}
+
+void TstSteamAppInfo::roundTripsTheIndex()
+{
+    QHash<quint32, SteamAppInfo::Span> index;
+    quint64 tableOffset = 0;
+    const QByteArray file = v29File();
+    QVERIFY(SteamAppInfo::buildIndex(file, &index, &tableOffset, nullptr));
+
+    const QByteArray saved = SteamAppInfo::serializeIndex(file.size(), 1700000000000, tableOffset, index);
+
+    QHash<quint32, SteamAppInfo::Span> loaded;
+    quint64 loadedOffset = 0;
+    QVERIFY(SteamAppInfo::parseIndex(saved, file.size(), 1700000000000, &loadedOffset, &loaded));
+    QCOMPARE(loadedOffset, tableOffset);
+    QCOMPARE(loaded.size(), index.size());
+    for (auto it = index.constBegin(); it != index.constEnd(); ++it) {
+        QCOMPARE(loaded.value(it.key()).offset, it.value().offset);
+        QCOMPARE(loaded.value(it.key()).size, it.value().size);
+    }
+}
+
+void TstSteamAppInfo::distrustsAnIndexOfAnotherFile()
+{
+    QHash<quint32, SteamAppInfo::Span> index;
+    quint64 tableOffset = 0;
+    const QByteArray file = v28File();
+    QVERIFY(SteamAppInfo::buildIndex(file, &index, &tableOffset, nullptr));
+    const QByteArray saved = SteamAppInfo::serializeIndex(file.size(), 1000, tableOffset, index);
+
+    QHash<quint32, SteamAppInfo::Span> loaded;
+    quint64 loadedOffset = 0;
+    QVERIFY(!SteamAppInfo::parseIndex(saved, file.size(), 1001, &loadedOffset, &loaded));
+    QVERIFY(!SteamAppInfo::parseIndex(saved, file.size() + 1, 1000, &loadedOffset, &loaded));
+    QVERIFY(!SteamAppInfo::parseIndex(saved.left(saved.size() - 3), file.size(), 1000,
+                                      &loadedOffset, &loaded));
+    QVERIFY(!SteamAppInfo::parseIndex("PFAX" + saved.mid(4), file.size(), 1000,
+                                      &loadedOffset, &loaded));
+    QVERIFY(loaded.isEmpty());
+
+    // Spans past the end of a file of that size are not believed either.
+    const QByteArray shrunk = SteamAppInfo::serializeIndex(16, 1000, 0, index);
+    QVERIFY(!SteamAppInfo::parseIndex(shrunk, 16, 1000, &loadedOffset, &loaded));
+}
+
+void TstSteamAppInfo::readsOneApp_data()
+{
+    QTest::addColumn<QByteArray>("file");
+    QTest::addColumn<quint32>("toolId");
+
+    QTest::newRow("v28") << v28File() << quint32(228980);
+    QTest::newRow("v29") << v29File() << quint32(2805730);
+}
+
+void TstSteamAppInfo::readsOneApp()
+{
+    QFETCH(QByteArray, file);
+    QFETCH(quint32, toolId);
+
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    QVERIFY(writeFile(dir.filePath("appinfo.vdf"), file, QDateTime::currentDateTime()));
+
+    SteamAppInfo appInfo(dir.filePath("appinfo.vdf"), dir.filePath("cache/appinfo.index"));
+    QVERIFY(appInfo.contains(220));
+    QVERIFY(!appInfo.contains(440));
+
+    QString error;
+    const VDFNode hl2 = appInfo.appSection(220, &error);
+    QVERIFY2(error.isEmpty(), qPrintable(error));
+    QCOMPARE(hl2.child("common").getString("name"), QString("Half-Life 2"));
+    QCOMPARE(appInfo.appType(220), QString("game"));
+    QCOMPARE(appInfo.appType(toolId), QString("tool"));
+
+    QVERIFY(!appInfo.appSection(440, &error).isObject());
+    QVERIFY(!error.isEmpty());
+    QVERIFY(appInfo.appType(440).isEmpty());
+}
+
+void TstSteamAppInfo::ordersLaunchEntriesAsSteamDoes()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    QVERIFY(writeFile(dir.filePath("appinfo.vdf"), v29File(), QDateTime::currentDateTime()));
+
+    SteamAppInfo appInfo(dir.filePath("appinfo.vdf"), dir.filePath("appinfo.index"));
+    const QList<SteamAppInfo::LaunchEntry> entries = appInfo.launchEntries(220);
+    QCOMPARE(entries.size(), 3);
+
+    QCOMPARE(entries.at(0).executable, QString("bin/Game.exe"));
+    QCOMPARE(entries.at(0).arguments, QString("-dx12"));
+    QCOMPARE(entries.at(0).workingDir, QString("bin"));
+    QCOMPARE(entries.at(0).osList, QString("windows"));
+
+    QCOMPARE(entries.at(1).executable, QString("game.sh"));
+    QCOMPARE(entries.at(1).osList, QString("linux"));
+
+    QCOMPARE(entries.at(2).executable, QString("tools/editor.exe"));
+    QCOMPARE(entries.at(2).type, QString("option1"));
+
+    QVERIFY(appInfo.launchEntries(2805730).isEmpty());
+}
+
+void TstSteamAppInfo::answersNothingForAMissingFile()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+
+    SteamAppInfo appInfo(dir.filePath("appinfo.vdf"), dir.filePath("appinfo.index"));
+    QString error;
+    QVERIFY(!appInfo.appSection(220, &error).isObject());
+    QVERIFY(!error.isEmpty());
+    QVERIFY(!appInfo.contains(220));
+    QVERIFY(!QFile::exists(dir.filePath("appinfo.index")));
+}
+
+void TstSteamAppInfo::savesTheIndexAndFollowsARewrite()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    const QString path = dir.filePath("appinfo.vdf");
+    const QString indexPath = dir.filePath("cache/appinfo.index");
+    const QDateTime first = QDateTime::currentDateTime().addSecs(-3600);
+    QVERIFY(writeFile(path, v28File(), first));
+
+    {
+        SteamAppInfo appInfo(path, indexPath);
+        QCOMPARE(appInfo.appType(220), QString("game"));
+    }
+    QVERIFY(QFile::exists(indexPath));
+
+    // A second reader finds the index already there and trusts it.
+    {
+        QFile saved(indexPath);
+        QVERIFY(saved.open(QIODevice::ReadOnly));
+        QHash<quint32, SteamAppInfo::Span> index;
+        quint64 tableOffset = 0;
+        const QFileInfo info(path);
+        QVERIFY(SteamAppInfo::parseIndex(saved.readAll(), info.size(),
+                                         info.lastModified().toMSecsSinceEpoch(),
+                                         &tableOffset, &index));
+        QCOMPARE(index.size(), 2);
+
+        SteamAppInfo appInfo(path, indexPath);
+        QCOMPARE(appInfo.appType(228980), QString("tool"));
+    }
+
+    // Steam restarts and rewrites it with the apps moved: the same reader
+    // must see the new file, not the old offsets.
+    SteamAppInfo appInfo(path, indexPath);
+    QCOMPARE(appInfo.appType(220), QString("game"));
+
+    const QByteArray rewritten = appInfoFile(0x07564428, {
+        {440, appData(nullptr, "Team Fortress 2", "Game", false)},
+        {220, appData(nullptr, "Half-Life 2: Update", "Game", false)},
+    });
+    QVERIFY(writeFile(path, rewritten, first.addSecs(60)));
+
+    QCOMPARE(appInfo.appSection(220).child("common").getString("name"), QString("Half-Life 2: Update"));
+    QCOMPARE(appInfo.appType(440), QString("game"));
+    QVERIFY(!appInfo.contains(228980));
+}
+
+QTEST_MAIN(TstSteamAppInfo)
+#include "tst_steamappinfo.moc"
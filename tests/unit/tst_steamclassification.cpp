@@ -0,0 +1,171 @@
+// Whether a Steam game is native is decided by walking its install for an
+// .exe, and remembered so the walk is not redone on every start. What matters
+// about the memory is when it is trusted:
+//
+//   Only at the build and the directory stamp it was made at. An update, or a
+//     directory changed by hand, is a question asked again, not a stale answer.
+//   Never for a directory that could not be stat'ed — an unplugged drive's
+//     games are not known to be unchanged.
+//   And an old verdict is still the best guess while the new one is pending.
+//
+// A temporary directory stands in for the install and for the cache file.
+
+#include <QTest>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QTemporaryDir>
+
+#include "launchers/SteamClassificationCache.h"
+
+namespace {
+
+void touch(const QString& path)
+{
+    QDir().mkpath(QFileInfo(path).absolutePath());
+    QFile file(path);
+    QVERIFY(file.open(QIODevice::WriteOnly));
+}
+
+} // namespace
+
+class TstSteamClassification : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void roundTripsThroughJson();
+    void dropsAFileOfAnotherFormat();
+
+    void trustsOnlyTheSameBuildAndStamp();
+    void neverTrustsADirectoryItCouldNotStat();
+    void remembersTheLastVerdictAsAGuess();
+    void survivesARestart();
+
+    void findsAnExeAnywhereBelow();
+    void aNativeTreeHasNone();
+    void aMissingDirectoryHasNoStamp();
+};
+
+void TstSteamClassification::roundTripsThroughJson()
+{
+    QHash<QString, SteamClassificationCache::Entry> entries;
+    SteamClassificationCache::Entry native;
+    native.buildId = 14920183;
+    native.dirStamp = 1760000000123;
+    native.nativeLinux = true;
+    entries.insert("570", native);
+    SteamClassificationCache::Entry windows;
+    windows.buildId = 1;
+    windows.dirStamp = 2;
+    entries.insert("1245620", windows);
+
+    const auto parsed =
+        SteamClassificationCache::parse(SteamClassificationCache::serialize(entries));
+    QCOMPARE(parsed.size(), 2);
+    QCOMPARE(parsed.value("570").buildId, native.buildId);
+    QCOMPARE(parsed.value("570").dirStamp, native.dirStamp);
+    QVERIFY(parsed.value("570").nativeLinux);
+    QVERIFY(!parsed.value("1245620").nativeLinux);
+}
+
+void TstSteamClassification::dropsAFileOfAnotherFormat()
+{
+    QVERIFY(SteamClassificationCache::parse(
+                R"({"version": 99, "apps": {"570": {"buildId": 1, "dirStamp": 2, "native": true}}})")
+                .isEmpty());
+    QVERIFY(SteamClassificationCache::parse("not json").isEmpty());
+    QVERIFY(SteamClassificationCache::parse(QByteArray()).isEmpty());
+}
+
+void TstSteamClassification::trustsOnlyTheSameBuildAndStamp()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    SteamClassificationCache cache(dir.path() + "/platforms.json");
+    cache.store("570", 100, 5000, true);
+
+    bool native = false;
+    QVERIFY(cache.lookup("570", 100, 5000, &native));
+    QVERIFY(native);
+
+    QVERIFY2(!cache.lookup("570", 101, 5000, &native), "Steam applied an update");
+    QVERIFY2(!cache.lookup("570", 100, 5001, &native), "the directory was changed by hand");
+    QVERIFY(!cache.lookup("730", 100, 5000, &native));
+}
+
+void TstSteamClassification::neverTrustsADirectoryItCouldNotStat()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    SteamClassificationCache cache(dir.path() + "/platforms.json");
+    cache.store("570", 100, 0, true);
+
+    bool native = false;
+    QVERIFY(!cache.lookup("570", 100, 0, &native));
+}
+
+void TstSteamClassification::remembersTheLastVerdictAsAGuess()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    SteamClassificationCache cache(dir.path() + "/platforms.json");
+    cache.store("570", 100, 5000, true);
+
+    bool native = false;
+    QVERIFY(!cache.lookup("570", 101, 6000, &native));
+    QVERIFY(cache.lastKnown("570", &native));
+    QVERIFY(native);
+    QVERIFY(!cache.lastKnown("730", &native));
+}
+
+void TstSteamClassification::survivesARestart()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    const QString path = dir.path() + "/cache/platforms.json";
+    {
+        SteamClassificationCache cache(path);
+        cache.store("570", 100, 5000, true);
+        QVERIFY(cache.save());
+    }
+
+    SteamClassificationCache reopened(path);
+    bool native = false;
+    QVERIFY(reopened.lookup("570", 100, 5000, &native));
+    QVERIFY(native);
+}
+
+void TstSteamClassification::findsAnExeAnywhereBelow()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    touch(dir.path() + "/bin/linux/game.so");
+    touch(dir.path() + "/redist/deep/down/setup.exe");
+
+    QVERIFY(SteamClassificationCache::hasWindowsExecutables(dir.path()));
+}
+
+void TstSteamClassification::aNativeTreeHasNone()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    touch(dir.path() + "/bin/game.x86_64");
+    touch(dir.path() + "/data/level0.pak");
+
+    QVERIFY(!SteamClassificationCache::hasWindowsExecutables(dir.path()));
+    QVERIFY(SteamClassificationCache::directoryStamp(dir.path()) != 0);
+}
+
+void TstSteamClassification::aMissingDirectoryHasNoStamp()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    const QString gone = dir.path() + "/not-installed";
+
+    QCOMPARE(SteamClassificationCache::directoryStamp(gone), qint64(0));
+    QVERIFY(!SteamClassificationCache::hasWindowsExecutables(gone));
+}
+
+QTEST_MAIN(TstSteamClassification)
+#include "tst_steamclassification.moc"
@@ -0,0 +1,195 @@
+// The packed store of drawn cover sizes: one data file, one mapped index.
+//
+// What must hold:
+//   A variant comes back pixel for pixel, in a format QPixmap takes as is,
+//     and is still there when the store is opened again.
+//   Writing a key again replaces it; the old bytes are dead until compact()
+//     drops them.
+//   The index grows with the library, and nothing in it is lost doing so.
+//   Past its cap the store asks to be compacted, never does it in a write,
+//     and then keeps what was drawn most recently, within three quarters of
+//     the cap.
+//   A damaged or truncated file starts the store empty, never shows garbage.
+
+#include <QTest>
+#include <QColor>
+#include <QFile>
+#include <QTemporaryDir>
+
+#include "network/ThumbnailStore.h"
+
+namespace {
+
+QImage solid(const QSize& size, const QColor& color)
+{
+    QImage image(size, QImage::Format_RGB32);
+    image.fill(color);
+    return image;
+}
+
+// A 10x10 RGB32 variant, with its record header.
+constexpr qint64 kSmallRecord = 10 * 10 * 4 + 16;
+
+} // namespace
+
+class TstThumbnailStore : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void roundTripsAndPersists();
+    void replacesAndCompacts();
+    void growsWithTheLibrary();
+    void keepsTheMostRecentlyDrawnUnderItsCap();
+    void startsEmptyWhenDamaged();
+};
+
+void TstThumbnailStore::roundTripsAndPersists()
+{
+    QTemporaryDir dir;
+    {
+        ThumbnailStore store(dir.path());
+        QCOMPARE(store.count(), 0);
+        QVERIFY(store.find("a").isNull());
+
+        store.insert("a", solid(QSize(120, 56), QColor(30, 120, 200)));
+
+        QImage translucent(QSize(8, 4), QImage::Format_ARGB32);
+        translucent.fill(QColor(255, 0, 0, 128));
+        store.insert("b", translucent);
+
+        QCOMPARE(store.count(), 2);
+        QVERIFY(store.contains("a"));
+        QVERIFY(!store.contains("c"));
+    }
+
+    ThumbnailStore store(dir.path());
+    QCOMPARE(store.count(), 2);
+
+    const QImage a = store.find("a");
+    QCOMPARE(a.size(), QSize(120, 56));
+    QCOMPARE(a.format(), QImage::Format_RGB32);
+    QCOMPARE(a.pixelColor(60, 30), QColor(30, 120, 200));
+
+    const QImage b = store.find("b");
+    QCOMPARE(b.format(), QImage::Format_ARGB32_Premultiplied);
+    QCOMPARE(b.pixelColor(0, 0).alpha(), 128);
+}
+
+void TstThumbnailStore::replacesAndCompacts()
+{
+    QTemporaryDir dir;
+    ThumbnailStore store(dir.path());
+
+    store.insert("a", solid(QSize(10, 10), Qt::red));
+    store.insert("a", solid(QSize(10, 10), Qt::blue));
+    QCOMPARE(store.count(), 1);
+    QCOMPARE(store.liveBytes(), kSmallRecord);
+    QCOMPARE(store.dataBytes(), 2 * kSmallRecord);
+    QCOMPARE(store.find("a").pixelColor(0, 0), QColor(Qt::blue));
+
+    store.compact();
+    QCOMPARE(store.dataBytes(), kSmallRecord);
+    QCOMPARE(QFile(dir.filePath("thumbnails.dat")).size(), kSmallRecord);
+    QCOMPARE(store.find("a").pixelColor(0, 0), QColor(Qt::blue));
+}
+
+void TstThumbnailStore::growsWithTheLibrary()
+{
+    QTemporaryDir dir;
+    const int games = 3000;   // several times the first index
+    {
+        ThumbnailStore store(dir.path());
+        for (int i = 0; i < games; ++i) {
+            store.insert(QString::number(i), solid(QSize(2, 2), QColor(i % 256, 0, 0)));
+        }
+        QCOMPARE(store.count(), games);
+    }
+
+    ThumbnailStore store(dir.path());
+    QCOMPARE(store.count(), games);
+    for (int i = 0; i < games; ++i) {
+        const QImage image = store.find(QString::number(i));
+        QVERIFY2(!image.isNull(), qPrintable(QString::number(i)));
+        QCOMPARE(image.pixelColor(1, 1).red(), i % 256);
+    }
+}
+
+void TstThumbnailStore::keepsTheMostRecentlyDrawnUnderItsCap()
+{
+    QTemporaryDir dir;
+    ThumbnailStore store(dir.path(), 10 * kSmallRecord);
+
+    for (int i = 0; i < 10; ++i) {
+        store.insert(QString::number(i), solid(QSize(10, 10), Qt::green));
+    }
+    QCOMPARE(store.count(), 10);   // exactly at the cap is not over it
+    QVERIFY(!store.wantsCompaction());
+
+    // Drawn again, so the oldest write is now among the most recent.
+    QVERIFY(!store.find("0").isNull());
+
+    // Over the cap: the write goes in as it is, and the store says so.
+    store.insert("10", solid(QSize(10, 10), Qt::green));
+    QCOMPARE(store.count(), 11);
+    QVERIFY(store.wantsCompaction());
+
+    // Compacted: down to the seven records that fit in three quarters of it,
+    // newest first.
+    store.compact();
+    QVERIFY(!store.wantsCompaction());
+    QCOMPARE(store.count(), 7);
+    QVERIFY(store.dataBytes() <= 10 * kSmallRecord / 4 * 3);
+    for (const char* kept : {"10", "0", "9", "8", "7", "6", "5"}) {
+        QVERIFY2(store.contains(kept), kept);
+    }
+    for (const char* dropped : {"1", "2", "3", "4"}) {
+        QVERIFY2(!store.contains(dropped), dropped);
+    }
+
+    // Nothing larger than a quarter of the cap gets in at all.
+    store.insert("huge", solid(QSize(100, 100), Qt::green));
+    QVERIFY(!store.contains("huge"));
+}
+
+void TstThumbnailStore::startsEmptyWhenDamaged()
+{
+    QTemporaryDir dir;
+    {
+        ThumbnailStore store(dir.path());
+        store.insert("a", solid(QSize(10, 10), Qt::red));
+    }
+
+    // The data file lost its tail: the index points past the end.
+    {
+        QFile data(dir.filePath("thumbnails.dat"));
+        QVERIFY(data.resize(10));
+    }
+    {
+        ThumbnailStore store(dir.path());
+        QCOMPARE(store.count(), 0);
+        QVERIFY(store.find("a").isNull());
+        store.insert("a", solid(QSize(10, 10), Qt::red));
+        QVERIFY(!store.find("a").isNull());
+    }
+
+    // An index that is not one.
+    {
+        QFile index(dir.filePath("thumbnails.idx"));
+        QVERIFY(index.open(QIODevice::WriteOnly | QIODevice::Truncate));
+        index.write("not an index");
+    }
+    ThumbnailStore store(dir.path());
+    QCOMPARE(store.count(), 0);
+    store.insert("b", solid(QSize(10, 10), Qt::red));
+    QCOMPARE(store.find("b").pixelColor(0, 0), QColor(Qt::red));
+
+    // What clear() leaves is an empty store, not a closed one.
+    store.clear();
+    QCOMPARE(store.count(), 0);
+    store.insert("c", solid(QSize(10, 10), Qt::red));
+    QVERIFY(store.contains("c"));
+}
+
+QTEST_MAIN(TstThumbnailStore)
+#include "tst_thumbnailstore.moc"
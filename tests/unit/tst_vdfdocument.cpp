@@ -0,0 +1,196 @@
+// VDFDocument is the parser underneath VDFParser now, and the one the hot
+// paths use directly. tst_vdfparser pins the dialect through the old API;
+// this is about what the new one promises on top:
+//
+//   Nothing is copied. A value is a view into the bytes it was parsed from.
+//   Lookups answer like the old map did — the last of a repeated key wins —
+//     and keep the file's order for anyone walking children.
+//   Escapes are decoded when text is asked for, never before.
+//   An invalid ref is safe to keep asking: a path is walked without checks.
+
+#include <QTest>
+#include <QTemporaryDir>
+#include <QFile>
+
+#include "parsers/VDFDocument.h"
+#include "parsers/VDFParser.h"
+
+class TstVdfDocument : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void valuesPointIntoTheInput();
+    void walksAMissingPathSafely();
+    void keepsFileOrder();
+    void lastRepeatedKeyWins();
+    void decodesEscapesOnDemand();
+    void caseInsensitivePrefersAnExactMatch();
+    void emptyValuesAndBlocksSayWhatTheFileSays();
+    void survivesDeepNesting();
+    void failureLeavesNoRoot();
+    void skipsAByteOrderMark();
+    void compatTreeMatchesTheDocument();
+    void parseFileReadsFromDisk();
+};
+
+void TstVdfDocument::valuesPointIntoTheInput()
+{
+    const QByteArray bytes = R"("AppState" { "appid" "1245620" "name" "ELDEN RING" })";
+    VDFDocument doc;
+    QVERIFY2(doc.parse(bytes), qPrintable(doc.errorString()));
+
+    const VDFRef name = doc.root().child("AppState").child("name");
+    QVERIFY(name.isValue());
+    QCOMPARE(name.rawValue().toByteArray(), QByteArray("ELDEN RING"));
+    QVERIFY(name.rawValue().data() >= bytes.constData());
+    QVERIFY(name.rawValue().data() < bytes.constData() + bytes.size());
+    QCOMPARE(doc.root().child("AppState").getInt("appid"), 1245620LL);
+}
+
+void TstVdfDocument::walksAMissingPathSafely()
+{
+    VDFDocument doc;
+    QVERIFY(doc.parse(R"("a" { "b" "c" })"));
+
+    const VDFRef missing = doc.root().child("a").child("nope").child("deeper");
+    QVERIFY(!missing.isValid());
+    QVERIFY(!missing.isValue());
+    QVERIFY(!missing.isObject());
+    QCOMPARE(missing.childCount(), 0);
+    QCOMPARE(missing.getString("x", "fallback"), QString("fallback"));
+    QCOMPARE(missing.getInt("x", 7), 7LL);
+
+    QVERIFY(!VDFDocument().root().isValid());
+}
+
+void TstVdfDocument::keepsFileOrder()
+{
+    VDFDocument doc;
+    QVERIFY(doc.parse(R"("apps" { "730" "a" "10" "b" "570" "c" })"));
+
+    QStringList keys;
+    const VDFRef apps = doc.root().child("apps");
+    for (VDFRef c = apps.firstChild(); c.isValid(); c = c.nextSibling()) {
+        keys << c.key();
+    }
+    QCOMPARE(keys, (QStringList{"730", "10", "570"}));
+    QCOMPARE(apps.childCount(), 3);
+}
+
+void TstVdfDocument::lastRepeatedKeyWins()
+{
+    VDFDocument doc;
+    QVERIFY(doc.parse(R"("k" "first" "k" "second")"));
+    QCOMPARE(doc.root().getString("k"), QString("second"));
+
+    VDFParser parser;
+    QVERIFY(parser.parse(R"("k" "first" "k" "second")"));
+    QCOMPARE(parser.root().getString("k"), QString("second"));
+}
+
+void TstVdfDocument::decodesEscapesOnDemand()
+{
+    VDFDocument doc;
+    QVERIFY(doc.parse(R"("a\"b" "C:\\Games\\x\ty")"));
+
+    const VDFRef entry = doc.root().child("a\"b");
+    QVERIFY(entry.isValid());
+    QCOMPARE(entry.rawKey().toByteArray(), QByteArray(R"(a\"b)"));
+    QCOMPARE(entry.key(), QString("a\"b"));
+    QCOMPARE(entry.value(), QString("C:\\Games\\x\ty"));
+}
+
+void TstVdfDocument::caseInsensitivePrefersAnExactMatch()
+{
+    VDFDocument doc;
+    QVERIFY(doc.parse(R"("Apps" { "x" "1" } "apps" { "x" "2" } "Valve" { "x" "3" })"));
+
+    QCOMPARE(doc.root().childCaseInsensitive("apps").getString("x"), QString("2"));
+    QCOMPARE(doc.root().childCaseInsensitive("valve").getString("x"), QString("3"));
+    QVERIFY(!doc.root().child("valve").isValid());
+}
+
+void TstVdfDocument::emptyValuesAndBlocksSayWhatTheFileSays()
+{
+    VDFDocument doc;
+    QVERIFY(doc.parse(R"("root" { "label" "" "empty" { } })"));
+
+    const VDFRef root = doc.root().child("root");
+    QVERIFY(root.child("label").isValue());
+    QCOMPARE(root.getString("label", "fallback"), QString());
+    QVERIFY(root.child("empty").isObject());
+    QCOMPARE(root.child("empty").childCount(), 0);
+
+    // ...while the compatibility tree keeps the old answers.
+    const VDFNode node = root.toNode();
+    QVERIFY(!node.child("label").isValue());
+    QVERIFY(!node.child("empty").isObject());
+}
+
+void TstVdfDocument::survivesDeepNesting()
+{
+    const int depth = 100000;
+    QByteArray bytes;
+    for (int i = 0; i < depth; ++i) {
+        bytes += "\"k\" { ";
+    }
+    bytes += "\"leaf\" \"x\" ";
+    bytes += QByteArray(depth, '}');
+
+    VDFDocument doc;
+    QVERIFY2(doc.parse(bytes), qPrintable(doc.errorString()));
+    QCOMPARE(doc.nodeCount(), depth + 2);
+}
+
+void TstVdfDocument::failureLeavesNoRoot()
+{
+    VDFDocument doc;
+    QVERIFY(!doc.parse(R"("a" { "b" "c" )"));
+    QVERIFY(!doc.errorString().isEmpty());
+    QVERIFY(!doc.root().isValid());
+
+    QVERIFY(!doc.parse(R"("key" "value)"));
+    QCOMPARE(doc.errorString(), QString("Unterminated string"));
+}
+
+void TstVdfDocument::skipsAByteOrderMark()
+{
+    VDFDocument doc;
+    QVERIFY2(doc.parse("\xEF\xBB\xBF\"k\" \"v\""), qPrintable(doc.errorString()));
+    QCOMPARE(doc.root().getString("k"), QString("v"));
+}
+
+void TstVdfDocument::compatTreeMatchesTheDocument()
+{
+    VDFParser parser;
+    QVERIFY(parser.parse(QString::fromUtf8(R"("libraryfolders" { "0" { "path" "/home/ü/Steam" } })")));
+
+    QCOMPARE(parser.document().root().child("libraryfolders").child("0").getString("path"),
+             QString::fromUtf8("/home/ü/Steam"));
+    QCOMPARE(parser.root().child("libraryfolders").child("0").getString("path"),
+             QString::fromUtf8("/home/ü/Steam"));
+}
+
+void TstVdfDocument::parseFileReadsFromDisk()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+
+    const QString path = dir.filePath("localconfig.vdf");
+    QFile file(path);
+    QVERIFY(file.open(QIODevice::WriteOnly));
+    file.write("\"UserLocalConfigStore\"\r\n{\r\n\t\"LaunchOptions\"\t\t\"%command%\"\r\n}\r\n");
+    file.close();
+
+    VDFDocument doc;
+    QVERIFY2(doc.parseFile(path), qPrintable(doc.errorString()));
+    QCOMPARE(doc.root().child("UserLocalConfigStore").getString("LaunchOptions"),
+             QString("%command%"));
+
+    QVERIFY(!doc.parseFile(dir.filePath("missing.vdf")));
+    QVERIFY(!doc.errorString().isEmpty());
+}
+
+QTEST_MAIN(TstVdfDocument)
+#include "tst_vdfdocument.moc"
@@ -0,0 +1,228 @@
+// VDFQuery serves the reads that run most often — the update badge, the
+// launch-options lookup, library discovery — by reading as little of a file as
+// it can. What it has to get right:
+//
+//   The values are the tree parser's values.
+//   It stops once nothing still wanted could turn up, and not before.
+//   A block nobody asked about is stepped over, broken or not.
+//   What is read is checked exactly as strictly as the tree parser checks it.
+
+#include <QTest>
+#include <QTemporaryDir>
+#include <QFile>
+
+#include "parsers/VDFQuery.h"
+
+namespace {
+
+const QByteArray kManifest = R"("AppState"
+{
+	"appid"		"1245620"
+	"name"		"ELDEN RING"
+	"StateFlags"		"6"
+	"buildid"		"24407790"
+	"InstalledDepots"
+	{
+		"1245621"
+		{
+			"manifest"		"123"
+		}
+	}
+}
+)";
+
+const QByteArray kLocalConfig = R"("UserLocalConfigStore"
+{
+	"Software"
+	{
+		"Valve"
+		{
+			"Steam"
+			{
+				"Apps"
+				{
+					"570"
+					{
+						"LaunchOptions"		"-novid"
+						"BadgeData"		{ "x" "1" }
+					}
+					"1245620"
+					{
+						"BadgeData"		{ "x" "1" }
+						"launchoptions"		"PROTON_LOG=1 %command%"
+					}
+					"730"
+					{
+					}
+				}
+			}
+		}
+	}
+	"friends" { "a" "b" }
+}
+)";
+
+} // namespace
+
+class TstVdfQuery : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void readsWhatWasAskedFor();
+    void stopsOnceEverythingIsFound();
+    void stopsWhenTheBlockAPathRanThroughCloses();
+    void missingKeysFallBack();
+    void pathsMayEndAtABlock();
+    void wildcardCollectsEveryMatchInOrder();
+    void matchesKeysCaseInsensitivelyWhenAsked();
+    void stepsOverABrokenBlockNobodyAskedFor();
+    void stillRejectsWhatItReads_data();
+    void stillRejectsWhatItReads();
+    void decodesEscapes();
+    void runFileReadsFromDisk();
+};
+
+void TstVdfQuery::readsWhatWasAskedFor()
+{
+    VDFQuery query({"AppState/StateFlags", "AppState/buildid", "AppState/name"});
+    QVERIFY2(query.run(kManifest), qPrintable(query.errorString()));
+
+    QCOMPARE(query.intValue("AppState/StateFlags"), 6LL);
+    QCOMPARE(query.intValue("AppState/buildid"), 24407790LL);
+    QCOMPARE(query.value("AppState/name"), QString("ELDEN RING"));
+}
+
+void TstVdfQuery::stopsOnceEverythingIsFound()
+{
+    // Cut off in the middle of the depot list: the answers are all above it.
+    const QByteArray truncated = kManifest.left(kManifest.indexOf("\"manifest\""));
+
+    VDFQuery query({"AppState/StateFlags", "AppState/buildid"});
+    QVERIFY2(query.run(truncated), qPrintable(query.errorString()));
+    QVERIFY(query.stoppedEarly());
+    QCOMPARE(query.intValue("AppState/buildid"), 24407790LL);
+}
+
+void TstVdfQuery::stopsWhenTheBlockAPathRanThroughCloses()
+{
+    // 730 has no LaunchOptions: the answer is known at its closing brace,
+    // not at the end of the file.
+    const QString path = "UserLocalConfigStore/Software/Valve/Steam/Apps/730/LaunchOptions";
+    const QByteArray truncated = kLocalConfig.left(kLocalConfig.indexOf("\"friends\""));
+
+    VDFQuery query({path});
+    QVERIFY2(query.run(truncated), qPrintable(query.errorString()));
+    QVERIFY(query.stoppedEarly());
+    QVERIFY(!query.contains(path));
+}
+
+void TstVdfQuery::missingKeysFallBack()
+{
+    VDFQuery query({"AppState/SizeOnDisk", "Nope/name"});
+    QVERIFY(query.run(kManifest));
+    QVERIFY(!query.contains("AppState/SizeOnDisk"));
+    QCOMPARE(query.intValue("AppState/SizeOnDisk", -1), -1LL);
+    QCOMPARE(query.value("Nope/name", "fallback"), QString("fallback"));
+    QCOMPARE(query.value("never/asked"), QString());
+}
+
+void TstVdfQuery::pathsMayEndAtABlock()
+{
+    VDFQuery query({"AppState", "AppState/InstalledDepots", "AppState/name/more"});
+    QVERIFY(query.run(kManifest));
+    QVERIFY(query.contains("AppState"));
+    QVERIFY(query.contains("AppState/InstalledDepots"));
+    QVERIFY2(!query.contains("AppState/name/more"), "a value is not a block");
+}
+
+void TstVdfQuery::wildcardCollectsEveryMatchInOrder()
+{
+    const QByteArray folders = R"("libraryfolders"
+{
+	"contentstatsid"		"-1"
+	"1"		{ "path" "/mnt/b" "apps" { "10" "1" } }
+	"0"		{ "path" "/home/a" "apps" { } }
+	"2"		{ "label" "no path here" }
+}
+)";
+
+    VDFQuery query({"libraryfolders/*/path"});
+    QVERIFY2(query.run(folders), qPrintable(query.errorString()));
+    QCOMPARE(query.values("libraryfolders/*/path"), (QStringList{"/mnt/b", "/home/a"}));
+    QCOMPARE(query.value("libraryfolders/*/path"), QString("/mnt/b"));
+}
+
+void TstVdfQuery::matchesKeysCaseInsensitivelyWhenAsked()
+{
+    const QString path = "UserLocalConfigStore/Software/Valve/Steam/apps/1245620/LaunchOptions";
+
+    VDFQuery exact({path});
+    QVERIFY(exact.run(kLocalConfig));
+    QVERIFY(!exact.contains(path));
+
+    VDFQuery loose({path}, Qt::CaseInsensitive);
+    QVERIFY(loose.run(kLocalConfig));
+    QCOMPARE(loose.value(path), QString("PROTON_LOG=1 %command%"));
+    QVERIFY(loose.stoppedEarly());
+}
+
+void TstVdfQuery::stepsOverABrokenBlockNobodyAskedFor()
+{
+    // An unknown character inside "junk" would fail the tree parser; nobody
+    // asked about junk.
+    VDFQuery query({"root/want"});
+    QVERIFY2(query.run(R"("root" { "junk" { "a" = "b" { } } "want" "yes" })"),
+             qPrintable(query.errorString()));
+    QCOMPARE(query.value("root/want"), QString("yes"));
+}
+
+void TstVdfQuery::stillRejectsWhatItReads_data()
+{
+    QTest::addColumn<QByteArray>("raw");
+
+    QTest::newRow("unterminated string")  << QByteArray(R"("root" { "key" "value)");
+    QTest::newRow("unclosed object")      << QByteArray(R"("root" { "b" "c" )");
+    QTest::newRow("key without a value")  << QByteArray(R"("root" { "b" )");
+    QTest::newRow("stray closing brace")  << QByteArray(R"(})");
+    QTest::newRow("unclosed skipped block") << QByteArray(R"("other" { "b" "c" )");
+}
+
+void TstVdfQuery::stillRejectsWhatItReads()
+{
+    QFETCH(QByteArray, raw);
+
+    VDFQuery query({"root/want"});
+    QVERIFY2(!query.run(raw), "expected a parse failure");
+    QVERIFY(!query.errorString().isEmpty());
+}
+
+void TstVdfQuery::decodesEscapes()
+{
+    VDFQuery query({"root/path"});
+    QVERIFY(query.run(R"("root" { "path" "C:\\Games\\x" })"));
+    QCOMPARE(query.value("root/path"), QString("C:\\Games\\x"));
+}
+
+void TstVdfQuery::runFileReadsFromDisk()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+
+    const QString path = dir.filePath("appmanifest_1245620.acf");
+    QFile file(path);
+    QVERIFY(file.open(QIODevice::WriteOnly));
+    file.write(kManifest);
+    file.close();
+
+    VDFQuery query({"AppState/appid"});
+    QVERIFY2(query.runFile(path), qPrintable(query.errorString()));
+    QCOMPARE(query.value("AppState/appid"), QString("1245620"));
+
+    QVERIFY(!query.runFile(dir.filePath("missing.acf")));
+    QVERIFY(!query.contains("AppState/appid"));
+    QVERIFY(!query.errorString().isEmpty());
+}
+
+QTEST_MAIN(TstVdfQuery)
+#include "tst_vdfquery.moc"